@@ -23,6 +23,14 @@ Example usage:
       while state:
         ...  # Code executed within `while` loop is timed.
 
+  # With a batch size, the function only sets up the benchmark, and returns
+  # the callable to time, which the library calls in batches without a
+  # Python loop in between.
+  @benchmark.register(batch_size=100)
+  def my_batched_benchmark(state):
+      data = ...  # Not timed.
+      return lambda: kernel(data)  # Timed, less the cost of an empty call.
+
   if __name__ == '__main__':
     benchmark.main()
 """
@@ -30,7 +38,12 @@ Example usage:
 from absl import app
 from google_benchmark import _benchmark
 from google_benchmark._benchmark import (
+    BenchmarkReporter,
     Counter,
+    MemoryManager,
+    ProcessMemoryManager,
+    kTime,
+    kPercentage,
     kNanosecond,
     kMicrosecond,
     kMillisecond,
@@ -49,8 +62,16 @@ from google_benchmark._benchmark import (
 
 __all__ = [
     "register",
+    "register_memory_manager",
+    "run_benchmarks_for_results",
+    "results_array",
     "main",
+    "BenchmarkReporter",
     "Counter",
+    "MemoryManager",
+    "ProcessMemoryManager",
+    "kTime",
+    "kPercentage",
     "kNanosecond",
     "kMicrosecond",
     "kMillisecond",
@@ -115,11 +136,20 @@ class __OptionMaker:
 option = __OptionMaker()
 
 
-def register(undefined=None, *, name=None):
-    """Register function for benchmarking."""
+def register(undefined=None, *, name=None, batch_size=None, release_gil=False):
+    """Register function for benchmarking.
+
+    Without a batch_size, the function runs the benchmark loop itself. With
+    one, it is called once per run with the state and returns a callable
+    without arguments, which is timed batch_size calls at a time, less the
+    time a call of an empty function takes. With release_gil, the GIL is
+    released between the calls, for benchmarks of extensions that run without
+    it on several threads.
+    """
     if undefined is None:
         # Decorator is called without parenthesis so we return a decorator
-        return lambda f: register(f, name=name)
+        return lambda f: register(f, name=name, batch_size=batch_size,
+                                  release_gil=release_gil)
 
     # We have either the function to benchmark (simple case) or an instance of Options
     # (@option._ case).
@@ -130,7 +160,11 @@ def register(undefined=None, *, name=None):
 
     # We register the benchmark and reproduce all the @option._ calls onto the
     # benchmark builder pattern
-    benchmark = _benchmark.RegisterBenchmark(name, options.func)
+    if batch_size is None:
+        benchmark = _benchmark.RegisterBenchmark(name, options.func)
+    else:
+        benchmark = _benchmark.RegisterBatchedBenchmark(
+            name, options.func, batch_size, release_gil)
     for name, args, kwargs in options.builder_calls[::-1]:
         getattr(benchmark, name)(*args, **kwargs)
 
@@ -155,4 +189,31 @@ def main(argv=None):
 
 # Methods for use with custom main function.
 initialize = _benchmark.Initialize
+# Takes an optional BenchmarkReporter, whose report_runs(runs) is then called
+# with the runs of each benchmark instead of printing them.
 run_benchmarks = _benchmark.RunSpecifiedBenchmarks
+# Runs the benchmarks that match a regex, or --benchmark_filter if empty, and
+# returns their runs, as BenchmarkReporter.Run records, without printing them.
+run_benchmarks_for_results = _benchmark.RunSpecifiedBenchmarksForResults
+# Takes a MemoryManager, whose start() and stop(result) are called around an
+# extra run of each benchmark, or None to stop measuring memory.
+register_memory_manager = _benchmark.RegisterMemoryManager
+
+
+def results_array(runs):
+    """Return 'runs', as returned by run_benchmarks_for_results(), as a numpy
+    structured array with one record per run, and the times in nanoseconds."""
+    import numpy as np
+
+    multipliers = {kNanosecond: 1.0, kMicrosecond: 1e3, kMillisecond: 1e6,
+                   kSecond: 1e9}
+    dtype = [("name", object), ("aggregate_name", object),
+             ("iterations", np.uint64), ("threads", np.int64),
+             ("repetition_index", np.int64), ("real_time_ns", np.float64),
+             ("cpu_time_ns", np.float64), ("error_occurred", np.bool_)]
+    return np.array(
+        [(run.name, run.aggregate_name, run.iterations, run.threads,
+          run.repetition_index,
+          run.real_time * multipliers[run.time_unit],
+          run.cpu_time * multipliers[run.time_unit], run.error_occurred)
+         for run in runs], dtype=dtype)
@@ -1,6 +1,10 @@
 // Benchmark for Python.
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
 #include <map>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -39,8 +43,221 @@ std::vector<std::string> Initialize(const std::vector<std::string>& argv) {
 
 benchmark::internal::Benchmark* RegisterBenchmark(const char* name,
                                                   py::function f) {
+  return benchmark::RegisterBenchmark(name, [f](benchmark::State& state) {
+    py::gil_scoped_acquire gil;
+    f(&state);
+  });
+}
+
+// The threads of a benchmark wait for each other as they start and finish
+// their loops, which they can't while one of them holds the GIL.
+bool KeepRunning(benchmark::State& state) {
+  if (state.threads() == 1) return state.KeepRunning();
+  py::gil_scoped_release release;
+  return state.KeepRunning();
+}
+
+bool KeepRunningBatch(benchmark::State& state,
+                      benchmark::IterationCount batch_size) {
+  if (state.threads() == 1) return state.KeepRunningBatch(batch_size);
+  py::gil_scoped_release release;
+  return state.KeepRunningBatch(batch_size);
+}
+
+PyObject* CallWithoutArguments(PyObject* callable) {
+#if PY_VERSION_HEX >= 0x03090000
+  return PyObject_Vectorcall(callable, nullptr, 0, nullptr);
+#else
+  return PyObject_CallObject(callable, nullptr);
+#endif
+}
+
+// The seconds a call of a Python function that does nothing takes, the least
+// of a few rounds, which the batched benchmarks subtract from every call.
+// REQUIRES: The GIL is held.
+double CallOverhead() {
+  static const double overhead = [] {
+    const int kCalls = 1000;
+    py::object noop = py::eval("lambda: None");
+    double best = std::numeric_limits<double>::infinity();
+    for (int round = 0; round < 5; ++round) {
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < kCalls; ++i) {
+        PyObject* result = CallWithoutArguments(noop.ptr());
+        if (result == nullptr) throw py::error_already_set();
+        Py_DECREF(result);
+      }
+      const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      best = std::min(best, elapsed.count() / kCalls);
+    }
+    return best;
+  }();
+  return overhead;
+}
+
+// Time the callable that 'setup(state)' returns, called 'batch_size' times
+// per batch from here rather than once per iteration of a Python loop. With
+// 'release_gil', the GIL is released between the calls, so that the other
+// threads of the benchmark can make theirs.
+void RunBatched(const py::function& setup, benchmark::IterationCount batch_size,
+                bool release_gil, benchmark::State& state) {
+  py::gil_scoped_acquire gil;
+  py::object kernel = setup(&state);
+  if (state.error_occurred()) return;
+  const double overhead = CallOverhead();
+  PyObject* callable = kernel.ptr();
+  while (KeepRunningBatch(state, batch_size)) {
+    const auto start = std::chrono::steady_clock::now();
+    for (benchmark::IterationCount i = 0; i < batch_size; ++i) {
+      if (release_gil) {
+        // Let the threads waiting for the GIL take it before the next call.
+        py::gil_scoped_release release;
+      }
+      PyObject* result = CallWithoutArguments(callable);
+      if (result == nullptr) {
+        py::error_already_set error;
+        state.SkipWithError(error.what());
+        return;
+      }
+      Py_DECREF(result);
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    state.SetIterationTime(
+        std::max(0.0, elapsed.count() - overhead * batch_size));
+  }
+}
+
+// The library takes plain function pointers for statistics and complexity
+// functions, so the Python functions go to a fixed number of slots, each
+// with its own trampoline.
+const int kPythonFunctionSlots = 32;
+
+std::vector<py::function>& StatisticsSlots() {
+  static std::vector<py::function>* slots = new std::vector<py::function>;
+  return *slots;
+}
+
+std::vector<py::function>& ComplexitySlots() {
+  static std::vector<py::function>* slots = new std::vector<py::function>;
+  return *slots;
+}
+
+template <int I>
+double CallStatistics(const std::vector<double>& values) {
+  py::gil_scoped_acquire gil;
+  return StatisticsSlots()[I](values).cast<double>();
+}
+
+template <int I>
+double CallComplexity(benchmark::IterationCount n) {
+  py::gil_scoped_acquire gil;
+  return ComplexitySlots()[I](n).cast<double>();
+}
+
+template <int I>
+struct Trampolines {
+  static void Fill(benchmark::StatisticsFunc** statistics,
+                   benchmark::BigOFunc** complexity) {
+    statistics[I - 1] = &CallStatistics<I - 1>;
+    complexity[I - 1] = &CallComplexity<I - 1>;
+    Trampolines<I - 1>::Fill(statistics, complexity);
+  }
+};
+
+template <>
+struct Trampolines<0> {
+  static void Fill(benchmark::StatisticsFunc**, benchmark::BigOFunc**) {}
+};
+
+struct TrampolineTable {
+  TrampolineTable() {
+    Trampolines<kPythonFunctionSlots>::Fill(statistics, complexity);
+  }
+  benchmark::StatisticsFunc* statistics[kPythonFunctionSlots];
+  benchmark::BigOFunc* complexity[kPythonFunctionSlots];
+};
+
+const TrampolineTable& GetTrampolines() {
+  static const TrampolineTable* table = new TrampolineTable;
+  return *table;
+}
+
+void TakeSlot(std::vector<py::function>* slots, py::function f) {
+  if (static_cast<int>(slots->size()) == kPythonFunctionSlots) {
+    throw std::length_error(
+        "too many Python statistics or complexity functions");
+  }
+  slots->push_back(f);
+}
+
+benchmark::StatisticsFunc* StatisticsTrampoline(py::function f) {
+  TakeSlot(&StatisticsSlots(), f);
+  return GetTrampolines().statistics[StatisticsSlots().size() - 1];
+}
+
+benchmark::BigOFunc* ComplexityTrampoline(py::function f) {
+  TakeSlot(&ComplexitySlots(), f);
+  return GetTrampolines().complexity[ComplexitySlots().size() - 1];
+}
+
+// A MemoryManager that Python classes can implement, as start() and
+// stop(result), and optionally start_thread(index) and stop_thread(index).
+class PyMemoryManager : public benchmark::MemoryManager {
+ public:
+  void Start() override {
+    PYBIND11_OVERRIDE_PURE_NAME(void, benchmark::MemoryManager, "start",
+                                Start, );
+  }
+  void Stop(Result* result) override {
+    PYBIND11_OVERRIDE_PURE_NAME(void, benchmark::MemoryManager, "stop", Stop,
+                                result);
+  }
+  void StartThread(int thread_index) override {
+    PYBIND11_OVERRIDE_NAME(void, benchmark::MemoryManager, "start_thread",
+                           StartThread, thread_index);
+  }
+  void StopThread(int thread_index) override {
+    PYBIND11_OVERRIDE_NAME(void, benchmark::MemoryManager, "stop_thread",
+                           StopThread, thread_index);
+  }
+};
+
+void RegisterMemoryManager(py::object manager) {
+  // Kept alive for as long as the library may use it.
+  static py::object* registered = new py::object;
+  *registered = manager;
+  benchmark::RegisterMemoryManager(
+      manager.is_none() ? nullptr
+                        : manager.cast<benchmark::MemoryManager*>());
+}
+
+// A reporter that Python classes can implement, as report_runs(runs) and
+// optionally report_context(), which returns whether to run the benchmarks.
+class PyBenchmarkReporter : public benchmark::BenchmarkReporter {
+ public:
+  bool ReportContext(const Context&) override {
+    py::gil_scoped_acquire gil;
+    py::function report_context = py::get_override(this, "report_context");
+    return report_context ? report_context().cast<bool>() : true;
+  }
+  void ReportRuns(const std::vector<Run>& runs) override {
+    PYBIND11_OVERRIDE_PURE_NAME(void, benchmark::BenchmarkReporter,
+                                "report_runs", ReportRuns, runs);
+  }
+};
+
+benchmark::internal::Benchmark* RegisterBatchedBenchmark(
+    const char* name, py::function setup, benchmark::IterationCount batch_size,
+    bool release_gil) {
+  if (batch_size == 0) throw std::invalid_argument("batch_size must be > 0");
   return benchmark::RegisterBenchmark(
-      name, [f](benchmark::State& state) { f(&state); });
+             name,
+             [setup, batch_size, release_gil](benchmark::State& state) {
+               RunBatched(setup, batch_size, release_gil, state);
+             })
+      ->UseManualTime();
 }
 
 PYBIND11_MODULE(_benchmark, m) {
@@ -65,6 +282,12 @@ PYBIND11_MODULE(_benchmark, m) {
       .value("oLambda", BigO::oLambda)
       .export_values();
 
+  using benchmark::StatisticUnit;
+  py::enum_<StatisticUnit>(m, "StatisticUnit")
+      .value("kTime", StatisticUnit::kTime)
+      .value("kPercentage", StatisticUnit::kPercentage)
+      .export_values();
+
   using benchmark::internal::Benchmark;
   py::class_<Benchmark>(m, "Benchmark")
       // For methods returning a pointer tor the current object, reference
@@ -89,6 +312,14 @@ PYBIND11_MODULE(_benchmark, m) {
       .def("arg_name", &Benchmark::ArgName, py::return_value_policy::reference)
       .def("arg_names", &Benchmark::ArgNames,
            py::return_value_policy::reference)
+      .def("multiversion", &Benchmark::Multiversion,
+           py::return_value_policy::reference, py::arg("variants"))
+      .def("arg_strings", &Benchmark::ArgStrings,
+           py::return_value_policy::reference, py::arg("arg_index"),
+           py::arg("values"))
+      .def("arg_doubles", &Benchmark::ArgDoubles,
+           py::return_value_policy::reference, py::arg("arg_index"),
+           py::arg("values"))
       .def("range_pair", &Benchmark::RangePair,
            py::return_value_policy::reference, py::arg("lo1"), py::arg("hi1"),
            py::arg("lo2"), py::arg("hi2"))
@@ -99,6 +330,26 @@ PYBIND11_MODULE(_benchmark, m) {
            py::return_value_policy::reference)
       .def("repetitions", &Benchmark::Repetitions,
            py::return_value_policy::reference)
+      .def("threads", &Benchmark::Threads, py::return_value_policy::reference)
+      .def("thread_range", &Benchmark::ThreadRange,
+           py::return_value_policy::reference, py::arg("min_threads"),
+           py::arg("max_threads"))
+      .def("dense_thread_range", &Benchmark::DenseThreadRange,
+           py::return_value_policy::reference, py::arg("min_threads"),
+           py::arg("max_threads"), py::arg("stride") = 1)
+      .def("thread_per_cpu", &Benchmark::ThreadPerCpu,
+           py::return_value_policy::reference)
+      .def("memory_iterations", &Benchmark::MemoryIterations,
+           py::return_value_policy::reference)
+      .def(
+          "compute_statistics",
+          [](Benchmark* benchmark, const std::string& name, py::function f,
+             benchmark::StatisticUnit unit) {
+            return benchmark->ComputeStatistics(name, StatisticsTrampoline(f),
+                                                unit);
+          },
+          py::return_value_policy::reference, py::arg("name"),
+          py::arg("statistics"), py::arg("unit") = benchmark::kTime)
       .def("report_aggregates_only", &Benchmark::ReportAggregatesOnly,
            py::return_value_policy::reference, py::arg("value") = true)
       .def("display_aggregates_only", &Benchmark::DisplayAggregatesOnly,
@@ -113,7 +364,13 @@ PYBIND11_MODULE(_benchmark, m) {
           "complexity",
           (Benchmark * (Benchmark::*)(benchmark::BigO)) & Benchmark::Complexity,
           py::return_value_policy::reference,
-          py::arg("complexity") = benchmark::oAuto);
+          py::arg("complexity") = benchmark::oAuto)
+      .def(
+          "complexity_lambda",
+          [](Benchmark* benchmark, py::function f) {
+            return benchmark->Complexity(ComplexityTrampoline(f));
+          },
+          py::return_value_policy::reference);
 
   using benchmark::Counter;
   py::class_<Counter> py_counter(m, "Counter");
@@ -152,8 +409,8 @@ PYBIND11_MODULE(_benchmark, m) {
 
   using benchmark::State;
   py::class_<State>(m, "State")
-      .def("__bool__", &State::KeepRunning)
-      .def_property_readonly("keep_running", &State::KeepRunning)
+      .def("__bool__", KeepRunning)
+      .def_property_readonly("keep_running", KeepRunning)
       .def("pause_timing", &State::PauseTiming)
       .def("resume_timing", &State::ResumeTiming)
       .def("skip_with_error", &State::SkipWithError)
@@ -167,15 +424,94 @@ PYBIND11_MODULE(_benchmark, m) {
                     &State::SetItemsProcessed)
       .def("set_label", (void(State::*)(const char*)) & State::SetLabel)
       .def("range", &State::range, py::arg("pos") = 0)
+      .def("string_arg", &State::string_arg, py::arg("pos") = 0)
+      .def_property_readonly("variant", &State::variant)
+      .def("double_arg", &State::double_arg, py::arg("pos") = 0)
       .def_property_readonly("iterations", &State::iterations)
       .def_readwrite("counters", &State::counters)
       .def_property_readonly("thread_index", &State::thread_index)
       .def_property_readonly("threads", &State::threads);
 
+  using benchmark::MemoryManager;
+  py::class_<MemoryManager, PyMemoryManager> py_memory_manager(
+      m, "MemoryManager");
+  py_memory_manager.def(py::init<>());
+  py::class_<MemoryManager::Result>(py_memory_manager, "Result")
+      .def(py::init<>())
+      .def_readonly_static("TOMBSTONE", &MemoryManager::Result::TombstoneValue)
+      .def_readwrite("num_allocs", &MemoryManager::Result::num_allocs)
+      .def_readwrite("max_bytes_used", &MemoryManager::Result::max_bytes_used)
+      .def_readwrite("total_allocated_bytes",
+                     &MemoryManager::Result::total_allocated_bytes)
+      .def_readwrite("num_frees", &MemoryManager::Result::num_frees)
+      .def_readwrite("net_heap_growth", &MemoryManager::Result::net_heap_growth)
+      .def_readwrite("alloc_size_histogram",
+                     &MemoryManager::Result::alloc_size_histogram)
+      .def_readwrite("peak_rss_bytes", &MemoryManager::Result::peak_rss_bytes)
+      .def_readwrite("minor_page_faults",
+                     &MemoryManager::Result::minor_page_faults)
+      .def_readwrite("major_page_faults",
+                     &MemoryManager::Result::major_page_faults)
+      .def_readwrite("thread_allocs", &MemoryManager::Result::thread_allocs)
+      .def_readwrite("thread_allocated_bytes",
+                     &MemoryManager::Result::thread_allocated_bytes);
+  py::class_<benchmark::ProcessMemoryManager, MemoryManager>(
+      m, "ProcessMemoryManager")
+      .def(py::init<>());
+
+  using benchmark::BenchmarkReporter;
+  py::class_<BenchmarkReporter, PyBenchmarkReporter> py_reporter(
+      m, "BenchmarkReporter");
+  py_reporter.def(py::init<>());
+  // The perf counters of a run are among its counters, by event name.
+  using Run = BenchmarkReporter::Run;
+  py::class_<Run>(py_reporter, "Run")
+      .def_property_readonly("name", &Run::benchmark_name)
+      .def_readonly("family_index", &Run::family_index)
+      .def_readonly("per_family_instance_index",
+                    &Run::per_family_instance_index)
+      .def_property_readonly(
+          "is_aggregate",
+          [](const Run& run) { return run.run_type == Run::RT_Aggregate; })
+      .def_readonly("aggregate_name", &Run::aggregate_name)
+      .def_readonly("label", &Run::report_label)
+      .def_readonly("error_occurred", &Run::error_occurred)
+      .def_readonly("error_message", &Run::error_message)
+      .def_readonly("iterations", &Run::iterations)
+      .def_readonly("threads", &Run::threads)
+      .def_readonly("repetition_index", &Run::repetition_index)
+      .def_readonly("time_unit", &Run::time_unit)
+      .def_property_readonly("real_time", &Run::GetAdjustedRealTime)
+      .def_property_readonly("cpu_time", &Run::GetAdjustedCPUTime)
+      .def_readonly("counters", &Run::counters)
+      .def_readonly("has_memory_result", &Run::has_memory_result)
+      .def_readonly("allocs_per_iter", &Run::allocs_per_iter)
+      .def_readonly("memory_iterations", &Run::memory_iterations)
+      .def_readonly("memory_result", &Run::memory_result);
+
+  m.def("RegisterMemoryManager", RegisterMemoryManager, py::arg("manager"));
   m.def("Initialize", Initialize);
   m.def("RegisterBenchmark", RegisterBenchmark,
         py::return_value_policy::reference);
-  m.def("RunSpecifiedBenchmarks",
-        []() { benchmark::RunSpecifiedBenchmarks(); });
+  m.def("RegisterBatchedBenchmark", RegisterBatchedBenchmark,
+        py::return_value_policy::reference, py::arg("name"), py::arg("setup"),
+        py::arg("batch_size"), py::arg("release_gil") = false);
+  // The benchmarks take the GIL when they call into Python, so that those of
+  // several threads can run.
+  m.def(
+      "RunSpecifiedBenchmarks", []() { benchmark::RunSpecifiedBenchmarks(); },
+      py::call_guard<py::gil_scoped_release>());
+  m.def(
+      "RunSpecifiedBenchmarks",
+      [](BenchmarkReporter* reporter) {
+        benchmark::RunSpecifiedBenchmarks(reporter);
+      },
+      py::call_guard<py::gil_scoped_release>(), py::arg("reporter"));
+  m.def(
+      "RunSpecifiedBenchmarksForResults",
+      [](const std::string& spec) {
+        return benchmark::RunSpecifiedBenchmarks(spec);
+      },
+      py::call_guard<py::gil_scoped_release>(), py::arg("spec") = "");
 };
 }  // namespace
@@ -122,6 +122,21 @@ def using_range(state):
         sum(range(state.range(0)))
 
 
+@benchmark.register(batch_size=1000)
+@benchmark.option.arg(1000)
+def batched_sum(state):
+    """Time only the calls of the returned callable, without a Python loop."""
+    numbers = list(range(state.range(0)))
+    return lambda: sum(numbers)
+
+
+@benchmark.register(batch_size=10, release_gil=True)
+@benchmark.option.threads(4)
+def batched_threads(state):
+    """Threads wait for each other only while they hold the GIL."""
+    return lambda: time.sleep(0.001)
+
+
 @benchmark.register
 @benchmark.option.range_multiplier(2)
 @benchmark.option.range(1 << 10, 1 << 18)
@@ -132,5 +147,14 @@ def computing_complexity(state):
     state.complexity_n = state.range(0)
 
 
+@benchmark.register
+@benchmark.option.thread_range(1, 4)
+@benchmark.option.compute_statistics("max", max)
+@benchmark.option.repetitions(3)
+def thread_scaling(state):
+    while state:
+        sum(range(1000))
+
+
 if __name__ == "__main__":
     benchmark.main()
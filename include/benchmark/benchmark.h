@@ -193,6 +193,16 @@ BENCHMARK(BM_test)->Unit(benchmark::kMillisecond);
 #include <utility>
 #endif
 
+// C++20 coroutines, for BENCHMARK_ASYNC().
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#define BENCHMARK_HAS_COROUTINES
+#endif
+#endif
+
 #if defined(_MSC_VER)
 #include <intrin.h>  // for _ReadWriteBarrier
 #endif
@@ -344,19 +354,131 @@ inline BENCHMARK_ALWAYS_INLINE void ClobberMemory() {
 // intended to add little to no overhead.
 // See: https://youtu.be/nXaxk27zwlk?t=2441
 #ifndef BENCHMARK_HAS_NO_INLINE_ASSEMBLY
+#if defined(BENCHMARK_HAS_CXX11) &&                               \
+    (((defined(__x86_64__) || defined(__i386__)) && defined(__SSE__)) || \
+     defined(__aarch64__))
+// The vector types of the compiler, such as __m256 or float32x4_t, are kept
+// in the vector registers, rather than spilled to memory for lack of a
+// general purpose one that holds them. 'x' is any of xmm0-15 (or their ymm
+// and zmm), 'v' any of the 32 with AVX-512, 'w' any of v0-31 on AArch64.
+#if defined(__aarch64__)
+#define BENCHMARK_VECTOR_REGISTER "w"
+#elif defined(__AVX512F__)
+#define BENCHMARK_VECTOR_REGISTER "v"
+#else
+#define BENCHMARK_VECTOR_REGISTER "x"
+#endif
+
+namespace internal {
+
+template <class Tp, class = void>
+struct IsSubscriptable : std::false_type {};
+
 template <class Tp>
-inline BENCHMARK_ALWAYS_INLINE void DoNotOptimize(Tp const& value) {
+struct IsSubscriptable<Tp, decltype((void)std::declval<Tp&>()[0])>
+    : std::true_type {};
+
+// Whether Tp is a vector type of the compiler, which is none of the kinds of
+// types of the standard but can be indexed, of a size that the enabled
+// instruction sets have registers for.
+template <class Tp>
+struct InVectorRegister {
+  typedef typename std::remove_cv<Tp>::type Type;
+  static const bool value =
+      std::is_object<Type>::value && !std::is_class<Type>::value &&
+      !std::is_union<Type>::value && !std::is_array<Type>::value &&
+      !std::is_scalar<Type>::value && IsSubscriptable<Type>::value &&
+#if defined(__aarch64__)
+      (sizeof(Type) == 8 || sizeof(Type) == 16);
+#else
+      (sizeof(Type) == 16
+#if defined(__AVX__)
+       || sizeof(Type) == 32
+#endif
+#if defined(__AVX512F__)
+       || sizeof(Type) == 64
+#endif
+      );
+#endif
+};
+
+}  // namespace internal
+
+template <class Tp>
+inline BENCHMARK_ALWAYS_INLINE
+    typename std::enable_if<internal::InVectorRegister<Tp>::value>::type
+    DoNotOptimize(Tp const& value) {
+  asm volatile("" : : BENCHMARK_VECTOR_REGISTER(value) : "memory");
+}
+
+template <class Tp>
+inline BENCHMARK_ALWAYS_INLINE
+    typename std::enable_if<internal::InVectorRegister<Tp>::value>::type
+    DoNotOptimize(Tp& value) {
+  asm volatile("" : "+" BENCHMARK_VECTOR_REGISTER(value) : : "memory");
+}
+
+// Aggregates too large for a general purpose register are left in memory,
+// rather than copied to the stack for the register alternative.
+template <class Tp>
+inline BENCHMARK_ALWAYS_INLINE
+    typename std::enable_if<!internal::InVectorRegister<Tp>::value &&
+                            (sizeof(Tp) > sizeof(void*))>::type
+    DoNotOptimize(Tp const& value) {
+  asm volatile("" : : "m"(value) : "memory");
+}
+
+template <class Tp>
+inline BENCHMARK_ALWAYS_INLINE
+    typename std::enable_if<!internal::InVectorRegister<Tp>::value &&
+                            (sizeof(Tp) > sizeof(void*))>::type
+    DoNotOptimize(Tp& value) {
+  asm volatile("" : "+m"(value) : : "memory");
+}
+
+#define BENCHMARK_DONOTOPTIMIZE_RETURN(Tp)                         \
+  typename std::enable_if<!internal::InVectorRegister<Tp>::value && \
+                          (sizeof(Tp) <= sizeof(void*))>::type
+#undef BENCHMARK_VECTOR_REGISTER
+#else
+#define BENCHMARK_DONOTOPTIMIZE_RETURN(Tp) void
+#endif
+
+template <class Tp>
+inline BENCHMARK_ALWAYS_INLINE BENCHMARK_DONOTOPTIMIZE_RETURN(Tp)
+    DoNotOptimize(Tp const& value) {
   asm volatile("" : : "r,m"(value) : "memory");
 }
 
 template <class Tp>
-inline BENCHMARK_ALWAYS_INLINE void DoNotOptimize(Tp& value) {
+inline BENCHMARK_ALWAYS_INLINE BENCHMARK_DONOTOPTIMIZE_RETURN(Tp)
+    DoNotOptimize(Tp& value) {
 #if defined(__clang__)
   asm volatile("" : "+r,m"(value) : : "memory");
 #else
   asm volatile("" : "+m,r"(value) : : "memory");
 #endif
 }
+#undef BENCHMARK_DONOTOPTIMIZE_RETURN
+
+// The DoNotOptimizeRange(...) functions make the compiler assume that the
+// 'count' objects at 'data' are read, and written unless they are const, by
+// code it can't see, as DoNotOptimize(...) does for a single object, but
+// without the barrier on all the memory of ClobberMemory(). The operand is
+// an array of unknown bound at 'data', which covers any count.
+template <class Tp>
+inline BENCHMARK_ALWAYS_INLINE void DoNotOptimizeRange(Tp const* data,
+                                                       size_t count) {
+  if (count == 0) return;
+  asm volatile("" : : "m"(*(Tp const(*)[])data));
+}
+
+template <class Tp>
+inline BENCHMARK_ALWAYS_INLINE void DoNotOptimizeRange(Tp* data,
+                                                       size_t count) {
+  if (count == 0) return;
+  asm volatile("" : "+m"(*(Tp(*)[])data));
+}
 
 #ifndef BENCHMARK_HAS_CXX11
 inline BENCHMARK_ALWAYS_INLINE void ClobberMemory() {
@@ -370,6 +492,14 @@ inline BENCHMARK_ALWAYS_INLINE void DoNotOptimize(Tp const& value) {
   _ReadWriteBarrier();
 }
 
+template <class Tp>
+inline BENCHMARK_ALWAYS_INLINE void DoNotOptimizeRange(Tp const* data,
+                                                       size_t count) {
+  if (count == 0) return;
+  internal::UseCharPointer(reinterpret_cast<char const volatile*>(data));
+  _ReadWriteBarrier();
+}
+
 #ifndef BENCHMARK_HAS_CXX11
 inline BENCHMARK_ALWAYS_INLINE void ClobberMemory() { _ReadWriteBarrier(); }
 #endif
@@ -378,6 +508,13 @@ template <class Tp>
 inline BENCHMARK_ALWAYS_INLINE void DoNotOptimize(Tp const& value) {
   internal::UseCharPointer(&reinterpret_cast<char const volatile&>(value));
 }
+
+template <class Tp>
+inline BENCHMARK_ALWAYS_INLINE void DoNotOptimizeRange(Tp const* data,
+                                                       size_t count) {
+  if (count == 0) return;
+  internal::UseCharPointer(reinterpret_cast<char const volatile*>(data));
+}
 // FIXME Add ClobberMemory() for non-gnu and non-msvc compilers, before C++11.
 #endif
 
@@ -451,10 +588,46 @@ enum TimeUnit { kNanosecond, kMicrosecond, kMillisecond, kSecond };
 // calculated automatically to the best fit.
 enum BigO { oNone, o1, oN, oNSquared, oNCubed, oLogN, oNLogN, oAuto, oLambda };
 
+// ComplexityModel is passed to a benchmark whose complexity is fitted over
+// several inputs, to combine the terms of the inputs: as a sum with a
+// coefficient per term (e.g. a*N + b*lgM), or as a product with a single
+// coefficient (e.g. a*NlgM).
+enum ComplexityModel { kAdditiveComplexity, kMultiplicativeComplexity };
+
+// TuneStrategy is passed to Benchmark::Tune() to pick how it searches the
+// args. kTuneCoordinateDescent moves along one arg at a time, to its best
+// value with the others fixed, until none improves. kTuneSuccessiveHalving
+// measures a sample of the args briefly, then the better half of them for
+// twice as long, and so on until one is left.
+enum TuneStrategy { kTuneCoordinateDescent, kTuneSuccessiveHalving };
+
 typedef uint64_t IterationCount;
 
 enum StatisticUnit { kTime, kPercentage };
 
+// PinPolicy is passed to a benchmark to pick the cpus its threads run on.
+// kPinDefault follows the --benchmark_cpu_affinity flag; kPinCompact packs the
+// threads onto as few cores and NUMA nodes as possible, kPinScatter spreads
+// them over as many as possible, kPinNumaNodes lets each thread run anywhere
+// on one NUMA node (round-robin over the nodes), and kPinCpuList is used for
+// an explicit list of cpus. kPinCores puts one thread on each core of a
+// package, then of the next package, and only then on the other hyperthreads
+// of the cores.
+enum PinPolicy {
+  kPinDefault,
+  kPinNone,
+  kPinCompact,
+  kPinScatter,
+  kPinNumaNodes,
+  kPinCpuList,
+  kPinCores
+};
+
+// ArrivalProcess is passed to a benchmark run at a target rate, to pick when
+// its iterations are due: at a constant interval, or as a Poisson process
+// (exponentially distributed intervals) of the same mean rate.
+enum ArrivalProcess { kConstantArrivals, kPoissonArrivals };
+
 // BigOFunc is passed to a benchmark in order to specify the asymptotic
 // computational complexity for the benchmark.
 typedef double(BigOFunc)(IterationCount);
@@ -478,6 +651,10 @@ class BenchmarkInstance;
 class ThreadTimer;
 class ThreadManager;
 class PerfCountersMeasurement;
+class RegionProfile;
+class LatencyHistogram;
+class ArrivalSchedule;
+class Profiler;
 
 enum AggregationReportMode
 #if defined(BENCHMARK_HAS_CXX11)
@@ -501,6 +678,87 @@ enum AggregationReportMode
 
 }  // namespace internal
 
+// A handle to a user counter registered with State::RegisterCounter().
+class CounterHandle {
+ public:
+  CounterHandle() : index_(static_cast<size_t>(-1)) {}
+
+ private:
+  friend class State;
+  explicit CounterHandle(size_t index) : index_(index) {}
+
+  size_t index_;
+};
+
+#if defined(BENCHMARK_HAS_CXX11)
+namespace internal {
+// The value of a shared counter owned by one thread. Only the owner writes
+// it; the padding keeps the values of two threads off the same cache line.
+struct SharedCounterSlot {
+  SharedCounterSlot() : value(0) {}
+
+  std::atomic<double> value;
+  char padding[128 - sizeof(std::atomic<double>)];
+};
+}  // namespace internal
+
+// A counter that all the threads of a benchmark add to, returned by
+// State::RegisterSharedCounter(). Each thread adds to its own slot, without
+// any atomic read-modify-write or shared cache line, and the slots are summed
+// when the counter is read with Total() or reported.
+class SharedCounter {
+ public:
+  SharedCounter() : slot_(NULL), slots_(NULL), num_threads_(0) {}
+
+  BENCHMARK_ALWAYS_INLINE
+  void Add(double v) {
+    assert(slot_ != NULL);
+    slot_->value.store(slot_->value.load(std::memory_order_relaxed) + v,
+                       std::memory_order_relaxed);
+  }
+
+  BENCHMARK_ALWAYS_INLINE
+  SharedCounter& operator+=(double v) {
+    Add(v);
+    return *this;
+  }
+
+  // The sum over all the threads of what they added so far. Any thread may
+  // call this while the others are still adding, e.g. to sample the counter
+  // periodically.
+  double Total() const;
+
+ private:
+  friend class State;
+  SharedCounter(internal::SharedCounterSlot* slot,
+                internal::SharedCounterSlot* slots, int num_threads)
+      : slot_(slot), slots_(slots), num_threads_(num_threads) {}
+
+  internal::SharedCounterSlot* slot_;
+  internal::SharedCounterSlot* slots_;
+  int num_threads_;
+};
+#endif
+
+// A source of timestamps that are taken asynchronously, behind the work
+// enqueued before them, e.g. the events of a GPU stream or the completions of
+// a storage queue, for State::SetAsyncTimer().
+class AsyncTimer {
+ public:
+  virtual ~AsyncTimer() {}
+
+  // Enqueue a timestamp, and return a handle to it, which stays valid until
+  // it is passed to Release().
+  virtual uint64_t Record() = 0;
+
+  // The seconds from the timestamp 'start' to the timestamp 'stop', waiting
+  // for them to be taken if they weren't yet.
+  virtual double ElapsedSeconds(uint64_t start, uint64_t stop) = 0;
+
+  // Done with the timestamp 'event'.
+  virtual void Release(uint64_t event) { (void)event; }
+};
+
 // State is passed to a running Benchmark and contains state for the
 // benchmark to use.
 class State {
@@ -535,6 +793,39 @@ class State {
   //   }
   bool KeepRunningBatch(IterationCount n);
 
+  // Run the benchmark in batches of 'batch_size' items, for benchmarks that
+  // need fresh input for every iteration. For each batch, 'setup(i)' is
+  // called for every 'i' in [0, batch_size) with the timer paused, and then
+  // 'body(i)' for every 'i', timed back to back. Each item counts as one
+  // iteration, so the reported times are per item. This pauses the timer once
+  // per batch, rather than once per iteration with the usual
+  // PauseTiming()/ResumeTiming() pattern.
+  // REQUIRES: 'batch_size' > 0.
+  // NOTE: This replaces the benchmark loop, and like KeepRunningBatch(),
+  // may overshoot by up to 'batch_size' iterations.
+  //
+  // Intended usage:
+  //   std::vector<std::string> inputs(64);
+  //   state.RunBatched(
+  //       64, [&](benchmark::IterationCount i) { inputs[i] = MakeInput(); },
+  //       [&](benchmark::IterationCount i) { Parse(&inputs[i]); });
+  template <class Setup, class Body>
+  void RunBatched(IterationCount batch_size, Setup setup, Body body);
+
+  // Run 'body()' once per iteration, like the benchmark loop, but 'kFactor'
+  // times in a row for each check of the iterations left, so that the loop
+  // adds less to bodies of a few nanoseconds. The iterations left over, fewer
+  // than 'kFactor', run one at a time: each call counts as one iteration, and
+  // the times stay those of one. The factor is reported as the counter
+  // 'unroll_factor'.
+  // REQUIRES: 'kFactor' > 0.
+  // NOTE: This replaces the benchmark loop.
+  //
+  // Intended usage:
+  //   state.RunUnrolled<8>([&] { benchmark::DoNotOptimize(x += y); });
+  template <int kFactor, class Body>
+  void RunUnrolled(Body body);
+
   // REQUIRES: timer is running and 'SkipWithError(...)' has not been called
   //           by the current thread.
   // Stop the benchmark timer.  If not called, the timer will be
@@ -548,7 +839,8 @@ class State {
   //
   // NOTE: PauseTiming()/ResumeTiming() are relatively
   // heavyweight, and so their use should generally be avoided
-  // within each benchmark iteration, if possible.
+  // within each benchmark iteration, if possible. Their estimated cost is
+  // subtracted from the reported times.
   void PauseTiming();
 
   // REQUIRES: timer is not running and 'SkipWithError(...)' has not been called
@@ -586,6 +878,16 @@ class State {
   // Returns true if an error has been reported with 'SkipWithError(...)'.
   bool error_occurred() const { return error_occurred_; }
 
+  // Evict the caches, so that what comes next runs from memory. The timer is
+  // paused while doing so, if it is running. The first overload evicts
+  // everything the current cpu has cached, by reading through a buffer twice
+  // the size of its largest cache, which takes milliseconds. The second one
+  // only evicts the lines of [data, data + size), which is much cheaper for
+  // small regions wherever the CPU can flush cache lines (x86 and AArch64).
+  // Either way, the run is reported as having a cold cache.
+  void FlushCaches();
+  void FlushCaches(const void* data, size_t size);
+
   // REQUIRES: called exactly once per iteration of the benchmarking loop.
   // Set the manually measured time for this benchmark iteration, which
   // is used instead of automatically measured time if UseManualTime() was
@@ -595,6 +897,24 @@ class State {
   // reported values.
   void SetIterationTime(double seconds);
 
+  // Time the iterations of a UseManualTime() benchmark whose work runs
+  // asynchronously with 'timer', rather than waiting for the work of each
+  // iteration to be done to call SetIterationTime(). Each iteration calls
+  // StartAsyncIteration() before enqueuing its work, and StopAsyncIteration()
+  // after, which only enqueue timestamps. Up to 'max_in_flight' iterations
+  // are left in flight; once there are that many, the times of the oldest
+  // half of them are waited for. All of them are by the end of the loop,
+  // before the time of the run is looked at. 'timer' must outlive the loop.
+  void SetAsyncTimer(AsyncTimer* timer, int max_in_flight = 64);
+  void StartAsyncIteration();
+  void StopAsyncIteration();
+
+  // Record the latency of one operation, of 'seconds', in the latency
+  // histogram of the run if RecordLatencyHistogram() is used, for benchmarks
+  // whose operations are not timed by the iterations of the loop, e.g. those
+  // of BENCHMARK_ASYNC(). Does nothing otherwise.
+  void RecordLatency(double seconds);
+
   // Set the number of bytes processed by the current benchmark
   // execution.  This routine is typically called once at the end of a
   // throughput oriented benchmark.
@@ -624,6 +944,17 @@ class State {
   BENCHMARK_ALWAYS_INLINE
   int64_t complexity_length_n() const { return complexity_n_; }
 
+  // Set the lengths of the several inputs of a benchmark whose complexity is
+  // fitted over all of them (see Benchmark::Complexity(terms)), e.g.
+  // 'SetComplexityN({build_size, probe_size})'.
+  void SetComplexityN(const std::vector<int64_t>& complexity_n) {
+    complexity_ns_ = complexity_n;
+  }
+
+  const std::vector<int64_t>& complexity_lengths_n() const {
+    return complexity_ns_;
+  }
+
   // If this routine is called with items > 0, then an items/s
   // label is printed on the benchmark report line for the currently
   // executing benchmark. It is typically called at the end of a processing
@@ -668,16 +999,45 @@ class State {
     return range_[pos];
   }
 
+  // The value that range(pos) stands for, if the benchmark gave the values of
+  // the arg with ArgStrings() or ArgDoubles(). CHECKs if it did not, or, for
+  // double_arg(), if they are not numbers.
+  const std::string& string_arg(std::size_t pos = 0) const;
+  double double_arg(std::size_t pos = 0) const;
+
   BENCHMARK_DEPRECATED_MSG("use 'range(0)' instead")
   int64_t range_x() const { return range(0); }
 
   BENCHMARK_DEPRECATED_MSG("use 'range(1)' instead")
   int64_t range_y() const { return range(1); }
 
+  // The variant of a benchmark registered with Benchmark::Multiversion() that
+  // is run, or empty.
+  const std::string& variant() const { return variant_; }
+
+  // A seed for the inputs of the benchmark, derived from its name and its
+  // arguments: the same in all the runs of the benchmark, whatever its
+  // threads, variants or contender, and different for other arguments. See
+  // benchmark::datagen.
+  uint64_t seed() const { return seed_; }
+
+  // The repetition of the benchmark being run, from 0.
+  int64_t repetition_index() const { return repetition_index_; }
+
   // Number of threads concurrently executing the benchmark.
   BENCHMARK_ALWAYS_INLINE
   int threads() const { return threads_; }
 
+  // The operations each thread keeps in flight at once, see
+  // Benchmark::InFlightRange(), or 1.
+  int in_flight() const { return in_flight_; }
+
+  // The role of the executing thread, see Benchmark::ThreadGroups(), or
+  // empty, and its index among the threads of that role, from
+  // [0, the threads of the role).
+  const std::string& thread_role() const { return thread_role_; }
+  int role_thread_index() const { return role_thread_index_; }
+
   // Index of the executing thread. Values from [0, threads).
   BENCHMARK_ALWAYS_INLINE
   int thread_index() const { return thread_index_; }
@@ -711,18 +1071,88 @@ class State {
 
  private:  // items we don't need on the first cache line
   std::vector<int64_t> range_;
+  // The benchmark that the args are of, for the values of string_arg().
+  const internal::Benchmark* arg_values_;
+  std::string variant_;
+  uint64_t seed_;
+  int64_t repetition_index_;
+  int in_flight_;
+  std::string thread_role_;
+  int role_thread_index_;
+  // Samples the timed regions, with --benchmark_profile.
+  internal::Profiler* profiler_;
 
   int64_t complexity_n_;
+  std::vector<int64_t> complexity_ns_;
+
+  // Iteration sampling for RecordLatencyHistogram(): the range-based for loop
+  // hands out the iterations in chunks, alternating between sample_period - 1
+  // iterations that are not sampled and a single one that is timed.
+  internal::LatencyHistogram* const latency_histogram_;
+  IterationCount sample_iterations_left_;
+  bool next_chunk_sampled_;
+  double sample_start_;
+
+  // Progress tracking for RecordTimeSeries(): the range-based for loop hands
+  // out the iterations in chunks of this many, and publishes how many are
+  // done at the end of each. 0 if not tracked.
+  const IterationCount progress_chunk_;
+
+  // For Samples(): each chunk is a sample, timed from the real time the timer
+  // measured and the iterations done by the time it was handed out.
+  const bool record_samples_;
+  double sample_timed_;
+  IterationCount sampled_iterations_;
+
+  // For TargetRate(): when each iteration is due. Every iteration is timed
+  // into latency_histogram_, from when it was due rather than when it began.
+  internal::ArrivalSchedule* const arrivals_;
+
+  // For FixedWork(): the iterations are taken from those shared by all the
+  // threads, this many at a time, or a sample at a time with Samples(), and
+  // the ones this thread took so far. 0 if they are not shared. The chunks
+  // above are then handed out of the iterations taken.
+  IterationCount shared_chunk_;
+  IterationCount shared_taken_;
 
  public:
   // Container for user-defined counters.
   UserCounters counters;
 
+  // Register the user counter 'name', starting from 'counter', and return a
+  // handle to it. Updating the counter through the handle, as in
+  // 'state.counter(bytes) += n', is an add to a slot of an array, where
+  // 'state.counters["bytes"] += n' looks the name up every time. Registering
+  // the same name again returns the same handle.
+  //
+  // The registered counters are moved into 'counters' when the benchmark
+  // function returns, where they replace any counters of the same name.
+  CounterHandle RegisterCounter(const std::string& name,
+                                const Counter& counter = Counter());
+
+  BENCHMARK_ALWAYS_INLINE
+  Counter& counter(CounterHandle handle) {
+    assert(handle.index_ < registered_counters_.size());
+    return registered_counters_[handle.index_];
+  }
+
+#if defined(BENCHMARK_HAS_CXX11)
+  // Register the counter 'name', shared by all the threads of the benchmark,
+  // and return this thread's handle to it. Every thread that adds to the
+  // counter must register it, with the same 'counter' flags. The sum over
+  // the threads is reported as the counter 'name', and so is divided by the
+  // number of threads if 'counter' has kAvgThreads, like any other counter.
+  SharedCounter RegisterSharedCounter(const std::string& name,
+                                      const Counter& counter = Counter());
+#endif
+
  private:
   State(IterationCount max_iters, const std::vector<int64_t>& ranges,
         int thread_i, int n_threads, internal::ThreadTimer* timer,
         internal::ThreadManager* manager,
-        internal::PerfCountersMeasurement* perf_counters_measurement);
+        internal::PerfCountersMeasurement* perf_counters_measurement,
+        internal::LatencyHistogram* latency_histogram,
+        IterationCount progress_chunk, internal::ArrivalSchedule* arrivals);
 
   void StartKeepRunning();
   // Implementation of KeepRunning() and KeepRunningBatch().
@@ -730,6 +1160,42 @@ class State {
   bool KeepRunningInternal(IterationCount n, bool is_batch);
   void FinishKeepRunning();
 
+  // Take shared iterations until at least 'n' are left to this thread.
+  // Returns false if there are not that many left to take.
+  bool TakeSharedIterations(IterationCount n);
+
+  // The first and the following chunks of iterations of the range-based for
+  // loop when sampling latencies. Return 0 once all iterations were handed
+  // out.
+  IterationCount FirstSampleChunk();
+  IterationCount NextSampleChunk();
+
+  // Whether the range-based for loop hands out the iterations in chunks.
+  bool chunked() const {
+    return latency_histogram_ != NULL || progress_chunk_ != 0 ||
+           arrivals_ != NULL || shared_chunk_ != 0;
+  }
+
+  // Move the counters registered with RegisterCounter() into 'counters'.
+  void PublishRegisteredCounters();
+
+  // Add the times of the oldest 'count' iterations in flight with the
+  // AsyncTimer to the manual time, and release their timestamps.
+  void ResolveAsyncIterations(size_t count);
+
+  // The iterations timed with SetAsyncTimer(), as (start, stop) timestamps,
+  // oldest first, and the start of the one running, if any.
+  AsyncTimer* async_timer_;
+  size_t max_in_flight_;
+  std::vector<std::pair<uint64_t, uint64_t> > async_in_flight_;
+  uint64_t async_start_;
+  bool async_started_;
+
+  // The counters registered with RegisterCounter(), and their names, indexed
+  // by their handles.
+  std::vector<Counter> registered_counters_;
+  std::vector<std::string> registered_counter_names_;
+
   const int thread_index_;
   const int threads_;
 
@@ -738,6 +1204,7 @@ class State {
   internal::PerfCountersMeasurement* const perf_counters_measurement_;
 
   friend class internal::BenchmarkInstance;
+  friend class Region;
 };
 
 inline BENCHMARK_ALWAYS_INLINE bool State::KeepRunning() {
@@ -766,6 +1233,11 @@ inline BENCHMARK_ALWAYS_INLINE bool State::KeepRunningInternal(IterationCount n,
       return true;
     }
   }
+  if (BENCHMARK_BUILTIN_EXPECT(shared_chunk_ != 0, false) &&
+      TakeSharedIterations(n)) {
+    total_iterations_ -= n;
+    return true;
+  }
   // For non-batch runs, total_iterations_ must be 0 by now.
   if (is_batch && total_iterations_ != 0) {
     batch_leftover_ = n - total_iterations_;
@@ -776,6 +1248,18 @@ inline BENCHMARK_ALWAYS_INLINE bool State::KeepRunningInternal(IterationCount n,
   return false;
 }
 
+template <class Setup, class Body>
+void State::RunBatched(IterationCount batch_size, Setup setup, Body body) {
+  while (KeepRunningBatch(batch_size)) {
+    PauseTiming();
+    for (IterationCount i = 0; i < batch_size; ++i) setup(i);
+    // The next KeepRunningBatch() stops the run.
+    if (BENCHMARK_BUILTIN_EXPECT(error_occurred_, false)) continue;
+    ResumeTiming();
+    for (IterationCount i = 0; i < batch_size; ++i) body(i);
+  }
+}
+
 struct State::StateIterator {
   struct BENCHMARK_UNUSED Value {};
   typedef std::forward_iterator_tag iterator_category;
@@ -791,7 +1275,11 @@ struct State::StateIterator {
 
   BENCHMARK_ALWAYS_INLINE
   explicit StateIterator(State* st)
-      : cached_(st->error_occurred_ ? 0 : st->max_iterations), parent_(st) {}
+      : cached_(st->error_occurred_ ? 0 : st->max_iterations), parent_(st) {
+    if (BENCHMARK_BUILTIN_EXPECT(st->chunked(), false)) {
+      cached_ = st->FirstSampleChunk();
+    }
+  }
 
  public:
   BENCHMARK_ALWAYS_INLINE
@@ -807,12 +1295,18 @@ struct State::StateIterator {
   BENCHMARK_ALWAYS_INLINE
   bool operator!=(StateIterator const&) const {
     if (BENCHMARK_BUILTIN_EXPECT(cached_ != 0, true)) return true;
+    if (BENCHMARK_BUILTIN_EXPECT(parent_->chunked(), false)) {
+      cached_ = parent_->NextSampleChunk();
+      if (cached_ != 0) return true;
+    }
     parent_->FinishKeepRunning();
     return false;
   }
 
  private:
-  IterationCount cached_;
+  // Mutable, as the comparison with end() refills it when the iterations are
+  // handed out in chunks.
+  mutable IterationCount cached_;
   State* const parent_;
 };
 
@@ -826,6 +1320,71 @@ inline BENCHMARK_ALWAYS_INLINE State::StateIterator State::end() {
 
 namespace internal {
 
+// Calls 'body' kTimes in a row, inlined.
+template <int kTimes>
+struct Unroll {
+  template <class Body>
+  static BENCHMARK_ALWAYS_INLINE void Run(Body& body) {
+    body();
+    Unroll<kTimes - 1>::Run(body);
+  }
+};
+
+template <>
+struct Unroll<0> {
+  template <class Body>
+  static BENCHMARK_ALWAYS_INLINE void Run(Body&) {}
+};
+
+}  // namespace internal
+
+template <int kFactor, class Body>
+void State::RunUnrolled(Body body) {
+#ifdef BENCHMARK_HAS_CXX11
+  static_assert(kFactor > 0, "the unroll factor must be positive");
+#endif
+  // As the ranged-for loop would, but for the iterations of each chunk.
+  StateIterator it = begin();
+  const StateIterator last = end();
+  while (it != last) {
+    IterationCount& left = it.cached_;
+    for (; left >= kFactor; left -= kFactor)
+      internal::Unroll<kFactor>::Run(body);
+    for (; left != 0; --left) body();
+  }
+  counters["unroll_factor"] = Counter(kFactor, Counter::kAvgThreads);
+}
+
+// Times a phase of the iterations of a benchmark, from its construction to
+// its destruction, e.g.
+//
+//   for (auto _ : state) {
+//     { benchmark::Region r(state, "hash"); Hash(keys); }
+//     { benchmark::Region r(state, "probe"); Probe(table, keys); }
+//   }
+//
+// The cycles spent in each region, and the perf counters if there are any,
+// are summed over the iterations and the threads and reported as the counters
+// "region/<name>", in seconds per iteration, and "region/<name>/<counter>".
+// The regions entered while another is open are nested in it, and their
+// names are those of the regions they are nested in and their own, separated
+// by ';', e.g. "region/probe;compare". 'name', which can't contain '/' or
+// ';', must outlive the run. Only the regions left before the iterations are
+// done are reported.
+class Region {
+ public:
+  Region(State& state, const char* name);
+  ~Region();
+
+ private:
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(Region);
+
+  internal::RegionProfile* const profile_;
+  internal::PerfCountersMeasurement* const perf_counters_;
+};
+
+namespace internal {
+
 typedef void(Function)(State&);
 
 // ------------------------------------------------------
@@ -862,6 +1421,19 @@ class Benchmark {
   // REQUIRES: The function passed to the constructor must accept an arg1.
   Benchmark* DenseRange(int64_t start, int64_t limit, int step = 1);
 
+  // Run this benchmark once for each working set size, in bytes, at each of
+  // 'fractions' of the size of each data cache of the CPU, e.g. just below
+  // and above those of its L1, L2 and L3 for {0.9, 1.1}, where the time per
+  // byte changes. The sizes are rounded to whole cache lines, and to whole
+  // pages once they are larger than a page. The label of each run says which
+  // caches its size targets, e.g. "L2x0.9". If the caches aren't known, the
+  // powers of 8 from 1 KiB to 64 MiB are run instead.
+  // REQUIRES: The function passed to the constructor must accept an arg1.
+  Benchmark* CacheBoundaryRange(const std::vector<double>& fractions);
+
+  // Equivalent to CacheBoundaryRange({0.5, 0.9, 1.1, 2}).
+  Benchmark* CacheBoundaryRange();
+
   // Run this benchmark once with "args" as the extra arguments passed
   // to the function.
   // REQUIRES: The function passed to the constructor must accept arg1, arg2 ...
@@ -887,6 +1459,24 @@ class Benchmark {
   // REQUIRES: The function passed to the constructor must accept arg1, arg2 ...
   Benchmark* ArgsProduct(const std::vector<std::vector<int64_t> >& arglists);
 
+  // Rather than run every combination of values in the product of 'space',
+  // as ArgsProduct() would, search it for the args that minimize 'objective',
+  // with short runs of the args proposed by 'strategy', and only report the
+  // runs of the best args found. The objective is the time per iteration if
+  // empty, "cpu_time" for the CPU time, or else the name of a counter. The
+  // benchmark is listed as "<name>/tune".
+  // REQUIRES: No other args are set, and none of the lists is empty.
+  Benchmark* Tune(const std::vector<std::vector<int64_t> >& space,
+                  const std::string& objective = std::string(),
+                  TuneStrategy strategy = kTuneCoordinateDescent);
+
+  // Run the benchmark once for each of 'variants' that the CPU supports, see
+  // CPUInfo::Supports(), as a family of its own named "<name>/<variant>",
+  // where State::variant() is the variant to run, e.g. the kernel compiled
+  // for that instruction set. The other variants are skipped.
+  // REQUIRES: 'variants' is not empty.
+  Benchmark* Multiversion(const std::vector<std::string>& variants);
+
   // Equivalent to ArgNames({name})
   Benchmark* ArgName(const std::string& name);
 
@@ -894,6 +1484,19 @@ class Benchmark {
   // only argument values will be shown.
   Benchmark* ArgNames(const std::vector<std::string>& names);
 
+  // Let the 'arg_index'-th arg stand for one of 'values': the arg is the
+  // position of a value, which names the benchmark instead of the arg, and
+  // which State::string_arg() returns. The positions are passed like any
+  // other arg, e.g.
+  //   ArgStrings(0, {"scalar", "avx2"})->ArgsProduct({{0, 1}, {64, 4096}})
+  // runs "BM_Kernel/scalar/64", "BM_Kernel/avx2/64", ...
+  // REQUIRES: 'values' is not empty.
+  Benchmark* ArgStrings(size_t arg_index,
+                        const std::vector<std::string>& values);
+
+  // Like ArgStrings(), for numbers, which State::double_arg() returns.
+  Benchmark* ArgDoubles(size_t arg_index, const std::vector<double>& values);
+
   // Equivalent to Ranges({{lo1, hi1}, {lo2, hi2}}).
   // NOTE: This is a legacy C++03 interface provided for compatibility only.
   //   New code should use 'Ranges'.
@@ -918,6 +1521,23 @@ class Benchmark {
   // REQUIRES: `t > 0` and `Iterations` has not been called on this benchmark.
   Benchmark* MinTime(double t);
 
+  // Before the iteration count is estimated, run the benchmark for at least
+  // this amount of time and throw the results away, e.g. to warm up the
+  // caches and let the CPU frequency ramp up. This option overrides the
+  // `benchmark_min_warmup_time` flag.
+  // REQUIRES: `t >= 0`
+  Benchmark* MinWarmUpTime(double t);
+
+  // Run in batches until the 95% confidence interval of the time per
+  // iteration is within 'relative_error' of it (e.g. 0.01 for +/-1%), instead
+  // of for the minimum time only. At least 5 batches of a fifth of the minimum
+  // time each are run, and it gives up once 10 times the minimum time was
+  // spent. The achieved error is reported. This option overrides the
+  // `benchmark_target_cv` flag.
+  // REQUIRES: `relative_error > 0` and `Iterations` has not been called on
+  // this benchmark.
+  Benchmark* TargetRelativeError(double relative_error);
+
   // Specify the amount of iterations that should be run by this benchmark.
   // REQUIRES: 'n > 0' and `MinTime` has not been called on this benchmark.
   //
@@ -926,6 +1546,12 @@ class Benchmark {
   // `--benchmark_min_time=N` or `MinTime(...)` should be used instead.
   Benchmark* Iterations(IterationCount n);
 
+  // Specify the iterations each thread runs while a registered MemoryManager
+  // measures the benchmark, instead of the default of up to 16, or as many
+  // as the benchmark ran if fewer.
+  // REQUIRES: 'n > 0'
+  Benchmark* MemoryIterations(IterationCount n);
+
   // Specify the amount of times to repeat this benchmark. This option overrides
   // the `benchmark_repetitions` flag.
   // REQUIRES: `n > 0`
@@ -963,6 +1589,127 @@ class Benchmark {
   // or MB/second values.
   Benchmark* UseManualTime();
 
+  // If called, the timed slices are measured with serialized reads of the CPU
+  // cycle counter, calibrated against the wall clock, instead of with the
+  // real and CPU clocks. This is much cheaper than reading the clocks, which
+  // matters when the benchmark times a few nanoseconds at a time with
+  // PauseTiming()/ResumeTiming(). The same time is reported as both the real
+  // and the CPU time, along with the 'cycles' per iteration. If
+  // 'subtract_overhead' is true, the cost of reading the counter is
+  // subtracted from every slice.
+  Benchmark* UseCycleClock(bool subtract_overhead = false);
+
+  // By default, the threads of a multithreaded benchmark meet at the start and
+  // at the end of the benchmark loop through a mutex and condition variable,
+  // and are woken up one after the other. If called, the threads spin on the
+  // barrier instead, so that they all start (and stop) timing within a very
+  // short time of each other. The spinning costs cpu time, so this is only
+  // worth it when the threads have a cpu each.
+  Benchmark* UseSpinBarrier();
+
+  // By default, each thread of a multithreaded benchmark runs all the
+  // iterations, so the work grows with the threads (weak scaling). If called,
+  // the iterations are a budget shared by the threads instead: each takes
+  // them in small chunks as it goes, until the budget is spent, so that the
+  // faster ones do more of it (strong scaling). The real time is then that
+  // of the threads doing the job together, and the name gets a '/fixed_work'
+  // suffix.
+  Benchmark* FixedWork();
+
+  // If called, the caches are flushed before every run of the benchmark
+  // function, into each repetition, and the name gets a '/cold_cache' suffix
+  // so that it can be told apart from, and compared with, the hot-cache
+  // variant. For every iteration to start cold, call State::FlushCaches() in
+  // the benchmark loop instead.
+  Benchmark* ColdCache();
+
+  // Time one out of every 'sample_period' iterations individually, and report
+  // the percentiles and the histogram of these latencies along with the mean.
+  // Each sampled iteration also carries the cost of reading the clock twice
+  // (tens of nanoseconds), so this is meant for iterations that take much
+  // longer than that. Only the range-based for loop is sampled.
+  Benchmark* RecordLatencyHistogram(IterationCount sample_period = 64);
+
+  // Every 'interval' seconds of real time, record how many iterations all the
+  // threads have done so far, and the totals of the shared counters (see
+  // State::RegisterSharedCounter()), and report this time series along with
+  // the run, to show warm-up, steady state and any degradation over time.
+  // Only the range-based for loop is tracked.
+  Benchmark* RecordTimeSeries(double interval = 0.01);
+
+  // Every 'interval' seconds of real time, take the rate at which all the
+  // threads did their iterations over the last interval, and report the
+  // lowest, median and highest of these rates along with the run, so that a
+  // throughput that collapsed for part of the run shows next to the average
+  // of items_per_second. Only the range-based for loop is tracked.
+  Benchmark* IntervalThroughput(double interval = 0.01);
+
+  // Split the iterations of each repetition into 'samples' chunks of as many
+  // iterations, and report the real time per iteration of each, so that an
+  // interrupt or a change of frequency shows as a slow sample rather than
+  // being averaged into the whole run. The samples give a distribution to
+  // take robust statistics of without running as many repetitions. With
+  // FixedWork(), the share of a thread is split, and each thread reports the
+  // samples of the iterations it took. Only the range-based for loop is
+  // sampled, and not with RecordLatencyHistogram(), TargetRate() or
+  // UseManualTime().
+  Benchmark* Samples(int samples);
+
+  // Run open-loop: instead of starting each iteration as soon as the previous
+  // one is done, start them at 'ops_per_second' over all the threads, on the
+  // schedule of 'process'. Each iteration's latency is measured from when it
+  // was due, so that the time an iteration spends queued behind a slow one
+  // counts, and reported as with RecordLatencyHistogram(), together with the
+  // 'achieved_rate' counter. Implies UseRealTime(). Only the range-based for
+  // loop runs on the schedule.
+  Benchmark* TargetRate(double ops_per_second,
+                        ArrivalProcess process = kConstantArrivals);
+
+  // Once all the thread counts of each set of arguments are run, report how
+  // the throughput scales with the threads: the speedup and parallel
+  // efficiency of each thread count, and the Universal Scalability Law fitted
+  // to them (serial fraction and coherency cost), as extra aggregates. The
+  // same goes for the depths of InFlightRange(), as the "in_flight_efficiency"
+  // and "in_flight_USL" aggregates.
+  Benchmark* ThreadScaling();
+
+  // Once all the instances are run, report 'counter' of each of them as a
+  // cell of a matrix, with their first argument as its row and their second
+  // as its column, as an extra "matrix" aggregate: e.g. the latency between
+  // each pair of cpus. Repetitions are averaged. The JSON output has the
+  // matrix as a whole, with null for the pairs that didn't run.
+  Benchmark* CounterMatrix(const std::string& counter);
+
+  // With --benchmark_time_budget, how much this benchmark matters: the
+  // instances of a higher priority run first, and get their repetitions
+  // beyond the first before the others do. 0 by default.
+  Benchmark* Priority(int priority);
+
+  // Tag this benchmark, e.g. with Tags({"slow", "numa"}), so that it can be
+  // selected by its tags with --benchmark_tags. A tag may not be empty,
+  // start with '-' or contain ',' or '|'. The tags are also reported with
+  // each run.
+  Benchmark* Tags(const std::vector<std::string>& tags);
+
+  // With --benchmark_cache_dir, reuse the cached results of this benchmark as
+  // long as 'fingerprint' is the same, rather than the one given by
+  // --benchmark_cache_fingerprint or that of the executable. It should
+  // identify the code the benchmark runs, e.g. a hash of the library it
+  // measures.
+  Benchmark* CacheFingerprint(const std::string& fingerprint);
+
+  // Compare this benchmark, the baseline, with 'contender' in A/B pairs: each
+  // instance is followed by one of 'contender', with the same arguments and
+  // settings but named after it, and the repetitions of the two alternate, in
+  // a random order within each pair of repetitions, so that both see the
+  // same state of the machine. The mean relative difference of the
+  // contender's times to the baseline's, paired by repetition, and its 95%
+  // confidence interval are reported as extra aggregates of the contender,
+  // which need at least two repetitions. A pair is selected by the name of
+  // its baseline. Takes ownership of 'contender', of which nothing but the
+  // name and what it runs is used. See also BENCHMARK_AB().
+  Benchmark* CompareWith(Benchmark* contender);
+
   // Set the asymptotic computational complexity for the benchmark. If called
   // the asymptotic computational complexity will be shown on the output.
   Benchmark* Complexity(BigO complexity = benchmark::oAuto);
@@ -971,10 +1718,25 @@ class Benchmark {
   // the asymptotic computational complexity will be shown on the output.
   Benchmark* Complexity(BigOFunc* complexity);
 
+  // Set the complexity of a benchmark over several inputs, whose lengths it
+  // sets with SetComplexityN({n, m, ...}): 'terms[i]' is the complexity in the
+  // i-th input, and the terms are combined according to 'model'. For example,
+  // Complexity({oN, oLogN}) fits a*N + b*lgM, and reports the coefficient of
+  // each term with the RMS of the fit. None of the terms can be oAuto.
+  Benchmark* Complexity(const std::vector<BigO>& terms,
+                        ComplexityModel model = kAdditiveComplexity);
+
   // Add this statistics to be computed over all the values of benchmark run
   Benchmark* ComputeStatistics(std::string name, StatisticsFunc* statistics,
                                StatisticUnit unit = kTime);
 
+  // Add statistics that are robust to, or show, the noisy repetitions: the
+  // min, max, p5 and p95, the median absolute deviation ("mad"), the mean of
+  // the 80% of repetitions in the middle ("trimmed_mean"), and the bounds of
+  // the bootstrapped 95% confidence interval of the mean ("ci_low" and
+  // "ci_high").
+  Benchmark* RobustStatistics();
+
   // Support for running multiple copies of the same benchmark concurrently
   // in multiple threads.  This may be useful when measuring the scaling
   // of some piece of code.
@@ -1005,35 +1767,125 @@ class Benchmark {
   // Equivalent to ThreadRange(NumCPUs(), NumCPUs())
   Benchmark* ThreadPerCpu();
 
+  // Run this benchmark on a thread per physical core, or on a thread per
+  // core of one package (socket), leaving the other hyperthreads of the cores
+  // idle. Unless PinThreads() picks otherwise, the threads are pinned with
+  // kPinCores.
+  Benchmark* ThreadsPerPhysicalCore();
+  Benchmark* ThreadsPerSocket();
+
+  // Run this benchmark on 1 core, on all the cores of one package, on all
+  // the cores of all the packages, and on all the cpus with their
+  // hyperthreads, pinned with kPinCores unless PinThreads() picks otherwise,
+  // so that where the scaling stops shows which level of the machine limits
+  // it. The counts that coincide, e.g. on a single package, run once.
+  Benchmark* ThreadTopologySweep();
+
+  // Run this benchmark once with each thread keeping 'n' operations in flight
+  // at once, as State::in_flight(), for those that batch or overlap their
+  // operations, like BENCHMARK_ASYNC() ones, and are scaled by the depth of
+  // their queues rather than by threads. The instances are named
+  // "in_flight:<n>". InFlightRange() picks the depths from [min, max] as
+  // ThreadRange() picks the thread counts; the two can be combined.
+  Benchmark* InFlight(int n);
+  Benchmark* InFlightRange(int min_in_flight, int max_in_flight);
+
+  // Pin the threads of the benchmark to cpus according to 'policy'. Overrides
+  // the --benchmark_cpu_affinity flag. The cpu (and NUMA node) each thread
+  // ended up on is included in the JSON output.
+  Benchmark* PinThreads(PinPolicy policy);
+
+  // Pin thread i of the benchmark to cpus[i % cpus.size()].
+  Benchmark* PinThreads(const std::vector<int>& cpus);
+
+  // Run the benchmark on a group of threads per role, e.g. producers and
+  // consumers, instead of on Threads() that all play the same part:
+  //   BENCHMARK(BM_Queue)->ThreadGroups({{"producer", 4}, {"consumer", 4}});
+  // runs it on 8 threads, the first 4 of which have the State::thread_role()
+  // "producer" and the others "consumer". The iterations, times and counters
+  // of each role are reported as well as those of all the threads. Replaces
+  // the thread counts.
+  Benchmark* ThreadGroups(
+      const std::vector<std::pair<std::string, int> >& groups);
+
   virtual void Run(State& state) = 0;
 
+  // Called once all the benchmarks have run, to free what the benchmark kept
+  // between its runs.
+  virtual void Finish() {}
+
  protected:
   explicit Benchmark(const char* name);
   Benchmark(Benchmark const&);
   void SetName(const char* name);
 
+  // Make the variants, see Multiversion(), the instantiations of a template,
+  // named "<name><template_args>", which always run.
+  void SetTemplateVariants(const std::vector<std::string>& template_args);
+
   int ArgsCnt() const;
 
  private:
   friend class BenchmarkFamilies;
   friend class BenchmarkInstance;
+  friend class ::benchmark::State;
 
   std::string name_;
   AggregationReportMode aggregation_report_mode_;
   std::vector<std::string> arg_names_;       // Args for all benchmark runs
-  std::vector<std::vector<int64_t> > args_;  // Args for all benchmark runs
+  // The values that the args set by ArgStrings() or ArgDoubles() stand for,
+  // as named and, for numbers, as numbers. Indexed by arg, then by position.
+  std::vector<std::vector<std::string> > arg_value_names_;
+  std::vector<std::vector<double> > arg_value_numbers_;
+  // The caches that each of the sizes CacheBoundaryRange() set arg 0 to
+  // targets, by size.
+  std::map<int64_t, std::string> cache_targets_;
+  // Args for all benchmark runs, as cartesian products of lists of values for
+  // each arg, which are only expanded once the filter is applied.
+  std::vector<std::vector<std::vector<int64_t> > > args_;
   TimeUnit time_unit_;
   int range_multiplier_;
   double min_time_;
+  double min_warmup_time_;
+  double target_relative_error_;
   IterationCount iterations_;
+  IterationCount memory_iterations_;
   int repetitions_;
   bool measure_process_cpu_time_;
   bool use_real_time_;
   bool use_manual_time_;
+  bool use_cycle_clock_;
+  bool subtract_timer_overhead_;
+  bool use_spin_barrier_;
+  bool fixed_work_;
+  bool cold_cache_;
+  IterationCount latency_sample_period_;
+  double time_series_interval_;
+  double throughput_interval_;
+  int samples_;
+  double target_rate_;
+  ArrivalProcess arrival_process_;
+  bool thread_scaling_;
+  std::string matrix_counter_;
+  int priority_;
+  std::vector<std::string> tags_;
+  std::vector<std::string> variants_;
+  bool template_variants_;
+  std::vector<std::vector<int64_t> > tune_space_;
+  std::string tune_objective_;
+  TuneStrategy tune_strategy_;
+  std::string cache_fingerprint_;
+  Benchmark* contender_;
   BigO complexity_;
   BigOFunc* complexity_lambda_;
+  std::vector<BigO> complexity_terms_;
+  ComplexityModel complexity_model_;
   std::vector<Statistics> statistics_;
   std::vector<int> thread_counts_;
+  std::vector<int> in_flight_counts_;
+  PinPolicy pin_policy_;
+  std::vector<int> pin_cpus_;
+  std::vector<std::pair<std::string, int> > thread_groups_;
 
   Benchmark& operator=(Benchmark const&);
 };
@@ -1121,16 +1973,513 @@ internal::Benchmark* RegisterBenchmark(const char* name, Lambda&& fn,
 #define BENCHMARK_HAS_NO_VARIADIC_REGISTER_BENCHMARK
 #endif
 
+#ifdef BENCHMARK_HAS_COROUTINES
+namespace internal {
+class AsyncBenchmark;
+}  // namespace internal
+
+// The coroutine that a BENCHMARK_ASYNC() function returns, one iteration of
+// the benchmark. It runs from when the runner launches it, or when another
+// task co_awaits it, which resumes once it is done.
+
+class AsyncTask {
+ public:
+  struct promise_type {
+    // The coroutine that co_awaits the task, if any.
+    std::coroutine_handle<> continuation;
+
+    AsyncTask get_return_object() {
+      return AsyncTask(
+          std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+      bool await_ready() noexcept { return false; }
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<promise_type> handle) noexcept {
+        std::coroutine_handle<> next = handle.promise().continuation;
+        return next ? next : std::noop_coroutine();
+      }
+      void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  AsyncTask() : handle_(nullptr) {}
+  AsyncTask(AsyncTask&& other) noexcept : handle_(other.handle_) {
+    other.handle_ = nullptr;
+  }
+  AsyncTask& operator=(AsyncTask&& other) noexcept {
+    std::swap(handle_, other.handle_);
+    return *this;
+  }
+  ~AsyncTask() {
+    if (handle_) handle_.destroy();
+  }
+
+  bool await_ready() const noexcept { return done(); }
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<> awaiting) noexcept {
+    handle_.promise().continuation = awaiting;
+    return handle_;
+  }
+  void await_resume() const noexcept {}
+
+  // Run the task until it first suspends.
+  void Start() { handle_.resume(); }
+
+  // Whether the task ran to its end, or there is none.
+  bool done() const { return !handle_ || handle_.done(); }
+
+ private:
+  explicit AsyncTask(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// What resumes the AsyncTasks of a BENCHMARK_ASYNC() benchmark once the work
+// they wait on is done, e.g. the completion queue of an RPC stack or an I/O
+// event loop, see AsyncBenchmark::Executor().
+class AsyncExecutor {
+ public:
+  virtual ~AsyncExecutor() {}
+
+  // Resume the tasks whose work is done, waiting for some if there are none.
+  // Called whenever all the iterations in flight are suspended, from each of
+  // the threads of the benchmark.
+  virtual void RunOnce() = 0;
+};
+
+// The executor that each thread of a BENCHMARK_ASYNC() benchmark runs: a
+// queue of the coroutines that are ready to resume, which a task can post
+// itself to with
+//   co_await benchmark::AsyncLoop::Current()->Schedule();
+// to let the other iterations in flight run.
+class AsyncLoop : public AsyncExecutor {
+ public:
+  struct ScheduleAwaiter {
+    AsyncLoop* loop;
+    bool await_ready() noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { loop->Post(handle); }
+    void await_resume() noexcept {}
+  };
+
+  // Resume 'handle' in the next RunOnce().
+  void Post(std::coroutine_handle<> handle) { ready_.push_back(handle); }
+  ScheduleAwaiter Schedule() { return ScheduleAwaiter{this}; }
+
+  bool empty() const { return ready_.empty(); }
+
+  // Resume the coroutines that were posted, but not those that they post.
+  virtual void RunOnce() BENCHMARK_OVERRIDE {
+    std::vector<std::coroutine_handle<> > ready;
+    ready.swap(ready_);
+    for (std::coroutine_handle<> handle : ready) handle.resume();
+  }
+
+  // The loop of the BENCHMARK_ASYNC() benchmark running on this thread, or
+  // nullptr.
+  static AsyncLoop* Current() { return CurrentSlot(); }
+
+ private:
+  friend class internal::AsyncBenchmark;
+
+  static AsyncLoop*& CurrentSlot() {
+    static thread_local AsyncLoop* current = nullptr;
+    return current;
+  }
+
+  std::vector<std::coroutine_handle<> > ready_;
+};
+
+namespace internal {
+
+// The benchmark of a BENCHMARK_ASYNC() coroutine, which keeps
+// State::in_flight() calls of it running at once without blocking on any of
+// them. Whenever they are all
+// suspended, the runner resumes those posted to the AsyncLoop of the thread,
+// or else waits on the Executor(). The time of the run is from the launch of
+// the first iteration to the end of the last, and it reports the items, the
+// iterations, per second, and the mean "latency" of an iteration, in seconds,
+// which RecordLatencyHistogram() breaks down. Chain InFlight(),
+// InFlightRange() and Executor() first, as the other setters return a plain
+// Benchmark*.
+class AsyncBenchmark : public Benchmark {
+ public:
+  typedef AsyncTask(Function)(State&);
+
+  AsyncBenchmark(const char* name, Function* func)
+      : Benchmark(name), func_(func), executor_(nullptr) {}
+
+  AsyncBenchmark* InFlight(int n) {
+    Benchmark::InFlight(n);
+    return this;
+  }
+  AsyncBenchmark* InFlightRange(int min_in_flight, int max_in_flight) {
+    Benchmark::InFlightRange(min_in_flight, max_in_flight);
+    return this;
+  }
+
+  // 'executor' must outlive the benchmark.
+  AsyncBenchmark* Executor(AsyncExecutor* executor) {
+    executor_ = executor;
+    return this;
+  }
+
+  virtual void Run(State& st) BENCHMARK_OVERRIDE;
+
+ private:
+  Function* func_;
+  AsyncExecutor* executor_;
+};
+
+inline void AsyncBenchmark::Run(State& st) {
+  typedef std::chrono::steady_clock Clock;
+  AsyncLoop loop;
+  AsyncLoop*& current = AsyncLoop::CurrentSlot();
+  AsyncLoop* const previous = current;
+  current = &loop;
+
+  std::vector<AsyncTask> tasks(static_cast<size_t>(st.in_flight()));
+  std::vector<Clock::time_point> starts(tasks.size());
+  std::vector<bool> busy(tasks.size(), false);
+  double total_latency = 0;
+  while (st.KeepRunningBatch(st.max_iterations)) {
+    IterationCount launched = 0, completed = 0;
+    while (completed < st.max_iterations && !st.error_occurred()) {
+      bool progressed = false;
+      for (size_t i = 0; i < tasks.size(); ++i) {
+        if (busy[i] && tasks[i].done()) {
+          const double latency =
+              std::chrono::duration<double>(Clock::now() - starts[i]).count();
+          total_latency += latency;
+          st.RecordLatency(latency);
+          tasks[i] = AsyncTask();
+          busy[i] = false;
+          ++completed;
+          progressed = true;
+        }
+        if (!busy[i] && launched < st.max_iterations) {
+          starts[i] = Clock::now();
+          tasks[i] = func_(st);
+          busy[i] = true;
+          ++launched;
+          tasks[i].Start();
+          progressed = true;
+        }
+      }
+      if (progressed) continue;
+      if (!loop.empty()) {
+        loop.RunOnce();
+      } else if (executor_ != nullptr) {
+        executor_->RunOnce();
+      } else {
+        st.SkipWithError(
+            "all the iterations in flight are suspended, with no executor to "
+            "resume them");
+      }
+    }
+  }
+  // The tasks left in flight after an error are destroyed where they are
+  // suspended.
+  tasks.clear();
+  current = previous;
+
+  st.SetItemsProcessed(st.iterations());
+  st.counters["latency"] = Counter(total_latency, Counter::kAvgIterations);
+}
+
+inline AsyncBenchmark* RegisterAsyncBenchmark(const char* name,
+                                              AsyncBenchmark::Function* func) {
+  return static_cast<AsyncBenchmark*>(
+      RegisterBenchmarkInternal(new AsyncBenchmark(name, func)));
+}
+
+}  // namespace internal
+#endif  // BENCHMARK_HAS_COROUTINES
+
+#ifdef BENCHMARK_HAS_CXX11
+// Lists of template args for BENCHMARK_TEMPLATE_PRODUCT(): of types, or of
+// values of type T, as std::integer_sequence, which are passed as the
+// std::integral_constant types of the values.
+template <typename... Ts>
+struct TypeList {};
+
+template <typename T, T... Vs>
+struct ValueList {};
+
+namespace internal {
+
+// The name of the type in the signature of TemplateArgName<T>::Get(), as
+// __PRETTY_FUNCTION__ or __FUNCSIG__ show it.
+std::string TypeNameFromSignature(const char* signature);
+
+// The name of T, or of the value of an integral_constant T, as a template
+// arg in the name of a benchmark.
+template <typename T>
+struct TemplateArgName {
+  static std::string Get() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return TypeNameFromSignature(__FUNCSIG__);
+#else
+    return TypeNameFromSignature(__PRETTY_FUNCTION__);
+#endif
+  }
+};
+
+template <typename T, T V>
+struct TemplateArgName<std::integral_constant<T, V> > {
+  static std::string Get() {
+    if (std::is_same<T, bool>::value) return V ? "true" : "false";
+    if (std::is_unsigned<T>::value) {
+      return std::to_string(static_cast<unsigned long long>(V));
+    }
+    return std::to_string(static_cast<long long>(V));
+  }
+};
+
+// The benchmark of the instantiations of a function template, which runs the
+// one of State::variant().
+class TemplateProductBenchmark : public Benchmark {
+ public:
+  TemplateProductBenchmark(const char* name,
+                           const std::vector<std::string>& template_args,
+                           const std::vector<Function*>& funcs)
+      : Benchmark(name), template_args_(template_args), funcs_(funcs) {
+    SetTemplateVariants(template_args);
+  }
+
+  virtual void Run(State& st) BENCHMARK_OVERRIDE;
+
+ private:
+  std::vector<std::string> template_args_;
+  std::vector<Function*> funcs_;
+};
+
+// Adds F::Run<Done..., ...> for each combination of the args in Lists, the
+// first list varying the slowest, to 'funcs', and their template args to
+// 'template_args'.
+template <typename F, typename Done, typename... Lists>
+struct TemplateProduct;
+
+template <typename F, typename... Done>
+struct TemplateProduct<F, TypeList<Done...> > {
+  static void Add(std::vector<std::string>* template_args,
+                  std::vector<Function*>* funcs) {
+    const std::vector<std::string> names = {TemplateArgName<Done>::Get()...};
+    std::string args = "<";
+    for (size_t i = 0; i < names.size(); ++i) {
+      if (i != 0) args += ',';
+      args += names[i];
+    }
+    template_args->push_back(args + '>');
+    funcs->push_back(&F::template Run<Done...>);
+  }
+};
+
+template <typename F, typename... Done, typename... Ts, typename... Lists>
+struct TemplateProduct<F, TypeList<Done...>, TypeList<Ts...>, Lists...> {
+  static void Add(std::vector<std::string>* template_args,
+                  std::vector<Function*>* funcs) {
+    const int expand[] = {
+        0, (TemplateProduct<F, TypeList<Done..., Ts>, Lists...>::Add(
+                template_args, funcs),
+            0)...};
+    (void)expand;
+  }
+};
+
+template <typename F, typename... Done, typename T, T... Vs,
+          typename... Lists>
+struct TemplateProduct<F, TypeList<Done...>, ValueList<T, Vs...>, Lists...>
+    : TemplateProduct<F, TypeList<Done...>,
+                      TypeList<std::integral_constant<T, Vs>...>, Lists...> {
+};
+
+#if defined(__cpp_lib_integer_sequence)
+template <typename F, typename... Done, typename T, T... Vs,
+          typename... Lists>
+struct TemplateProduct<F, TypeList<Done...>, std::integer_sequence<T, Vs...>,
+                       Lists...>
+    : TemplateProduct<F, TypeList<Done...>, ValueList<T, Vs...>, Lists...> {};
+#endif
+
+template <typename F, typename... Lists>
+Benchmark* RegisterTemplateProduct(const char* name) {
+  std::vector<std::string> template_args;
+  std::vector<Function*> funcs;
+  TemplateProduct<F, TypeList<>, Lists...>::Add(&template_args, &funcs);
+  return RegisterBenchmarkInternal(
+      new TemplateProductBenchmark(name, template_args, funcs));
+}
+
+}  // namespace internal
+#endif
+
+// Register the memory bandwidth suite: sequential and random reads, writes and
+// copies, over working sets that fit in each level of the cache hierarchy of
+// this machine and one that doesn't, split between 1 up to as many threads
+// as there are cpus. The benchmarks are named "MemoryBandwidth/<kernel>" and
+// report bytes_per_second. Call before RunSpecifiedBenchmarks().
+void RegisterMemoryBandwidthBenchmarks();
+
+// Register the memory latency suite: chases of a random cyclic chain of
+// pointers, one dependent load per cache line, over the same working sets as
+// the bandwidth suite, across pages, within each page before the next, and on
+// huge pages, and, on hosts with several NUMA nodes, from the cpus of each
+// node to the memory of each. The benchmarks are named
+// "MemoryLatency/<variant>" and report ns_per_load. Call before
+// RunSpecifiedBenchmarks().
+void RegisterMemoryLatencyBenchmarks();
+
+// Register the contention suite, of what moving cache lines between cores
+// costs: "Contention/AtomicIncrement" and "Contention/CompareExchange" update
+// one atomic counter from 1 up to as many threads as there are cpus, one per
+// core, and report items_per_second; "Contention/FalseSharing" has each
+// thread update a counter of its own, 8 to 128 bytes from the next one; and
+// "Contention/PingPong" hands a value back and forth between each pair of
+// cores, reporting ns_per_transfer, and the core-to-core latency matrix as a
+// "matrix" aggregate. Call before RunSpecifiedBenchmarks().
+void RegisterContentionBenchmarks();
+
+// How Buffer maps its memory.
+struct BufferOptions {
+  BufferOptions() : huge_pages(false), numa_node(kAnyNode), prefault(true) {}
+
+  // numa_node values that are not a node: wherever the kernel puts the pages
+  // (the node of the thread that first touches them, by default), and the
+  // node of the cpu the allocating thread runs on.
+  enum { kAnyNode = -1, kLocalNode = -2 };
+
+  // Back the buffer with huge pages: from the reserved pool of the default
+  // huge page size if there are enough, and transparent huge pages otherwise,
+  // which the kernel may or may not find.
+  bool huge_pages;
+  // Bind the pages to this NUMA node, or one of the values above.
+  int numa_node;
+  // Touch every page when allocating, so that the timed region doesn't
+  // fault them in.
+  bool prefault;
+};
+
+// A page-aligned buffer mapped with the given options, freed when destroyed.
+// Where the options can't be applied, e.g. without huge pages or NUMA outside
+// of Linux, the buffer is still allocated with the ones that can; page_size()
+// and numa_node() say what it got.
+class Buffer {
+ public:
+  explicit Buffer(size_t bytes, const BufferOptions& options = BufferOptions());
+  ~Buffer();
+
+  void* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // The size of the pages backing most of the buffer, and the NUMA node its
+  // first page is on, or -1 if unknown or not faulted in yet.
+  size_t page_size() const { return page_size_; }
+  int numa_node() const { return numa_node_; }
+
+ private:
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(Buffer);
+
+  void* data_;
+  size_t size_;
+  // What was mapped, to unmap it: larger than the buffer when it was aligned
+  // to huge pages.
+  void* mapping_;
+  size_t mapping_size_;
+  size_t page_size_;
+  int numa_node_;
+};
+
+namespace internal {
+class BufferSet;
+class SharedFixtureState;
+}  // namespace internal
+
+// Generators of the inputs of benchmarks, so that they don't each have their
+// own. The inputs are a function of their parameters and of the seed, which is
+// usually State::seed(), and are generated once per process: the benchmarks,
+// threads and repetitions that ask for the same ones share them. With
+// --benchmark_datagen_dir, the numbers are also written to files there, which
+// later runs map instead of generating them again, and the strings are read
+// back from there.
+namespace datagen {
+
+// Values generated by one of the functions below. They are owned by the
+// generator, and stay valid until ClearCache().
+template <typename T>
+class Values {
+ public:
+  Values() : data_(NULL), size_(0) {}
+  Values(const T* data, size_t size) : data_(data), size_(size) {}
+
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+  const T& operator[](size_t i) const { return data_[i]; }
+
+ private:
+  const T* data_;
+  size_t size_;
+};
+
+// 'n' values drawn uniformly from [min, max].
+Values<int64_t> Uniform(size_t n, int64_t min, int64_t max, uint64_t seed);
+
+// 'n' values from [0, num_values), drawn with a probability proportional to
+// 1 / (value + 1)^exponent: 0 is the most frequent, and with an exponent
+// around 1, a few values make up most of them, as words in a text or keys in
+// a cache do. Takes memory for the num_values probabilities while generating.
+Values<int64_t> Zipf(size_t n, int64_t num_values, double exponent,
+                     uint64_t seed);
+
+// The values 0 to n - 1 in ascending order, after swapping a random pair of
+// them n * unsorted / 2 times: sorted for 0, and as good as shuffled for 1 and
+// above.
+Values<int64_t> NearlySorted(size_t n, double unsorted, uint64_t seed);
+
+// Strings of random lower-case letters, one of each of the 'lengths', which
+// can themselves be generated by the functions above for lengths of that
+// distribution.
+const std::vector<std::string>& Strings(const Values<int64_t>& lengths,
+                                        uint64_t seed);
+
+// Free the inputs generated so far, unmapping those read from files.
+void ClearCache();
+
+}  // namespace datagen
+
 // The base class for all fixture tests.
 class Fixture : public internal::Benchmark {
  public:
-  Fixture() : internal::Benchmark("") {}
+  // Which runs share the state that SetUpShared() builds, for state that is
+  // too expensive to build for every run, and that the threads only read.
+  enum SharedScope {
+    // None: there is no such state. SetUp() and TearDown() still run on every
+    // thread of every run, including those that find the iteration count.
+    kPerRun,
+    // The runs of a repetition.
+    kPerRepetition,
+    // The runs of all the instances with the same args, whatever their
+    // threads, and of all their repetitions.
+    kPerArgs,
+    // All the runs of the fixture.
+    kPerFamily
+  };
 
-  virtual void Run(State& st) BENCHMARK_OVERRIDE {
-    this->SetUp(st);
-    this->BenchmarkCase(st);
-    this->TearDown(st);
-  }
+  explicit Fixture(SharedScope scope = kPerRun);
+  virtual ~Fixture();
+
+  virtual void Run(State& st) BENCHMARK_OVERRIDE;
+  virtual void Finish() BENCHMARK_OVERRIDE;
 
   // These will be deprecated ...
   virtual void SetUp(const State&) {}
@@ -1141,6 +2490,47 @@ class Fixture : public internal::Benchmark {
 
  protected:
   virtual void BenchmarkCase(State&) = 0;
+
+  // With a SharedScope other than kPerRun, SetUpShared() runs on the first
+  // thread of the first run of each scope, before SetUp() on any thread, and
+  // TearDownShared() once the next scope starts, or all the benchmarks have
+  // run.
+  virtual void SetUpShared(const State&) {}
+  virtual void TearDownShared() {}
+
+ private:
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(Fixture);
+
+  const SharedScope shared_scope_;
+  internal::SharedFixtureState* const shared_;
+};
+
+// A fixture that gives each thread a Buffer of its own, allocated with
+// 'options' in SetUp(), before the timing starts, and freed in TearDown(). The
+// buffers are 'bytes' long, or state.range(0) bytes if that is 0. Each run
+// reports the mean 'buffer_page_size' of the threads, and 'buffer_numa_local',
+// the fraction of them whose buffer is on the NUMA node they ran on. A
+// subclass that overrides SetUp() or TearDown() calls these too.
+class BufferFixture : public Fixture {
+ public:
+  explicit BufferFixture(size_t bytes = 0,
+                         const BufferOptions& options = BufferOptions());
+  virtual ~BufferFixture();
+
+  using Fixture::SetUp;
+  using Fixture::TearDown;
+  virtual void SetUp(State& st) BENCHMARK_OVERRIDE;
+  virtual void TearDown(State& st) BENCHMARK_OVERRIDE;
+
+  // The buffer of the thread of 'st', once SetUp() for it is done.
+  Buffer& buffer(const State& st);
+
+ private:
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(BufferFixture);
+
+  const size_t bytes_;
+  const BufferOptions options_;
+  internal::BufferSet* const buffers_;
 };
 
 }  // namespace benchmark
@@ -1175,7 +2565,32 @@ class Fixture : public internal::Benchmark {
       (::benchmark::internal::RegisterBenchmarkInternal( \
           new ::benchmark::internal::FunctionBenchmark(#n, n)))
 
+// Register 'baseline' and 'contender' as an A/B pair, see
+// Benchmark::CompareWith():
+//   BENCHMARK_AB(BM_Old, BM_New)->Range(8, 8 << 10)->Repetitions(10);
+#define BENCHMARK_AB(baseline, contender) \
+  BENCHMARK(baseline)->CompareWith(       \
+      new ::benchmark::internal::FunctionBenchmark(#contender, contender))
+
+#if defined(BENCHMARK_HAS_CXX11)
+// Register 'func' for each of the variants, the instruction sets that the
+// CPU supports among those given, see Benchmark::Multiversion():
+//   BENCHMARK_MULTIVERSION(BM_Kernel, "scalar", "sse4.2", "avx2")->Arg(64);
+#define BENCHMARK_MULTIVERSION(func, ...) \
+  BENCHMARK(func)->Multiversion({__VA_ARGS__})
+#endif
+
 // Old-style macros
+#ifdef BENCHMARK_HAS_COROUTINES
+// Register a coroutine 'func' returning a benchmark::AsyncTask, each call of
+// which is one iteration, with up to InFlight() of them running at once, see
+// internal::AsyncBenchmark:
+//   BENCHMARK_ASYNC(BM_Rpc)->InFlightRange(1, 256)->Arg(64);
+#define BENCHMARK_ASYNC(func)      \
+  BENCHMARK_PRIVATE_DECLARE(func) = \
+      ::benchmark::internal::RegisterAsyncBenchmark(#func, func)
+#endif
+
 #define BENCHMARK_WITH_ARG(n, a) BENCHMARK(n)->Arg((a))
 #define BENCHMARK_WITH_ARG2(n, a1, a2) BENCHMARK(n)->Args({(a1), (a2)})
 #define BENCHMARK_WITH_UNIT(n, t) BENCHMARK(n)->Unit((t))
@@ -1234,6 +2649,27 @@ class Fixture : public internal::Benchmark {
 #define BENCHMARK_TEMPLATE(n, a) BENCHMARK_TEMPLATE1(n, a)
 #endif
 
+#ifdef BENCHMARK_HAS_CXX11
+// Register n<Args...> for every combination of the template args in the
+// lists, see TypeList and ValueList, as the families "n<float,4>", ...:
+//   template <typename T, typename N> void BM_Unrolled(benchmark::State&);
+//   BENCHMARK_TEMPLATE_PRODUCT(BM_Unrolled, benchmark::TypeList<float, double>,
+//                              benchmark::ValueList<int, 1, 2, 4, 8>)
+//       ->Arg(1024);
+// where N::value is the value of an arg from a ValueList.
+#define BENCHMARK_TEMPLATE_PRODUCT(n, ...)                                \
+  struct BENCHMARK_PRIVATE_CONCAT(n, _TemplateProduct_, __LINE__) {       \
+    template <typename... Args>                                           \
+    static void Run(::benchmark::State& st) {                             \
+      n<Args...>(st);                                                     \
+    }                                                                     \
+  };                                                                      \
+  BENCHMARK_PRIVATE_DECLARE(n) =                                          \
+      ::benchmark::internal::RegisterTemplateProduct<                     \
+          BENCHMARK_PRIVATE_CONCAT(n, _TemplateProduct_, __LINE__),       \
+          __VA_ARGS__>(#n)
+#endif
+
 #define BENCHMARK_PRIVATE_DECLARE_F(BaseClass, Method)                  \
   class BaseClass##_##Method##_Benchmark : public BaseClass {           \
    public:                                                              \
@@ -1366,14 +2802,42 @@ struct CPUInfo {
     DISABLED
   };
 
+  // Where a logical cpu sits in the machine. The fields that are not known
+  // on this platform are -1.
+  struct LogicalCpu {
+    int cpu;
+    // Its package (socket), and its core, numbered within the package.
+    int package;
+    int core;
+    // Its rank among the SMT siblings of its core, 0 for the first.
+    int smt_index;
+    int numa_node;
+    // The lowest numbered of the cpus that share its last-level cache.
+    int llc;
+  };
+
   int num_cpus;
   Scaling scaling;
   double cycles_per_second;
   std::vector<CacheInfo> caches;
+  // The online cpus, ordered by number. Empty where the platform doesn't
+  // tell.
+  std::vector<LogicalCpu> topology;
+  // The distinct packages, cores and NUMA nodes of 'topology', 0 if unknown.
+  int num_packages;
+  int num_cores;
+  int num_numa_nodes;
   std::vector<double> load_avg;
+  // The instruction set extensions that the CPU, and the OS, support, named
+  // as by the "target" attribute of GCC and Clang, e.g. "avx2" or "sve".
+  std::vector<std::string> features;
 
   static const CPUInfo& Get();
 
+  // Whether the CPU supports all the features of 'variant', which are
+  // separated by '+', as in "avx512f+avx512vl". "scalar" is always supported.
+  bool Supports(const std::string& variant) const;
+
  private:
   CPUInfo();
   BENCHMARK_DISALLOW_COPY_AND_ASSIGN(CPUInfo);
@@ -1396,9 +2860,12 @@ struct BenchmarkName {
   std::string function_name;
   std::string args;
   std::string min_time;
+  std::string min_warmup_time;
   std::string iterations;
   std::string repetitions;
   std::string time_type;
+  std::string cache;
+  std::string in_flight;
   std::string threads;
 
   // Return the full name of the benchmark with each non-empty
@@ -1406,6 +2873,94 @@ struct BenchmarkName {
   std::string str() const;
 };
 
+// If a MemoryManager is registered, it can be used to collect and report
+// allocation metrics for a run of the benchmark.
+class MemoryManager {
+ public:
+  struct Result {
+    Result()
+        : num_allocs(0),
+          max_bytes_used(0),
+          total_allocated_bytes(TombstoneValue),
+          num_frees(TombstoneValue),
+          net_heap_growth(TombstoneValue),
+          peak_rss_bytes(TombstoneValue),
+          minor_page_faults(TombstoneValue),
+          major_page_faults(TombstoneValue) {}
+
+    // The value of the members a MemoryManager doesn't measure, which are
+    // then not reported. All but num_allocs and max_bytes_used have it by
+    // default.
+    static const int64_t TombstoneValue;
+
+    // The number of allocations made in total between Start and Stop.
+    int64_t num_allocs;
+
+    // The peak memory use between Start and Stop.
+    int64_t max_bytes_used;
+
+    // The number of bytes allocated in total between Start and Stop.
+    int64_t total_allocated_bytes;
+
+    // The number of frees made in total between Start and Stop.
+    int64_t num_frees;
+
+    // The bytes allocated minus the bytes freed between Start and Stop, e.g.
+    // what leaked.
+    int64_t net_heap_growth;
+
+    // The number of allocations made between Start and Stop, by size: entry
+    // i counts those of more than 2^(i-1) and at most 2^i bytes. Empty if
+    // not measured.
+    std::vector<int64_t> alloc_size_histogram;
+
+    // The peak resident set size of the process between Start and Stop.
+    int64_t peak_rss_bytes;
+
+    // The page faults of the process between Start and Stop, without and
+    // with I/O.
+    int64_t minor_page_faults;
+    int64_t major_page_faults;
+
+    // The number of allocations and of bytes allocated by each thread of the
+    // benchmark, by thread index, between its StartThread and StopThread.
+    // Empty if not measured.
+    std::vector<int64_t> thread_allocs;
+    std::vector<int64_t> thread_allocated_bytes;
+  };
+
+  virtual ~MemoryManager() {}
+
+  // Implement this to start recording allocation information.
+  virtual void Start() = 0;
+
+  // Implement this to stop recording and fill out the given Result structure.
+  virtual void Stop(Result* result) = 0;
+
+  // Called by each thread of the benchmark, with its index, before and after
+  // it runs its iterations between Start and Stop, for managers that count
+  // per thread.
+  virtual void StartThread(int /* thread_index */) {}
+  virtual void StopThread(int /* thread_index */) {}
+};
+
+// A MemoryManager of what the operating system sees of the memory of the
+// process: its peak resident set size and page faults. It doesn't count
+// allocations. The peak resident set size is that of the run on Linux, and
+// that of the whole process so far elsewhere.
+class ProcessMemoryManager : public MemoryManager {
+ public:
+  ProcessMemoryManager();
+
+  virtual void Start() BENCHMARK_OVERRIDE;
+  virtual void Stop(Result* result) BENCHMARK_OVERRIDE;
+
+ private:
+  bool peak_rss_reset_;
+  int64_t start_minor_page_faults_;
+  int64_t start_major_page_faults_;
+};
+
 // Interface for custom benchmark result printers.
 // By default, benchmark reports are printed to stdout. However an application
 // can control the destination of the reports by calling
@@ -1418,10 +2973,48 @@ class BenchmarkReporter {
     SystemInfo const& sys_info;
     // The number of chars in the longest benchmark name.
     size_t name_field_width;
+    // The repetitions of all the benchmarks that are about to be run, or 0
+    // if not known.
+    int64_t num_repetitions;
     static const char* executable_name;
     Context();
   };
 
+  // A point of the time series recorded with RecordTimeSeries().
+  struct TimeSeriesSample {
+    TimeSeriesSample() : time(0), iterations(0) {}
+
+    // Seconds of real time since the run started.
+    double time;
+    // The iterations done by all the threads so far.
+    IterationCount iterations;
+    // The totals of the shared counters so far, without their flags applied.
+    std::map<std::string, double> counters;
+  };
+
+  // What the threads of a role of Benchmark::ThreadGroups() did in a run, as
+  // the Run has it for all the threads.
+  struct RoleRun {
+    RoleRun()
+        : threads(0),
+          iterations(0),
+          real_accumulated_time(0),
+          cpu_accumulated_time(0) {}
+
+    std::string name;
+    int64_t threads;
+    // Over all the threads of the role.
+    IterationCount iterations;
+    // The times of a thread of the role, in seconds.
+    double real_accumulated_time;
+    double cpu_accumulated_time;
+    UserCounters counters;
+
+    // Per iteration, in 'unit'.
+    double GetAdjustedRealTime(TimeUnit unit) const;
+    double GetAdjustedCPUTime(TimeUnit unit) const;
+  };
+
   struct Run {
     static const int64_t no_repetition_index = -1;
     enum RunType { RT_Iteration, RT_Aggregate };
@@ -1432,9 +3025,13 @@ class BenchmarkReporter {
           error_occurred(false),
           iterations(1),
           threads(1),
+          in_flight(0),
+          processes(1),
           time_unit(kNanosecond),
           real_accumulated_time(0),
           cpu_accumulated_time(0),
+          real_time_overhead(0),
+          cpu_time_overhead(0),
           max_heapbytes_used(0),
           complexity(oNone),
           complexity_lambda(),
@@ -1444,7 +3041,14 @@ class BenchmarkReporter {
           counters(),
           has_memory_result(false),
           allocs_per_iter(0.0),
-          max_bytes_used(0) {}
+          max_bytes_used(0),
+          memory_iterations(0),
+          latency_samples(0),
+          relative_error(0),
+          outliers_dropped(0),
+          cached(false),
+          cold_cache(false),
+          cpu_frequency(0) {}
 
     std::string benchmark_name() const;
     BenchmarkName run_name;
@@ -1459,12 +3063,24 @@ class BenchmarkReporter {
 
     IterationCount iterations;
     int64_t threads;
+    // The operations in flight per thread, see Benchmark::InFlight(), or 0.
+    int64_t in_flight;
+    // The processes whose threads ran it together, one but for the leader of
+    // --benchmark_coordinator_workers.
+    int64_t processes;
     int64_t repetition_index;
     int64_t repetitions;
     TimeUnit time_unit;
     double real_accumulated_time;
     double cpu_accumulated_time;
 
+    // The cost of pausing and resuming the timer, as measured once for each
+    // kind of timer, times the number of pauses. It was already subtracted
+    // from the accumulated times above, which it can be added back to for the
+    // raw times.
+    double real_time_overhead;
+    double cpu_time_overhead;
+
     // Return a value representing the real time per iteration in the unit
     // specified by 'time_unit'.
     // NOTE: If 'iterations' is zero the returned value represents the
@@ -1477,6 +3093,10 @@ class BenchmarkReporter {
     // accumulated time.
     double GetAdjustedCPUTime() const;
 
+    // Return 'total', one of the members of 'memory_result', per memory
+    // iteration.
+    double MemoryPerIteration(int64_t total) const;
+
     // This is set to 0.0 if memory tracing is not enabled.
     double max_heapbytes_used;
 
@@ -1484,6 +3104,11 @@ class BenchmarkReporter {
     BigO complexity;
     BigOFunc* complexity_lambda;
     int64_t complexity_n;
+    // The lengths of the inputs, if the complexity is fitted over several.
+    std::vector<int64_t> complexity_ns;
+    // The complexity a BigO aggregate shows, if not that of 'complexity', as
+    // for a fit over several inputs (e.g. 'N + lgM').
+    std::string big_o_string;
 
     // what statistics to compute from the measurements
     const std::vector<internal::Statistics>* statistics;
@@ -1498,6 +3123,86 @@ class BenchmarkReporter {
     bool has_memory_result;
     double allocs_per_iter;
     int64_t max_bytes_used;
+    // All that the MemoryManager measured, over 'memory_iterations'. See
+    // MemoryPerIteration().
+    IterationCount memory_iterations;
+    MemoryManager::Result memory_result;
+
+    // The cpu and NUMA node each thread ran on (-1 if unknown), if the
+    // threads were pinned. Empty otherwise.
+    std::vector<int> thread_cpus;
+    std::vector<int> thread_numa_nodes;
+
+    // The iterations and the times, in seconds, of each thread, with
+    // --benchmark_thread_breakdown, in thread order. Empty otherwise, or with
+    // a single thread.
+    std::vector<IterationCount> thread_iterations;
+    std::vector<double> thread_real_times;
+    std::vector<double> thread_cpu_times;
+
+    // Sampled per-iteration latencies, if RecordLatencyHistogram() was used,
+    // in the unit specified by 'time_unit'. The percentiles are (percentile,
+    // latency) pairs, e.g. (99.9, p999); the buckets of the histogram are
+    // (upper bound, number of samples) pairs.
+    int64_t latency_samples;
+    std::vector<std::pair<double, double> > latency_percentiles;
+    std::vector<std::pair<double, int64_t> > latency_buckets;
+
+    // The half-width of the 95% confidence interval of the time per
+    // iteration, relative to it, if the benchmark was run until a target
+    // relative error. 0 otherwise.
+    double relative_error;
+
+    // The number of repetitions left out of an aggregate as outliers, with
+    // --benchmark_outlier_rejection.
+    int64_t outliers_dropped;
+
+    // Whether this run was not run again, but reused from the results cached
+    // in --benchmark_cache_dir.
+    bool cached;
+
+    // Whether the caches were flushed for this run, with ColdCache() or
+    // State::FlushCaches().
+    bool cold_cache;
+
+    // The frequency, in Hz, the cpu running the first thread ran at, if
+    // measured. 0 otherwise.
+    double cpu_frequency;
+
+    // The progress of the run over time, if RecordTimeSeries() was used.
+    std::vector<TimeSeriesSample> time_series;
+
+    // The real time per iteration of each of the Samples(), in seconds, in
+    // the order they were run, averaged over the threads. Those of a
+    // FixedWork() run are of each thread's, one after the other. Empty if
+    // not sampled.
+    std::vector<double> sample_times;
+
+    // For a CounterMatrix() aggregate, the counter, the distinct first and
+    // second arguments of the runs, in increasing order, and the counter of
+    // each pair of them, row by row, or NaN if no run had that pair.
+    std::string matrix_counter;
+    std::vector<int64_t> matrix_rows;
+    std::vector<int64_t> matrix_columns;
+    std::vector<double> matrix_values;
+
+    // The share of each role in the run, if ThreadGroups() was used, in the
+    // order they were given.
+    std::vector<RoleRun> roles;
+
+    // The file the profile of this run was written to, with
+    // --benchmark_profile. Empty if it was not profiled.
+    std::string profile_file;
+
+    // The Tags() of the benchmark, in the order they were given.
+    std::vector<std::string> tags;
+
+    // What makes the measurements of this run doubtful, each as
+    // "<check>: <why>": "empty_loop" if an iteration took about as long as
+    // one of an empty loop, as if the compiler had removed the body, and
+    // "timer_resolution" if the timer ran for only a few steps of its clock
+    // at a time. Empty if none.
+    std::vector<std::string> warnings;
   };
 
   struct PerFamilyRunReports {
@@ -1534,6 +3239,18 @@ class BenchmarkReporter {
   // complexity and RMS of that benchmark family.
   virtual void ReportRuns(const std::vector<Run>& report) = 0;
 
+  // Whether the run of each repetition of a benchmark is to be passed to
+  // ReportRepetition() as soon as it completes. If so, ReportRuns() is then
+  // only passed the aggregates over the repetitions, once they are all done.
+  // Ignored for the benchmarks this reporter only reports aggregates of.
+  virtual bool StreamsRepetitions() const { return false; }
+
+  // Called with the run of each repetition, as soon as it completes, if
+  // StreamsRepetitions() returns true. When random interleaving is enabled,
+  // the repetitions of different benchmarks come in the order they were run.
+  // By default, passes the run on to ReportRuns() on its own.
+  virtual void ReportRepetition(const Run& run);
+
   // Called once and only once after ever group of benchmarks is run and
   // reported.
   virtual void Finalize() {}
@@ -1577,16 +3294,29 @@ class ConsoleReporter : public BenchmarkReporter {
     OO_Color = 1,
     OO_Tabular = 2,
     OO_ColorTabular = OO_Color | OO_Tabular,
-    OO_Defaults = OO_ColorTabular
+    OO_Defaults = OO_ColorTabular,
+    // A single line with the repetitions done so far and an estimate of the
+    // time left, in place of a line per run, which is only printed for the
+    // errors.
+    OO_Progress = 4
   };
   explicit ConsoleReporter(OutputOptions opts_ = OO_Defaults)
       : output_options_(opts_),
         name_field_width_(0),
         prev_counters_(),
-        printed_header_(false) {}
+        printed_header_(false),
+        num_repetitions_(0),
+        repetitions_done_(0),
+        errors_(0),
+        start_time_(0),
+        last_progress_time_(0),
+        progress_width_(0),
+        progress_on_terminal_(false) {}
 
   virtual bool ReportContext(const Context& context) BENCHMARK_OVERRIDE;
   virtual void ReportRuns(const std::vector<Run>& reports) BENCHMARK_OVERRIDE;
+  virtual bool StreamsRepetitions() const BENCHMARK_OVERRIDE { return true; }
+  virtual void Finalize() BENCHMARK_OVERRIDE;
 
  protected:
   virtual void PrintRunData(const Run& report);
@@ -1596,6 +3326,26 @@ class ConsoleReporter : public BenchmarkReporter {
   size_t name_field_width_;
   UserCounters prev_counters_;
   bool printed_header_;
+
+ private:
+  void PrintProgress(const Run& report);
+
+  // Each line is formatted into this, which is reused from one line to the
+  // next, and written out in one go.
+  std::string buffer_;
+  // The width of each of the counters of the tabular header last printed.
+  std::vector<size_t> counter_widths_;
+
+  // Of OO_Progress.
+  int64_t num_repetitions_;
+  int64_t repetitions_done_;
+  int64_t errors_;
+  double start_time_;
+  double last_progress_time_;
+  // Of the line that a terminal shows, which the next one overwrites.
+  size_t progress_width_;
+  bool progress_on_terminal_;
+  std::string last_run_name_;
 };
 
 class JSONReporter : public BenchmarkReporter {
@@ -1603,52 +3353,110 @@ class JSONReporter : public BenchmarkReporter {
   JSONReporter() : first_report_(true) {}
   virtual bool ReportContext(const Context& context) BENCHMARK_OVERRIDE;
   virtual void ReportRuns(const std::vector<Run>& reports) BENCHMARK_OVERRIDE;
+  virtual bool StreamsRepetitions() const BENCHMARK_OVERRIDE { return true; }
   virtual void Finalize() BENCHMARK_OVERRIDE;
 
  private:
+  // Appends the members of the run to buffer_.
   void PrintRunData(const Run& report);
 
   bool first_report_;
+  // The output is built here before it's written, and it is kept from one
+  // report to the next so that its memory is reused.
+  std::string buffer_;
 };
 
-class BENCHMARK_DEPRECATED_MSG(
-    "The CSV Reporter will be removed in a future release") CSVReporter
-    : public BenchmarkReporter {
+// Writes the runs in a compact, columnar binary format, which can be
+// memory-mapped and scanned without being parsed, once all of them are done.
+// The format is described in src/binary_reporter.cc, and tools/gbench/binary.py
+// reads it.
+class BinaryReporter : public BenchmarkReporter {
  public:
-  CSVReporter() : printed_header_(false) {}
   virtual bool ReportContext(const Context& context) BENCHMARK_OVERRIDE;
   virtual void ReportRuns(const std::vector<Run>& reports) BENCHMARK_OVERRIDE;
+  virtual bool StreamsRepetitions() const BENCHMARK_OVERRIDE { return true; }
+  virtual void Finalize() BENCHMARK_OVERRIDE;
 
  private:
-  void PrintRunData(const Run& report);
-
-  bool printed_header_;
-  std::set<std::string> user_counter_names_;
+  std::vector<std::pair<std::string, std::string> > context_;
+  std::vector<Run> runs_;
 };
 
-// If a MemoryManager is registered, it can be used to collect and report
-// allocation metrics for a run of the benchmark.
-class MemoryManager {
+// Writes the runs as CSV, with a column for each of the fields of the runs,
+// which are those of the binary format, one for each of the counters of the
+// runs before the header, and one with the other counters, so that every row
+// has the same columns. The counters are only known once the runs are done,
+// so the runs are held until all of them are, or until there are too many to
+// hold, and then the header is written; the runs after that are written as
+// they come. The counters a run doesn't have are left empty.
+class TableReporter : public BenchmarkReporter {
  public:
-  struct Result {
-    Result() : num_allocs(0), max_bytes_used(0) {}
+  TableReporter() : schema_fixed_(false) {}
 
-    // The number of allocations made in total between Start and Stop.
-    int64_t num_allocs;
+  virtual bool ReportContext(const Context& context) BENCHMARK_OVERRIDE;
+  virtual void ReportRuns(const std::vector<Run>& reports) BENCHMARK_OVERRIDE;
+  virtual bool StreamsRepetitions() const BENCHMARK_OVERRIDE { return true; }
+  virtual void Finalize() BENCHMARK_OVERRIDE;
 
-    // The peak memory use between Start and Stop.
-    int64_t max_bytes_used;
-  };
+ private:
+  void BufferRuns(const std::vector<Run>& reports);
+  // Write the header, with the counters of the runs held so far, and those
+  // runs.
+  void FixSchema();
+  void Write(const std::string& chunk);
+
+  // Whether the header was written, with the counters in 'schema_'.
+  bool schema_fixed_;
+  std::vector<std::string> schema_;
+  // The fields of the runs held, already formatted, of which those of row
+  // i end at row_ends_[i].
+  std::string rows_;
+  std::vector<size_t> row_ends_;
+  // The counters of the runs held, as the id of their name and their value,
+  // of which those of row i end at counter_ends_[i].
+  std::vector<std::pair<uint32_t, double> > counters_;
+  std::vector<size_t> counter_ends_;
+  std::map<std::string, uint32_t> counter_ids_;
+};
 
-  virtual ~MemoryManager() {}
+// Writes the time spent in the Regions of the runs as folded stacks, the
+// input of flamegraph.pl and of most flame graph viewers: a line per region,
+// with the name of the run and those of the regions it is nested in, then its
+// own, separated by ';', and the nanoseconds spent in it and not in the
+// regions nested in it. The line of the run itself has the time spent out of
+// all its regions.
+class FoldedReporter : public BenchmarkReporter {
+ public:
+  virtual bool ReportContext(const Context& context) BENCHMARK_OVERRIDE;
+  virtual void ReportRuns(const std::vector<Run>& reports) BENCHMARK_OVERRIDE;
+  virtual bool StreamsRepetitions() const BENCHMARK_OVERRIDE { return true; }
+};
 
-  // Implement this to start recording allocation information.
-  virtual void Start() = 0;
+class BENCHMARK_DEPRECATED_MSG(
+    "The CSV Reporter will be removed in a future release") CSVReporter
+    : public BenchmarkReporter {
+ public:
+  CSVReporter() : printed_header_(false), memory_columns_(false) {}
+  virtual bool ReportContext(const Context& context) BENCHMARK_OVERRIDE;
+  virtual void ReportRuns(const std::vector<Run>& reports) BENCHMARK_OVERRIDE;
 
-  // Implement this to stop recording and fill out the given Result structure.
-  virtual void Stop(Result* result) = 0;
+ private:
+  void PrintRunData(const Run& report);
+
+  bool printed_header_;
+  // Whether the header has the memory metrics, if the first runs had them.
+  bool memory_columns_;
+  std::set<std::string> user_counter_names_;
 };
 
+// Run the benchmarks that match 'spec', a regex like --benchmark_filter, or
+// those that match the flag if 'spec' is empty, as RunSpecifiedBenchmarks()
+// does, but return the runs the display reporter would have been passed, in
+// the same order, rather than printing them. The file reporter of
+// --benchmark_out, if any, still writes them.
+std::vector<BenchmarkReporter::Run> RunSpecifiedBenchmarks(
+    const std::string& spec);
+
 inline const char* GetTimeUnitString(TimeUnit unit) {
   switch (unit) {
     case kSecond:
@@ -1692,6 +3500,10 @@ std::vector<int64_t> CreateRange(int64_t lo, int64_t hi, int multi);
 std::vector<int64_t> CreateDenseRange(int64_t start, int64_t limit,
                                       int step);
 
+// Creates the list of working set sizes of Benchmark::CacheBoundaryRange().
+std::vector<int64_t> CreateCacheBoundaryRange(
+    const std::vector<double>& fractions);
+
 }  // namespace benchmark
 
 #endif  // BENCHMARK_BENCHMARK_H_
@@ -0,0 +1,108 @@
+#include "ab_comparison.h"
+
+#include <cmath>
+#include <map>
+#include <utility>
+
+#include "statistics.h"
+
+namespace benchmark {
+
+namespace {
+
+struct PairSides {
+  PairSides() : baseline(nullptr), contender(nullptr) {}
+
+  const BenchmarkReporter::Run* baseline;
+  const BenchmarkReporter::Run* contender;
+};
+
+double PerIteration(double time, IterationCount iterations) {
+  return time / static_cast<double>(iterations);
+}
+
+}  // end namespace
+
+std::vector<BenchmarkReporter::Run> ComputeABComparison(
+    const std::vector<BenchmarkReporter::Run>& reports) {
+  typedef BenchmarkReporter::Run Run;
+  std::vector<Run> results;
+
+  // The two sides of each repetition, by pair and then repetition.
+  std::map<int64_t, std::map<int64_t, PairSides> > pairs;
+  for (const Run& run : reports) {
+    if (run.run_type != Run::RT_Iteration || run.error_occurred ||
+        run.iterations == 0) {
+      continue;
+    }
+    PairSides& sides =
+        pairs[run.per_family_instance_index / 2][run.repetition_index];
+    if (run.per_family_instance_index % 2 == 0) {
+      sides.baseline = &run;
+    } else {
+      sides.contender = &run;
+    }
+  }
+
+  for (const auto& pair : pairs) {
+    std::vector<double> real_diffs;
+    std::vector<double> cpu_diffs;
+    const Run* baseline = nullptr;
+    const Run* contender = nullptr;
+    for (const auto& repetition : pair.second) {
+      const PairSides& sides = repetition.second;
+      if (sides.baseline == nullptr || sides.contender == nullptr) continue;
+      baseline = sides.baseline;
+      contender = sides.contender;
+      const double baseline_real = PerIteration(
+          baseline->real_accumulated_time, baseline->iterations);
+      const double baseline_cpu =
+          PerIteration(baseline->cpu_accumulated_time, baseline->iterations);
+      if (baseline_real <= 0 || baseline_cpu <= 0) continue;
+      real_diffs.push_back(PerIteration(contender->real_accumulated_time,
+                                        contender->iterations) /
+                               baseline_real -
+                           1);
+      cpu_diffs.push_back(PerIteration(contender->cpu_accumulated_time,
+                                       contender->iterations) /
+                              baseline_cpu -
+                          1);
+    }
+    if (real_diffs.size() < 2) continue;
+
+    const double n = static_cast<double>(real_diffs.size());
+    const double t = StudentT975(real_diffs.size() - 1);
+    const double real_mean = StatisticsMean(real_diffs);
+    const double cpu_mean = StatisticsMean(cpu_diffs);
+    const double real_half_width =
+        t * StatisticsStdDev(real_diffs) / std::sqrt(n);
+    const double cpu_half_width =
+        t * StatisticsStdDev(cpu_diffs) / std::sqrt(n);
+    const std::pair<const char*, double> aggregates[] = {
+        std::make_pair("ab_diff", 0.0), std::make_pair("ab_ci_low", -1.0),
+        std::make_pair("ab_ci_high", 1.0)};
+    for (const auto& aggregate : aggregates) {
+      Run data;
+      data.run_name = contender->run_name;
+      data.family_index = contender->family_index;
+      data.per_family_instance_index = contender->per_family_instance_index;
+      data.tags = contender->tags;
+      data.run_type = Run::RT_Aggregate;
+      data.aggregate_name = aggregate.first;
+      data.aggregate_unit = StatisticUnit::kPercentage;
+      data.report_label = "vs " + baseline->run_name.str();
+      data.iterations = static_cast<IterationCount>(real_diffs.size());
+      data.repetitions = contender->repetitions;
+      data.repetition_index = Run::no_repetition_index;
+      data.threads = contender->threads;
+      data.time_unit = contender->time_unit;
+      data.real_accumulated_time =
+          real_mean + aggregate.second * real_half_width;
+      data.cpu_accumulated_time = cpu_mean + aggregate.second * cpu_half_width;
+      results.push_back(data);
+    }
+  }
+  return results;
+}
+
+}  // end namespace benchmark
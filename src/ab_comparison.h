@@ -0,0 +1,23 @@
+#ifndef BENCHMARK_AB_COMPARISON_H_
+#define BENCHMARK_AB_COMPARISON_H_
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+
+// Return, for each A/B pair of instances in the 'reports' of a family made
+// with Benchmark::CompareWith(), the differences of the contender to the
+// baseline, paired by repetition: an 'ab_diff' aggregate with the mean
+// relative difference of their real and cpu times per iteration, and
+// 'ab_ci_low' and 'ab_ci_high' aggregates with the bounds of its 95%
+// confidence interval. The baseline of a pair is the instance with an even
+// per-family index, and the contender the one after it. Pairs with fewer
+// than two repetitions that completed on both sides are left out.
+std::vector<BenchmarkReporter::Run> ComputeABComparison(
+    const std::vector<BenchmarkReporter::Run>& reports);
+
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_AB_COMPARISON_H_
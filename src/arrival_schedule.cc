@@ -0,0 +1,45 @@
+#include "arrival_schedule.h"
+
+#include <chrono>
+#include <thread>
+
+#include "timers.h"
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+// Below this, sleeping overshoots too much, so the rest of a wait is spent
+// spinning on the clock.
+constexpr double kMinSleep = 200e-6;
+
+}  // end namespace
+
+ArrivalSchedule::ArrivalSchedule(double rate, ArrivalProcess process,
+                                 uint64_t seed)
+    : mean_interval_(1.0 / rate),
+      process_(process),
+      rng_(seed),
+      intervals_(rate),
+      next_(-1) {}
+
+double ArrivalSchedule::WaitForNext() {
+  double now = ChronoClockNow();
+  // The first iteration is due one interval in, so that n iterations span n
+  // intervals.
+  if (next_ < 0) next_ = now;
+  next_ += process_ == kPoissonArrivals ? intervals_(rng_) : mean_interval_;
+  while (now < next_) {
+    const double wait = next_ - now;
+    if (wait > kMinSleep) {
+      std::this_thread::sleep_for(
+          std::chrono::duration<double>(wait - kMinSleep / 2));
+    }
+    now = ChronoClockNow();
+  }
+  return next_;
+}
+
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,37 @@
+#ifndef BENCHMARK_ARRIVAL_SCHEDULE_H_
+#define BENCHMARK_ARRIVAL_SCHEDULE_H_
+
+#include <cstdint>
+#include <random>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+namespace internal {
+
+// When the iterations of one thread of an open-loop benchmark are due, for
+// TargetRate(). The schedule is fixed up front by the rate, the process and
+// the seed: an iteration that runs late doesn't push back the ones after it,
+// which is what keeps coordinated omission out of the latencies.
+class ArrivalSchedule {
+ public:
+  ArrivalSchedule(double rate, ArrivalProcess process, uint64_t seed);
+
+  // Wait until the next iteration is due, and return when that was, in
+  // ChronoClockNow() seconds. Returns at once if the thread is already behind.
+  // The schedule starts with the first call.
+  double WaitForNext();
+
+ private:
+  const double mean_interval_;
+  const ArrivalProcess process_;
+  std::mt19937_64 rng_;
+  std::exponential_distribution<double> intervals_;
+  // When the next iteration is due, or -1 before the first call.
+  double next_;
+};
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_ARRIVAL_SCHEDULE_H_
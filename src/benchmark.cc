@@ -37,6 +37,7 @@
 #include <map>
 #include <memory>
 #include <random>
+#include <set>
 #include <string>
 #include <thread>
 #include <utility>
@@ -44,20 +45,47 @@
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/synchronization/mutex.h"
+#include "ab_comparison.h"
+#include "arrival_schedule.h"
+#include "cache_flush.h"
+#include "calibration.h"
+#include "checkpoint.h"
 #include "check.h"
 #include "colorprint.h"
 #include "commandlineflags.h"
 #include "complexity.h"
+#include "coordinator.h"
 #include "counter.h"
+#include "counter_matrix.h"
+#include "cpu_affinity.h"
+#include "energy.h"
+#include "harness_stats.h"
+#include "interference.h"
 #include "internal_macros.h"
+#include "latency_histogram.h"
+#include "live_metrics.h"
 #include "log.h"
+#include "measurement_checks.h"
 #include "mutex.h"
+#include "noise_monitor.h"
 #include "perf_counters.h"
+#include "perf_metrics.h"
+#include "profiler.h"
 #include "re.h"
+#include "realtime.h"
+#include "reporting_thread.h"
+#include "result_cache.h"
+#include "results_reader.h"
+#include "shard.h"
 #include "statistics.h"
 #include "string_util.h"
+#include "sysinfo.h"
 #include "thread_manager.h"
+#include "thread_pool.h"
+#include "thread_scaling.h"
+#include "trace.h"
 #include "thread_timer.h"
+#include "tuner.h"
 
 ABSL_FLAG(
     bool, benchmark_list_tests, false,
@@ -68,6 +96,13 @@ ABSL_FLAG(std::string, benchmark_filter, ".",
           "execute.  If this flag is empty, or if this flag is the string "
           "\"all\", all benchmarks linked into the binary are run.");
 
+ABSL_FLAG(std::string, benchmark_tags, "",
+          "The comma-separated terms that the Tags() of the benchmarks to "
+          "run must all satisfy, along with --benchmark_filter: 'tag' to "
+          "require it, 'a|b' to require one of them, and '-tag' or '-a|b' to "
+          "rule them out, e.g. 'numa,-slow'. If empty, the tags select all "
+          "the benchmarks.");
+
 ABSL_FLAG(
     double, benchmark_min_time, 0.5,
     "Minimum number of seconds we should run benchmark before results are "
@@ -76,6 +111,17 @@ ABSL_FLAG(
     "For real-time based tests, this is the lower bound on the elapsed time of "
     "the benchmark execution, regardless of number of threads.");
 
+ABSL_FLAG(double, benchmark_min_warmup_time, 0.0,
+          "Minimum number of seconds a benchmark should be run before the "
+          "iteration count is estimated and the results are measured, e.g. "
+          "to warm up the caches. The results of the warm-up are discarded.");
+
+ABSL_FLAG(double, benchmark_target_cv, 0.0,
+          "If positive, run each benchmark that doesn't set its own "
+          "TargetRelativeError() in batches until the 95% confidence interval "
+          "of its time per iteration is within this fraction of it (e.g. 0.01 "
+          "for +/-1%), or until 10 times the minimum time was spent.");
+
 ABSL_FLAG(int32_t, benchmark_repetitions, 1,
           "The number of runs of each benchmark. If greater than 1, the mean "
           "and standard deviation of the runs will be reported.");
@@ -98,17 +144,82 @@ ABSL_FLAG(
     "benchmark_report_aggregates_only, only affects the display reporter, but  "
     "*NOT* file reporter, which will still contain all the output.");
 
+ABSL_FLAG(std::string, benchmark_outlier_rejection, "none",
+          "The rule by which repetitions are left out of the aggregates as "
+          "outliers: 'none', 'iqr' (outside 1.5 interquartile ranges of the "
+          "quartiles) or 'mad' (more than 3 estimated standard deviations "
+          "from the median, by the median absolute deviation).");
+
+ABSL_FLAG(int32_t, benchmark_shard_count, 1,
+          "The number of shards to split the benchmarks into, to run them on "
+          "as many machines. Only the shard --benchmark_shard_index is run.");
+
+ABSL_FLAG(int32_t, benchmark_shard_index, 0,
+          "The shard to run, from 0 to --benchmark_shard_count - 1.");
+
+ABSL_FLAG(std::string, benchmark_shard_costs, "",
+          "The JSON output of a previous run of the benchmarks, from which "
+          "their costs are estimated to balance the shards. If empty, the "
+          "shards have about as many benchmarks each.");
+
+ABSL_FLAG(std::string, benchmark_cache_dir, "",
+          "If set, the directory to cache the results of the benchmarks in. "
+          "A benchmark whose results are there, from the same code run with "
+          "the same flags, is reported from there rather than run again.");
+
+ABSL_FLAG(std::string, benchmark_datagen_dir, "",
+          "If set, the directory to keep the inputs generated with "
+          "benchmark::datagen in, for later runs to map rather than generate "
+          "them again.");
+
+ABSL_FLAG(std::string, benchmark_sysinfo_cache_dir, "",
+          "If set, the directory to cache the system information of the host "
+          "in, for later runs on it to read rather than probe it again, until "
+          "it reboots.");
+
+ABSL_FLAG(std::string, benchmark_cache_fingerprint, "",
+          "What identifies the code of the benchmarks in the cache, for those "
+          "that don't set one with CacheFingerprint(), e.g. a hash of the "
+          "libraries they measure. If empty, a hash of the executable.");
+
+ABSL_FLAG(std::string, benchmark_checkpoint, "",
+          "A file that each repetition is appended to as soon as it "
+          "completes. When the benchmarks are run again with the same file, "
+          "the repetitions it has of the same code with the same flags are "
+          "reported rather than run again, so that a run that was cut short "
+          "resumes where it stopped. The parallel jobs are not used.");
+
+ABSL_FLAG(std::string, benchmark_iterations_hint_file, "",
+          "The JSON or binary output of an earlier run of the benchmarks. "
+          "Each benchmark starts at the iteration count it was run with "
+          "there, rather than ramping up to it again.");
+
+ABSL_FLAG(std::string, benchmark_interference_file, "",
+          "The JSON or binary output of an earlier run of the benchmarks, "
+          "with their memory measured or their CACHE-MISSES counted. The "
+          "caches are scrubbed and the allocator trimmed before each "
+          "repetition of an instance that didn't go through more than the "
+          "last-level cache there, right after one of an instance that did.");
+
+ABSL_FLAG(bool, benchmark_process_memory, false,
+          "If no MemoryManager is registered, measure the peak resident set "
+          "size and the page faults of a few iterations of each benchmark.");
+
 ABSL_FLAG(std::string, benchmark_format, "console",
           "The format to use for console output. Valid values are 'console', "
-          "'json', or 'csv'.");
+          "'json', 'csv', 'table', or 'folded'.");
 
 ABSL_FLAG(std::string, benchmark_out_format, "json",
           "The format to use for file output. Valid values are 'console', "
-          "'json', or 'csv'.");
+          "'json', 'csv', 'table', 'binary', or 'folded'.");
 
 ABSL_FLAG(std::string, benchmark_out, "",
           "The file to write additional output to.");
 
+ABSL_FLAG(std::string, benchmark_trace_out, "",
+          "The file to write the timeline of the run to, as Chrome trace "
+          "events, which chrome://tracing and Perfetto load.");
+
 ABSL_FLAG(std::string, benchmark_color, "auto",
           "Whether to use colors in the output.  Valid values: 'true'/'yes'/1, "
           "'false'/'no'/0, and 'auto'. 'auto' means to use colors if the "
@@ -120,6 +231,22 @@ ABSL_FLAG(
     "Whether to use tabular format when printing user counters to the console. "
     "Valid values: 'true'/'yes'/1, 'false'/'no'/0.  Defaults to false.");
 
+ABSL_FLAG(bool, benchmark_progress, false,
+          "Whether the console shows a single line with the repetitions done "
+          "so far and an estimate of the time left, rather than a line per "
+          "run. The errors are still printed in full.");
+
+ABSL_FLAG(bool, benchmark_background_reporting, false,
+          "Whether the results are reported by a thread of their own, at the "
+          "lowest scheduling priority, so that the repetitions don't wait "
+          "for the reporters to format and write them out. They are still "
+          "reported in order.");
+
+ABSL_FLAG(std::string, benchmark_reporting_cpus, "",
+          "The cpus that the thread of --benchmark_background_reporting runs "
+          "on, such as '0-1', e.g. to keep it off those the benchmarks are "
+          "pinned to. If empty, it runs anywhere.");
+
 ABSL_FLAG(int32_t, v, 0, "The level of verbose logging to output.");
 
 ABSL_FLAG(std::vector<std::string>, benchmark_perf_counters, {},
@@ -127,6 +254,156 @@ ABSL_FLAG(std::vector<std::string>, benchmark_perf_counters, {},
           "more information about libpfm: "
           "https://man7.org/linux/man-pages/man3/libpfm.3.html");
 
+ABSL_FLAG(std::vector<std::string>, benchmark_perf_metrics, {},
+          "List of metric sets to derive from perf counters, which are "
+          "collected along with --benchmark_perf_counters: 'ipc', 'branch' "
+          "(branch misses per thousand instructions), 'memory' (cache misses "
+          "per thousand instructions) or 'tma_l1' (the frontend bound, bad "
+          "speculation, retiring and backend bound fractions of the pipeline "
+          "slots, on the Intel cores whose events are known).");
+
+ABSL_FLAG(int32_t, benchmark_parallel_jobs, 1,
+          "The number of benchmark families to run at the same time, each on "
+          "its own cores, spread over the last-level caches. The families "
+          "that can't share the machine are run alone afterwards.");
+
+ABSL_FLAG(std::string, benchmark_coordinator, "",
+          "The address, '<host>:<port>' or 'unix:<path>', at which the "
+          "leader of a run over several processes listens, with "
+          "--benchmark_coordinator_workers, or else the one that this "
+          "process connects to as one of its workers. Each run of the "
+          "leader is then also run by the workers, started at the same "
+          "time, and their threads are reported as more threads of the "
+          "leader's. The workers report nothing themselves.");
+
+ABSL_FLAG(int32_t, benchmark_coordinator_workers, 0,
+          "The number of workers that the leader at --benchmark_coordinator "
+          "waits for, which all run the same benchmarks as it does.");
+
+ABSL_FLAG(double, benchmark_time_budget, 0.0,
+          "If positive, the seconds that running the benchmarks may take. "
+          "Every instance gets a repetition before any gets another, those "
+          "of a higher Priority() first, and then the repetitions left go to "
+          "those of a higher priority and then of more varying times, as "
+          "long as each is expected to end within the budget. Once it runs "
+          "out, the instances report the aggregates of the repetitions they "
+          "did. The parallel jobs are not used.");
+
+ABSL_FLAG(bool, benchmark_perf_counters_per_thread, false,
+          "Whether to also report the perf counters of each thread of "
+          "multithreaded benchmarks, as '<counter>/thread:<index>'.");
+
+ABSL_FLAG(bool, benchmark_thread_breakdown, false,
+          "Whether to also report the iterations and times of each thread of "
+          "multithreaded benchmarks, and how unevenly the threads took their "
+          "time, as the 'thread_imbalance' (the slowest thread over the "
+          "mean) and 'thread_cv' (the coefficient of variation over the "
+          "threads) counters.");
+
+ABSL_FLAG(std::string, benchmark_cpu_affinity, "",
+          "Where to run the threads of the benchmarks that don't pick their "
+          "own placement with PinThreads(). Valid values are 'none' (or "
+          "empty), 'compact', 'scatter', 'numa', 'cores', or a list of cpus "
+          "such as '0-3,8'.");
+
+ABSL_FLAG(std::string, benchmark_isolation, "none",
+          "Where to run the repetitions of the benchmarks. Valid values are "
+          "'none', to run them all in this process, or 'process', to run each "
+          "of them in a child process of its own.");
+
+ABSL_FLAG(int32_t, benchmark_realtime_priority, 0,
+          "If positive, run the threads of the benchmarks under SCHED_FIFO at "
+          "this real-time priority, from 1 to 99, so that other threads don't "
+          "preempt them. The reporting still runs at the normal priority, in "
+          "between. Needs CAP_SYS_NICE, or a large enough RLIMIT_RTPRIO.");
+
+ABSL_FLAG(bool, benchmark_lock_memory, false,
+          "Lock the memory of the process with mlockall(), so that the runs "
+          "don't fault pages in. Needs CAP_IPC_LOCK, or a large enough "
+          "RLIMIT_MEMLOCK.");
+
+ABSL_FLAG(bool, benchmark_report_cpu_frequency, false,
+          "Report the frequency the cpu ran at during each repetition, as "
+          "cpu_frequency_mhz in the JSON output.");
+
+ABSL_FLAG(double, benchmark_max_cpu_frequency_drop, 0.0,
+          "If positive, a repetition fails if the cpu ran at a frequency more "
+          "than this fraction below the highest frequency that an earlier "
+          "repetition ran at, e.g. 0.1 for throttling by more than 10%. "
+          "Implies --benchmark_report_cpu_frequency.");
+
+ABSL_FLAG(bool, benchmark_noise_stats, false,
+          "Count the context switches, page faults and cpu migrations of the "
+          "threads of each repetition, as counters of the repetition.");
+
+ABSL_FLAG(std::string, benchmark_noise_thresholds, "",
+          "If set, e.g. to 'cpu_migrations=0,involuntary_switches=10', a "
+          "repetition whose counts exceed one of these is run again, up to "
+          "--benchmark_noise_max_reruns times. Implies "
+          "--benchmark_noise_stats.");
+
+ABSL_FLAG(int32_t, benchmark_noise_max_reruns, 3,
+          "How many times a repetition is run again for exceeding "
+          "--benchmark_noise_thresholds, at most. The last run is kept.");
+
+ABSL_FLAG(bool, benchmark_check_measurements, false,
+          "Warn about the runs whose iterations take about as long as those "
+          "of an empty loop, as if the compiler had removed their body, or "
+          "whose timer runs for only a few steps of its clock at a time, "
+          "on the console and as the warnings of the run in the JSON "
+          "output.");
+
+ABSL_FLAG(bool, benchmark_energy, false,
+          "Measure the energy the cpu packages used during each run, from "
+          "their RAPL counters, as energy/<domain>, in joules per iteration, "
+          "and power/<domain>, in watts. Needs read access to "
+          "/sys/class/powercap.");
+
+ABSL_FLAG(bool, benchmark_harness_stats, false,
+          "At the end, print how the wall time of each benchmark and of all "
+          "of them split between the timed regions, the pauses of the timer, "
+          "the fixtures, starting and joining the threads, probing for the "
+          "iteration count, the memory manager and reporting, to stderr.");
+
+ABSL_FLAG(bool, benchmark_calibrate, false,
+          "Time reference kernels before running the benchmarks: an integer "
+          "multiply-add loop, a chase of pointers in the L1 data cache and "
+          "one in memory. Their nanoseconds per step are recorded in the "
+          "context, as calibration_alu_ns, calibration_l1_ns and "
+          "calibration_dram_ns, so that the results of hosts of different "
+          "speeds can be compared.");
+
+ABSL_FLAG(double, benchmark_calibration_interval, 0.0,
+          "If positive, the reference kernels are timed again between the "
+          "repetitions once this many seconds have passed since they last "
+          "were, for the normalized_time of the runs after them.");
+
+ABSL_FLAG(std::string, benchmark_normalize_time, "",
+          "If set to one of 'alu', 'l1' or 'dram', each run has a "
+          "normalized_time counter: its real time per iteration in steps of "
+          "that reference kernel. Implies --benchmark_calibrate.");
+
+ABSL_FLAG(std::string, benchmark_profile, "",
+          "Profile the timed regions of the last repetition of each "
+          "benchmark, with a sampling perf event of each of its threads. "
+          "Valid values are 'perf', for the functions the samples fall in, "
+          "and 'lbr', for the branches taken before them, from the branch "
+          "record of the cpu. The profile is written to a file in "
+          "--benchmark_profile_dir, whose name is the profile_file of the run "
+          "in the JSON output.");
+
+ABSL_FLAG(std::string, benchmark_profile_dir, ".",
+          "The directory the --benchmark_profile files are written to.");
+
+ABSL_FLAG(std::string, benchmark_metrics_address, "",
+          "Serve the metrics of the benchmarks as they run, in the text "
+          "format of OpenMetrics, over HTTP at /metrics on this "
+          "'[<host>]:<port>', e.g. ':9100' for any host. Empty for none.");
+
+ABSL_FLAG(double, benchmark_metrics_interval, 1.0,
+          "How often, in seconds, the progress of the runs is sampled for "
+          "--benchmark_metrics_address.");
+
 ABSL_FLAG(std::string, benchmark_context, "",
           "Extra context to include in the output formatted as comma-separated "
           "key-value pairs. Kept internal as it's only used for parsing from "
@@ -145,7 +422,10 @@ void UseCharPointer(char const volatile*) {}
 State::State(IterationCount max_iters, const std::vector<int64_t>& ranges,
              int thread_i, int n_threads, internal::ThreadTimer* timer,
              internal::ThreadManager* manager,
-             internal::PerfCountersMeasurement* perf_counters_measurement)
+             internal::PerfCountersMeasurement* perf_counters_measurement,
+             internal::LatencyHistogram* latency_histogram,
+             IterationCount progress_chunk,
+             internal::ArrivalSchedule* arrivals)
     : total_iterations_(0),
       batch_leftover_(0),
       max_iterations(max_iters),
@@ -153,8 +433,29 @@ State::State(IterationCount max_iters, const std::vector<int64_t>& ranges,
       finished_(false),
       error_occurred_(false),
       range_(ranges),
+      arg_values_(nullptr),
+      seed_(0),
+      repetition_index_(0),
+      in_flight_(1),
+      role_thread_index_(0),
+      profiler_(nullptr),
       complexity_n_(0),
+      latency_histogram_(latency_histogram),
+      sample_iterations_left_(0),
+      next_chunk_sampled_(false),
+      sample_start_(-1),
+      progress_chunk_(progress_chunk),
+      record_samples_(manager != nullptr && manager->record_samples()),
+      sample_timed_(0),
+      sampled_iterations_(0),
+      arrivals_(arrivals),
+      shared_chunk_(0),
+      shared_taken_(0),
       counters(),
+      async_timer_(nullptr),
+      max_in_flight_(0),
+      async_start_(0),
+      async_started_(false),
       thread_index_(thread_i),
       threads_(n_threads),
       timer_(timer),
@@ -163,6 +464,8 @@ State::State(IterationCount max_iters, const std::vector<int64_t>& ranges,
   BM_CHECK(max_iterations != 0) << "At least one iteration must be run";
   BM_CHECK_LT(thread_index_, threads_)
       << "thread_index must be less than threads";
+  BM_CHECK(arrivals_ == nullptr || latency_histogram_ != nullptr)
+      << "Iterations run on a schedule are timed into a latency histogram";
 
   // Note: The use of offsetof below is technically undefined until C++17
   // because State is not a standard layout type. However, all compilers
@@ -189,27 +492,133 @@ State::State(IterationCount max_iters, const std::vector<int64_t>& ranges,
 #endif
 }
 
+const std::string& State::string_arg(std::size_t pos) const {
+  BM_CHECK(arg_values_ != nullptr &&
+           pos < arg_values_->arg_value_names_.size() &&
+           !arg_values_->arg_value_names_[pos].empty())
+      << "arg " << pos << " has no values";
+  const std::vector<std::string>& names = arg_values_->arg_value_names_[pos];
+  const int64_t arg = range(pos);
+  BM_CHECK(arg >= 0 && arg < static_cast<int64_t>(names.size()))
+      << "arg " << pos << " is not the position of one of its values";
+  return names[static_cast<size_t>(arg)];
+}
+
+double State::double_arg(std::size_t pos) const {
+  const std::string& name = string_arg(pos);
+  const std::vector<std::vector<double>>& numbers =
+      arg_values_->arg_value_numbers_;
+  BM_CHECK(pos < numbers.size() && !numbers[pos].empty())
+      << "the values of arg " << pos << " are not numbers, but e.g. " << name;
+  return numbers[pos][static_cast<size_t>(range(pos))];
+}
+
 void State::PauseTiming() {
   // Add in time accumulated so far
   BM_CHECK(started_ && !finished_ && !error_occurred_);
   timer_->StopTimer();
+  if (internal::Tracer* tracer = internal::GetTracer()) tracer->StopTimed();
   if (perf_counters_measurement_) {
-    auto measurements = perf_counters_measurement_->StopAndGetMeasurements();
-    for (const auto& name_and_measurement : measurements) {
-      auto name = name_and_measurement.first;
-      auto measurement = name_and_measurement.second;
-      BM_CHECK_EQ(counters[name], 0.0);
-      counters[name] = Counter(measurement, Counter::kAvgIterations);
-    }
+    perf_counters_measurement_->Stop();
   }
+  if (profiler_) profiler_->Stop();
 }
 
 void State::ResumeTiming() {
   BM_CHECK(started_ && !finished_ && !error_occurred_);
+  if (internal::Tracer* tracer = internal::GetTracer()) tracer->StartTimed();
   timer_->StartTimer();
   if (perf_counters_measurement_) {
     perf_counters_measurement_->Start();
   }
+  if (profiler_) profiler_->Start();
+}
+
+IterationCount State::FirstSampleChunk() {
+  // Called from begin(), before the timer starts, so start off with iterations
+  // that are not sampled. If there are none, the first sample is only taken
+  // once StartKeepRunning() is done.
+  if (error_occurred_) return 0;
+  sample_iterations_left_ = shared_chunk_ != 0 ? 0 : max_iterations;
+  // The schedule starts with the first iteration, and the shared iterations
+  // are taken, once StartKeepRunning() is done.
+  if (arrivals_ != NULL || shared_chunk_ != 0) return 0;
+  if (latency_histogram_ == NULL) return NextSampleChunk();
+  const IterationCount period = latency_histogram_->sample_period();
+  next_chunk_sampled_ = true;
+  const IterationCount chunk = std::min(period - 1, sample_iterations_left_);
+  sample_iterations_left_ -= chunk;
+  return chunk;
+}
+
+bool State::TakeSharedIterations(IterationCount n) {
+  while (!error_occurred_ && total_iterations_ < n) {
+    const IterationCount taken = manager_->TakeSharedIterations(
+        std::max(shared_chunk_, n - total_iterations_));
+    if (taken == 0) break;
+    total_iterations_ += taken;
+    shared_taken_ += taken;
+  }
+  return !error_occurred_ && total_iterations_ >= n;
+}
+
+IterationCount State::NextSampleChunk() {
+  if (sample_start_ >= 0) {
+    const double elapsed = ChronoClockNow() - sample_start_;
+    latency_histogram_->Record(static_cast<uint64_t>(elapsed * 1e9));
+    sample_start_ = -1;
+  }
+  // The shared iterations this thread took are its own, whose chunks are
+  // handed out as if those were all.
+  const IterationCount done =
+      (shared_chunk_ != 0 ? shared_taken_ : max_iterations) -
+      sample_iterations_left_;
+  if (progress_chunk_ != 0) manager_->SetThreadProgress(thread_index_, done);
+  if (record_samples_ && !error_occurred_ && done > sampled_iterations_) {
+    const double timed = timer_->real_time_so_far();
+    manager_->GetThreadResult(thread_index_)
+        .sample_times.push_back(
+            (timed - sample_timed_) /
+            static_cast<double>(done - sampled_iterations_));
+    sample_timed_ = timed;
+    sampled_iterations_ = done;
+  }
+  if (error_occurred_) return 0;
+  if (sample_iterations_left_ == 0) {
+    if (shared_chunk_ == 0) return 0;
+    // A take of its own for each sample, which is then as long as it is
+    // when the iterations are not shared.
+    sample_iterations_left_ = manager_->TakeSharedIterations(
+        record_samples_ ? progress_chunk_ : shared_chunk_);
+    shared_taken_ += sample_iterations_left_;
+    if (sample_iterations_left_ == 0) return 0;
+  }
+  if (arrivals_ != NULL) {
+    // The latency of the next iteration counts from when it was due, which
+    // the wait for it may already be past.
+    sample_start_ = arrivals_->WaitForNext();
+    --sample_iterations_left_;
+    return 1;
+  }
+  if (latency_histogram_ == NULL) {
+    const IterationCount chunk =
+        progress_chunk_ != 0
+            ? std::min(progress_chunk_, sample_iterations_left_)
+            : sample_iterations_left_;
+    sample_iterations_left_ -= chunk;
+    return chunk;
+  }
+  const IterationCount period = latency_histogram_->sample_period();
+  IterationCount chunk;
+  if (next_chunk_sampled_ || period == 1) {
+    chunk = 1;
+    sample_start_ = ChronoClockNow();
+  } else {
+    chunk = std::min(period - 1, sample_iterations_left_);
+  }
+  next_chunk_sampled_ = !next_chunk_sampled_;
+  sample_iterations_left_ -= chunk;
+  return chunk;
 }
 
 void State::SkipWithError(const char* msg) {
@@ -226,10 +635,95 @@ void State::SkipWithError(const char* msg) {
   if (timer_->running()) timer_->StopTimer();
 }
 
+void State::FlushCaches() {
+  const bool timer_was_running = timer_->running();
+  if (timer_was_running) PauseTiming();
+  internal::FlushAllCaches();
+  manager_->GetThreadResult(thread_index_).cold_cache = true;
+  if (timer_was_running) ResumeTiming();
+}
+
+void State::FlushCaches(const void* data, size_t size) {
+  const bool timer_was_running = timer_->running();
+  if (timer_was_running) PauseTiming();
+  internal::FlushCacheLines(data, size);
+  manager_->GetThreadResult(thread_index_).cold_cache = true;
+  if (timer_was_running) ResumeTiming();
+}
+
 void State::SetIterationTime(double seconds) {
   timer_->SetIterationTime(seconds);
 }
 
+void State::SetAsyncTimer(AsyncTimer* timer, int max_in_flight) {
+  BM_CHECK(!started_) << "SetAsyncTimer() must be called before the loop";
+  BM_CHECK(max_in_flight > 0);
+  async_timer_ = timer;
+  max_in_flight_ = static_cast<size_t>(max_in_flight);
+  async_in_flight_.reserve(max_in_flight_);
+}
+
+void State::StartAsyncIteration() {
+  BM_CHECK(async_timer_ != nullptr && !async_started_)
+      << "StartAsyncIteration() needs an AsyncTimer, and a "
+         "StopAsyncIteration() after the previous one";
+  async_start_ = async_timer_->Record();
+  async_started_ = true;
+}
+
+void State::StopAsyncIteration() {
+  BM_CHECK(async_started_) << "StopAsyncIteration() without a start";
+  if (async_in_flight_.size() == max_in_flight_) {
+    ResolveAsyncIterations(std::max<size_t>(1, max_in_flight_ / 2));
+  }
+  async_in_flight_.emplace_back(async_start_, async_timer_->Record());
+  async_started_ = false;
+}
+
+void State::ResolveAsyncIterations(size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    const std::pair<uint64_t, uint64_t>& events = async_in_flight_[i];
+    timer_->SetIterationTime(
+        async_timer_->ElapsedSeconds(events.first, events.second));
+    async_timer_->Release(events.first);
+    async_timer_->Release(events.second);
+  }
+  async_in_flight_.erase(async_in_flight_.begin(),
+                         async_in_flight_.begin() + count);
+}
+
+void State::RecordLatency(double seconds) {
+  if (latency_histogram_ == NULL) return;
+  latency_histogram_->Record(static_cast<uint64_t>(seconds * 1e9));
+}
+
+CounterHandle State::RegisterCounter(const std::string& name,
+                                    const Counter& counter) {
+  for (size_t i = 0; i < registered_counter_names_.size(); ++i) {
+    if (registered_counter_names_[i] == name) return CounterHandle(i);
+  }
+  registered_counter_names_.push_back(name);
+  registered_counters_.push_back(counter);
+  return CounterHandle(registered_counters_.size() - 1);
+}
+
+void State::PublishRegisteredCounters() {
+  for (size_t i = 0; i < registered_counters_.size(); ++i) {
+    counters[registered_counter_names_[i]] = registered_counters_[i];
+  }
+}
+
+SharedCounter State::RegisterSharedCounter(const std::string& name,
+                                          const Counter& counter) {
+  internal::SharedCounterSlot* slots =
+      manager_->GetSharedCounterSlots(name, counter);
+  return SharedCounter(&slots[thread_index_], slots, manager_->num_threads());
+}
+
+double SharedCounter::Total() const {
+  return internal::ThreadManager::SumSharedCounterSlots(slots_, num_threads_);
+}
+
 void State::SetLabel(const char* label) {
   MutexLock l(manager_->GetBenchmarkMutex());
   manager_->results.report_label_ = label;
@@ -238,8 +732,12 @@ void State::SetLabel(const char* label) {
 void State::StartKeepRunning() {
   BM_CHECK(!started_ && !finished_);
   started_ = true;
-  total_iterations_ = error_occurred_ ? 0 : max_iterations;
+  // The shared iterations are only taken once this thread needs them.
+  total_iterations_ =
+      error_occurred_ || shared_chunk_ != 0 ? 0 : max_iterations;
+  if (perf_counters_measurement_) perf_counters_measurement_->Reset();
   manager_->StartStopBarrier();
+  manager_->GetThreadResult(thread_index_).loop_start = ChronoClockNow();
   if (!error_occurred_) ResumeTiming();
 }
 
@@ -247,10 +745,44 @@ void State::FinishKeepRunning() {
   BM_CHECK(started_ && (!finished_ || error_occurred_));
   if (!error_occurred_) {
     PauseTiming();
+    // Only now, outside of the measured region, turn what the perf counters
+    // accumulated over all the timed intervals into named counters.
+    if (perf_counters_measurement_) {
+      for (const auto& measurement :
+           perf_counters_measurement_->GetMeasurements()) {
+        counters[measurement.name] =
+            Counter(measurement.value, Counter::kAvgIterations);
+        if (perf_counters_measurement_->IsMultiplexed()) {
+          counters[measurement.name + ".running_fraction"] =
+              Counter(measurement.running_fraction, Counter::kAvgThreads);
+        }
+      }
+    }
+    manager_->GetThreadRegions(thread_index_)
+        .AddCounters(perf_counters_measurement_, &counters);
   }
-  // Total iterations has now wrapped around past 0. Fix this.
-  total_iterations_ = 0;
+  // The run isn't done until the work of its iterations is. The times of an
+  // erroneous one don't matter.
+  if (async_timer_ != nullptr) {
+    if (error_occurred_) {
+      for (const std::pair<uint64_t, uint64_t>& events : async_in_flight_) {
+        async_timer_->Release(events.first);
+        async_timer_->Release(events.second);
+      }
+      async_in_flight_.clear();
+    } else {
+      ResolveAsyncIterations(async_in_flight_.size());
+    }
+    if (async_started_) async_timer_->Release(async_start_);
+    async_started_ = false;
+  }
+  // Total iterations has now wrapped around past 0. Fix this. If they were
+  // shared, this thread ran only those it took.
+  total_iterations_ =
+      shared_chunk_ != 0 && !error_occurred_ ? max_iterations - shared_taken_
+                                             : 0;
   finished_ = true;
+  manager_->GetThreadResult(thread_index_).loop_end = ChronoClockNow();
   manager_->StartStopBarrier();
 }
 
@@ -265,15 +797,58 @@ void FlushStreams(BenchmarkReporter* reporter) {
   std::flush(reporter->GetErrorStream());
 }
 
+// Whether the reporter is passed each repetition as soon as it completes,
+// rather than all of them once the benchmark is done.
+bool StreamsRepetitions(const BenchmarkReporter* reporter,
+                        bool aggregates_only) {
+  return reporter && !aggregates_only && reporter->StreamsRepetitions();
+}
+
+// Count the time since 'start' as the reporting of the instance 'name', for
+// --benchmark_harness_stats.
+void AddReportingTime(const std::string& name, double start) {
+  if (HarnessStats* stats = GetHarnessStats())
+    stats->Add(name, HarnessStats::kReporting, ChronoClockNow() - start);
+}
+
+// Reports one of the repetitions of 'run_results' in the display and file
+// reporters that stream them.
+void ReportRepetition(BenchmarkReporter* display_reporter,
+                      BenchmarkReporter* file_reporter,
+                      const RunResults& run_results,
+                      const BenchmarkReporter::Run& run) {
+  TraceScope trace("reporter", "report repetition");
+  const double start = ChronoClockNow();
+  if (StreamsRepetitions(display_reporter,
+                         run_results.display_report_aggregates_only)) {
+    display_reporter->ReportRepetition(run);
+    FlushStreams(display_reporter);
+  }
+  if (StreamsRepetitions(file_reporter,
+                         run_results.file_report_aggregates_only)) {
+    file_reporter->ReportRepetition(run);
+    FlushStreams(file_reporter);
+  }
+  if (LiveMetrics* live_metrics = GetLiveMetrics()) {
+    live_metrics->ReportRepetition(run);
+  }
+  AddReportingTime(run.run_name.str(), start);
+}
+
 // Reports in both display and file reporters.
 void Report(BenchmarkReporter* display_reporter,
             BenchmarkReporter* file_reporter, const RunResults& run_results) {
+  TraceScope trace("reporter", "report");
+  const double start = ChronoClockNow();
   auto report_one = [](BenchmarkReporter* reporter, bool aggregates_only,
                        const RunResults& results) {
     assert(reporter);
+    // The reporters that stream the repetitions have already seen them.
+    const bool streamed = StreamsRepetitions(reporter, aggregates_only);
     // If there are no aggregates, do output non-aggregates.
     aggregates_only &= !results.aggregates_only.empty();
-    if (!aggregates_only) reporter->ReportRuns(results.non_aggregates);
+    if (!aggregates_only && !streamed)
+      reporter->ReportRuns(results.non_aggregates);
     if (!results.aggregates_only.empty())
       reporter->ReportRuns(results.aggregates_only);
   };
@@ -283,9 +858,388 @@ void Report(BenchmarkReporter* display_reporter,
   if (file_reporter)
     report_one(file_reporter, run_results.file_report_aggregates_only,
                run_results);
+  if (LiveMetrics* live_metrics = GetLiveMetrics())
+    report_one(live_metrics, false, run_results);
 
   FlushStreams(display_reporter);
   FlushStreams(file_reporter);
+  const std::vector<BenchmarkReporter::Run>& runs =
+      run_results.non_aggregates.empty() ? run_results.aggregates_only
+                                         : run_results.non_aggregates;
+  if (!runs.empty()) AddReportingTime(runs[0].run_name.str(), start);
+}
+
+// How many results can wait for the thread of
+// --benchmark_background_reporting before the benchmarks wait for it.
+constexpr size_t kReportingQueueCapacity = 64;
+
+// The most spans --benchmark_trace_out keeps, of about a hundred bytes each,
+// and the most timed stretches between the pauses of each thread of a run.
+constexpr size_t kMaxTraceEvents = 1 << 20;
+constexpr int kMaxTracedTimedPerRun = 100;
+
+// Reports the repetition 'run' of 'run_results' as ReportRepetition() does,
+// but on the 'reporting_thread' if non-null.
+void ReportRepetition(ReportingThread* reporting_thread,
+                      BenchmarkReporter* display_reporter,
+                      BenchmarkReporter* file_reporter,
+                      const RunResults& run_results,
+                      const BenchmarkReporter::Run& run) {
+  if (reporting_thread != nullptr) {
+    reporting_thread->PostRepetition(run_results, run);
+    return;
+  }
+  ReportRepetition(display_reporter, file_reporter, run_results, run);
+}
+
+// Reports 'run_results' as Report() does, but on the 'reporting_thread' if
+// non-null.
+void Report(ReportingThread* reporting_thread,
+            BenchmarkReporter* display_reporter,
+            BenchmarkReporter* file_reporter, const RunResults& run_results) {
+  if (reporting_thread != nullptr) {
+    reporting_thread->PostResults(run_results);
+    return;
+  }
+  Report(display_reporter, file_reporter, run_results);
+}
+
+// Caches the results of 'instance', if there is a 'cache'.
+void CacheResults(const ResultCache* cache, const BenchmarkInstance& instance,
+                  const RunResults& results) {
+  if (cache != nullptr && !cache->Store(instance, results)) {
+    std::cerr << "Could not cache the results of " << instance.name().str()
+              << "\n";
+  }
+}
+
+// Does one repetition of 'runner', after scrubbing what the one before left
+// in the caches and the allocator, if that was of a cache-heavy instance and
+// this isn't, see --benchmark_interference_file. '*last_cache_heavy' is
+// whether the repetition before was, and is updated; if null, the
+// repetitions are not separated.
+void DoSeparatedRepetition(BenchmarkRunner* runner, bool* last_cache_heavy) {
+  if (last_cache_heavy == nullptr) {
+    runner->DoOneRepetition();
+    return;
+  }
+  if (*last_cache_heavy && !runner->IsCacheHeavy()) {
+    TraceScope trace("runner", "scrub");
+    ScrubCachesAndAllocator();
+  }
+  runner->DoOneRepetition();
+  *last_cache_heavy = runner->IsCacheHeavy();
+}
+
+// The repetitions 'runner' has left to do.
+int RepeatsRemaining(const BenchmarkRunner& runner) {
+  return runner.GetNumRepeats() - runner.GetNumRepetitionsDone();
+}
+
+// The 'runners' that have repetitions left, in their order, each alone but
+// for the two instances of an A/B pair that have as many left, which are
+// together.
+std::vector<std::vector<BenchmarkRunner*> > RepetitionUnits(
+    const std::vector<BenchmarkRunner*>& runners) {
+  std::vector<std::vector<BenchmarkRunner*> > units;
+  for (size_t i = 0; i < runners.size(); ++i) {
+    BenchmarkRunner* runner = runners[i];
+    if (!runner->HasRepeatsRemaining()) continue;
+    if (runner->GetBenchmarkInstance().ab_role() == kABBaseline &&
+        i + 1 < runners.size() &&
+        runners[i + 1]->GetBenchmarkInstance().ab_role() == kABContender &&
+        RepeatsRemaining(*runners[i + 1]) == RepeatsRemaining(*runner)) {
+      units.push_back({runner, runners[++i]});
+      continue;
+    }
+    units.push_back(std::vector<BenchmarkRunner*>(1, runner));
+  }
+  return units;
+}
+
+// Runs all the repetitions of the 'runners', interleaved at random if asked
+// to, and calls 'on_repetition' with the runner after each of them. The
+// repetitions of the two instances of an A/B pair are run in pairs, in a
+// random order but for the last pair, of which the baseline's runs first so
+// that it is also reported first. The repetitions are separated as
+// DoSeparatedRepetition() does with 'last_cache_heavy'.
+template <class Callback>
+void RunRepetitions(const std::vector<BenchmarkRunner*>& runners,
+                    bool* last_cache_heavy, Callback on_repetition) {
+  std::vector<std::vector<BenchmarkRunner*> > repetitions;
+  for (const auto& unit : RepetitionUnits(runners)) {
+    std::fill_n(std::back_inserter(repetitions),
+                RepeatsRemaining(*unit.front()), unit);
+  }
+
+  std::random_device rd;
+  std::mt19937 g(rd());
+  if (absl::GetFlag(FLAGS_benchmark_enable_random_interleaving)) {
+    std::shuffle(repetitions.begin(), repetitions.end(), g);
+  }
+
+  std::map<BenchmarkRunner*, int> pairs_remaining;
+  for (const auto& repetition : repetitions) {
+    if (repetition.size() == 2) ++pairs_remaining[repetition.front()];
+  }
+  for (std::vector<BenchmarkRunner*>& repetition : repetitions) {
+    if (repetition.size() == 2 && --pairs_remaining[repetition.front()] > 0 &&
+        std::bernoulli_distribution(0.5)(g)) {
+      std::swap(repetition[0], repetition[1]);
+    }
+    for (BenchmarkRunner* runner : repetition) {
+      DoSeparatedRepetition(runner, last_cache_heavy);
+      on_repetition(runner);
+    }
+  }
+}
+
+// Runs the repetitions of the 'runners' as long as each is expected to end
+// by 'deadline', in ChronoClockNow() seconds, for --benchmark_time_budget:
+// one of each first, by their priority, and then more of those that have
+// any left, by their priority and then how much their times vary so far,
+// round after round. Those that could not do all of theirs are stopped, with
+// the aggregates of what they did. Calls 'on_repetition' with the runner
+// after each repetition and 'on_done' once it has no more, as
+// RunRepetitions() does A/B pairs and separates the repetitions.
+template <class Callback, class Done>
+void RunWithinBudget(const std::vector<BenchmarkRunner*>& runners,
+                     double deadline, bool* last_cache_heavy,
+                     Callback on_repetition, Done on_done) {
+  typedef std::vector<BenchmarkRunner*> Unit;
+  std::vector<Unit> units = RepetitionUnits(runners);
+  std::random_device rd;
+  std::mt19937 g(rd());
+  if (absl::GetFlag(FLAGS_benchmark_enable_random_interleaving)) {
+    std::shuffle(units.begin(), units.end(), g);
+  }
+
+  auto priority = [](const Unit& unit) {
+    int highest = unit.front()->GetBenchmarkInstance().priority();
+    for (const BenchmarkRunner* runner : unit)
+      highest = std::max(highest, runner->GetBenchmarkInstance().priority());
+    return highest;
+  };
+  auto cv = [](const Unit& unit) {
+    double highest = 0;
+    for (const BenchmarkRunner* runner : unit)
+      highest = std::max(highest, runner->GetRepetitionsCV());
+    return highest;
+  };
+  // Whether the next repetition of 'unit' should end by the deadline, if it
+  // takes as long as its last one.
+  auto fits = [deadline](const Unit& unit) {
+    double seconds = 0;
+    for (const BenchmarkRunner* runner : unit)
+      seconds += runner->GetLastRepetitionSeconds();
+    return ChronoClockNow() + seconds <= deadline;
+  };
+  auto run = [&](const Unit& unit) {
+    Unit order = unit;
+    if (order.size() == 2 && RepeatsRemaining(*order.front()) > 1 &&
+        std::bernoulli_distribution(0.5)(g)) {
+      std::swap(order[0], order[1]);
+    }
+    for (BenchmarkRunner* runner : order) {
+      DoSeparatedRepetition(runner, last_cache_heavy);
+      on_repetition(runner);
+      if (!runner->HasRepeatsRemaining()) on_done(runner);
+    }
+  };
+
+  std::stable_sort(units.begin(), units.end(),
+                   [&priority](const Unit& a, const Unit& b) {
+                     return priority(a) > priority(b);
+                   });
+  for (const Unit& unit : units) {
+    if (fits(unit)) run(unit);
+  }
+  for (bool ran = true; ran;) {
+    std::vector<Unit> round;
+    for (const Unit& unit : units) {
+      if (unit.front()->HasRepeatsRemaining() &&
+          unit.front()->GetNumRepetitionsDone() > 0)
+        round.push_back(unit);
+    }
+    std::stable_sort(round.begin(), round.end(),
+                     [&](const Unit& a, const Unit& b) {
+                       if (priority(a) != priority(b))
+                         return priority(a) > priority(b);
+                       return cv(a) > cv(b);
+                     });
+    ran = false;
+    for (const Unit& unit : round) {
+      if (!fits(unit)) continue;
+      run(unit);
+      ran = true;
+    }
+  }
+
+  // One at a time, so that the last of a family to stop is the one that
+  // reports the aggregates of the family.
+  for (const Unit& unit : units) {
+    for (BenchmarkRunner* runner : unit) {
+      if (!runner->HasRepeatsRemaining()) continue;
+      const bool ran_none = runner->GetNumRepetitionsDone() == 0;
+      runner->StopRepeating("skipped: the time budget ran out");
+      if (ran_none) on_repetition(runner);
+      on_done(runner);
+    }
+  }
+}
+
+// If all the runs of the family of 'runner' are done, adds the complexity, the
+// thread scaling, the counter matrix and the A/B comparisons of the family,
+// if asked for, to 'run_results' and returns true.
+bool AddComplexity(const BenchmarkRunner& runner, RunResults* run_results) {
+  const auto* reports_for_family = runner.GetReportsForFamily();
+  if (reports_for_family == nullptr ||
+      reports_for_family->num_runs_done != reports_for_family->num_runs_total)
+    return false;
+  const BenchmarkInstance& b = runner.GetBenchmarkInstance();
+  if (b.complexity() != oNone) {
+    auto additional_run_stats = ComputeBigO(reports_for_family->Runs);
+    run_results->aggregates_only.insert(run_results->aggregates_only.end(),
+                                        additional_run_stats.begin(),
+                                        additional_run_stats.end());
+  }
+  if (!b.complexity_terms().empty()) {
+    auto additional_run_stats = ComputeBigO(
+        reports_for_family->Runs, b.complexity_terms(), b.complexity_model());
+    run_results->aggregates_only.insert(run_results->aggregates_only.end(),
+                                        additional_run_stats.begin(),
+                                        additional_run_stats.end());
+  }
+  if (b.thread_scaling()) {
+    auto scaling = ComputeThreadScaling(reports_for_family->Runs);
+    run_results->aggregates_only.insert(run_results->aggregates_only.end(),
+                                        scaling.begin(), scaling.end());
+  }
+  if (!b.matrix_counter().empty()) {
+    auto matrix = ComputeCounterMatrix(reports_for_family->Runs,
+                                       b.matrix_counter());
+    run_results->aggregates_only.insert(run_results->aggregates_only.end(),
+                                        matrix.begin(), matrix.end());
+  }
+  if (b.ab_role() != kNotAB) {
+    auto comparisons = ComputeABComparison(reports_for_family->Runs);
+    run_results->aggregates_only.insert(run_results->aggregates_only.end(),
+                                        comparisons.begin(), comparisons.end());
+  }
+  return true;
+}
+
+// The number of cpus sharing the last-level cache, 0 if unknown.
+int LastLevelCacheSharing() {
+  int level = 0;
+  int num_sharing = 0;
+  for (const auto& cache : internal::CPUCaches()) {
+    if (cache.level > level) {
+      level = cache.level;
+      num_sharing = cache.num_sharing;
+    }
+  }
+  return num_sharing;
+}
+
+// Runs each of the 'families' (all of its instances, one after the other) as
+// a job on one of the 'partitions' of the cpus, concurrently with the others.
+// The families are reported in order, as soon as they and all the families
+// before them are done, on the 'reporting_thread' if non-null.
+void RunFamiliesConcurrently(
+    const std::vector<std::vector<BenchmarkRunner*> >& families,
+    const std::vector<std::vector<int> >& partitions,
+    ReportingThread* reporting_thread, BenchmarkReporter* display_reporter,
+    BenchmarkReporter* file_reporter, const ResultCache* cache) {
+  struct FamilyResults {
+    FamilyResults() : done(false) {}
+    bool done;
+    std::vector<RunResults> run_results;
+  };
+  std::vector<FamilyResults> results(families.size());
+  Mutex results_mutex;
+  Condition results_cond;
+  std::atomic<size_t> next_family(0);
+
+  std::vector<std::thread> jobs;
+  for (size_t j = 0; j < partitions.size() && j < families.size(); ++j) {
+    const std::vector<int>& cpus = partitions[j];
+    jobs.emplace_back([&, cpus]() {
+      // The workers of the pool are created from this thread, so they are
+      // restricted to the same cpus.
+      SetCurrentThreadAffinity(cpus, nullptr);
+      ThreadPool pool;
+      for (size_t f = next_family++; f < families.size(); f = next_family++) {
+        for (BenchmarkRunner* runner : families[f])
+          runner->SetThreadPool(&pool);
+        // Scrubbing the caches would disturb the other jobs, which share
+        // them, so the repetitions are not separated.
+        RunRepetitions(families[f], nullptr, [](BenchmarkRunner*) {});
+
+        std::vector<RunResults> run_results;
+        for (BenchmarkRunner* runner : families[f]) {
+          run_results.push_back(runner->GetResults());
+          runner->SetThreadPool(nullptr);
+        }
+        AddComplexity(*families[f].back(), &run_results.back());
+        {
+          MutexLock l(results_mutex);
+          results[f].run_results = std::move(run_results);
+          results[f].done = true;
+        }
+        results_cond.notify_all();
+      }
+    });
+  }
+
+  for (size_t f = 0; f < families.size(); ++f) {
+    std::vector<RunResults> run_results;
+    {
+      MutexLock l(results_mutex);
+      results_cond.wait(l.native_handle(),
+                        [&results, f]() { return results[f].done; });
+      run_results = std::move(results[f].run_results);
+    }
+    for (size_t i = 0; i < run_results.size(); ++i) {
+      const RunResults& instance_results = run_results[i];
+      for (const BenchmarkReporter::Run& run : instance_results.non_aggregates)
+        ReportRepetition(reporting_thread, display_reporter, file_reporter,
+                         instance_results, run);
+      Report(reporting_thread, display_reporter, file_reporter,
+             instance_results);
+      CacheResults(cache, families[f][i]->GetBenchmarkInstance(),
+                   instance_results);
+    }
+  }
+  for (std::thread& job : jobs) job.join();
+}
+
+// Runs the 'benchmarks' as the leader of --benchmark_coordinator asks, until
+// it is done, without reporting them.
+void RunForLeader(const std::vector<BenchmarkInstance>& benchmarks,
+                  Coordinator* coordinator) {
+  std::map<std::string, size_t> indices;
+  for (size_t i = 0; i < benchmarks.size(); ++i)
+    indices[benchmarks[i].name().str()] = i;
+  // Made the first time the leader asks for them, and kept for the next
+  // runs.
+  std::map<size_t, std::unique_ptr<BenchmarkRunner> > runners;
+  std::string name;
+  IterationCount iters;
+  int64_t repetition_index;
+  while (coordinator->NextRun(&name, &iters, &repetition_index)) {
+    auto index = indices.find(name);
+    if (index == indices.end()) {
+      coordinator->RefuseRun("no benchmark named " + name);
+      continue;
+    }
+    std::unique_ptr<BenchmarkRunner>& runner = runners[index->second];
+    if (!runner) {
+      runner.reset(new BenchmarkRunner(benchmarks[index->second], nullptr));
+    }
+    runner->RunForCoordinator(iters, repetition_index);
+  }
+  for (const BenchmarkInstance& benchmark : benchmarks) benchmark.Finish();
 }
 
 void RunBenchmarks(const std::vector<BenchmarkInstance>& benchmarks,
@@ -293,14 +1247,41 @@ void RunBenchmarks(const std::vector<BenchmarkInstance>& benchmarks,
                    BenchmarkReporter* file_reporter) {
   // Note the file_reporter can be null.
   BM_CHECK(display_reporter != nullptr);
+  // What --benchmark_time_budget counts from.
+  const double start = ChronoClockNow();
 
   // Determine the width of the name field using a minimum width of 10.
   bool might_have_aggregates = absl::GetFlag(FLAGS_benchmark_repetitions) > 1;
   size_t name_field_width = 10;
   size_t stat_field_width = 0;
+  int64_t num_repetitions = 0;
   for (const BenchmarkInstance& benchmark : benchmarks) {
+    num_repetitions += benchmark.repetitions() != 0
+                           ? benchmark.repetitions()
+                           : absl::GetFlag(FLAGS_benchmark_repetitions);
     name_field_width =
         std::max<size_t>(name_field_width, benchmark.name().str().size());
+    if (benchmark.tuned()) {
+      // Reported with the args it is tuned to, which are at most as wide as
+      // the widest value of each.
+      std::vector<int64_t> widest;
+      for (const auto& values : benchmark.tune_space()) {
+        widest.push_back(*std::max_element(
+            values.begin(), values.end(), [](int64_t a, int64_t b) {
+              return std::to_string(a).size() < std::to_string(b).size();
+            }));
+      }
+      name_field_width = std::max<size_t>(
+          name_field_width,
+          benchmark.WithArgs(widest, 0, 1, 0).name().str().size());
+    }
+    // The roles of the thread groups have lines of their own, under the run.
+    for (const auto& group : benchmark.thread_groups()) {
+      name_field_width = std::max<size_t>(
+          name_field_width,
+          StrFormat("  %s (threads:%d)", group.first.c_str(), group.second)
+              .size());
+    }
     might_have_aggregates |= benchmark.repetitions() > 1;
 
     for (const auto& Stat : benchmark.statistics())
@@ -311,6 +1292,7 @@ void RunBenchmarks(const std::vector<BenchmarkInstance>& benchmarks,
   // Print header here
   BenchmarkReporter::Context context;
   context.name_field_width = name_field_width;
+  context.num_repetitions = num_repetitions;
 
   // Keep track of running times of all instances of each benchmark family.
   std::map<int /*family_index*/, BenchmarkReporter::PerFamilyRunReports>
@@ -321,64 +1303,262 @@ void RunBenchmarks(const std::vector<BenchmarkInstance>& benchmarks,
     FlushStreams(display_reporter);
     FlushStreams(file_reporter);
 
-    size_t num_repetitions_total = 0;
-
     std::vector<internal::BenchmarkRunner> runners;
     runners.reserve(benchmarks.size());
     for (const BenchmarkInstance& benchmark : benchmarks) {
       BenchmarkReporter::PerFamilyRunReports* reports_for_family = nullptr;
-      if (benchmark.complexity() != oNone)
+      if (benchmark.complexity() != oNone ||
+          !benchmark.complexity_terms().empty() ||
+          benchmark.thread_scaling() || !benchmark.matrix_counter().empty() ||
+          benchmark.ab_role() != kNotAB)
         reports_for_family = &per_family_reports[benchmark.family_index()];
 
       runners.emplace_back(benchmark, reports_for_family);
       int num_repeats_of_this_instance = runners.back().GetNumRepeats();
-      num_repetitions_total += num_repeats_of_this_instance;
       if (reports_for_family)
         reports_for_family->num_runs_total += num_repeats_of_this_instance;
     }
     assert(runners.size() == benchmarks.size() && "Unexpected runner count.");
 
-    std::vector<size_t> repetition_indices;
-    repetition_indices.reserve(num_repetitions_total);
-    for (size_t runner_index = 0, num_runners = runners.size();
-         runner_index != num_runners; ++runner_index) {
-      const internal::BenchmarkRunner& runner = runners[runner_index];
-      std::fill_n(std::back_inserter(repetition_indices),
-                  runner.GetNumRepeats(), runner_index);
+    const std::string hint_file =
+        absl::GetFlag(FLAGS_benchmark_iterations_hint_file);
+    std::map<std::string, IterationCount> hints;
+    if (!hint_file.empty() && !ReadIterationCounts(hint_file, &hints)) {
+      std::cerr << "Could not read the iteration counts from '" << hint_file
+                << "', the benchmarks ramp up as usual\n";
+    }
+    for (size_t i = 0; i < benchmarks.size(); ++i) {
+      auto hint = hints.find(benchmarks[i].name().str());
+      if (hint != hints.end()) runners[i].SetIterationsHint(hint->second);
     }
-    assert(repetition_indices.size() == num_repetitions_total &&
-           "Unexpected number of repetition indexes.");
 
-    if (absl::GetFlag(FLAGS_benchmark_enable_random_interleaving)) {
-      std::random_device rd;
-      std::mt19937 g(rd());
-      std::shuffle(repetition_indices.begin(), repetition_indices.end(), g);
+    const std::string interference_file =
+        absl::GetFlag(FLAGS_benchmark_interference_file);
+    std::set<std::string> cache_heavy;
+    if (!interference_file.empty() &&
+        !ReadCacheHeavyInstances(interference_file, LastLevelCacheBytes(),
+                                 &cache_heavy)) {
+      std::cerr << "Could not read the runs of '" << interference_file
+                << "', the benchmarks run without being separated\n";
+    }
+    for (size_t i = 0; i < benchmarks.size(); ++i) {
+      runners[i].SetCacheHeavy(
+          cache_heavy.count(benchmarks[i].name().str()) != 0);
+    }
+    // The frequency drops are from the runs of this call only.
+    HighestCpuFrequency highest_cpu_frequency;
+    for (BenchmarkRunner& runner : runners)
+      runner.SetHighestCpuFrequency(&highest_cpu_frequency);
+    // Whether the last repetition run alone was of a cache-heavy instance.
+    bool last_cache_heavy = false;
+
+    std::unique_ptr<ResultCache> cache;
+    std::vector<RunResults> cached_results(benchmarks.size());
+    std::vector<bool> cached(benchmarks.size(), false);
+    const std::string cache_dir = absl::GetFlag(FLAGS_benchmark_cache_dir);
+    // The benchmarks that are profiled have to be run again, and the results
+    // of the coordinated ones depend on the workers.
+    if (!cache_dir.empty() && absl::GetFlag(FLAGS_benchmark_profile).empty() &&
+        GetCoordinator() == nullptr) {
+      std::string fingerprint =
+          absl::GetFlag(FLAGS_benchmark_cache_fingerprint);
+      if (fingerprint.empty()) fingerprint = ExecutableFingerprint();
+      cache.reset(new ResultCache(cache_dir, fingerprint));
+      for (size_t i = 0; i < benchmarks.size(); ++i)
+        cached[i] = cache->Load(benchmarks[i], &cached_results[i]);
     }
 
-    for (size_t repetition_index : repetition_indices) {
-      internal::BenchmarkRunner& runner = runners[repetition_index];
-      runner.DoOneRepetition();
-      if (runner.HasRepeatsRemaining()) continue;
-      // FIXME: report each repetition separately, not all of them in bulk.
+    std::unique_ptr<Checkpoint> checkpoint;
+    const std::string checkpoint_path =
+        absl::GetFlag(FLAGS_benchmark_checkpoint);
+    if (!checkpoint_path.empty()) {
+      std::string fingerprint =
+          absl::GetFlag(FLAGS_benchmark_cache_fingerprint);
+      if (fingerprint.empty()) fingerprint = ExecutableFingerprint();
+      checkpoint.reset(new Checkpoint(fingerprint));
+      if (!checkpoint->Open(checkpoint_path)) {
+        std::cerr << "Could not write the checkpoint '" << checkpoint_path
+                  << "', the run can't be resumed\n";
+        checkpoint.reset();
+      }
+    }
 
-      RunResults run_results = runner.GetResults();
+    std::unique_ptr<ReportingThread> reporting_thread;
+    if (absl::GetFlag(FLAGS_benchmark_background_reporting)) {
+      std::vector<int> reporting_cpus;
+      ParseCpuList(absl::GetFlag(FLAGS_benchmark_reporting_cpus),
+                   &reporting_cpus);
+      reporting_thread.reset(new ReportingThread(
+          [display_reporter, file_reporter](
+              const RunResults& run_results,
+              const BenchmarkReporter::Run* repetition) {
+            if (repetition != nullptr) {
+              ReportRepetition(display_reporter, file_reporter, run_results,
+                               *repetition);
+            } else {
+              Report(display_reporter, file_reporter, run_results);
+            }
+          },
+          kReportingQueueCapacity, reporting_cpus));
+    }
 
+    // Only between the repetitions run alone, so that the kernels have the
+    // host to themselves.
+    const double calibration_interval =
+        absl::GetFlag(FLAGS_benchmark_calibration_interval);
+    auto report_repetition = [&](BenchmarkRunner* runner) {
+      RecalibrateIfDue(calibration_interval);
+      const RunResults& partial_results = runner->GetPartialResults();
+      const BenchmarkReporter::Run& run = partial_results.non_aggregates.back();
+      // Not the repetitions that the time budget left out.
+      if (checkpoint && !runner->StoppedRepeating() &&
+          !runner->GetBenchmarkInstance().tuned()) {
+        checkpoint->Add(runner->GetBenchmarkInstance(), run,
+                        runner->GetIterations());
+      }
+      ReportRepetition(reporting_thread.get(), display_reporter,
+                       file_reporter, partial_results, run);
+    };
+    auto finish = [&](BenchmarkRunner* runner) {
+      RunResults run_results = runner->GetResults();
       // Maybe calculate complexity report
-      if (const auto* reports_for_family = runner.GetReportsForFamily()) {
-        if (reports_for_family->num_runs_done ==
-            reports_for_family->num_runs_total) {
-          auto additional_run_stats = ComputeBigO(reports_for_family->Runs);
-          run_results.aggregates_only.insert(run_results.aggregates_only.end(),
-                                             additional_run_stats.begin(),
-                                             additional_run_stats.end());
-          per_family_reports.erase(
-              (int)reports_for_family->Runs.front().family_index);
+      if (AddComplexity(*runner, &run_results))
+        per_family_reports.erase(runner->GetBenchmarkInstance().family_index());
+      Report(reporting_thread.get(), display_reporter, file_reporter,
+             run_results);
+      // Those cut short by the time budget are run in full the next time.
+      if (!runner->StoppedRepeating())
+        CacheResults(cache.get(), runner->GetBenchmarkInstance(), run_results);
+    };
+    auto run_alone = [&](const std::vector<BenchmarkRunner*>& some_runners) {
+      RunRepetitions(some_runners, &last_cache_heavy,
+                     [&](BenchmarkRunner* runner) {
+                       report_repetition(runner);
+                       if (!runner->HasRepeatsRemaining()) finish(runner);
+                     });
+    };
+
+    std::vector<std::vector<int> > partitions;
+    const int num_jobs = absl::GetFlag(FLAGS_benchmark_parallel_jobs);
+    // Forking is only safe while this is the only thread of the process.
+    if (num_jobs > 1 && memory_manager == nullptr && !checkpoint &&
+        GetCoordinator() == nullptr &&
+        absl::GetFlag(FLAGS_benchmark_isolation) != "process") {
+      partitions =
+          PartitionCpus(GetAllowedCpus(), num_jobs, LastLevelCacheSharing());
+    }
+    // Runs the instances from 'first' to 'last'.
+    auto run_some = [&](size_t first, size_t last) {
+      if (partitions.size() < 2) {
+        std::vector<BenchmarkRunner*> some_runners;
+        for (size_t i = first; i < last; ++i)
+          some_runners.push_back(&runners[i]);
+        run_alone(some_runners);
+        return;
+      }
+      // With parallel jobs, the families all of whose instances can run
+      // alongside others are run concurrently, each on a partition of the
+      // cpus. The other families are run alone, once the families before them
+      // are done, so that everything is still reported in order.
+      std::vector<std::vector<BenchmarkRunner*> > concurrent_families;
+      std::vector<int> concurrent_family_indices;
+      auto run_concurrently = [&]() {
+        RunFamiliesConcurrently(concurrent_families, partitions,
+                                reporting_thread.get(), display_reporter,
+                                file_reporter, cache.get());
+        for (int family_index : concurrent_family_indices)
+          per_family_reports.erase(family_index);
+        concurrent_families.clear();
+        concurrent_family_indices.clear();
+      };
+      size_t cpus_per_job = partitions[0].size();
+      for (const auto& cpus : partitions)
+        cpus_per_job = std::min(cpus_per_job, cpus.size());
+      for (size_t begin = first, end = first; begin < last; begin = end) {
+        // The instances of a family are next to each other.
+        const int family_index = benchmarks[begin].family_index();
+        std::vector<BenchmarkRunner*> family;
+        bool concurrent = true;
+        for (end = begin;
+             end < last && benchmarks[end].family_index() == family_index;
+             ++end) {
+          family.push_back(&runners[end]);
+          concurrent =
+              concurrent && runners[end].CanRunConcurrently(cpus_per_job);
+        }
+        if (concurrent) {
+          concurrent_families.push_back(family);
+          concurrent_family_indices.push_back(family_index);
+          continue;
         }
+        run_concurrently();
+        run_alone(family);
       }
-
-      Report(display_reporter, file_reporter, run_results);
+      run_concurrently();
+    };
+
+    // With a time budget, the instances that are neither cached nor tuned are
+    // all scheduled together, once the others are done.
+    const double time_budget = absl::GetFlag(FLAGS_benchmark_time_budget);
+    std::vector<BenchmarkRunner*> budgeted;
+
+    // The cached and the tuned instances are reported in their place among
+    // the others, which are run in the stretches between them.
+    for (size_t first = 0, last = 0; first < runners.size(); first = last) {
+      if (benchmarks[first].tuned()) {
+        const BenchmarkInstance best = TuneInstance(benchmarks[first]);
+        BenchmarkRunner runner(best, nullptr);
+        runner.SetHighestCpuFrequency(&highest_cpu_frequency);
+        run_alone({&runner});
+        last = first + 1;
+        continue;
+      }
+      if (cached[first]) {
+        const RunResults& run_results = cached_results[first];
+        for (const BenchmarkReporter::Run& run : run_results.non_aggregates)
+          ReportRepetition(reporting_thread.get(), display_reporter,
+                           file_reporter, run_results, run);
+        Report(reporting_thread.get(), display_reporter, file_reporter,
+               run_results);
+        last = first + 1;
+        continue;
+      }
+      for (last = first; last < runners.size() && !cached[last] &&
+                         !benchmarks[last].tuned();
+           ++last) {
+      }
+      // The repetitions kept in the checkpoint are reported first, and the
+      // instances that have none left are done. One at a time, so that the
+      // last of a family to be done is the one that reports the aggregates
+      // of the family.
+      for (size_t i = first; checkpoint && i < last; ++i) {
+        for (const CheckpointedRepetition& repetition :
+             checkpoint->Take(benchmarks[i])) {
+          if (!runners[i].HasRepeatsRemaining()) break;
+          runners[i].RestoreRepetition(repetition.run, repetition.iters);
+          const RunResults& restored = runners[i].GetPartialResults();
+          ReportRepetition(reporting_thread.get(), display_reporter,
+                           file_reporter, restored,
+                           restored.non_aggregates.back());
+        }
+        if (runners[i].GetNumRepetitionsDone() > 0 &&
+            !runners[i].HasRepeatsRemaining())
+          finish(&runners[i]);
+      }
+      if (time_budget > 0) {
+        for (size_t i = first; i < last; ++i) budgeted.push_back(&runners[i]);
+        continue;
+      }
+      run_some(first, last);
     }
+    if (!budgeted.empty())
+      RunWithinBudget(budgeted, start + time_budget, &last_cache_heavy,
+                      report_repetition, finish);
+    // Everything is reported before the reporters are finalized.
+    reporting_thread.reset();
   }
+  // Free what the benchmarks kept between their runs.
+  for (const BenchmarkInstance& benchmark : benchmarks) benchmark.Finish();
   display_reporter->Finalize();
   if (file_reporter) file_reporter->Finalize();
   FlushStreams(display_reporter);
@@ -401,6 +1581,12 @@ std::unique_ptr<BenchmarkReporter> CreateReporter(
     return PtrType(new JSONReporter);
   } else if (name == "csv") {
     return PtrType(new CSVReporter);
+  } else if (name == "table") {
+    return PtrType(new TableReporter);
+  } else if (name == "binary") {
+    return PtrType(new BinaryReporter);
+  } else if (name == "folded") {
+    return PtrType(new FoldedReporter);
   } else {
     std::cerr << "Unexpected format: '" << name << "'\n";
     std::exit(1);
@@ -438,6 +1624,9 @@ ConsoleReporter::OutputOptions GetOutputOptions(bool force_no_color) {
   } else {
     output_opts &= ~ConsoleReporter::OO_Tabular;
   }
+  if (absl::GetFlag(FLAGS_benchmark_progress)) {
+    output_opts |= ConsoleReporter::OO_Progress;
+  }
   return static_cast<ConsoleReporter::OutputOptions>(output_opts);
 }
 
@@ -451,9 +1640,89 @@ size_t RunSpecifiedBenchmarks(BenchmarkReporter* display_reporter) {
   return RunSpecifiedBenchmarks(display_reporter, nullptr);
 }
 
-size_t RunSpecifiedBenchmarks(BenchmarkReporter* display_reporter,
-                              BenchmarkReporter* file_reporter) {
-  std::string spec = absl::GetFlag(FLAGS_benchmark_filter);
+namespace {
+
+// Keeps the runs it is passed, in order, and prints nothing.
+class RunCollector : public BenchmarkReporter {
+ public:
+  bool ReportContext(const Context&) BENCHMARK_OVERRIDE { return true; }
+  void ReportRuns(const std::vector<Run>& runs) BENCHMARK_OVERRIDE {
+    runs_.insert(runs_.end(), runs.begin(), runs.end());
+  }
+
+  std::vector<Run> runs_;
+};
+
+// Lock the memory with --benchmark_lock_memory, and check that the threads can
+// run at --benchmark_realtime_priority, once per process. What was applied is
+// recorded in the context, as 'memory_locked' and 'realtime_priority'.
+void ApplyIsolationSettings(std::ostream& err) {
+  static bool applied = false;
+  if (applied) return;
+  applied = true;
+  std::string error;
+  if (absl::GetFlag(FLAGS_benchmark_lock_memory)) {
+    const bool locked = internal::LockProcessMemory(&error);
+    if (!locked) err << "Could not lock the memory: " << error << "\n";
+    AddCustomContext("memory_locked", locked ? "true" : "false");
+  }
+  const int priority = absl::GetFlag(FLAGS_benchmark_realtime_priority);
+  if (priority > 0) {
+    // On this thread, which runs the first thread of every benchmark.
+    internal::ThreadScheduling previous;
+    const bool allowed =
+        internal::SetCurrentThreadRealtime(priority, &previous, &error);
+    if (allowed) {
+      internal::RestoreCurrentThreadScheduling(previous);
+    } else {
+      err << "Could not run the benchmarks at real-time priority " << priority
+          << ": " << error << "\n";
+    }
+    AddCustomContext("realtime_priority",
+                     allowed ? std::to_string(priority) : "0");
+  }
+}
+
+// Say which domains --benchmark_energy measures, or why it can't, once per
+// process, and record them in the context as 'energy_domains'.
+void CheckEnergyMeter(std::ostream& err) {
+  static bool checked = false;
+  if (checked || !absl::GetFlag(FLAGS_benchmark_energy)) return;
+  checked = true;
+  const internal::EnergyMeter& meter = internal::GetEnergyMeter();
+  if (meter.domains().empty()) {
+    err << "Could not measure the energy: " << meter.error() << "\n";
+    AddCustomContext("energy_domains", "unsupported: " + meter.error());
+    return;
+  }
+  std::string domains;
+  for (const std::string& domain : meter.domains())
+    domains += (domains.empty() ? "" : ",") + domain;
+  AddCustomContext("energy_domains", domains);
+}
+
+// Time the reference kernels with --benchmark_calibrate, or
+// --benchmark_normalize_time, once per process, and record them in the
+// context.
+void CalibrateHost() {
+  if (!absl::GetFlag(FLAGS_benchmark_calibrate) &&
+      absl::GetFlag(FLAGS_benchmark_normalize_time).empty()) {
+    return;
+  }
+  internal::Calibration calibration;
+  if (internal::GetCalibration(&calibration)) return;
+  internal::Calibrate();
+  internal::GetCalibration(&calibration);
+  AddCustomContext("calibration_alu_ns",
+                   StrFormat("%.4f", calibration.alu_ns));
+  AddCustomContext("calibration_l1_ns", StrFormat("%.4f", calibration.l1_ns));
+  AddCustomContext("calibration_dram_ns",
+                   StrFormat("%.4f", calibration.dram_ns));
+}
+
+size_t RunMatchingBenchmarks(std::string spec,
+                             BenchmarkReporter* display_reporter,
+                             BenchmarkReporter* file_reporter) {
   if (spec.empty() || spec == "all")
     spec = ".";  // Regexp that matches all benchmarks
 
@@ -477,7 +1746,11 @@ size_t RunSpecifiedBenchmarks(BenchmarkReporter* display_reporter,
     std::exit(1);
   }
   if (!fname.empty()) {
-    output_file.open(fname);
+    const std::ios::openmode mode =
+        absl::GetFlag(FLAGS_benchmark_out_format) == "binary"
+            ? std::ios::out | std::ios::binary
+            : std::ios::out;
+    output_file.open(fname, mode);
     if (!output_file.is_open()) {
       Err << "invalid file name: '" << fname << "'" << std::endl;
       std::exit(1);
@@ -492,23 +1765,146 @@ size_t RunSpecifiedBenchmarks(BenchmarkReporter* display_reporter,
   }
 
   std::vector<internal::BenchmarkInstance> benchmarks;
-  if (!FindBenchmarksInternal(spec, &benchmarks, &Err)) return 0;
+  if (!FindBenchmarksInternal(spec, &benchmarks, &Err,
+                              absl::GetFlag(FLAGS_benchmark_tags)))
+    return 0;
 
   if (benchmarks.empty()) {
-    Err << "Failed to match any benchmarks against regex: " << spec << "\n";
+    Err << "Failed to match any benchmarks against regex: " << spec;
+    const std::string tags = absl::GetFlag(FLAGS_benchmark_tags);
+    if (!tags.empty()) Err << " and tags: " << tags;
+    Err << "\n";
     return 0;
   }
 
+  // A shard may get none of the benchmarks, and still reports that.
+  const int shard_count = absl::GetFlag(FLAGS_benchmark_shard_count);
+  if (shard_count > 1) {
+    std::map<std::string, double> costs;
+    const std::string costs_file = absl::GetFlag(FLAGS_benchmark_shard_costs);
+    if (!costs_file.empty() &&
+        !internal::ReadBenchmarkCosts(costs_file, &costs)) {
+      Err << "Could not read the benchmark costs from '" << costs_file
+          << "'\n";
+      std::exit(1);
+    }
+    const int shard_index = absl::GetFlag(FLAGS_benchmark_shard_index);
+    internal::SelectShard(shard_index, shard_count, costs, &benchmarks);
+    // So that the outputs of the shards can be told apart, and merged.
+    AddCustomContext("benchmark_shard",
+                     StrFormat("%d/%d", shard_index, shard_count));
+  }
+
   if (absl::GetFlag(FLAGS_benchmark_list_tests)) {
     for (auto const& benchmark : benchmarks)
       Out << benchmark.name().str() << "\n";
   } else {
+    ProcessMemoryManager process_memory_manager;
+    const bool measure_process_memory =
+        absl::GetFlag(FLAGS_benchmark_process_memory) &&
+        internal::memory_manager == nullptr;
+    if (measure_process_memory) {
+      internal::memory_manager = &process_memory_manager;
+    }
+    ApplyIsolationSettings(Err);
+    internal::Coordinator coordinator;
+    const std::string coordinator_address =
+        absl::GetFlag(FLAGS_benchmark_coordinator);
+    if (!coordinator_address.empty()) {
+      // Which the leader and its workers must agree on.
+      std::string names;
+      for (const internal::BenchmarkInstance& benchmark : benchmarks)
+        names += benchmark.name().str() + "\n";
+      const int num_workers =
+          absl::GetFlag(FLAGS_benchmark_coordinator_workers);
+      std::string error;
+      const bool connected =
+          num_workers > 0
+              ? coordinator.Lead(coordinator_address, num_workers, names,
+                                 &error)
+              : coordinator.Follow(coordinator_address, names, &error);
+      if (!connected) {
+        Err << "Could not coordinate the benchmarks: " << error << "\n";
+        std::exit(1);
+      }
+      internal::SetCoordinator(&coordinator);
+      if (!coordinator.is_leader()) {
+        internal::RunForLeader(benchmarks, &coordinator);
+        internal::SetCoordinator(nullptr);
+        if (measure_process_memory) internal::memory_manager = nullptr;
+        return benchmarks.size();
+      }
+      AddCustomContext("benchmark_processes",
+                       StrFormat("%d", coordinator.num_processes()));
+    }
+    CalibrateHost();
+    CheckEnergyMeter(Err);
+    // Before the benchmarks, which their runs are checked against.
+    if (absl::GetFlag(FLAGS_benchmark_check_measurements))
+      internal::GetMeasurementFloor();
+    internal::LiveMetrics live_metrics;
+    internal::MetricsServer metrics_server(&live_metrics);
+    const std::string metrics_address =
+        absl::GetFlag(FLAGS_benchmark_metrics_address);
+    if (!metrics_address.empty()) {
+      std::string error;
+      if (metrics_server.Start(metrics_address, &error)) {
+        internal::SetLiveMetrics(&live_metrics);
+      } else {
+        Err << "Could not serve the metrics: " << error << "\n";
+      }
+    }
+    const std::string trace_out = absl::GetFlag(FLAGS_benchmark_trace_out);
+    std::unique_ptr<internal::Tracer> tracer;
+    if (!trace_out.empty()) {
+      tracer.reset(new internal::Tracer(internal::kMaxTraceEvents,
+                                          internal::kMaxTracedTimedPerRun));
+      internal::SetTracer(tracer.get());
+    }
+    std::unique_ptr<internal::HarnessStats> harness_stats;
+    if (absl::GetFlag(FLAGS_benchmark_harness_stats)) {
+      harness_stats.reset(new internal::HarnessStats);
+      internal::SetHarnessStats(harness_stats.get());
+    }
+    const double start = ChronoClockNow();
     internal::RunBenchmarks(benchmarks, display_reporter, file_reporter);
+    internal::SetCoordinator(nullptr);
+    internal::SetLiveMetrics(nullptr);
+    if (harness_stats) {
+      internal::SetHarnessStats(nullptr);
+      harness_stats->Print(Err, ChronoClockNow() - start);
+    }
+    if (tracer) {
+      internal::SetTracer(nullptr);
+      std::string error;
+      if (!tracer->Write(trace_out, &error)) {
+        Err << "Could not write the trace: " << error << "\n";
+      }
+    }
+    metrics_server.Stop();
+    if (measure_process_memory) internal::memory_manager = nullptr;
   }
 
   return benchmarks.size();
 }
 
+}  // end namespace
+
+size_t RunSpecifiedBenchmarks(BenchmarkReporter* display_reporter,
+                              BenchmarkReporter* file_reporter) {
+  return RunMatchingBenchmarks(absl::GetFlag(FLAGS_benchmark_filter),
+                               display_reporter, file_reporter);
+}
+
+std::vector<BenchmarkReporter::Run> RunSpecifiedBenchmarks(
+    const std::string& spec) {
+  RunCollector collector;
+  RunMatchingBenchmarks(
+      spec.empty() ? absl::GetFlag(FLAGS_benchmark_filter) : spec, &collector,
+      nullptr);
+  return collector.runs_;
+}
+
 void RegisterMemoryManager(MemoryManager* manager) {
   internal::memory_manager = manager;
 }
@@ -530,17 +1926,65 @@ void PrintUsageAndExit() {
           "benchmark"
           " [--benchmark_list_tests={true|false}]\n"
           "          [--benchmark_filter=<regex>]\n"
+          "          [--benchmark_tags=<tag>,-<tag>,<tag>|<tag>...]\n"
           "          [--benchmark_min_time=<min_time>]\n"
+          "          [--benchmark_min_warmup_time=<min_warmup_time>]\n"
+          "          [--benchmark_target_cv=<relative_error>]\n"
           "          [--benchmark_repetitions=<num_repetitions>]\n"
           "          [--benchmark_enable_random_interleaving={true|false}]\n"
           "          [--benchmark_report_aggregates_only={true|false}]\n"
           "          [--benchmark_display_aggregates_only={true|false}]\n"
-          "          [--benchmark_format=<console|json|csv>]\n"
+          "          [--benchmark_outlier_rejection=<none|iqr|mad>]\n"
+          "          [--benchmark_shard_count=<num_shards>]\n"
+          "          [--benchmark_shard_index=<shard>]\n"
+          "          [--benchmark_shard_costs=<filename>]\n"
+          "          [--benchmark_cache_dir=<directory>]\n"
+          "          [--benchmark_cache_fingerprint=<string>]\n"
+          "          [--benchmark_checkpoint=<filename>]\n"
+          "          [--benchmark_datagen_dir=<directory>]\n"
+          "          [--benchmark_sysinfo_cache_dir=<directory>]\n"
+          "          [--benchmark_iterations_hint_file=<filename>]\n"
+          "          [--benchmark_interference_file=<filename>]\n"
+          "          [--benchmark_process_memory={true|false}]\n"
+          "          [--benchmark_format=<console|json|csv|table|folded>]\n"
           "          [--benchmark_out=<filename>]\n"
-          "          [--benchmark_out_format=<json|console|csv>]\n"
+          "          [--benchmark_out_format=<json|console|csv|table|binary|"
+          "folded>]\n"
+          "          [--benchmark_trace_out=<filename>]\n"
           "          [--benchmark_color={auto|true|false}]\n"
           "          [--benchmark_counters_tabular={true|false}]\n"
+          "          [--benchmark_progress={true|false}]\n"
+          "          [--benchmark_background_reporting={true|false}]\n"
+          "          [--benchmark_reporting_cpus=<cpu list>]\n"
           "          [--benchmark_perf_counters=<counter>,...]\n"
+          "          [--benchmark_perf_counters_per_thread={true|false}]\n"
+          "          [--benchmark_thread_breakdown={true|false}]\n"
+          "          [--benchmark_perf_metrics=<ipc|branch|memory|tma_l1>,"
+          "...]\n"
+          "          [--benchmark_parallel_jobs=<num_jobs>]\n"
+          "          [--benchmark_coordinator=<host>:<port>|unix:<path>]\n"
+          "          [--benchmark_coordinator_workers=<num_workers>]\n"
+          "          [--benchmark_time_budget=<seconds>]\n"
+          "          [--benchmark_cpu_affinity=<none|compact|scatter|numa|"
+          "cores|<cpu list>>]\n"
+          "          [--benchmark_isolation=<none|process>]\n"
+          "          [--benchmark_realtime_priority=<1-99>]\n"
+          "          [--benchmark_lock_memory={true|false}]\n"
+          "          [--benchmark_report_cpu_frequency={true|false}]\n"
+          "          [--benchmark_max_cpu_frequency_drop=<fraction>]\n"
+          "          [--benchmark_noise_stats={true|false}]\n"
+          "          [--benchmark_noise_thresholds=<counter>=<max>,...]\n"
+          "          [--benchmark_noise_max_reruns=<num_reruns>]\n"
+          "          [--benchmark_check_measurements={true|false}]\n"
+          "          [--benchmark_energy={true|false}]\n"
+          "          [--benchmark_harness_stats={true|false}]\n"
+          "          [--benchmark_calibrate={true|false}]\n"
+          "          [--benchmark_calibration_interval=<seconds>]\n"
+          "          [--benchmark_normalize_time=<alu|l1|dram>]\n"
+          "          [--benchmark_profile=<perf|lbr>]\n"
+          "          [--benchmark_profile_dir=<directory>]\n"
+          "          [--benchmark_metrics_address=[<host>]:<port>]\n"
+          "          [--benchmark_metrics_interval=<seconds>]\n"
           "          [--benchmark_context=<key>=<value>,...]\n"
           "          [--v=<verbosity>]\n");
   exit(0);
@@ -549,13 +1993,91 @@ void PrintUsageAndExit() {
 void ValidateCommandLineFlags() {
   for (auto const& flag : {absl::GetFlag(FLAGS_benchmark_format),
                            absl::GetFlag(FLAGS_benchmark_out_format)}) {
-    if (flag != "console" && flag != "json" && flag != "csv") {
+    if (flag != "console" && flag != "json" && flag != "csv" &&
+        flag != "table" && flag != "binary" && flag != "folded") {
       PrintUsageAndExit();
     }
   }
+  // The binary format is only for files.
+  if (absl::GetFlag(FLAGS_benchmark_format) == "binary") {
+    PrintUsageAndExit();
+  }
   if (absl::GetFlag(FLAGS_benchmark_color).empty()) {
     PrintUsageAndExit();
   }
+  if (absl::GetFlag(FLAGS_benchmark_isolation) != "none" &&
+      absl::GetFlag(FLAGS_benchmark_isolation) != "process") {
+    PrintUsageAndExit();
+  }
+  if (absl::GetFlag(FLAGS_benchmark_shard_count) < 1 ||
+      absl::GetFlag(FLAGS_benchmark_shard_index) < 0 ||
+      absl::GetFlag(FLAGS_benchmark_shard_index) >=
+          absl::GetFlag(FLAGS_benchmark_shard_count)) {
+    PrintUsageAndExit();
+  }
+  // The repetitions of the workers are not isolated.
+  if (absl::GetFlag(FLAGS_benchmark_coordinator_workers) < 0 ||
+      (absl::GetFlag(FLAGS_benchmark_coordinator_workers) > 0 &&
+       absl::GetFlag(FLAGS_benchmark_coordinator).empty()) ||
+      (!absl::GetFlag(FLAGS_benchmark_coordinator).empty() &&
+       absl::GetFlag(FLAGS_benchmark_isolation) == "process")) {
+    PrintUsageAndExit();
+  }
+  if (absl::GetFlag(FLAGS_benchmark_parallel_jobs) < 1 ||
+      absl::GetFlag(FLAGS_benchmark_time_budget) < 0 ||
+      absl::GetFlag(FLAGS_benchmark_min_warmup_time) < 0 ||
+      absl::GetFlag(FLAGS_benchmark_target_cv) < 0 ||
+      absl::GetFlag(FLAGS_benchmark_max_cpu_frequency_drop) < 0 ||
+      absl::GetFlag(FLAGS_benchmark_max_cpu_frequency_drop) >= 1 ||
+      absl::GetFlag(FLAGS_benchmark_noise_max_reruns) < 0 ||
+      absl::GetFlag(FLAGS_benchmark_calibration_interval) < 0 ||
+      !(absl::GetFlag(FLAGS_benchmark_metrics_interval) > 0)) {
+    PrintUsageAndExit();
+  }
+  if (!absl::GetFlag(FLAGS_benchmark_normalize_time).empty() &&
+      !IsCalibrationKernel(absl::GetFlag(FLAGS_benchmark_normalize_time))) {
+    PrintUsageAndExit();
+  }
+  std::map<std::string, double> noise_thresholds;
+  if (!ParseNoiseThresholds(absl::GetFlag(FLAGS_benchmark_noise_thresholds),
+                            &noise_thresholds)) {
+    PrintUsageAndExit();
+  }
+  std::vector<TagTerm> tag_terms;
+  if (!ParseTagSelection(absl::GetFlag(FLAGS_benchmark_tags), &tag_terms)) {
+    PrintUsageAndExit();
+  }
+  if (!PerfMetrics::IsValid(absl::GetFlag(FLAGS_benchmark_perf_metrics))) {
+    PrintUsageAndExit();
+  }
+  Profiler::Mode profile_mode;
+  if (!absl::GetFlag(FLAGS_benchmark_profile).empty() &&
+      !Profiler::ParseMode(absl::GetFlag(FLAGS_benchmark_profile),
+                           &profile_mode)) {
+    PrintUsageAndExit();
+  }
+  OutlierRejection outlier_rejection;
+  if (!ParseOutlierRejection(absl::GetFlag(FLAGS_benchmark_outlier_rejection),
+                             &outlier_rejection)) {
+    PrintUsageAndExit();
+  }
+  PinPolicy pin_policy;
+  std::vector<int> pin_cpus;
+  if (!ParseCpuAffinity(absl::GetFlag(FLAGS_benchmark_cpu_affinity),
+                        &pin_policy, &pin_cpus)) {
+    PrintUsageAndExit();
+  }
+  std::vector<int> reporting_cpus;
+  if (!absl::GetFlag(FLAGS_benchmark_reporting_cpus).empty() &&
+      !ParseCpuList(absl::GetFlag(FLAGS_benchmark_reporting_cpus),
+                    &reporting_cpus)) {
+    PrintUsageAndExit();
+  }
+  const int realtime_priority =
+      absl::GetFlag(FLAGS_benchmark_realtime_priority);
+  if (realtime_priority < 0 || realtime_priority > 99) {
+    PrintUsageAndExit();
+  }
   for (const auto& kv : benchmark::KvPairsFromEnv(
            absl::GetFlag(FLAGS_benchmark_context).c_str(), {})) {
     AddCustomContext(kv.first, kv.second);
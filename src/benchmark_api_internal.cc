@@ -1,8 +1,10 @@
 #include "benchmark_api_internal.h"
 
+#include <algorithm>
 #include <cinttypes>
 
 #include "string_util.h"
+#include "thread_manager.h"
 
 namespace benchmark {
 namespace internal {
@@ -10,8 +12,11 @@ namespace internal {
 BenchmarkInstance::BenchmarkInstance(Benchmark* benchmark, int family_idx,
                                      int per_family_instance_idx,
                                      const std::vector<int64_t>& args,
-                                     int thread_count)
-    : benchmark_(*benchmark),
+                                     int thread_count, ABRole ab_role,
+                                     const std::string& variant,
+                                     int in_flight)
+    : name_(MakeName(*benchmark, args, thread_count, variant, in_flight)),
+      benchmark_(*benchmark),
       family_index_(family_idx),
       per_family_instance_index_(per_family_instance_idx),
       aggregation_report_mode_(benchmark_.aggregation_report_mode_),
@@ -20,73 +25,237 @@ BenchmarkInstance::BenchmarkInstance(Benchmark* benchmark, int family_idx,
       measure_process_cpu_time_(benchmark_.measure_process_cpu_time_),
       use_real_time_(benchmark_.use_real_time_),
       use_manual_time_(benchmark_.use_manual_time_),
+      use_cycle_clock_(benchmark_.use_cycle_clock_),
+      subtract_timer_overhead_(benchmark_.subtract_timer_overhead_),
+      use_spin_barrier_(benchmark_.use_spin_barrier_),
+      fixed_work_(benchmark_.fixed_work_),
+      cold_cache_(benchmark_.cold_cache_),
+      latency_sample_period_(benchmark_.latency_sample_period_),
+      time_series_interval_(benchmark_.time_series_interval_),
+      throughput_interval_(benchmark_.throughput_interval_),
+      samples_(benchmark_.samples_),
+      target_rate_(benchmark_.target_rate_),
+      arrival_process_(benchmark_.arrival_process_),
+      thread_scaling_(benchmark_.thread_scaling_),
+      matrix_counter_(benchmark_.matrix_counter_),
+      priority_(benchmark_.priority_),
+      cache_fingerprint_(benchmark_.cache_fingerprint_),
+      ab_role_(ab_role),
+      variant_(variant),
       complexity_(benchmark_.complexity_),
       complexity_lambda_(benchmark_.complexity_lambda_),
+      complexity_terms_(benchmark_.complexity_terms_),
+      complexity_model_(benchmark_.complexity_model_),
       statistics_(benchmark_.statistics_),
       repetitions_(benchmark_.repetitions_),
       min_time_(benchmark_.min_time_),
+      min_warmup_time_(benchmark_.min_warmup_time_),
+      target_relative_error_(benchmark_.target_relative_error_),
       iterations_(benchmark_.iterations_),
-      threads_(thread_count) {
-  name_.function_name = benchmark_.name_;
+      memory_iterations_(benchmark_.memory_iterations_),
+      threads_(thread_count),
+      in_flight_(in_flight),
+      pin_policy_(benchmark_.pin_policy_),
+      pin_cpus_(benchmark_.pin_cpus_),
+      tags_(benchmark_.tags_),
+      thread_groups_(benchmark_.thread_groups_) {
+  const std::string inputs = benchmark_.name_ + "/" + name_.args;
+  seed_ = Fnv1aHash(inputs.data(), inputs.size());
+  if (ab_role_ == kABContender) {
+    name_.function_name = FunctionName(*benchmark_.contender_, variant_);
+  }
+  if (tuned()) name_.args = "tune";
+}
+
+BenchmarkInstance BenchmarkInstance::WithArgs(const std::vector<int64_t>& args,
+                                              int per_family_instance_index,
+                                              int repetitions,
+                                              double min_time) const {
+  BenchmarkInstance instance(&benchmark_, family_index_,
+                             per_family_instance_index, args, threads_,
+                             kNotAB, variant_, in_flight_);
+  instance.repetitions_ = repetitions;
+  instance.min_time_ = min_time;
+  return instance;
+}
+
+void BenchmarkInstance::Finish() const {
+  if (ab_role_ == kABContender) {
+    benchmark_.contender_->Finish();
+  } else {
+    benchmark_.Finish();
+  }
+}
+
+const std::string& BenchmarkInstance::ThreadRole(int thread_id,
+                                                 int* role_thread_index) const {
+  static const std::string* const kNoRole = new std::string();
+  int first = 0;
+  for (const auto& group : thread_groups_) {
+    if (thread_id < first + group.second) {
+      *role_thread_index = thread_id - first;
+      return group.first;
+    }
+    first += group.second;
+  }
+  *role_thread_index = thread_id;
+  return *kNoRole;
+}
+
+const std::string& BenchmarkInstance::cache_target() const {
+  static const std::string* const kNoTarget = new std::string();
+  if (args_.empty()) return *kNoTarget;
+  const auto it = benchmark_.cache_targets_.find(args_[0]);
+  return it != benchmark_.cache_targets_.end() ? it->second : *kNoTarget;
+}
+
+bool BenchmarkInstance::tuned() const {
+  return !benchmark_.tune_space_.empty() && args_.empty();
+}
+
+const std::vector<std::vector<int64_t>>& BenchmarkInstance::tune_space()
+    const {
+  return benchmark_.tune_space_;
+}
+
+const std::string& BenchmarkInstance::tune_objective() const {
+  return benchmark_.tune_objective_;
+}
+
+TuneStrategy BenchmarkInstance::tune_strategy() const {
+  return benchmark_.tune_strategy_;
+}
+
+std::string BenchmarkInstance::FunctionName(const Benchmark& benchmark,
+                                            const std::string& variant) {
+  if (variant.empty()) return benchmark.name_;
+  if (benchmark.template_variants_) return benchmark.name_ + variant;
+  return benchmark.name_ + '/' + variant;
+}
 
-  size_t arg_i = 0;
-  for (const auto& arg : args) {
-    if (!name_.args.empty()) {
-      name_.args += '/';
+std::string BenchmarkInstance::FormatArg(const Benchmark& benchmark,
+                                         size_t arg_index, int64_t arg) {
+  std::string value = StrFormat("%" PRId64, arg);
+  if (arg_index < benchmark.arg_value_names_.size()) {
+    const auto& names = benchmark.arg_value_names_[arg_index];
+    if (arg >= 0 && arg < static_cast<int64_t>(names.size())) {
+      value = names[static_cast<size_t>(arg)];
+    }
+  }
+  if (arg_index < benchmark.arg_names_.size()) {
+    const auto& arg_name = benchmark.arg_names_[arg_index];
+    if (!arg_name.empty()) {
+      return StrFormat("%s:%s", arg_name.c_str(), value.c_str());
     }
+  }
+  return value;
+}
 
-    if (arg_i < benchmark->arg_names_.size()) {
-      const auto& arg_name = benchmark_.arg_names_[arg_i];
-      if (!arg_name.empty()) {
-        name_.args += StrFormat("%s:", arg_name.c_str());
-      }
+std::string BenchmarkInstance::FormatArgs(const Benchmark& benchmark,
+                                          const std::vector<int64_t>& args) {
+  std::string formatted;
+  for (size_t arg_i = 0; arg_i < args.size(); ++arg_i) {
+    if (!formatted.empty()) {
+      formatted += '/';
     }
+    formatted += FormatArg(benchmark, arg_i, args[arg_i]);
+  }
+  return formatted;
+}
+
+BenchmarkName BenchmarkInstance::MakeName(const Benchmark& benchmark,
+                                          const std::vector<int64_t>& args,
+                                          int thread_count,
+                                          const std::string& variant,
+                                          int in_flight) {
+  BenchmarkName name;
+  name.function_name = FunctionName(benchmark, variant);
 
-    name_.args += StrFormat("%" PRId64, arg);
-    ++arg_i;
+  name.args = FormatArgs(benchmark, args);
+
+  if (!IsZero(benchmark.min_time_)) {
+    name.min_time = StrFormat("min_time:%0.3f", benchmark.min_time_);
   }
 
-  if (!IsZero(benchmark->min_time_)) {
-    name_.min_time = StrFormat("min_time:%0.3f", benchmark_.min_time_);
+  if (!IsZero(benchmark.min_warmup_time_)) {
+    name.min_warmup_time =
+        StrFormat("min_warmup_time:%0.3f", benchmark.min_warmup_time_);
   }
 
-  if (benchmark_.iterations_ != 0) {
-    name_.iterations = StrFormat(
-        "iterations:%lu", static_cast<unsigned long>(benchmark_.iterations_));
+  if (benchmark.iterations_ != 0) {
+    name.iterations = StrFormat(
+        "iterations:%lu", static_cast<unsigned long>(benchmark.iterations_));
   }
 
-  if (benchmark_.repetitions_ != 0) {
-    name_.repetitions = StrFormat("repeats:%d", benchmark_.repetitions_);
+  if (benchmark.repetitions_ != 0) {
+    name.repetitions = StrFormat("repeats:%d", benchmark.repetitions_);
   }
 
-  if (benchmark_.measure_process_cpu_time_) {
-    name_.time_type = "process_time";
+  if (benchmark.measure_process_cpu_time_) {
+    name.time_type = "process_time";
   }
 
-  if (benchmark_.use_manual_time_) {
-    if (!name_.time_type.empty()) {
-      name_.time_type += '/';
+  if (benchmark.use_manual_time_) {
+    if (!name.time_type.empty()) {
+      name.time_type += '/';
     }
-    name_.time_type += "manual_time";
-  } else if (benchmark_.use_real_time_) {
-    if (!name_.time_type.empty()) {
-      name_.time_type += '/';
+    name.time_type += "manual_time";
+  } else if (benchmark.use_real_time_) {
+    if (!name.time_type.empty()) {
+      name.time_type += '/';
     }
-    name_.time_type += "real_time";
+    name.time_type += "real_time";
+  }
+
+  if (benchmark.use_cycle_clock_) {
+    if (!name.time_type.empty()) {
+      name.time_type += '/';
+    }
+    name.time_type += "cycle_clock";
+  }
+
+  if (benchmark.cold_cache_) {
+    name.cache = "cold_cache";
+  }
+
+  if (!benchmark.in_flight_counts_.empty()) {
+    name.in_flight = StrFormat("in_flight:%d", in_flight);
   }
 
-  if (!benchmark_.thread_counts_.empty()) {
-    name_.threads = StrFormat("threads:%d", threads_);
+  if (!benchmark.thread_counts_.empty()) {
+    name.threads = StrFormat("threads:%d", thread_count);
+    if (benchmark.fixed_work_) name.threads += "/fixed_work";
   }
+  return name;
 }
 
 State BenchmarkInstance::Run(
     IterationCount iters, int thread_id, internal::ThreadTimer* timer,
     internal::ThreadManager* manager,
-    internal::PerfCountersMeasurement* perf_counters_measurement) const {
+    internal::PerfCountersMeasurement* perf_counters_measurement,
+    internal::LatencyHistogram* latency_histogram,
+    IterationCount progress_chunk, internal::ArrivalSchedule* arrivals,
+    internal::Profiler* profiler) const {
   State st(iters, args_, thread_id, threads_, timer, manager,
-           perf_counters_measurement);
-  benchmark_.Run(st);
+           perf_counters_measurement, latency_histogram, progress_chunk,
+           arrivals);
+  st.arg_values_ = &benchmark_;
+  st.variant_ = variant_;
+  st.seed_ = seed_;
+  st.repetition_index_ = manager->repetition_index();
+  if (in_flight_ > 0) st.in_flight_ = in_flight_;
+  st.thread_role_ = ThreadRole(thread_id, &st.role_thread_index_);
+  st.profiler_ = profiler;
+  if (fixed_work_ && threads_ > 1) {
+    // Small enough for the threads to finish within a chunk of each other.
+    st.shared_chunk_ = std::max<IterationCount>(1, iters / (threads_ * 32));
+  }
+  if (ab_role_ == kABContender) {
+    benchmark_.contender_->Run(st);
+  } else {
+    benchmark_.Run(st);
+  }
+  st.PublishRegisteredCounters();
   return st;
 }
 
@@ -14,14 +14,43 @@
 namespace benchmark {
 namespace internal {
 
+// The part an instance plays in an A/B pair, see Benchmark::CompareWith().
+enum ABRole { kNotAB, kABBaseline, kABContender };
+
 // Information kept per benchmark we may want to run
 class BenchmarkInstance {
  public:
   BenchmarkInstance(Benchmark* benchmark, int family_index,
                     int per_family_instance_index,
-                    const std::vector<int64_t>& args, int threads);
+                    const std::vector<int64_t>& args, int threads,
+                    ABRole ab_role = kNotAB,
+                    const std::string& variant = std::string(),
+                    int in_flight = 0);
+
+  // The name the instance of 'benchmark' with 'args', 'threads', 'variant'
+  // and 'in_flight' has, and the parts of it for the args, without making
+  // the instance.
+  static BenchmarkName MakeName(const Benchmark& benchmark,
+                                const std::vector<int64_t>& args, int threads,
+                                const std::string& variant = std::string(),
+                                int in_flight = 0);
+  static std::string FunctionName(const Benchmark& benchmark,
+                                  const std::string& variant);
+  static std::string FormatArgs(const Benchmark& benchmark,
+                                const std::vector<int64_t>& args);
+  static std::string FormatArg(const Benchmark& benchmark, size_t arg_index,
+                               int64_t arg);
+
+  // The instance of the same family, with 'args' instead, and the given
+  // index, repetitions and min time, as those of a tuned instance are run.
+  BenchmarkInstance WithArgs(const std::vector<int64_t>& args,
+                             int per_family_instance_index, int repetitions,
+                             double min_time) const;
 
   const BenchmarkName& name() const { return name_; }
+
+  // Call Benchmark::Finish() on the benchmark that the instance runs.
+  void Finish() const;
   int family_index() const { return family_index_; }
   int per_family_instance_index() const { return per_family_instance_index_; }
   AggregationReportMode aggregation_report_mode() const {
@@ -31,17 +60,66 @@ class BenchmarkInstance {
   bool measure_process_cpu_time() const { return measure_process_cpu_time_; }
   bool use_real_time() const { return use_real_time_; }
   bool use_manual_time() const { return use_manual_time_; }
+  bool use_cycle_clock() const { return use_cycle_clock_; }
+  bool subtract_timer_overhead() const { return subtract_timer_overhead_; }
+  bool use_spin_barrier() const { return use_spin_barrier_; }
+  bool fixed_work() const { return fixed_work_; }
+  bool cold_cache() const { return cold_cache_; }
+  IterationCount latency_sample_period() const {
+    return latency_sample_period_;
+  }
+  double time_series_interval() const { return time_series_interval_; }
+  double throughput_interval() const { return throughput_interval_; }
+  int samples() const { return samples_; }
+  double target_rate() const { return target_rate_; }
+  ArrivalProcess arrival_process() const { return arrival_process_; }
+  bool thread_scaling() const { return thread_scaling_; }
+  const std::string& matrix_counter() const { return matrix_counter_; }
+  int priority() const { return priority_; }
+  const std::string& cache_fingerprint() const { return cache_fingerprint_; }
+  ABRole ab_role() const { return ab_role_; }
+  const std::string& variant() const { return variant_; }
+  // The caches that the working set size of arg 0 targets, if it is one of
+  // those of Benchmark::CacheBoundaryRange(), or empty.
+  const std::string& cache_target() const;
+  // Whether this stands for the search of the args of a family with a tune
+  // space, see Benchmark::Tune(), rather than for some args of it.
+  bool tuned() const;
+  const std::vector<std::vector<int64_t>>& tune_space() const;
+  const std::string& tune_objective() const;
+  TuneStrategy tune_strategy() const;
   BigO complexity() const { return complexity_; }
   BigOFunc* complexity_lambda() const { return complexity_lambda_; }
+  const std::vector<BigO>& complexity_terms() const {
+    return complexity_terms_;
+  }
+  ComplexityModel complexity_model() const { return complexity_model_; }
   const std::vector<Statistics>& statistics() const { return statistics_; }
   int repetitions() const { return repetitions_; }
   double min_time() const { return min_time_; }
+  double min_warmup_time() const { return min_warmup_time_; }
+  double target_relative_error() const { return target_relative_error_; }
   IterationCount iterations() const { return iterations_; }
+  IterationCount memory_iterations() const { return memory_iterations_; }
   int threads() const { return threads_; }
+  // The operations in flight per thread, or 0 if not set.
+  int in_flight() const { return in_flight_; }
+  PinPolicy pin_policy() const { return pin_policy_; }
+  const std::vector<int>& pin_cpus() const { return pin_cpus_; }
+  const std::vector<std::string>& tags() const { return tags_; }
+  const std::vector<std::pair<std::string, int>>& thread_groups() const {
+    return thread_groups_;
+  }
+  // The role of the thread 'thread_id' in the ThreadGroups(), or empty, and
+  // its index among the threads of that role.
+  const std::string& ThreadRole(int thread_id, int* role_thread_index) const;
 
   State Run(IterationCount iters, int thread_id, internal::ThreadTimer* timer,
             internal::ThreadManager* manager,
-            internal::PerfCountersMeasurement* perf_counters_measurement) const;
+            internal::PerfCountersMeasurement* perf_counters_measurement,
+            internal::LatencyHistogram* latency_histogram,
+            IterationCount progress_chunk, internal::ArrivalSchedule* arrivals,
+            internal::Profiler* profiler) const;
 
  private:
   BenchmarkName name_;
@@ -49,24 +127,69 @@ class BenchmarkInstance {
   const int family_index_;
   const int per_family_instance_index_;
   AggregationReportMode aggregation_report_mode_;
-  const std::vector<int64_t>& args_;
+  const std::vector<int64_t> args_;
   TimeUnit time_unit_;
   bool measure_process_cpu_time_;
   bool use_real_time_;
   bool use_manual_time_;
+  bool use_cycle_clock_;
+  bool subtract_timer_overhead_;
+  bool use_spin_barrier_;
+  bool fixed_work_;
+  bool cold_cache_;
+  IterationCount latency_sample_period_;
+  double time_series_interval_;
+  double throughput_interval_;
+  int samples_;
+  double target_rate_;
+  ArrivalProcess arrival_process_;
+  bool thread_scaling_;
+  const std::string& matrix_counter_;
+  int priority_;
+  const std::string& cache_fingerprint_;
+  ABRole ab_role_;
+  std::string variant_;
+  uint64_t seed_;
   BigO complexity_;
   BigOFunc* complexity_lambda_;
+  std::vector<BigO> complexity_terms_;
+  ComplexityModel complexity_model_;
   UserCounters counters_;
   const std::vector<Statistics>& statistics_;
   int repetitions_;
   double min_time_;
+  double min_warmup_time_;
+  double target_relative_error_;
   IterationCount iterations_;
+  IterationCount memory_iterations_;
   int threads_;  // Number of concurrent threads to us
+  int in_flight_;
+  PinPolicy pin_policy_;
+  const std::vector<int>& pin_cpus_;
+  const std::vector<std::string>& tags_;
+  const std::vector<std::pair<std::string, int>>& thread_groups_;
 };
 
+// Find the instances whose names match 're' and that have the tags selected
+// by 'tags', a --benchmark_tags.
 bool FindBenchmarksInternal(const std::string& re,
                             std::vector<BenchmarkInstance>* benchmarks,
-                            std::ostream* Err);
+                            std::ostream* Err, const std::string& tags = "");
+
+// A term of a --benchmark_tags selection: the benchmarks must have one of
+// 'tags', or, if 'excluded', none of them.
+struct TagTerm {
+  std::vector<std::string> tags;
+  bool excluded;
+};
+
+// Parse a --benchmark_tags, the comma-separated terms that the benchmarks
+// must all satisfy, e.g. "numa,gpu|fpga,-slow", into 'terms'.
+bool ParseTagSelection(const std::string& str, std::vector<TagTerm>* terms);
+
+// Whether 'tag' can be given to Tags(): not empty, not starting with '-', and
+// without ',' or '|'.
+bool IsValidTag(const std::string& tag);
 
 bool IsZero(double n);
 
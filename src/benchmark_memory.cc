@@ -0,0 +1,473 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The benchmark_memory library: linking it registers a MemoryManager that
+// counts the allocations of the whole program. On glibc, it interposes malloc
+// and its kin, which operator new calls too; elsewhere, and with the
+// sanitizers, which interpose malloc themselves, it replaces operator new and
+// delete. Each thread counts in its own slot, which Stop() sums up, and
+// nothing is counted but between Start() and Stop().
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "internal_macros.h"
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(memory_sanitizer) || \
+    __has_feature(thread_sanitizer)
+#define BENCHMARK_MEMORY_SANITIZED
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define BENCHMARK_MEMORY_SANITIZED
+#endif
+
+#if defined(__GLIBC__) && !defined(BENCHMARK_MEMORY_SANITIZED)
+#define BENCHMARK_MEMORY_INTERPOSE_MALLOC
+#include <errno.h>
+#include <execinfo.h>
+#include <malloc.h>
+#include <unistd.h>
+#endif
+
+ABSL_FLAG(int64_t, benchmark_memory_sample_period, 0,
+          "With the benchmark_memory library, sample the stack of about one "
+          "allocation every this many bytes during the memory run of each "
+          "benchmark, and print its top allocation sites to stderr. 0 to not "
+          "sample. Only with glibc.");
+
+namespace benchmark {
+namespace {
+
+// Entry i counts the allocations of more than 2^(i-1) and at most 2^i bytes.
+const int kNumSizeClasses = 48;
+// The threads past these share the last slot.
+const int kNumSlots = 256;
+
+int SizeClass(size_t size) {
+  int size_class = 0;
+  while (size_class < kNumSizeClasses - 1 &&
+         (static_cast<size_t>(1) << size_class) < size) {
+    ++size_class;
+  }
+  return size_class;
+}
+
+struct alignas(64) Slot {
+  std::atomic<int64_t> allocs;
+  std::atomic<int64_t> bytes;
+  std::atomic<int64_t> frees;
+  // What the allocator gave and took back, if it says how much.
+  std::atomic<int64_t> usable_allocated;
+  std::atomic<int64_t> usable_freed;
+  std::atomic<int64_t> size_classes[kNumSizeClasses];
+};
+
+Slot slots[kNumSlots];
+std::atomic<int> num_slots(0);
+thread_local Slot* thread_slot = nullptr;
+
+// The counts of the threads of the benchmark, by thread index: those of
+// their slots at StartThread(), then what they allocated until StopThread().
+int64_t thread_allocs[kNumSlots];
+int64_t thread_bytes[kNumSlots];
+std::atomic<int> num_threads(0);
+
+std::atomic<bool> active(false);
+// The bytes live since Start(), all threads together, and their peak.
+std::atomic<int64_t> live_bytes(0);
+std::atomic<int64_t> peak_bytes(0);
+
+Slot* GetThreadSlot() {
+  if (thread_slot == nullptr) {
+    const int slot = num_slots.fetch_add(1, std::memory_order_relaxed);
+    thread_slot = &slots[std::min(slot, kNumSlots - 1)];
+  }
+  return thread_slot;
+}
+
+void Add(std::atomic<int64_t>* counter, int64_t value) {
+  counter->fetch_add(value, std::memory_order_relaxed);
+}
+
+// The sums of the slots.
+struct Totals {
+  Totals()
+      : allocs(0),
+        bytes(0),
+        frees(0),
+        usable_allocated(0),
+        usable_freed(0),
+        size_classes(kNumSizeClasses, 0) {}
+
+  int64_t allocs;
+  int64_t bytes;
+  int64_t frees;
+  int64_t usable_allocated;
+  int64_t usable_freed;
+  std::vector<int64_t> size_classes;
+};
+
+Totals SumSlots() {
+  Totals totals;
+  const int used = std::min(num_slots.load(), kNumSlots);
+  for (int i = 0; i < used; ++i) {
+    const Slot& slot = slots[i];
+    totals.allocs += slot.allocs.load(std::memory_order_relaxed);
+    totals.bytes += slot.bytes.load(std::memory_order_relaxed);
+    totals.frees += slot.frees.load(std::memory_order_relaxed);
+    totals.usable_allocated +=
+        slot.usable_allocated.load(std::memory_order_relaxed);
+    totals.usable_freed += slot.usable_freed.load(std::memory_order_relaxed);
+    for (int c = 0; c < kNumSizeClasses; ++c) {
+      totals.size_classes[c] +=
+          slot.size_classes[c].load(std::memory_order_relaxed);
+    }
+  }
+  return totals;
+}
+
+#ifdef BENCHMARK_MEMORY_INTERPOSE_MALLOC
+// A table of the sampled allocation sites, by their stacks, which is never
+// resized: the sites past its capacity are dropped.
+const int kNumSites = 1024;
+const int kMaxFrames = 16;
+
+struct Site {
+  // 0 while free, 1 while its stack is written, 2 once it can be read.
+  std::atomic<int> state;
+  uint64_t hash;
+  int num_frames;
+  void* frames[kMaxFrames];
+  std::atomic<int64_t> samples;
+  std::atomic<int64_t> bytes;
+};
+
+Site sites[kNumSites];
+int64_t sample_period = 0;
+thread_local int64_t bytes_until_sample = 0;
+thread_local bool sampling = false;
+
+void SampleSite(size_t size) {
+  // backtrace() may allocate, but what it allocates isn't sampled.
+  if (sampling) return;
+  sampling = true;
+  void* frames[kMaxFrames];
+  const int num_frames = backtrace(frames, kMaxFrames);
+  uint64_t hash = 14695981039346656037ULL;
+  for (int i = 0; i < num_frames; ++i) {
+    hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i])) * 1099511628211ULL;
+  }
+  for (int probe = 0; probe < kNumSites; ++probe) {
+    Site& site = sites[(hash + probe) % kNumSites];
+    int state = site.state.load(std::memory_order_acquire);
+    if (state == 0 && site.state.compare_exchange_strong(state, 1)) {
+      site.hash = hash;
+      site.num_frames = num_frames;
+      std::copy(frames, frames + num_frames, site.frames);
+      site.state.store(2, std::memory_order_release);
+      state = 2;
+    }
+    while (state == 1) state = site.state.load(std::memory_order_acquire);
+    if (site.hash != hash) continue;
+    // Each sample stands for the period's worth of bytes.
+    Add(&site.samples, 1);
+    Add(&site.bytes, std::max<int64_t>(sample_period,
+                                       static_cast<int64_t>(size)));
+    break;
+  }
+  sampling = false;
+}
+
+void PrintSites() {
+  std::vector<const Site*> sampled;
+  for (const Site& site : sites) {
+    if (site.state.load() == 2 && site.samples.load() > 0) {
+      sampled.push_back(&site);
+    }
+  }
+  if (sampled.empty()) return;
+  std::sort(sampled.begin(), sampled.end(), [](const Site* a, const Site* b) {
+    return a->bytes.load() > b->bytes.load();
+  });
+  std::cerr << "Sampled allocation sites of the memory run:\n";
+  const size_t kNumPrinted = 10;
+  for (size_t i = 0; i < sampled.size() && i < kNumPrinted; ++i) {
+    std::cerr << "  ~" << sampled[i]->bytes.load() << " bytes in "
+              << sampled[i]->samples.load() << " samples at:" << std::endl;
+    // Without allocating, skipping the frames of the interposer.
+    backtrace_symbols_fd(const_cast<void* const*>(sampled[i]->frames + 2),
+                         std::max(sampled[i]->num_frames - 2, 0),
+                         STDERR_FILENO);
+  }
+}
+
+void ClearSites() {
+  for (Site& site : sites) {
+    site.state.store(0);
+    site.samples.store(0);
+    site.bytes.store(0);
+  }
+}
+#endif  // BENCHMARK_MEMORY_INTERPOSE_MALLOC
+
+void RecordAlloc(size_t size, size_t usable) {
+  Slot* slot = GetThreadSlot();
+  Add(&slot->allocs, 1);
+  Add(&slot->bytes, static_cast<int64_t>(size));
+  Add(&slot->usable_allocated, static_cast<int64_t>(usable));
+  Add(&slot->size_classes[SizeClass(size)], 1);
+  const int64_t live =
+      live_bytes.fetch_add(static_cast<int64_t>(usable),
+                           std::memory_order_relaxed) +
+      static_cast<int64_t>(usable);
+  int64_t peak = peak_bytes.load(std::memory_order_relaxed);
+  while (live > peak && !peak_bytes.compare_exchange_weak(
+                            peak, live, std::memory_order_relaxed)) {
+  }
+#ifdef BENCHMARK_MEMORY_INTERPOSE_MALLOC
+  if (sample_period > 0) {
+    bytes_until_sample -= static_cast<int64_t>(size);
+    if (bytes_until_sample <= 0) {
+      bytes_until_sample += sample_period;
+      SampleSite(size);
+    }
+  }
+#endif
+}
+
+void RecordFree(size_t usable) {
+  Slot* slot = GetThreadSlot();
+  Add(&slot->frees, 1);
+  Add(&slot->usable_freed, static_cast<int64_t>(usable));
+  live_bytes.fetch_sub(static_cast<int64_t>(usable),
+                       std::memory_order_relaxed);
+}
+
+class InterposingMemoryManager : public MemoryManager {
+ public:
+  void Start() BENCHMARK_OVERRIDE {
+#ifdef BENCHMARK_MEMORY_INTERPOSE_MALLOC
+    sample_period = absl::GetFlag(FLAGS_benchmark_memory_sample_period);
+    if (sample_period > 0) {
+      ClearSites();
+      // The first call loads the unwinder, which allocates.
+      void* frame;
+      backtrace(&frame, 1);
+    }
+#endif
+    start_ = SumSlots();
+    num_threads.store(0);
+    live_bytes.store(0);
+    peak_bytes.store(0);
+    active.store(true, std::memory_order_release);
+  }
+
+  void Stop(Result* result) BENCHMARK_OVERRIDE {
+    active.store(false, std::memory_order_release);
+    const Totals end = SumSlots();
+    result->num_allocs = end.allocs - start_.allocs;
+    result->max_bytes_used = peak_bytes.load();
+    result->total_allocated_bytes = end.bytes - start_.bytes;
+    result->num_frees = end.frees - start_.frees;
+#ifdef BENCHMARK_MEMORY_INTERPOSE_MALLOC
+    result->net_heap_growth = (end.usable_allocated - start_.usable_allocated) -
+                              (end.usable_freed - start_.usable_freed);
+#endif
+    result->alloc_size_histogram.clear();
+    for (int c = 0; c < kNumSizeClasses; ++c) {
+      result->alloc_size_histogram.push_back(end.size_classes[c] -
+                                             start_.size_classes[c]);
+    }
+    while (!result->alloc_size_histogram.empty() &&
+           result->alloc_size_histogram.back() == 0) {
+      result->alloc_size_histogram.pop_back();
+    }
+    const int threads = num_threads.load();
+    result->thread_allocs.assign(thread_allocs, thread_allocs + threads);
+    result->thread_allocated_bytes.assign(thread_bytes, thread_bytes + threads);
+#ifdef BENCHMARK_MEMORY_INTERPOSE_MALLOC
+    if (sample_period > 0) PrintSites();
+#endif
+  }
+
+  // The threads that share the last slot count each other's allocations.
+  void StartThread(int thread_index) BENCHMARK_OVERRIDE {
+    if (thread_index >= kNumSlots) return;
+    const Slot* slot = GetThreadSlot();
+    thread_allocs[thread_index] = slot->allocs.load(std::memory_order_relaxed);
+    thread_bytes[thread_index] = slot->bytes.load(std::memory_order_relaxed);
+    int threads = num_threads.load();
+    while (threads <= thread_index &&
+           !num_threads.compare_exchange_weak(threads, thread_index + 1)) {
+    }
+  }
+
+  void StopThread(int thread_index) BENCHMARK_OVERRIDE {
+    if (thread_index >= kNumSlots) return;
+    const Slot* slot = GetThreadSlot();
+    thread_allocs[thread_index] =
+        slot->allocs.load(std::memory_order_relaxed) -
+        thread_allocs[thread_index];
+    thread_bytes[thread_index] = slot->bytes.load(std::memory_order_relaxed) -
+                                 thread_bytes[thread_index];
+  }
+
+ private:
+  Totals start_;
+};
+
+InterposingMemoryManager* RegisterInterposingMemoryManager() {
+  // Never destroyed, as the program may allocate until it exits.
+  static InterposingMemoryManager* manager = new InterposingMemoryManager;
+  RegisterMemoryManager(manager);
+  return manager;
+}
+
+InterposingMemoryManager* const registered_manager BENCHMARK_UNUSED =
+    RegisterInterposingMemoryManager();
+
+bool IsActive() { return active.load(std::memory_order_relaxed); }
+
+}  // end namespace
+}  // end namespace benchmark
+
+#ifdef BENCHMARK_MEMORY_INTERPOSE_MALLOC
+
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void* __libc_valloc(size_t size);
+void* __libc_pvalloc(size_t size);
+void __libc_free(void* ptr);
+
+}  // extern "C"
+
+namespace {
+
+void* Allocated(void* ptr, size_t size) {
+  if (ptr != nullptr && benchmark::IsActive()) {
+    benchmark::RecordAlloc(size, malloc_usable_size(ptr));
+  }
+  return ptr;
+}
+
+void Freeing(void* ptr) {
+  if (ptr != nullptr && benchmark::IsActive()) {
+    benchmark::RecordFree(malloc_usable_size(ptr));
+  }
+}
+
+}  // end namespace
+
+extern "C" {
+
+void* malloc(size_t size) { return Allocated(__libc_malloc(size), size); }
+
+void free(void* ptr) {
+  Freeing(ptr);
+  __libc_free(ptr);
+}
+
+void* calloc(size_t count, size_t size) {
+  return Allocated(__libc_calloc(count, size), count * size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  Freeing(ptr);
+  void* result = __libc_realloc(ptr, size);
+  // A failed realloc leaves the block where it was.
+  if (result == nullptr && ptr != nullptr && size != 0) {
+    return Allocated(ptr, malloc_usable_size(ptr));
+  }
+  return Allocated(result, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+  return Allocated(__libc_memalign(alignment, size), size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  return Allocated(__libc_memalign(alignment, size), size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+  if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+  void* result = Allocated(__libc_memalign(alignment, size), size);
+  if (result == nullptr) return ENOMEM;
+  *ptr = result;
+  return 0;
+}
+
+void* valloc(size_t size) { return Allocated(__libc_valloc(size), size); }
+
+void* pvalloc(size_t size) { return Allocated(__libc_pvalloc(size), size); }
+
+}  // extern "C"
+
+#else  // BENCHMARK_MEMORY_INTERPOSE_MALLOC
+
+// Without a way to tell the size of a block, the frees are counted but not
+// their bytes, so the net heap growth is not measured.
+void* operator new(size_t size) {
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  if (benchmark::IsActive()) benchmark::RecordAlloc(size, 0);
+  return ptr;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr != nullptr && benchmark::IsActive()) {
+    benchmark::RecordAlloc(size, 0);
+  }
+  return ptr;
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nothrow) noexcept {
+  return operator new(size, nothrow);
+}
+
+void operator delete(void* ptr) noexcept {
+  if (ptr != nullptr && benchmark::IsActive()) benchmark::RecordFree(0);
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  operator delete(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  operator delete(ptr);
+}
+
+#endif  // BENCHMARK_MEMORY_INTERPOSE_MALLOC
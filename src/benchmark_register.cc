@@ -31,8 +31,10 @@
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <numeric>
+#include <set>
 #include <sstream>
 #include <thread>
 
@@ -41,12 +43,15 @@
 #include "benchmark_api_internal.h"
 #include "check.h"
 #include "complexity.h"
+#include "cpu_affinity.h"
 #include "internal_macros.h"
 #include "log.h"
 #include "mutex.h"
 #include "re.h"
 #include "statistics.h"
 #include "string_util.h"
+#include "sysinfo.h"
+#include "sysinfo.h"
 #include "timers.h"
 
 namespace benchmark {
@@ -57,10 +62,156 @@ static const int kRangeMultiplier = 8;
 // The size of a benchmark family determines is the number of inputs to repeat
 // the benchmark on. If this is "large" then warn the user during configuration.
 static const size_t kMaxFamilySize = 100;
+
+// The characters with a special meaning in a regular expression. A filter
+// without any is matched as a substring, without the regex engine.
+const char kRegexMetacharacters[] = "\\^$.|?*+()[]{}";
+
+// Return the characters all the names that 'spec' matches start with, if it
+// is anchored with '^' and has no alternatives. Empty if there are none.
+std::string AnchoredPrefix(const std::string& spec) {
+  if (spec.empty() || spec[0] != '^' || spec.find('|') != std::string::npos) {
+    return "";
+  }
+  size_t end = spec.find_first_of(kRegexMetacharacters, 1);
+  if (end == std::string::npos) {
+    end = spec.size();
+  } else if (spec[end] == '?' || spec[end] == '*' || spec[end] == '{') {
+    // The character before may not be there.
+    --end;
+  }
+  return end > 1 ? spec.substr(1, end - 1) : "";
+}
+
+// Whether a name that starts with 'name' can start with 'prefix'.
+bool CanStartWith(const std::string& name, const std::string& prefix) {
+  const size_t n = std::min(name.size(), prefix.size());
+  return name.compare(0, n, prefix, 0, n) == 0;
+}
+// Whether the literal filter 'spec' can be in any of the names of a family,
+// which are the 'names' but for their args. Each of its '/'-separated pieces
+// but the first and the last is a whole part of the name, the first is the
+// end of one and the last the start of one. A piece can be an arg only if it
+// has nothing but digits, signs and the characters of the 'arg_words'.
+bool CanMatchLiteral(const std::vector<BenchmarkName>& names,
+                     const std::vector<std::string>& arg_words,
+                     const std::string& spec) {
+  std::string arg_characters = "0123456789-:";
+  for (const std::string& arg_word : arg_words) arg_characters += arg_word;
+  const std::vector<std::string> pieces = StrSplit(spec, '/');
+  if (pieces.size() < 2) {
+    for (const BenchmarkName& name : names) {
+      if (name.str().find(spec) != std::string::npos) return true;
+    }
+    return spec.find_first_not_of(arg_characters) == std::string::npos;
+  }
+
+  std::vector<std::string> parts;
+  for (const BenchmarkName& name : names) {
+    for (const std::string& part : StrSplit(name.str(), '/')) {
+      parts.push_back(part);
+    }
+  }
+  for (size_t i = 0; i < pieces.size(); ++i) {
+    const std::string& piece = pieces[i];
+    if (piece.find_first_not_of(arg_characters) == std::string::npos) {
+      continue;
+    }
+    const bool found = std::any_of(
+        parts.begin(), parts.end(), [&](const std::string& part) {
+          if (part.size() < piece.size()) return false;
+          if (i == 0) {
+            return part.compare(part.size() - piece.size(), piece.size(),
+                                piece) == 0;
+          }
+          if (i + 1 == pieces.size()) {
+            return part.compare(0, piece.size(), piece) == 0;
+          }
+          return part == piece;
+        });
+    if (!found) return false;
+  }
+  return true;
+}
+
 }  // end namespace
 
 namespace internal {
 
+namespace {
+
+// Add to 'selected' the indices in the product 'arglists', in which the first
+// arg varies the fastest, of the combinations of args whose names can start
+// with 'prefix'. 'name' is the start of the names, up to the 'arg'-th arg, of
+// the combinations at 'index' plus multiples of 'stride'. The args are only
+// formatted as long as they are within the prefix, so that a prefix that
+// excludes most of a large product only costs as much as what it selects.
+void SelectCombinations(const Benchmark& family,
+                        const std::vector<std::vector<int64_t>>& arglists,
+                        const std::string& prefix, size_t arg,
+                        const std::string& name, size_t index, size_t stride,
+                        std::vector<size_t>* selected) {
+  if (arg == arglists.size()) {
+    selected->push_back(index);
+    return;
+  }
+  const bool past_prefix = name.size() >= prefix.size();
+  const std::vector<int64_t>& arglist = arglists[arg];
+  for (size_t i = 0; i < arglist.size(); ++i) {
+    std::string next;
+    if (!past_prefix) {
+      next = name + '/' + BenchmarkInstance::FormatArg(family, arg, arglist[i]);
+      if (!CanStartWith(next, prefix)) continue;
+    }
+    SelectCombinations(family, arglists, prefix, arg + 1,
+                       past_prefix ? name : next, index + i * stride,
+                       stride * arglist.size(), selected);
+  }
+}
+
+}  // end namespace
+
+namespace {
+
+int64_t PageSize() {
+#ifdef BENCHMARK_OS_WINDOWS
+  return 4096;
+#else
+  return static_cast<int64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// The unit the working set sizes are rounded to.
+constexpr int64_t kCacheLineSize = 64;
+
+}  // end namespace
+
+std::vector<std::pair<int64_t, std::string>> CacheBoundarySizes(
+    const std::vector<CPUInfo::CacheInfo>& caches,
+    const std::vector<double>& fractions, int64_t page_size) {
+  std::map<int64_t, std::string> targets;
+  std::set<std::pair<int, int>> seen;
+  for (const CPUInfo::CacheInfo& cache : caches) {
+    if (cache.type == "Instruction" || cache.size <= 0) continue;
+    if (!seen.insert(std::make_pair(cache.level, cache.size)).second) continue;
+    for (double fraction : fractions) {
+      BM_CHECK_GT(fraction, 0);
+      const double bytes = fraction * static_cast<double>(cache.size);
+      const int64_t unit = bytes >= static_cast<double>(page_size)
+                               ? page_size
+                               : kCacheLineSize;
+      const int64_t size = std::max<int64_t>(
+          unit, static_cast<int64_t>(bytes / static_cast<double>(unit) + 0.5) *
+                    unit);
+      std::string& target = targets[size];
+      if (!target.empty()) target += ',';
+      target += StrFormat("L%dx%g", cache.level, fraction);
+    }
+  }
+  return std::vector<std::pair<int64_t, std::string>>(targets.begin(),
+                                                      targets.end());
+}
+
 //=============================================================================//
 //                         BenchmarkFamilies
 //=============================================================================//
@@ -77,16 +228,26 @@ class BenchmarkFamilies {
   // Clear all registered benchmark families.
   void ClearBenchmarks();
 
+  // Index 'tags' of 'family', if it is registered already. Otherwise its
+  // tags are indexed once it is.
+  void AddTags(const Benchmark* family, const std::vector<std::string>& tags);
+
   // Extract the list of benchmark instances that match the specified
-  // regular expression.
-  bool FindBenchmarks(std::string re,
+  // regular expression, and the --benchmark_tags selection 'tags'.
+  bool FindBenchmarks(std::string re, const std::string& tags,
                       std::vector<BenchmarkInstance>* benchmarks,
                       std::ostream* Err);
 
  private:
   BenchmarkFamilies() {}
 
+  void IndexTags(size_t index, const std::vector<std::string>& tags)
+      REQUIRES(mutex_);
+
   std::vector<std::unique_ptr<Benchmark>> families_;
+  // The indices of the families with each tag, in increasing order, so that
+  // the families a selection rules out are never looked at.
+  std::map<std::string, std::vector<size_t>> tag_index_ GUARDED_BY(mutex_);
   Mutex mutex_;
 };
 
@@ -98,6 +259,7 @@ BenchmarkFamilies* BenchmarkFamilies::GetInstance() {
 size_t BenchmarkFamilies::AddBenchmark(std::unique_ptr<Benchmark> family) {
   MutexLock l(mutex_);
   size_t index = families_.size();
+  IndexTags(index, family->tags_);
   families_.push_back(std::move(family));
   return index;
 }
@@ -106,13 +268,40 @@ void BenchmarkFamilies::ClearBenchmarks() {
   MutexLock l(mutex_);
   families_.clear();
   families_.shrink_to_fit();
+  tag_index_.clear();
+}
+
+void BenchmarkFamilies::AddTags(const Benchmark* family,
+                                const std::vector<std::string>& tags) {
+  MutexLock l(mutex_);
+  // The family is almost always the one registered last.
+  for (size_t i = families_.size(); i > 0; --i) {
+    if (families_[i - 1].get() == family) {
+      IndexTags(i - 1, tags);
+      return;
+    }
+  }
+}
+
+void BenchmarkFamilies::IndexTags(size_t index,
+                                  const std::vector<std::string>& tags) {
+  for (const std::string& tag : tags) {
+    std::vector<size_t>& indices = tag_index_[tag];
+    auto it = std::lower_bound(indices.begin(), indices.end(), index);
+    if (it == indices.end() || *it != index) indices.insert(it, index);
+  }
 }
 
 bool BenchmarkFamilies::FindBenchmarks(
-    std::string spec, std::vector<BenchmarkInstance>* benchmarks,
-    std::ostream* ErrStream) {
+    std::string spec, const std::string& tags,
+    std::vector<BenchmarkInstance>* benchmarks, std::ostream* ErrStream) {
   BM_CHECK(ErrStream);
   auto& Err = *ErrStream;
+  std::vector<TagTerm> tag_terms;
+  if (!ParseTagSelection(tags, &tag_terms)) {
+    Err << "Invalid tag selection: " << tags << std::endl;
+    return false;
+  }
   // Make regular expression out of command-line flag
   std::string error_msg;
   Regex re;
@@ -126,54 +315,177 @@ bool BenchmarkFamilies::FindBenchmarks(
     return false;
   }
 
+  // A literal filter matches the names that contain it, and one anchored to
+  // a literal prefix can only match the families and args that start with it,
+  // so that the others need not even be named.
+  const bool literal =
+      spec.find_first_of(kRegexMetacharacters) == std::string::npos;
+  const std::string prefix = isNegativeFilter ? "" : AnchoredPrefix(spec);
+  auto matches = [&](const std::string& name) {
+    const bool match =
+        literal ? name.find(spec) != std::string::npos : re.Match(name);
+    return match != isNegativeFilter;
+  };
+
   // Special list of thread counts to use when none are specified
   const std::vector<int> one_thread = {1};
 
   int next_family_index = 0;
 
   MutexLock l(mutex_);
-  for (std::unique_ptr<Benchmark>& family : families_) {
-    int family_index = next_family_index;
-    int per_family_instance_index = 0;
-
+  // Whether each family has the tags asked for, from the index.
+  std::vector<bool> tagged(families_.size(), true);
+  for (const TagTerm& term : tag_terms) {
+    std::vector<bool> in_term(families_.size(), false);
+    for (const std::string& tag : term.tags) {
+      auto it = tag_index_.find(tag);
+      if (it == tag_index_.end()) continue;
+      for (size_t index : it->second) in_term[index] = true;
+    }
+    for (size_t i = 0; i < families_.size(); ++i)
+      tagged[i] = tagged[i] && in_term[i] != term.excluded;
+  }
+  for (size_t f = 0; f < families_.size(); ++f) {
+    std::unique_ptr<Benchmark>& family = families_[f];
     // Family was deleted or benchmark doesn't match
-    if (!family) continue;
+    if (!family || !tagged[f]) continue;
 
-    if (family->ArgsCnt() == -1) {
-      family->Args({});
-    }
     const std::vector<int>* thread_counts =
         (family->thread_counts_.empty()
              ? &one_thread
              : &static_cast<const std::vector<int>&>(family->thread_counts_));
-    const size_t family_size = family->args_.size() * thread_counts->size();
-    // The benchmark will be run at least 'family_size' different inputs.
-    // If 'family_size' is very large warn the user.
-    if (family_size > kMaxFamilySize) {
-      Err << "The number of inputs is very large. " << family->name_
-          << " will be repeated at least " << family_size << " times.\n";
+    // The thread count and the operations in flight of each instance of a
+    // set of args, with 0 in flight unless the family sets it.
+    std::vector<std::pair<int, int>> concurrencies;
+    for (int num_threads : *thread_counts) {
+      if (family->in_flight_counts_.empty()) {
+        concurrencies.emplace_back(num_threads, 0);
+      }
+      for (int in_flight : family->in_flight_counts_) {
+        concurrencies.emplace_back(num_threads, in_flight);
+      }
+    }
+    // The words that the args are named with, which a literal filter may
+    // contain.
+    std::vector<std::string> arg_words = family->arg_names_;
+    for (const auto& values : family->arg_value_names_) {
+      arg_words.insert(arg_words.end(), values.begin(), values.end());
     }
-    // reserve in the special case the regex ".", since we know the final
-    // family size.
-    if (spec == ".") benchmarks->reserve(benchmarks->size() + family_size);
-
-    for (auto const& args : family->args_) {
-      for (int num_threads : *thread_counts) {
-        BenchmarkInstance instance(family.get(), family_index,
-                                   per_family_instance_index, args,
-                                   num_threads);
-
-        const auto full_name = instance.name().str();
-        if ((re.Match(full_name) && !isNegativeFilter) ||
-            (!re.Match(full_name) && isNegativeFilter)) {
-          benchmarks->push_back(std::move(instance));
 
+    // Each variant that the CPU supports, see Multiversion(), is a family of
+    // its own.
+    std::vector<std::string> variants;
+    for (const std::string& variant : family->variants_) {
+      if (family->template_variants_ || CPUSupports(variant)) {
+        variants.push_back(variant);
+      }
+    }
+    if (family->variants_.empty()) variants.push_back(std::string());
+
+    for (const std::string& variant : variants) {
+      int family_index = next_family_index;
+      int per_family_instance_index = 0;
+      const std::string function_name =
+          BenchmarkInstance::FunctionName(*family, variant);
+
+      if (!family->tune_space_.empty()) {
+        // A tuned family has a single instance per thread count (and
+        // operations in flight), without args, which stands for the search
+        // of its args.
+        for (const auto& concurrency : concurrencies) {
+          BenchmarkInstance instance(family.get(), family_index,
+                                     per_family_instance_index, {},
+                                     concurrency.first, kNotAB, variant,
+                                     concurrency.second);
+          if (!matches(instance.name().str())) continue;
+          benchmarks->push_back(instance);
           ++per_family_instance_index;
-
-          // Only bump the next family index once we've estabilished that
-          // at least one instance of this family will be run.
           if (next_family_index == family_index) ++next_family_index;
         }
+        continue;
+      }
+      if (family->ArgsCnt() == -1) {
+        family->Args({});
+      }
+      size_t num_args = 0;
+      for (const auto& arglists : family->args_) {
+        size_t num_combinations = 1;
+        for (const auto& arglist : arglists) {
+          num_combinations *= arglist.size();
+        }
+        num_args += num_combinations;
+      }
+      const size_t family_size = num_args * concurrencies.size();
+      // The names of the instances, but for their args, by thread count and
+      // operations in flight.
+      std::vector<BenchmarkName> names;
+      for (const auto& concurrency : concurrencies) {
+        names.push_back(BenchmarkInstance::MakeName(
+            *family, {}, concurrency.first, variant, concurrency.second));
+      }
+      if (!CanStartWith(function_name, prefix) ||
+          (literal && !isNegativeFilter &&
+           !CanMatchLiteral(names, arg_words, spec))) {
+        continue;
+      }
+      // The benchmark will be run at least 'family_size' different inputs.
+      // If 'family_size' is very large warn the user.
+      if (family_size > kMaxFamilySize) {
+        Err << "The number of inputs is very large. " << function_name
+            << " will be repeated at least " << family_size << " times.\n";
+      }
+      // reserve in the special case the regex ".", since we know the final
+      // family size.
+      if (spec == ".") benchmarks->reserve(benchmarks->size() + family_size);
+
+      std::vector<size_t> selected;
+      std::vector<int64_t> args;
+      for (const auto& arglists : family->args_) {
+        size_t num_combinations = 1;
+        for (const auto& arglist : arglists) {
+          num_combinations *= arglist.size();
+        }
+        selected.clear();
+        if (prefix.size() > function_name.size()) {
+          SelectCombinations(*family, arglists, prefix, 0, function_name, 0, 1,
+                             &selected);
+          std::sort(selected.begin(), selected.end());
+          num_combinations = selected.size();
+        }
+
+        for (size_t i = 0; i < num_combinations; ++i) {
+          size_t index = selected.empty() ? i : selected[i];
+          args.clear();
+          for (const auto& arglist : arglists) {
+            args.push_back(arglist[index % arglist.size()]);
+            index /= arglist.size();
+          }
+          const std::string formatted_args =
+              BenchmarkInstance::FormatArgs(*family, args);
+          for (size_t t = 0; t < concurrencies.size(); ++t) {
+            names[t].args = formatted_args;
+            if (!matches(names[t].str())) continue;
+            benchmarks->emplace_back(
+                family.get(), family_index, per_family_instance_index, args,
+                concurrencies[t].first,
+                family->contender_ ? kABBaseline : kNotAB, variant,
+                concurrencies[t].second);
+            ++per_family_instance_index;
+
+            // The contender of an A/B pair comes right after its baseline.
+            if (family->contender_) {
+              benchmarks->emplace_back(family.get(), family_index,
+                                       per_family_instance_index, args,
+                                       concurrencies[t].first, kABContender,
+                                       variant, concurrencies[t].second);
+              ++per_family_instance_index;
+            }
+
+            // Only bump the next family index once we've estabilished that
+            // at least one instance of this family will be run.
+            if (next_family_index == family_index) ++next_family_index;
+          }
+        }
       }
     }
   }
@@ -191,8 +503,30 @@ Benchmark* RegisterBenchmarkInternal(Benchmark* bench) {
 // `BenchmarkFamilies`
 bool FindBenchmarksInternal(const std::string& re,
                             std::vector<BenchmarkInstance>* benchmarks,
-                            std::ostream* Err) {
-  return BenchmarkFamilies::GetInstance()->FindBenchmarks(re, benchmarks, Err);
+                            std::ostream* Err, const std::string& tags) {
+  return BenchmarkFamilies::GetInstance()->FindBenchmarks(re, tags, benchmarks,
+                                                          Err);
+}
+
+bool ParseTagSelection(const std::string& str, std::vector<TagTerm>* terms) {
+  terms->clear();
+  if (str.empty()) return true;
+  for (const std::string& term_str : StrSplit(str, ',')) {
+    TagTerm term;
+    term.excluded = !term_str.empty() && term_str[0] == '-';
+    term.tags = StrSplit(term_str.substr(term.excluded ? 1 : 0), '|');
+    if (term.tags.empty()) return false;
+    for (const std::string& tag : term.tags) {
+      if (!IsValidTag(tag)) return false;
+    }
+    terms->push_back(term);
+  }
+  return true;
+}
+
+bool IsValidTag(const std::string& tag) {
+  return !tag.empty() && tag[0] != '-' &&
+         tag.find_first_of(",|") == std::string::npos;
 }
 
 //=============================================================================//
@@ -205,20 +539,41 @@ Benchmark::Benchmark(const char* name)
       time_unit_(kNanosecond),
       range_multiplier_(kRangeMultiplier),
       min_time_(0),
+      min_warmup_time_(0),
+      target_relative_error_(0),
       iterations_(0),
+      memory_iterations_(0),
       repetitions_(0),
       measure_process_cpu_time_(false),
       use_real_time_(false),
       use_manual_time_(false),
+      use_cycle_clock_(false),
+      subtract_timer_overhead_(false),
+      use_spin_barrier_(false),
+      fixed_work_(false),
+      cold_cache_(false),
+      latency_sample_period_(0),
+      time_series_interval_(0),
+      throughput_interval_(0),
+      samples_(0),
+      target_rate_(0),
+      arrival_process_(kConstantArrivals),
+      thread_scaling_(false),
+      priority_(0),
+      template_variants_(false),
+      tune_strategy_(kTuneCoordinateDescent),
+      contender_(nullptr),
       complexity_(oNone),
-      complexity_lambda_(nullptr) {
+      complexity_lambda_(nullptr),
+      complexity_model_(kAdditiveComplexity),
+      pin_policy_(kPinDefault) {
   ComputeStatistics("mean", StatisticsMean);
   ComputeStatistics("median", StatisticsMedian);
   ComputeStatistics("stddev", StatisticsStdDev);
   ComputeStatistics("cv", StatisticsCV, kPercentage);
 }
 
-Benchmark::~Benchmark() {}
+Benchmark::~Benchmark() { delete contender_; }
 
 Benchmark* Benchmark::Name(const std::string& name) {
   SetName(name.c_str());
@@ -227,7 +582,7 @@ Benchmark* Benchmark::Name(const std::string& name) {
 
 Benchmark* Benchmark::Arg(int64_t x) {
   BM_CHECK(ArgsCnt() == -1 || ArgsCnt() == 1);
-  args_.push_back({x});
+  args_.push_back({{x}});
   return this;
 }
 
@@ -242,7 +597,7 @@ Benchmark* Benchmark::Range(int64_t start, int64_t limit) {
   AddRange(&arglist, start, limit, range_multiplier_);
 
   for (int64_t i : arglist) {
-    args_.push_back({i});
+    args_.push_back({{i}});
   }
   return this;
 }
@@ -265,30 +620,29 @@ Benchmark* Benchmark::ArgsProduct(
     const std::vector<std::vector<int64_t>>& arglists) {
   BM_CHECK(ArgsCnt() == -1 || ArgsCnt() == static_cast<int>(arglists.size()));
 
-  std::vector<std::size_t> indices(arglists.size());
-  const std::size_t total = std::accumulate(
-      std::begin(arglists), std::end(arglists), std::size_t{1},
-      [](const std::size_t res, const std::vector<int64_t>& arglist) {
-        return res * arglist.size();
-      });
-  std::vector<int64_t> args;
-  args.reserve(arglists.size());
-  for (std::size_t i = 0; i < total; i++) {
-    for (std::size_t arg = 0; arg < arglists.size(); arg++) {
-      args.push_back(arglists[arg][indices[arg]]);
-    }
-    args_.push_back(args);
-    args.clear();
+  // Kept as is, rather than expanded, since it may have far more combinations
+  // than the filter selects.
+  const bool empty = std::any_of(
+      arglists.begin(), arglists.end(),
+      [](const std::vector<int64_t>& arglist) { return arglist.empty(); });
+  if (!empty) args_.push_back(arglists);
 
-    std::size_t arg = 0;
-    do {
-      indices[arg] = (indices[arg] + 1) % arglists[arg].size();
-    } while (indices[arg++] == 0 && arg < arglists.size());
-  }
+  return this;
+}
 
+Benchmark* Benchmark::Multiversion(const std::vector<std::string>& variants) {
+  BM_CHECK(!variants.empty());
+  variants_ = variants;
+  template_variants_ = false;
   return this;
 }
 
+void Benchmark::SetTemplateVariants(
+    const std::vector<std::string>& template_args) {
+  variants_ = template_args;
+  template_variants_ = true;
+}
+
 Benchmark* Benchmark::ArgName(const std::string& name) {
   BM_CHECK(ArgsCnt() == -1 || ArgsCnt() == 1);
   arg_names_ = {name};
@@ -301,18 +655,69 @@ Benchmark* Benchmark::ArgNames(const std::vector<std::string>& names) {
   return this;
 }
 
+Benchmark* Benchmark::ArgStrings(size_t arg_index,
+                                  const std::vector<std::string>& values) {
+  BM_CHECK(!values.empty());
+  BM_CHECK(ArgsCnt() == -1 || static_cast<int>(arg_index) < ArgsCnt());
+  if (arg_value_names_.size() <= arg_index) {
+    arg_value_names_.resize(arg_index + 1);
+  }
+  arg_value_names_[arg_index] = values;
+  if (arg_index < arg_value_numbers_.size()) {
+    arg_value_numbers_[arg_index].clear();
+  }
+  return this;
+}
+
+Benchmark* Benchmark::ArgDoubles(size_t arg_index,
+                                  const std::vector<double>& values) {
+  std::vector<std::string> names;
+  names.reserve(values.size());
+  for (double value : values) names.push_back(StrFormat("%g", value));
+  ArgStrings(arg_index, names);
+  if (arg_value_numbers_.size() <= arg_index) {
+    arg_value_numbers_.resize(arg_index + 1);
+  }
+  arg_value_numbers_[arg_index] = values;
+  return this;
+}
+
 Benchmark* Benchmark::DenseRange(int64_t start, int64_t limit, int step) {
   BM_CHECK(ArgsCnt() == -1 || ArgsCnt() == 1);
   BM_CHECK_LE(start, limit);
   for (int64_t arg = start; arg <= limit; arg += step) {
-    args_.push_back({arg});
+    args_.push_back({{arg}});
+  }
+  return this;
+}
+
+Benchmark* Benchmark::CacheBoundaryRange(const std::vector<double>& fractions) {
+  BM_CHECK(ArgsCnt() == -1 || ArgsCnt() == 1);
+  const std::vector<std::pair<int64_t, std::string>> sizes =
+      CacheBoundarySizes(CPUCaches(), fractions, PageSize());
+  if (sizes.empty()) {
+    std::vector<int64_t> arglist;
+    AddPowers<int64_t>(&arglist, 1 << 10, 1 << 26, 8);
+    for (int64_t size : arglist) args_.push_back({{size}});
+    return this;
+  }
+  for (const auto& size : sizes) {
+    args_.push_back({{size.first}});
+    cache_targets_[size.first] = size.second;
   }
   return this;
 }
 
+Benchmark* Benchmark::CacheBoundaryRange() {
+  return CacheBoundaryRange({0.5, 0.9, 1.1, 2});
+}
+
 Benchmark* Benchmark::Args(const std::vector<int64_t>& args) {
   BM_CHECK(ArgsCnt() == -1 || ArgsCnt() == static_cast<int>(args.size()));
-  args_.push_back(args);
+  std::vector<std::vector<int64_t>> arglists;
+  arglists.reserve(args.size());
+  for (int64_t arg : args) arglists.push_back({arg});
+  args_.push_back(arglists);
   return this;
 }
 
@@ -334,13 +739,33 @@ Benchmark* Benchmark::MinTime(double t) {
   return this;
 }
 
+Benchmark* Benchmark::MinWarmUpTime(double t) {
+  BM_CHECK(t >= 0.0);
+  min_warmup_time_ = t;
+  return this;
+}
+
+Benchmark* Benchmark::TargetRelativeError(double relative_error) {
+  BM_CHECK(relative_error > 0.0);
+  BM_CHECK(iterations_ == 0);
+  target_relative_error_ = relative_error;
+  return this;
+}
+
 Benchmark* Benchmark::Iterations(IterationCount n) {
   BM_CHECK(n > 0);
   BM_CHECK(IsZero(min_time_));
+  BM_CHECK(IsZero(target_relative_error_));
   iterations_ = n;
   return this;
 }
 
+Benchmark* Benchmark::MemoryIterations(IterationCount n) {
+  BM_CHECK(n > 0);
+  memory_iterations_ = n;
+  return this;
+}
+
 Benchmark* Benchmark::Repetitions(int n) {
   BM_CHECK(n > 0);
   repetitions_ = n;
@@ -370,6 +795,8 @@ Benchmark* Benchmark::DisplayAggregatesOnly(bool value) {
 
 Benchmark* Benchmark::MeasureProcessCPUTime() {
   // Can be used together with UseRealTime() / UseManualTime().
+  BM_CHECK(!use_cycle_clock_)
+      << "Cannot set MeasureProcessCPUTime and UseCycleClock simultaneously.";
   measure_process_cpu_time_ = true;
   return this;
 }
@@ -388,6 +815,116 @@ Benchmark* Benchmark::UseManualTime() {
   return this;
 }
 
+Benchmark* Benchmark::UseCycleClock(bool subtract_overhead) {
+  BM_CHECK(!measure_process_cpu_time_)
+      << "Cannot set MeasureProcessCPUTime and UseCycleClock simultaneously.";
+  use_cycle_clock_ = true;
+  subtract_timer_overhead_ = subtract_overhead;
+  return this;
+}
+
+Benchmark* Benchmark::UseSpinBarrier() {
+  use_spin_barrier_ = true;
+  return this;
+}
+
+Benchmark* Benchmark::FixedWork() {
+  fixed_work_ = true;
+  return this;
+}
+
+Benchmark* Benchmark::ColdCache() {
+  cold_cache_ = true;
+  return this;
+}
+
+Benchmark* Benchmark::RecordLatencyHistogram(IterationCount sample_period) {
+  BM_CHECK_GT(sample_period, 0u);
+  latency_sample_period_ = sample_period;
+  return this;
+}
+
+Benchmark* Benchmark::RecordTimeSeries(double interval) {
+  BM_CHECK_GT(interval, 0.0);
+  time_series_interval_ = interval;
+  return this;
+}
+
+Benchmark* Benchmark::IntervalThroughput(double interval) {
+  BM_CHECK_GT(interval, 0.0);
+  throughput_interval_ = interval;
+  return this;
+}
+
+Benchmark* Benchmark::Samples(int samples) {
+  BM_CHECK_GT(samples, 0);
+  samples_ = samples;
+  return this;
+}
+
+Benchmark* Benchmark::TargetRate(double ops_per_second,
+                                 ArrivalProcess process) {
+  BM_CHECK_GT(ops_per_second, 0.0);
+  BM_CHECK(!use_manual_time_)
+      << "Cannot set TargetRate and UseManualTime simultaneously.";
+  target_rate_ = ops_per_second;
+  arrival_process_ = process;
+  use_real_time_ = true;
+  return this;
+}
+
+Benchmark* Benchmark::Tune(const std::vector<std::vector<int64_t>>& space,
+                           const std::string& objective,
+                           TuneStrategy strategy) {
+  BM_CHECK(args_.empty()) << "Cannot set args and tune them simultaneously.";
+  BM_CHECK(!space.empty());
+  BM_CHECK(std::none_of(
+      space.begin(), space.end(),
+      [](const std::vector<int64_t>& values) { return values.empty(); }));
+  tune_space_ = space;
+  tune_objective_ = objective;
+  tune_strategy_ = strategy;
+  return this;
+}
+
+Benchmark* Benchmark::ThreadScaling() {
+  thread_scaling_ = true;
+  return this;
+}
+
+Benchmark* Benchmark::CounterMatrix(const std::string& counter) {
+  BM_CHECK(!counter.empty());
+  matrix_counter_ = counter;
+  return this;
+}
+
+Benchmark* Benchmark::Priority(int priority) {
+  priority_ = priority;
+  return this;
+}
+
+Benchmark* Benchmark::Tags(const std::vector<std::string>& tags) {
+  for (const std::string& tag : tags) {
+    BM_CHECK(IsValidTag(tag)) << "invalid tag '" << tag << "'";
+    if (std::find(tags_.begin(), tags_.end(), tag) == tags_.end())
+      tags_.push_back(tag);
+  }
+  BenchmarkFamilies::GetInstance()->AddTags(this, tags);
+  return this;
+}
+
+Benchmark* Benchmark::CacheFingerprint(const std::string& fingerprint) {
+  cache_fingerprint_ = fingerprint;
+  return this;
+}
+
+Benchmark* Benchmark::CompareWith(Benchmark* contender) {
+  BM_CHECK(contender != nullptr && contender != this);
+  delete contender_;
+  contender_ = contender;
+  return this;
+}
+
 Benchmark* Benchmark::Complexity(BigO complexity) {
   complexity_ = complexity;
   return this;
@@ -399,6 +936,17 @@ Benchmark* Benchmark::Complexity(BigOFunc* complexity) {
   return this;
 }
 
+Benchmark* Benchmark::Complexity(const std::vector<BigO>& terms,
+                                 ComplexityModel model) {
+  BM_CHECK(!terms.empty());
+  BM_CHECK(std::none_of(terms.begin(), terms.end(), [](BigO term) {
+    return term == oNone || term == oAuto || term == oLambda;
+  })) << "Each term must have a fixed complexity";
+  complexity_terms_ = terms;
+  complexity_model_ = model;
+  return this;
+}
+
 Benchmark* Benchmark::ComputeStatistics(std::string name,
                                         StatisticsFunc* statistics,
                                         StatisticUnit unit) {
@@ -406,6 +954,18 @@ Benchmark* Benchmark::ComputeStatistics(std::string name,
   return this;
 }
 
+Benchmark* Benchmark::RobustStatistics() {
+  ComputeStatistics("min", StatisticsMin);
+  ComputeStatistics("max", StatisticsMax);
+  ComputeStatistics("p5", StatisticsP5);
+  ComputeStatistics("p95", StatisticsP95);
+  ComputeStatistics("mad", StatisticsMAD);
+  ComputeStatistics("trimmed_mean", StatisticsTrimmedMean);
+  ComputeStatistics("ci_low", StatisticsBootstrapLow);
+  ComputeStatistics("ci_high", StatisticsBootstrapHigh);
+  return this;
+}
+
 Benchmark* Benchmark::Threads(int t) {
   BM_CHECK_GT(t, 0);
   thread_counts_.push_back(t);
@@ -434,7 +994,87 @@ Benchmark* Benchmark::DenseThreadRange(int min_threads, int max_threads,
 }
 
 Benchmark* Benchmark::ThreadPerCpu() {
-  thread_counts_.push_back(CPUInfo::Get().num_cpus);
+  thread_counts_.push_back(NumCPUs());
+  return this;
+}
+
+namespace {
+
+// The counts of the topology presets, all of them NumCPUs() where the cpus of
+// the process are not known.
+TopologyThreadCounts GetTopologyThreadCounts() {
+  TopologyThreadCounts counts = CountTopologyThreads(GetAllowedCpus());
+  if (counts.cpus == 0) {
+    counts.package_cores = counts.cores = counts.cpus = NumCPUs();
+  }
+  return counts;
+}
+
+}  // namespace
+
+Benchmark* Benchmark::ThreadsPerPhysicalCore() {
+  thread_counts_.push_back(GetTopologyThreadCounts().cores);
+  if (pin_policy_ == kPinDefault) pin_policy_ = kPinCores;
+  return this;
+}
+
+Benchmark* Benchmark::ThreadsPerSocket() {
+  thread_counts_.push_back(GetTopologyThreadCounts().package_cores);
+  if (pin_policy_ == kPinDefault) pin_policy_ = kPinCores;
+  return this;
+}
+
+Benchmark* Benchmark::ThreadTopologySweep() {
+  const TopologyThreadCounts counts = GetTopologyThreadCounts();
+  const int sweep[] = {1, counts.package_cores, counts.cores, counts.cpus};
+  for (size_t i = 0; i < sizeof(sweep) / sizeof(sweep[0]); ++i) {
+    if (i == 0 || sweep[i] > sweep[i - 1]) thread_counts_.push_back(sweep[i]);
+  }
+  if (pin_policy_ == kPinDefault) pin_policy_ = kPinCores;
+  return this;
+}
+
+Benchmark* Benchmark::ThreadGroups(
+    const std::vector<std::pair<std::string, int>>& groups) {
+  BM_CHECK(!groups.empty());
+  int total = 0;
+  for (const auto& group : groups) {
+    BM_CHECK(!group.first.empty()) << "Thread groups must be named";
+    BM_CHECK_GT(group.second, 0);
+    total += group.second;
+  }
+  thread_groups_ = groups;
+  thread_counts_.assign(1, total);
+  return this;
+}
+
+Benchmark* Benchmark::InFlight(int n) {
+  BM_CHECK_GT(n, 0);
+  in_flight_counts_.push_back(n);
+  return this;
+}
+
+Benchmark* Benchmark::InFlightRange(int min_in_flight, int max_in_flight) {
+  BM_CHECK_GT(min_in_flight, 0);
+  BM_CHECK_GE(max_in_flight, min_in_flight);
+
+  AddRange(&in_flight_counts_, min_in_flight, max_in_flight, 2);
+  return this;
+}
+
+Benchmark* Benchmark::PinThreads(PinPolicy policy) {
+  BM_CHECK(policy != kPinCpuList)
+      << "Use PinThreads(cpus) to pin the threads to a list of cpus.";
+  pin_policy_ = policy;
+  pin_cpus_.clear();
+  return this;
+}
+
+Benchmark* Benchmark::PinThreads(const std::vector<int>& cpus) {
+  BM_CHECK(!cpus.empty());
+  BM_CHECK_GE(*std::min_element(cpus.begin(), cpus.end()), 0);
+  pin_policy_ = kPinCpuList;
+  pin_cpus_ = cpus;
   return this;
 }
 
@@ -454,8 +1094,96 @@ int Benchmark::ArgsCnt() const {
 
 void FunctionBenchmark::Run(State& st) { func_(st); }
 
+void TemplateProductBenchmark::Run(State& st) {
+  for (size_t i = 0; i < template_args_.size(); ++i) {
+    if (template_args_[i] == st.variant()) return funcs_[i](st);
+  }
+  BM_CHECK(false) << "No instantiation for " << st.variant();
+}
+
+std::string TypeNameFromSignature(const char* signature) {
+  const std::string s = signature;
+  // GCC: "... [with T = float; std::string = ...]", Clang: "... [T = float]",
+  // MSVC: "... TemplateArgName<float>::Get(void)".
+  size_t begin = s.find("T = ");
+  if (begin != std::string::npos) {
+    begin += 4;
+  } else {
+    begin = s.find("TemplateArgName<");
+    if (begin == std::string::npos) return s;
+    begin += 16;
+  }
+  size_t end = begin;
+  for (int depth = 0; end < s.size(); ++end) {
+    const char c = s[end];
+    if (c == '<' || c == '(' || c == '[') {
+      ++depth;
+    } else if (depth > 0 && (c == '>' || c == ')' || c == ']')) {
+      --depth;
+    } else if (depth == 0 && (c == ';' || c == ']' || c == '>')) {
+      break;
+    }
+  }
+  while (end > begin && s[end - 1] == ' ') --end;
+  std::string name = s.substr(begin, end - begin);
+  for (const char* prefix : {"class ", "struct ", "enum "}) {
+    if (name.compare(0, std::strlen(prefix), prefix) == 0) {
+      name.erase(0, std::strlen(prefix));
+    }
+  }
+  return name;
+}
+
+// What a Fixture shares between its runs: the shared state is built for the
+// scope named 'key', if 'built'.
+class SharedFixtureState {
+ public:
+  SharedFixtureState() : built(false) {}
+
+  Mutex mutex;
+  bool built GUARDED_BY(mutex);
+  std::string key GUARDED_BY(mutex);
+};
+
 }  // end namespace internal
 
+Fixture::Fixture(SharedScope scope)
+    : internal::Benchmark(""),
+      shared_scope_(scope),
+      shared_(new internal::SharedFixtureState) {}
+
+Fixture::~Fixture() { delete shared_; }
+
+void Fixture::Run(State& st) {
+  if (shared_scope_ != kPerRun) {
+    std::string key;
+    if (shared_scope_ == kPerRepetition) {
+      key = StrFormat("%016" PRIx64 "/%d/%" PRId64, st.seed(), st.threads(),
+                      st.repetition_index());
+    } else if (shared_scope_ == kPerArgs) {
+      // The seed is that of the args.
+      key = StrFormat("%016" PRIx64, st.seed());
+    }
+    // The first thread builds it, and the others wait for it.
+    MutexLock l(shared_->mutex);
+    if (!shared_->built || shared_->key != key) {
+      if (shared_->built) TearDownShared();
+      SetUpShared(st);
+      shared_->built = true;
+      shared_->key = key;
+    }
+  }
+  this->SetUp(st);
+  this->BenchmarkCase(st);
+  this->TearDown(st);
+}
+
+void Fixture::Finish() {
+  MutexLock l(shared_->mutex);
+  if (shared_->built) TearDownShared();
+  shared_->built = false;
+}
+
 void ClearRegisteredBenchmarks() {
   internal::BenchmarkFamilies::GetInstance()->ClearBenchmarks();
 }
@@ -476,4 +1204,15 @@ std::vector<int64_t> CreateDenseRange(int64_t start, int64_t limit,
   return args;
 }
 
+std::vector<int64_t> CreateCacheBoundaryRange(
+    const std::vector<double>& fractions) {
+  std::vector<int64_t> args;
+  for (const auto& size : internal::CacheBoundarySizes(
+           internal::CPUCaches(), fractions, internal::PageSize())) {
+    args.push_back(size.first);
+  }
+  if (args.empty()) internal::AddPowers<int64_t>(&args, 1 << 10, 1 << 26, 8);
+  return args;
+}
+
 }  // end namespace benchmark
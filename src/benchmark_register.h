@@ -2,8 +2,11 @@
 #define BENCHMARK_REGISTER_H
 
 #include <limits>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "benchmark/benchmark.h"
 #include "check.h"
 
 namespace benchmark {
@@ -102,6 +105,13 @@ void AddRange(std::vector<T>* dst, T lo, T hi, int mult) {
   }
 }
 
+// The working set sizes of Benchmark::CacheBoundaryRange() for 'caches' and
+// pages of 'page_size' bytes, in increasing order, each with the caches it
+// targets, or empty if none of 'caches' holds data.
+std::vector<std::pair<int64_t, std::string> > CacheBoundarySizes(
+    const std::vector<CPUInfo::CacheInfo>& caches,
+    const std::vector<double>& fractions, int64_t page_size);
+
 }  // namespace internal
 }  // namespace benchmark
 
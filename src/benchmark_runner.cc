@@ -26,11 +26,19 @@
 #include <unistd.h>
 #endif
 
+#if !defined(BENCHMARK_OS_WINDOWS) && !defined(BENCHMARK_OS_FUCHSIA) && \
+    !defined(BENCHMARK_OS_EMSCRIPTEN) && !defined(BENCHMARK_OS_NACL)
+#define BENCHMARK_HAS_FORK 1
+#include <sys/wait.h>
+#endif
+
 #include <algorithm>
 #include <atomic>
+#include <cerrno>
 #include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -39,19 +47,36 @@
 #include <utility>
 
 #include "absl/flags/flag.h"
+#include "arrival_schedule.h"
+#include "cache_flush.h"
+#include "calibration.h"
 #include "check.h"
 #include "colorprint.h"
 #include "complexity.h"
+#include "coordinator.h"
 #include "counter.h"
+#include "cpu_affinity.h"
+#include "cpu_frequency.h"
+#include "energy.h"
 #include "internal_macros.h"
+#include "latency_histogram.h"
+#include "live_metrics.h"
 #include "log.h"
+#include "measurement_checks.h"
 #include "mutex.h"
+#include "noise_monitor.h"
 #include "perf_counters.h"
+#include "perf_metrics.h"
 #include "re.h"
+#include "realtime.h"
+#include "run_serialization.h"
 #include "statistics.h"
 #include "string_util.h"
 #include "thread_manager.h"
+#include "thread_pool.h"
 #include "thread_timer.h"
+#include "time_series.h"
+#include "trace.h"
 
 namespace benchmark {
 
@@ -63,79 +88,329 @@ namespace {
 
 static constexpr IterationCount kMaxIterations = 1000000000;
 
+// When running until a target relative error, the minimum number of batches,
+// each of which runs for at least min_time / kMinBatches, and the multiple of
+// min_time after which to give up.
+static constexpr int kMinBatches = 5;
+static constexpr double kMaxTimeFactor = 10;
+
+// With RecordTimeSeries(), or live metrics, the number of chunks each
+// thread's iterations are split into, at the end of which the thread
+// publishes its progress.
+static constexpr IterationCount kProgressChunks = 1024;
+
+// The metric sets of --benchmark_perf_metrics on this cpu. If they can't be
+// measured here, that is said once, and there are none.
+const PerfMetrics& GetPerfMetrics() {
+  static const PerfMetrics* metrics = [] {
+    PerfMetrics* m = new PerfMetrics;
+    const std::vector<std::string> sets =
+        absl::GetFlag(FLAGS_benchmark_perf_metrics);
+    std::string error;
+    if (!sets.empty() &&
+        !PerfMetrics::Create(sets, PerfCounters::CorePmuName(), m, &error)) {
+      GetErrorLogInstance() << "Could not measure the perf metrics: " << error
+                            << "\n";
+    }
+    return m;
+  }();
+  return *metrics;
+}
+
 BenchmarkReporter::Run CreateRunReport(
     const benchmark::internal::BenchmarkInstance& b,
     const internal::ThreadManager::Result& results,
     IterationCount memory_iterations,
     const MemoryManager::Result& memory_result, double seconds,
-    int64_t repetition_index, int64_t repeats) {
+    int64_t repetition_index, int64_t repeats,
+    const PerfMetrics* perf_metrics = nullptr,
+    const std::vector<std::string>* perf_counter_names = nullptr) {
   // Create report about this benchmark run.
   BenchmarkReporter::Run report;
 
   report.run_name = b.name();
   report.family_index = b.family_index();
   report.per_family_instance_index = b.per_family_instance_index();
+  report.tags = b.tags();
   report.error_occurred = results.has_error_;
   report.error_message = results.error_message_;
   report.report_label = results.report_label_;
+  if (!b.cache_target().empty()) {
+    report.report_label = report.report_label.empty()
+                              ? b.cache_target()
+                              : b.cache_target() + " " + report.report_label;
+  }
   // This is the total iterations across all threads.
   report.iterations = results.iterations;
   report.time_unit = b.time_unit();
   report.threads = b.threads();
+  report.processes = results.processes;
+  report.in_flight = b.in_flight();
   report.repetition_index = repetition_index;
   report.repetitions = repeats;
+  report.cold_cache = results.cold_cache;
 
   if (!report.error_occurred) {
     if (b.use_manual_time()) {
       report.real_accumulated_time = results.manual_time_used;
     } else {
       report.real_accumulated_time = results.real_time_used;
+      report.real_time_overhead = results.real_time_overhead;
     }
     report.cpu_accumulated_time = results.cpu_time_used;
+    report.cpu_time_overhead = results.cpu_time_overhead;
+    // Of the benchmark loop, which is only timed by the benchmark itself with
+    // manual time.
+    if (absl::GetFlag(FLAGS_benchmark_check_measurements) &&
+        !results.has_error_ && !b.use_manual_time() &&
+        results.iterations > 0) {
+      const double threads =
+          static_cast<double>(b.threads() * results.processes);
+      const double slices =
+          static_cast<double>(std::max<int64_t>(results.timed_slices, 1));
+      // The real times are those of a thread, the CPU times their sum, but
+      // for those of the whole process.
+      const double real_slice =
+          b.use_cycle_clock() ? 0
+                              : (results.real_time_used +
+                                 results.real_time_overhead) *
+                                    threads / slices;
+      const double cpu_slice =
+          b.use_real_time() || b.use_cycle_clock() ||
+                  b.measure_process_cpu_time()
+              ? 0
+              : (results.cpu_time_used + results.cpu_time_overhead) / slices;
+      report.warnings = CheckMeasurements(
+          results.real_time_used * threads /
+              static_cast<double>(results.iterations),
+          real_slice, cpu_slice, GetMeasurementFloor());
+    }
     report.complexity_n = results.complexity_n;
+    report.complexity_ns = results.complexity_ns;
     report.complexity = b.complexity();
     report.complexity_lambda = b.complexity_lambda();
     report.statistics = &b.statistics();
     report.counters = results.counters;
+    report.thread_cpus = results.thread_cpus;
+    report.thread_numa_nodes = results.thread_numa_nodes;
+    report.time_series = results.time_series;
+    report.sample_times = results.sample_times;
+
+    const LatencyHistogram& latencies = results.latency_histogram;
+    if (latencies.count() > 0) {
+      // The histogram is in nanoseconds.
+      const double multiplier = GetTimeUnitMultiplier(b.time_unit()) / 1e9;
+      report.latency_samples = static_cast<int64_t>(latencies.count());
+      for (double p : {50.0, 90.0, 99.0, 99.9}) {
+        report.latency_percentiles.emplace_back(
+            p, latencies.Percentile(p) * multiplier);
+      }
+      for (const auto& bucket : latencies.Buckets()) {
+        report.latency_buckets.emplace_back(
+            static_cast<double>(bucket.first) * multiplier,
+            static_cast<int64_t>(bucket.second));
+      }
+    }
 
     if (memory_iterations > 0) {
       report.has_memory_result = true;
+      // Zero if not measured, as they were before they could be.
+      const int64_t kNotMeasured = MemoryManager::Result::TombstoneValue;
       report.allocs_per_iter =
-          memory_iterations ? static_cast<double>(memory_result.num_allocs) /
-                                  memory_iterations
-                            : 0;
-      report.max_bytes_used = memory_result.max_bytes_used;
+          memory_iterations && memory_result.num_allocs != kNotMeasured
+              ? static_cast<double>(memory_result.num_allocs) /
+                    memory_iterations
+              : 0;
+      report.max_bytes_used = memory_result.max_bytes_used != kNotMeasured
+                                  ? memory_result.max_bytes_used
+                                  : 0;
+      report.memory_iterations = memory_iterations;
+      report.memory_result = memory_result;
+    }
+
+    // From the totals of the perf counters, before they are made averages.
+    if (perf_metrics != nullptr) perf_metrics->Compute(&report.counters);
+    if (perf_counter_names != nullptr)
+      AddPerUnitCounters(*perf_counter_names, &report.counters);
+    // And the watts from the joules, over the time the run took, paused or
+    // not.
+    if (absl::GetFlag(FLAGS_benchmark_energy)) {
+      AddPowerCounters(results.real_time_used + results.real_time_overhead,
+                       &report.counters);
     }
 
+    // Of the items counted over the whole run, before they are made a rate.
+    const auto items = report.counters.find("items_per_second");
+    const double items_per_iteration =
+        items != report.counters.end() && results.iterations > 0
+            ? items->second.value / static_cast<double>(results.iterations)
+            : 0;
     internal::Finish(&report.counters, results.iterations, seconds,
-                     b.threads());
+                     b.threads() * results.processes);
+    AddIntervalThroughput(results.interval_rates, items_per_iteration,
+                          &report.counters);
+
+    for (const internal::ThreadManager::Result::RoleResult& role :
+         results.roles) {
+      BenchmarkReporter::RoleRun role_report;
+      role_report.name = role.name;
+      role_report.threads = role.threads;
+      role_report.iterations = role.iterations;
+      role_report.real_accumulated_time =
+          b.use_manual_time() ? role.manual_time_used : role.real_time_used;
+      role_report.cpu_accumulated_time = role.cpu_time_used;
+      role_report.counters = role.counters;
+      // The rates of the role are over the time of the run, which its
+      // threads all took part in.
+      internal::Finish(&role_report.counters, role.iterations, seconds,
+                       role.threads);
+      report.roles.push_back(role_report);
+    }
   }
   return report;
 }
 
+// Add the iterations and times of each thread in 'results' to 'report', and
+// how unevenly the threads took their time per iteration: the slowest over
+// the mean, and the coefficient of variation.
+void AddThreadBreakdown(const internal::ThreadManager::Result& results,
+                        BenchmarkReporter::Run* report) {
+  report->thread_iterations = results.thread_iterations;
+  report->thread_real_times = results.thread_real_times;
+  report->thread_cpu_times = results.thread_cpu_times;
+  std::vector<double> times;
+  for (size_t t = 0; t < results.thread_iterations.size(); ++t) {
+    if (results.thread_iterations[t] == 0) return;
+    times.push_back(results.thread_real_times[t] /
+                    static_cast<double>(results.thread_iterations[t]));
+  }
+  const double mean = StatisticsMean(times);
+  if (!(mean > 0)) return;
+  report->counters["thread_imbalance"] =
+      Counter(*std::max_element(times.begin(), times.end()) / mean);
+  report->counters["thread_cv"] = Counter(StatisticsCV(times));
+}
+
+// The --benchmark_noise_thresholds, which were validated at startup.
+std::map<std::string, double> GetNoiseThresholds() {
+  std::map<std::string, double> thresholds;
+  ParseNoiseThresholds(absl::GetFlag(FLAGS_benchmark_noise_thresholds),
+                       &thresholds);
+  return thresholds;
+}
+
 // Execute one thread of benchmark b for the specified number of iterations.
-// Adds the stats collected for the thread into manager->results.
+// Stores the stats collected for the thread into its own result slot of the
+// manager, to be reduced into manager->results once all threads are done.
 void RunInThread(const BenchmarkInstance* b, IterationCount iters,
                  int thread_id, ThreadManager* manager,
-                 PerfCountersMeasurement* perf_counters_measurement) {
+                 PerfCountersMeasurement* perf_counters_measurement,
+                 Profiler* profiler, const std::vector<int>& cpus,
+                 bool perf_counters_per_thread, int realtime_priority,
+                 bool noise_stats) {
+  // Pool workers and the main thread outlive the run, so put their affinity
+  // and scheduling back once done.
+  std::vector<int> previous_cpus;
+  const bool pinned =
+      !cpus.empty() && SetCurrentThreadAffinity(cpus, &previous_cpus);
+  ThreadScheduling previous_scheduling;
+  const bool realtime =
+      realtime_priority > 0 &&
+      SetCurrentThreadRealtime(realtime_priority, &previous_scheduling,
+                               nullptr);
   internal::ThreadTimer timer(
-      b->measure_process_cpu_time()
-          ? internal::ThreadTimer::CreateProcessCpuTime()
-          : internal::ThreadTimer::Create());
-  State st =
-      b->Run(iters, thread_id, &timer, manager, perf_counters_measurement);
-  BM_CHECK(st.error_occurred() || st.iterations() >= st.max_iterations)
+      b->use_cycle_clock()
+          ? internal::ThreadTimer::CreateCycleClock(
+                b->subtract_timer_overhead())
+          : b->measure_process_cpu_time()
+                ? internal::ThreadTimer::CreateProcessCpuTime()
+                : internal::ThreadTimer::Create());
+  internal::ThreadManager::Result& results =
+      manager->GetThreadResult(thread_id);
+  LatencyHistogram* latency_histogram = nullptr;
+  std::unique_ptr<ArrivalSchedule> arrivals;
+  if (b->target_rate() > 0) {
+    // Each thread takes its share of the rate, and times every iteration.
+    arrivals.reset(new ArrivalSchedule(b->target_rate() / b->threads(),
+                                       b->arrival_process(),
+                                       static_cast<uint64_t>(thread_id) + 1));
+    results.latency_histogram = LatencyHistogram(1);
+    latency_histogram = &results.latency_histogram;
+  } else if (b->latency_sample_period() != 0) {
+    results.latency_histogram = LatencyHistogram(b->latency_sample_period());
+    latency_histogram = &results.latency_histogram;
+  }
+  if (b->cold_cache()) {
+    FlushAllCaches();
+    results.cold_cache = true;
+  }
+  // The samples are chunks too, which the progress is published at the end
+  // of instead. Those of a FixedWork() run are of the share of a thread.
+  const IterationCount thread_iters =
+      b->fixed_work() ? std::max<IterationCount>(1, iters / b->threads())
+                      : iters;
+  const IterationCount progress_chunk =
+      manager->record_samples()
+          ? (thread_iters + b->samples() - 1) / b->samples()
+          : b->time_series_interval() > 0 || b->throughput_interval() > 0 ||
+                    GetLiveMetrics() != nullptr
+                ? std::max<IterationCount>(1, iters / kProgressChunks)
+                : 0;
+  std::unique_ptr<NoiseMonitor> noise_monitor;
+  if (noise_stats && (thread_id == 0 || NoiseMonitor::per_thread())) {
+    noise_monitor.reset(new NoiseMonitor);
+    noise_monitor->Start();
+  }
+  const double run_start = ChronoClockNow();
+  State st = b->Run(iters, thread_id, &timer, manager,
+                    perf_counters_measurement, latency_histogram,
+                    progress_chunk, arrivals.get(), profiler);
+  // The loop may not have started, if the benchmark skipped it.
+  results.setup_time = ChronoClockNow() - run_start;
+  if (results.loop_end > 0)
+    results.setup_time -= results.loop_end - results.loop_start;
+  // The threads of a FixedWork() run share the iterations.
+  BM_CHECK(st.error_occurred() || b->fixed_work() ||
+           st.iterations() >= st.max_iterations)
       << "Benchmark returned before State::KeepRunning() returned false!";
-  {
-    MutexLock l(manager->GetBenchmarkMutex());
-    internal::ThreadManager::Result& results = manager->results;
-    results.iterations += st.iterations();
-    results.cpu_time_used += timer.cpu_time_used();
-    results.real_time_used += timer.real_time_used();
-    results.manual_time_used += timer.manual_time_used();
-    results.complexity_n += st.complexity_length_n();
-    internal::Increment(&results.counters, st.counters);
+  results.iterations = st.iterations();
+  results.cpu_time_used = timer.cpu_time_used();
+  results.real_time_used = timer.real_time_used();
+  results.manual_time_used = timer.manual_time_used();
+  results.real_time_overhead = timer.real_time_overhead();
+  results.cpu_time_overhead = timer.cpu_time_overhead();
+  results.timed_slices = timer.num_slices();
+  results.complexity_n = st.complexity_length_n();
+  results.complexity_ns = st.complexity_lengths_n();
+  results.counters = st.counters;
+  if (noise_monitor) noise_monitor->Stop(&results.counters);
+  results.role = st.thread_role();
+  if (arrivals) {
+    results.counters["achieved_rate"] =
+        Counter(static_cast<double>(st.iterations()), Counter::kIsRate);
+  }
+  if (b->use_cycle_clock()) {
+    results.counters["cycles"] =
+        Counter(timer.cycles_used(), Counter::kAvgIterations);
+  }
+  if (perf_counters_per_thread && perf_counters_measurement != nullptr &&
+      b->threads() > 1 && st.iterations() > 0) {
+    // Only this thread has these, so the reduction over the threads keeps them
+    // as they are.
+    const std::string suffix = "/thread:" + std::to_string(thread_id);
+    for (const auto& m : perf_counters_measurement->GetMeasurements()) {
+      results.counters[m.name + suffix] =
+          Counter(m.value / static_cast<double>(st.iterations()));
+    }
+  }
+  if (pinned) {
+    int cpu, numa_node;
+    GetCurrentCpu(&cpu, &numa_node);
+    results.thread_cpus.assign(1, cpu);
+    results.thread_numa_nodes.assign(1, numa_node);
+    SetCurrentThreadAffinity(previous_cpus, nullptr);
   }
+  if (realtime) RestoreCurrentThreadScheduling(previous_scheduling);
   manager->NotifyThreadComplete();
 }
 
@@ -148,17 +423,48 @@ BenchmarkRunner::BenchmarkRunner(
       reports_for_family(reports_for_family_),
       min_time(!IsZero(b.min_time()) ? b.min_time()
                                      : absl::GetFlag(FLAGS_benchmark_min_time)),
+      min_warmup_time(b.min_warmup_time() > 0
+                          ? b.min_warmup_time()
+                          : absl::GetFlag(FLAGS_benchmark_min_warmup_time)),
+      warmup_done(!(min_warmup_time > 0)),
+      target_relative_error(!IsZero(b.target_relative_error())
+                                ? b.target_relative_error()
+                                : absl::GetFlag(FLAGS_benchmark_target_cv)),
+      batch_min_time(target_relative_error > 0 ? min_time / kMinBatches
+                                               : min_time),
       repeats(b.repetitions() != 0
                   ? b.repetitions()
                   : absl::GetFlag(FLAGS_benchmark_repetitions)),
       has_explicit_iteration_count(b.iterations() != 0),
-      pool(b.threads() - 1),
+      isolate_repetitions(absl::GetFlag(FLAGS_benchmark_isolation) ==
+                          "process"),
+      max_cpu_frequency_drop(
+          absl::GetFlag(FLAGS_benchmark_max_cpu_frequency_drop)),
+      sample_cpu_frequency(
+          absl::GetFlag(FLAGS_benchmark_report_cpu_frequency) ||
+          max_cpu_frequency_drop > 0),
       iters(has_explicit_iteration_count ? b.iterations() : 1),
-      perf_counters_measurement(
-          PerfCounters::Create(absl::GetFlag(FLAGS_benchmark_perf_counters))),
-      perf_counters_measurement_ptr(perf_counters_measurement.IsValid()
-                                        ? &perf_counters_measurement
-                                        : nullptr) {
+      perf_counter_names(absl::GetFlag(FLAGS_benchmark_perf_counters)),
+      perf_counters_per_thread(
+          absl::GetFlag(FLAGS_benchmark_perf_counters_per_thread)),
+      thread_breakdown(absl::GetFlag(FLAGS_benchmark_thread_breakdown)),
+      realtime_priority(absl::GetFlag(FLAGS_benchmark_realtime_priority)),
+      noise_thresholds(GetNoiseThresholds()),
+      noise_stats(absl::GetFlag(FLAGS_benchmark_noise_stats) ||
+                  !noise_thresholds.empty()),
+      noise_max_reruns(absl::GetFlag(FLAGS_benchmark_noise_max_reruns)),
+      energy_meter(absl::GetFlag(FLAGS_benchmark_energy) &&
+                           !GetEnergyMeter().domains().empty()
+                       ? &GetEnergyMeter()
+                       : nullptr),
+      harness_stats(GetHarnessStats()),
+      normalize_time(absl::GetFlag(FLAGS_benchmark_normalize_time)),
+      thread_perf_counters(static_cast<size_t>(b.threads())),
+      profile(!absl::GetFlag(FLAGS_benchmark_profile).empty()),
+      profile_mode(Profiler::kInstructions),
+      profile_dir(absl::GetFlag(FLAGS_benchmark_profile_dir)),
+      thread_profilers(static_cast<size_t>(b.threads())),
+      thread_profiler_errors(static_cast<size_t>(b.threads())) {
   run_results.display_report_aggregates_only =
       (absl::GetFlag(FLAGS_benchmark_report_aggregates_only) ||
        absl::GetFlag(FLAGS_benchmark_display_aggregates_only));
@@ -170,77 +476,353 @@ BenchmarkRunner::BenchmarkRunner(
          internal::ARM_DisplayReportAggregatesOnly);
     run_results.file_report_aggregates_only =
         (b.aggregation_report_mode() & internal::ARM_FileReportAggregatesOnly);
-    BM_CHECK(absl::GetFlag(FLAGS_benchmark_perf_counters).empty() ||
-             perf_counters_measurement.IsValid())
-        << "Perf counters were requested but could not be set up.";
   }
+
+  PinPolicy pin_policy = b.pin_policy();
+  std::vector<int> pin_cpus = b.pin_cpus();
+  if (pin_policy == kPinDefault) {
+    // Already validated in ValidateCommandLineFlags().
+    ParseCpuAffinity(absl::GetFlag(FLAGS_benchmark_cpu_affinity), &pin_policy,
+                     &pin_cpus);
+  }
+  thread_cpus =
+      AssignThreadCpus(pin_policy, pin_cpus, b.threads(), GetAllowedCpus());
+  for (const std::string& name : GetPerfMetrics().counter_names()) {
+    if (std::find(perf_counter_names.begin(), perf_counter_names.end(),
+                  name) == perf_counter_names.end()) {
+      perf_counter_names.push_back(name);
+    }
+  }
+  // Already validated in ValidateCommandLineFlags().
+  if (profile) {
+    Profiler::ParseMode(absl::GetFlag(FLAGS_benchmark_profile), &profile_mode);
+  }
+}
+
+void BenchmarkRunner::SetIterationsHint(IterationCount hint) {
+  // The iterations reported with a target relative error are those of all
+  // the batches, which are each only a fraction of that.
+  if (has_explicit_iteration_count || target_relative_error > 0) return;
+  iterations_hint = std::min(hint, kMaxIterations);
+}
+
+bool BenchmarkRunner::CanRunConcurrently(size_t num_cpus) const {
+  // The process' CPU time would include that of the other benchmarks, and
+  // the pinned threads would run on the cpus of the others.
+  return static_cast<size_t>(b.threads()) <= num_cpus &&
+         !b.measure_process_cpu_time() && thread_cpus[0].empty();
+}
+
+PerfCountersMeasurement* BenchmarkRunner::GetPerfCountersForThread(
+    int thread_id) {
+  if (perf_counter_names.empty()) return nullptr;
+  std::unique_ptr<PerfCountersMeasurement>& counters =
+      thread_perf_counters[static_cast<size_t>(thread_id)];
+  if (!counters) {
+    // The events of the threads the benchmark itself spawns are only counted
+    // if their CPU time is measured too.
+    counters.reset(new PerfCountersMeasurement(PerfCounters::Create(
+        perf_counter_names, /*inherit=*/b.measure_process_cpu_time())));
+  }
+  BM_CHECK(counters->IsValid())
+      << "Perf counters were requested but could not be set up.";
+  return counters.get();
+}
+
+Profiler* BenchmarkRunner::GetProfilerForThread(int thread_id) {
+  if (!profiling) return nullptr;
+  std::unique_ptr<Profiler>& profiler =
+      thread_profilers[static_cast<size_t>(thread_id)];
+  std::string& error = thread_profiler_errors[static_cast<size_t>(thread_id)];
+  if (!profiler && error.empty()) {
+    profiler = Profiler::Create(profile_mode, &error);
+    if (!profiler) {
+      GetErrorLogInstance() << "Could not profile " << b.name().str() << ": "
+                            << error << "\n";
+    }
+  }
+  return profiler.get();
+}
+
+std::string BenchmarkRunner::WriteThreadProfiles() {
+  std::vector<const Profiler*> profilers;
+  for (const std::unique_ptr<Profiler>& profiler : thread_profilers) {
+    if (profiler) profilers.push_back(profiler.get());
+  }
+  std::string path;
+  if (!profilers.empty()) {
+    path = ProfilePath(profile_dir, b.name().str(), profile_mode);
+    if (!WriteProfile(b.name().str(), profile_mode, profilers, path)) {
+      GetErrorLogInstance() << "Could not write the profile of "
+                            << b.name().str() << " to " << path << "\n";
+      path.clear();
+    }
+  }
+  for (auto& profiler : thread_profilers) profiler.reset();
+  for (auto& error : thread_profiler_errors) error.clear();
+  return path;
+}
+
+void BenchmarkRunner::DoMemoryIterations(IterationCount memory_iterations) {
+  TraceScope trace("runner", "memory");
+  trace.AddArg("iterations", memory_iterations);
+  if (Tracer* tracer = GetTracer()) tracer->StartRun();
+  std::unique_ptr<internal::ThreadManager> manager;
+  manager.reset(
+      new internal::ThreadManager(b.threads(), b.use_spin_barrier()));
+  manager->set_repetition_index(num_repetitions_done);
+  if (b.fixed_work()) manager->ShareIterations(memory_iterations);
+  auto run_thread = [this, &manager, memory_iterations](int thread_id) {
+    memory_manager->StartThread(thread_id);
+    RunInThread(&b, memory_iterations, thread_id, manager.get(),
+                GetPerfCountersForThread(thread_id), nullptr,
+                thread_cpus[thread_id], perf_counters_per_thread,
+                realtime_priority, false);
+    memory_manager->StopThread(thread_id);
+  };
+  ThreadPool& pool = thread_pool ? *thread_pool : ThreadPool::Get();
+  pool.Dispatch(b.threads(), run_thread);
+  run_thread(0);
+  manager->WaitForAllThreads();
+  pool.WaitForIdle();
 }
 
 BenchmarkRunner::IterationResults BenchmarkRunner::DoNIterations() {
   BM_VLOG(2) << "Running " << b.name().str() << " for " << iters << "\n";
+  TraceScope trace("runner", "iterations");
+  trace.AddArg("iterations", iters);
+  if (Tracer* tracer = GetTracer()) tracer->StartRun();
+  const double start = ChronoClockNow();
 
   std::unique_ptr<internal::ThreadManager> manager;
-  manager.reset(new internal::ThreadManager(b.threads()));
+  manager.reset(
+      new internal::ThreadManager(b.threads(), b.use_spin_barrier()));
+  manager->set_repetition_index(num_repetitions_done);
+  manager->set_record_samples(b.samples() > 0 &&
+                              b.latency_sample_period() == 0 &&
+                              b.target_rate() == 0 && !b.use_manual_time());
+  if (b.fixed_work()) manager->ShareIterations(iters);
+  std::unique_ptr<TimeSeriesSampler> sampler;
+  LiveMetrics* const live_metrics = GetLiveMetrics();
+  // The rates of IntervalThroughput() are those between the samples of the
+  // time series, if there is one.
+  const double sample_interval =
+      b.time_series_interval() > 0
+          ? b.time_series_interval()
+          : b.throughput_interval() > 0
+                ? b.throughput_interval()
+                : absl::GetFlag(FLAGS_benchmark_metrics_interval);
+  if (b.time_series_interval() > 0 || b.throughput_interval() > 0 ||
+      live_metrics != nullptr) {
+    sampler.reset(new TimeSeriesSampler(manager.get(), sample_interval,
+                                        live_metrics, b.name().str()));
+  }
 
-  // Run all but one thread in separate threads
-  for (std::size_t ti = 0; ti < pool.size(); ++ti) {
-    pool[ti] = std::thread(&RunInThread, &b, iters, static_cast<int>(ti + 1),
-                           manager.get(), perf_counters_measurement_ptr);
+  // The other processes start at the same time, as their threads would.
+  Coordinator* const coordinator = GetCoordinator();
+  if (coordinator != nullptr) {
+    std::string error;
+    if (!coordinator->StartRun(b.name().str(), iters, num_repetitions_done,
+                               &error)) {
+      IterationResults i;
+      i.results.has_error_ = true;
+      i.results.error_message_ = "could not coordinate the run: " + error;
+      i.iters = iters;
+      i.seconds = 0;
+      i.cpu_frequency = 0;
+      return i;
+    }
   }
+
+  // The energy of the package, over the whole of the run.
+  const std::vector<uint64_t> energy_start =
+      energy_meter ? energy_meter->Read() : std::vector<uint64_t>();
+
+  // Run all but one thread on the (persistent) worker threads of the pool.
+  ThreadPool& pool = thread_pool ? *thread_pool : ThreadPool::Get();
+  pool.Dispatch(b.threads(), [this, &manager](int thread_id) {
+    RunInThread(&b, iters, thread_id, manager.get(),
+                GetPerfCountersForThread(thread_id),
+                GetProfilerForThread(thread_id), thread_cpus[thread_id],
+                perf_counters_per_thread, realtime_priority, noise_stats);
+  });
   // And run one thread here directly.
-  // (If we were asked to run just one thread, we don't create new threads.)
+  // (If we were asked to run just one thread, we don't use the pool at all.)
   // Yes, we need to do this here *after* we start the separate threads.
-  RunInThread(&b, iters, 0, manager.get(), perf_counters_measurement_ptr);
+  // The frequency is that of the core this thread runs on.
+  std::unique_ptr<CpuFrequencyMonitor> frequency_monitor;
+  if (sample_cpu_frequency) {
+    frequency_monitor.reset(new CpuFrequencyMonitor);
+    frequency_monitor->Start();
+  }
+  RunInThread(&b, iters, 0, manager.get(), GetPerfCountersForThread(0),
+              GetProfilerForThread(0), thread_cpus[0],
+              perf_counters_per_thread, realtime_priority, noise_stats);
+  const double cpu_frequency =
+      frequency_monitor ? frequency_monitor->Stop() : 0;
 
   // The main thread has finished. Now let's wait for the other threads.
   manager->WaitForAllThreads();
-  for (std::thread& thread : pool) thread.join();
+  pool.WaitForIdle();
+  manager->ReduceThreadResults();
 
   IterationResults i;
+  i.cpu_frequency = cpu_frequency;
+  const internal::ThreadManager::Result& main_thread =
+      manager->GetThreadResult(0);
+  i.loop_seconds = main_thread.loop_end - main_thread.loop_start;
+  i.timed_seconds = main_thread.real_time_used;
+  i.setup_seconds = main_thread.setup_time;
   // Acquire the measurements/counters from the manager, UNDER THE LOCK!
   {
     MutexLock l(manager->GetBenchmarkMutex());
     i.results = manager->results;
   }
+  if (energy_meter) energy_meter->AddEnergy(energy_start, &i.results.counters);
+  if (sampler) {
+    std::vector<BenchmarkReporter::TimeSeriesSample> samples = sampler->Stop();
+    if (b.throughput_interval() > 0)
+      i.results.interval_rates = IntervalRates(samples, sample_interval);
+    if (b.time_series_interval() > 0) i.results.time_series.swap(samples);
+  }
 
   // And get rid of the manager.
   manager.reset();
 
-  // Adjust real/manual time stats since they were reported per thread.
-  i.results.real_time_used /= b.threads();
-  i.results.manual_time_used /= b.threads();
+  if (coordinator != nullptr) {
+    std::string error;
+    if (!coordinator->FinishRun(&i.results, &error) &&
+        !i.results.has_error_) {
+      i.results.has_error_ = true;
+      i.results.error_message_ = "could not coordinate the run: " + error;
+    }
+  }
+
+  // Adjust real/manual time stats since they were reported per thread, by
+  // the threads of all the processes that ran.
+  const int threads = b.threads() * i.results.processes;
+  i.results.real_time_used /= threads;
+  i.results.manual_time_used /= threads;
+  i.results.real_time_overhead /= threads;
+  // Those of the threads of this process only, which the workers don't send.
+  // Those of a FixedWork() run are each of a single thread already.
+  if (!b.fixed_work()) {
+    for (double& sample_time : i.results.sample_times)
+      sample_time /= b.threads();
+  }
   // If we were measuring whole-process CPU usage, adjust the CPU time too.
-  if (b.measure_process_cpu_time()) i.results.cpu_time_used /= b.threads();
+  if (b.measure_process_cpu_time()) {
+    i.results.cpu_time_used /= threads;
+    i.results.cpu_time_overhead /= threads;
+  }
+  // And those of each role, by the threads of the role.
+  for (internal::ThreadManager::Result::RoleResult& role : i.results.roles) {
+    role.real_time_used /= role.threads;
+    role.manual_time_used /= role.threads;
+    if (b.measure_process_cpu_time()) role.cpu_time_used /= role.threads;
+  }
 
   BM_VLOG(2) << "Ran in " << i.results.cpu_time_used << "/"
              << i.results.real_time_used << "\n";
 
   // By using KeepRunningBatch a benchmark can iterate more times than
   // requested, so take the iteration count from i.results.
-  i.iters = i.results.iterations / b.threads();
+  // Those of a FixedWork() run are a budget of all the threads.
+  i.iters = b.fixed_work() ? i.results.iterations
+                           : i.results.iterations / threads;
 
-  // Base decisions off of real time if requested by this benchmark.
-  i.seconds = i.results.cpu_time_used;
+  // Base decisions off of real time if requested by this benchmark. The
+  // time spent pausing the timer counts: it is time the run took all the same,
+  // and without it, a benchmark that does little but pause could be run for
+  // ever more iterations.
+  i.seconds = i.results.cpu_time_used + i.results.cpu_time_overhead;
   if (b.use_manual_time()) {
     i.seconds = i.results.manual_time_used;
   } else if (b.use_real_time()) {
-    i.seconds = i.results.real_time_used;
+    i.seconds = i.results.real_time_used + i.results.real_time_overhead;
   }
+  i.wall_seconds = ChronoClockNow() - start;
 
   return i;
 }
 
+BenchmarkRunner::IterationResults BenchmarkRunner::DoBatchesUntilPrecise(
+    IterationResults i, double* relative_error) {
+  std::vector<double> batch_times(1, i.seconds / i.iters);
+  for (;;) {
+    if (batch_times.size() >= static_cast<size_t>(kMinBatches) &&
+        StatisticsRelativeError(batch_times) <= target_relative_error)
+      break;
+    if (batch_times.size() >= 2 && i.seconds >= kMaxTimeFactor * min_time)
+      break;
+
+    IterationResults batch = DoNIterations();
+    if (batch.results.has_error_) return batch;
+    batch_times.push_back(batch.seconds / batch.iters);
+
+    // The batches add up, like the threads of a run do.
+    i.results.iterations += batch.results.iterations;
+    i.results.real_time_used += batch.results.real_time_used;
+    i.results.cpu_time_used += batch.results.cpu_time_used;
+    i.results.manual_time_used += batch.results.manual_time_used;
+    i.results.real_time_overhead += batch.results.real_time_overhead;
+    i.results.cpu_time_overhead += batch.results.cpu_time_overhead;
+    i.results.timed_slices += batch.results.timed_slices;
+    Increment(&i.results.counters, batch.results.counters);
+    for (size_t t = 0; t < i.results.thread_iterations.size(); ++t) {
+      i.results.thread_iterations[t] += batch.results.thread_iterations[t];
+      i.results.thread_real_times[t] += batch.results.thread_real_times[t];
+      i.results.thread_cpu_times[t] += batch.results.thread_cpu_times[t];
+    }
+    for (size_t r = 0; r < i.results.roles.size(); ++r) {
+      internal::ThreadManager::Result::RoleResult& role = i.results.roles[r];
+      const internal::ThreadManager::Result::RoleResult& batch_role =
+          batch.results.roles[r];
+      role.iterations += batch_role.iterations;
+      role.real_time_used += batch_role.real_time_used;
+      role.cpu_time_used += batch_role.cpu_time_used;
+      role.manual_time_used += batch_role.manual_time_used;
+      Increment(&role.counters, batch_role.counters);
+    }
+    i.results.latency_histogram.Merge(batch.results.latency_histogram);
+    i.results.sample_times.insert(i.results.sample_times.end(),
+                                  batch.results.sample_times.begin(),
+                                  batch.results.sample_times.end());
+    AppendTimeSeries(&i.results.time_series, batch.results.time_series);
+    i.results.interval_rates.insert(i.results.interval_rates.end(),
+                                    batch.results.interval_rates.begin(),
+                                    batch.results.interval_rates.end());
+    // The mean frequency over the batches, weighted by how long they ran.
+    if (i.cpu_frequency > 0 && batch.cpu_frequency > 0) {
+      i.cpu_frequency = (i.cpu_frequency * i.seconds +
+                         batch.cpu_frequency * batch.seconds) /
+                        (i.seconds + batch.seconds);
+    }
+    i.iters += batch.iters;
+    i.seconds += batch.seconds;
+    i.wall_seconds += batch.wall_seconds;
+    i.loop_seconds += batch.loop_seconds;
+    i.timed_seconds += batch.timed_seconds;
+    i.setup_seconds += batch.setup_seconds;
+  }
+  *relative_error = StatisticsRelativeError(batch_times);
+  BM_VLOG(2) << "Ran " << batch_times.size() << " batches, relative error "
+             << *relative_error << "\n";
+  return i;
+}
+
 IterationCount BenchmarkRunner::PredictNumItersNeeded(
     const IterationResults& i) const {
+  const double min_time_to_apply = GetMinTimeToApply();
   // See how much iterations should be increased by.
   // Note: Avoid division by zero with max(seconds, 1ns).
-  double multiplier = min_time * 1.4 / std::max(i.seconds, 1e-9);
+  double multiplier = min_time_to_apply * 1.4 / std::max(i.seconds, 1e-9);
   // If our last run was at least 10% of FLAGS_benchmark_min_time then we
   // use the multiplier directly.
   // Otherwise we use at most 10 times expansion.
   // NOTE: When the last run was at least 10% of the min time the max
   // expansion should be 14x.
-  bool is_significant = (i.seconds / min_time) > 0.1;
+  bool is_significant = (i.seconds / min_time_to_apply) > 0.1;
   multiplier = is_significant ? multiplier : 10.0;
 
   // So what seems to be the sufficiently-large iteration count? Round up.
@@ -259,19 +841,170 @@ bool BenchmarkRunner::ShouldReportIterationResults(
   // Determine if this run should be reported;
   // Either it has run for a sufficient amount of time
   // or because an error was reported.
+  const double min_time_to_apply = GetMinTimeToApply();
   return i.results.has_error_ ||
-         i.iters >= kMaxIterations ||  // Too many iterations already.
-         i.seconds >= min_time ||      // The elapsed time is large enough.
+         i.iters >= kMaxIterations ||      // Too many iterations already.
+         i.seconds >= min_time_to_apply ||  // The elapsed time is large enough.
          // CPU time is specified but the elapsed real time greatly exceeds
          // the minimum time.
          // Note that user provided timers are except from this sanity check.
-         ((i.results.real_time_used >= 5 * min_time) && !b.use_manual_time());
+         ((i.results.real_time_used >= 5 * min_time_to_apply) &&
+          !b.use_manual_time());
+}
+
+void BenchmarkRunner::RunWarmUp() {
+  // The iteration count is estimated for the warm-up in the same way as it is
+  // for measuring, so that min_warmup_time means the same as min_time, but
+  // it is then started from scratch: the measuring may size its runs
+  // differently.
+  TraceScope trace("runner", "warm-up");
+  const IterationCount iters_backup = iters;
+  for (;;) {
+    const IterationResults i = DoNIterations();
+    AddHarnessTime(HarnessStats::kProbing, i.wall_seconds);
+    if (ShouldReportIterationResults(i)) break;
+    iters = PredictNumItersNeeded(i);
+  }
+  iters = iters_backup;
+  warmup_done = true;
+}
+
+void BenchmarkRunner::AddHarnessTime(HarnessStats::Phase phase,
+                                     double seconds) {
+  if (harness_stats) harness_stats->Add(b.name().str(), phase, seconds);
+}
+
+void BenchmarkRunner::AddHarnessTimes(const IterationResults& i) {
+  if (!harness_stats) return;
+  // The loop is timed or paused, and the run is in the benchmark, or in
+  // starting and joining the threads.
+  AddHarnessTime(HarnessStats::kTimed, i.timed_seconds);
+  AddHarnessTime(HarnessStats::kPaused,
+                 std::max(0.0, i.loop_seconds - i.timed_seconds));
+  AddHarnessTime(HarnessStats::kSetup, i.setup_seconds);
+  AddHarnessTime(
+      HarnessStats::kThreads,
+      std::max(0.0, i.wall_seconds - i.loop_seconds - i.setup_seconds));
 }
 
 void BenchmarkRunner::DoOneRepetition() {
   assert(HasRepeatsRemaining() && "Already done all repetitions?");
 
-  const bool is_the_first_repetition = num_repetitions_done == 0;
+  const std::string name = GetTracer() != nullptr ? b.name().str() : "";
+  TraceScope trace("runner", name);
+  trace.AddArg("repetition", num_repetitions_done);
+  const double start = ChronoClockNow();
+  BenchmarkReporter::Run report;
+  for (int reruns = 0;; ++reruns) {
+    report =
+        isolate_repetitions ? RunRepetitionInChildProcess() : RunRepetition();
+    const std::string noise =
+        report.error_occurred
+            ? std::string()
+            : ExceededNoiseThreshold(report.counters, noise_thresholds);
+    if (noise.empty() || reruns == noise_max_reruns) {
+      if (reruns > 0) report.counters["noise_reruns"] = Counter(reruns);
+      break;
+    }
+    BM_VLOG(1) << "Running " << b.name().str() << " again for its noise ("
+               << noise << ")\n";
+  }
+
+  if (max_cpu_frequency_drop > 0 && highest_cpu_frequency != nullptr &&
+      !report.error_occurred && report.cpu_frequency > 0) {
+    const double highest = highest_cpu_frequency->Update(report.cpu_frequency);
+    if (IsCpuFrequencyDrop(report.cpu_frequency, highest,
+                           max_cpu_frequency_drop)) {
+      report.error_occurred = true;
+      report.error_message = StrFormat(
+          "the cpu ran at %.0f MHz, more than %.0f%% below the %.0f MHz it "
+          "ran at before",
+          report.cpu_frequency * 1e-6, max_cpu_frequency_drop * 100,
+          highest * 1e-6);
+    }
+  }
+
+  Calibration calibration;
+  if (!normalize_time.empty() && !report.error_occurred &&
+      report.iterations > 0 && GetCalibration(&calibration)) {
+    const double kernel_ns = CalibrationKernelNs(calibration, normalize_time);
+    if (kernel_ns > 0) {
+      report.counters["normalized_time"] =
+          Counter(report.real_accumulated_time * 1e9 /
+                  static_cast<double>(report.iterations) / kernel_ns);
+    }
+  }
+
+  AddRepetition(report);
+  last_repetition_seconds = ChronoClockNow() - start;
+  if (harness_stats)
+    harness_stats->AddRepetition(b.name().str(), last_repetition_seconds);
+}
+
+void BenchmarkRunner::RestoreRepetition(const BenchmarkReporter::Run& report,
+                                        IterationCount iterations) {
+  assert(HasRepeatsRemaining() && "Already done all repetitions?");
+  // What the report points to is not kept.
+  BenchmarkReporter::Run restored = report;
+  if (!restored.error_occurred) {
+    restored.complexity_lambda = b.complexity_lambda();
+    restored.statistics = &b.statistics();
+  }
+  AddRepetition(restored);
+  iters = iterations;
+}
+
+void BenchmarkRunner::AddRepetition(const BenchmarkReporter::Run& report) {
+  if (reports_for_family) {
+    ++reports_for_family->num_runs_done;
+    if (!report.error_occurred) reports_for_family->Runs.push_back(report);
+  }
+
+  run_results.non_aggregates.push_back(report);
+  stats_accumulator.Add(report);
+
+  ++num_repetitions_done;
+  if (!report.error_occurred) iterations_found = true;
+}
+
+void BenchmarkRunner::RunForCoordinator(IterationCount n,
+                                        int64_t repetition_index) {
+  iters = n;
+  num_repetitions_done = static_cast<int>(repetition_index);
+  DoNIterations();
+}
+
+double BenchmarkRunner::GetRepetitionsCV() const {
+  std::vector<double> times;
+  for (const BenchmarkReporter::Run& run : run_results.non_aggregates) {
+    if (!run.error_occurred && run.iterations > 0) {
+      times.push_back(run.GetAdjustedRealTime());
+    }
+  }
+  if (times.size() < 2) return 0;
+  return StatisticsCV(times);
+}
+
+void BenchmarkRunner::StopRepeating(const std::string& reason) {
+  if (!HasRepeatsRemaining()) return;
+  int left = repeats - num_repetitions_done;
+  if (num_repetitions_done == 0) {
+    AddRepetition(CreateErrorReport(reason));
+    --left;
+  }
+  if (reports_for_family) reports_for_family->num_runs_total -= left;
+  repeats = num_repetitions_done;
+  stopped_repeating = true;
+}
+
+BenchmarkReporter::Run BenchmarkRunner::RunRepetition() {
+  if (!warmup_done) RunWarmUp();
+
+  // A repetition that failed, e.g. in a child process that crashed, need not
+  // have found the iteration count.
+  const bool is_the_first_repetition = !iterations_found;
+  if (is_the_first_repetition && iterations_hint > 0) iters = iterations_hint;
+  profiling = profile && num_repetitions_done + 1 == repeats;
   IterationResults i;
 
   // We *may* be gradually increasing the length (iteration count)
@@ -281,6 +1014,10 @@ void BenchmarkRunner::DoOneRepetition() {
   // is *only* calculated for the *first* repetition, and other repetitions
   // simply use that precomputed iteration count.
   for (;;) {
+    // Only the samples of the run that is reported are kept.
+    for (auto& profiler : thread_profilers) {
+      if (profiler) profiler->Clear();
+    }
     i = DoNIterations();
 
     // Do we consider the results to be significant?
@@ -293,6 +1030,7 @@ void BenchmarkRunner::DoOneRepetition() {
                                          ShouldReportIterationResults(i);
 
     if (results_are_significant) break;  // Good, let's report them!
+    AddHarnessTime(HarnessStats::kProbing, i.wall_seconds);
 
     // Nope, bad iteration. Let's re-estimate the hopefully-sufficient
     // iteration count, and run the benchmark again...
@@ -303,44 +1041,167 @@ void BenchmarkRunner::DoOneRepetition() {
            "then we should have accepted the current iteration run.");
   }
 
+  double relative_error = 0;
+  if (target_relative_error > 0 && !has_explicit_iteration_count &&
+      !i.results.has_error_)
+    i = DoBatchesUntilPrecise(i, &relative_error);
+  AddHarnessTimes(i);
+
   // Oh, one last thing, we need to also produce the 'memory measurements'..
   MemoryManager::Result memory_result;
   IterationCount memory_iterations = 0;
   if (memory_manager != nullptr) {
     // Only run a few iterations to reduce the impact of one-time
     // allocations in benchmarks that are not properly managed.
-    memory_iterations = std::min<IterationCount>(16, iters);
+    const IterationCount thread_iterations =
+        b.memory_iterations() > 0 ? b.memory_iterations()
+                                  : std::min<IterationCount>(16, iters);
+    const double memory_start = ChronoClockNow();
     memory_manager->Start();
-    std::unique_ptr<internal::ThreadManager> manager;
-    manager.reset(new internal::ThreadManager(1));
-    RunInThread(&b, memory_iterations, 0, manager.get(),
-                perf_counters_measurement_ptr);
-    manager->WaitForAllThreads();
-    manager.reset();
-
+    DoMemoryIterations(thread_iterations);
     memory_manager->Stop(&memory_result);
+    AddHarnessTime(HarnessStats::kMemory, ChronoClockNow() - memory_start);
+    // Over all the threads, as the iterations of the report are.
+    memory_iterations =
+        b.fixed_work() ? thread_iterations : thread_iterations * b.threads();
   }
 
+  for (auto& counters : thread_perf_counters) counters.reset();
+  const std::string profile_file = profiling ? WriteThreadProfiles() : "";
+  profiling = false;
+
   // Ok, now actually report.
   BenchmarkReporter::Run report =
       CreateRunReport(b, i.results, memory_iterations, memory_result, i.seconds,
-                      num_repetitions_done, repeats);
+                      num_repetitions_done, repeats, &GetPerfMetrics(),
+                      &perf_counter_names);
+  report.relative_error = relative_error;
+  report.cpu_frequency = i.cpu_frequency;
+  report.profile_file = profile_file;
+  if (thread_breakdown && b.threads() > 1 && !report.error_occurred) {
+    AddThreadBreakdown(i.results, &report);
+  }
+  return report;
+}
 
-  if (reports_for_family) {
-    ++reports_for_family->num_runs_done;
-    if (!report.error_occurred) reports_for_family->Runs.push_back(report);
+BenchmarkReporter::Run BenchmarkRunner::RunRepetitionInChildProcess() {
+#ifdef BENCHMARK_HAS_FORK
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return CreateErrorReport(
+        StrFormat("could not create a pipe: %s", strerror(errno)));
+  }
+  // Whatever is still buffered would otherwise be written twice.
+  std::cout.flush();
+  std::cerr.flush();
+  fflush(nullptr);
+  const pid_t pid = fork();
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return CreateErrorReport(
+        StrFormat("could not fork: %s", strerror(errno)));
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    std::string message;
+    {
+      // Nor is the thread serving the live metrics, whose lock it may hold.
+      SetLiveMetrics(nullptr);
+      // Nor are the spans of the child process written out.
+      SetTracer(nullptr);
+      // The memory locks are not inherited either.
+      if (absl::GetFlag(FLAGS_benchmark_lock_memory)) {
+        LockProcessMemory(nullptr);
+      }
+      // Only this thread was forked, not the workers of the process-wide
+      // thread pool.
+      ThreadPool pool;
+      thread_pool = &pool;
+      BinaryWriter writer(&message);
+      writer.WriteRun(RunRepetition());
+      // The parent needs it for the next repetitions.
+      writer.Write(iters);
+      thread_pool = nullptr;
+    }
+    size_t written = 0;
+    while (written < message.size()) {
+      const ssize_t n =
+          write(fds[1], message.data() + written, message.size() - written);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      written += static_cast<size_t>(n);
+    }
+    close(fds[1]);
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(nullptr);
+    _exit(written == message.size() ? 0 : 1);
   }
 
-  run_results.non_aggregates.push_back(report);
+  close(fds[1]);
+  std::string message;
+  char buffer[4096];
+  for (;;) {
+    const ssize_t n = read(fds[0], buffer, sizeof(buffer));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    message.append(buffer, static_cast<size_t>(n));
+  }
+  close(fds[0]);
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
 
-  ++num_repetitions_done;
+  if (WIFSIGNALED(status)) {
+    return CreateErrorReport(StrFormat(
+        "the benchmark process was killed by signal %d", WTERMSIG(status)));
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    return CreateErrorReport(StrFormat(
+        "the benchmark process exited with status %d", WEXITSTATUS(status)));
+  }
+  BenchmarkReporter::Run report;
+  IterationCount child_iters;
+  BinaryReader reader(message.data(), message.size());
+  if (!reader.ReadRun(&report) || !reader.Read(&child_iters) ||
+      !reader.AtEnd()) {
+    return CreateErrorReport(
+        "could not read the results of the benchmark process");
+  }
+  iters = child_iters;
+  if (!report.error_occurred) {
+    report.complexity_lambda = b.complexity_lambda();
+    report.statistics = &b.statistics();
+  }
+  return report;
+#else
+  return RunRepetition();
+#endif
+}
+
+BenchmarkReporter::Run BenchmarkRunner::CreateErrorReport(
+    const std::string& message) const {
+  internal::ThreadManager::Result results;
+  results.has_error_ = true;
+  results.error_message_ = message;
+  return CreateRunReport(b, results, 0, MemoryManager::Result(), 0,
+                         num_repetitions_done, repeats);
 }
 
 RunResults&& BenchmarkRunner::GetResults() {
   assert(!HasRepeatsRemaining() && "Did not run all repetitions yet?");
 
   // Calculate additional statistics over the repetitions of this instance.
-  run_results.aggregates_only = ComputeStats(run_results.non_aggregates);
+  // Outliers can only be told once all repetitions are done. The flag was
+  // validated at startup.
+  OutlierRejection rule = kNoOutlierRejection;
+  ParseOutlierRejection(absl::GetFlag(FLAGS_benchmark_outlier_rejection),
+                        &rule);
+  run_results.aggregates_only =
+      rule == kNoOutlierRejection
+          ? stats_accumulator.Compute()
+          : ComputeStats(run_results.non_aggregates, rule);
 
   return std::move(run_results);
 }
@@ -15,26 +15,81 @@
 #ifndef BENCHMARK_RUNNER_H_
 #define BENCHMARK_RUNNER_H_
 
-#include <thread>
+#include <map>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "absl/flags/declare.h"
 #include "absl/flags/flag.h"
 #include "benchmark_api_internal.h"
+#include "cpu_frequency.h"
+#include "energy.h"
+#include "harness_stats.h"
 #include "internal_macros.h"
+#include "online_statistics.h"
 #include "perf_counters.h"
+#include "profiler.h"
 #include "thread_manager.h"
+#include "thread_pool.h"
 
 ABSL_DECLARE_FLAG(double, benchmark_min_time);
 
+ABSL_DECLARE_FLAG(double, benchmark_min_warmup_time);
+
+ABSL_DECLARE_FLAG(double, benchmark_target_cv);
+
 ABSL_DECLARE_FLAG(int32_t, benchmark_repetitions);
 
 ABSL_DECLARE_FLAG(bool, benchmark_report_aggregates_only);
 
 ABSL_DECLARE_FLAG(bool, benchmark_display_aggregates_only);
 
+ABSL_DECLARE_FLAG(std::string, benchmark_outlier_rejection);
+
 ABSL_DECLARE_FLAG(std::vector<std::string>, benchmark_perf_counters);
 
+ABSL_DECLARE_FLAG(bool, benchmark_perf_counters_per_thread);
+ABSL_DECLARE_FLAG(bool, benchmark_thread_breakdown);
+
+ABSL_DECLARE_FLAG(std::vector<std::string>, benchmark_perf_metrics);
+
+ABSL_DECLARE_FLAG(int32_t, benchmark_parallel_jobs);
+
+ABSL_DECLARE_FLAG(std::string, benchmark_cpu_affinity);
+
+ABSL_DECLARE_FLAG(std::string, benchmark_isolation);
+
+ABSL_DECLARE_FLAG(int32_t, benchmark_realtime_priority);
+ABSL_DECLARE_FLAG(bool, benchmark_noise_stats);
+ABSL_DECLARE_FLAG(std::string, benchmark_noise_thresholds);
+ABSL_DECLARE_FLAG(int32_t, benchmark_noise_max_reruns);
+ABSL_DECLARE_FLAG(bool, benchmark_check_measurements);
+ABSL_DECLARE_FLAG(bool, benchmark_energy);
+ABSL_DECLARE_FLAG(bool, benchmark_harness_stats);
+
+ABSL_DECLARE_FLAG(bool, benchmark_calibrate);
+ABSL_DECLARE_FLAG(double, benchmark_calibration_interval);
+ABSL_DECLARE_FLAG(std::string, benchmark_normalize_time);
+
+ABSL_DECLARE_FLAG(bool, benchmark_lock_memory);
+ABSL_DECLARE_FLAG(bool, benchmark_process_memory);
+ABSL_DECLARE_FLAG(std::string, benchmark_interference_file);
+ABSL_DECLARE_FLAG(std::string, benchmark_iterations_hint_file);
+
+ABSL_DECLARE_FLAG(std::string, benchmark_datagen_dir);
+ABSL_DECLARE_FLAG(std::string, benchmark_sysinfo_cache_dir);
+
+ABSL_DECLARE_FLAG(bool, benchmark_report_cpu_frequency);
+
+ABSL_DECLARE_FLAG(double, benchmark_max_cpu_frequency_drop);
+
+ABSL_DECLARE_FLAG(std::string, benchmark_profile);
+
+ABSL_DECLARE_FLAG(std::string, benchmark_profile_dir);
+
+ABSL_DECLARE_FLAG(double, benchmark_metrics_interval);
+
 namespace benchmark {
 
 namespace internal {
@@ -62,40 +117,213 @@ class BenchmarkRunner {
 
   void DoOneRepetition();
 
+  // Count 'report' as the next repetition, done before the run was cut short,
+  // after which the repetitions ran 'iterations' per thread, as
+  // --benchmark_checkpoint does when a run resumes.
+  void RestoreRepetition(const BenchmarkReporter::Run& report,
+                         IterationCount iterations);
+
+  int GetNumRepetitionsDone() const { return num_repetitions_done; }
+
+  // Run 'n' iterations per thread, as the repetition 'repetition_index', in
+  // a worker of the Coordinator, which sends the results to the leader that
+  // asked for them.
+  void RunForCoordinator(IterationCount n, int64_t repetition_index);
+
+  // The iterations per thread that the next repetition runs, once the first
+  // one settled them.
+  IterationCount GetIterations() const { return iters; }
+
+  // The real time the last repetition took to run, ramp up included, in
+  // seconds, or 0 if there was none.
+  double GetLastRepetitionSeconds() const { return last_repetition_seconds; }
+
+  // The coefficient of variation of the time per iteration of the
+  // repetitions done so far that didn't fail, or 0 for fewer than two.
+  double GetRepetitionsCV() const;
+
+  // Do no more repetitions than those done so far, so that the aggregates are
+  // over those, as --benchmark_time_budget does once it runs out. Without
+  // any, a repetition that failed with 'reason' stands for them.
+  void StopRepeating(const std::string& reason);
+
+  // Whether StopRepeating() cut the repetitions short.
+  bool StoppedRepeating() const { return stopped_repeating; }
+
   RunResults&& GetResults();
 
+  // The results of the repetitions done so far, without the aggregates.
+  const RunResults& GetPartialResults() const { return run_results; }
+
   BenchmarkReporter::PerFamilyRunReports* GetReportsForFamily() const {
     return reports_for_family;
   }
 
+  const benchmark::internal::BenchmarkInstance& GetBenchmarkInstance() const {
+    return b;
+  }
+
+  // Whether this can run alongside other benchmarks, on 'num_cpus' cpus of
+  // its own.
+  bool CanRunConcurrently(size_t num_cpus) const;
+
+  // Run the threads on 'pool' rather than on the process-wide one, if set.
+  void SetThreadPool(ThreadPool* pool) { thread_pool = pool; }
+
+  // Start the first repetition at 'iters', the count an earlier run settled
+  // on, rather than ramping up from one iteration. It is still run again
+  // with more iterations if it turns out to be too short.
+  void SetIterationsHint(IterationCount iters);
+
+  // Whether an earlier run found the instance to go through more than the
+  // last-level cache, see --benchmark_interference_file.
+  void SetCacheHeavy(bool heavy) { cache_heavy = heavy; }
+  bool IsCacheHeavy() const { return cache_heavy; }
+
+  // Where the highest cpu frequency of the runs so far is kept, for
+  // --benchmark_max_cpu_frequency_drop, which is not checked without one.
+  void SetHighestCpuFrequency(HighestCpuFrequency* highest) {
+    highest_cpu_frequency = highest;
+  }
+
  private:
   RunResults run_results;
+  // The aggregates of the repetitions, updated as each of them is done.
+  StatisticsAccumulator stats_accumulator;
 
   const benchmark::internal::BenchmarkInstance& b;
   BenchmarkReporter::PerFamilyRunReports* reports_for_family;
 
   const double min_time;
-  const int repeats;
+  const double min_warmup_time;
+  bool warmup_done;
+  // If positive, the benchmark runs in batches of 'batch_min_time' until the
+  // time per iteration is known within this relative error.
+  const double target_relative_error;
+  const double batch_min_time;
+  // Only ever lowered, by StopRepeating().
+  int repeats;
   const bool has_explicit_iteration_count;
+  // Whether each repetition runs in a child process of its own.
+  const bool isolate_repetitions;
+  // If positive, the repetitions that ran at a cpu frequency more than this
+  // fraction below the highest seen before fail.
+  const double max_cpu_frequency_drop;
+  // Whether the cpu frequency is measured for each run.
+  const bool sample_cpu_frequency;
+  HighestCpuFrequency* highest_cpu_frequency = nullptr;
 
   int num_repetitions_done = 0;
-
-  std::vector<std::thread> pool;
+  // Whether a repetition succeeded: until one does, each one finds the
+  // iteration count again.
+  bool iterations_found = false;
+  double last_repetition_seconds = 0;
+  bool stopped_repeating = false;
 
   IterationCount iters;  // preserved between repetitions!
+  IterationCount iterations_hint = 0;
+  bool cache_heavy = false;
   // So only the first repetition has to find/calculate it,
   // the other repetitions will just use that precomputed iteration count.
 
-  PerfCountersMeasurement perf_counters_measurement;
-  PerfCountersMeasurement* const perf_counters_measurement_ptr;
+  std::vector<std::string> perf_counter_names;
+  const bool perf_counters_per_thread;
+  const bool thread_breakdown;
+  // SCHED_FIFO priority of the threads while they run, or 0.
+  const int realtime_priority;
+  // The noise that makes a repetition run again, see
+  // --benchmark_noise_thresholds, which needs the noise to be counted.
+  std::map<std::string, double> noise_thresholds;
+  const bool noise_stats;
+  const int noise_max_reruns;
+  // With --benchmark_energy, where the energy can be measured, or null.
+  const EnergyMeter* const energy_meter;
+  // With --benchmark_harness_stats, where the times of the runs go, or null.
+  HarnessStats* const harness_stats;
+  // The reference kernel of the normalized_time counter, or empty.
+  std::string normalize_time;
+  // Each thread counts its own events, in counters it opened itself. They are
+  // opened lazily, the first time a thread runs in a repetition, and closed
+  // at the end of the repetition so that no counters are held for the
+  // benchmarks that are not running.
+  std::vector<std::unique_ptr<PerfCountersMeasurement>> thread_perf_counters;
+  // Must be called from the thread 'thread_id' runs on.
+  PerfCountersMeasurement* GetPerfCountersForThread(int thread_id);
+
+  // With --benchmark_profile, the threads of the last repetition are each
+  // profiled by a profiler they opened themselves, like the perf counters.
+  const bool profile;
+  Profiler::Mode profile_mode;
+  std::string profile_dir;
+  bool profiling = false;
+  std::vector<std::unique_ptr<Profiler>> thread_profilers;
+  // Why the profiler of each thread could not be opened, if it could not.
+  std::vector<std::string> thread_profiler_errors;
+  // Must be called from the thread 'thread_id' runs on. nullptr if not
+  // profiling, or if the profiler could not be opened.
+  Profiler* GetProfilerForThread(int thread_id);
+  // Write the profile of the threads, and close their profilers. Returns the
+  // file written, if any.
+  std::string WriteThreadProfiles();
+
+  // The cpus each thread is pinned to; empty entries for unpinned threads.
+  std::vector<std::vector<int>> thread_cpus;
+
+  ThreadPool* thread_pool = nullptr;
 
   struct IterationResults {
     internal::ThreadManager::Result results;
     IterationCount iters;
     double seconds;
+    // In Hz, 0 if not measured.
+    double cpu_frequency;
+    // For --benchmark_harness_stats: how long the run took, and on its main
+    // thread, how long the loop took, how long the timer ran in it, and how
+    // long the rest of the benchmark took, in seconds.
+    double wall_seconds = 0;
+    double loop_seconds = 0;
+    double timed_seconds = 0;
+    double setup_seconds = 0;
   };
   IterationResults DoNIterations();
 
+  // Run 'memory_iterations' iterations on each of the benchmark's threads,
+  // between the StartThread and StopThread of the memory manager, and discard
+  // the results.
+  void DoMemoryIterations(IterationCount memory_iterations);
+
+  // Run one repetition, and return its report.
+  BenchmarkReporter::Run RunRepetition();
+
+  // Same, in a forked child process, which sends the report back over a pipe.
+  BenchmarkReporter::Run RunRepetitionInChildProcess();
+
+  BenchmarkReporter::Run CreateErrorReport(const std::string& message) const;
+
+  // Count 'report' as the next repetition, towards the aggregates of the
+  // instance and those of its family.
+  void AddRepetition(const BenchmarkReporter::Run& report);
+
+  // Run the benchmark for at least min_warmup_time, the same way it is run
+  // for measuring, and discard the results.
+  void RunWarmUp();
+
+  // Add to the 'phase' of the instance in the harness stats, if any; or the
+  // phases of the run 'i', that is reported.
+  void AddHarnessTime(HarnessStats::Phase phase, double seconds);
+  void AddHarnessTimes(const IterationResults& i);
+
+  // The time for which the runs are sized: the warm-up time while warming
+  // up, the batch time otherwise.
+  double GetMinTimeToApply() const {
+    return warmup_done ? batch_min_time : min_warmup_time;
+  }
+
+  // Add batches to 'i' until the target relative error is reached, or the
+  // time budget is spent.
+  IterationResults DoBatchesUntilPrecise(IterationResults i,
+                                         double* relative_error);
+
   IterationCount PredictNumItersNeeded(const IterationResults& i) const;
 
   bool ShouldReportIterationResults(const IterationResults& i) const;
@@ -0,0 +1,14 @@
+// The suites that come with the library, as a benchmark binary of their own,
+// to characterize the host the other benchmarks run on.
+
+#include "benchmark/benchmark.h"
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  benchmark::RegisterMemoryBandwidthBenchmarks();
+  benchmark::RegisterMemoryLatencyBenchmarks();
+  benchmark::RegisterContentionBenchmarks();
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
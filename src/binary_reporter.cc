@@ -0,0 +1,232 @@
+// Copyright 2021 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "run_columns.h"
+#include "string_util.h"
+#include "timers.h"
+
+// The file is written in the byte order of the machine, which the reader
+// tells from the byte order mark, and is laid out so that it can be mapped
+// into memory and its columns used as arrays:
+//
+//   header, 64 bytes:
+//     char     magic[8] = "GBENCHBR"
+//     uint32_t version = 1
+//     uint32_t byte_order_mark = 0x01020304
+//     uint64_t num_runs, num_columns, num_strings, num_counters, num_context
+//     uint64_t reserved = 0
+//   columns:      num_columns x {uint64_t name, uint64_t type}
+//   column data:  num_columns x num_runs x 8 bytes, one column after another
+//   counter index: (num_runs + 1) x uint64_t, where the counters of run i are
+//                 entries [index[i], index[i + 1])
+//   counters:     num_counters x {uint64_t name, double value}
+//   context:      num_context x {uint64_t key, uint64_t value}
+//   string index: (num_strings + 1) x uint64_t, where string i is the bytes
+//                 [index[i], index[i + 1]) of the string data
+//   string data
+//
+// Names, keys and string values are indices into the strings, of which the
+// first is the empty one. The column types are 0 for int64_t, 1 for double,
+// and 2 for strings. The values are those the JSON reporter writes.
+
+namespace benchmark {
+namespace internal {
+extern std::map<std::string, std::string>* global_context;
+}
+
+namespace {
+
+const char kMagic[8] = {'G', 'B', 'E', 'N', 'C', 'H', 'B', 'R'};
+const uint32_t kVersion = 1;
+const uint32_t kByteOrderMark = 0x01020304;
+
+const int kNumColumns = internal::kNumRunColumns;
+const internal::RunColumn* const kColumns = internal::kRunColumns;
+
+class StringTable {
+ public:
+  StringTable() { Intern(""); }
+
+  uint64_t Intern(const std::string& s) {
+    std::map<std::string, uint64_t>::const_iterator it = ids_.find(s);
+    if (it != ids_.end()) return it->second;
+    const uint64_t id = strings_.size();
+    ids_.insert(std::make_pair(s, id));
+    strings_.push_back(s);
+    return id;
+  }
+
+  const std::vector<std::string>& strings() const { return strings_; }
+
+ private:
+  std::map<std::string, uint64_t> ids_;
+  std::vector<std::string> strings_;
+};
+
+void AppendU64(std::string* out, uint64_t value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+uint64_t DoubleBits(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+uint64_t IntBits(int64_t value) { return static_cast<uint64_t>(value); }
+
+}  // end namespace
+
+bool BinaryReporter::ReportContext(const Context& context) {
+  context_.clear();
+  context_.push_back(std::make_pair("date", LocalDateTimeString()));
+  context_.push_back(std::make_pair("host_name", context.sys_info.name));
+  if (Context::executable_name) {
+    context_.push_back(
+        std::make_pair("executable", std::string(Context::executable_name)));
+  }
+  const CPUInfo& info = context.cpu_info;
+  context_.push_back(
+      std::make_pair("num_cpus", std::to_string(info.num_cpus)));
+  context_.push_back(std::make_pair(
+      "mhz_per_cpu", std::to_string(static_cast<int64_t>(
+                         info.cycles_per_second / 1000000.0 + 0.5))));
+  if (info.scaling != CPUInfo::Scaling::UNKNOWN) {
+    context_.push_back(std::make_pair(
+        "cpu_scaling_enabled",
+        std::string(info.scaling == CPUInfo::Scaling::ENABLED ? "true"
+                                                              : "false")));
+  }
+  // The caches are flattened into "caches/<i>/<field>" keys, and the load
+  // averages are separated by commas.
+  for (size_t i = 0; i < info.caches.size(); ++i) {
+    const std::string prefix = "caches/" + std::to_string(i) + "/";
+    const CPUInfo::CacheInfo& cache = info.caches[i];
+    context_.push_back(std::make_pair(prefix + "type", cache.type));
+    context_.push_back(
+        std::make_pair(prefix + "level", std::to_string(cache.level)));
+    context_.push_back(
+        std::make_pair(prefix + "size", std::to_string(cache.size)));
+    context_.push_back(std::make_pair(prefix + "num_sharing",
+                                      std::to_string(cache.num_sharing)));
+  }
+  std::string load_avg;
+  for (size_t i = 0; i < info.load_avg.size(); ++i) {
+    if (i != 0) load_avg += ',';
+    load_avg += StrFormat("%g", info.load_avg[i]);
+  }
+  context_.push_back(std::make_pair("load_avg", load_avg));
+#if defined(NDEBUG)
+  context_.push_back(std::make_pair("library_build_type", "release"));
+#else
+  context_.push_back(std::make_pair("library_build_type", "debug"));
+#endif
+  if (internal::global_context != nullptr) {
+    for (const auto& kv : *internal::global_context) context_.push_back(kv);
+  }
+  return true;
+}
+
+void BinaryReporter::ReportRuns(const std::vector<Run>& reports) {
+  runs_.insert(runs_.end(), reports.begin(), reports.end());
+}
+
+void BinaryReporter::Finalize() {
+  StringTable strings;
+  std::vector<std::vector<uint64_t> > columns(kNumColumns);
+  std::vector<uint64_t> counter_index(1, 0);
+  std::string counters;
+  std::vector<internal::RunValue> values(internal::kNumRunColumns);
+  for (const Run& run : runs_) {
+    internal::GetRunValues(run, values.data());
+    for (int c = 0; c < kNumColumns; ++c) {
+      const internal::RunValue& value = values[c];
+      switch (kColumns[c].type) {
+        case internal::kInt64Column:
+          columns[c].push_back(IntBits(value.int_value));
+          break;
+        case internal::kDoubleColumn:
+          columns[c].push_back(DoubleBits(value.double_value));
+          break;
+        case internal::kStringColumn:
+          columns[c].push_back(strings.Intern(value.string_value));
+          break;
+      }
+    }
+
+    for (const auto& counter : run.counters) {
+      AppendU64(&counters, strings.Intern(counter.first));
+      AppendU64(&counters, DoubleBits(counter.second));
+    }
+    counter_index.push_back(counter_index.back() + run.counters.size());
+  }
+
+  std::string out;
+  std::vector<uint64_t> column_names(kNumColumns);
+  for (int c = 0; c < kNumColumns; ++c) {
+    column_names[c] = strings.Intern(kColumns[c].name);
+  }
+  std::vector<std::pair<uint64_t, uint64_t> > context;
+  for (const auto& kv : context_) {
+    context.push_back(
+        std::make_pair(strings.Intern(kv.first), strings.Intern(kv.second)));
+  }
+
+  out.append(kMagic, sizeof(kMagic));
+  out.append(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+  out.append(reinterpret_cast<const char*>(&kByteOrderMark),
+             sizeof(kByteOrderMark));
+  AppendU64(&out, runs_.size());
+  AppendU64(&out, kNumColumns);
+  AppendU64(&out, strings.strings().size());
+  AppendU64(&out, counter_index.back());
+  AppendU64(&out, context.size());
+  AppendU64(&out, 0);
+
+  for (int c = 0; c < kNumColumns; ++c) {
+    AppendU64(&out, column_names[c]);
+    AppendU64(&out, static_cast<uint64_t>(kColumns[c].type));
+  }
+  for (int c = 0; c < kNumColumns; ++c) {
+    for (uint64_t value : columns[c]) AppendU64(&out, value);
+  }
+  for (uint64_t offset : counter_index) AppendU64(&out, offset);
+  out.append(counters);
+  for (const auto& kv : context) {
+    AppendU64(&out, kv.first);
+    AppendU64(&out, kv.second);
+  }
+  uint64_t offset = 0;
+  AppendU64(&out, offset);
+  for (const std::string& s : strings.strings()) {
+    offset += s.size();
+    AppendU64(&out, offset);
+  }
+  for (const std::string& s : strings.strings()) out.append(s);
+
+  GetOutputStream().write(out.data(),
+                          static_cast<std::streamsize>(out.size()));
+  runs_.clear();
+}
+
+}  // end namespace benchmark
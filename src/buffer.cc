@@ -0,0 +1,234 @@
+// Buffers mapped with huge pages and NUMA bindings, and the fixture that gives
+// each thread one.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "check.h"
+#include "cpu_affinity.h"
+#include "counter.h"
+#include "internal_macros.h"
+#include "mutex.h"
+
+#ifdef BENCHMARK_OS_LINUX
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace benchmark {
+namespace {
+
+#ifdef BENCHMARK_OS_LINUX
+// From <numaif.h>, which comes with libnuma rather than the kernel headers.
+constexpr int kMpolBind = 2;
+constexpr unsigned long kMpolFNode = 1;
+constexpr unsigned long kMpolFAddr = 2;
+constexpr unsigned long kMaxNodes = 1024;
+
+size_t BasePageSize() { return static_cast<size_t>(sysconf(_SC_PAGESIZE)); }
+
+// The size of the pages of the reserved huge page pool, or 0.
+size_t HugePageSize() {
+  std::ifstream meminfo("/proc/meminfo");
+  std::string line;
+  while (std::getline(meminfo, line)) {
+    unsigned long kb;
+    if (std::sscanf(line.c_str(), "Hugepagesize: %lu kB", &kb) == 1) {
+      return static_cast<size_t>(kb) * 1024;
+    }
+  }
+  return 0;
+}
+
+// The bytes of the mapping at 'address' that are backed by transparent huge
+// pages.
+size_t TransparentHugeBytes(const void* address) {
+  const uintptr_t target = reinterpret_cast<uintptr_t>(address);
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool in_mapping = false;
+  while (std::getline(smaps, line)) {
+    unsigned long start, end, kb;
+    if (std::sscanf(line.c_str(), "%lx-%lx ", &start, &end) == 2) {
+      in_mapping = start <= target && target < end;
+    } else if (in_mapping &&
+               std::sscanf(line.c_str(), "AnonHugePages: %lu kB", &kb) == 1) {
+      return static_cast<size_t>(kb) * 1024;
+    }
+  }
+  return 0;
+}
+
+int NodeOfPage(void* address) {
+  int node = -1;
+  if (syscall(__NR_get_mempolicy, &node, nullptr, 0, address,
+              kMpolFNode | kMpolFAddr) != 0) {
+    return -1;
+  }
+  return node;
+}
+
+bool BindToNode(void* address, size_t size, int node) {
+  if (node < 0 || static_cast<unsigned long>(node) >= kMaxNodes) return false;
+  std::vector<unsigned long> mask(kMaxNodes / (8 * sizeof(unsigned long)));
+  mask[node / (8 * sizeof(unsigned long))] |=
+      1UL << (node % (8 * sizeof(unsigned long)));
+  return syscall(__NR_mbind, address, size, kMpolBind, mask.data(), kMaxNodes,
+                 0) == 0;
+}
+
+void* MapAnonymous(size_t size, int extra_flags) {
+  void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+  return mapping == MAP_FAILED ? nullptr : mapping;
+}
+#endif
+
+size_t RoundUp(size_t n, size_t multiple) {
+  return (n + multiple - 1) / multiple * multiple;
+}
+
+}  // namespace
+
+#ifdef BENCHMARK_OS_LINUX
+Buffer::Buffer(size_t bytes, const BufferOptions& options)
+    : data_(nullptr),
+      size_(bytes),
+      mapping_(nullptr),
+      mapping_size_(0),
+      page_size_(BasePageSize()),
+      numa_node_(-1) {
+  const size_t huge_page_size = options.huge_pages ? HugePageSize() : 0;
+  if (huge_page_size != 0) {
+    // Fails unless enough of the reserved pool is free.
+    mapping_size_ = RoundUp(std::max<size_t>(bytes, 1), huge_page_size);
+    mapping_ = MapAnonymous(mapping_size_, MAP_HUGETLB);
+    if (mapping_ != nullptr) {
+      data_ = mapping_;
+      page_size_ = huge_page_size;
+    }
+  }
+  if (data_ == nullptr) {
+    // Otherwise, the transparent huge pages can only back the whole of the
+    // buffer if it starts on a huge page, so map enough to align it.
+    const size_t alignment =
+        options.huge_pages && huge_page_size != 0 ? huge_page_size
+                                                  : page_size_;
+    mapping_size_ =
+        RoundUp(std::max<size_t>(bytes, 1), alignment) + alignment - page_size_;
+    mapping_ = MapAnonymous(mapping_size_, 0);
+    BM_CHECK(mapping_ != nullptr) << "could not map " << bytes << " bytes";
+    data_ = reinterpret_cast<void*>(
+        RoundUp(reinterpret_cast<uintptr_t>(mapping_), alignment));
+    if (options.huge_pages) {
+      madvise(data_, RoundUp(std::max<size_t>(bytes, 1), alignment),
+              MADV_HUGEPAGE);
+    }
+  }
+  int node = options.numa_node;
+  if (node == BufferOptions::kLocalNode) {
+    int cpu;
+    internal::GetCurrentCpu(&cpu, &node);
+  }
+  if (node >= 0) BindToNode(data_, RoundUp(bytes, page_size_), node);
+  if (options.prefault && bytes > 0) {
+    // Write a byte of every base page, which faults a huge page in whole.
+    char* p = static_cast<char*>(data_);
+    for (size_t offset = 0; offset < bytes; offset += BasePageSize()) {
+      p[offset] = 0;
+    }
+    numa_node_ = NodeOfPage(data_);
+    if (options.huge_pages && page_size_ == BasePageSize() &&
+        huge_page_size != 0 && 2 * TransparentHugeBytes(data_) >= bytes) {
+      page_size_ = huge_page_size;
+    }
+  }
+}
+
+Buffer::~Buffer() { munmap(mapping_, mapping_size_); }
+#else
+Buffer::Buffer(size_t bytes, const BufferOptions& options)
+    : data_(nullptr),
+      size_(bytes),
+      mapping_(nullptr),
+      mapping_size_(0),
+      page_size_(4096),
+      numa_node_(-1) {
+  mapping_size_ = RoundUp(std::max<size_t>(bytes, 1), page_size_) + page_size_;
+  mapping_ = ::operator new(mapping_size_);
+  data_ = reinterpret_cast<void*>(
+      RoundUp(reinterpret_cast<uintptr_t>(mapping_), page_size_));
+  if (options.prefault) std::memset(data_, 0, bytes);
+}
+
+Buffer::~Buffer() { ::operator delete(mapping_); }
+#endif
+
+namespace internal {
+
+// The buffers of the threads of a BufferFixture, by thread index.
+class BufferSet {
+ public:
+  ~BufferSet() EXCLUDES(mutex_) {
+    MutexLock l(mutex_);
+    for (Buffer* buffer : buffers_) delete buffer;
+  }
+
+  Buffer* Get(int thread_index) EXCLUDES(mutex_) {
+    MutexLock l(mutex_);
+    const size_t i = static_cast<size_t>(thread_index);
+    return i < buffers_.size() ? buffers_[i] : nullptr;
+  }
+
+  void Set(int thread_index, Buffer* buffer) EXCLUDES(mutex_) {
+    MutexLock l(mutex_);
+    const size_t i = static_cast<size_t>(thread_index);
+    if (i >= buffers_.size()) buffers_.resize(i + 1, nullptr);
+    buffers_[i] = buffer;
+  }
+
+ private:
+  Mutex mutex_;
+  std::vector<Buffer*> buffers_ GUARDED_BY(mutex_);
+};
+
+}  // namespace internal
+
+BufferFixture::BufferFixture(size_t bytes, const BufferOptions& options)
+    : bytes_(bytes), options_(options), buffers_(new internal::BufferSet) {}
+
+BufferFixture::~BufferFixture() { delete buffers_; }
+
+void BufferFixture::SetUp(State& st) {
+  const size_t bytes =
+      bytes_ != 0 ? bytes_ : static_cast<size_t>(st.range(0));
+  Buffer* buffer = new Buffer(bytes, options_);
+  buffers_->Set(st.thread_index(), buffer);
+  int cpu, node;
+  internal::GetCurrentCpu(&cpu, &node);
+  st.counters["buffer_page_size"] =
+      Counter(static_cast<double>(buffer->page_size()), Counter::kAvgThreads);
+  st.counters["buffer_numa_local"] =
+      Counter(node >= 0 && buffer->numa_node() == node ? 1 : 0,
+              Counter::kAvgThreads);
+}
+
+void BufferFixture::TearDown(State& st) {
+  delete buffers_->Get(st.thread_index());
+  buffers_->Set(st.thread_index(), nullptr);
+}
+
+Buffer& BufferFixture::buffer(const State& st) {
+  return *buffers_->Get(st.thread_index());
+}
+
+}  // namespace benchmark
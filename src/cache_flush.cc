@@ -0,0 +1,70 @@
+#include "cache_flush.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "internal_macros.h"
+#include "sysinfo.h"
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+// Small enough not to skip any line on the CPUs we know of.
+constexpr size_t kCacheLineSize = 64;
+
+}  // end namespace
+
+size_t CacheFlushSize(const std::vector<CPUInfo::CacheInfo>& caches) {
+  size_t largest = 0;
+  for (const CPUInfo::CacheInfo& cache : caches) {
+    largest = std::max(largest, static_cast<size_t>(cache.size));
+  }
+  if (largest == 0) return 64 << 20;
+  return 2 * largest;
+}
+
+void FlushAllCaches() {
+  static const size_t size = CacheFlushSize(CPUCaches());
+  // Written once, so that its pages are backed by memory of their own rather
+  // than by the shared zero page. After that it is only read, so that the
+  // threads of a benchmark can flush at the same time.
+  static const char* const buffer = []() {
+    char* b = new char[size];
+    std::memset(b, 1, size);
+    return b;
+  }();
+  const volatile char* p = buffer;
+  char sum = 0;
+  for (size_t i = 0; i < size; i += kCacheLineSize) sum += p[i];
+  benchmark::DoNotOptimize(sum);
+}
+
+void FlushCacheLines(const void* data, size_t size) {
+  // From the start of the line 'data' is in.
+  const uintptr_t begin =
+      reinterpret_cast<uintptr_t>(data) & ~(uintptr_t{kCacheLineSize} - 1);
+  const uintptr_t end = reinterpret_cast<uintptr_t>(data) + size;
+#if (defined(__x86_64__) || defined(__amd64__) || defined(__i386__)) && \
+    defined(__GNUC__)
+  for (uintptr_t p = begin; p < end; p += kCacheLineSize) {
+    __asm__ volatile("clflush (%0)" : : "r"(p) : "memory");
+  }
+  // clflush is only ordered by fences.
+  __asm__ volatile("mfence" : : : "memory");
+#elif defined(__aarch64__) && defined(__GNUC__)
+  for (uintptr_t p = begin; p < end; p += kCacheLineSize) {
+    __asm__ volatile("dc civac, %0" : : "r"(p) : "memory");
+  }
+  __asm__ volatile("dsb ish" : : : "memory");
+#else
+  (void)begin;
+  (void)end;
+  FlushAllCaches();
+#endif
+}
+
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,29 @@
+#ifndef BENCHMARK_CACHE_FLUSH_H_
+#define BENCHMARK_CACHE_FLUSH_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+namespace internal {
+
+// The size of the buffer FlushAllCaches() reads through: twice the largest of
+// 'caches', or 64 MiB if there are none.
+size_t CacheFlushSize(const std::vector<CPUInfo::CacheInfo>& caches);
+
+// Evict whatever the calling cpu has in its data caches, by reading through a
+// buffer of CacheFlushSize() bytes. The buffer is allocated and written once,
+// the first time it is needed.
+void FlushAllCaches();
+
+// Evict the lines holding [data, data + size) from every level of the cache
+// hierarchy, on every cpu. Where the CPU has no instruction for it, all of
+// the caches are flushed instead.
+void FlushCacheLines(const void* data, size_t size);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_CACHE_FLUSH_H_
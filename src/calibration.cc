@@ -0,0 +1,140 @@
+#include "calibration.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "mutex.h"
+#include "sysinfo.h"
+#include "timers.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+constexpr size_t kWordsPerLine = 64 / sizeof(uint64_t);
+constexpr int kRounds = 3;
+
+// Smaller than the L1 data cache of any cpu we run on.
+constexpr size_t kL1Bytes = 16 << 10;
+constexpr size_t kMinDramBytes = 64 << 20;
+
+constexpr int64_t kAluSteps = 1 << 22;
+constexpr int64_t kL1Steps = 1 << 22;
+constexpr int64_t kDramSteps = 1 << 18;
+
+double AluNs() {
+  uint64_t x = 1;
+  const double start = ChronoClockNow();
+  for (int64_t i = 0; i < kAluSteps; ++i) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    DoNotOptimize(x);
+  }
+  return (ChronoClockNow() - start) * 1e9 / kAluSteps;
+}
+
+// A chain through the lines of 'bytes' of memory, in a random order, so that
+// the prefetchers cannot guess the next load. Each line holds the index of
+// the first word of the next one.
+std::vector<uint64_t> PointerChain(size_t bytes) {
+  const size_t num_lines =
+      std::max<size_t>(2, bytes / (kWordsPerLine * sizeof(uint64_t)));
+  std::vector<size_t> order(num_lines);
+  for (size_t i = 0; i < num_lines; ++i) order[i] = i;
+  // Fixed seed, so that every host chases the same chain.
+  std::mt19937 gen(42);
+  std::shuffle(order.begin(), order.end(), gen);
+  std::vector<uint64_t> chain(num_lines * kWordsPerLine);
+  for (size_t i = 0; i < num_lines; ++i) {
+    chain[order[i] * kWordsPerLine] =
+        order[(i + 1) % num_lines] * kWordsPerLine;
+  }
+  return chain;
+}
+
+double ChaseNs(const std::vector<uint64_t>& chain, int64_t steps) {
+  uint64_t next = 0;
+  const double start = ChronoClockNow();
+  for (int64_t i = 0; i < steps; ++i) next = chain[next];
+  DoNotOptimize(next);
+  return (ChronoClockNow() - start) * 1e9 / static_cast<double>(steps);
+}
+
+size_t DramBytes() {
+  size_t largest = 0;
+  for (const CPUInfo::CacheInfo& cache : CPUCaches()) {
+    if (cache.size > 0) largest = std::max<size_t>(largest, cache.size);
+  }
+  return std::max(kMinDramBytes, 4 * largest);
+}
+
+Mutex calibration_mutex;
+Calibration current GUARDED_BY(calibration_mutex);
+// When the current calibration was run, in ChronoClockNow() seconds, or 0.
+double calibrated_at GUARDED_BY(calibration_mutex) = 0;
+
+}  // namespace
+
+Calibration RunCalibration() {
+  const std::vector<uint64_t> l1 = PointerChain(kL1Bytes);
+  const std::vector<uint64_t> dram = PointerChain(DramBytes());
+  std::vector<Calibration> rounds;
+  for (int round = 0; round < kRounds; ++round) {
+    const double alu_ns = AluNs();
+    const double l1_ns = ChaseNs(l1, kL1Steps);
+    const double dram_ns = ChaseNs(dram, kDramSteps);
+    rounds.push_back({alu_ns, l1_ns, dram_ns});
+  }
+  return FastestCalibration(rounds);
+}
+
+Calibration FastestCalibration(const std::vector<Calibration>& rounds) {
+  Calibration calibration = rounds.front();
+  for (const Calibration& round : rounds) {
+    calibration.alu_ns = std::min(calibration.alu_ns, round.alu_ns);
+    calibration.l1_ns = std::min(calibration.l1_ns, round.l1_ns);
+    calibration.dram_ns = std::min(calibration.dram_ns, round.dram_ns);
+  }
+  return calibration;
+}
+
+void Calibrate() {
+  const Calibration calibration = RunCalibration();
+  MutexLock l(calibration_mutex);
+  current = calibration;
+  calibrated_at = ChronoClockNow();
+}
+
+void RecalibrateIfDue(double interval) {
+  if (interval <= 0) return;
+  {
+    MutexLock l(calibration_mutex);
+    if (calibrated_at == 0 || ChronoClockNow() - calibrated_at < interval) {
+      return;
+    }
+  }
+  Calibrate();
+}
+
+bool GetCalibration(Calibration* calibration) {
+  MutexLock l(calibration_mutex);
+  if (calibrated_at == 0) return false;
+  *calibration = current;
+  return true;
+}
+
+bool IsCalibrationKernel(const std::string& kernel) {
+  return kernel == "alu" || kernel == "l1" || kernel == "dram";
+}
+
+double CalibrationKernelNs(const Calibration& calibration,
+                           const std::string& kernel) {
+  if (kernel == "alu") return calibration.alu_ns;
+  if (kernel == "l1") return calibration.l1_ns;
+  return calibration.dram_ns;
+}
+
+}  // namespace internal
+}  // namespace benchmark
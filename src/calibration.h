@@ -0,0 +1,48 @@
+#ifndef BENCHMARK_CALIBRATION_H_
+#define BENCHMARK_CALIBRATION_H_
+
+#include <string>
+#include <vector>
+
+namespace benchmark {
+namespace internal {
+
+// How long the reference kernels of --benchmark_calibrate take on this host,
+// in nanoseconds per step: a dependent integer multiply-add, a load from a
+// chain of pointers that fits in the L1 data cache, and one from a chain
+// that is several times larger than the last-level cache.
+struct Calibration {
+  double alu_ns;
+  double l1_ns;
+  double dram_ns;
+};
+
+// Run the reference kernels, each a few times, and keep the fastest of each.
+Calibration RunCalibration();
+
+// The fastest time of each kernel over the 'rounds', of which there is at
+// least one.
+Calibration FastestCalibration(const std::vector<Calibration>& rounds);
+
+// Run the kernels and make what they measured the current calibration.
+void Calibrate();
+
+// Calibrate() again if it was last run more than 'interval' seconds ago. An
+// 'interval' of 0 never does.
+void RecalibrateIfDue(double interval);
+
+// The current calibration, or false if there is none yet.
+bool GetCalibration(Calibration* calibration);
+
+// Whether 'kernel' is one of "alu", "l1" and "dram", a value of
+// --benchmark_normalize_time.
+bool IsCalibrationKernel(const std::string& kernel);
+
+// The nanoseconds per step of the kernel named 'kernel'.
+double CalibrationKernelNs(const Calibration& calibration,
+                           const std::string& kernel);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_CALIBRATION_H_
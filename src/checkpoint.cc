@@ -0,0 +1,108 @@
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <iterator>
+
+#include "internal_macros.h"
+#include "result_cache.h"
+#include "run_serialization.h"
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+// Written first in the file, to tell the checkpoints of another version apart.
+const char kCheckpointVersion[] = "benchmark checkpoint 11";
+
+}  // end namespace
+
+bool Checkpoint::Open(const std::string& path) {
+  std::string contents;
+  {
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (file.is_open()) {
+      contents.assign(std::istreambuf_iterator<char>(file),
+                      std::istreambuf_iterator<char>());
+    }
+  }
+
+  // Each repetition is written as a string, so that one that was not written
+  // in full is told apart by its size. What is kept is written again, without
+  // such a partial repetition at the end, so that those appended next are
+  // read back.
+  std::string kept;
+  BinaryWriter kept_writer(&kept);
+  kept_writer.WriteString(kCheckpointVersion);
+  BinaryReader reader(contents.data(), contents.size());
+  std::string version, record;
+  if (reader.ReadString(&version) && version == kCheckpointVersion) {
+    while (reader.ReadString(&record)) {
+      BinaryReader record_reader(record.data(), record.size());
+      std::string key;
+      CheckpointedRepetition repetition;
+      if (!record_reader.ReadString(&key) ||
+          !record_reader.Read(&repetition.iters) ||
+          !record_reader.ReadRun(&repetition.run) || !record_reader.AtEnd()) {
+        break;
+      }
+      kept_[key].push_back(repetition);
+      kept_writer.WriteString(record);
+    }
+  }
+
+  // Through a temporary file, so that being stopped while it is written
+  // loses nothing.
+  const std::string temp_path = path + ".tmp";
+  {
+    std::ofstream file(temp_path.c_str(),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    file.write(kept.data(), static_cast<std::streamsize>(kept.size()));
+    if (!file) return false;
+  }
+#ifdef BENCHMARK_OS_WINDOWS
+  // rename() doesn't replace an existing file there.
+  std::remove(path.c_str());
+#endif
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  file_.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+  return file_.is_open();
+}
+
+std::vector<CheckpointedRepetition> Checkpoint::Take(
+    const BenchmarkInstance& instance) {
+  std::vector<CheckpointedRepetition> repetitions;
+  auto it = kept_.find(RunKey(instance, fingerprint_));
+  if (it == kept_.end()) return repetitions;
+  repetitions.swap(it->second);
+  kept_.erase(it);
+  // The indices depend on which benchmarks the filter selected this time, and
+  // the tags may have changed since.
+  for (CheckpointedRepetition& repetition : repetitions) {
+    repetition.run.family_index = instance.family_index();
+    repetition.run.per_family_instance_index =
+        instance.per_family_instance_index();
+    repetition.run.tags = instance.tags();
+  }
+  return repetitions;
+}
+
+void Checkpoint::Add(const BenchmarkInstance& instance,
+                     const BenchmarkReporter::Run& run, IterationCount iters) {
+  std::string record;
+  BinaryWriter writer(&record);
+  writer.WriteString(RunKey(instance, fingerprint_));
+  writer.Write(iters);
+  writer.WriteRun(run);
+  std::string out;
+  BinaryWriter(&out).WriteString(record);
+  file_.write(out.data(), static_cast<std::streamsize>(out.size()));
+  file_.flush();
+}
+
+}  // end namespace internal
+}  // end namespace benchmark
@@ -0,0 +1,55 @@
+#ifndef BENCHMARK_CHECKPOINT_H_
+#define BENCHMARK_CHECKPOINT_H_
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "benchmark_api_internal.h"
+
+namespace benchmark {
+namespace internal {
+
+// A repetition that was done before the run was cut short, and the
+// iterations per thread that the next repetitions of its instance run.
+struct CheckpointedRepetition {
+  BenchmarkReporter::Run run;
+  IterationCount iters;
+};
+
+// Keeps the repetitions of the benchmarks in a file, appended as each of them
+// completes, so that a run that crashed or was preempted can resume where it
+// stopped, with --benchmark_checkpoint.
+class Checkpoint {
+ public:
+  // 'fingerprint' identifies the code of the instances that don't have a
+  // fingerprint of their own, as for the ResultCache.
+  explicit Checkpoint(const std::string& fingerprint)
+      : fingerprint_(fingerprint) {}
+
+  // Read the repetitions kept in 'path', if it exists, and open it to append
+  // more. Whatever was written of a repetition that the last run was stopped
+  // in the middle of is dropped. Returns false if it can't be written.
+  bool Open(const std::string& path);
+
+  // The repetitions of 'instance' kept from the last run, in the order they
+  // completed, which are taken out of the checkpoint.
+  std::vector<CheckpointedRepetition> Take(const BenchmarkInstance& instance);
+
+  // Append the repetition 'run' of 'instance', after which its next
+  // repetitions run 'iters' per thread, and flush it out.
+  void Add(const BenchmarkInstance& instance,
+           const BenchmarkReporter::Run& run, IterationCount iters);
+
+ private:
+  const std::string fingerprint_;
+  std::ofstream file_;
+  std::map<std::string, std::vector<CheckpointedRepetition> > kept_;
+};
+
+}  // end namespace internal
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_CHECKPOINT_H_
@@ -14,6 +14,7 @@
 
 #include "colorprint.h"
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
@@ -155,6 +156,50 @@ void ColorPrintf(std::ostream& out, LogColor color, const char* fmt,
 #endif
 }
 
+void AppendFormat(std::string* out, const char* fmt, va_list args) {
+  va_list args_cp;
+  va_copy(args_cp, args);
+  const size_t size = out->size();
+  // Into the capacity that is left, which is mostly enough once the string
+  // has been reused a few times, and else into as much as it takes.
+  const size_t room = std::max<size_t>(out->capacity() - size, 64);
+  out->resize(size + room);
+  int ret = vsnprintf(&(*out)[size], room + 1, fmt, args);
+  BM_CHECK(ret >= 0);
+  if (static_cast<size_t>(ret) > room) {
+    out->resize(size + static_cast<size_t>(ret));
+    ret = vsnprintf(&(*out)[size], static_cast<size_t>(ret) + 1, fmt, args_cp);
+    BM_CHECK(ret >= 0);
+  }
+  va_end(args_cp);
+  out->resize(size + static_cast<size_t>(ret));
+}
+
+void AppendColored(std::string* out, LogColor color, const char* fmt,
+                   va_list args) {
+#ifdef BENCHMARK_OS_WINDOWS
+  ((void)color);
+  AppendFormat(out, fmt, args);
+#else
+  const char* color_code = GetPlatformColorCode(color);
+  if (color_code) {
+    *out += "\033[0;3";
+    *out += color_code;
+    *out += 'm';
+  }
+  AppendFormat(out, fmt, args);
+  *out += "\033[m";
+#endif
+}
+
+bool IsStdoutTerminal() {
+#if BENCHMARK_OS_WINDOWS
+  return 0 != _isatty(_fileno(stdout));
+#else
+  return 0 != isatty(fileno(stdout));
+#endif
+}
+
 bool IsColorTerminal() {
 #if BENCHMARK_OS_WINDOWS
   // On Windows the TERM variable is usually not set, but the
@@ -24,10 +24,21 @@ void ColorPrintf(std::ostream& out, LogColor color, const char* fmt,
                  va_list args);
 void ColorPrintf(std::ostream& out, LogColor color, const char* fmt, ...);
 
+// Format straight into the end of 'out', without a string in between.
+void AppendFormat(std::string* out, const char* fmt, va_list args);
+
+// Append what ColorPrintf() prints to 'out', with the escape codes of the
+// terminal. Not for windows, whose console is colored through its attributes.
+void AppendColored(std::string* out, LogColor color, const char* fmt,
+                   va_list args);
+
 // Returns true if stdout appears to be a terminal that supports colored
 // output, false otherwise.
 bool IsColorTerminal();
 
+// Returns true if stdout is a terminal, colored or not.
+bool IsStdoutTerminal();
+
 }  // end namespace benchmark
 
 #endif  // BENCHMARK_COLORPRINT_H_
@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <string>
 #include "check.h"
 #include "complexity.h"
 
@@ -69,6 +70,74 @@ std::string GetBigOString(BigO complexity) {
   }
 }
 
+std::string GetBigOString(const BenchmarkReporter::Run& run) {
+  return run.big_o_string.empty() ? GetBigOString(run.complexity)
+                                  : run.big_o_string;
+}
+
+// The complexity 'term' in the input called 'n', e.g. "lgM".
+std::string GetBigOTermString(BigO term, const std::string& n) {
+  switch (term) {
+    case oN:
+      return n;
+    case oNSquared:
+      return n + "^2";
+    case oNCubed:
+      return n + "^3";
+    case oLogN:
+      return "lg" + n;
+    case oNLogN:
+      return n + "lg" + n;
+    case o1:
+    default:
+      return "(1)";
+  }
+}
+
+// The name of the i-th input of a complexity fitted over several.
+std::string GetBigOInputName(size_t i) {
+  static const char* const kNames[] = {"N", "M", "K", "L", "P", "Q"};
+  if (i < sizeof(kNames) / sizeof(kNames[0])) return kNames[i];
+  return "N" + std::to_string(i);
+}
+
+bool LinearLeastSquares(const std::vector<std::vector<double> >& x,
+                        const std::vector<double>& y,
+                        const std::vector<bool>& used,
+                        std::vector<double>* coef) {
+  std::vector<size_t> columns;
+  for (size_t j = 0; j < x.size(); ++j) {
+    if (used[j]) columns.push_back(j);
+  }
+  const size_t m = columns.size();
+  // The normal equations, as an augmented matrix.
+  std::vector<std::vector<double> > a(m, std::vector<double>(m + 1, 0));
+  for (size_t r = 0; r < m; ++r) {
+    for (size_t c = 0; c < m; ++c) {
+      for (size_t i = 0; i < y.size(); ++i)
+        a[r][c] += x[columns[r]][i] * x[columns[c]][i];
+    }
+    for (size_t i = 0; i < y.size(); ++i) a[r][m] += x[columns[r]][i] * y[i];
+  }
+  // Gaussian elimination with partial pivoting.
+  for (size_t p = 0; p < m; ++p) {
+    size_t pivot = p;
+    for (size_t r = p + 1; r < m; ++r) {
+      if (std::fabs(a[r][p]) > std::fabs(a[pivot][p])) pivot = r;
+    }
+    if (std::fabs(a[pivot][p]) < 1e-300) return false;
+    std::swap(a[p], a[pivot]);
+    for (size_t r = 0; r < m; ++r) {
+      if (r == p) continue;
+      const double f = a[r][p] / a[p][p];
+      for (size_t c = p; c <= m; ++c) a[r][c] -= f * a[p][c];
+    }
+  }
+  coef->assign(x.size(), 0);
+  for (size_t r = 0; r < m; ++r) (*coef)[columns[r]] = a[r][m] / a[r][r];
+  return true;
+}
+
 // Find the coefficient for the high-order term in the running time, by
 // minimizing the sum of squares of relative error, for the fitting curve
 // given by the lambda expression.
@@ -194,6 +263,7 @@ std::vector<BenchmarkReporter::Run> ComputeBigO(
   big_o.run_name = run_name;
   big_o.family_index = reports[0].family_index;
   big_o.per_family_instance_index = reports[0].per_family_instance_index;
+  big_o.tags = reports[0].tags;
   big_o.run_type = BenchmarkReporter::Run::RT_Aggregate;
   big_o.repetitions = reports[0].repetitions;
   big_o.repetition_index = Run::no_repetition_index;
@@ -219,6 +289,7 @@ std::vector<BenchmarkReporter::Run> ComputeBigO(
   rms.run_name = run_name;
   rms.family_index = reports[0].family_index;
   rms.per_family_instance_index = reports[0].per_family_instance_index;
+  rms.tags = reports[0].tags;
   rms.run_type = BenchmarkReporter::Run::RT_Aggregate;
   rms.aggregate_name = "RMS";
   rms.aggregate_unit = StatisticUnit::kPercentage;
@@ -240,4 +311,127 @@ std::vector<BenchmarkReporter::Run> ComputeBigO(
   return results;
 }
 
+std::vector<BenchmarkReporter::Run> ComputeBigO(
+    const std::vector<BenchmarkReporter::Run>& reports,
+    const std::vector<BigO>& terms, ComplexityModel model) {
+  typedef BenchmarkReporter::Run Run;
+  std::vector<Run> results;
+
+  if (reports.size() < 2) return results;
+
+  // The fitting curves evaluated at the inputs of each run: one column per
+  // term, or a single one with their product.
+  const size_t num_columns =
+      model == kAdditiveComplexity ? terms.size() : static_cast<size_t>(1);
+  std::vector<std::vector<double> > columns(num_columns);
+  std::vector<double> real_time;
+  std::vector<double> cpu_time;
+  for (const Run& run : reports) {
+    BM_CHECK_EQ(run.complexity_ns.size(), terms.size())
+        << "Did you forget to call SetComplexityN with a length per term?";
+    double product = 1;
+    for (size_t i = 0; i < terms.size(); ++i) {
+      BM_CHECK_GT(run.complexity_ns[i], 0);
+      const double value = FittingCurve(terms[i])(
+          static_cast<IterationCount>(run.complexity_ns[i]));
+      if (model == kAdditiveComplexity) {
+        columns[i].push_back(value);
+      } else {
+        product *= value;
+      }
+    }
+    if (model == kMultiplicativeComplexity) columns[0].push_back(product);
+    real_time.push_back(run.real_accumulated_time / run.iterations);
+    cpu_time.push_back(run.cpu_accumulated_time / run.iterations);
+  }
+
+  const std::vector<bool> used(num_columns, true);
+  std::vector<double> real_coef;
+  std::vector<double> cpu_coef;
+  if (!LinearLeastSquares(columns, real_time, used, &real_coef) ||
+      !LinearLeastSquares(columns, cpu_time, used, &cpu_coef)) {
+    return results;
+  }
+
+  // Normalized RMS by the mean of the observed values, as for one input.
+  auto rms = [&columns](const std::vector<double>& time,
+                        const std::vector<double>& coef) {
+    double sum_squares = 0;
+    double sum = 0;
+    for (size_t i = 0; i < time.size(); ++i) {
+      double fit = 0;
+      for (size_t j = 0; j < columns.size(); ++j)
+        fit += coef[j] * columns[j][i];
+      sum_squares += (time[i] - fit) * (time[i] - fit);
+      sum += time[i];
+    }
+    const double n = static_cast<double>(time.size());
+    return std::sqrt(sum_squares / n) / (sum / n);
+  };
+
+  std::vector<std::string> term_strings;
+  for (size_t i = 0; i < terms.size(); ++i)
+    term_strings.push_back(GetBigOTermString(terms[i], GetBigOInputName(i)));
+
+  // Drop the 'args' when reporting complexity.
+  auto run_name = reports[0].run_name;
+  run_name.args.clear();
+
+  Run big_o;
+  big_o.run_name = run_name;
+  big_o.family_index = reports[0].family_index;
+  big_o.per_family_instance_index = reports[0].per_family_instance_index;
+  big_o.tags = reports[0].tags;
+  big_o.run_type = BenchmarkReporter::Run::RT_Aggregate;
+  big_o.repetitions = reports[0].repetitions;
+  big_o.repetition_index = Run::no_repetition_index;
+  big_o.threads = reports[0].threads;
+  big_o.aggregate_unit = StatisticUnit::kTime;
+  big_o.report_label = reports[0].report_label;
+  big_o.iterations = 0;
+  big_o.report_big_o = true;
+  big_o.complexity = oLambda;
+  if (model == kAdditiveComplexity) {
+    // A BigO aggregate per term, with its coefficient.
+    for (size_t i = 0; i < terms.size(); ++i) {
+      big_o.aggregate_name = "BigO_" + term_strings[i];
+      big_o.big_o_string = term_strings[i];
+      big_o.real_accumulated_time = real_coef[i];
+      big_o.cpu_accumulated_time = cpu_coef[i];
+      results.push_back(big_o);
+    }
+  } else {
+    big_o.aggregate_name = "BigO";
+    for (const std::string& term : term_strings) big_o.big_o_string += term;
+    big_o.real_accumulated_time = real_coef[0];
+    big_o.cpu_accumulated_time = cpu_coef[0];
+    results.push_back(big_o);
+  }
+
+  // As for one input, the RMS is divided by the multiplier of the time unit,
+  // which it is multiplied by when reported.
+  double multiplier = GetTimeUnitMultiplier(reports[0].time_unit);
+
+  Run rms_run;
+  rms_run.run_name = run_name;
+  rms_run.family_index = reports[0].family_index;
+  rms_run.per_family_instance_index = reports[0].per_family_instance_index;
+  rms_run.tags = reports[0].tags;
+  rms_run.run_type = BenchmarkReporter::Run::RT_Aggregate;
+  rms_run.aggregate_name = "RMS";
+  rms_run.aggregate_unit = StatisticUnit::kPercentage;
+  rms_run.report_label = big_o.report_label;
+  rms_run.iterations = 0;
+  rms_run.repetition_index = Run::no_repetition_index;
+  rms_run.repetitions = reports[0].repetitions;
+  rms_run.threads = reports[0].threads;
+  rms_run.real_accumulated_time = rms(real_time, real_coef) / multiplier;
+  rms_run.cpu_accumulated_time = rms(cpu_time, cpu_coef) / multiplier;
+  rms_run.report_rms = true;
+  rms_run.complexity = oLambda;
+  rms_run.time_unit = reports[0].time_unit;
+  results.push_back(rms_run);
+  return results;
+}
+
 }  // end namespace benchmark
@@ -30,6 +30,22 @@ namespace benchmark {
 std::vector<BenchmarkReporter::Run> ComputeBigO(
     const std::vector<BenchmarkReporter::Run>& reports);
 
+// Return the BigO of each of the 'terms' (or of their product), fitted over
+// the several inputs set with SetComplexityN({n, m, ...}), and the RMS of the
+// fit, for the specified list of reports. If 'reports.size() < 2' an empty
+// vector is returned.
+std::vector<BenchmarkReporter::Run> ComputeBigO(
+    const std::vector<BenchmarkReporter::Run>& reports,
+    const std::vector<BigO>& terms, ComplexityModel model);
+
+// Least squares fit of y = sum_j coef[j] * x[j][i], over the columns of 'x'
+// that are 'used'; the others get a coefficient of 0. Returns false if the
+// system is singular.
+bool LinearLeastSquares(const std::vector<std::vector<double> >& x,
+                        const std::vector<double>& y,
+                        const std::vector<bool>& used,
+                        std::vector<double>* coef);
+
 // This data structure will contain the result returned by MinimalLeastSq
 //   - coef        : Estimated coeficient for the high-order term as
 //                   interpolated from data.
@@ -50,6 +66,9 @@ struct LeastSq {
 // Function to return an string for the calculated complexity
 std::string GetBigOString(BigO complexity);
 
+// The complexity shown for the BigO aggregate 'run'.
+std::string GetBigOString(const BenchmarkReporter::Run& run);
+
 }  // end namespace benchmark
 
 #endif  // COMPLEXITY_H_
@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <cinttypes>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
@@ -33,10 +35,82 @@
 
 namespace benchmark {
 
+namespace {
+
+// Warn when pausing the timer makes up more than this of the measured time.
+constexpr double kTimerOverheadWarningFraction = 0.25;
+
+double OverheadFraction(double time, double overhead) {
+  return overhead > 0 ? overhead / (time + overhead) : 0;
+}
+
+// How often the progress is printed when it is not to a terminal, which
+// would rather have it overwritten as it goes, in seconds.
+constexpr double kProgressInterval = 10;
+
+// Formats the fields of a line straight into 'buffer', which is written out
+// once the line is done, rather than through a string and the stream for
+// each field. The console of windows is colored through its attributes, so
+// there the colored lines are printed as they go.
+class LinePrinter {
+ public:
+  LinePrinter(std::ostream& out, std::string* buffer, bool color)
+      : out_(out), buffer_(buffer), color_(color) {
+    buffer_->clear();
+  }
+
+  ~LinePrinter() {
+    out_.write(buffer_->data(), static_cast<std::streamsize>(buffer_->size()));
+  }
+
+  void operator()(LogColor color, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+#ifdef BENCHMARK_OS_WINDOWS
+    if (color_) {
+      out_.write(buffer_->data(),
+                 static_cast<std::streamsize>(buffer_->size()));
+      buffer_->clear();
+      ColorPrintf(out_, color, fmt, args);
+      va_end(args);
+      return;
+    }
+#endif
+    if (color_) {
+      AppendColored(buffer_, color, fmt, args);
+    } else {
+      AppendFormat(buffer_, fmt, args);
+    }
+    va_end(args);
+  }
+
+ private:
+  std::ostream& out_;
+  std::string* buffer_;
+  const bool color_;
+};
+
+std::string FormatDuration(double seconds) {
+  const int64_t s = static_cast<int64_t>(seconds);
+  return StrFormat("%" PRId64 ":%02d:%02d", s / 3600,
+                   static_cast<int>(s / 60 % 60), static_cast<int>(s % 60));
+}
+
+}  // end namespace
+
 bool ConsoleReporter::ReportContext(const Context& context) {
   name_field_width_ = context.name_field_width;
   printed_header_ = false;
   prev_counters_.clear();
+  num_repetitions_ = context.num_repetitions;
+  repetitions_done_ = 0;
+  errors_ = 0;
+  start_time_ = ChronoClockNow();
+  last_progress_time_ = 0;
+  progress_width_ = 0;
+  progress_on_terminal_ =
+      &GetOutputStream() == &std::cout && IsStdoutTerminal();
+  last_run_name_.clear();
 
   PrintBasicContext(&GetErrorStream(), context);
 
@@ -55,10 +129,13 @@ bool ConsoleReporter::ReportContext(const Context& context) {
 void ConsoleReporter::PrintHeader(const Run& run) {
   std::string str = FormatString("%-*s %13s %15s %12s", static_cast<int>(name_field_width_),
                                  "Benchmark", "Time", "CPU", "Iterations");
+  counter_widths_.clear();
   if(!run.counters.empty()) {
     if(output_options_ & OO_Tabular) {
       for(auto const& c : run.counters) {
         str += FormatString(" %10s", c.first.c_str());
+        counter_widths_.push_back(
+            std::max(std::string::size_type(10), c.first.length()));
       }
     } else {
       str += " UserCounters...";
@@ -69,6 +146,10 @@ void ConsoleReporter::PrintHeader(const Run& run) {
 }
 
 void ConsoleReporter::ReportRuns(const std::vector<Run>& reports) {
+  if (output_options_ & OO_Progress) {
+    for (const auto& run : reports) PrintProgress(run);
+    return;
+  }
   for (const auto& run : reports) {
     // print the header:
     // --- if none was printed yet
@@ -89,12 +170,76 @@ void ConsoleReporter::ReportRuns(const std::vector<Run>& reports) {
   }
 }
 
-static void IgnoreColorPrint(std::ostream& out, LogColor, const char* fmt,
-                             ...) {
-  va_list args;
-  va_start(args, fmt);
-  out << FormatString(fmt, args);
-  va_end(args);
+void ConsoleReporter::PrintProgress(const Run& run) {
+  if (run.run_type == Run::RT_Iteration) {
+    ++repetitions_done_;
+    last_run_name_ = run.run_name.str();
+  } else if (run.aggregate_name == "mean" &&
+             run.run_name.str() != last_run_name_) {
+    // Only the aggregates of the repetitions of this one were reported.
+    repetitions_done_ += run.repetitions;
+    last_run_name_ = run.run_name.str();
+  }
+
+  std::ostream& out = GetOutputStream();
+  if (run.error_occurred) {
+    ++errors_;
+    if (progress_width_ > 0) {
+      out << '\r' << std::string(progress_width_, ' ') << '\r';
+      progress_width_ = 0;
+    }
+    PrintRunData(run);
+  }
+
+  const double now = ChronoClockNow();
+  const bool done =
+      num_repetitions_ > 0 && repetitions_done_ >= num_repetitions_;
+  if (!progress_on_terminal_ && !done && last_progress_time_ > 0 &&
+      now - last_progress_time_ < kProgressInterval) {
+    return;
+  }
+  last_progress_time_ = now;
+
+  const double elapsed = now - start_time_;
+  std::string line;
+  if (num_repetitions_ > 0) {
+    const int64_t done_so_far = std::min(repetitions_done_, num_repetitions_);
+    line = StrFormat("[%" PRId64 "/%" PRId64 "] %3.0f%% %s elapsed",
+                     done_so_far, num_repetitions_,
+                     100. * static_cast<double>(done_so_far) /
+                         static_cast<double>(num_repetitions_),
+                     FormatDuration(elapsed).c_str());
+    if (done_so_far > 0) {
+      const double left = elapsed / static_cast<double>(done_so_far) *
+                          static_cast<double>(num_repetitions_ - done_so_far);
+      line += StrFormat(", %s left", FormatDuration(left).c_str());
+    }
+  } else {
+    line = StrFormat("[%" PRId64 "] %s elapsed", repetitions_done_,
+                     FormatDuration(elapsed).c_str());
+  }
+  if (errors_ > 0) line += StrFormat(", %" PRId64 " errors", errors_);
+  line += "  " + run.benchmark_name();
+
+  if (!progress_on_terminal_) {
+    out << line << '\n';
+    return;
+  }
+  // Over the line before, with blanks over what is left of it.
+  const size_t width = line.size();
+  if (width < progress_width_) line.append(progress_width_ - width, ' ');
+  out << '\r' << line << std::flush;
+  progress_width_ = width;
+}
+
+void ConsoleReporter::Finalize() {
+  if (!(output_options_ & OO_Progress)) return;
+  std::ostream& out = GetOutputStream();
+  if (progress_width_ > 0) out << '\n';
+  progress_width_ = 0;
+  out << repetitions_done_ << " repetitions in "
+      << FormatDuration(ChronoClockNow() - start_time_) << ", " << errors_
+      << " errors\n";
 }
 
 
@@ -113,19 +258,40 @@ static std::string FormatTime(double time) {
 }
 
 void ConsoleReporter::PrintRunData(const Run& result) {
-  typedef void(PrinterFn)(std::ostream&, LogColor, const char*, ...);
-  auto& Out = GetOutputStream();
-  PrinterFn* printer = (output_options_ & OO_Color) ?
-                         (PrinterFn*)ColorPrintf : IgnoreColorPrint;
+  LinePrinter printer(GetOutputStream(), &buffer_,
+                      (output_options_ & OO_Color) != 0);
   auto name_color =
       (result.report_big_o || result.report_rms) ? COLOR_BLUE : COLOR_GREEN;
-  printer(Out, name_color, "%-*s ", name_field_width_,
+  printer(name_color, "%-*s ", name_field_width_,
           result.benchmark_name().c_str());
 
   if (result.error_occurred) {
-    printer(Out, COLOR_RED, "ERROR OCCURRED: \'%s\'",
+    printer(COLOR_RED, "ERROR OCCURRED: \'%s\'",
             result.error_message.c_str());
-    printer(Out, COLOR_DEFAULT, "\n");
+    printer(COLOR_DEFAULT, "\n");
+    return;
+  }
+
+  // The matrix of a CounterMatrix() aggregate, with a line per row, in
+  // place of the times.
+  if (!result.matrix_counter.empty()) {
+    printer(COLOR_DEFAULT, "%s\n", result.matrix_counter.c_str());
+    const size_t num_columns = result.matrix_columns.size();
+    printer(COLOR_DEFAULT, "%-*s ", name_field_width_, "");
+    for (int64_t column : result.matrix_columns) {
+      printer(COLOR_CYAN, " %8lld", static_cast<long long>(column));
+    }
+    printer(COLOR_DEFAULT, "\n");
+    for (size_t r = 0; r < result.matrix_rows.size(); ++r) {
+      printer(COLOR_CYAN, "%*lld ", name_field_width_,
+              static_cast<long long>(result.matrix_rows[r]));
+      for (size_t c = 0; c < num_columns; ++c) {
+        const double value = result.matrix_values[r * num_columns + c];
+        printer(COLOR_DEFAULT, " %8s",
+                std::isnan(value) ? "-" : HumanReadableNumber(value).c_str());
+      }
+      printer(COLOR_DEFAULT, "\n");
+    }
     return;
   }
 
@@ -136,31 +302,35 @@ void ConsoleReporter::PrintRunData(const Run& result) {
 
 
   if (result.report_big_o) {
-    std::string big_o = GetBigOString(result.complexity);
-    printer(Out, COLOR_YELLOW, "%10.2f %-4s %10.2f %-4s ", real_time, big_o.c_str(),
+    std::string big_o = GetBigOString(result);
+    printer(COLOR_YELLOW, "%10.2f %-4s %10.2f %-4s ", real_time, big_o.c_str(),
             cpu_time, big_o.c_str());
   } else if (result.report_rms) {
-    printer(Out, COLOR_YELLOW, "%10.0f %-4s %10.0f %-4s ", real_time * 100, "%",
+    printer(COLOR_YELLOW, "%10.0f %-4s %10.0f %-4s ", real_time * 100, "%",
             cpu_time * 100, "%");
   } else if (result.run_type != Run::RT_Aggregate ||
              result.aggregate_unit == StatisticUnit::kTime) {
     const char* timeLabel = GetTimeUnitString(result.time_unit);
-    printer(Out, COLOR_YELLOW, "%s %-4s %s %-4s ", real_time_str.c_str(), timeLabel,
+    printer(COLOR_YELLOW, "%s %-4s %s %-4s ", real_time_str.c_str(), timeLabel,
             cpu_time_str.c_str(), timeLabel);
   } else {
     assert(result.aggregate_unit == StatisticUnit::kPercentage);
-    printer(Out, COLOR_YELLOW, "%10.2f %-4s %10.2f %-4s ",
+    printer(COLOR_YELLOW, "%10.2f %-4s %10.2f %-4s ",
             (100. * result.real_accumulated_time), "%",
             (100. * result.cpu_accumulated_time), "%");
   }
 
   if (!result.report_big_o && !result.report_rms) {
-    printer(Out, COLOR_CYAN, "%10lld", result.iterations);
+    printer(COLOR_CYAN, "%10lld", result.iterations);
   }
 
+  // Under the header, whose widths were worked out once.
+  const bool under_header = counter_widths_.size() == result.counters.size();
+  size_t counter_index = 0;
   for (auto& c : result.counters) {
-    const std::size_t cNameLen = std::max(std::string::size_type(10),
-                                          c.first.length());
+    const std::size_t cNameLen =
+        under_header ? counter_widths_[counter_index++]
+                     : std::max(std::string::size_type(10), c.first.length());
     std::string s;
     const char* unit = "";
     if (result.run_type == Run::RT_Aggregate &&
@@ -173,18 +343,109 @@ void ConsoleReporter::PrintRunData(const Run& result) {
         unit = (c.second.flags & Counter::kInvert) ? "s" : "/s";
     }
     if (output_options_ & OO_Tabular) {
-      printer(Out, COLOR_DEFAULT, " %*s%s", cNameLen - strlen(unit), s.c_str(),
+      printer(COLOR_DEFAULT, " %*s%s", cNameLen - strlen(unit), s.c_str(),
               unit);
     } else {
-      printer(Out, COLOR_DEFAULT, " %s=%s%s", c.first.c_str(), s.c_str(), unit);
+      printer(COLOR_DEFAULT, " %s=%s%s", c.first.c_str(), s.c_str(), unit);
+    }
+  }
+
+  for (const auto& p : result.latency_percentiles) {
+    printer(COLOR_DEFAULT, " p%g=%.4g%s", p.first, p.second,
+            GetTimeUnitString(result.time_unit));
+  }
+
+  if (result.has_memory_result) {
+    // Only what the MemoryManager measured, per iteration but for the peaks.
+    const MemoryManager::Result& memory = result.memory_result;
+    const int64_t kNotMeasured = MemoryManager::Result::TombstoneValue;
+    if (memory.num_allocs != kNotMeasured) {
+      printer(COLOR_DEFAULT, " allocs/iter=%s",
+              HumanReadableNumber(result.allocs_per_iter, 1000).c_str());
+    }
+    if (memory.max_bytes_used != kNotMeasured) {
+      printer(COLOR_DEFAULT, " max_bytes=%s",
+              HumanReadableNumber(static_cast<double>(result.max_bytes_used))
+                  .c_str());
+    }
+    const struct {
+      const char* name;
+      int64_t total;
+      double one_k;
+    } per_iteration[] = {{"bytes/iter", memory.total_allocated_bytes, 1024},
+                         {"frees/iter", memory.num_frees, 1000},
+                         {"net_bytes/iter", memory.net_heap_growth, 1024},
+                         {"minor_faults/iter", memory.minor_page_faults, 1000},
+                         {"major_faults/iter", memory.major_page_faults, 1000}};
+    for (const auto& m : per_iteration) {
+      if (m.total == kNotMeasured) continue;
+      printer(COLOR_DEFAULT, " %s=%s", m.name,
+              HumanReadableNumber(result.MemoryPerIteration(m.total), m.one_k)
+                  .c_str());
+    }
+    if (memory.peak_rss_bytes != kNotMeasured) {
+      printer(COLOR_DEFAULT, " peak_rss=%s",
+              HumanReadableNumber(static_cast<double>(memory.peak_rss_bytes))
+                  .c_str());
     }
   }
 
+  if (result.relative_error > 0) {
+    printer(COLOR_DEFAULT, " +/-%.2g%%", result.relative_error * 100);
+  }
+
+  if (result.outliers_dropped > 0) {
+    printer(COLOR_DEFAULT, " (%" PRId64 " outliers dropped)",
+            result.outliers_dropped);
+  }
+
+  if (result.cached) {
+    printer(COLOR_DEFAULT, " (cached)");
+  }
+
+  // The overhead was subtracted, but if it was most of what was measured, the
+  // times are only as good as its estimate.
+  const double overhead_fraction = std::max(
+      OverheadFraction(result.real_accumulated_time, result.real_time_overhead),
+      OverheadFraction(result.cpu_accumulated_time, result.cpu_time_overhead));
+  if (overhead_fraction > kTimerOverheadWarningFraction) {
+    printer(COLOR_RED, " (timer overhead %.0f%%)",
+            overhead_fraction * 100);
+  }
+
+  // Only the checks, which the JSON output explains.
+  for (const std::string& warning : result.warnings) {
+    printer(COLOR_RED, " (%s)", warning.substr(0, warning.find(':')).c_str());
+  }
+
   if (!result.report_label.empty()) {
-    printer(Out, COLOR_DEFAULT, " %s", result.report_label.c_str());
+    printer(COLOR_DEFAULT, " %s", result.report_label.c_str());
   }
 
-  printer(Out, COLOR_DEFAULT, "\n");
+  printer(COLOR_DEFAULT, "\n");
+
+  // A line per role of the thread groups, under the run.
+  for (const BenchmarkReporter::RoleRun& role : result.roles) {
+    const std::string role_name = FormatString(
+        "  %s (threads:%d)", role.name.c_str(), static_cast<int>(role.threads));
+    printer(COLOR_GREEN, "%-*s ", name_field_width_, role_name.c_str());
+    const char* timeLabel = GetTimeUnitString(result.time_unit);
+    printer(COLOR_YELLOW, "%s %-4s %s %-4s ",
+            FormatTime(role.GetAdjustedRealTime(result.time_unit)).c_str(),
+            timeLabel,
+            FormatTime(role.GetAdjustedCPUTime(result.time_unit)).c_str(),
+            timeLabel);
+    printer(COLOR_CYAN, "%10lld", role.iterations);
+    for (const auto& c : role.counters) {
+      const char* unit = "";
+      if (c.second.flags & Counter::kIsRate)
+        unit = (c.second.flags & Counter::kInvert) ? "s" : "/s";
+      printer(COLOR_DEFAULT, " %s=%s%s", c.first.c_str(),
+              HumanReadableNumber(c.second.value, c.second.oneK).c_str(),
+              unit);
+    }
+    printer(COLOR_DEFAULT, "\n");
+  }
 }
 
 }  // end namespace benchmark
@@ -0,0 +1,160 @@
+// The contention suite: what moving cache lines between cores costs, under
+// concurrent atomic updates, between a pair of cores, and between variables
+// that only share a line.
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "cpu_affinity.h"
+#include "sysinfo.h"
+#include "timers.h"
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+constexpr size_t kLineSize = 64;
+// The farthest apart that the variables of two threads are put, in bytes.
+constexpr size_t kMaxDistance = 2 * kLineSize;
+
+// Each on a line of its own, so that only the threads meant to share them do.
+struct alignas(kLineSize) SharedCounter {
+  std::atomic<uint64_t> value;
+};
+SharedCounter shared_counter;
+SharedCounter ball;
+
+// The variables of the false sharing probe, a Buffer so that they are
+// aligned to a page, with one per 8 bytes, for up to as many threads as
+// there are cpus at kMaxDistance apart.
+Buffer* false_sharing_lines = nullptr;
+
+void BM_AtomicIncrement(State& state) {
+  for (auto _ : state) {
+    shared_counter.value.fetch_add(1, std::memory_order_relaxed);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Each iteration increments the counter with a compare and swap, retried
+// until it succeeds, and the failed ones are counted.
+void BM_CompareExchange(State& state) {
+  uint64_t failures = 0;
+  for (auto _ : state) {
+    uint64_t expected = shared_counter.value.load(std::memory_order_relaxed);
+    while (!shared_counter.value.compare_exchange_weak(
+        expected, expected + 1, std::memory_order_relaxed)) {
+      ++failures;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["cas_failures"] =
+      Counter(static_cast<double>(failures), Counter::kAvgIterations);
+}
+
+// Each thread increments a variable of its own, state.range(0) bytes from
+// that of the next thread: the threads whose variables share a cache line
+// take it from each other on every write.
+void BM_FalseSharing(State& state) {
+  char* const base = static_cast<char*>(false_sharing_lines->data());
+  std::atomic<uint64_t>* const value =
+      reinterpret_cast<std::atomic<uint64_t>*>(
+          base + static_cast<size_t>(state.thread_index()) *
+                     static_cast<size_t>(state.range(0)));
+  for (auto _ : state) value->fetch_add(1, std::memory_order_relaxed);
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Thread 0, on cpu state.range(0), and thread 1, on cpu state.range(1),
+// hand a value back and forth, each waiting for the other's write before
+// writing its own. An iteration is a round trip, two transfers of the line.
+void BM_PingPong(State& state) {
+  const int64_t self = state.thread_index();
+  std::vector<int> previous;
+  const bool pinned = SetCurrentThreadAffinity(
+      {static_cast<int>(state.range(static_cast<size_t>(self)))}, &previous);
+  // Before the threads start together, so that neither sees the last value
+  // of an earlier run.
+  if (self == 0) ball.value.store(0, std::memory_order_relaxed);
+  uint64_t next = static_cast<uint64_t>(self);
+  const double start = ChronoClockNow();
+  for (auto _ : state) {
+    while (ball.value.load(std::memory_order_acquire) != next) {
+    }
+    ball.value.store(next + 1, std::memory_order_release);
+    next += 2;
+  }
+  const double elapsed = ChronoClockNow() - start;
+  if (pinned) SetCurrentThreadAffinity(previous, nullptr);
+  const double transfers = 2 * static_cast<double>(state.iterations());
+  state.counters["ns_per_transfer"] = Counter(
+      transfers > 0 ? elapsed * 1e9 / transfers : 0, Counter::kAvgThreads);
+}
+
+}  // end namespace
+
+}  // namespace internal
+
+void RegisterContentionBenchmarks() {
+  const int num_cpus = internal::NumCPUs();
+  RegisterBenchmark("Contention/AtomicIncrement", internal::BM_AtomicIncrement)
+      ->ThreadRange(1, num_cpus)
+      ->PinThreads(kPinCores)
+      ->UseRealTime();
+  RegisterBenchmark("Contention/CompareExchange", internal::BM_CompareExchange)
+      ->ThreadRange(1, num_cpus)
+      ->PinThreads(kPinCores)
+      ->UseRealTime();
+
+  if (internal::false_sharing_lines == nullptr) {
+    const size_t bytes =
+        static_cast<size_t>(num_cpus) * internal::kMaxDistance;
+    internal::false_sharing_lines = new Buffer(bytes);
+    char* base = static_cast<char*>(internal::false_sharing_lines->data());
+    for (size_t offset = 0; offset + sizeof(uint64_t) <= bytes;
+         offset += sizeof(uint64_t)) {
+      new (base + offset) std::atomic<uint64_t>(0);
+    }
+  }
+  internal::Benchmark* false_sharing =
+      RegisterBenchmark("Contention/FalseSharing", internal::BM_FalseSharing)
+          ->ArgName("distance")
+          ->RangeMultiplier(2)
+          ->Range(sizeof(uint64_t), internal::kMaxDistance)
+          ->PinThreads(kPinCores)
+          ->UseRealTime();
+  false_sharing->Threads(2);
+  if (num_cpus > 2) false_sharing->Threads(num_cpus);
+
+  // Between the first cpu of each pair of cores the benchmarks may run on,
+  // the hyperthreads of a core sharing its caches.
+  std::vector<int> cpus;
+  std::set<std::pair<int, int> > cores;
+  for (const internal::CpuLocation& cpu : internal::GetAllowedCpus()) {
+    if (cpu.core < 0 ||
+        cores.insert(std::make_pair(cpu.package, cpu.core)).second) {
+      cpus.push_back(cpu.cpu);
+    }
+  }
+  if (cpus.size() < 2) return;
+  internal::Benchmark* ping_pong =
+      RegisterBenchmark("Contention/PingPong", internal::BM_PingPong)
+          ->ArgNames({"cpu", "peer"})
+          ->Threads(2)
+          ->PinThreads(kPinNone)
+          ->UseRealTime()
+          ->CounterMatrix("ns_per_transfer");
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    for (size_t j = i + 1; j < cpus.size(); ++j) {
+      ping_pong->Args({cpus[i], cpus[j]});
+    }
+  }
+}
+
+}  // namespace benchmark
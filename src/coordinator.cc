@@ -0,0 +1,610 @@
+#include "coordinator.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "counter.h"
+#include "internal_macros.h"
+#include "run_serialization.h"
+#include "string_util.h"
+#include "timers.h"
+
+#if !defined(BENCHMARK_OS_WINDOWS) && !defined(BENCHMARK_OS_FUCHSIA) && \
+    !defined(BENCHMARK_OS_EMSCRIPTEN) && !defined(BENCHMARK_OS_NACL)
+#define BENCHMARK_HAS_SOCKETS 1
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+std::atomic<Coordinator*> current_coordinator(nullptr);
+
+// How long the leader waits for its workers to connect, and the workers for
+// the leader to listen.
+constexpr double kConnectSeconds = 60;
+// How long a worker waits before it tries to connect again.
+constexpr int kRetryMillis = 100;
+
+// Larger messages are taken for garbage.
+constexpr uint64_t kMaxMessageSize = uint64_t{1} << 30;
+
+// The first byte of each message.
+const char kHello = 'H';
+const char kRun = 'R';
+const char kReady = 'Y';
+const char kRefuse = 'X';
+const char kStart = 'S';
+const char kCancel = 'C';
+const char kResults = 'T';
+const char kDone = 'D';
+
+const char kUnixPrefix[] = "unix:";
+
+bool IsUnixAddress(const std::string& address) {
+  return address.compare(0, sizeof(kUnixPrefix) - 1, kUnixPrefix) == 0;
+}
+
+template <class T>
+void WriteVector(BinaryWriter* writer, const std::vector<T>& values) {
+  writer->Write(static_cast<uint64_t>(values.size()));
+  for (const T& value : values) writer->Write(value);
+}
+
+template <class T>
+bool ReadVector(BinaryReader* reader, std::vector<T>* values) {
+  uint64_t size;
+  if (!reader->Read(&size)) return false;
+  values->clear();
+  for (uint64_t i = 0; i < size; ++i) {
+    T value;
+    if (!reader->Read(&value)) return false;
+    values->push_back(value);
+  }
+  return true;
+}
+
+// Only what is added up over the threads of a run is sent, not the latency
+// histogram, the time series or the results of the roles, which are the
+// leader's own.
+std::string WriteResult(const ThreadManager::Result& result) {
+  std::string out;
+  BinaryWriter writer(&out);
+  writer.Write(result.processes);
+  writer.Write(result.iterations);
+  writer.Write(result.real_time_used);
+  writer.Write(result.cpu_time_used);
+  writer.Write(result.manual_time_used);
+  writer.Write(result.real_time_overhead);
+  writer.Write(result.cpu_time_overhead);
+  writer.Write(result.timed_slices);
+  writer.Write(result.complexity_n);
+  writer.Write(result.has_error_);
+  writer.WriteString(result.error_message_);
+  writer.Write(result.cold_cache);
+  writer.Write(static_cast<uint64_t>(result.counters.size()));
+  for (const auto& kv : result.counters) {
+    writer.WriteString(kv.first);
+    writer.Write(kv.second.value);
+    writer.Write(static_cast<int32_t>(kv.second.flags));
+    writer.Write(static_cast<int32_t>(kv.second.oneK));
+  }
+  WriteVector(&writer, result.thread_cpus);
+  WriteVector(&writer, result.thread_numa_nodes);
+  WriteVector(&writer, result.thread_iterations);
+  WriteVector(&writer, result.thread_real_times);
+  WriteVector(&writer, result.thread_cpu_times);
+  return out;
+}
+
+bool ReadResult(const std::string& in, ThreadManager::Result* result) {
+  BinaryReader reader(in.data(), in.size());
+  uint64_t num_counters;
+  if (!reader.Read(&result->processes) || !reader.Read(&result->iterations) ||
+      !reader.Read(&result->real_time_used) ||
+      !reader.Read(&result->cpu_time_used) ||
+      !reader.Read(&result->manual_time_used) ||
+      !reader.Read(&result->real_time_overhead) ||
+      !reader.Read(&result->cpu_time_overhead) ||
+      !reader.Read(&result->timed_slices) ||
+      !reader.Read(&result->complexity_n) ||
+      !reader.Read(&result->has_error_) ||
+      !reader.ReadString(&result->error_message_) ||
+      !reader.Read(&result->cold_cache) || !reader.Read(&num_counters)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < num_counters; ++i) {
+    std::string name;
+    Counter counter;
+    int32_t flags, one_k;
+    if (!reader.ReadString(&name) || !reader.Read(&counter.value) ||
+        !reader.Read(&flags) || !reader.Read(&one_k)) {
+      return false;
+    }
+    counter.flags = static_cast<Counter::Flags>(flags);
+    counter.oneK = static_cast<Counter::OneK>(one_k);
+    result->counters[name] = counter;
+  }
+  return ReadVector(&reader, &result->thread_cpus) &&
+         ReadVector(&reader, &result->thread_numa_nodes) &&
+         ReadVector(&reader, &result->thread_iterations) &&
+         ReadVector(&reader, &result->thread_real_times) &&
+         ReadVector(&reader, &result->thread_cpu_times) && reader.AtEnd();
+}
+
+// Add the results of the run of a worker to 'results', as if its threads
+// were more threads of the run.
+void AddWorkerResult(const ThreadManager::Result& worker,
+                     ThreadManager::Result* results) {
+  results->processes += worker.processes;
+  results->iterations += worker.iterations;
+  results->real_time_used += worker.real_time_used;
+  results->cpu_time_used += worker.cpu_time_used;
+  results->manual_time_used += worker.manual_time_used;
+  results->real_time_overhead += worker.real_time_overhead;
+  results->cpu_time_overhead += worker.cpu_time_overhead;
+  results->timed_slices += worker.timed_slices;
+  results->complexity_n += worker.complexity_n;
+  results->cold_cache = results->cold_cache || worker.cold_cache;
+  Increment(&results->counters, worker.counters);
+  results->thread_cpus.insert(results->thread_cpus.end(),
+                              worker.thread_cpus.begin(),
+                              worker.thread_cpus.end());
+  results->thread_numa_nodes.insert(results->thread_numa_nodes.end(),
+                                    worker.thread_numa_nodes.begin(),
+                                    worker.thread_numa_nodes.end());
+  results->thread_iterations.insert(results->thread_iterations.end(),
+                                    worker.thread_iterations.begin(),
+                                    worker.thread_iterations.end());
+  results->thread_real_times.insert(results->thread_real_times.end(),
+                                    worker.thread_real_times.begin(),
+                                    worker.thread_real_times.end());
+  results->thread_cpu_times.insert(results->thread_cpu_times.end(),
+                                   worker.thread_cpu_times.begin(),
+                                   worker.thread_cpu_times.end());
+}
+
+#ifdef BENCHMARK_HAS_SOCKETS
+bool SendAll(int fd, const std::string& data) {
+#ifdef MSG_NOSIGNAL
+  const int send_flags = MSG_NOSIGNAL;
+#else
+  const int send_flags = 0;
+#endif
+  size_t sent = 0;
+  while (sent < data.size()) {
+    const ssize_t n =
+        send(fd, data.data() + sent, data.size() - sent, send_flags);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    sent += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool ReceiveAll(int fd, char* data, size_t size) {
+  size_t received = 0;
+  while (received < size) {
+    const ssize_t n = recv(fd, data + received, size - received, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    received += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool SendMessage(int fd, char type, const std::string& body) {
+  std::string out;
+  BinaryWriter writer(&out);
+  writer.Write(static_cast<uint64_t>(body.size() + 1));
+  out += type;
+  out += body;
+  return SendAll(fd, out);
+}
+
+bool ReceiveMessage(int fd, char* type, std::string* body) {
+  uint64_t size;
+  if (!ReceiveAll(fd, reinterpret_cast<char*>(&size), sizeof(size)) ||
+      size == 0 || size > kMaxMessageSize) {
+    return false;
+  }
+  std::string message(static_cast<size_t>(size), '\0');
+  if (!ReceiveAll(fd, &message[0], message.size())) return false;
+  *type = message[0];
+  body->assign(message, 1, std::string::npos);
+  return true;
+}
+
+// The runs are short exchanges, which are not to wait for more to send.
+void SetNoDelay(int fd) {
+  const int no_delay = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+}
+
+// The addresses of the "<host>:<port>" 'address', to listen on if
+// 'passive', with any host if it is empty.
+struct addrinfo* ResolveAddress(const std::string& address, bool passive,
+                                std::string* error) {
+  const size_t colon = address.rfind(':');
+  if (colon == std::string::npos || colon + 1 == address.size()) {
+    *error = "expected <host>:<port> or unix:<path>, got '" + address + "'";
+    return nullptr;
+  }
+  std::string host = address.substr(0, colon);
+  if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+    host = host.substr(1, host.size() - 2);
+  }
+  const std::string service = address.substr(colon + 1);
+  struct addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (passive) hints.ai_flags = AI_PASSIVE;
+  struct addrinfo* addresses = nullptr;
+  const int status = getaddrinfo(host.empty() ? nullptr : host.c_str(),
+                                 service.c_str(), &hints, &addresses);
+  if (status != 0) {
+    *error = StrFormat("could not resolve '%s': %s", address.c_str(),
+                       gai_strerror(status));
+    return nullptr;
+  }
+  return addresses;
+}
+
+bool UnixAddress(const std::string& path, struct sockaddr_un* address,
+                 std::string* error) {
+  std::memset(address, 0, sizeof(*address));
+  address->sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address->sun_path)) {
+    *error = "invalid unix socket path '" + path + "'";
+    return false;
+  }
+  std::memcpy(address->sun_path, path.c_str(), path.size());
+  return true;
+}
+
+// A socket listening on 'address', or -1.
+int Listen(const std::string& address, std::string* error) {
+  if (IsUnixAddress(address)) {
+    const std::string path = address.substr(sizeof(kUnixPrefix) - 1);
+    struct sockaddr_un unix_address;
+    if (!UnixAddress(path, &unix_address, error)) return -1;
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+      *error = StrFormat("could not create a socket: %s", strerror(errno));
+      return -1;
+    }
+    // That of an earlier run that didn't get to remove it.
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&unix_address),
+             sizeof(unix_address)) != 0 ||
+        listen(fd, 64) != 0) {
+      *error = StrFormat("could not listen on '%s': %s", address.c_str(),
+                         strerror(errno));
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+  struct addrinfo* addresses = ResolveAddress(address, true, error);
+  if (addresses == nullptr) return -1;
+  int listen_fd = -1;
+  *error = "no address to listen on";
+  for (struct addrinfo* a = addresses; a != nullptr; a = a->ai_next) {
+    const int fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) continue;
+    const int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(fd, a->ai_addr, a->ai_addrlen) == 0 && listen(fd, 64) == 0) {
+      listen_fd = fd;
+      break;
+    }
+    *error = StrFormat("could not listen on '%s': %s", address.c_str(),
+                       strerror(errno));
+    close(fd);
+  }
+  freeaddrinfo(addresses);
+  return listen_fd;
+}
+
+// A socket connected to 'address', or -1 if none is listening there.
+int Connect(const std::string& address, std::string* error) {
+  if (IsUnixAddress(address)) {
+    struct sockaddr_un unix_address;
+    if (!UnixAddress(address.substr(sizeof(kUnixPrefix) - 1), &unix_address,
+                     error)) {
+      return -1;
+    }
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+      *error = StrFormat("could not create a socket: %s", strerror(errno));
+      return -1;
+    }
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&unix_address),
+                sizeof(unix_address)) != 0) {
+      *error = StrFormat("could not connect to '%s': %s", address.c_str(),
+                         strerror(errno));
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+  struct addrinfo* addresses = ResolveAddress(address, false, error);
+  if (addresses == nullptr) return -1;
+  int connected_fd = -1;
+  *error = "no address to connect to";
+  for (struct addrinfo* a = addresses; a != nullptr; a = a->ai_next) {
+    const int fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) continue;
+    if (connect(fd, a->ai_addr, a->ai_addrlen) == 0) {
+      connected_fd = fd;
+      break;
+    }
+    *error = StrFormat("could not connect to '%s': %s", address.c_str(),
+                       strerror(errno));
+    close(fd);
+  }
+  freeaddrinfo(addresses);
+  if (connected_fd >= 0) SetNoDelay(connected_fd);
+  return connected_fd;
+}
+#endif  // BENCHMARK_HAS_SOCKETS
+
+}  // namespace
+
+Coordinator::Coordinator() : leader_(false) {}
+
+Coordinator::~Coordinator() {
+#ifdef BENCHMARK_HAS_SOCKETS
+  if (leader_ && broken_.empty()) {
+    for (int fd : fds_) SendMessage(fd, kDone, "");
+  }
+#endif
+  Close();
+}
+
+void Coordinator::Close() {
+#ifdef BENCHMARK_HAS_SOCKETS
+  for (int fd : fds_) close(fd);
+  if (!unix_path_.empty()) unlink(unix_path_.c_str());
+#endif
+  fds_.clear();
+  unix_path_.clear();
+}
+
+bool Coordinator::Lead(const std::string& address, int num_workers,
+                       const std::string& benchmarks, std::string* error) {
+#ifdef BENCHMARK_HAS_SOCKETS
+  leader_ = true;
+  const int listen_fd = Listen(address, error);
+  if (listen_fd < 0) return false;
+  if (IsUnixAddress(address))
+    unix_path_ = address.substr(sizeof(kUnixPrefix) - 1);
+  const double deadline = ChronoClockNow() + kConnectSeconds;
+  bool ok = true;
+  while (ok && fds_.size() < static_cast<size_t>(num_workers)) {
+    const double left = deadline - ChronoClockNow();
+    struct pollfd poll_fd;
+    poll_fd.fd = listen_fd;
+    poll_fd.events = POLLIN;
+    poll_fd.revents = 0;
+    if (left <= 0 || poll(&poll_fd, 1, static_cast<int>(left * 1000)) == 0) {
+      *error = StrFormat("%d of the %d workers connected in %.0f seconds",
+                         static_cast<int>(fds_.size()), num_workers,
+                         kConnectSeconds);
+      ok = false;
+      break;
+    }
+    const int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) continue;
+    if (!IsUnixAddress(address)) SetNoDelay(fd);
+    fds_.push_back(fd);
+    char type;
+    std::string body;
+    if (!ReceiveMessage(fd, &type, &body) || type != kHello) {
+      *error = "a worker hung up before it said which benchmarks it runs";
+      ok = false;
+    } else if (body != benchmarks) {
+      *error = "a worker runs other benchmarks than the leader";
+      ok = false;
+    }
+  }
+  close(listen_fd);
+  if (!ok) {
+    // Which closes the connections, so that the workers give up too.
+    broken_ = *error;
+    Close();
+  }
+  return ok;
+#else
+  (void)address;
+  (void)num_workers;
+  (void)benchmarks;
+  *error = "not supported on this platform";
+  return false;
+#endif
+}
+
+bool Coordinator::Follow(const std::string& address,
+                         const std::string& benchmarks, std::string* error) {
+#ifdef BENCHMARK_HAS_SOCKETS
+  leader_ = false;
+  // The leader may not be listening yet.
+  const double deadline = ChronoClockNow() + kConnectSeconds;
+  int fd = Connect(address, error);
+  while (fd < 0 && ChronoClockNow() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kRetryMillis));
+    fd = Connect(address, error);
+  }
+  if (fd < 0) return false;
+  fds_.push_back(fd);
+  if (!SendMessage(fd, kHello, benchmarks)) {
+    *error = "the leader hung up";
+    return false;
+  }
+  return true;
+#else
+  (void)address;
+  (void)benchmarks;
+  *error = "not supported on this platform";
+  return false;
+#endif
+}
+
+bool Coordinator::StartRun(const std::string& name, IterationCount iters,
+                           int64_t repetition_index, std::string* error) {
+  if (!broken_.empty()) {
+    *error = broken_;
+    return false;
+  }
+#ifdef BENCHMARK_HAS_SOCKETS
+  char type;
+  std::string body;
+  if (!leader_) {
+    if (!SendMessage(fds_[0], kReady, "") ||
+        !ReceiveMessage(fds_[0], &type, &body) ||
+        (type != kStart && type != kCancel)) {
+      broken_ = *error = "lost the leader";
+      return false;
+    }
+    if (type == kCancel) {
+      *error = "the leader called the run off";
+      return false;
+    }
+    return true;
+  }
+
+  std::string request;
+  BinaryWriter writer(&request);
+  writer.WriteString(name);
+  writer.Write(iters);
+  writer.Write(repetition_index);
+  for (size_t w = 0; w < fds_.size(); ++w) {
+    if (!SendMessage(fds_[w], kRun, request)) {
+      broken_ = *error = StrFormat("lost the worker %d", static_cast<int>(w));
+      return false;
+    }
+  }
+  // Those that refuse are not told to start, nor to call the run off.
+  std::vector<bool> ready(fds_.size(), false);
+  std::string refusal;
+  for (size_t w = 0; w < fds_.size(); ++w) {
+    if (!ReceiveMessage(fds_[w], &type, &body) ||
+        (type != kReady && type != kRefuse)) {
+      broken_ = *error = StrFormat("lost the worker %d", static_cast<int>(w));
+      return false;
+    }
+    ready[w] = type == kReady;
+    if (!ready[w] && refusal.empty())
+      refusal = StrFormat("worker %d: %s", static_cast<int>(w), body.c_str());
+  }
+  // As close together as they can be sent.
+  const char go = refusal.empty() ? kStart : kCancel;
+  for (size_t w = 0; w < fds_.size(); ++w) {
+    if (ready[w] && !SendMessage(fds_[w], go, "")) {
+      broken_ = *error = StrFormat("lost the worker %d", static_cast<int>(w));
+      return false;
+    }
+  }
+  if (!refusal.empty()) {
+    *error = refusal;
+    return false;
+  }
+  return true;
+#else
+  (void)name;
+  (void)iters;
+  (void)repetition_index;
+  return true;
+#endif
+}
+
+bool Coordinator::FinishRun(ThreadManager::Result* results,
+                            std::string* error) {
+  if (!broken_.empty()) {
+    *error = broken_;
+    return false;
+  }
+#ifdef BENCHMARK_HAS_SOCKETS
+  if (!leader_) {
+    if (!SendMessage(fds_[0], kResults, WriteResult(*results))) {
+      broken_ = *error = "lost the leader";
+      return false;
+    }
+    return true;
+  }
+  for (size_t w = 0; w < fds_.size(); ++w) {
+    char type;
+    std::string body;
+    ThreadManager::Result worker;
+    if (!ReceiveMessage(fds_[w], &type, &body) || type != kResults ||
+        !ReadResult(body, &worker)) {
+      broken_ = *error = StrFormat("lost the worker %d", static_cast<int>(w));
+      return false;
+    }
+    if (worker.has_error_ && !results->has_error_) {
+      results->has_error_ = true;
+      results->error_message_ = StrFormat("worker %d: %s", static_cast<int>(w),
+                                          worker.error_message_.c_str());
+    }
+    AddWorkerResult(worker, results);
+  }
+#else
+  (void)results;
+#endif
+  return true;
+}
+
+bool Coordinator::NextRun(std::string* name, IterationCount* iters,
+                          int64_t* repetition_index) {
+  if (!broken_.empty()) return false;
+#ifdef BENCHMARK_HAS_SOCKETS
+  char type = 0;
+  std::string body;
+  if (!ReceiveMessage(fds_[0], &type, &body) || type != kRun) {
+    broken_ = type == kDone ? "the leader is done" : "lost the leader";
+    return false;
+  }
+  BinaryReader reader(body.data(), body.size());
+  if (!reader.ReadString(name) || !reader.Read(iters) ||
+      !reader.Read(repetition_index) || !reader.AtEnd()) {
+    broken_ = "could not read what the leader asked for";
+    return false;
+  }
+  return true;
+#else
+  (void)name;
+  (void)iters;
+  (void)repetition_index;
+  return false;
+#endif
+}
+
+void Coordinator::RefuseRun(const std::string& error) {
+#ifdef BENCHMARK_HAS_SOCKETS
+  if (broken_.empty() && !SendMessage(fds_[0], kRefuse, error))
+    broken_ = "lost the leader";
+#else
+  (void)error;
+#endif
+}
+
+Coordinator* GetCoordinator() { return current_coordinator.load(); }
+
+void SetCoordinator(Coordinator* coordinator) {
+  current_coordinator.store(coordinator);
+}
+
+}  // namespace internal
+}  // namespace benchmark
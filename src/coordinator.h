@@ -0,0 +1,91 @@
+#ifndef BENCHMARK_COORDINATOR_H_
+#define BENCHMARK_COORDINATOR_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "thread_manager.h"
+
+namespace benchmark {
+namespace internal {
+
+// Runs the benchmarks in several processes at once, on this host or on
+// others, as one run with more threads, e.g. for the clients of a server.
+// With --benchmark_coordinator_workers, this process is the leader, which the
+// workers started with --benchmark_coordinator connect to. The leader asks
+// the workers to run each of its runs too, for as many iterations, and starts
+// them all at once when they are all ready. The results of the workers are
+// then added to those of the leader, as those of its threads are.
+//
+// The processes run the same binary, with the same flags, on hosts of the
+// same architecture. Only on the platforms with POSIX sockets.
+class Coordinator {
+ public:
+  Coordinator();
+  // The leader tells the workers it is done.
+  ~Coordinator();
+
+  // Listen on 'address', "<host>:<port>" or "unix:<path>", and wait for
+  // 'num_workers' workers to connect, which must run the instances of
+  // 'benchmarks', the names of the instances in order. Returns false, with
+  // why in 'error', if it can't, or if they don't connect in time.
+  bool Lead(const std::string& address, int num_workers,
+            const std::string& benchmarks, std::string* error);
+
+  // Connect to the leader at 'address', as one of its workers, which runs the
+  // instances of 'benchmarks'.
+  bool Follow(const std::string& address, const std::string& benchmarks,
+              std::string* error);
+
+  bool is_leader() const { return leader_; }
+
+  // The processes that take part in each run, the leader included.
+  int num_processes() const {
+    return leader_ ? static_cast<int>(fds_.size()) + 1 : 1;
+  }
+
+  // On the leader, have the workers get ready to run 'iters' iterations per
+  // thread of the instance 'name', in its repetition 'repetition_index', and
+  // start them once they all are. On a worker, tell the leader that it is
+  // ready, and wait until the leader says to start. Returns false, with why
+  // in 'error', if the run is called off.
+  bool StartRun(const std::string& name, IterationCount iters,
+                int64_t repetition_index, std::string* error);
+
+  // On the leader, add the results of the run of each worker to 'results'.
+  // On a worker, send 'results' to the leader.
+  bool FinishRun(ThreadManager::Result* results, std::string* error);
+
+  // On a worker, wait until the leader asks for a run. Returns false once the
+  // leader is done, or gone.
+  bool NextRun(std::string* name, IterationCount* iters,
+               int64_t* repetition_index);
+
+  // On a worker, tell the leader that it can't do the run it asked for.
+  void RefuseRun(const std::string& error);
+
+ private:
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(Coordinator);
+
+  void Close();
+
+  bool leader_;
+  // Those of the workers, on the leader, and that of the leader, on a
+  // worker.
+  std::vector<int> fds_;
+  // Why the connections can't be used any more, if so.
+  std::string broken_;
+  // The unix socket the leader listened on, which it removes.
+  std::string unix_path_;
+};
+
+// The coordinator of the runs, or null.
+Coordinator* GetCoordinator();
+void SetCoordinator(Coordinator* coordinator);
+
+}  // end namespace internal
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_COORDINATOR_H_
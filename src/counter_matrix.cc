@@ -0,0 +1,96 @@
+#include "counter_matrix.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <utility>
+
+#include "string_util.h"
+
+namespace benchmark {
+
+namespace internal {
+
+bool ParseArgValues(const std::string& args, std::vector<int64_t>* values) {
+  values->clear();
+  if (args.empty()) return true;
+  for (const std::string& arg : StrSplit(args, '/')) {
+    // Named by ArgNames(), or not.
+    const size_t colon = arg.rfind(':');
+    const char* value =
+        arg.c_str() + (colon == std::string::npos ? 0 : colon + 1);
+    char* end;
+    errno = 0;
+    const long long parsed = std::strtoll(value, &end, 10);
+    if (end == value || *end != '\0' || errno != 0) return false;
+    values->push_back(static_cast<int64_t>(parsed));
+  }
+  return true;
+}
+
+}  // namespace internal
+
+std::vector<BenchmarkReporter::Run> ComputeCounterMatrix(
+    const std::vector<BenchmarkReporter::Run>& reports,
+    const std::string& counter) {
+  typedef BenchmarkReporter::Run Run;
+  std::vector<Run> results;
+  // The sums of the counter, and the runs summed, by (row, column).
+  std::map<std::pair<int64_t, int64_t>, std::pair<double, int> > cells;
+  const Run* named = nullptr;
+  std::vector<int64_t> args;
+  for (const Run& run : reports) {
+    if (run.run_type != Run::RT_Iteration || run.error_occurred) continue;
+    auto it = run.counters.find(counter);
+    if (it == run.counters.end() ||
+        !internal::ParseArgValues(run.run_name.args, &args) ||
+        args.size() < 2) {
+      continue;
+    }
+    std::pair<double, int>& cell = cells[std::make_pair(args[0], args[1])];
+    cell.first += it->second.value;
+    ++cell.second;
+    if (named == nullptr) named = &run;
+  }
+  if (named == nullptr) return results;
+
+  Run matrix;
+  matrix.run_name = named->run_name;
+  matrix.run_name.args.clear();
+  matrix.family_index = named->family_index;
+  matrix.per_family_instance_index = named->per_family_instance_index;
+  matrix.tags = named->tags;
+  matrix.run_type = Run::RT_Aggregate;
+  matrix.aggregate_name = "matrix";
+  matrix.aggregate_unit = StatisticUnit::kTime;
+  matrix.report_label = named->report_label;
+  matrix.iterations = 0;
+  matrix.repetitions = named->repetitions;
+  matrix.repetition_index = Run::no_repetition_index;
+  matrix.threads = named->threads;
+  matrix.time_unit = named->time_unit;
+  matrix.matrix_counter = counter;
+  for (const auto& cell : cells) {
+    matrix.matrix_rows.push_back(cell.first.first);
+    matrix.matrix_columns.push_back(cell.first.second);
+  }
+  for (std::vector<int64_t>* labels :
+       {&matrix.matrix_rows, &matrix.matrix_columns}) {
+    std::sort(labels->begin(), labels->end());
+    labels->erase(std::unique(labels->begin(), labels->end()), labels->end());
+  }
+  for (int64_t row : matrix.matrix_rows) {
+    for (int64_t column : matrix.matrix_columns) {
+      auto it = cells.find(std::make_pair(row, column));
+      matrix.matrix_values.push_back(
+          it == cells.end() ? std::numeric_limits<double>::quiet_NaN()
+                            : it->second.first / it->second.second);
+    }
+  }
+  results.push_back(matrix);
+  return results;
+}
+
+}  // namespace benchmark
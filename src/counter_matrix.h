@@ -0,0 +1,28 @@
+#ifndef BENCHMARK_COUNTER_MATRIX_H_
+#define BENCHMARK_COUNTER_MATRIX_H_
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+
+// Return the "matrix" aggregate of Benchmark::CounterMatrix(): 'counter' of
+// the 'reports', averaged over their repetitions, by their first and second
+// arguments. Empty if none of the reports has two integer arguments and the
+// counter.
+std::vector<BenchmarkReporter::Run> ComputeCounterMatrix(
+    const std::vector<BenchmarkReporter::Run>& reports,
+    const std::string& counter);
+
+namespace internal {
+
+// The integer values of the arguments in 'args', e.g. "cpu:0/peer:3" or
+// "0/3". Returns false if there is one that is not an integer.
+bool ParseArgValues(const std::string& args, std::vector<int64_t>* values);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_COUNTER_MATRIX_H_
@@ -0,0 +1,329 @@
+#include "cpu_affinity.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <sstream>
+#include <tuple>
+
+#include "internal_macros.h"
+#include "sysinfo.h"
+
+#ifdef BENCHMARK_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+#ifdef BENCHMARK_OS_LINUX
+// Where 'cpu' is in the machine, or nullptr if it is not known.
+const CPUInfo::LogicalCpu* FindCpu(int cpu) {
+  const std::vector<CPUInfo::LogicalCpu>& topology = CPUTopology();
+  auto it = std::lower_bound(
+      topology.begin(), topology.end(), cpu,
+      [](const CPUInfo::LogicalCpu& a, int b) { return a.cpu < b; });
+  return it != topology.end() && it->cpu == cpu ? &*it : nullptr;
+}
+#endif
+
+}  // namespace
+
+bool ParseCpuList(const std::string& str, std::vector<int>* cpus) {
+  cpus->clear();
+  std::stringstream ss(str);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    char* end;
+    long first = strtol(range.c_str(), &end, 10);
+    long last = first;
+    if (end == range.c_str() || first < 0) return false;
+    if (*end == '-') {
+      const char* start = end + 1;
+      last = strtol(start, &end, 10);
+      if (end == start || last < first) return false;
+    }
+    // Tolerate the trailing newline of files in sysfs.
+    if (*end != '\0' && *end != '\n') return false;
+    for (long cpu = first; cpu <= last; ++cpu) {
+      cpus->push_back(static_cast<int>(cpu));
+    }
+  }
+  return !cpus->empty();
+}
+
+bool ParseCpuAffinity(const std::string& str, PinPolicy* policy,
+                      std::vector<int>* cpus) {
+  cpus->clear();
+  if (str.empty() || str == "none") {
+    *policy = kPinNone;
+  } else if (str == "compact") {
+    *policy = kPinCompact;
+  } else if (str == "scatter") {
+    *policy = kPinScatter;
+  } else if (str == "numa") {
+    *policy = kPinNumaNodes;
+  } else if (str == "cores") {
+    *policy = kPinCores;
+  } else if (ParseCpuList(str, cpus)) {
+    *policy = kPinCpuList;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::vector<CpuLocation> GetAllowedCpus() {
+  std::vector<CpuLocation> result;
+#ifdef BENCHMARK_OS_LINUX
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0) return result;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET(cpu, &set)) continue;
+    const CPUInfo::LogicalCpu* where = FindCpu(cpu);
+    CpuLocation loc;
+    loc.cpu = cpu;
+    loc.numa_node = where != nullptr ? where->numa_node : -1;
+    loc.package = where != nullptr ? where->package : -1;
+    loc.core = where != nullptr && where->core >= 0 ? where->core : cpu;
+    result.push_back(loc);
+  }
+#endif
+  return result;
+}
+
+TopologyThreadCounts CountTopologyThreads(
+    const std::vector<CpuLocation>& allowed) {
+  std::set<std::pair<int, int> > cores;
+  for (const CpuLocation& loc : allowed) {
+    cores.insert(std::make_pair(loc.package, loc.core));
+  }
+  TopologyThreadCounts counts;
+  counts.cpus = static_cast<int>(allowed.size());
+  counts.cores = static_cast<int>(cores.size());
+  // The set is ordered by package, the first of which is filled first.
+  counts.package_cores = 0;
+  for (const std::pair<int, int>& core : cores) {
+    if (core.first == cores.begin()->first) ++counts.package_cores;
+  }
+  return counts;
+}
+
+std::vector<std::vector<int> > AssignThreadCpus(
+    PinPolicy policy, const std::vector<int>& cpu_list, int num_threads,
+    const std::vector<CpuLocation>& allowed) {
+  std::vector<std::vector<int> > result(num_threads);
+  if (policy == kPinCpuList) {
+    for (int t = 0; t < num_threads && !cpu_list.empty(); ++t) {
+      result[t].push_back(cpu_list[t % cpu_list.size()]);
+    }
+    return result;
+  }
+  if (allowed.empty() || policy == kPinNone || policy == kPinDefault) {
+    return result;
+  }
+
+  std::vector<CpuLocation> cpus = allowed;
+  std::vector<int> nodes;
+  for (const CpuLocation& loc : cpus) nodes.push_back(loc.numa_node);
+  std::sort(nodes.begin(), nodes.end());
+  nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+  switch (policy) {
+    case kPinCompact: {
+      // Fill up a node, core by core (hyperthreads included), before moving
+      // on to the next one.
+      std::sort(cpus.begin(), cpus.end(),
+                [](const CpuLocation& a, const CpuLocation& b) {
+                  return std::make_tuple(a.numa_node, a.package, a.core,
+                                         a.cpu) <
+                         std::make_tuple(b.numa_node, b.package, b.core, b.cpu);
+                });
+      for (int t = 0; t < num_threads; ++t) {
+        result[t].push_back(cpus[t % cpus.size()].cpu);
+      }
+      break;
+    }
+    case kPinScatter: {
+      // Take the first hyperthread of every core before any of the second
+      // ones, and alternate between the nodes.
+      std::map<std::pair<int, int>, int> threads_on_core;
+      std::vector<std::tuple<int, int, int, int> > order;
+      for (const CpuLocation& loc : cpus) {
+        int sibling = threads_on_core[std::make_pair(loc.package, loc.core)]++;
+        order.push_back(std::make_tuple(sibling, loc.numa_node, loc.core,
+                                        loc.cpu));
+      }
+      std::sort(order.begin(), order.end());
+      // Within each sibling rank, round-robin over the nodes.
+      std::vector<int> scattered;
+      for (size_t begin = 0; begin < order.size();) {
+        size_t end = begin;
+        while (end < order.size() &&
+               std::get<0>(order[end]) == std::get<0>(order[begin])) {
+          ++end;
+        }
+        std::map<int, std::vector<int> > by_node;
+        for (size_t i = begin; i < end; ++i) {
+          by_node[std::get<1>(order[i])].push_back(std::get<3>(order[i]));
+        }
+        for (size_t round = 0; scattered.size() < end; ++round) {
+          for (const auto& node : by_node) {
+            if (round < node.second.size())
+              scattered.push_back(node.second[round]);
+          }
+        }
+        begin = end;
+      }
+      for (int t = 0; t < num_threads; ++t) {
+        result[t].push_back(scattered[t % scattered.size()]);
+      }
+      break;
+    }
+    case kPinCores: {
+      // The first hyperthread of every core, package by package, before any
+      // of the second ones.
+      std::map<std::pair<int, int>, int> threads_on_core;
+      std::vector<std::tuple<int, int, int, int> > order;
+      for (const CpuLocation& loc : cpus) {
+        int sibling = threads_on_core[std::make_pair(loc.package, loc.core)]++;
+        order.push_back(
+            std::make_tuple(sibling, loc.package, loc.core, loc.cpu));
+      }
+      std::sort(order.begin(), order.end());
+      for (int t = 0; t < num_threads; ++t) {
+        result[t].push_back(std::get<3>(order[t % order.size()]));
+      }
+      break;
+    }
+    case kPinNumaNodes: {
+      // Every thread may run anywhere on its node.
+      for (int t = 0; t < num_threads; ++t) {
+        const int node = nodes[t % nodes.size()];
+        for (const CpuLocation& loc : cpus) {
+          if (loc.numa_node == node) result[t].push_back(loc.cpu);
+        }
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return result;
+}
+
+std::vector<std::vector<int> > PartitionCpus(
+    const std::vector<CpuLocation>& allowed, int num_partitions,
+    int cpus_per_llc) {
+  std::vector<CpuLocation> cpus = allowed;
+  std::sort(cpus.begin(), cpus.end(),
+            [](const CpuLocation& a, const CpuLocation& b) {
+              return std::make_tuple(a.numa_node, a.package, a.core, a.cpu) <
+                     std::make_tuple(b.numa_node, b.package, b.core, b.cpu);
+            });
+
+  // Group the hyperthreads into cores, and the cores into last-level caches,
+  // assuming the cores sharing one are numbered next to each other.
+  typedef std::vector<int> Core;
+  std::vector<std::vector<Core> > llcs;
+  int llc_cpus = 0;
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    const bool same_core = i > 0 && cpus[i].package == cpus[i - 1].package &&
+                           cpus[i].core == cpus[i - 1].core;
+    if (same_core) {
+      llcs.back().back().push_back(cpus[i].cpu);
+      ++llc_cpus;
+      continue;
+    }
+    const bool same_llc = i > 0 && cpus[i].package == cpus[i - 1].package &&
+                          (cpus_per_llc <= 0 || llc_cpus < cpus_per_llc);
+    if (!same_llc) {
+      llcs.push_back(std::vector<Core>());
+      llc_cpus = 0;
+    }
+    llcs.back().push_back(Core(1, cpus[i].cpu));
+    ++llc_cpus;
+  }
+
+  size_t num_cores = 0;
+  for (const auto& llc : llcs) num_cores += llc.size();
+  std::vector<std::vector<int> > partitions;
+  if (num_partitions <= 0 || num_cores == 0) return partitions;
+  const size_t num_parts =
+      std::min(static_cast<size_t>(num_partitions), num_cores);
+  const size_t cores_per_part = num_cores / num_parts;
+
+  // Start each partition in the cache with the most cores left, and among
+  // those, the one with the fewest partitions already, so that partitions
+  // only share a cache once there are more of them than caches.
+  std::vector<size_t> next_core(llcs.size(), 0);
+  std::vector<int> parts_in_llc(llcs.size(), 0);
+  auto pick_llc = [&]() {
+    size_t best = 0;
+    for (size_t l = 1; l < llcs.size(); ++l) {
+      const size_t left = llcs[l].size() - next_core[l];
+      const size_t best_left = llcs[best].size() - next_core[best];
+      if (left > best_left ||
+          (left == best_left && parts_in_llc[l] < parts_in_llc[best])) {
+        best = l;
+      }
+    }
+    ++parts_in_llc[best];
+    return best;
+  };
+  for (size_t p = 0; p < num_parts; ++p) {
+    std::vector<int> part;
+    size_t llc = pick_llc();
+    for (size_t cores = 0; cores < cores_per_part; ++cores) {
+      // Spill over to another cache once this one is full.
+      if (next_core[llc] == llcs[llc].size()) llc = pick_llc();
+      const Core& core = llcs[llc][next_core[llc]++];
+      part.insert(part.end(), core.begin(), core.end());
+    }
+    std::sort(part.begin(), part.end());
+    partitions.push_back(part);
+  }
+  return partitions;
+}
+
+bool SetCurrentThreadAffinity(const std::vector<int>& cpus,
+                              std::vector<int>* previous) {
+#ifdef BENCHMARK_OS_LINUX
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (previous != nullptr) {
+    previous->clear();
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+      return false;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) previous->push_back(cpu);
+    }
+    CPU_ZERO(&set);
+  }
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)cpus;
+  (void)previous;
+  return false;
+#endif
+}
+
+void GetCurrentCpu(int* cpu, int* numa_node) {
+  *cpu = -1;
+  *numa_node = -1;
+#ifdef BENCHMARK_OS_LINUX
+  *cpu = sched_getcpu();
+  const CPUInfo::LogicalCpu* where = FindCpu(*cpu);
+  if (where != nullptr) *numa_node = where->numa_node;
+#endif
+}
+
+}  // end namespace internal
+}  // end namespace benchmark
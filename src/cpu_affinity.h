@@ -0,0 +1,67 @@
+#ifndef BENCHMARK_CPU_AFFINITY_H_
+#define BENCHMARK_CPU_AFFINITY_H_
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+namespace internal {
+
+// Where a cpu sits in the machine, as far as thread placement is concerned.
+struct CpuLocation {
+  int cpu;
+  int numa_node;
+  int package;
+  int core;
+};
+
+// Parse a list of cpus in the Linux 'cpulist' format, e.g. "0-3,8,10-11".
+bool ParseCpuList(const std::string& str, std::vector<int>* cpus);
+
+// Parse the value of --benchmark_cpu_affinity: empty or "none", "compact",
+// "scatter", "numa", "cores", or an explicit cpu list.
+bool ParseCpuAffinity(const std::string& str, PinPolicy* policy,
+                      std::vector<int>* cpus);
+
+// The location of every cpu the process is allowed to run on, ordered by cpu
+// number. Empty if that can't be determined on this platform.
+std::vector<CpuLocation> GetAllowedCpus();
+
+// The thread counts of the topology presets on the 'allowed' cpus: a thread
+// per core of the package that kPinCores fills first, per core, and per cpu.
+struct TopologyThreadCounts {
+  int package_cores;
+  int cores;
+  int cpus;
+};
+TopologyThreadCounts CountTopologyThreads(
+    const std::vector<CpuLocation>& allowed);
+
+// Compute the set of cpus each of the 'num_threads' threads may run on under
+// 'policy'. An empty set means the thread is not pinned.
+std::vector<std::vector<int> > AssignThreadCpus(
+    PinPolicy policy, const std::vector<int>& cpu_list, int num_threads,
+    const std::vector<CpuLocation>& allowed);
+
+// Split the 'allowed' cpus into at most 'num_partitions' disjoint sets of
+// whole cores, as many cores each, spread over the last-level caches. Each of
+// those is shared by 'cpus_per_llc' cpus (all of a package if 0). Cores that
+// don't divide evenly are left out.
+std::vector<std::vector<int> > PartitionCpus(
+    const std::vector<CpuLocation>& allowed, int num_partitions,
+    int cpus_per_llc);
+
+// Restrict the calling thread to 'cpus', returning its previous affinity in
+// 'previous' if non-null. Returns false if this is not supported.
+bool SetCurrentThreadAffinity(const std::vector<int>& cpus,
+                              std::vector<int>* previous);
+
+// The cpu the calling thread is running on, and its NUMA node, or -1.
+void GetCurrentCpu(int* cpu, int* numa_node);
+
+}  // end namespace internal
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_CPU_AFFINITY_H_
@@ -0,0 +1,140 @@
+#include "cpu_frequency.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "internal_macros.h"
+#include "timers.h"
+
+#if defined(BENCHMARK_OS_LINUX)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+#if defined(BENCHMARK_OS_LINUX)
+int OpenCycleCounter() {
+  struct perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_CPU_CYCLES;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.exclude_hv = 1;
+  int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+  if (fd < 0) {
+    // Counting the kernel's cycles may not be allowed, the thread's own are
+    // then still better than nothing.
+    attr.exclude_kernel = 1;
+    fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+  return fd;
+}
+
+bool ReadCycleCounter(int fd, uint64_t* cycles, uint64_t* time_running) {
+  uint64_t values[2];
+  if (read(fd, values, sizeof(values)) != sizeof(values)) return false;
+  *cycles = values[0];
+  *time_running = values[1];
+  return true;
+}
+#endif
+
+// Each loop iteration doubles the same register 8 times, so takes 8 cycles
+// however wide the core is; the loop counter is updated in parallel. Adding a
+// register to itself, rather than an immediate, keeps the cores that fold
+// chains of immediate additions from doing so.
+constexpr int kAddsPerLoop = 8;
+constexpr int kProbeLoops = 2500;
+constexpr int kProbeTrials = 3;
+
+}  // end namespace
+
+double ProbeCpuFrequency() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+  // The fastest of a few trials, as the others were likely interrupted.
+  double best = 0;
+  for (int trial = 0; trial < kProbeTrials; ++trial) {
+    uint64_t x = 1;
+    const double start = ChronoClockNow();
+    for (int i = 0; i < kProbeLoops; ++i) {
+#if defined(__aarch64__)
+      asm volatile(
+          "add %0, %0, %0\n\tadd %0, %0, %0\n\tadd %0, %0, %0\n\t"
+          "add %0, %0, %0\n\tadd %0, %0, %0\n\tadd %0, %0, %0\n\t"
+          "add %0, %0, %0\n\tadd %0, %0, %0\n\t"
+          : "+r"(x));
+#else
+      asm volatile(
+          "add %0, %0\n\tadd %0, %0\n\tadd %0, %0\n\tadd %0, %0\n\t"
+          "add %0, %0\n\tadd %0, %0\n\tadd %0, %0\n\tadd %0, %0\n\t"
+          : "+r"(x));
+#endif
+    }
+    const double seconds = ChronoClockNow() - start;
+    DoNotOptimize(x);
+    if (seconds > 0) {
+      best = std::max(best, kAddsPerLoop * kProbeLoops / seconds);
+    }
+  }
+  return best;
+#else
+  return 0;
+#endif
+}
+
+bool IsCpuFrequencyDrop(double frequency, double reference, double max_drop) {
+  return frequency > 0 && reference > 0 &&
+         frequency < (1 - max_drop) * reference;
+}
+
+CpuFrequencyMonitor::CpuFrequencyMonitor()
+    : fd_(-1), start_cycles_(0), start_time_running_(0), start_probe_(0) {
+#if defined(BENCHMARK_OS_LINUX)
+  fd_ = OpenCycleCounter();
+#endif
+}
+
+CpuFrequencyMonitor::~CpuFrequencyMonitor() {
+#if defined(BENCHMARK_OS_LINUX)
+  if (fd_ >= 0) close(fd_);
+#endif
+}
+
+void CpuFrequencyMonitor::Start() {
+#if defined(BENCHMARK_OS_LINUX)
+  if (fd_ >= 0 && ReadCycleCounter(fd_, &start_cycles_, &start_time_running_))
+    return;
+#endif
+  start_probe_ = ProbeCpuFrequency();
+}
+
+double CpuFrequencyMonitor::Stop() {
+#if defined(BENCHMARK_OS_LINUX)
+  uint64_t cycles, time_running;
+  if (fd_ >= 0 && ReadCycleCounter(fd_, &cycles, &time_running)) {
+    // The time is in nanoseconds.
+    if (time_running == start_time_running_) return 0;
+    return static_cast<double>(cycles - start_cycles_) /
+           (static_cast<double>(time_running - start_time_running_) * 1e-9);
+  }
+#endif
+  const double end_probe = ProbeCpuFrequency();
+  if (start_probe_ == 0 || end_probe == 0) return 0;
+  return (start_probe_ + end_probe) / 2;
+}
+
+double HighestCpuFrequency::Update(double frequency) {
+  MutexLock l(mutex_);
+  const double previous = highest_;
+  highest_ = std::max(highest_, frequency);
+  return previous;
+}
+
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,66 @@
+#ifndef BENCHMARK_CPU_FREQUENCY_H_
+#define BENCHMARK_CPU_FREQUENCY_H_
+
+#include "benchmark/benchmark.h"
+#include "mutex.h"
+
+namespace benchmark {
+namespace internal {
+
+// Measures the frequency the core of the calling thread actually runs at,
+// which turbo limits and thermal throttling move away from the nominal one.
+//
+// Where the kernel lets us, the cycles the thread ran for are counted with a
+// perf event, and divided by the time it was running: that is the mean
+// frequency over the interval. Otherwise, a chain of dependent additions,
+// which retire at one per cycle, is timed at the start and at the end of the
+// interval, and their mean is taken.
+class CpuFrequencyMonitor {
+ public:
+  CpuFrequencyMonitor();
+  ~CpuFrequencyMonitor();
+
+  void Start();
+
+  // The frequency since Start(), in Hz, or 0 if it can't be measured here.
+  double Stop();
+
+ private:
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(CpuFrequencyMonitor);
+
+  // The perf event counting the cycles of this thread, or -1.
+  int fd_;
+  uint64_t start_cycles_;
+  uint64_t start_time_running_;
+  double start_probe_;
+};
+
+// The frequency of the calling thread's core, from the time a chain of
+// dependent additions takes; 0 where we can't write such a chain.
+double ProbeCpuFrequency();
+
+// Whether 'frequency' is more than 'max_drop', a fraction, below 'reference'.
+bool IsCpuFrequencyDrop(double frequency, double reference, double max_drop);
+
+// The highest frequency the repetitions of one RunSpecifiedBenchmarks() call
+// ran at, for --benchmark_max_cpu_frequency_drop. Its runners share it, from
+// the threads of the jobs too; those of a child process report theirs back
+// in the run.
+class HighestCpuFrequency {
+ public:
+  HighestCpuFrequency() : highest_(0) {}
+
+  // Record 'frequency', and return the highest of those recorded before it.
+  double Update(double frequency);
+
+ private:
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(HighestCpuFrequency);
+
+  Mutex mutex_;
+  double highest_;
+};
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_CPU_FREQUENCY_H_
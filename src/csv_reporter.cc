@@ -35,6 +35,12 @@ std::vector<std::string> elements = {
     "name",           "iterations",       "real_time",        "cpu_time",
     "time_unit",      "bytes_per_second", "items_per_second", "label",
     "error_occurred", "error_message"};
+
+const char* const kMemoryElements[] = {
+    "allocs_per_iter",          "max_bytes_used",
+    "bytes_allocated_per_iter", "frees_per_iter",
+    "net_heap_growth_per_iter", "peak_rss_bytes",
+    "minor_page_faults_per_iter", "major_page_faults_per_iter"};
 }  // namespace
 
 std::string CsvEscape(const std::string & s) {
@@ -60,6 +66,7 @@ void CSVReporter::ReportRuns(const std::vector<Run>& reports) {
   if (!printed_header_) {
     // save the names of all the user counters
     for (const auto& run : reports) {
+      memory_columns_ |= run.has_memory_result;
       for (const auto& cnt : run.counters) {
         if (cnt.first == "bytes_per_second" || cnt.first == "items_per_second")
           continue;
@@ -72,6 +79,9 @@ void CSVReporter::ReportRuns(const std::vector<Run>& reports) {
       Out << *B++;
       if (B != elements.end()) Out << ",";
     }
+    if (memory_columns_) {
+      for (const char* element : kMemoryElements) Out << "," << element;
+    }
     for (auto B = user_counter_names_.begin();
          B != user_counter_names_.end();) {
       Out << ",\"" << *B++ << "\"";
@@ -121,7 +131,7 @@ void CSVReporter::PrintRunData(const Run& run) {
 
   // Do not print timeLabel on bigO and RMS report
   if (run.report_big_o) {
-    Out << GetBigOString(run.complexity);
+    Out << GetBigOString(run);
   } else if (!run.report_rms) {
     Out << GetTimeUnitString(run.time_unit);
   }
@@ -140,6 +150,36 @@ void CSVReporter::PrintRunData(const Run& run) {
   }
   Out << ",,";  // for error_occurred and error_message
 
+  if (memory_columns_) {
+    // Empty for what the MemoryManager didn't measure.
+    const MemoryManager::Result& memory = run.memory_result;
+    const int64_t kNotMeasured = MemoryManager::Result::TombstoneValue;
+    if (run.has_memory_result) {
+      Out << ",";
+      if (memory.num_allocs != kNotMeasured) Out << run.allocs_per_iter;
+      Out << ",";
+      if (memory.max_bytes_used != kNotMeasured) Out << run.max_bytes_used;
+      const int64_t per_iteration[] = {
+          memory.total_allocated_bytes, memory.num_frees,
+          memory.net_heap_growth};
+      for (int64_t total : per_iteration) {
+        Out << ",";
+        if (total != kNotMeasured) Out << run.MemoryPerIteration(total);
+      }
+      Out << ",";
+      if (memory.peak_rss_bytes != kNotMeasured) Out << memory.peak_rss_bytes;
+      const int64_t page_faults[] = {memory.minor_page_faults,
+                                     memory.major_page_faults};
+      for (int64_t total : page_faults) {
+        Out << ",";
+        if (total != kNotMeasured) Out << run.MemoryPerIteration(total);
+      }
+    } else {
+      Out << std::string(sizeof(kMemoryElements) / sizeof(kMemoryElements[0]),
+                         ',');
+    }
+  }
+
   // Print user counters
   for (const auto& ucn : user_counter_names_) {
     auto it = run.counters.find(ucn);
@@ -219,6 +219,33 @@ inline BENCHMARK_ALWAYS_INLINE int64_t Now() {
 #error You need to define CycleTimer for your OS and CPU
 #endif
 }
+
+// Same as Now(), but where the CPU allows it, the clock is only read once the
+// instructions before have completed, and before the ones after have started.
+// This costs a few more cycles than Now(), but keeps out-of-order execution
+// from moving the code under test across the reads.
+inline BENCHMARK_ALWAYS_INLINE int64_t NowSerialized() {
+#if defined(BENCHMARK_OS_MACOSX) || defined(BENCHMARK_OS_EMSCRIPTEN)
+  return Now();
+#elif (defined(__x86_64__) || defined(__amd64__) || defined(__i386__)) && \
+    defined(__GNUC__)
+  uint32_t low, high;
+  __asm__ volatile("lfence\n\trdtsc\n\tlfence"
+                   : "=a"(low), "=d"(high)
+                   :
+                   : "memory");
+  return static_cast<int64_t>((static_cast<uint64_t>(high) << 32) | low);
+#elif defined(__aarch64__)
+  int64_t virtual_timer_value;
+  asm volatile("isb\n\tmrs %0, cntvct_el0\n\tisb"
+               : "=r"(virtual_timer_value)
+               :
+               : "memory");
+  return virtual_timer_value;
+#else
+  return Now();
+#endif
+}
 }  // end namespace cycleclock
 }  // end namespace benchmark
 
@@ -0,0 +1,293 @@
+// The generators of benchmark::datagen, and the cache of what they generated.
+
+#include "internal_macros.h"
+
+#ifdef BENCHMARK_OS_WINDOWS
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "benchmark_runner.h"
+#include "check.h"
+#include "mutex.h"
+#include "string_util.h"
+
+namespace benchmark {
+namespace datagen {
+namespace {
+
+// Written first in each file, followed by the number of values, and the
+// values, or the lengths and then the characters of the strings.
+const char kNumbersMagic[8] = {'b', 'm', 'd', 'a', 't', 'a', 'n', '1'};
+const char kStringsMagic[8] = {'b', 'm', 'd', 'a', 't', 'a', 's', '1'};
+constexpr size_t kHeaderSize = sizeof(kNumbersMagic) + sizeof(uint64_t);
+
+// An input, generated here or read from a file.
+struct Input {
+  Input() : mapping(nullptr), mapping_size(0) {}
+  ~Input() {
+#ifndef BENCHMARK_OS_WINDOWS
+    if (mapping != nullptr) munmap(mapping, mapping_size);
+#endif
+  }
+
+  Values<int64_t> numbers() const {
+    if (mapping != nullptr) {
+      return Values<int64_t>(
+          reinterpret_cast<const int64_t*>(static_cast<const char*>(mapping) +
+                                           kHeaderSize),
+          (mapping_size - kHeaderSize) / sizeof(int64_t));
+    }
+    return Values<int64_t>(values.data(), values.size());
+  }
+
+  std::vector<int64_t> values;
+  std::vector<std::string> strings;
+  // The file the values are mapped from, if any.
+  void* mapping;
+  size_t mapping_size;
+};
+
+Mutex cache_mutex;
+// By the name of the input, which is also that of its file.
+std::map<std::string, std::unique_ptr<Input> >* cache GUARDED_BY(cache_mutex) =
+    nullptr;
+
+std::string InputPath(const std::string& name) {
+  const std::string dir = absl::GetFlag(FLAGS_benchmark_datagen_dir);
+  return dir.empty() ? "" : dir + "/" + name + ".bin";
+}
+
+// Map the values of the file at 'path' into 'input', if it has them.
+bool MapNumbers(const std::string& path, Input* input) {
+#ifdef BENCHMARK_OS_WINDOWS
+  (void)path;
+  (void)input;
+  return false;
+#else
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  void* mapping = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= kHeaderSize) {
+    mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                   MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (mapping == MAP_FAILED) return false;
+  const size_t size = static_cast<size_t>(st.st_size);
+  uint64_t count;
+  std::memcpy(&count, static_cast<const char*>(mapping) + sizeof(kNumbersMagic),
+              sizeof(count));
+  if (std::memcmp(mapping, kNumbersMagic, sizeof(kNumbersMagic)) != 0 ||
+      size != kHeaderSize + count * sizeof(int64_t)) {
+    munmap(mapping, size);
+    return false;
+  }
+  input->mapping = mapping;
+  input->mapping_size = size;
+  return true;
+#endif
+}
+
+bool ReadStrings(const std::string& path, Input* input) {
+  std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+  char magic[sizeof(kStringsMagic)];
+  uint64_t count;
+  if (!file.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, kStringsMagic, sizeof(magic)) != 0 ||
+      !file.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+    return false;
+  }
+  std::vector<uint64_t> lengths(static_cast<size_t>(count));
+  if (!file.read(reinterpret_cast<char*>(lengths.data()),
+                 static_cast<std::streamsize>(count * sizeof(uint64_t)))) {
+    return false;
+  }
+  std::vector<std::string> strings(lengths.size());
+  for (size_t i = 0; i < lengths.size(); ++i) {
+    strings[i].resize(static_cast<size_t>(lengths[i]));
+    if (lengths[i] != 0 &&
+        !file.read(&strings[i][0], static_cast<std::streamsize>(lengths[i]))) {
+      return false;
+    }
+  }
+  input->strings.swap(strings);
+  return true;
+}
+
+// Write 'input' to 'path', through a temporary file so that concurrent runs
+// never read half of it.
+void WriteInput(const std::string& path, const Input& input, bool strings) {
+#ifdef BENCHMARK_OS_WINDOWS
+  _mkdir(absl::GetFlag(FLAGS_benchmark_datagen_dir).c_str());
+#else
+  mkdir(absl::GetFlag(FLAGS_benchmark_datagen_dir).c_str(), 0777);
+#endif
+  const std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary.c_str(), std::ios::out | std::ios::binary);
+    const uint64_t count = strings ? input.strings.size() : input.values.size();
+    file.write(strings ? kStringsMagic : kNumbersMagic, sizeof(kNumbersMagic));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    if (strings) {
+      for (const std::string& s : input.strings) {
+        const uint64_t length = s.size();
+        file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+      }
+      for (const std::string& s : input.strings) file.write(s.data(), s.size());
+    } else {
+      file.write(reinterpret_cast<const char*>(input.values.data()),
+                 static_cast<std::streamsize>(count * sizeof(int64_t)));
+    }
+    if (!file) {
+      std::remove(temporary.c_str());
+      return;
+    }
+  }
+  std::rename(temporary.c_str(), path.c_str());
+}
+
+// The input 'name', generated by 'generate' unless it already was, or is in
+// its file.
+template <typename Generate>
+const Input& GetInput(const std::string& name, bool strings,
+                      Generate generate) {
+  MutexLock l(cache_mutex);
+  if (cache == nullptr) {
+    cache = new std::map<std::string, std::unique_ptr<Input> >();
+  }
+  std::unique_ptr<Input>& input = (*cache)[name];
+  if (input) return *input;
+  input.reset(new Input);
+  const std::string path = InputPath(name);
+  if (!path.empty() && (strings ? ReadStrings(path, input.get())
+                                : MapNumbers(path, input.get()))) {
+    return *input;
+  }
+  generate(input.get());
+  if (!path.empty()) WriteInput(path, *input, strings);
+  return *input;
+}
+
+// A double in [0, 1) from all the 53 bits of mantissa.
+double UniformReal(std::mt19937_64* rng) {
+  return static_cast<double>((*rng)() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+}  // namespace
+
+Values<int64_t> Uniform(size_t n, int64_t min, int64_t max, uint64_t seed) {
+  BM_CHECK(min <= max);
+  const std::string name =
+      StrFormat("uniform_%zu_%" PRId64 "_%" PRId64 "_%016" PRIx64, n, min, max,
+                seed);
+  return GetInput(name, false, [=](Input* input) {
+           std::mt19937_64 rng(seed);
+           // 0 for the whole range of int64_t.
+           const uint64_t range =
+               static_cast<uint64_t>(max) - static_cast<uint64_t>(min) + 1;
+           input->values.resize(n);
+           for (int64_t& value : input->values) {
+             const uint64_t r = range == 0 ? rng() : rng() % range;
+             value = static_cast<int64_t>(static_cast<uint64_t>(min) + r);
+           }
+         })
+      .numbers();
+}
+
+Values<int64_t> Zipf(size_t n, int64_t num_values, double exponent,
+                     uint64_t seed) {
+  BM_CHECK(num_values > 0);
+  const std::string name =
+      StrFormat("zipf_%zu_%" PRId64 "_%g_%016" PRIx64, n, num_values, exponent,
+                seed);
+  return GetInput(name, false, [=](Input* input) {
+           std::vector<double> cdf(static_cast<size_t>(num_values));
+           double total = 0;
+           for (size_t i = 0; i < cdf.size(); ++i) {
+             total += 1 / std::pow(static_cast<double>(i + 1), exponent);
+             cdf[i] = total;
+           }
+           std::mt19937_64 rng(seed);
+           input->values.resize(n);
+           for (int64_t& value : input->values) {
+             const double u = UniformReal(&rng) * total;
+             const size_t i = static_cast<size_t>(
+                 std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+             value = static_cast<int64_t>(std::min(i, cdf.size() - 1));
+           }
+         })
+      .numbers();
+}
+
+Values<int64_t> NearlySorted(size_t n, double unsorted, uint64_t seed) {
+  const std::string name =
+      StrFormat("nearly_sorted_%zu_%g_%016" PRIx64, n, unsorted, seed);
+  return GetInput(name, false, [=](Input* input) {
+           input->values.resize(n);
+           std::iota(input->values.begin(), input->values.end(), int64_t{0});
+           if (n < 2) return;
+           std::mt19937_64 rng(seed);
+           const uint64_t swaps = static_cast<uint64_t>(
+               static_cast<double>(n) * std::max(0.0, unsorted) / 2);
+           for (uint64_t s = 0; s < swaps; ++s) {
+             std::swap(input->values[rng() % n], input->values[rng() % n]);
+           }
+         })
+      .numbers();
+}
+
+const std::vector<std::string>& Strings(const Values<int64_t>& lengths,
+                                        uint64_t seed) {
+  const std::string name = StrFormat(
+      "strings_%zu_%016" PRIx64 "_%016" PRIx64, lengths.size(),
+      Fnv1aHash(reinterpret_cast<const char*>(lengths.data()),
+                lengths.size() * sizeof(int64_t)),
+      seed);
+  return GetInput(name, true, [&](Input* input) {
+           std::mt19937_64 rng(seed);
+           input->strings.resize(lengths.size());
+           for (size_t i = 0; i < lengths.size(); ++i) {
+             std::string& s = input->strings[i];
+             s.resize(static_cast<size_t>(std::max<int64_t>(0, lengths[i])));
+             // 13 letters out of each random number, as 26^13 < 2^64.
+             for (size_t c = 0; c < s.size();) {
+               uint64_t r = rng();
+               for (int k = 0; k < 13 && c < s.size(); ++k, ++c) {
+                 s[c] = static_cast<char>('a' + r % 26);
+                 r /= 26;
+               }
+             }
+           }
+         })
+      .strings;
+}
+
+void ClearCache() {
+  MutexLock l(cache_mutex);
+  if (cache != nullptr) cache->clear();
+}
+
+}  // namespace datagen
+}  // namespace benchmark
@@ -0,0 +1,108 @@
+#include "energy.h"
+
+#include <fstream>
+
+#include "internal_macros.h"
+#include "string_util.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+const char kEnergyPrefix[] = "energy/";
+
+template <class ArgT>
+bool ReadFromFile(const std::string& path, ArgT* arg) {
+  *arg = ArgT();
+  std::ifstream f(path.c_str());
+  if (!f.is_open()) return false;
+  f >> *arg;
+  return !f.fail();
+}
+
+}  // end namespace
+
+EnergyMeter::EnergyMeter(const std::string& powercap_dir) {
+#if defined(BENCHMARK_OS_LINUX)
+  // The zones are numbered from 0, with the subzones of "intel-rapl:<n>" in
+  // "intel-rapl:<n>:<m>". Those of the MMIO interface count the same
+  // packages again, and are left out.
+  for (int zone = 0;; ++zone) {
+    const std::string zone_dir =
+        StrCat(powercap_dir, "/intel-rapl:", zone);
+    std::string zone_name;
+    if (!ReadFromFile(StrCat(zone_dir, "/name"), &zone_name)) break;
+    for (int subzone = -1;; ++subzone) {
+      const std::string dir =
+          subzone < 0 ? zone_dir : StrCat(zone_dir, ":", subzone);
+      std::string name;
+      if (!ReadFromFile(StrCat(dir, "/name"), &name)) break;
+      uint64_t range = 0;
+      if (!ReadFromFile(StrCat(dir, "/max_energy_range_uj"), &range) ||
+          range == 0) {
+        continue;
+      }
+      const std::string path = StrCat(dir, "/energy_uj");
+      uint64_t value;
+      if (!ReadFromFile(path, &value)) {
+        // Since the power side channels, only root can read the counters.
+        error_ = StrCat("could not read ", path,
+                        ", which may only be readable by root");
+        names_.clear();
+        paths_.clear();
+        ranges_.clear();
+        return;
+      }
+      names_.push_back(subzone < 0 ? name : StrCat(zone_name, "/", name));
+      paths_.push_back(path);
+      ranges_.push_back(range);
+    }
+  }
+  if (names_.empty()) error_ = StrCat("no RAPL domains in ", powercap_dir);
+#else
+  error_ = "the energy of the cpus is only read on Linux";
+  (void)powercap_dir;
+#endif
+}
+
+std::vector<uint64_t> EnergyMeter::Read() const {
+  std::vector<uint64_t> values(paths_.size());
+  for (size_t d = 0; d < paths_.size(); ++d)
+    ReadFromFile(paths_[d], &values[d]);
+  return values;
+}
+
+void EnergyMeter::AddEnergy(const std::vector<uint64_t>& start,
+                            UserCounters* counters) const {
+  const std::vector<uint64_t> end = Read();
+  for (size_t d = 0; d < names_.size(); ++d) {
+    // The counter wrapped around at most once, in a run a lot shorter than
+    // the minutes it takes.
+    const uint64_t microjoules = end[d] >= start[d]
+                                     ? end[d] - start[d]
+                                     : ranges_[d] - start[d] + end[d];
+    (*counters)[kEnergyPrefix + names_[d]] =
+        Counter(static_cast<double>(microjoules) * 1e-6,
+                Counter::kAvgIterations);
+  }
+}
+
+const EnergyMeter& GetEnergyMeter() {
+  static const EnergyMeter* meter = new EnergyMeter("/sys/class/powercap");
+  return *meter;
+}
+
+void AddPowerCounters(double seconds, UserCounters* counters) {
+  if (seconds <= 0) return;
+  const size_t prefix_size = sizeof(kEnergyPrefix) - 1;
+  UserCounters power;
+  for (const auto& counter : *counters) {
+    if (counter.first.compare(0, prefix_size, kEnergyPrefix) != 0) continue;
+    power["power/" + counter.first.substr(prefix_size)] =
+        Counter(counter.second.value / seconds);
+  }
+  counters->insert(power.begin(), power.end());
+}
+
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,55 @@
+#ifndef BENCHMARK_ENERGY_H_
+#define BENCHMARK_ENERGY_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+namespace internal {
+
+// Reads the energy counters of the RAPL domains, which Intel and AMD cpus
+// both have, through the powercap zones of Linux: a package domain per
+// socket, "package-0", and those it has of its cores and its memory,
+// "package-0/core" and "package-0/dram". The counters are those of the whole
+// package, whatever runs on it, and they are only updated every millisecond
+// or so.
+class EnergyMeter {
+ public:
+  // Finds the domains under 'powercap_dir', usually /sys/class/powercap.
+  explicit EnergyMeter(const std::string& powercap_dir);
+
+  // The names of the domains, or none if the energy can't be measured here.
+  const std::vector<std::string>& domains() const { return names_; }
+  // Why there are no domains, if so.
+  const std::string& error() const { return error_; }
+
+  // The counter of each domain, in microjoules.
+  std::vector<uint64_t> Read() const;
+
+  // Add the joules each domain used since 'start', a Read(), to 'counters',
+  // as "energy/<domain>", averaged over the iterations.
+  void AddEnergy(const std::vector<uint64_t>& start,
+                 UserCounters* counters) const;
+
+ private:
+  std::vector<std::string> names_;
+  std::vector<std::string> paths_;
+  // Where each counter wraps around to 0.
+  std::vector<uint64_t> ranges_;
+  std::string error_;
+};
+
+// The meter of the domains of this host, found on first use.
+const EnergyMeter& GetEnergyMeter();
+
+// Add the mean watts of each "energy/<domain>" of 'counters', joules that are
+// not averaged yet, over the 'seconds' the run took, as "power/<domain>".
+void AddPowerCounters(double seconds, UserCounters* counters);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_ENERGY_H_
@@ -0,0 +1,75 @@
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+// The output is a line per frame, "<run>;<region>;...;<region> <ns>", as
+// flamegraph.pl and the likes take it. The repetitions of a run have the same
+// stacks, which those tools add up.
+
+namespace benchmark {
+
+namespace {
+
+const char kRegionPrefix[] = "region/";
+
+// The nanoseconds a frame takes over all the iterations and the threads.
+int64_t Nanoseconds(double seconds) {
+  return seconds > 0 ? static_cast<int64_t>(std::llround(seconds * 1e9)) : 0;
+}
+
+}  // end namespace
+
+bool FoldedReporter::ReportContext(const Context&) {
+  // Only the stacks, so that the output can be fed as it is to the tools.
+  return true;
+}
+
+void FoldedReporter::ReportRuns(const std::vector<Run>& reports) {
+  std::ostream& out = GetOutputStream();
+  for (const Run& run : reports) {
+    if (run.run_type != Run::RT_Iteration || run.error_occurred) continue;
+    // The seconds spent in each region, and the part of them spent in the
+    // regions nested in it.
+    const double iterations = static_cast<double>(run.iterations);
+    std::map<std::string, double> inclusive;
+    std::map<std::string, double> nested;
+    for (const auto& counter : run.counters) {
+      const std::string& name = counter.first;
+      if (name.compare(0, sizeof(kRegionPrefix) - 1, kRegionPrefix) != 0)
+        continue;
+      const std::string path = name.substr(sizeof(kRegionPrefix) - 1);
+      // The perf counts of the region.
+      if (path.find('/') != std::string::npos) continue;
+      const double seconds = counter.second.value * iterations;
+      inclusive[path] = seconds;
+      const size_t parent_end = path.rfind(';');
+      nested[parent_end == std::string::npos ? std::string()
+                                             : path.substr(0, parent_end)] +=
+          seconds;
+    }
+    if (inclusive.empty()) continue;
+
+    // ';' would split the run into frames of its own.
+    std::string run_name = run.benchmark_name();
+    for (char& c : run_name) {
+      if (c == ';') c = ':';
+    }
+    const double run_seconds = run.real_accumulated_time *
+                               static_cast<double>(run.threads * run.processes);
+    const int64_t outside = Nanoseconds(run_seconds - nested[std::string()]);
+    if (outside > 0) out << run_name << ' ' << outside << '\n';
+    for (const auto& region : inclusive) {
+      const int64_t self =
+          Nanoseconds(region.second - nested[region.first]);
+      if (self > 0)
+        out << run_name << ';' << region.first << ' ' << self << '\n';
+    }
+  }
+}
+
+}  // end namespace benchmark
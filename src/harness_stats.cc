@@ -0,0 +1,108 @@
+#include "harness_stats.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "string_util.h"
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+std::atomic<HarnessStats*> harness_stats(nullptr);
+
+const char* const kPhaseNames[HarnessStats::kNumPhases] = {
+    "timed", "paused", "setup", "threads", "probing", "memory", "reporting"};
+
+// The seconds of each phase of a row, then the other and total ones.
+std::string FormatRow(const std::string& name, int name_width,
+                      const double* seconds, double other, double total) {
+  std::string row = StrFormat("%-*s", name_width, name.c_str());
+  for (int p = 0; p < HarnessStats::kNumPhases; ++p)
+    row += StrFormat(" %10.3f", seconds[p]);
+  return row + StrFormat(" %10.3f %10.3f\n", other, total);
+}
+
+}  // end namespace
+
+void HarnessStats::Add(const std::string& name, Phase phase, double seconds) {
+  MutexLock l(mutex_);
+  GetInstance(name).seconds[phase] += seconds;
+}
+
+void HarnessStats::AddRepetition(const std::string& name, double seconds) {
+  MutexLock l(mutex_);
+  GetInstance(name).repetitions += seconds;
+}
+
+double HarnessStats::Get(const std::string& name, Phase phase) const {
+  MutexLock l(mutex_);
+  const auto it = instances_.find(name);
+  return it == instances_.end() ? 0 : it->second.seconds[phase];
+}
+
+double HarnessStats::GetTotal(Phase phase) const {
+  MutexLock l(mutex_);
+  double total = 0;
+  for (const auto& instance : instances_)
+    total += instance.second.seconds[phase];
+  return total;
+}
+
+void HarnessStats::Print(std::ostream& out, double total_seconds) const {
+  MutexLock l(mutex_);
+  int name_width = 5;
+  for (const std::string& name : names_)
+    name_width = std::max(name_width, static_cast<int>(name.size()));
+
+  std::string header = StrFormat("%-*s", name_width, "Harness");
+  for (const char* phase : kPhaseNames) header += StrFormat(" %10s", phase);
+  out << header << StrFormat(" %10s %10s\n", "other", "total")
+      << std::string(header.size() + 22, '-') << "\n";
+
+  double totals[kNumPhases] = {};
+  double others = 0;
+  double accounted = 0;
+  for (const std::string& name : names_) {
+    const Instance& instance = instances_.at(name);
+    // All but the reporting happens during the repetitions; the rest of
+    // those is the runner's own.
+    double in_repetitions = 0;
+    for (int p = 0; p < kNumPhases; ++p) {
+      totals[p] += instance.seconds[p];
+      if (p != kReporting) in_repetitions += instance.seconds[p];
+    }
+    const double other = std::max(0.0, instance.repetitions - in_repetitions);
+    const double total = in_repetitions + other + instance.seconds[kReporting];
+    others += other;
+    accounted += total;
+    out << FormatRow(name, name_width, instance.seconds, other, total);
+  }
+  // What the instances don't account for is that of the harness between
+  // them.
+  const double other = others + std::max(0.0, total_seconds - accounted);
+  const double total = std::max(total_seconds, accounted);
+  out << FormatRow("total", name_width, totals, other, total);
+  if (total <= 0) return;
+  std::string shares = StrFormat("%-*s", name_width, "%");
+  for (int p = 0; p < kNumPhases; ++p)
+    shares += StrFormat(" %9.1f%%", totals[p] * 100 / total);
+  out << shares << StrFormat(" %9.1f%% %9.1f%%\n", other * 100 / total, 100.0);
+}
+
+HarnessStats::Instance& HarnessStats::GetInstance(const std::string& name) {
+  auto it = instances_.find(name);
+  if (it == instances_.end()) {
+    names_.push_back(name);
+    it = instances_.insert(std::make_pair(name, Instance())).first;
+  }
+  return it->second;
+}
+
+HarnessStats* GetHarnessStats() { return harness_stats.load(); }
+
+void SetHarnessStats(HarnessStats* stats) { harness_stats.store(stats); }
+
+}  // namespace internal
+}  // namespace benchmark
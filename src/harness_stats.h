@@ -0,0 +1,79 @@
+#ifndef BENCHMARK_HARNESS_STATS_H_
+#define BENCHMARK_HARNESS_STATS_H_
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "mutex.h"
+
+namespace benchmark {
+namespace internal {
+
+// Where the wall time of the benchmarks went, for --benchmark_harness_stats:
+// how much of it the timers measured, and how much the harness spent around
+// them, per instance and in total. Any thread can add to it.
+class HarnessStats {
+ public:
+  enum Phase {
+    // Of the runs that are reported, on the main thread of the run: while the
+    // timer ran, while it was paused, in the fixture and the rest of the
+    // benchmark before and after its loop, and in starting, waiting for and
+    // joining the threads.
+    kTimed,
+    kPaused,
+    kSetup,
+    kThreads,
+    // The whole of the runs that probe for the iteration count, and of the
+    // warm-up.
+    kProbing,
+    // The whole of the runs of the memory manager.
+    kMemory,
+    // In the reporters, on whichever thread reports.
+    kReporting,
+    kNumPhases
+  };
+
+  // Add 'seconds' to the 'phase' of the instance 'name'.
+  void Add(const std::string& name, Phase phase, double seconds);
+
+  // Add the 'seconds' a repetition of the instance 'name' took, of which what
+  // no phase accounts for is the "other" of the instance.
+  void AddRepetition(const std::string& name, double seconds);
+
+  // The seconds of the 'phase' of the instance 'name', or of all of them.
+  double Get(const std::string& name, Phase phase) const;
+  double GetTotal(Phase phase) const;
+
+  // Print a table of the seconds of each phase of each instance, and of all
+  // of them, out of the 'total_seconds' the benchmarks took, along with the
+  // share of the total of each phase. What the instances don't account for
+  // is "other" in the total.
+  void Print(std::ostream& out, double total_seconds) const;
+
+ private:
+  struct Instance {
+    Instance() : repetitions(0) {
+      for (int p = 0; p < kNumPhases; ++p) seconds[p] = 0;
+    }
+    double seconds[kNumPhases];
+    double repetitions;
+  };
+
+  Instance& GetInstance(const std::string& name) REQUIRES(mutex_);
+
+  mutable Mutex mutex_;
+  // In the order they were first added to.
+  std::vector<std::string> names_ GUARDED_BY(mutex_);
+  std::map<std::string, Instance> instances_ GUARDED_BY(mutex_);
+};
+
+// The stats of the benchmarks being run, or null.
+HarnessStats* GetHarnessStats();
+void SetHarnessStats(HarnessStats* stats);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_HARNESS_STATS_H_
@@ -0,0 +1,70 @@
+#include "interference.h"
+
+#include "cache_flush.h"
+#include "sysinfo.h"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+// The bytes of each miss of the last-level cache.
+constexpr double kCacheLineSize = 64;
+// The misses per thousand instructions past which a benchmark is bound by
+// the memory rather than by the caches.
+constexpr double kHeavyLlcMpki = 10;
+
+bool GetNumber(const PreviousRun& run, const char* name, double* value) {
+  auto it = run.numbers.find(name);
+  if (it == run.numbers.end()) return false;
+  *value = it->second;
+  return true;
+}
+
+}  // end namespace
+
+bool IsCacheHeavy(const PreviousRun& run, double cache_bytes) {
+  double value;
+  return (GetNumber(run, "max_bytes_used", &value) && value >= cache_bytes) ||
+         (GetNumber(run, "CACHE-MISSES", &value) &&
+          value * kCacheLineSize >= cache_bytes) ||
+         (GetNumber(run, "llc_mpki", &value) && value >= kHeavyLlcMpki);
+}
+
+bool ReadCacheHeavyInstances(const std::string& path, double cache_bytes,
+                             std::set<std::string>* names) {
+  std::vector<PreviousRun> runs;
+  if (!ReadPreviousRuns(path, &runs)) return false;
+  std::set<std::string> seen;
+  for (const PreviousRun& run : runs) {
+    auto run_type = run.strings.find("run_type");
+    auto name = run.strings.find("run_name");
+    auto error = run.numbers.find("error_occurred");
+    if (run_type == run.strings.end() || run_type->second != "iteration" ||
+        name == run.strings.end() ||
+        (error != run.numbers.end() && error->second != 0) ||
+        !seen.insert(name->second).second) {
+      continue;
+    }
+    if (IsCacheHeavy(run, cache_bytes)) names->insert(name->second);
+  }
+  return true;
+}
+
+double LastLevelCacheBytes() {
+  return static_cast<double>(CacheFlushSize(CPUCaches())) / 2;
+}
+
+void ScrubCachesAndAllocator() {
+  FlushAllCaches();
+#if defined(__GLIBC__)
+  malloc_trim(0);
+#endif
+}
+
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,38 @@
+#ifndef BENCHMARK_INTERFERENCE_H_
+#define BENCHMARK_INTERFERENCE_H_
+
+#include <set>
+#include <string>
+
+#include "results_reader.h"
+
+namespace benchmark {
+namespace internal {
+
+// Whether the instance that ran as 'run' before goes through more memory
+// than the 'cache_bytes' of the last-level cache, and so leaves little of
+// what the next instance had in it, for --benchmark_interference_file: if it
+// used at least as much memory at its peak, as the memory manager measured
+// it, if it missed the cache for at least as many bytes per iteration, by
+// its CACHE-MISSES counter, or if it missed it at least 10 times per
+// thousand instructions, by its llc_mpki metric.
+bool IsCacheHeavy(const PreviousRun& run, double cache_bytes);
+
+// Read the names of the instances that were cache-heavy in the output at
+// 'path', from the first of their repetitions that didn't fail. Return false
+// if the file can't be read or parsed.
+bool ReadCacheHeavyInstances(const std::string& path, double cache_bytes,
+                             std::set<std::string>* names);
+
+// The size of the last-level cache of this host, in bytes: that of the
+// largest cache, or 32 MiB if there are none.
+double LastLevelCacheBytes();
+
+// Evict what a cache-heavy instance left in the caches of the calling cpu,
+// and give the memory it freed back to the system where the allocator can.
+void ScrubCachesAndAllocator();
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_INTERFERENCE_H_
@@ -15,15 +15,17 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
-#include <iomanip>  // for setprecision
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <limits>
 #include <string>
-#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "benchmark/benchmark.h"
 #include "complexity.h"
+#include "statistics.h"
 #include "string_util.h"
 #include "timers.h"
 
@@ -34,83 +36,186 @@ extern std::map<std::string, std::string>* global_context;
 
 namespace {
 
-std::string StrEscape(const std::string& s) {
-  std::string tmp;
-  tmp.reserve(s.size());
-  for (char c : s) {
-    switch (c) {
-      case '\b':
-        tmp += "\\b";
-        break;
-      case '\f':
-        tmp += "\\f";
-        break;
-      case '\n':
-        tmp += "\\n";
-        break;
-      case '\r':
-        tmp += "\\r";
-        break;
-      case '\t':
-        tmp += "\\t";
-        break;
-      case '\\':
-        tmp += "\\\\";
-        break;
-      case '"':
-        tmp += "\\\"";
-        break;
-      default:
-        tmp += c;
-        break;
-    }
+// The output is built up in a buffer which is reused from one call to the
+// next, and numbers are formatted straight into it, so that writing a run
+// doesn't allocate once the buffer is large enough.
+
+// A string that is not copied, from either a literal or a std::string.
+struct StringPiece {
+  StringPiece(const char* s) : data(s), size(std::strlen(s)) {}
+  StringPiece(const std::string& s) : data(s.data()), size(s.size()) {}
+  const char* data;
+  size_t size;
+};
+
+const char* EscapeSequence(char c) {
+  switch (c) {
+    case '\b':
+      return "\\b";
+    case '\f':
+      return "\\f";
+    case '\n':
+      return "\\n";
+    case '\r':
+      return "\\r";
+    case '\t':
+      return "\\t";
+    case '\\':
+      return "\\\\";
+    case '"':
+      return "\\\"";
+    default:
+      return nullptr;
+  }
+}
+
+void AppendEscaped(std::string* out, StringPiece s) {
+  // Most strings need no escaping, and are appended in one go.
+  size_t begin = 0;
+  for (size_t i = 0; i < s.size; ++i) {
+    const char* escaped = EscapeSequence(s.data[i]);
+    if (escaped == nullptr) continue;
+    out->append(s.data + begin, i - begin);
+    out->append(escaped);
+    begin = i + 1;
   }
-  return tmp;
+  out->append(s.data + begin, s.size - begin);
 }
 
-std::string FormatKV(std::string const& key, std::string const& value) {
-  return StrFormat("\"%s\": \"%s\"", StrEscape(key).c_str(),
-                   StrEscape(value).c_str());
+void AppendUnsigned(std::string* out, uint64_t value) {
+  char buffer[20];
+  char* end = buffer + sizeof(buffer);
+  char* p = end;
+  do {
+    *--p = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  out->append(p, static_cast<size_t>(end - p));
 }
 
-std::string FormatKV(std::string const& key, const char* value) {
-  return StrFormat("\"%s\": \"%s\"", StrEscape(key).c_str(),
-                   StrEscape(value).c_str());
+void AppendInt(std::string* out, int64_t value) {
+  if (value < 0) {
+    out->push_back('-');
+    // Negated as unsigned, which is well defined for the most negative value.
+    AppendUnsigned(out, 0 - static_cast<uint64_t>(value));
+  } else {
+    AppendUnsigned(out, static_cast<uint64_t>(value));
+  }
 }
 
-std::string FormatKV(std::string const& key, bool value) {
-  return StrFormat("\"%s\": %s", StrEscape(key).c_str(),
-                   value ? "true" : "false");
+void AppendDouble(std::string* out, double value) {
+  if (std::isnan(value)) {
+    out->append("NaN");
+  } else if (std::isinf(value)) {
+    out->append(value < 0 ? "-Infinity" : "Infinity");
+  } else {
+    // Enough digits for the value to be read back exactly.
+    const int max_fractional_digits10 =
+        std::numeric_limits<double>::max_digits10 - 1;
+    char buffer[32];
+    const int size = std::snprintf(buffer, sizeof(buffer), "%.*e",
+                                   max_fractional_digits10, value);
+    out->append(buffer, static_cast<size_t>(size));
+  }
 }
 
-std::string FormatKV(std::string const& key, int64_t value) {
-  std::stringstream ss;
-  ss << '"' << StrEscape(key) << "\": " << value;
-  return ss.str();
+// The shortest form, as an ostream writes it by default.
+void AppendShortDouble(std::string* out, double value) {
+  char buffer[32];
+  const int size = std::snprintf(buffer, sizeof(buffer), "%g", value);
+  out->append(buffer, static_cast<size_t>(size));
 }
 
-std::string FormatKV(std::string const& key, IterationCount value) {
-  std::stringstream ss;
-  ss << '"' << StrEscape(key) << "\": " << value;
-  return ss.str();
+void AppendKey(std::string* out, StringPiece key) {
+  out->push_back('"');
+  AppendEscaped(out, key);
+  out->append("\": ");
 }
 
-std::string FormatKV(std::string const& key, double value) {
-  std::stringstream ss;
-  ss << '"' << StrEscape(key) << "\": ";
-
-  if (std::isnan(value))
-    ss << (value < 0 ? "-" : "") << "NaN";
-  else if (std::isinf(value))
-    ss << (value < 0 ? "-" : "") << "Infinity";
-  else {
-    const auto max_digits10 =
-        std::numeric_limits<decltype(value)>::max_digits10;
-    const auto max_fractional_digits10 = max_digits10 - 1;
-    ss << std::scientific << std::setprecision(max_fractional_digits10)
-       << value;
-  }
-  return ss.str();
+void AppendKV(std::string* out, StringPiece key, StringPiece value) {
+  AppendKey(out, key);
+  out->push_back('"');
+  AppendEscaped(out, value);
+  out->push_back('"');
+}
+
+// Or the literals would be taken for bools.
+void AppendKV(std::string* out, StringPiece key, const char* value) {
+  AppendKV(out, key, StringPiece(value));
+}
+
+void AppendKV(std::string* out, StringPiece key, bool value) {
+  AppendKey(out, key);
+  out->append(value ? "true" : "false");
+}
+
+void AppendKV(std::string* out, StringPiece key, int64_t value) {
+  AppendKey(out, key);
+  AppendInt(out, value);
+}
+
+void AppendKV(std::string* out, StringPiece key, IterationCount value) {
+  AppendKey(out, key);
+  AppendUnsigned(out, value);
+}
+
+void AppendKV(std::string* out, StringPiece key, double value) {
+  AppendKey(out, key);
+  AppendDouble(out, value);
+}
+
+void AppendKV(std::string* out, StringPiece key,
+              std::vector<int> const& values) {
+  AppendKey(out, key);
+  out->push_back('[');
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i != 0) out->append(", ");
+    AppendInt(out, values[i]);
+  }
+  out->push_back(']');
+}
+
+void AppendKV(std::string* out, StringPiece key,
+              std::vector<IterationCount> const& values) {
+  AppendKey(out, key);
+  out->push_back('[');
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i != 0) out->append(", ");
+    AppendUnsigned(out, values[i]);
+  }
+  out->push_back(']');
+}
+
+void AppendKV(std::string* out, StringPiece key,
+              std::vector<double> const& values) {
+  AppendKey(out, key);
+  out->push_back('[');
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i != 0) out->append(", ");
+    AppendDouble(out, values[i]);
+  }
+  out->push_back(']');
+}
+
+void AppendKV(std::string* out, StringPiece key,
+              std::vector<std::string> const& values) {
+  AppendKey(out, key);
+  out->push_back('[');
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i != 0) out->append(", ");
+    out->push_back('"');
+    AppendEscaped(out, values[i]);
+    out->push_back('"');
+  }
+  out->push_back(']');
+}
+
+// Starts the next member of an object: the separator from the previous one,
+// if any, and the indentation.
+void NextMember(std::string* out, bool* first, StringPiece indent) {
+  if (!*first) out->append(",\n");
+  *first = false;
+  out->append(indent.data, indent.size);
 }
 
 int64_t RoundDouble(double v) { return std::lround(v); }
@@ -118,83 +223,121 @@ int64_t RoundDouble(double v) { return std::lround(v); }
 }  // end namespace
 
 bool JSONReporter::ReportContext(const Context& context) {
-  std::ostream& out = GetOutputStream();
+  std::string& out = buffer_;
+  out.clear();
 
-  out << "{\n";
-  std::string inner_indent(2, ' ');
+  out.append("{\n");
+  const char* inner_indent = "  ";
 
   // Open context block and print context information.
-  out << inner_indent << "\"context\": {\n";
-  std::string indent(4, ' ');
+  out.append(inner_indent).append("\"context\": {\n");
+  const char* indent = "    ";
+  bool first = true;
 
-  std::string walltime_value = LocalDateTimeString();
-  out << indent << FormatKV("date", walltime_value) << ",\n";
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "date", LocalDateTimeString());
 
-  out << indent << FormatKV("host_name", context.sys_info.name) << ",\n";
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "host_name", context.sys_info.name);
 
   if (Context::executable_name) {
-    out << indent << FormatKV("executable", Context::executable_name) << ",\n";
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "executable", Context::executable_name);
   }
 
   CPUInfo const& info = context.cpu_info;
-  out << indent << FormatKV("num_cpus", static_cast<int64_t>(info.num_cpus))
-      << ",\n";
-  out << indent
-      << FormatKV("mhz_per_cpu",
-                  RoundDouble(info.cycles_per_second / 1000000.0))
-      << ",\n";
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "num_cpus", static_cast<int64_t>(info.num_cpus));
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "mhz_per_cpu",
+           RoundDouble(info.cycles_per_second / 1000000.0));
   if (CPUInfo::Scaling::UNKNOWN != info.scaling) {
-    out << indent
-        << FormatKV("cpu_scaling_enabled",
-                    info.scaling == CPUInfo::Scaling::ENABLED ? true : false)
-        << ",\n";
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "cpu_scaling_enabled",
+             info.scaling == CPUInfo::Scaling::ENABLED ? true : false);
   }
 
-  out << indent << "\"caches\": [\n";
-  indent = std::string(6, ' ');
-  std::string cache_indent(8, ' ');
+  NextMember(&out, &first, indent);
+  out.append("\"caches\": [\n");
+  const char* cache_indent = "        ";
   for (size_t i = 0; i < info.caches.size(); ++i) {
     auto& CI = info.caches[i];
-    out << indent << "{\n";
-    out << cache_indent << FormatKV("type", CI.type) << ",\n";
-    out << cache_indent << FormatKV("level", static_cast<int64_t>(CI.level))
-        << ",\n";
-    out << cache_indent << FormatKV("size", static_cast<int64_t>(CI.size))
-        << ",\n";
-    out << cache_indent
-        << FormatKV("num_sharing", static_cast<int64_t>(CI.num_sharing))
-        << "\n";
-    out << indent << "}";
-    if (i != info.caches.size() - 1) out << ",";
-    out << "\n";
-  }
-  indent = std::string(4, ' ');
-  out << indent << "],\n";
-  out << indent << "\"load_avg\": [";
+    out.append("      {\n");
+    bool first_field = true;
+    NextMember(&out, &first_field, cache_indent);
+    AppendKV(&out, "type", CI.type);
+    NextMember(&out, &first_field, cache_indent);
+    AppendKV(&out, "level", static_cast<int64_t>(CI.level));
+    NextMember(&out, &first_field, cache_indent);
+    AppendKV(&out, "size", static_cast<int64_t>(CI.size));
+    NextMember(&out, &first_field, cache_indent);
+    AppendKV(&out, "num_sharing", static_cast<int64_t>(CI.num_sharing));
+    out.append("\n      }");
+    if (i != info.caches.size() - 1) out.push_back(',');
+    out.push_back('\n');
+  }
+  out.append(indent).append("]");
+  NextMember(&out, &first, indent);
+  out.append("\"load_avg\": [");
   for (auto it = info.load_avg.begin(); it != info.load_avg.end();) {
-    out << *it++;
-    if (it != info.load_avg.end()) out << ",";
+    AppendShortDouble(&out, *it++);
+    if (it != info.load_avg.end()) out.push_back(',');
+  }
+  out.append("]");
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "cpu_features", info.features);
+  if (!info.topology.empty()) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "num_packages", static_cast<int64_t>(info.num_packages));
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "num_cores", static_cast<int64_t>(info.num_cores));
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "num_numa_nodes",
+             static_cast<int64_t>(info.num_numa_nodes));
+    // One cpu per line, as there can be hundreds.
+    NextMember(&out, &first, indent);
+    out.append("\"cpu_topology\": [\n");
+    for (size_t i = 0; i < info.topology.size(); ++i) {
+      const CPUInfo::LogicalCpu& cpu = info.topology[i];
+      out.append("      {");
+      AppendKV(&out, "cpu", static_cast<int64_t>(cpu.cpu));
+      out.append(", ");
+      AppendKV(&out, "package", static_cast<int64_t>(cpu.package));
+      out.append(", ");
+      AppendKV(&out, "core", static_cast<int64_t>(cpu.core));
+      out.append(", ");
+      AppendKV(&out, "smt_index", static_cast<int64_t>(cpu.smt_index));
+      out.append(", ");
+      AppendKV(&out, "numa_node", static_cast<int64_t>(cpu.numa_node));
+      out.append(", ");
+      AppendKV(&out, "llc", static_cast<int64_t>(cpu.llc));
+      out.append("}");
+      if (i != info.topology.size() - 1) out.push_back(',');
+      out.push_back('\n');
+    }
+    out.append(indent).append("]");
   }
-  out << "],\n";
 
 #if defined(NDEBUG)
   const char build_type[] = "release";
 #else
   const char build_type[] = "debug";
 #endif
-  out << indent << FormatKV("library_build_type", build_type);
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "library_build_type", build_type);
 
   if (internal::global_context != nullptr) {
     for (const auto& kv : *internal::global_context) {
-      out << ",\n";
-      out << indent << FormatKV(kv.first, kv.second);
+      NextMember(&out, &first, indent);
+      AppendKV(&out, kv.first, kv.second);
     }
   }
-  out << "\n";
+  out.push_back('\n');
 
   // Close context block and open the list of benchmarks.
-  out << inner_indent << "},\n";
-  out << inner_indent << "\"benchmarks\": [\n";
+  out.append(inner_indent).append("},\n");
+  out.append(inner_indent).append("\"benchmarks\": [\n");
+  GetOutputStream().write(out.data(), static_cast<std::streamsize>(out.size()));
   return true;
 }
 
@@ -202,22 +345,23 @@ void JSONReporter::ReportRuns(std::vector<Run> const& reports) {
   if (reports.empty()) {
     return;
   }
-  std::string indent(4, ' ');
-  std::ostream& out = GetOutputStream();
+  std::string& out = buffer_;
+  out.clear();
   if (!first_report_) {
-    out << ",\n";
+    out.append(",\n");
   }
   first_report_ = false;
 
   for (auto it = reports.begin(); it != reports.end(); ++it) {
-    out << indent << "{\n";
+    out.append("    {\n");
     PrintRunData(*it);
-    out << indent << '}';
+    out.append("    }");
     auto it_cp = it;
     if (++it_cp != reports.end()) {
-      out << ",\n";
+      out.append(",\n");
     }
   }
+  GetOutputStream().write(out.data(), static_cast<std::streamsize>(out.size()));
 }
 
 void JSONReporter::Finalize() {
@@ -226,15 +370,19 @@ void JSONReporter::Finalize() {
 }
 
 void JSONReporter::PrintRunData(Run const& run) {
-  std::string indent(6, ' ');
-  std::ostream& out = GetOutputStream();
-  out << indent << FormatKV("name", run.benchmark_name()) << ",\n";
-  out << indent << FormatKV("family_index", run.family_index) << ",\n";
-  out << indent
-      << FormatKV("per_family_instance_index", run.per_family_instance_index)
-      << ",\n";
-  out << indent << FormatKV("run_name", run.run_name.str()) << ",\n";
-  out << indent << FormatKV("run_type", [&run]() -> const char* {
+  std::string& out = buffer_;
+  const char* indent = "      ";
+  bool first = true;
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "name", run.benchmark_name());
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "family_index", run.family_index);
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "per_family_instance_index", run.per_family_instance_index);
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "run_name", run.run_name.str());
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "run_type", [&run]() -> const char* {
     switch (run.run_type) {
       case BenchmarkReporter::Run::RT_Iteration:
         return "iteration";
@@ -242,16 +390,32 @@ void JSONReporter::PrintRunData(Run const& run) {
         return "aggregate";
     }
     BENCHMARK_UNREACHABLE();
-  }()) << ",\n";
-  out << indent << FormatKV("repetitions", run.repetitions) << ",\n";
+  }());
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "repetitions", run.repetitions);
   if (run.run_type != BenchmarkReporter::Run::RT_Aggregate) {
-    out << indent << FormatKV("repetition_index", run.repetition_index)
-        << ",\n";
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "repetition_index", run.repetition_index);
+  }
+  NextMember(&out, &first, indent);
+  AppendKV(&out, "threads", run.threads);
+  if (run.in_flight > 0) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "in_flight", run.in_flight);
+  }
+  if (run.processes > 1) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "processes", run.processes);
+  }
+  if (!run.tags.empty()) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "tags", run.tags);
   }
-  out << indent << FormatKV("threads", run.threads) << ",\n";
   if (run.run_type == BenchmarkReporter::Run::RT_Aggregate) {
-    out << indent << FormatKV("aggregate_name", run.aggregate_name) << ",\n";
-    out << indent << FormatKV("aggregate_unit", [&run]() -> const char* {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "aggregate_name", run.aggregate_name);
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "aggregate_unit", [&run]() -> const char* {
       switch (run.aggregate_unit) {
         case StatisticUnit::kTime:
           return "time";
@@ -259,51 +423,309 @@ void JSONReporter::PrintRunData(Run const& run) {
           return "percentage";
       }
       BENCHMARK_UNREACHABLE();
-    }()) << ",\n";
+    }());
   }
   if (run.error_occurred) {
-    out << indent << FormatKV("error_occurred", run.error_occurred) << ",\n";
-    out << indent << FormatKV("error_message", run.error_message) << ",\n";
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "error_occurred", run.error_occurred);
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "error_message", run.error_message);
   }
   if (!run.report_big_o && !run.report_rms) {
-    out << indent << FormatKV("iterations", run.iterations) << ",\n";
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "iterations", run.iterations);
     if (run.run_type != Run::RT_Aggregate ||
         run.aggregate_unit == StatisticUnit::kTime) {
-      out << indent << FormatKV("real_time", run.GetAdjustedRealTime())
-          << ",\n";
-      out << indent << FormatKV("cpu_time", run.GetAdjustedCPUTime());
+      NextMember(&out, &first, indent);
+      AppendKV(&out, "real_time", run.GetAdjustedRealTime());
+      NextMember(&out, &first, indent);
+      AppendKV(&out, "cpu_time", run.GetAdjustedCPUTime());
     } else {
       assert(run.aggregate_unit == StatisticUnit::kPercentage);
-      out << indent << FormatKV("real_time", run.real_accumulated_time)
-          << ",\n";
-      out << indent << FormatKV("cpu_time", run.cpu_accumulated_time);
+      NextMember(&out, &first, indent);
+      AppendKV(&out, "real_time", run.real_accumulated_time);
+      NextMember(&out, &first, indent);
+      AppendKV(&out, "cpu_time", run.cpu_accumulated_time);
     }
-    out << ",\n"
-        << indent << FormatKV("time_unit", GetTimeUnitString(run.time_unit));
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "time_unit", GetTimeUnitString(run.time_unit));
   } else if (run.report_big_o) {
-    out << indent << FormatKV("cpu_coefficient", run.GetAdjustedCPUTime())
-        << ",\n";
-    out << indent << FormatKV("real_coefficient", run.GetAdjustedRealTime())
-        << ",\n";
-    out << indent << FormatKV("big_o", GetBigOString(run.complexity)) << ",\n";
-    out << indent << FormatKV("time_unit", GetTimeUnitString(run.time_unit));
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "cpu_coefficient", run.GetAdjustedCPUTime());
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "real_coefficient", run.GetAdjustedRealTime());
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "big_o", GetBigOString(run));
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "time_unit", GetTimeUnitString(run.time_unit));
   } else if (run.report_rms) {
-    out << indent << FormatKV("rms", run.GetAdjustedCPUTime());
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "rms", run.GetAdjustedCPUTime());
   }
 
   for (auto& c : run.counters) {
-    out << ",\n" << indent << FormatKV(c.first, c.second);
+    NextMember(&out, &first, indent);
+    AppendKV(&out, c.first, static_cast<double>(c.second));
   }
 
   if (run.has_memory_result) {
-    out << ",\n" << indent << FormatKV("allocs_per_iter", run.allocs_per_iter);
-    out << ",\n" << indent << FormatKV("max_bytes_used", run.max_bytes_used);
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "allocs_per_iter", run.allocs_per_iter);
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "max_bytes_used", run.max_bytes_used);
+
+    // The members the MemoryManager measured, per iteration.
+    const MemoryManager::Result& memory = run.memory_result;
+    const int64_t kNotMeasured = MemoryManager::Result::TombstoneValue;
+    const std::pair<const char*, int64_t> per_iteration[] = {
+        {"bytes_allocated_per_iter", memory.total_allocated_bytes},
+        {"frees_per_iter", memory.num_frees},
+        {"net_heap_growth_per_iter", memory.net_heap_growth},
+        {"minor_page_faults_per_iter", memory.minor_page_faults},
+        {"major_page_faults_per_iter", memory.major_page_faults}};
+    for (const auto& kv : per_iteration) {
+      if (kv.second == kNotMeasured) continue;
+      NextMember(&out, &first, indent);
+      AppendKV(&out, kv.first, run.MemoryPerIteration(kv.second));
+    }
+    if (memory.peak_rss_bytes != kNotMeasured) {
+      NextMember(&out, &first, indent);
+      AppendKV(&out, "peak_rss_bytes", memory.peak_rss_bytes);
+    }
+    if (!memory.alloc_size_histogram.empty()) {
+      // The allocations per iteration of up to each size, in bytes.
+      NextMember(&out, &first, indent);
+      out.append("\"allocs_per_iter_by_size\": [");
+      bool first_bucket = true;
+      for (size_t i = 0; i < memory.alloc_size_histogram.size() && i < 64;
+           ++i) {
+        if (memory.alloc_size_histogram[i] == 0) continue;
+        if (!first_bucket) out.append(", ");
+        first_bucket = false;
+        out.push_back('[');
+        AppendUnsigned(&out, uint64_t(1) << i);
+        out.append(", ");
+        AppendDouble(&out,
+                     run.MemoryPerIteration(memory.alloc_size_histogram[i]));
+        out.push_back(']');
+      }
+      out.push_back(']');
+    }
+    // Per iteration of each thread, which all run 1/threads of them.
+    const std::pair<const char*, const std::vector<int64_t>*> per_thread[] = {
+        {"allocs_per_iter_by_thread", &memory.thread_allocs},
+        {"bytes_allocated_per_iter_by_thread",
+         &memory.thread_allocated_bytes}};
+    for (const auto& kv : per_thread) {
+      if (kv.second->empty()) continue;
+      std::vector<double> values;
+      for (int64_t total : *kv.second) {
+        values.push_back(run.MemoryPerIteration(total) * run.threads);
+      }
+      NextMember(&out, &first, indent);
+      AppendKV(&out, kv.first, values);
+    }
+  }
+
+  if (!run.thread_cpus.empty()) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "thread_cpus", run.thread_cpus);
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "thread_numa_nodes", run.thread_numa_nodes);
+  }
+
+  if (!run.thread_iterations.empty()) {
+    // The times of each thread per iteration of it, like those of the run.
+    std::vector<double> real_times, cpu_times;
+    for (size_t t = 0; t < run.thread_iterations.size(); ++t) {
+      const double multiplier =
+          run.thread_iterations[t] == 0
+              ? 0
+              : GetTimeUnitMultiplier(run.time_unit) /
+                    static_cast<double>(run.thread_iterations[t]);
+      real_times.push_back(run.thread_real_times[t] * multiplier);
+      cpu_times.push_back(run.thread_cpu_times[t] * multiplier);
+    }
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "thread_iterations", run.thread_iterations);
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "thread_real_time", real_times);
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "thread_cpu_time", cpu_times);
+  }
+
+  if (!run.sample_times.empty()) {
+    // Per iteration, like the times, with robust statistics of them.
+    std::vector<double> samples;
+    for (double sample_time : run.sample_times)
+      samples.push_back(sample_time * GetTimeUnitMultiplier(run.time_unit));
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "samples", samples);
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "samples_median", StatisticsMedian(samples));
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "samples_mad", StatisticsMAD(samples));
+  }
+
+  if (run.latency_samples > 0) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "latency_samples", run.latency_samples);
+    NextMember(&out, &first, indent);
+    out.append("\"latency_percentiles\": {");
+    for (size_t i = 0; i < run.latency_percentiles.size(); ++i) {
+      if (i != 0) out.append(", ");
+      out.append("\"p");
+      AppendShortDouble(&out, run.latency_percentiles[i].first);
+      out.append("\": ");
+      AppendDouble(&out, run.latency_percentiles[i].second);
+    }
+    out.append("}");
+    NextMember(&out, &first, indent);
+    out.append("\"latency_histogram\": [");
+    for (size_t i = 0; i < run.latency_buckets.size(); ++i) {
+      if (i != 0) out.append(", ");
+      out.push_back('[');
+      AppendDouble(&out, run.latency_buckets[i].first);
+      out.append(", ");
+      AppendInt(&out, run.latency_buckets[i].second);
+      out.push_back(']');
+    }
+    out.push_back(']');
+  }
+
+  if (!run.time_series.empty()) {
+    NextMember(&out, &first, indent);
+    out.append("\"time_series\": [");
+    for (size_t i = 0; i < run.time_series.size(); ++i) {
+      const BenchmarkReporter::TimeSeriesSample& sample = run.time_series[i];
+      if (i != 0) out.append(", ");
+      out.append("{\"time\": ");
+      AppendDouble(&out, sample.time);
+      out.append(", \"iterations\": ");
+      AppendInt(&out, sample.iterations);
+      for (const auto& kv : sample.counters) {
+        out.append(", \"");
+        AppendEscaped(&out, kv.first);
+        out.append("\": ");
+        AppendDouble(&out, kv.second);
+      }
+      out.push_back('}');
+    }
+    out.push_back(']');
+  }
+
+  if (!run.roles.empty()) {
+    // In the time unit of the run, like its times.
+    NextMember(&out, &first, indent);
+    out.append("\"roles\": [");
+    for (size_t i = 0; i < run.roles.size(); ++i) {
+      const BenchmarkReporter::RoleRun& role = run.roles[i];
+      if (i != 0) out.append(", ");
+      out.push_back('{');
+      AppendKV(&out, "name", role.name);
+      out.append(", ");
+      AppendKV(&out, "threads", role.threads);
+      out.append(", ");
+      AppendKV(&out, "iterations", role.iterations);
+      out.append(", ");
+      AppendKV(&out, "real_time", role.GetAdjustedRealTime(run.time_unit));
+      out.append(", ");
+      AppendKV(&out, "cpu_time", role.GetAdjustedCPUTime(run.time_unit));
+      for (const auto& c : role.counters) {
+        out.append(", ");
+        AppendKV(&out, c.first, static_cast<double>(c.second));
+      }
+      out.push_back('}');
+    }
+    out.push_back(']');
+  }
+
+  if (!run.matrix_counter.empty()) {
+    // The cells that no run had are null.
+    NextMember(&out, &first, indent);
+    out.append("\"matrix\": {");
+    AppendKV(&out, "counter", run.matrix_counter);
+    auto append_labels = [&out](const char* key,
+                                const std::vector<int64_t>& labels) {
+      out.append(", ");
+      AppendKey(&out, key);
+      out.push_back('[');
+      for (size_t i = 0; i < labels.size(); ++i) {
+        if (i != 0) out.append(", ");
+        AppendInt(&out, labels[i]);
+      }
+      out.push_back(']');
+    };
+    append_labels("rows", run.matrix_rows);
+    append_labels("columns", run.matrix_columns);
+    out.append(", \"values\": [");
+    const size_t num_columns = run.matrix_columns.size();
+    for (size_t r = 0; r < run.matrix_rows.size(); ++r) {
+      out.append(r == 0 ? "[" : ", [");
+      for (size_t c = 0; c < num_columns; ++c) {
+        if (c != 0) out.append(", ");
+        const double value = run.matrix_values[r * num_columns + c];
+        if (std::isnan(value)) {
+          out.append("null");
+        } else {
+          AppendDouble(&out, value);
+        }
+      }
+      out.push_back(']');
+    }
+    out.append("]}");
+  }
+
+  if (run.relative_error > 0) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "relative_error", run.relative_error);
+  }
+
+  if (run.outliers_dropped > 0) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "outliers_dropped", run.outliers_dropped);
+  }
+
+  if (run.cached) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "cached", true);
+  }
+
+  if (run.cold_cache) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "cold_cache", true);
+  }
+
+  if (run.real_time_overhead > 0 || run.cpu_time_overhead > 0) {
+    // Per iteration, like the times.
+    const double multiplier = GetTimeUnitMultiplier(run.time_unit) /
+                              static_cast<double>(run.iterations);
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "real_time_overhead", run.real_time_overhead * multiplier);
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "cpu_time_overhead", run.cpu_time_overhead * multiplier);
+  }
+
+  if (run.cpu_frequency > 0) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "cpu_frequency_mhz", run.cpu_frequency * 1e-6);
+  }
+
+  if (!run.profile_file.empty()) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "profile_file", run.profile_file);
+  }
+
+  if (!run.warnings.empty()) {
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "warnings", run.warnings);
   }
 
   if (!run.report_label.empty()) {
-    out << ",\n" << indent << FormatKV("label", run.report_label);
+    NextMember(&out, &first, indent);
+    AppendKV(&out, "label", run.report_label);
   }
-  out << '\n';
+  out.push_back('\n');
 }
 
 }  // end namespace benchmark
@@ -0,0 +1,101 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "check.h"
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+const uint64_t kHalfSubBuckets =
+    uint64_t(1) << (LatencyHistogram::kSubBucketBits - 1);
+
+// Enough buckets for any 64 bit value.
+const size_t kNumBuckets = (64 - LatencyHistogram::kSubBucketBits + 2) *
+                           kHalfSubBuckets;
+
+int MostSignificantBit(uint64_t value) {
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(value);
+#else
+  int msb = 0;
+  while (value >>= 1) ++msb;
+  return msb;
+#endif
+}
+
+}  // namespace
+
+const int LatencyHistogram::kSubBucketBits;
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < 2 * kHalfSubBuckets) return static_cast<size_t>(value);
+  // Keep the kSubBucketBits most significant bits of the value.
+  const int shift = MostSignificantBit(value) - (kSubBucketBits - 1);
+  return static_cast<size_t>(shift * kHalfSubBuckets + (value >> shift));
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+  if (index < 2 * kHalfSubBuckets) return index;
+  const int shift = static_cast<int>(index / kHalfSubBuckets) - 1;
+  const uint64_t mantissa = index - shift * kHalfSubBuckets;
+  return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t nanoseconds) {
+  if (counts_.empty()) counts_.resize(kNumBuckets);
+  ++counts_[BucketIndex(nanoseconds)];
+  ++total_count_;
+  sum_ += static_cast<double>(nanoseconds);
+  min_ = std::min(min_, nanoseconds);
+  max_ = std::max(max_, nanoseconds);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  if (other.total_count_ == 0) return;
+  if (sample_period_ == 0) sample_period_ = other.sample_period_;
+  if (counts_.empty()) counts_.resize(kNumBuckets);
+  for (size_t i = 0; i < kNumBuckets; ++i) counts_[i] += other.counts_[i];
+  total_count_ += other.total_count_;
+  sum_ += other.sum_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+}
+
+double LatencyHistogram::mean() const {
+  return total_count_ == 0 ? 0.0 : sum_ / static_cast<double>(total_count_);
+}
+
+double LatencyHistogram::Percentile(double percentile) const {
+  BM_CHECK_GT(total_count_, 0u);
+  BM_CHECK(percentile >= 0 && percentile <= 100);
+  const uint64_t rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(
+             percentile / 100.0 * static_cast<double>(total_count_))));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      // The bucket bound may lie beyond what was actually recorded.
+      return static_cast<double>(
+          std::min(std::max(BucketUpperBound(i), min_), max_));
+    }
+  }
+  return static_cast<double>(max_);
+}
+
+std::vector<std::pair<uint64_t, uint64_t> > LatencyHistogram::Buckets() const {
+  std::vector<std::pair<uint64_t, uint64_t> > buckets;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    if (counts_[i] != 0) {
+      buckets.push_back(std::make_pair(BucketUpperBound(i), counts_[i]));
+    }
+  }
+  return buckets;
+}
+
+}  // end namespace internal
+}  // end namespace benchmark
@@ -0,0 +1,60 @@
+#ifndef BENCHMARK_LATENCY_HISTOGRAM_H_
+#define BENCHMARK_LATENCY_HISTOGRAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace benchmark {
+namespace internal {
+
+// A log-linear histogram of latencies in nanoseconds, in the spirit of
+// HdrHistogram: values below 2^kSubBucketBits are counted exactly, larger ones
+// in buckets that are at most 1/2^(kSubBucketBits-1) of their value wide.
+// Recording is a couple of shifts and an increment. The counts are only
+// allocated once something is recorded, so an unused histogram is cheap to
+// copy around.
+class LatencyHistogram {
+ public:
+  static const int kSubBucketBits = 7;
+
+  explicit LatencyHistogram(int64_t sample_period = 0)
+      : sample_period_(sample_period), total_count_(0), sum_(0),
+        min_(UINT64_MAX), max_(0) {}
+
+  // Record one iteration out of every 'sample_period()'.
+  int64_t sample_period() const { return sample_period_; }
+
+  void Record(uint64_t nanoseconds);
+  void Merge(const LatencyHistogram& other);
+
+  uint64_t count() const { return total_count_; }
+  uint64_t min() const { return min_; }
+  uint64_t max() const { return max_; }
+  double mean() const;
+
+  // The smallest recorded value such that 'percentile' percent of the values
+  // are at or below it, to within the precision of the buckets.
+  // REQUIRES: count() > 0, 0 <= percentile <= 100.
+  double Percentile(double percentile) const;
+
+  // The (upper bound, count) of every non-empty bucket, in increasing order.
+  std::vector<std::pair<uint64_t, uint64_t> > Buckets() const;
+
+  static size_t BucketIndex(uint64_t value);
+  static uint64_t BucketUpperBound(size_t index);
+
+ private:
+  int64_t sample_period_;
+  std::vector<uint64_t> counts_;
+  uint64_t total_count_;
+  double sum_;
+  uint64_t min_;
+  uint64_t max_;
+};
+
+}  // end namespace internal
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_LATENCY_HISTOGRAM_H_
@@ -0,0 +1,408 @@
+#include "live_metrics.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "internal_macros.h"
+#include "string_util.h"
+
+#if !defined(BENCHMARK_OS_WINDOWS) && !defined(BENCHMARK_OS_FUCHSIA) && \
+    !defined(BENCHMARK_OS_EMSCRIPTEN) && !defined(BENCHMARK_OS_NACL)
+#define BENCHMARK_HAS_SOCKETS 1
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+std::atomic<LiveMetrics*> live_metrics(nullptr);
+
+// How long Loop() waits for a connection before it checks whether to stop,
+// in milliseconds.
+constexpr int kPollMillis = 200;
+// The most of a request that is read, which is only the start of it.
+constexpr size_t kMaxRequestSize = 8192;
+
+// A label value, with the backslashes, double quotes and line feeds escaped.
+std::string EscapeLabel(const std::string& value) {
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+void AppendFamily(std::string* out, const char* name, const char* type,
+                  const char* help) {
+  *out += StrFormat("# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+}
+
+void AppendSample(std::string* out, const std::string& name,
+                  const std::string& labels, double value) {
+  *out += name;
+  *out += '{';
+  *out += labels;
+  *out += "} ";
+  *out += std::isfinite(value) ? StrFormat("%.17g", value)
+          : std::isnan(value)  ? std::string("NaN")
+          : value > 0          ? std::string("+Inf")
+                               : std::string("-Inf");
+  *out += '\n';
+}
+
+}  // namespace
+
+bool LiveMetrics::ReportContext(const Context&) { return true; }
+
+LiveMetrics::Instance* LiveMetrics::GetInstance(const std::string& name) {
+  auto it = instances_.find(name);
+  if (it == instances_.end()) {
+    it = instances_.insert(std::make_pair(name, Instance())).first;
+    names_.push_back(name);
+  }
+  return &it->second;
+}
+
+void LiveMetrics::AddSample(const std::string& name,
+                            const TimeSeriesSample& sample) {
+  MutexLock l(mutex_);
+  Instance* instance = GetInstance(name);
+  // Each batch of iterations is sampled from its start, so the rates are over
+  // the whole batch so far when it has just started again.
+  const bool restarted = sample.time <= instance->last_sample_time ||
+                         sample.iterations < instance->last_sample_iterations;
+  const double since = restarted ? sample.time
+                                 : sample.time - instance->last_sample_time;
+  if (since > 0) {
+    const double iterations = static_cast<double>(
+        restarted ? sample.iterations
+                  : sample.iterations - instance->last_sample_iterations);
+    instance->live_iterations_per_second = iterations / since;
+    for (const auto& kv : sample.counters) {
+      double total = kv.second;
+      if (!restarted) {
+        auto last = instance->last_sample_counters.find(kv.first);
+        if (last != instance->last_sample_counters.end()) total -= last->second;
+      }
+      instance->live_counter_rates[kv.first] = total / since;
+    }
+  }
+  instance->last_sample_time = sample.time;
+  instance->last_sample_iterations = sample.iterations;
+  instance->last_sample_counters = sample.counters;
+}
+
+void LiveMetrics::ReportRuns(const std::vector<Run>& reports) {
+  MutexLock l(mutex_);
+  for (const Run& run : reports) {
+    Instance* instance = GetInstance(run.run_name.str());
+    const double seconds_per_unit = 1 / GetTimeUnitMultiplier(run.time_unit);
+    if (run.run_type == Run::RT_Aggregate) {
+      // Only those in time, not the big O, the rms or the percentages.
+      if (run.report_big_o || run.report_rms ||
+          run.aggregate_unit != StatisticUnit::kTime ||
+          !run.matrix_counter.empty()) {
+        continue;
+      }
+      instance->aggregates[run.aggregate_name] =
+          std::make_pair(run.GetAdjustedRealTime() * seconds_per_unit,
+                         run.GetAdjustedCPUTime() * seconds_per_unit);
+      continue;
+    }
+    ++instance->repetitions;
+    if (run.error_occurred) {
+      ++instance->errors;
+      continue;
+    }
+    instance->iterations = run.iterations;
+    instance->iterations_per_second =
+        run.real_accumulated_time > 0
+            ? static_cast<double>(run.iterations) / run.real_accumulated_time
+            : 0;
+    instance->real_time = run.GetAdjustedRealTime() * seconds_per_unit;
+    instance->cpu_time = run.GetAdjustedCPUTime() * seconds_per_unit;
+    instance->counters.clear();
+    for (const auto& kv : run.counters) {
+      instance->counters[kv.first] = kv.second.value;
+    }
+  }
+}
+
+std::string LiveMetrics::Render() {
+  MutexLock l(mutex_);
+  std::vector<std::pair<std::string, const Instance*> > instances;
+  for (const std::string& name : names_) {
+    instances.push_back(std::make_pair(
+        "benchmark=\"" + EscapeLabel(name) + "\"", &instances_[name]));
+  }
+
+  std::string out;
+  AppendFamily(&out, "benchmark_live_iterations_per_second", "gauge",
+               "Iterations per second of the run in progress, over the last "
+               "sampling interval.");
+  for (const auto& kv : instances) {
+    if (kv.second->last_sample_time <= 0) continue;
+    AppendSample(&out, "benchmark_live_iterations_per_second", kv.first,
+                 kv.second->live_iterations_per_second);
+  }
+  AppendFamily(&out, "benchmark_live_counter_rate", "gauge",
+               "Increase per second of each shared counter of the run in "
+               "progress, over the last sampling interval.");
+  for (const auto& kv : instances) {
+    for (const auto& rate : kv.second->live_counter_rates) {
+      AppendSample(&out, "benchmark_live_counter_rate",
+                   kv.first + ",counter=\"" + EscapeLabel(rate.first) + "\"",
+                   rate.second);
+    }
+  }
+
+  AppendFamily(&out, "benchmark_repetitions", "counter",
+               "Repetitions reported so far.");
+  for (const auto& kv : instances) {
+    AppendSample(&out, "benchmark_repetitions_total", kv.first,
+                 static_cast<double>(kv.second->repetitions));
+  }
+  AppendFamily(&out, "benchmark_errors", "counter",
+               "Repetitions reported so far that failed.");
+  for (const auto& kv : instances) {
+    AppendSample(&out, "benchmark_errors_total", kv.first,
+                 static_cast<double>(kv.second->errors));
+  }
+
+  // Of the last repetition that didn't fail.
+  struct {
+    const char* name;
+    const char* help;
+    double Instance::*value;
+  } const last_repetition[] = {
+      {"benchmark_iterations_per_second",
+       "Iterations per second of the last repetition.",
+       &Instance::iterations_per_second},
+      {"benchmark_real_time_seconds",
+       "Real time per iteration of the last repetition.", &Instance::real_time},
+      {"benchmark_cpu_time_seconds",
+       "CPU time per iteration of the last repetition.", &Instance::cpu_time},
+  };
+  AppendFamily(&out, "benchmark_iterations", "gauge",
+               "Iterations of the last repetition.");
+  for (const auto& kv : instances) {
+    if (kv.second->repetitions == kv.second->errors) continue;
+    AppendSample(&out, "benchmark_iterations", kv.first,
+                 static_cast<double>(kv.second->iterations));
+  }
+  for (const auto& metric : last_repetition) {
+    AppendFamily(&out, metric.name, "gauge", metric.help);
+    for (const auto& kv : instances) {
+      if (kv.second->repetitions == kv.second->errors) continue;
+      AppendSample(&out, metric.name, kv.first, kv.second->*metric.value);
+    }
+  }
+  AppendFamily(&out, "benchmark_counter", "gauge",
+               "Each counter of the last repetition.");
+  for (const auto& kv : instances) {
+    for (const auto& counter : kv.second->counters) {
+      AppendSample(&out, "benchmark_counter",
+                   kv.first + ",counter=\"" + EscapeLabel(counter.first) + "\"",
+                   counter.second);
+    }
+  }
+
+  AppendFamily(&out, "benchmark_aggregate_real_time_seconds", "gauge",
+               "Real time per iteration of each aggregate of the repetitions.");
+  for (const auto& kv : instances) {
+    for (const auto& aggregate : kv.second->aggregates) {
+      AppendSample(&out, "benchmark_aggregate_real_time_seconds",
+                   kv.first + ",aggregate=\"" + EscapeLabel(aggregate.first) +
+                       "\"",
+                   aggregate.second.first);
+    }
+  }
+  AppendFamily(&out, "benchmark_aggregate_cpu_time_seconds", "gauge",
+               "CPU time per iteration of each aggregate of the repetitions.");
+  for (const auto& kv : instances) {
+    for (const auto& aggregate : kv.second->aggregates) {
+      AppendSample(&out, "benchmark_aggregate_cpu_time_seconds",
+                   kv.first + ",aggregate=\"" + EscapeLabel(aggregate.first) +
+                       "\"",
+                   aggregate.second.second);
+    }
+  }
+  out += "# EOF\n";
+  return out;
+}
+
+LiveMetrics* GetLiveMetrics() { return live_metrics.load(); }
+
+void SetLiveMetrics(LiveMetrics* metrics) { live_metrics.store(metrics); }
+
+MetricsServer::MetricsServer(LiveMetrics* metrics)
+    : metrics_(metrics), listen_fd_(-1), port_(0), stop_(false) {}
+
+MetricsServer::~MetricsServer() { Stop(); }
+
+bool MetricsServer::Start(const std::string& address, std::string* error) {
+#ifdef BENCHMARK_HAS_SOCKETS
+  const size_t colon = address.rfind(':');
+  if (colon == std::string::npos || colon + 1 == address.size()) {
+    *error = "expected [<host>]:<port>, got '" + address + "'";
+    return false;
+  }
+  std::string host = address.substr(0, colon);
+  if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+    host = host.substr(1, host.size() - 2);
+  }
+  const std::string service = address.substr(colon + 1);
+  struct addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  struct addrinfo* addresses = nullptr;
+  const int status = getaddrinfo(host.empty() ? nullptr : host.c_str(),
+                                 service.c_str(), &hints, &addresses);
+  if (status != 0) {
+    *error = StrFormat("could not resolve '%s': %s", address.c_str(),
+                       gai_strerror(status));
+    return false;
+  }
+  *error = "no address to listen on";
+  for (struct addrinfo* a = addresses; a != nullptr; a = a->ai_next) {
+    const int fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) continue;
+    const int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(fd, a->ai_addr, a->ai_addrlen) == 0 && listen(fd, 16) == 0) {
+      listen_fd_ = fd;
+      break;
+    }
+    *error = StrFormat("could not listen on '%s': %s", address.c_str(),
+                       strerror(errno));
+    close(fd);
+  }
+  freeaddrinfo(addresses);
+  if (listen_fd_ < 0) return false;
+
+  struct sockaddr_storage bound;
+  socklen_t bound_size = sizeof(bound);
+  if (getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&bound),
+                  &bound_size) == 0) {
+    char port[16];
+    if (getnameinfo(reinterpret_cast<struct sockaddr*>(&bound), bound_size,
+                    nullptr, 0, port, sizeof(port), NI_NUMERICSERV) == 0) {
+      port_ = std::atoi(port);
+    }
+  }
+  stop_ = false;
+  thread_ = std::thread([this]() { Loop(); });
+  return true;
+#else
+  (void)address;
+  *error = "not supported on this platform";
+  return false;
+#endif
+}
+
+void MetricsServer::Stop() {
+  stop_ = true;
+  if (thread_.joinable()) thread_.join();
+#ifdef BENCHMARK_HAS_SOCKETS
+  if (listen_fd_ >= 0) close(listen_fd_);
+#endif
+  listen_fd_ = -1;
+}
+
+void MetricsServer::Loop() {
+#ifdef BENCHMARK_HAS_SOCKETS
+  while (!stop_) {
+    struct pollfd poll_fd;
+    poll_fd.fd = listen_fd_;
+    poll_fd.events = POLLIN;
+    poll_fd.revents = 0;
+    if (poll(&poll_fd, 1, kPollMillis) <= 0) continue;
+    const int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) continue;
+    Serve(fd);
+    close(fd);
+  }
+#endif
+}
+
+void MetricsServer::Serve(int fd) {
+#ifdef BENCHMARK_HAS_SOCKETS
+  // A client that sends nothing doesn't hold up the others for long.
+  struct timeval timeout;
+  timeout.tv_sec = 1;
+  timeout.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  // A client that hangs up early doesn't kill the process with SIGPIPE.
+#ifdef SO_NOSIGPIPE
+  const int no_sigpipe = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+#ifdef MSG_NOSIGNAL
+  const int send_flags = MSG_NOSIGNAL;
+#else
+  const int send_flags = 0;
+#endif
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos &&
+         request.size() < kMaxRequestSize) {
+    const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    request.append(buffer, static_cast<size_t>(n));
+  }
+
+  std::string response;
+  const bool metrics = request.compare(0, 13, "GET /metrics ") == 0 ||
+                       request.compare(0, 13, "GET /metrics?") == 0;
+  if (metrics) {
+    const std::string body = metrics_->Render();
+    response = StrFormat(
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/openmetrics-text; version=1.0.0; "
+        "charset=utf-8\r\n"
+        "Content-Length: %zu\r\n"
+        "Connection: close\r\n\r\n",
+        body.size());
+    response += body;
+  } else {
+    response =
+        "HTTP/1.1 404 Not Found\r\n"
+        "Content-Length: 0\r\n"
+        "Connection: close\r\n\r\n";
+  }
+  size_t sent = 0;
+  while (sent < response.size()) {
+    const ssize_t n =
+        send(fd, response.data() + sent, response.size() - sent,
+                           send_flags);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    sent += static_cast<size_t>(n);
+  }
+#else
+  (void)fd;
+#endif
+}
+
+}  // namespace internal
+}  // namespace benchmark
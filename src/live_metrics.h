@@ -0,0 +1,105 @@
+#ifndef BENCHMARK_LIVE_METRICS_H_
+#define BENCHMARK_LIVE_METRICS_H_
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "mutex.h"
+
+namespace benchmark {
+namespace internal {
+
+// The metrics of --benchmark_metrics_address, as they are while the
+// benchmarks run: what the samplers of the runs read of their progress every
+// --benchmark_metrics_interval seconds, and the repetitions and aggregates as
+// they are reported, which it is fed like the reporters that stream them.
+class LiveMetrics : public BenchmarkReporter {
+ public:
+  virtual bool ReportContext(const Context& context) BENCHMARK_OVERRIDE;
+  virtual void ReportRuns(const std::vector<Run>& reports) BENCHMARK_OVERRIDE;
+  virtual bool StreamsRepetitions() const BENCHMARK_OVERRIDE { return true; }
+
+  // A sample of the progress of a run of the benchmark named 'name'.
+  void AddSample(const std::string& name, const TimeSeriesSample& sample);
+
+  // The metrics in the text format of OpenMetrics, which Prometheus scrapes.
+  std::string Render();
+
+ private:
+  struct Instance {
+    Instance()
+        : last_sample_time(0),
+          last_sample_iterations(0),
+          live_iterations_per_second(0),
+          repetitions(0),
+          errors(0),
+          iterations(0),
+          iterations_per_second(0),
+          real_time(0),
+          cpu_time(0) {}
+
+    double last_sample_time;
+    IterationCount last_sample_iterations;
+    std::map<std::string, double> last_sample_counters;
+    double live_iterations_per_second;
+    std::map<std::string, double> live_counter_rates;
+
+    int64_t repetitions;
+    int64_t errors;
+    // Of the last repetition, with the times per iteration in seconds.
+    IterationCount iterations;
+    double iterations_per_second;
+    double real_time;
+    double cpu_time;
+    std::map<std::string, double> counters;
+    // The real and cpu times of each aggregate, in seconds.
+    std::map<std::string, std::pair<double, double> > aggregates;
+  };
+
+  Instance* GetInstance(const std::string& name) REQUIRES(mutex_);
+
+  Mutex mutex_;
+  // In the order they were first seen in.
+  std::vector<std::string> names_ GUARDED_BY(mutex_);
+  std::map<std::string, Instance> instances_ GUARDED_BY(mutex_);
+};
+
+// The live metrics that the runs feed, or null.
+LiveMetrics* GetLiveMetrics();
+void SetLiveMetrics(LiveMetrics* metrics);
+
+// Serves the live metrics over HTTP, at /metrics, from a thread of its own.
+// Only on the platforms with POSIX sockets.
+class MetricsServer {
+ public:
+  explicit MetricsServer(LiveMetrics* metrics);
+  ~MetricsServer();
+
+  // Listen on 'address', "[<host>]:<port>", with any host if it is empty.
+  // Returns false, with why in 'error', if it can't.
+  bool Start(const std::string& address, std::string* error);
+  // The port listened on, which the OS picks for port 0.
+  int port() const { return port_; }
+  void Stop();
+
+ private:
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(MetricsServer);
+
+  void Loop();
+  void Serve(int fd);
+
+  LiveMetrics* const metrics_;
+  int listen_fd_;
+  int port_;
+  std::atomic<bool> stop_;
+  std::thread thread_;
+};
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_LIVE_METRICS_H_
@@ -0,0 +1,99 @@
+#include "measurement_checks.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "benchmark/benchmark.h"
+#include "string_util.h"
+#include "timers.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+// An iteration that takes at most this many times an empty one does nothing
+// that can be told apart from the loop itself.
+constexpr double kEmptyLoopFactor = 2;
+// A slice that lasts fewer steps of its clock than this is off by up to a
+// tenth of it.
+constexpr double kResolutionFactor = 10;
+
+constexpr int kTrials = 5;
+constexpr IterationCount kEmptyLoopIterations = 1 << 20;
+// How long to wait for a clock to step, at most, in seconds.
+constexpr double kMaxResolutionWait = 0.1;
+
+// As the loop of a benchmark that the compiler left nothing of: a decrement
+// and a branch per iteration.
+double MeasureEmptyIteration() {
+  double best = std::numeric_limits<double>::max();
+  for (int trial = 0; trial < kTrials; ++trial) {
+    const double start = ChronoClockNow();
+    for (IterationCount i = kEmptyLoopIterations; i != 0; --i)
+      DoNotOptimize(i);
+    best = std::min(best, ChronoClockNow() - start);
+  }
+  return best / static_cast<double>(kEmptyLoopIterations);
+}
+
+// The smallest step between two readings of 'now', or 0 if it didn't step.
+double MeasureResolution(double (*now)()) {
+  double best = std::numeric_limits<double>::max();
+  for (int trial = 0; trial < kTrials; ++trial) {
+    const double deadline = ChronoClockNow() + kMaxResolutionWait;
+    const double start = now();
+    double end = start;
+    while (end == start && ChronoClockNow() < deadline) end = now();
+    if (end > start) best = std::min(best, end - start);
+  }
+  return best == std::numeric_limits<double>::max() ? 0 : best;
+}
+
+double ChronoClock() { return ChronoClockNow(); }
+
+void CheckSlice(const char* clock, double slice_seconds, double resolution,
+                std::vector<std::string>* warnings) {
+  if (slice_seconds <= 0 || resolution <= 0 ||
+      slice_seconds >= kResolutionFactor * resolution) {
+    return;
+  }
+  warnings->push_back(
+      StrFormat("timer_resolution: the timer ran for %.0f ns at a time, "
+                "within %.0f steps of the %.0f ns of the %s clock",
+                slice_seconds * 1e9, kResolutionFactor, resolution * 1e9,
+                clock));
+}
+
+}  // end namespace
+
+const MeasurementFloor& GetMeasurementFloor() {
+  static const MeasurementFloor floor = [] {
+    MeasurementFloor f;
+    f.empty_iteration = MeasureEmptyIteration();
+    f.real_resolution = MeasureResolution(ChronoClock);
+    f.cpu_resolution = MeasureResolution(ThreadCPUUsage);
+    return f;
+  }();
+  return floor;
+}
+
+std::vector<std::string> CheckMeasurements(double iteration_seconds,
+                                           double real_slice_seconds,
+                                           double cpu_slice_seconds,
+                                           const MeasurementFloor& floor) {
+  std::vector<std::string> warnings;
+  if (iteration_seconds > 0 &&
+      iteration_seconds <= kEmptyLoopFactor * floor.empty_iteration) {
+    warnings.push_back(
+        StrFormat("empty_loop: an iteration took %.2f ns, about what one of "
+                  "an empty loop takes (%.2f ns); was the body optimized "
+                  "away?",
+                  iteration_seconds * 1e9, floor.empty_iteration * 1e9));
+  }
+  CheckSlice("real", real_slice_seconds, floor.real_resolution, &warnings);
+  CheckSlice("cpu", cpu_slice_seconds, floor.cpu_resolution, &warnings);
+  return warnings;
+}
+
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,38 @@
+#ifndef BENCHMARK_MEASUREMENT_CHECKS_H_
+#define BENCHMARK_MEASUREMENT_CHECKS_H_
+
+#include <string>
+#include <vector>
+
+namespace benchmark {
+namespace internal {
+
+// What a run can't measure below: the time an iteration of an empty
+// benchmark loop takes, and the smallest step of the clocks, in seconds.
+struct MeasurementFloor {
+  MeasurementFloor()
+      : empty_iteration(0), real_resolution(0), cpu_resolution(0) {}
+  double empty_iteration;
+  // Of ChronoClockNow() and of ThreadCPUUsage().
+  double real_resolution;
+  double cpu_resolution;
+};
+
+// Measured the first time it is called.
+const MeasurementFloor& GetMeasurementFloor();
+
+// What looks wrong with the measurements of a run, each as "<check>: <why>":
+// "empty_loop", if 'iteration_seconds', the real time an iteration took on a
+// thread, is barely more than the empty loop's, as if the compiler had
+// removed the body; "timer_resolution", if the mean 'real_slice_seconds' or
+// 'cpu_slice_seconds' the timer ran for between pauses is within a few steps
+// of its clock. A time of 0 is not checked.
+std::vector<std::string> CheckMeasurements(double iteration_seconds,
+                                           double real_slice_seconds,
+                                           double cpu_slice_seconds,
+                                           const MeasurementFloor& floor);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_MEASUREMENT_CHECKS_H_
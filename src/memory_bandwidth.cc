@@ -0,0 +1,147 @@
+#include "memory_bandwidth.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <string>
+
+#include "sysinfo.h"
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+constexpr size_t kWordsPerLine = 64 / sizeof(uint64_t);
+
+// Used when the cache hierarchy could not be read.
+const int64_t kDefaultWorkingSets[] = {16 << 10, 256 << 10, 4 << 20, 64 << 20};
+
+enum Access { kSequential, kRandom };
+
+// The bytes of the working set that fall to each thread. The working set is
+// split between the threads, rather than each of them having one of its own,
+// so that the memory the suite needs doesn't grow with the number of cpus.
+size_t BytesPerThread(const State& state) {
+  return static_cast<size_t>(state.range(0)) /
+         static_cast<size_t>(state.threads());
+}
+
+// The order in which the 'num_lines' lines of a working set are visited.
+std::vector<size_t> LineOrder(Access access, size_t num_lines) {
+  std::vector<size_t> order(num_lines);
+  for (size_t i = 0; i < num_lines; ++i) order[i] = i;
+  if (access == kRandom) {
+    // Fixed seed, so that every thread and every run sees the same order.
+    std::mt19937 gen(42);
+    std::shuffle(order.begin(), order.end(), gen);
+  }
+  return order;
+}
+
+// Each iteration reads every line of the working set once. The whole line is
+// read even in random order, so that the bytes counted are the bytes moved.
+void BM_Read(State& state, Access access) {
+  const size_t num_lines =
+      BytesPerThread(state) / (kWordsPerLine * sizeof(uint64_t));
+  std::vector<uint64_t> data(num_lines * kWordsPerLine, 1);
+  const std::vector<size_t> order = LineOrder(access, num_lines);
+  for (auto _ : state) {
+    uint64_t sum = 0;
+    for (size_t line : order) {
+      const uint64_t* words = &data[line * kWordsPerLine];
+      for (size_t w = 0; w < kWordsPerLine; ++w) sum += words[w];
+    }
+    DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(BytesPerThread(state)));
+}
+
+void BM_Write(State& state, Access access) {
+  const size_t num_lines =
+      BytesPerThread(state) / (kWordsPerLine * sizeof(uint64_t));
+  std::vector<uint64_t> data(num_lines * kWordsPerLine);
+  const std::vector<size_t> order = LineOrder(access, num_lines);
+  uint64_t value = 0;
+  for (auto _ : state) {
+    for (size_t line : order) {
+      uint64_t* words = &data[line * kWordsPerLine];
+      for (size_t w = 0; w < kWordsPerLine; ++w) words[w] = value;
+    }
+    ClobberMemory();
+    ++value;
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(BytesPerThread(state)));
+}
+
+// The working set is split into a source and a destination half, and the
+// bytes counted are those read plus those written.
+void BM_Copy(State& state, Access access) {
+  const size_t num_lines =
+      BytesPerThread(state) / (2 * kWordsPerLine * sizeof(uint64_t));
+  std::vector<uint64_t> src(num_lines * kWordsPerLine, 1);
+  std::vector<uint64_t> dst(num_lines * kWordsPerLine);
+  const std::vector<size_t> order = LineOrder(access, num_lines);
+  for (auto _ : state) {
+    for (size_t line : order) {
+      std::copy_n(&src[line * kWordsPerLine], kWordsPerLine,
+                  &dst[line * kWordsPerLine]);
+    }
+    ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(BytesPerThread(state)));
+}
+
+}  // end namespace
+
+std::vector<int64_t> MemoryBandwidthWorkingSets(
+    const std::vector<CPUInfo::CacheInfo>& caches) {
+  std::vector<int64_t> sizes;
+  int64_t largest = 0;
+  for (const CPUInfo::CacheInfo& cache : caches) {
+    if (cache.type == "Instruction" || cache.size <= 0) continue;
+    sizes.push_back(cache.size / 2);
+    largest = std::max<int64_t>(largest, cache.size);
+  }
+  if (sizes.empty()) {
+    return std::vector<int64_t>(std::begin(kDefaultWorkingSets),
+                                std::end(kDefaultWorkingSets));
+  }
+  sizes.push_back(4 * largest);
+  std::sort(sizes.begin(), sizes.end());
+  sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+  return sizes;
+}
+
+}  // namespace internal
+
+void RegisterMemoryBandwidthBenchmarks() {
+  using internal::kRandom;
+  using internal::kSequential;
+  struct Kernel {
+    const char* name;
+    void (*fn)(State&, internal::Access);
+    internal::Access access;
+  };
+  static const Kernel kKernels[] = {
+      {"MemoryBandwidth/SequentialRead", internal::BM_Read, kSequential},
+      {"MemoryBandwidth/SequentialWrite", internal::BM_Write, kSequential},
+      {"MemoryBandwidth/SequentialCopy", internal::BM_Copy, kSequential},
+      {"MemoryBandwidth/RandomRead", internal::BM_Read, kRandom},
+      {"MemoryBandwidth/RandomWrite", internal::BM_Write, kRandom},
+      {"MemoryBandwidth/RandomCopy", internal::BM_Copy, kRandom},
+  };
+  const std::vector<int64_t> sizes =
+      internal::MemoryBandwidthWorkingSets(internal::CPUCaches());
+  for (const Kernel& kernel : kKernels) {
+    internal::Benchmark* b =
+        RegisterBenchmark(kernel.name, kernel.fn, kernel.access);
+    for (int64_t size : sizes) b->Arg(size);
+    b->ThreadRange(1, internal::NumCPUs())->UseRealTime();
+  }
+}
+
+}  // namespace benchmark
@@ -0,0 +1,22 @@
+#ifndef BENCHMARK_MEMORY_BANDWIDTH_H_
+#define BENCHMARK_MEMORY_BANDWIDTH_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+namespace internal {
+
+// The working-set sizes, in bytes and in increasing order, that the memory
+// bandwidth suite sweeps over: half of each data cache, so that it fits in
+// that level, and four times the largest one, so that it is served from
+// memory.
+std::vector<int64_t> MemoryBandwidthWorkingSets(
+    const std::vector<CPUInfo::CacheInfo>& caches);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_MEMORY_BANDWIDTH_H_
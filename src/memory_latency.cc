@@ -0,0 +1,126 @@
+#include "memory_latency.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "memory_bandwidth.h"
+#include "string_util.h"
+#include "sysinfo.h"
+#include "timers.h"
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+constexpr size_t kLineSize = 64;
+
+struct Chase {
+  // Whether the chain stays in a page until it has visited all its lines.
+  bool page_local;
+  BufferOptions buffer;
+};
+
+// Each iteration follows the chain once around, one dependent load per line,
+// and the run reports how long each load took.
+void BM_Chase(State& state, Chase chase) {
+  Buffer buffer(static_cast<size_t>(state.range(0)), chase.buffer);
+  const size_t num_lines = buffer.size() / kLineSize;
+  // Fixed seed, so that every run chases the same chain.
+  const std::vector<size_t> order = ChaseOrder(
+      num_lines, chase.page_local ? buffer.page_size() / kLineSize : 0, 42);
+  char* const base = static_cast<char*>(buffer.data());
+  for (size_t i = 0; i < num_lines; ++i) {
+    *reinterpret_cast<void**>(base + order[i] * kLineSize) =
+        base + order[(i + 1) % num_lines] * kLineSize;
+  }
+  void* next = base + order[0] * kLineSize;
+  const double start = ChronoClockNow();
+  for (auto _ : state) {
+    for (size_t i = 0; i < num_lines; ++i) next = *static_cast<void**>(next);
+    DoNotOptimize(next);
+  }
+  const double loads =
+      static_cast<double>(state.iterations()) * static_cast<double>(num_lines);
+  state.counters["ns_per_load"] =
+      Counter(loads > 0 ? (ChronoClockNow() - start) * 1e9 / loads : 0,
+              Counter::kAvgThreads);
+  state.counters["page_size"] =
+      Counter(static_cast<double>(buffer.page_size()), Counter::kAvgThreads);
+}
+
+}  // end namespace
+
+std::vector<size_t> ChaseOrder(size_t num_lines, size_t lines_per_page,
+                               uint64_t seed) {
+  std::mt19937_64 gen(seed);
+  std::vector<size_t> order(num_lines);
+  for (size_t i = 0; i < num_lines; ++i) order[i] = i;
+  if (lines_per_page == 0 || lines_per_page >= num_lines) {
+    std::shuffle(order.begin(), order.end(), gen);
+    return order;
+  }
+  const size_t num_pages = (num_lines + lines_per_page - 1) / lines_per_page;
+  std::vector<size_t> pages(num_pages);
+  for (size_t p = 0; p < num_pages; ++p) pages[p] = p;
+  std::shuffle(pages.begin(), pages.end(), gen);
+  size_t next = 0;
+  for (size_t page : pages) {
+    const size_t first = page * lines_per_page;
+    const size_t last = std::min(num_lines, first + lines_per_page);
+    const auto begin = order.begin() + static_cast<std::ptrdiff_t>(next);
+    for (size_t line = first; line < last; ++line) order[next++] = line;
+    std::shuffle(begin, order.begin() + static_cast<std::ptrdiff_t>(next), gen);
+  }
+  return order;
+}
+
+}  // namespace internal
+
+void RegisterMemoryLatencyBenchmarks() {
+  using internal::Chase;
+  const std::vector<int64_t> sizes =
+      internal::MemoryBandwidthWorkingSets(internal::CPUCaches());
+  BufferOptions huge_pages;
+  huge_pages.huge_pages = true;
+  struct Variant {
+    const char* name;
+    Chase chase;
+  };
+  const Variant kVariants[] = {
+      {"MemoryLatency/RandomChase", {false, BufferOptions()}},
+      {"MemoryLatency/PageLocalChase", {true, BufferOptions()}},
+      {"MemoryLatency/HugePageChase", {false, huge_pages}},
+  };
+  for (const Variant& variant : kVariants) {
+    internal::Benchmark* b =
+        RegisterBenchmark(variant.name, internal::BM_Chase, variant.chase);
+    for (int64_t size : sizes) b->Arg(size);
+  }
+
+  // From the cpus of each NUMA node to the memory of each, over the working
+  // set that is served from memory.
+  const std::vector<CPUInfo::LogicalCpu>& topology = internal::CPUTopology();
+  std::map<int, std::vector<int> > node_cpus;
+  for (const CPUInfo::LogicalCpu& cpu : topology) {
+    if (cpu.numa_node >= 0) node_cpus[cpu.numa_node].push_back(cpu.cpu);
+  }
+  if (node_cpus.size() < 2) return;
+  for (const auto& cpus : node_cpus) {
+    for (const auto& memory : node_cpus) {
+      Chase chase = {false, BufferOptions()};
+      chase.buffer.numa_node = memory.first;
+      const std::string name =
+          StrFormat("MemoryLatency/CrossNodeChase/cpu_node:%d/memory_node:%d",
+                    cpus.first, memory.first);
+      RegisterBenchmark(name.c_str(), internal::BM_Chase, chase)
+          ->Arg(sizes.back())
+          ->PinThreads(cpus.second);
+    }
+  }
+}
+
+}  // namespace benchmark
@@ -0,0 +1,23 @@
+#ifndef BENCHMARK_MEMORY_LATENCY_H_
+#define BENCHMARK_MEMORY_LATENCY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace benchmark {
+namespace internal {
+
+// The order in which a chain of pointers visits 'num_lines' cache lines, a
+// random cycle. With 'lines_per_page' of 0, any line may follow any other, so
+// that nearly every load misses the TLB as well as the caches. Otherwise all
+// the lines of a page are visited, in a random order, before the chain moves
+// on to the next page, in a random order too, so that only the first load of
+// each page misses the TLB.
+std::vector<size_t> ChaseOrder(size_t num_lines, size_t lines_per_page,
+                               uint64_t seed);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_MEMORY_LATENCY_H_
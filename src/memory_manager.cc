@@ -0,0 +1,121 @@
+// Copyright 2015 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal_macros.h"
+
+#ifndef BENCHMARK_OS_WINDOWS
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+
+const int64_t MemoryManager::Result::TombstoneValue =
+    std::numeric_limits<int64_t>::max();
+
+namespace {
+
+#ifdef BENCHMARK_OS_LINUX
+// Resets the peak resident set size of the process to its current one, which
+// needs Linux 4.0.
+bool ResetPeakRss() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  clear_refs.close();
+  return !clear_refs.fail();
+}
+
+// The peak resident set size of the process since it started or was reset,
+// or 0 if unknown.
+int64_t ReadPeakRss() {
+  std::ifstream status("/proc/self/status");
+  std::string key;
+  while (status >> key) {
+    if (key == "VmHWM:") {
+      int64_t kilobytes = 0;
+      status >> kilobytes;
+      return kilobytes * 1024;
+    }
+    status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  }
+  return 0;
+}
+
+// The current resident set size of the process, or 0 if unknown.
+int64_t ReadCurrentRss() {
+  std::ifstream statm("/proc/self/statm");
+  int64_t size = 0;
+  int64_t resident = 0;
+  if (!(statm >> size >> resident)) return 0;
+  return resident * static_cast<int64_t>(sysconf(_SC_PAGESIZE));
+}
+#endif
+
+}  // end namespace
+
+ProcessMemoryManager::ProcessMemoryManager()
+    : peak_rss_reset_(false),
+      start_minor_page_faults_(0),
+      start_major_page_faults_(0) {}
+
+void ProcessMemoryManager::Start() {
+#ifdef BENCHMARK_OS_LINUX
+  peak_rss_reset_ = ResetPeakRss();
+#endif
+#ifndef BENCHMARK_OS_WINDOWS
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    start_minor_page_faults_ = usage.ru_minflt;
+    start_major_page_faults_ = usage.ru_majflt;
+  }
+#endif
+}
+
+void ProcessMemoryManager::Stop(Result* result) {
+  result->num_allocs = Result::TombstoneValue;
+  result->max_bytes_used = Result::TombstoneValue;
+#ifndef BENCHMARK_OS_WINDOWS
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return;
+  result->minor_page_faults = usage.ru_minflt - start_minor_page_faults_;
+  result->major_page_faults = usage.ru_majflt - start_major_page_faults_;
+#ifdef BENCHMARK_OS_MACOSX
+  // In bytes, unlike everywhere else.
+  result->peak_rss_bytes = usage.ru_maxrss;
+#else
+  result->peak_rss_bytes = static_cast<int64_t>(usage.ru_maxrss) * 1024;
+#endif
+#ifdef BENCHMARK_OS_LINUX
+  if (peak_rss_reset_) {
+    const int64_t peak_rss = ReadPeakRss();
+    if (peak_rss > 0) result->peak_rss_bytes = peak_rss;
+  }
+  // The peak is never below where the run ended.
+  if (result->peak_rss_bytes < ReadCurrentRss()) {
+    result->peak_rss_bytes = ReadCurrentRss();
+  }
+#endif
+#else
+  (void)result;
+#endif
+}
+
+}  // end namespace benchmark
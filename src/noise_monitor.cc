@@ -0,0 +1,148 @@
+#include "noise_monitor.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "internal_macros.h"
+#include "string_util.h"
+
+#ifndef BENCHMARK_OS_WINDOWS
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+#if defined(BENCHMARK_OS_LINUX)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+const char* const kNoiseCounters[] = {"voluntary_switches",
+                                      "involuntary_switches", "minor_faults",
+                                      "major_faults", "cpu_migrations"};
+
+// A counter of the migrations of the calling thread, enabled, or -1.
+int OpenMigrationsEvent() {
+#if defined(BENCHMARK_OS_LINUX)
+  struct perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_SOFTWARE;
+  attr.config = PERF_COUNT_SW_CPU_MIGRATIONS;
+  // As a perf_event_paranoid of 2 only lets us count the user space.
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+  return -1;
+#endif
+}
+
+double ReadMigrations(int fd) {
+#if defined(BENCHMARK_OS_LINUX)
+  uint64_t count = 0;
+  if (fd >= 0 && read(fd, &count, sizeof(count)) == sizeof(count)) {
+    return static_cast<double>(count);
+  }
+#else
+  (void)fd;
+#endif
+  return 0;
+}
+
+// The switches and faults so far, in the order of kNoiseCounters.
+void ReadUsage(double* usage) {
+#ifndef BENCHMARK_OS_WINDOWS
+  struct rusage ru;
+#ifdef RUSAGE_THREAD
+  const int who = RUSAGE_THREAD;
+#else
+  const int who = RUSAGE_SELF;
+#endif
+  if (getrusage(who, &ru) == 0) {
+    usage[0] = static_cast<double>(ru.ru_nvcsw);
+    usage[1] = static_cast<double>(ru.ru_nivcsw);
+    usage[2] = static_cast<double>(ru.ru_minflt);
+    usage[3] = static_cast<double>(ru.ru_majflt);
+    return;
+  }
+#endif
+  std::memset(usage, 0, 4 * sizeof(double));
+}
+
+}  // namespace
+
+NoiseMonitor::NoiseMonitor() : migrations_fd_(OpenMigrationsEvent()) {
+  std::memset(start_, 0, sizeof(start_));
+}
+
+NoiseMonitor::~NoiseMonitor() {
+#if defined(BENCHMARK_OS_LINUX)
+  if (migrations_fd_ >= 0) close(migrations_fd_);
+#endif
+}
+
+bool NoiseMonitor::per_thread() {
+#ifdef RUSAGE_THREAD
+  return true;
+#else
+  return false;
+#endif
+}
+
+void NoiseMonitor::Start() {
+  ReadUsage(start_);
+#if defined(BENCHMARK_OS_LINUX)
+  if (migrations_fd_ >= 0) ioctl(migrations_fd_, PERF_EVENT_IOC_RESET, 0);
+#endif
+}
+
+void NoiseMonitor::Stop(UserCounters* counters) {
+  double usage[4];
+  ReadUsage(usage);
+  for (int i = 0; i < 4; ++i) {
+    (*counters)[kNoiseCounters[i]] = Counter(usage[i] - start_[i]);
+  }
+  if (migrations_fd_ >= 0) {
+    (*counters)[kNoiseCounters[4]] = Counter(ReadMigrations(migrations_fd_));
+  }
+}
+
+bool ParseNoiseThresholds(const std::string& str,
+                          std::map<std::string, double>* thresholds) {
+  thresholds->clear();
+  if (str.empty()) return true;
+  for (const std::string& threshold : StrSplit(str, ',')) {
+    const size_t eq = threshold.find('=');
+    if (eq == std::string::npos) return false;
+    const std::string name = threshold.substr(0, eq);
+    bool known = false;
+    for (const char* counter : kNoiseCounters) known |= name == counter;
+    const char* value = threshold.c_str() + eq + 1;
+    char* end;
+    const double max = std::strtod(value, &end);
+    if (!known || end == value || *end != '\0' || max < 0) return false;
+    (*thresholds)[name] = max;
+  }
+  return true;
+}
+
+std::string ExceededNoiseThreshold(
+    const UserCounters& counters,
+    const std::map<std::string, double>& thresholds) {
+  for (const auto& threshold : thresholds) {
+    auto it = counters.find(threshold.first);
+    if (it != counters.end() && it->second.value > threshold.second) {
+      return StrFormat("%s: %g > %g", threshold.first.c_str(),
+                       it->second.value, threshold.second);
+    }
+  }
+  return std::string();
+}
+
+}  // namespace internal
+}  // namespace benchmark
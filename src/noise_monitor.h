@@ -0,0 +1,54 @@
+#ifndef BENCHMARK_NOISE_MONITOR_H_
+#define BENCHMARK_NOISE_MONITOR_H_
+
+#include <map>
+#include <string>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+namespace internal {
+
+// Counts what the OS did to the calling thread between Start() and Stop():
+// its voluntary and involuntary context switches, its minor and major page
+// faults, and, where a perf software event can be opened, its migrations to
+// other cpus. Where the OS only counts them for the whole process, only the
+// monitor of the main thread of a run counts them, see per_thread().
+class NoiseMonitor {
+ public:
+  NoiseMonitor();
+  ~NoiseMonitor();
+
+  // Whether each thread counts its own events, rather than the process.
+  static bool per_thread();
+
+  void Start();
+
+  // Add the counts since Start() to 'counters', summed over the threads:
+  // "voluntary_switches", "involuntary_switches", "minor_faults",
+  // "major_faults" and "cpu_migrations".
+  void Stop(UserCounters* counters);
+
+ private:
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(NoiseMonitor);
+
+  // The perf event counting the migrations, or -1.
+  const int migrations_fd_;
+  double start_[4];
+};
+
+// Parse a --benchmark_noise_thresholds, e.g. "cpu_migrations=0,major_faults=0",
+// into the most of each counter that a repetition may have.
+bool ParseNoiseThresholds(const std::string& str,
+                          std::map<std::string, double>* thresholds);
+
+// The first of the 'thresholds' that 'counters' exceed, as
+// "<name>: <count> > <max>", or empty if none.
+std::string ExceededNoiseThreshold(
+    const UserCounters& counters,
+    const std::map<std::string, double>& thresholds);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_NOISE_MONITOR_H_
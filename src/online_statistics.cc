@@ -0,0 +1,278 @@
+#include "online_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "check.h"
+#include "statistics.h"
+
+namespace benchmark {
+
+RunningMoments::RunningMoments()
+    : count_(0),
+      sum_(0.0),
+      mean_(0.0),
+      m2_(0.0),
+      min_(std::numeric_limits<double>::infinity()),
+      max_(-std::numeric_limits<double>::infinity()) {}
+
+void RunningMoments::Add(double x) {
+  ++count_;
+  sum_ += x;
+  const double delta = x - mean_;
+  mean_ += delta / count_;
+  m2_ += delta * (x - mean_);
+  min_ = std::min(min_, x);
+  max_ = std::max(max_, x);
+}
+
+double RunningMoments::Mean() const {
+  if (count_ == 0) return 0.0;
+  // Like StatisticsMean(), to the last bit.
+  return sum_ * (1.0 / count_);
+}
+
+double RunningMoments::StdDev() const {
+  // Sample standard deviation is undefined for n = 1
+  if (count_ < 2) return 0.0;
+  return std::sqrt(std::max(m2_, 0.0) / (count_ - 1.0));
+}
+
+double RunningMoments::CV() const {
+  if (count_ < 2) return 0.0;
+  return StdDev() / Mean();
+}
+
+double RunningMoments::Min() const { return count_ == 0 ? 0.0 : min_; }
+
+double RunningMoments::Max() const { return count_ == 0 ? 0.0 : max_; }
+
+StreamingQuantile::StreamingQuantile(double p)
+    : p_(p), estimating_(false), heights_(), positions_(), desired_() {
+  BM_CHECK(p > 0.0 && p < 1.0);
+}
+
+void StreamingQuantile::Add(double x) {
+  if (!estimating_) {
+    exact_.push_back(x);
+    if (exact_.size() > kMaxExactValues) StartEstimating();
+    return;
+  }
+
+  // Find the cell of the markers 'x' falls in, moving the extremes if it is
+  // beyond them, and shift the markers above it.
+  int cell;
+  if (x < heights_[0]) {
+    heights_[0] = x;
+    cell = 0;
+  } else if (x >= heights_[4]) {
+    heights_[4] = x;
+    cell = 3;
+  } else {
+    cell = 0;
+    while (x >= heights_[cell + 1]) ++cell;
+  }
+  for (int i = cell + 1; i < 5; ++i) positions_[i] += 1.0;
+  const double increments[5] = {0.0, p_ / 2, p_, (1.0 + p_) / 2, 1.0};
+  for (int i = 0; i < 5; ++i) desired_[i] += increments[i];
+
+  // Move the middle markers that are off their desired position by more than
+  // one, along the parabola through them and their neighbours, or linearly
+  // if that would take them past a neighbour.
+  for (int i = 1; i < 4; ++i) {
+    const double offset = desired_[i] - positions_[i];
+    if ((offset >= 1.0 && positions_[i + 1] - positions_[i] > 1.0) ||
+        (offset <= -1.0 && positions_[i - 1] - positions_[i] < -1.0)) {
+      const int d = offset > 0 ? 1 : -1;
+      const double parabolic =
+          heights_[i] +
+          d / (positions_[i + 1] - positions_[i - 1]) *
+              ((positions_[i] - positions_[i - 1] + d) *
+                   (heights_[i + 1] - heights_[i]) /
+                   (positions_[i + 1] - positions_[i]) +
+               (positions_[i + 1] - positions_[i] - d) *
+                   (heights_[i] - heights_[i - 1]) /
+                   (positions_[i] - positions_[i - 1]));
+      if (heights_[i - 1] < parabolic && parabolic < heights_[i + 1]) {
+        heights_[i] = parabolic;
+      } else {
+        heights_[i] += d * (heights_[i + d] - heights_[i]) /
+                       (positions_[i + d] - positions_[i]);
+      }
+      positions_[i] += d;
+    }
+  }
+}
+
+double StreamingQuantile::Value() const {
+  if (estimating_) return heights_[2];
+  if (p_ == 0.5) return StatisticsMedian(exact_);
+  return StatisticsPercentile(exact_, p_ * 100);
+}
+
+void StreamingQuantile::StartEstimating() {
+  std::sort(exact_.begin(), exact_.end());
+  const double n = static_cast<double>(exact_.size());
+  const double quantiles[5] = {0.0, p_ / 2, p_, (1.0 + p_) / 2, 1.0};
+  for (int i = 0; i < 5; ++i) {
+    desired_[i] = 1.0 + (n - 1.0) * quantiles[i];
+    // The markers must be at distinct values, in order.
+    double position = std::floor(desired_[i] + 0.5);
+    if (i > 0) position = std::max(position, positions_[i - 1] + 1.0);
+    position = std::min(position, n - (4 - i));
+    positions_[i] = position;
+    heights_[i] = exact_[static_cast<size_t>(position) - 1];
+  }
+  estimating_ = true;
+  std::vector<double>().swap(exact_);
+}
+
+StatisticsAccumulator::Measure::Measure(
+    const std::vector<internal::Statistics>& statistics)
+    : keep_values_(false) {
+  for (const internal::Statistics& statistic : statistics) {
+    StatisticsFunc* compute = statistic.compute_;
+    if (compute == StatisticsMedian) {
+      quantiles_.insert(std::make_pair(compute, StreamingQuantile(0.5)));
+    } else if (compute == StatisticsP5) {
+      quantiles_.insert(std::make_pair(compute, StreamingQuantile(0.05)));
+    } else if (compute == StatisticsP95) {
+      quantiles_.insert(std::make_pair(compute, StreamingQuantile(0.95)));
+    } else if (compute != StatisticsMean && compute != StatisticsStdDev &&
+               compute != StatisticsCV && compute != StatisticsMin &&
+               compute != StatisticsMax) {
+      keep_values_ = true;
+    }
+  }
+}
+
+void StatisticsAccumulator::Measure::Add(double x) {
+  moments_.Add(x);
+  for (auto& kv : quantiles_) kv.second.Add(x);
+  if (keep_values_) values_.push_back(x);
+}
+
+double StatisticsAccumulator::Measure::Compute(
+    const internal::Statistics& statistic) const {
+  StatisticsFunc* compute = statistic.compute_;
+  if (compute == StatisticsMean) return moments_.Mean();
+  if (compute == StatisticsStdDev) return moments_.StdDev();
+  if (compute == StatisticsCV) return moments_.CV();
+  if (compute == StatisticsMin) return moments_.Min();
+  if (compute == StatisticsMax) return moments_.Max();
+  auto it = quantiles_.find(compute);
+  if (it != quantiles_.end()) return it->second.Value();
+  return compute(values_);
+}
+
+StatisticsAccumulator::StatisticsAccumulator()
+    : num_runs_(0), num_errors_(0), same_label_(true), statistics_(nullptr) {}
+
+void StatisticsAccumulator::Add(const BenchmarkReporter::Run& run) {
+  if (num_runs_ == 0) first_ = run;
+  BM_CHECK_EQ(first_.benchmark_name(), run.benchmark_name());
+  // The errored runs need not have run any iterations, so the aggregates
+  // take theirs from the first run that did not fail.
+  if (!run.error_occurred) {
+    if (num_runs_ == num_errors_) {
+      first_ = run;
+    } else {
+      BM_CHECK_EQ(first_.iterations, run.iterations);
+    }
+  }
+  ++num_runs_;
+  // Only add label if it is same for all runs
+  same_label_ &= run.report_label == first_.report_label;
+  if (run.error_occurred) {
+    ++num_errors_;
+    return;
+  }
+
+  // The errored runs don't say what statistics to compute.
+  if (statistics_ == nullptr) {
+    statistics_ = run.statistics;
+    BM_CHECK(statistics_ != nullptr);
+    times_.assign(2, Measure(*statistics_));
+  }
+  times_[0].Add(run.real_accumulated_time);
+  times_[1].Add(run.cpu_accumulated_time);
+  for (auto const& cnt : run.counters) {
+    auto it = counters_.find(cnt.first);
+    if (it == counters_.end()) {
+      CounterMeasure counter = {cnt.second, Measure(*statistics_)};
+      it = counters_.insert(std::make_pair(cnt.first, counter)).first;
+    } else {
+      BM_CHECK_EQ(it->second.counter.flags, cnt.second.flags);
+    }
+    it->second.measure.Add(cnt.second);
+  }
+}
+
+std::vector<BenchmarkReporter::Run> StatisticsAccumulator::Compute() const {
+  typedef BenchmarkReporter::Run Run;
+  std::vector<Run> results;
+  if (num_runs_ - num_errors_ < 2) {
+    // We don't report aggregated data if there was a single run.
+    return results;
+  }
+
+  // All repetitions should be run with the same number of iterations so we
+  // can take this information from the first benchmark that did not fail.
+  const IterationCount run_iterations = first_.iterations;
+  const double iteration_rescale_factor =
+      double(num_runs_) / double(run_iterations);
+
+  for (const auto& Stat : *statistics_) {
+    // Get the data from the accumulator to BenchmarkReporter::Run's.
+    Run data;
+    data.run_name = first_.run_name;
+    data.family_index = first_.family_index;
+    data.per_family_instance_index = first_.per_family_instance_index;
+    data.tags = first_.tags;
+    data.run_type = BenchmarkReporter::Run::RT_Aggregate;
+    data.threads = first_.threads;
+    data.processes = first_.processes;
+    data.repetitions = first_.repetitions;
+    data.repetition_index = Run::no_repetition_index;
+    data.aggregate_name = Stat.name_;
+    data.aggregate_unit = Stat.unit_;
+    if (same_label_) data.report_label = first_.report_label;
+
+    // It is incorrect to say that an aggregate is computed over
+    // run's iterations, because those iterations already got averaged.
+    // Similarly, if there are N repetitions with 1 iterations each,
+    // an aggregate will be computed over N measurements, not 1.
+    // Thus it is best to simply use the count of separate reports.
+    data.iterations = num_runs_;
+
+    data.real_accumulated_time = times_[0].Compute(Stat);
+    data.cpu_accumulated_time = times_[1].Compute(Stat);
+
+    if (data.aggregate_unit == StatisticUnit::kTime) {
+      // We will divide these times by data.iterations when reporting, but the
+      // data.iterations is not necessarily the scale of these measurements,
+      // because in each repetition, these timers are sum over all the iters.
+      // And if we want to say that the stats are over N repetitions and not
+      // M iterations, we need to multiply these by (N/M).
+      data.real_accumulated_time *= iteration_rescale_factor;
+      data.cpu_accumulated_time *= iteration_rescale_factor;
+    }
+
+    data.time_unit = first_.time_unit;
+
+    // user counters
+    for (auto const& kv : counters_) {
+      // Do *NOT* rescale the custom counters. They are already properly scaled.
+      const auto uc_stat = kv.second.measure.Compute(Stat);
+      data.counters[kv.first] =
+          Counter(uc_stat, kv.second.counter.flags, kv.second.counter.oneK);
+    }
+
+    results.push_back(data);
+  }
+
+  return results;
+}
+
+}  // end namespace benchmark
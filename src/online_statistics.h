@@ -0,0 +1,115 @@
+#ifndef BENCHMARK_ONLINE_STATISTICS_H_
+#define BENCHMARK_ONLINE_STATISTICS_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+
+// The count, sum, extremes and variance of a stream of values, updated in
+// constant time and memory with Welford's method, which doesn't lose the
+// variance to cancellation as the sum of the squares does.
+class RunningMoments {
+ public:
+  RunningMoments();
+
+  void Add(double x);
+
+  size_t count() const { return count_; }
+  // The same as StatisticsMean(), StatisticsStdDev(), etc. of the values.
+  double Mean() const;
+  double StdDev() const;
+  double CV() const;
+  double Min() const;
+  double Max() const;
+
+ private:
+  size_t count_;
+  double sum_;
+  double mean_;
+  double m2_;
+  double min_;
+  double max_;
+};
+
+// The 'p'-th quantile, 0 < p < 1, of a stream of values. It is exact while
+// there are few enough values to keep, and then estimated in constant memory
+// with the P-square algorithm of Jain and Chlamtac, which moves five markers
+// along the distribution as the values come in.
+class StreamingQuantile {
+ public:
+  explicit StreamingQuantile(double p);
+
+  void Add(double x);
+  double Value() const;
+
+ private:
+  // Place the markers from the values kept so far, and stop keeping them.
+  void StartEstimating();
+
+  static const size_t kMaxExactValues = 128;
+
+  double p_;
+  std::vector<double> exact_;
+  bool estimating_;
+  // The height and (1-based) position of each marker, and the position it
+  // should be at.
+  double heights_[5];
+  double positions_[5];
+  double desired_[5];
+};
+
+// Computes the aggregates of the repetitions of a benchmark, as
+// ComputeStats() does, from the repetitions as they are added rather than
+// all of them at once. The built-in statistics are updated online; only those
+// from a user-provided StatisticsFunc need all the values, which are then kept
+// for them.
+class StatisticsAccumulator {
+ public:
+  StatisticsAccumulator();
+
+  // Add one of the repetitions. They must all be of the same benchmark, with
+  // the same number of iterations.
+  void Add(const BenchmarkReporter::Run& run);
+
+  // Return the aggregates of the repetitions so far, or an empty vector if
+  // there are less than two non-errored ones.
+  std::vector<BenchmarkReporter::Run> Compute() const;
+
+ private:
+  // The values of one measurement, as needed by the statistics.
+  class Measure {
+   public:
+    explicit Measure(const std::vector<internal::Statistics>& statistics);
+
+    void Add(double x);
+    double Compute(const internal::Statistics& statistic) const;
+
+   private:
+    RunningMoments moments_;
+    std::map<StatisticsFunc*, StreamingQuantile> quantiles_;
+    bool keep_values_;
+    std::vector<double> values_;
+  };
+
+  struct CounterMeasure {
+    Counter counter;
+    Measure measure;
+  };
+
+  // The first repetition, which the aggregates take their name etc. from.
+  BenchmarkReporter::Run first_;
+  size_t num_runs_;
+  size_t num_errors_;
+  bool same_label_;
+  const std::vector<internal::Statistics>* statistics_;
+  std::vector<Measure> times_;  // Real, then cpu.
+  std::map<std::string, CounterMeasure> counters_;
+};
+
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_ONLINE_STATISTICS_H_
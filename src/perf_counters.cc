@@ -18,6 +18,8 @@
 #include <vector>
 
 #if defined HAVE_LIBPFM
+#include <sys/mman.h>
+
 #include "perfmon/pfmlib.h"
 #include "perfmon/pfmlib_perf_event.h"
 #endif
@@ -26,14 +28,100 @@ namespace benchmark {
 namespace internal {
 
 constexpr size_t PerfCounterValues::kMaxCounters;
+constexpr size_t PerfCounterValues::kMaxCountersPerGroup;
+constexpr size_t PerfCounterValues::kMaxGroups;
 
 #if defined HAVE_LIBPFM
 const bool PerfCounters::kSupported = true;
 
 bool PerfCounters::Initialize() { return pfm_initialize() == PFM_SUCCESS; }
 
+std::string PerfCounters::CorePmuName() {
+  if (!Initialize()) return "";
+  for (int pmu = PFM_PMU_NONE; pmu < PFM_PMU_MAX; ++pmu) {
+    pfm_pmu_info_t info;
+    std::memset(&info, 0, sizeof(info));
+    info.size = sizeof(info);
+    if (pfm_get_pmu_info(static_cast<pfm_pmu_t>(pmu), &info) == PFM_SUCCESS &&
+        info.is_present && info.type == PFM_PMU_TYPE_CORE) {
+      return info.name;
+    }
+  }
+  return "";
+}
+
+namespace {
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+#define BENCHMARK_HAS_USER_PMC_READ 1
+
+// Read the hardware counter 'counter', as numbered by the 'index' field (minus
+// one) of the perf_event_mmap_page.
+inline uint64_t ReadPmc(uint32_t counter) {
+#if defined(__x86_64__) || defined(__i386__)
+  uint32_t lo, hi;
+  asm volatile("rdpmc" : "=a"(lo), "=d"(hi) : "c"(counter));
+  return (static_cast<uint64_t>(hi) << 32) | lo;
+#else
+  uint64_t value;
+  // The kernel numbers the cycle counter 32 (see armv8pmu_user_event_idx).
+  if (counter == 32) {
+    asm volatile("mrs %0, pmccntr_el0" : "=r"(value));
+  } else {
+    asm volatile("msr pmselr_el0, %0" : : "r"(static_cast<uint64_t>(counter)));
+    asm volatile("isb" : : : "memory");
+    asm volatile("mrs %0, pmxevcntr_el0" : "=r"(value));
+  }
+  return value;
+#endif
+}
+#endif
+
+// Read the counter of the mapped 'page' following the protocol documented in
+// linux/perf_event.h. Returns false if the counter is not currently on the
+// PMU, in which case it has to be read with a syscall.
+bool ReadUserCounter(const perf_event_mmap_page* page, uint64_t* value) {
+#if defined(BENCHMARK_HAS_USER_PMC_READ)
+  uint32_t seq;
+  do {
+    seq = page->lock;
+    ClobberMemory();
+    const uint32_t index = page->index;
+    if (!page->cap_user_rdpmc || index == 0) return false;
+    // Sign-extend the pmc_width bits that the PMU counts.
+    const int shift = 64 - page->pmc_width;
+    const int64_t pmc =
+        static_cast<int64_t>(ReadPmc(index - 1) << shift) >> shift;
+    *value = static_cast<uint64_t>(page->offset + pmc);
+    ClobberMemory();
+  } while (page->lock != seq);
+  return true;
+#else
+  (void)page;
+  (void)value;
+  return false;
+#endif
+}
+
+}  // namespace
+
+bool PerfCounters::SnapshotInUserSpace(PerfCounterValues* values) const {
+  for (size_t i = 0; i < user_pages_.size(); ++i) {
+    if (!ReadUserCounter(
+            static_cast<const perf_event_mmap_page*>(user_pages_[i]),
+            &values->values_[i])) {
+      return false;
+    }
+  }
+  // The single group is pinned, so it was never multiplexed, and the times
+  // that would be used to scale the values don't matter.
+  values->time_enabled_[0] = 0;
+  values->time_running_[0] = 0;
+  return true;
+}
+
 PerfCounters PerfCounters::Create(
-    const std::vector<std::string>& counter_names) {
+    const std::vector<std::string>& counter_names, bool inherit) {
   if (counter_names.empty()) {
     return NoCounters();
   }
@@ -44,18 +132,31 @@ PerfCounters PerfCounters::Create(
         << PerfCounterValues::kMaxCounters << "\n";
     return NoCounters();
   }
-  std::vector<int> counter_ids(counter_names.size());
+  std::vector<int> counter_ids(counter_names.size(), -1);
+  // Close what was opened so far when bailing out.
+  auto fail = [&counter_ids]() -> PerfCounters {
+    for (int fd : counter_ids) {
+      if (fd >= 0) close(fd);
+    }
+    return NoCounters();
+  };
 
+  // A single group is pinned, so it is either always counting or fails to be
+  // scheduled at all. Several groups have to share the PMU, so they are left
+  // unpinned for the kernel to multiplex.
+  const bool single_group =
+      counter_names.size() <= PerfCounterValues::kMaxCountersPerGroup;
   const int mode = PFM_PLM3;  // user mode only
   for (size_t i = 0; i < counter_names.size(); ++i) {
-    const bool is_first = i == 0;
+    const size_t leader = i - i % PerfCounterValues::kMaxCountersPerGroup;
+    const bool is_first = i == leader;
     struct perf_event_attr attr{};
     attr.size = sizeof(attr);
-    const int group_id = !is_first ? counter_ids[0] : -1;
+    const int group_id = !is_first ? counter_ids[leader] : -1;
     const auto& name = counter_names[i];
     if (name.empty()) {
       GetErrorLogInstance() << "A counter name was the empty string\n";
-      return NoCounters();
+      return fail();
     }
     pfm_perf_encode_arg_t arg{};
     arg.attr = &attr;
@@ -64,19 +165,21 @@ PerfCounters PerfCounters::Create(
         pfm_get_os_event_encoding(name.c_str(), mode, PFM_OS_PERF_EVENT, &arg);
     if (pfm_get != PFM_SUCCESS) {
       GetErrorLogInstance() << "Unknown counter name: " << name << "\n";
-      return NoCounters();
+      return fail();
     }
     attr.disabled = is_first;
     // Note: the man page for perf_event_create suggests inerit = true and
     // read_format = PERF_FORMAT_GROUP don't work together, but that's not the
     // case.
-    attr.inherit = true;
-    attr.pinned = is_first;
+    attr.inherit = inherit;
+    attr.pinned = is_first && single_group;
     attr.exclude_kernel = true;
     attr.exclude_user = false;
     attr.exclude_hv = true;
-    // Read all counters in one read.
-    attr.read_format = PERF_FORMAT_GROUP;
+    // Read all counters of a group in one read, along with the times needed
+    // to scale the values if the group was multiplexed.
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
 
     int id = -1;
     static constexpr size_t kNrOfSyscallRetries = 5;
@@ -91,24 +194,53 @@ PerfCounters PerfCounters::Create(
     if (id < 0) {
       GetErrorLogInstance()
           << "Failed to get a file descriptor for " << name << "\n";
-      return NoCounters();
+      return fail();
     }
 
     counter_ids[i] = id;
   }
-  if (ioctl(counter_ids[0], PERF_EVENT_IOC_ENABLE) != 0) {
-    GetErrorLogInstance() << "Failed to start counters\n";
-    return NoCounters();
+  for (size_t leader = 0; leader < counter_ids.size();
+       leader += PerfCounterValues::kMaxCountersPerGroup) {
+    if (ioctl(counter_ids[leader], PERF_EVENT_IOC_ENABLE) != 0) {
+      GetErrorLogInstance() << "Failed to start counters\n";
+      return fail();
+    }
+  }
+
+  // Map the counters for reading them in user space, if possible.
+  const long page_size = sysconf(_SC_PAGESIZE);
+  std::vector<void*> user_pages;
+  if (single_group && !inherit) {
+    for (int fd : counter_ids) {
+      void* page = mmap(nullptr, page_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (page == MAP_FAILED) break;
+      user_pages.push_back(page);
+      if (!static_cast<perf_event_mmap_page*>(page)->cap_user_rdpmc) break;
+    }
+    if (user_pages.size() != counter_ids.size() ||
+        !static_cast<perf_event_mmap_page*>(user_pages.back())
+             ->cap_user_rdpmc) {
+      for (void* page : user_pages) munmap(page, page_size);
+      user_pages.clear();
+    }
   }
 
-  return PerfCounters(counter_names, std::move(counter_ids));
+  return PerfCounters(counter_names, std::move(counter_ids),
+                      std::move(user_pages));
 }
 
 PerfCounters::~PerfCounters() {
+  const long page_size = sysconf(_SC_PAGESIZE);
+  for (void* page : user_pages_) {
+    munmap(page, page_size);
+  }
   if (counter_ids_.empty()) {
     return;
   }
-  ioctl(counter_ids_[0], PERF_EVENT_IOC_DISABLE);
+  for (size_t leader = 0; leader < counter_ids_.size();
+       leader += PerfCounterValues::kMaxCountersPerGroup) {
+    ioctl(counter_ids_[leader], PERF_EVENT_IOC_DISABLE);
+  }
   for (int fd : counter_ids_) {
     close(fd);
   }
@@ -118,8 +250,14 @@ const bool PerfCounters::kSupported = false;
 
 bool PerfCounters::Initialize() { return false; }
 
+std::string PerfCounters::CorePmuName() { return ""; }
+
+bool PerfCounters::SnapshotInUserSpace(PerfCounterValues*) const {
+  return false;
+}
+
 PerfCounters PerfCounters::Create(
-    const std::vector<std::string>& counter_names) {
+    const std::vector<std::string>& counter_names, bool) {
   if (!counter_names.empty()) {
     GetErrorLogInstance() << "Performance counters not supported.";
   }
@@ -15,8 +15,11 @@
 #ifndef BENCHMARK_PERF_COUNTERS_H
 #define BENCHMARK_PERF_COUNTERS_H
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "benchmark/benchmark.h"
@@ -30,9 +33,11 @@
 namespace benchmark {
 namespace internal {
 
-// Typically, we can only read a small number of counters. There is also a
-// padding preceding counter values, when reading multiple counters with one
-// syscall (which is desirable). PerfCounterValues abstracts these details.
+// Typically, the PMU can only count a small number of events at a time, so
+// the counters are split into groups of at most kMaxCountersPerGroup, which
+// the kernel multiplexes onto the PMU if they don't all fit. Each group is read
+// with one syscall, along with the time the group was enabled and the time it
+// was actually counting. PerfCounterValues abstracts these details.
 // The implementation ensures the storage is inlined, and allows 0-based
 // indexing into the counter values.
 // The object is used in conjunction with a PerfCounters object, by passing it
@@ -45,21 +50,29 @@ class PerfCounterValues {
     BM_CHECK_LE(nr_counters_, kMaxCounters);
   }
 
-  uint64_t operator[](size_t pos) const { return values_[kPadding + pos]; }
+  uint64_t operator[](size_t pos) const { return values_[pos]; }
 
-  static constexpr size_t kMaxCounters = 3;
+  // The time (in ns) the group of the counter at 'pos' was enabled, and the
+  // time it was actually scheduled on the PMU. They only differ if the
+  // counters were multiplexed.
+  uint64_t time_enabled(size_t pos) const {
+    return time_enabled_[pos / kMaxCountersPerGroup];
+  }
+  uint64_t time_running(size_t pos) const {
+    return time_running_[pos / kMaxCountersPerGroup];
+  }
+
+  static constexpr size_t kMaxCounters = 32;
+  static constexpr size_t kMaxCountersPerGroup = 3;
+  static constexpr size_t kMaxGroups =
+      (kMaxCounters + kMaxCountersPerGroup - 1) / kMaxCountersPerGroup;
 
  private:
   friend class PerfCounters;
-  // Get the byte buffer in which perf counters can be captured.
-  // This is used by PerfCounters::Read
-  std::pair<char*, size_t> get_data_buffer() {
-    return {reinterpret_cast<char*>(values_.data()),
-            sizeof(uint64_t) * (kPadding + nr_counters_)};
-  }
 
-  static constexpr size_t kPadding = 1;
-  std::array<uint64_t, kPadding + kMaxCounters> values_;
+  std::array<uint64_t, kMaxCounters> values_;
+  std::array<uint64_t, kMaxGroups> time_enabled_;
+  std::array<uint64_t, kMaxGroups> time_running_;
   const size_t nr_counters_;
 };
 
@@ -82,12 +95,20 @@ class PerfCounters final {
   // initialization here.
   static bool Initialize();
 
+  // The name libpfm gives the core PMU of this cpu, e.g. "skl", or "" if
+  // there's none it knows.
+  static std::string CorePmuName();
+
   // Return a PerfCounters object ready to read the counters with the names
   // specified. The values are user-mode only. The counter name format is
-  // implementation and OS specific.
+  // implementation and OS specific. If 'inherit' is true, the counters also
+  // count the threads created by the calling thread from now on; otherwise
+  // they only count the calling thread, which allows reading them without a
+  // syscall where the platform supports it.
   // TODO: once we move to C++-17, this should be a std::optional, and then the
   // IsValid() boolean can be dropped.
-  static PerfCounters Create(const std::vector<std::string>& counter_names);
+  static PerfCounters Create(const std::vector<std::string>& counter_names,
+                             bool inherit = true);
 
   // Take a snapshot of the current value of the counters into the provided
   // valid PerfCounterValues storage. The values are populated such that:
@@ -96,9 +117,30 @@ class PerfCounters final {
 #ifndef BENCHMARK_OS_WINDOWS
     assert(values != nullptr);
     assert(IsValid());
-    auto buffer = values->get_data_buffer();
-    auto read_bytes = ::read(counter_ids_[0], buffer.first, buffer.second);
-    return static_cast<size_t>(read_bytes) == buffer.second;
+    if (!user_pages_.empty() && std::this_thread::get_id() == owner_ &&
+        SnapshotInUserSpace(values)) {
+      return true;
+    }
+    // With PERF_FORMAT_GROUP and the TOTAL_TIME_* flags, a read() of a group
+    // leader yields: nr, time_enabled, time_running, value[nr].
+    static constexpr size_t kHeader = 3;
+    std::array<uint64_t, kHeader + PerfCounterValues::kMaxCountersPerGroup>
+        buffer;
+    for (size_t group = 0; group < num_groups(); ++group) {
+      const size_t first = group * PerfCounterValues::kMaxCountersPerGroup;
+      const size_t count = std::min(PerfCounterValues::kMaxCountersPerGroup,
+                                    num_counters() - first);
+      const size_t size = sizeof(uint64_t) * (kHeader + count);
+      auto read_bytes =
+          ::read(counter_ids_[first], buffer.data(), size);
+      if (static_cast<size_t>(read_bytes) != size) return false;
+      values->time_enabled_[group] = buffer[1];
+      values->time_running_[group] = buffer[2];
+      for (size_t i = 0; i < count; ++i) {
+        values->values_[first + i] = buffer[kHeader + i];
+      }
+    }
+    return true;
 #else
     (void)values;
     return false;
@@ -108,29 +150,68 @@ class PerfCounters final {
   const std::vector<std::string>& names() const { return counter_names_; }
   size_t num_counters() const { return counter_names_.size(); }
 
+  // The number of perf_event groups the counters were split into. If there is
+  // more than one, the kernel may multiplex them.
+  size_t num_groups() const {
+    return (num_counters() + PerfCounterValues::kMaxCountersPerGroup - 1) /
+           PerfCounterValues::kMaxCountersPerGroup;
+  }
+
  private:
   PerfCounters(const std::vector<std::string>& counter_names,
-               std::vector<int>&& counter_ids)
+               std::vector<int>&& counter_ids,
+               std::vector<void*>&& user_pages)
       : counter_ids_(std::move(counter_ids)),
+        user_pages_(std::move(user_pages)),
+        owner_(std::this_thread::get_id()),
         counter_names_(counter_names),
         is_valid_(true) {}
   PerfCounters() : is_valid_(false) {}
 
+  // Read the counters straight from the PMU (rdpmc on x86, the PMU registers
+  // on arm64), through the perf_event pages mapped in 'user_pages_'. Returns
+  // false if that's not possible right now, e.g. because the kernel has not
+  // scheduled the counters onto the PMU, or this platform can't do it.
+  bool SnapshotInUserSpace(PerfCounterValues* values) const;
+
+  // The file descriptors of the counters. The one of counter i is the group
+  // leader if i % PerfCounterValues::kMaxCountersPerGroup == 0.
   std::vector<int> counter_ids_;
+  // The mmap'd perf_event_mmap_page of every counter, if they can be read in
+  // user space. That's only the case for a single group of non-inherited
+  // counters, read from the thread that opened them.
+  std::vector<void*> user_pages_;
+  std::thread::id owner_;
   const std::vector<std::string> counter_names_;
   const bool is_valid_;
 };
 
-// Typical usage of the above primitives.
+// Typical usage of the above primitives. The measured intervals between
+// Start() and Stop() are accumulated into pre-sized storage, so that pausing
+// and resuming the timer inside the benchmark loop does not allocate. The
+// named measurements are only produced afterwards, by GetMeasurements().
 class PerfCountersMeasurement final {
  public:
   PerfCountersMeasurement(PerfCounters&& c)
       : counters_(std::move(c)),
         start_values_(counters_.IsValid() ? counters_.names().size() : 0),
-        end_values_(counters_.IsValid() ? counters_.names().size() : 0) {}
+        end_values_(counters_.IsValid() ? counters_.names().size() : 0) {
+    Reset();
+  }
 
   bool IsValid() const { return counters_.IsValid(); }
 
+  // True if the counters may be multiplexed, in which case their values are
+  // estimates, and their running fractions are worth reporting.
+  bool IsMultiplexed() const { return counters_.num_groups() > 1; }
+
+  // Forget the intervals measured so far.
+  void Reset() {
+    accumulated_values_.fill(0);
+    accumulated_enabled_.fill(0);
+    accumulated_running_.fill(0);
+  }
+
   BENCHMARK_ALWAYS_INLINE void Start() {
     assert(IsValid());
     // Tell the compiler to not move instructions above/below where we take
@@ -140,20 +221,81 @@ class PerfCountersMeasurement final {
     ClobberMemory();
   }
 
-  BENCHMARK_ALWAYS_INLINE std::vector<std::pair<std::string, double>>
-  StopAndGetMeasurements() {
+  BENCHMARK_ALWAYS_INLINE void Stop() {
     assert(IsValid());
     // Tell the compiler to not move instructions above/below where we take
     // the snapshot.
     ClobberMemory();
     counters_.Snapshot(&end_values_);
     ClobberMemory();
+    AddInterval(start_values_, end_values_, accumulated_values_.data(),
+                accumulated_enabled_.data(), accumulated_running_.data());
+  }
+
+  // Take a snapshot of the counters into 'values', which has room for all of
+  // them, e.g. to measure a part of the Start()/Stop() interval.
+  BENCHMARK_ALWAYS_INLINE bool Snapshot(PerfCounterValues* values) const {
+    assert(IsValid());
+    ClobberMemory();
+    const bool ok = counters_.Snapshot(values);
+    ClobberMemory();
+    return ok;
+  }
 
-    std::vector<std::pair<std::string, double>> ret;
+  // Add the counts from the snapshot 'start' to the snapshot 'end' to
+  // 'values', indexed as names(), and the times each group was enabled and
+  // running to 'enabled' and 'running', indexed by group, unless they are
+  // null.
+  void AddInterval(const PerfCounterValues& start, const PerfCounterValues& end,
+                   double* values, double* enabled, double* running) const {
+    for (size_t group = 0; group < counters_.num_groups(); ++group) {
+      const size_t first = group * PerfCounterValues::kMaxCountersPerGroup;
+      const double group_enabled =
+          static_cast<double>(end.time_enabled(first)) -
+          static_cast<double>(start.time_enabled(first));
+      const double group_running =
+          static_cast<double>(end.time_running(first)) -
+          static_cast<double>(start.time_running(first));
+      // Scale up the counts of a group that only counted for part of the
+      // interval.
+      double scale = 1.0;
+      if (group_enabled > 0 && group_running < group_enabled) {
+        scale = group_running > 0 ? group_enabled / group_running : 0;
+      }
+      const size_t last =
+          std::min(first + PerfCounterValues::kMaxCountersPerGroup,
+                   counters_.num_counters());
+      for (size_t i = first; i < last; ++i) {
+        values[i] += scale * (static_cast<double>(end[i]) -
+                              static_cast<double>(start[i]));
+      }
+      if (enabled != nullptr) enabled[group] += group_enabled;
+      if (running != nullptr) running[group] += group_running;
+    }
+  }
+
+  const std::vector<std::string>& names() const { return counters_.names(); }
+
+  struct Measurement {
+    std::string name;
+    // The count, scaled up to the whole measurement if the counter was only
+    // scheduled for part of it.
+    double value;
+    // The fraction of the measurement the counter was actually counting.
+    double running_fraction;
+  };
+
+  // The measurements accumulated over the Start()/Stop() intervals since the
+  // last Reset().
+  std::vector<Measurement> GetMeasurements() const {
+    std::vector<Measurement> ret;
     for (size_t i = 0; i < counters_.names().size(); ++i) {
-      double measurement = static_cast<double>(end_values_[i]) -
-                           static_cast<double>(start_values_[i]);
-      ret.push_back({counters_.names()[i], measurement});
+      const size_t group = i / PerfCounterValues::kMaxCountersPerGroup;
+      const double enabled = accumulated_enabled_[group];
+      const double running_fraction =
+          enabled > 0 ? accumulated_running_[group] / enabled : 1.0;
+      ret.push_back(
+          {counters_.names()[i], accumulated_values_[i], running_fraction});
     }
     return ret;
   }
@@ -162,6 +304,10 @@ class PerfCountersMeasurement final {
   PerfCounters counters_;
   PerfCounterValues start_values_;
   PerfCounterValues end_values_;
+
+  std::array<double, PerfCounterValues::kMaxCounters> accumulated_values_;
+  std::array<double, PerfCounterValues::kMaxGroups> accumulated_enabled_;
+  std::array<double, PerfCounterValues::kMaxGroups> accumulated_running_;
 };
 
 BENCHMARK_UNUSED static bool perf_init_anchor = PerfCounters::Initialize();
@@ -0,0 +1,214 @@
+#include "perf_metrics.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace benchmark {
+namespace internal {
+
+// The events of the top-down level 1 on a family of Intel cores, in libpfm
+// names, as in the TMA_Metrics tables of Intel's perfmon repository.
+struct TopDownModel {
+  // The libpfm names of the core PMUs of the family.
+  std::vector<std::string> pmus;
+  // The event counting the pipeline slots, and the slots per count of it.
+  std::string slots;
+  double slots_per_count;
+  // The uops the core can issue per cycle.
+  double width;
+  std::string not_delivered;
+  std::string issued;
+  std::string retired;
+  std::string recovery_cycles;
+};
+
+namespace {
+
+const std::vector<TopDownModel>& TopDownModels() {
+  static const std::vector<TopDownModel>* models = new std::vector<
+      TopDownModel>{
+      // Sandy Bridge to Skylake and its servers: the slots are 4 per cycle.
+      {{"snb", "snb_ep", "ivb", "ivb_ep", "hsw", "hsw_ep", "bdw", "bdw_ep",
+        "skl", "skx"},
+       "UNHALTED_CORE_CYCLES",
+       4,
+       4,
+       "IDQ_UOPS_NOT_DELIVERED:CORE",
+       "UOPS_ISSUED:ANY",
+       "UOPS_RETIRED:RETIRE_SLOTS",
+       "INT_MISC:RECOVERY_CYCLES"},
+      // Ice Lake counts the slots, which are 5 per cycle, itself.
+      {{"icl", "icx"},
+       "TOPDOWN:SLOTS",
+       1,
+       5,
+       "IDQ_UOPS_NOT_DELIVERED:CORE",
+       "UOPS_ISSUED:ANY",
+       "UOPS_RETIRED:SLOTS",
+       "INT_MISC:RECOVERY_CYCLES"}};
+  return *models;
+}
+
+const char* const kMetricSets[] = {"ipc", "branch", "memory", "tma_l1"};
+
+// The generic events libpfm maps to those of each cpu.
+const char kCycles[] = "CYCLES";
+const char kInstructions[] = "INSTRUCTIONS";
+const char kBranches[] = "BRANCHES";
+const char kBranchMisses[] = "BRANCH-MISSES";
+const char kL1dMisses[] = "PERF_COUNT_HW_CACHE_L1D:READ:MISS";
+const char kLlcMisses[] = "CACHE-MISSES";
+
+void AddCounter(const std::string& name, std::vector<std::string>* names) {
+  if (std::find(names->begin(), names->end(), name) == names->end()) {
+    names->push_back(name);
+  }
+}
+
+bool GetCount(const UserCounters& counters, const std::string& name,
+              double* count) {
+  auto it = counters.find(name);
+  if (it == counters.end()) return false;
+  *count = it->second.value;
+  return true;
+}
+
+// 'events' per thousand 'instructions'.
+double Mpki(double events, double instructions) {
+  return instructions > 0 ? 1000 * events / instructions : 0;
+}
+
+}  // end namespace
+
+bool PerfMetrics::IsValid(const std::vector<std::string>& sets) {
+  for (const std::string& set : sets) {
+    if (std::find(std::begin(kMetricSets), std::end(kMetricSets), set) ==
+        std::end(kMetricSets)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PerfMetrics::Create(const std::vector<std::string>& sets,
+                         const std::string& pmu, PerfMetrics* metrics,
+                         std::string* error) {
+  PerfMetrics result;
+  for (const std::string& set : sets) {
+    if (!IsValid({set})) {
+      *error = "unknown perf metric set '" + set + "'";
+      return false;
+    }
+    AddCounter(set, &result.sets_);
+    std::vector<std::string>& names = result.counter_names_;
+    if (set == "ipc") {
+      AddCounter(kCycles, &names);
+      AddCounter(kInstructions, &names);
+    } else if (set == "branch") {
+      AddCounter(kInstructions, &names);
+      AddCounter(kBranches, &names);
+      AddCounter(kBranchMisses, &names);
+    } else if (set == "memory") {
+      AddCounter(kInstructions, &names);
+      AddCounter(kL1dMisses, &names);
+      AddCounter(kLlcMisses, &names);
+    } else {
+      for (const TopDownModel& model : TopDownModels()) {
+        if (std::find(model.pmus.begin(), model.pmus.end(), pmu) !=
+            model.pmus.end()) {
+          result.top_down_ = &model;
+        }
+      }
+      if (result.top_down_ == nullptr) {
+        *error = "the events of 'tma_l1' are not known for this cpu" +
+                 (pmu.empty() ? std::string() : " (" + pmu + ")");
+        return false;
+      }
+      AddCounter(result.top_down_->slots, &names);
+      AddCounter(result.top_down_->not_delivered, &names);
+      AddCounter(result.top_down_->issued, &names);
+      AddCounter(result.top_down_->retired, &names);
+      AddCounter(result.top_down_->recovery_cycles, &names);
+    }
+  }
+  *metrics = result;
+  return true;
+}
+
+void PerfMetrics::Compute(UserCounters* counters) const {
+  double instructions = 0;
+  double cycles, branches, misses, l1d_misses, llc_misses;
+  const bool has_instructions = GetCount(*counters, kInstructions,
+                                         &instructions);
+  for (const std::string& set : sets_) {
+    if (set == "ipc") {
+      if (has_instructions && GetCount(*counters, kCycles, &cycles) &&
+          cycles > 0) {
+        (*counters)["ipc"] = Counter(instructions / cycles);
+      }
+    } else if (set == "branch") {
+      if (has_instructions && GetCount(*counters, kBranches, &branches) &&
+          GetCount(*counters, kBranchMisses, &misses)) {
+        (*counters)["branch_miss_rate"] =
+            Counter(branches > 0 ? misses / branches : 0);
+        (*counters)["branch_mpki"] = Counter(Mpki(misses, instructions));
+      }
+    } else if (set == "memory") {
+      if (has_instructions &&
+          GetCount(*counters, kL1dMisses, &l1d_misses) &&
+          GetCount(*counters, kLlcMisses, &llc_misses)) {
+        (*counters)["l1d_mpki"] = Counter(Mpki(l1d_misses, instructions));
+        (*counters)["llc_mpki"] = Counter(Mpki(llc_misses, instructions));
+      }
+    } else if (top_down_ != nullptr) {
+      double slots, not_delivered, issued, retired, recovery_cycles;
+      if (!GetCount(*counters, top_down_->slots, &slots) ||
+          !GetCount(*counters, top_down_->not_delivered, &not_delivered) ||
+          !GetCount(*counters, top_down_->issued, &issued) ||
+          !GetCount(*counters, top_down_->retired, &retired) ||
+          !GetCount(*counters, top_down_->recovery_cycles, &recovery_cycles)) {
+        continue;
+      }
+      slots *= top_down_->slots_per_count;
+      if (slots <= 0) continue;
+      const double frontend_bound = not_delivered / slots;
+      // The uops issued that did not retire, and the slots lost recovering
+      // from the mispredictions.
+      const double bad_speculation = std::max(
+          0.0, (issued - retired + top_down_->width * recovery_cycles) / slots);
+      const double retiring = retired / slots;
+      (*counters)["tma_frontend_bound"] = Counter(frontend_bound);
+      (*counters)["tma_bad_speculation"] = Counter(bad_speculation);
+      (*counters)["tma_retiring"] = Counter(retiring);
+      (*counters)["tma_backend_bound"] = Counter(
+          std::max(0.0, 1 - frontend_bound - bad_speculation - retiring));
+    }
+  }
+}
+
+void AddPerUnitCounters(const std::vector<std::string>& names,
+                        UserCounters* counters) {
+  // SetItemsProcessed() and SetBytesProcessed() count them as rates, which
+  // are only made so once the metrics are.
+  double items = 0, bytes = 0;
+  GetCount(*counters, "items_per_second", &items);
+  GetCount(*counters, "bytes_per_second", &bytes);
+  UserCounters per_unit;
+  for (const std::string& name : names) {
+    double count;
+    if (!GetCount(*counters, name, &count)) continue;
+    if (items > 0) per_unit[name + "_per_item"] = Counter(count / items);
+    if (bytes > 0) per_unit[name + "_per_byte"] = Counter(count / bytes);
+  }
+  double cycles, instructions;
+  if (std::find(names.begin(), names.end(), kCycles) != names.end() &&
+      std::find(names.begin(), names.end(), kInstructions) != names.end() &&
+      GetCount(*counters, kCycles, &cycles) &&
+      GetCount(*counters, kInstructions, &instructions) && cycles > 0) {
+    per_unit["ipc"] = Counter(instructions / cycles);
+  }
+  counters->insert(per_unit.begin(), per_unit.end());
+}
+
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,67 @@
+#ifndef BENCHMARK_PERF_METRICS_H_
+#define BENCHMARK_PERF_METRICS_H_
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+namespace internal {
+
+struct TopDownModel;
+
+// The metric sets of --benchmark_perf_metrics, on the cpu whose core PMU is
+// named 'pmu' by libpfm (e.g. "skl"): the perf counters they need, and the
+// metrics they derive from the counts of those:
+//
+// - "ipc": the instructions retired per cycle.
+// - "branch": the mispredicted fraction of the branches, and the
+//   mispredictions per thousand instructions (MPKI).
+// - "memory": the MPKI of the L1 data cache and of the last-level cache.
+// - "tma_l1": the level 1 of the top-down microarchitecture analysis: the
+//   fractions of the pipeline slots that were frontend bound, bad
+//   speculation, retiring, and backend bound. Only on the Intel cores whose
+//   events are known.
+class PerfMetrics {
+ public:
+  PerfMetrics() : top_down_(nullptr) {}
+
+  // Whether the sets are all known, whatever the cpu.
+  static bool IsValid(const std::vector<std::string>& sets);
+
+  // The metrics of 'sets' on 'pmu'. Returns false, with the reason in
+  // 'error', if one of them is unknown or can't be measured on that cpu.
+  static bool Create(const std::vector<std::string>& sets,
+                     const std::string& pmu, PerfMetrics* metrics,
+                     std::string* error);
+
+  // The libpfm names of the counters the metrics need, without duplicates.
+  const std::vector<std::string>& counter_names() const {
+    return counter_names_;
+  }
+
+  // Add the metrics to 'counters', which hold the totals of the counters over
+  // the run. The metrics whose counters are missing, e.g. because they could
+  // not be opened, are left out.
+  void Compute(UserCounters* counters) const;
+
+ private:
+  std::vector<std::string> sets_;
+  std::vector<std::string> counter_names_;
+  // The events of "tma_l1" on this cpu, if it is one of the sets.
+  const TopDownModel* top_down_;
+};
+
+// Add, for each of the perf counters 'names' in 'counters', which hold the
+// totals of the counters and of the items and bytes processed over the run,
+// its count per item, "<name>_per_item", and per byte, "<name>_per_byte", if
+// the benchmark processed any, and "ipc" if the counters include the cycles
+// and the instructions.
+void AddPerUnitCounters(const std::vector<std::string>& names,
+                        UserCounters* counters);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_PERF_METRICS_H_
@@ -0,0 +1,302 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "internal_macros.h"
+#include "string_util.h"
+
+#if defined(BENCHMARK_OS_LINUX)
+#include <dlfcn.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+// Samples per second of the thread's running time. The 4000 that perf takes
+// by default would fill the ring buffer with branches in under a second.
+constexpr int kSampleFrequency = 1000;
+
+#if defined(BENCHMARK_OS_LINUX)
+// The pages of the ring buffer, a power of two: at the frequency above, that
+// is about a minute of instruction samples, and a second of branches, between
+// two Stop()s.
+constexpr size_t kBufferPages = 64;
+
+int OpenSamplingEvent(struct perf_event_attr* attr) {
+  return static_cast<int>(syscall(__NR_perf_event_open, attr, 0, -1, -1, 0));
+}
+
+// Copy 'size' bytes from 'offset' in the ring buffer 'data', wrapping around
+// its end.
+void CopyFromRing(const char* data, uint64_t data_size, uint64_t offset,
+                  void* out, size_t size) {
+  char* dst = static_cast<char*>(out);
+  for (size_t copied = 0; copied < size;) {
+    const uint64_t start = (offset + copied) % data_size;
+    const size_t chunk = static_cast<size_t>(
+        std::min<uint64_t>(size - copied, data_size - start));
+    std::memcpy(dst + copied, data + start, chunk);
+    copied += chunk;
+  }
+}
+#endif
+
+std::string Demangle(const char* name) {
+#if defined(__GNUC__)
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (status == 0 && demangled != nullptr) {
+    std::string result(demangled);
+    std::free(demangled);
+    return result;
+  }
+#endif
+  return name;
+}
+
+// The function 'address' is in, with the offset into it if 'with_offset', or
+// the module and the offset into it if the function has no dynamic symbol,
+// as those of the executable itself only have if it is linked with -rdynamic.
+std::string Symbolize(uint64_t address, bool with_offset) {
+#if defined(BENCHMARK_OS_LINUX)
+  Dl_info info;
+  if (dladdr(reinterpret_cast<void*>(address), &info) != 0) {
+    if (info.dli_sname != nullptr && info.dli_saddr != nullptr) {
+      std::string name = Demangle(info.dli_sname);
+      const uint64_t offset =
+          address - reinterpret_cast<uint64_t>(info.dli_saddr);
+      if (with_offset && offset != 0) {
+        name += StrFormat("+0x%llx", static_cast<unsigned long long>(offset));
+      }
+      return name;
+    }
+    if (info.dli_fname != nullptr && info.dli_fbase != nullptr) {
+      return StrFormat(
+          "%s+0x%llx", info.dli_fname,
+          static_cast<unsigned long long>(
+              address - reinterpret_cast<uint64_t>(info.dli_fbase)));
+    }
+  }
+#endif
+  return StrFormat("0x%llx", static_cast<unsigned long long>(address));
+}
+
+}  // end namespace
+
+bool Profiler::ParseMode(const std::string& name, Mode* mode) {
+  if (name == "perf") {
+    *mode = kInstructions;
+  } else if (name == "lbr") {
+    *mode = kBranches;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+#if defined(BENCHMARK_OS_LINUX)
+std::unique_ptr<Profiler> Profiler::Create(Mode mode, std::string* error) {
+  struct perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_CPU_CYCLES;
+  attr.freq = 1;
+  attr.sample_freq = kSampleFrequency;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  if (mode == kBranches) {
+    attr.sample_type = PERF_SAMPLE_BRANCH_STACK;
+    attr.branch_sample_type = PERF_SAMPLE_BRANCH_USER | PERF_SAMPLE_BRANCH_ANY;
+  } else {
+    attr.sample_type = PERF_SAMPLE_IP;
+  }
+  int fd = OpenSamplingEvent(&attr);
+  if (fd < 0 && mode == kInstructions) {
+    // Without a cycle counter, e.g. in a virtual machine, the samples are
+    // taken on a timer instead.
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_CPU_CLOCK;
+    fd = OpenSamplingEvent(&attr);
+  }
+  if (fd < 0) {
+    *error = StrFormat("could not open a sampling perf event: %s",
+                       strerror(errno));
+    if (mode == kBranches && errno == EOPNOTSUPP) {
+      *error += " (this cpu has no branch record the kernel can read)";
+    }
+    return nullptr;
+  }
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t buffer_size = (1 + kBufferPages) * page_size;
+  void* buffer = mmap(nullptr, buffer_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fd, 0);
+  if (buffer == MAP_FAILED) {
+    *error = StrFormat("could not map the samples of the perf event: %s",
+                       strerror(errno));
+    close(fd);
+    return nullptr;
+  }
+  return std::unique_ptr<Profiler>(new Profiler(mode, fd, buffer, buffer_size));
+}
+
+Profiler::Profiler(Mode mode, int fd, void* buffer, size_t buffer_size)
+    : mode_(mode),
+      fd_(fd),
+      buffer_(buffer),
+      buffer_size_(buffer_size),
+      lost_(0) {}
+
+Profiler::~Profiler() {
+  munmap(buffer_, buffer_size_);
+  close(fd_);
+}
+
+void Profiler::Start() { ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0); }
+
+void Profiler::Stop() {
+  ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+  Drain();
+}
+
+void Profiler::Drain() {
+  struct perf_event_mmap_page* page =
+      static_cast<struct perf_event_mmap_page*>(buffer_);
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  // Kernels before 4.1 don't say where the ring buffer is.
+  const uint64_t data_offset =
+      page->data_offset != 0 ? page->data_offset : page_size;
+  const uint64_t data_size =
+      page->data_size != 0 ? page->data_size : buffer_size_ - page_size;
+  const char* data = static_cast<const char*>(buffer_) + data_offset;
+
+  const uint64_t head = __atomic_load_n(&page->data_head, __ATOMIC_ACQUIRE);
+  uint64_t tail = page->data_tail;
+  std::vector<uint64_t> record;
+  while (tail < head) {
+    struct perf_event_header header;
+    CopyFromRing(data, data_size, tail, &header, sizeof(header));
+    if (header.size < sizeof(header)) break;
+    // The fields of the records we asked for are all 64 bits.
+    record.resize((header.size - sizeof(header)) / sizeof(uint64_t));
+    CopyFromRing(data, data_size, tail + sizeof(header), record.data(),
+                 record.size() * sizeof(uint64_t));
+    tail += header.size;
+    if (header.type == PERF_RECORD_LOST && record.size() >= 2) {
+      lost_ += record[1];
+    } else if (header.type != PERF_RECORD_SAMPLE || record.empty()) {
+      continue;
+    } else if (mode_ == kInstructions) {
+      ++samples_[std::make_pair(record[0], uint64_t{0})];
+    } else {
+      // The number of branches, then (from, to, flags) for each of them.
+      const uint64_t num_branches =
+          std::min<uint64_t>(record[0], (record.size() - 1) / 3);
+      for (uint64_t i = 0; i < num_branches; ++i) {
+        ++samples_[std::make_pair(record[1 + 3 * i], record[2 + 3 * i])];
+      }
+    }
+  }
+  __atomic_store_n(&page->data_tail, tail, __ATOMIC_RELEASE);
+}
+#else
+std::unique_ptr<Profiler> Profiler::Create(Mode, std::string* error) {
+  *error = "profiling is only supported on Linux";
+  return nullptr;
+}
+
+Profiler::Profiler(Mode mode, int fd, void* buffer, size_t buffer_size)
+    : mode_(mode),
+      fd_(fd),
+      buffer_(buffer),
+      buffer_size_(buffer_size),
+      lost_(0) {}
+
+Profiler::~Profiler() {}
+
+void Profiler::Start() {}
+
+void Profiler::Stop() {}
+
+void Profiler::Drain() {}
+#endif
+
+bool WriteProfile(const std::string& name, Profiler::Mode mode,
+                  const std::vector<const Profiler*>& profilers,
+                  const std::string& path) {
+  // Instructions are counted per function, branches per pair of addresses.
+  std::map<std::string, uint64_t> counts;
+  uint64_t total = 0, lost = 0;
+  for (const Profiler* profiler : profilers) {
+    lost += profiler->lost();
+    for (const auto& sample : profiler->samples()) {
+      const std::string key =
+          mode == Profiler::kInstructions
+              ? Symbolize(sample.first.first, false)
+              : Symbolize(sample.first.first, true) + " -> " +
+                    Symbolize(sample.first.second, true);
+      counts[key] += sample.second;
+      total += sample.second;
+    }
+  }
+  std::vector<std::pair<uint64_t, std::string>> sorted;
+  for (const auto& count : counts) {
+    sorted.emplace_back(count.second, count.first);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<uint64_t, std::string>& a,
+               const std::pair<uint64_t, std::string>& b) {
+              return a.first != b.first ? a.first > b.first
+                                        : a.second < b.second;
+            });
+
+  std::ofstream out(path.c_str());
+  if (!out) return false;
+  const char* what = mode == Profiler::kInstructions ? "samples" : "branches";
+  out << "# Profile of " << name << ", sampled at " << kSampleFrequency
+      << " Hz\n";
+  out << "# " << total << " " << what << ", " << lost << " samples lost\n";
+  out << "# " << what << " percent "
+      << (mode == Profiler::kInstructions ? "function" : "branch") << "\n";
+  for (const auto& entry : sorted) {
+    out << StrFormat("%10llu %6.2f%% ",
+                     static_cast<unsigned long long>(entry.first),
+                     100.0 * static_cast<double>(entry.first) /
+                         static_cast<double>(total))
+        << entry.second << "\n";
+  }
+  out.flush();
+  return static_cast<bool>(out);
+}
+
+std::string ProfilePath(const std::string& dir, const std::string& name,
+                        Profiler::Mode mode) {
+  std::string file;
+  for (char c : name) {
+    const bool keep = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                      (c >= '0' && c <= '9') || c == '_' || c == '-' ||
+                      c == '.';
+    file.push_back(keep ? c : '_');
+  }
+  file += mode == Profiler::kInstructions ? ".perf.txt" : ".lbr.txt";
+  return dir.empty() ? file : dir + "/" + file;
+}
+
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,94 @@
+#ifndef BENCHMARK_PROFILER_H_
+#define BENCHMARK_PROFILER_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+namespace internal {
+
+// Samples where the thread that opened it spends its time while started, with
+// a sampling perf event whose samples the kernel writes into a ring buffer we
+// map. Only the user-space code of the thread is sampled.
+class Profiler {
+ public:
+  enum Mode {
+    // The address of the instruction each sample interrupted.
+    kInstructions,
+    // The last branches the core took before each sample, from its branch
+    // record (LBR on x86).
+    kBranches
+  };
+
+  // Parse a --benchmark_profile: "perf" or "lbr". Anything else, including
+  // "pt", the Intel Processor Traces that we can't decode, is rejected.
+  static bool ParseMode(const std::string& name, Mode* mode);
+
+  // A profiler of the calling thread, stopped, or nullptr if the kernel does
+  // not let us open one, with the reason in 'error'.
+  static std::unique_ptr<Profiler> Create(Mode mode, std::string* error);
+
+  ~Profiler();
+
+  void Start();
+
+  // Stop sampling, and take in the samples taken since Start().
+  void Stop();
+
+  // Forget the samples taken in so far.
+  void Clear() {
+    samples_.clear();
+    lost_ = 0;
+  }
+
+  // The number of samples of each address, keyed by (address, 0), or of each
+  // branch, keyed by (from, to).
+  typedef std::map<std::pair<uint64_t, uint64_t>, uint64_t> Samples;
+  const Samples& samples() const { return samples_; }
+
+  // The samples that the kernel dropped, as the ring buffer was full.
+  uint64_t lost() const { return lost_; }
+
+  Mode mode() const { return mode_; }
+
+ private:
+  Profiler(Mode mode, int fd, void* buffer, size_t buffer_size);
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(Profiler);
+
+  // Take in the records in the ring buffer, and free their space.
+  void Drain();
+
+  const Mode mode_;
+  const int fd_;
+  // The metadata page, followed by the ring buffer, which is a power of two
+  // pages.
+  void* const buffer_;
+  const size_t buffer_size_;
+  Samples samples_;
+  uint64_t lost_;
+};
+
+// Write the samples of 'profilers', which were all opened in 'mode', to
+// 'path' as a flat profile of 'name': the functions in which the samples
+// fell, or the branches taken, most frequent first. Returns false if the file
+// could not be written.
+bool WriteProfile(const std::string& name, Profiler::Mode mode,
+                  const std::vector<const Profiler*>& profilers,
+                  const std::string& path);
+
+// The file in 'dir' that the profile of the benchmark named 'name' is written
+// to.
+std::string ProfilePath(const std::string& dir, const std::string& name,
+                        Profiler::Mode mode);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_PROFILER_H_
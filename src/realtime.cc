@@ -0,0 +1,69 @@
+#include "realtime.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include "internal_macros.h"
+
+#ifdef BENCHMARK_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+namespace benchmark {
+namespace internal {
+
+#ifdef BENCHMARK_OS_LINUX
+bool SetCurrentThreadRealtime(int priority, ThreadScheduling* previous,
+                              std::string* error) {
+  struct sched_param param;
+  int policy;
+  if (previous != nullptr) {
+    if (pthread_getschedparam(pthread_self(), &policy, &param) != 0) {
+      if (error != nullptr) *error = "could not get the scheduling policy";
+      return false;
+    }
+    previous->policy = policy;
+    previous->priority = param.sched_priority;
+  }
+  std::memset(&param, 0, sizeof(param));
+  param.sched_priority = priority;
+  const int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (result != 0) {
+    if (error != nullptr) *error = strerror(result);
+    return false;
+  }
+  return true;
+}
+
+void RestoreCurrentThreadScheduling(const ThreadScheduling& previous) {
+  struct sched_param param;
+  std::memset(&param, 0, sizeof(param));
+  param.sched_priority = previous.priority;
+  pthread_setschedparam(pthread_self(), previous.policy, &param);
+}
+
+bool LockProcessMemory(std::string* error) {
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    if (error != nullptr) *error = strerror(errno);
+    return false;
+  }
+  return true;
+}
+#else
+bool SetCurrentThreadRealtime(int, ThreadScheduling*, std::string* error) {
+  if (error != nullptr) *error = "only supported on Linux";
+  return false;
+}
+
+void RestoreCurrentThreadScheduling(const ThreadScheduling&) {}
+
+bool LockProcessMemory(std::string* error) {
+  if (error != nullptr) *error = "only supported on Linux";
+  return false;
+}
+#endif
+
+}  // namespace internal
+}  // namespace benchmark
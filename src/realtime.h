@@ -0,0 +1,35 @@
+#ifndef BENCHMARK_REALTIME_H_
+#define BENCHMARK_REALTIME_H_
+
+#include <string>
+
+namespace benchmark {
+namespace internal {
+
+// How a thread was scheduled, to put it back with
+// RestoreCurrentThreadScheduling().
+struct ThreadScheduling {
+  int policy;
+  int priority;
+};
+
+// Run the calling thread under SCHED_FIFO at 'priority', from 1 to 99, so that
+// it is only preempted by threads of a higher real-time priority, saving how
+// it was scheduled before in 'previous' if non-null. Returns false, with the
+// reason in 'error' if non-null, if this is not allowed, which it is not
+// without CAP_SYS_NICE or an RLIMIT_RTPRIO of at least 'priority'.
+bool SetCurrentThreadRealtime(int priority, ThreadScheduling* previous,
+                              std::string* error);
+
+void RestoreCurrentThreadScheduling(const ThreadScheduling& previous);
+
+// Lock the pages the process has mapped, and those it will map, in memory, so
+// that the runs don't fault them in. Returns false, with the reason in 'error'
+// if non-null, if this is not allowed, which it is not without CAP_IPC_LOCK
+// or a large enough RLIMIT_MEMLOCK. The locks are not inherited by fork().
+bool LockProcessMemory(std::string* error);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_REALTIME_H_
@@ -0,0 +1,89 @@
+#include "region.h"
+
+#include <cstring>
+
+#include "check.h"
+#include "cycleclock.h"
+#include "thread_manager.h"
+#include "timers.h"
+
+namespace benchmark {
+
+Region::Region(State& state, const char* name)
+    : profile_(&state.manager_->GetThreadRegions(state.thread_index_)),
+      perf_counters_(state.perf_counters_measurement_) {
+  profile_->Enter(name, perf_counters_);
+}
+
+Region::~Region() { profile_->Leave(perf_counters_); }
+
+namespace internal {
+
+int RegionProfile::FindEntry(const char* name, int parent) {
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const Entry& e = entries_[i];
+    if (e.parent == parent &&
+        (e.name == name || std::strcmp(e.name, name) == 0)) {
+      return static_cast<int>(i);
+    }
+  }
+  BM_CHECK(*name != '\0' && std::strpbrk(name, "/;") == nullptr)
+      << "Region names can't be empty, nor contain '/' or ';': " << name;
+  std::string path =
+      parent < 0 ? std::string(name)
+                 : entries_[static_cast<size_t>(parent)].path + ";" + name;
+  entries_.emplace_back(name, parent, std::move(path));
+  return static_cast<int>(entries_.size() - 1);
+}
+
+void RegionProfile::Enter(const char* name,
+                          PerfCountersMeasurement* perf_counters) {
+  const int parent = open_.empty() ? -1 : open_.back().entry;
+  open_.emplace_back(FindEntry(name, parent),
+                     perf_counters != nullptr ? perf_counters->names().size()
+                                              : 0);
+  OpenRegion& region = open_.back();
+  // The counters start before the clock, and stop after it, so that reading
+  // them isn't counted as cycles of the region.
+  if (perf_counters != nullptr) {
+    region.has_perf_counts =
+        perf_counters->Snapshot(&region.start_perf_counts);
+  }
+  region.start_cycles = cycleclock::Now();
+}
+
+void RegionProfile::Leave(PerfCountersMeasurement* perf_counters) {
+  const int64_t end_cycles = cycleclock::Now();
+  BM_CHECK(!open_.empty());
+  OpenRegion& region = open_.back();
+  Entry& e = entries_[static_cast<size_t>(region.entry)];
+  e.cycles += end_cycles - region.start_cycles;
+  if (region.has_perf_counts) {
+    PerfCounterValues end_perf_counts(perf_counters->names().size());
+    if (perf_counters->Snapshot(&end_perf_counts)) {
+      perf_counters->AddInterval(region.start_perf_counts, end_perf_counts,
+                                 e.perf_counts.data(), nullptr, nullptr);
+    }
+  }
+  open_.pop_back();
+}
+
+void RegionProfile::AddCounters(const PerfCountersMeasurement* perf_counters,
+                                UserCounters* counters) const {
+  if (entries_.empty()) return;
+  const double ticks_per_second = CycleClockTicksPerSecond();
+  for (const Entry& e : entries_) {
+    const std::string name = "region/" + e.path;
+    (*counters)[name] =
+        Counter(static_cast<double>(e.cycles) / ticks_per_second,
+                Counter::kAvgIterations);
+    if (perf_counters == nullptr) continue;
+    for (size_t i = 0; i < perf_counters->names().size(); ++i) {
+      (*counters)[name + "/" + perf_counters->names()[i]] =
+          Counter(e.perf_counts[i], Counter::kAvgIterations);
+    }
+  }
+}
+
+}  // end namespace internal
+}  // end namespace benchmark
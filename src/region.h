@@ -0,0 +1,73 @@
+#ifndef BENCHMARK_REGION_H_
+#define BENCHMARK_REGION_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "perf_counters.h"
+
+namespace benchmark {
+namespace internal {
+
+// The cycles, and the perf counts, spent in the Regions of one thread, by
+// where they are nested. Only that thread uses it.
+class RegionProfile {
+ public:
+  // Enter the region 'name', nested in the one entered last and not left
+  // yet, if any. 'perf_counters', if not null, are those of the thread.
+  void Enter(const char* name, PerfCountersMeasurement* perf_counters);
+
+  // Leave the region entered last.
+  void Leave(PerfCountersMeasurement* perf_counters);
+
+  // Add the seconds spent in each of the regions, and their perf counts, to
+  // 'counters', to be averaged over the iterations.
+  void AddCounters(const PerfCountersMeasurement* perf_counters,
+                   UserCounters* counters) const;
+
+ private:
+  struct Entry {
+    Entry(const char* n, int p, std::string&& full_path)
+        : name(n), parent(p), path(std::move(full_path)), cycles(0) {
+      perf_counts.fill(0);
+    }
+
+    // As passed to Enter() first, which is usually the same literal every
+    // time, so that it is found without comparing the strings.
+    const char* name;
+    // The entry of the region it is nested in, or -1.
+    int parent;
+    // The names of the regions it is nested in and its own, separated by ';'.
+    std::string path;
+    int64_t cycles;
+    std::array<double, PerfCounterValues::kMaxCounters> perf_counts;
+  };
+
+  struct OpenRegion {
+    OpenRegion(int e, size_t num_counters)
+        : entry(e),
+          start_cycles(0),
+          has_perf_counts(false),
+          start_perf_counts(num_counters) {}
+
+    int entry;
+    int64_t start_cycles;
+    bool has_perf_counts;
+    PerfCounterValues start_perf_counts;
+  };
+
+  int FindEntry(const char* name, int parent);
+
+  std::vector<Entry> entries_;
+  // The regions entered and not left yet, innermost last.
+  std::vector<OpenRegion> open_;
+};
+
+}  // end namespace internal
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_REGION_H_
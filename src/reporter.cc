@@ -36,6 +36,10 @@ BenchmarkReporter::BenchmarkReporter()
 
 BenchmarkReporter::~BenchmarkReporter() {}
 
+void BenchmarkReporter::ReportRepetition(const Run &run) {
+  ReportRuns(std::vector<Run>(1, run));
+}
+
 void BenchmarkReporter::PrintBasicContext(std::ostream *out,
                                           Context const &context) {
   BM_CHECK(out) << "cannot be null";
@@ -91,7 +95,10 @@ void BenchmarkReporter::PrintBasicContext(std::ostream *out,
 const char *BenchmarkReporter::Context::executable_name;
 
 BenchmarkReporter::Context::Context()
-    : cpu_info(CPUInfo::Get()), sys_info(SystemInfo::Get()) {}
+    : cpu_info(CPUInfo::Get()),
+      sys_info(SystemInfo::Get()),
+      name_field_width(0),
+      num_repetitions(0) {}
 
 std::string BenchmarkReporter::Run::benchmark_name() const {
   std::string name = run_name.str();
@@ -113,4 +120,21 @@ double BenchmarkReporter::Run::GetAdjustedCPUTime() const {
   return new_time;
 }
 
+double BenchmarkReporter::RoleRun::GetAdjustedRealTime(TimeUnit unit) const {
+  double new_time = real_accumulated_time * GetTimeUnitMultiplier(unit);
+  if (iterations != 0) new_time /= static_cast<double>(iterations);
+  return new_time;
+}
+
+double BenchmarkReporter::RoleRun::GetAdjustedCPUTime(TimeUnit unit) const {
+  double new_time = cpu_accumulated_time * GetTimeUnitMultiplier(unit);
+  if (iterations != 0) new_time /= static_cast<double>(iterations);
+  return new_time;
+}
+
+double BenchmarkReporter::Run::MemoryPerIteration(int64_t total) const {
+  if (memory_iterations == 0) return 0.0;
+  return static_cast<double>(total) / static_cast<double>(memory_iterations);
+}
+
 }  // end namespace benchmark
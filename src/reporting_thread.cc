@@ -0,0 +1,117 @@
+#include "reporting_thread.h"
+
+#include <cstring>
+#include <utility>
+
+#include "check.h"
+#include "cpu_affinity.h"
+#include "internal_macros.h"
+
+#ifdef BENCHMARK_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+// Only run the calling thread when no other thread wants the cpu, if
+// supported, which needs no privilege.
+void SetCurrentThreadIdle() {
+#if defined(BENCHMARK_OS_LINUX) && defined(SCHED_IDLE)
+  struct sched_param param;
+  std::memset(&param, 0, sizeof(param));
+  pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+}
+
+}  // end namespace
+
+ReportingThread::ReportingThread(const ReportFn& report, size_t capacity,
+                                 const std::vector<int>& cpus)
+    : report_(report),
+      items_(capacity),
+      head_(0),
+      size_(0),
+      reporting_(false),
+      stopping_(false) {
+  BM_CHECK(capacity > 0);
+  thread_ = std::thread(&ReportingThread::Run, this, cpus);
+}
+
+ReportingThread::~ReportingThread() {
+  {
+    MutexLock l(mutex_);
+    stopping_ = true;
+  }
+  not_empty_.notify_one();
+  thread_.join();
+}
+
+void ReportingThread::PostRepetition(const RunResults& results,
+                                     const BenchmarkReporter::Run& run) {
+  Item item;
+  item.results.display_report_aggregates_only =
+      results.display_report_aggregates_only;
+  item.results.file_report_aggregates_only =
+      results.file_report_aggregates_only;
+  item.results.non_aggregates.push_back(run);
+  item.repetition = true;
+  Post(std::move(item));
+}
+
+void ReportingThread::PostResults(const RunResults& results) {
+  Item item;
+  item.results = results;
+  Post(std::move(item));
+}
+
+void ReportingThread::Post(Item item) {
+  {
+    MutexLock l(mutex_);
+    not_full_.wait(l.native_handle(),
+                   [this]() { return size_ < items_.size(); });
+    items_[(head_ + size_) % items_.size()] = std::move(item);
+    ++size_;
+  }
+  not_empty_.notify_one();
+}
+
+void ReportingThread::WaitForIdle() {
+  MutexLock l(mutex_);
+  idle_.wait(l.native_handle(),
+             [this]() { return size_ == 0 && !reporting_; });
+}
+
+void ReportingThread::Run(const std::vector<int>& cpus) {
+  if (!cpus.empty()) SetCurrentThreadAffinity(cpus, nullptr);
+  SetCurrentThreadIdle();
+  for (;;) {
+    Item item;
+    {
+      MutexLock l(mutex_);
+      not_empty_.wait(l.native_handle(),
+                      [this]() { return size_ > 0 || stopping_; });
+      if (size_ == 0) return;
+      item = std::move(items_[head_]);
+      head_ = (head_ + 1) % items_.size();
+      --size_;
+      reporting_ = true;
+    }
+    not_full_.notify_one();
+    report_(item.results,
+            item.repetition ? &item.results.non_aggregates.back() : nullptr);
+    bool idle;
+    {
+      MutexLock l(mutex_);
+      reporting_ = false;
+      idle = size_ == 0;
+    }
+    if (idle) idle_.notify_all();
+  }
+}
+
+}  // end namespace internal
+}  // end namespace benchmark
@@ -0,0 +1,80 @@
+#ifndef BENCHMARK_REPORTING_THREAD_H_
+#define BENCHMARK_REPORTING_THREAD_H_
+
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "benchmark_runner.h"
+#include "mutex.h"
+
+namespace benchmark {
+namespace internal {
+
+// Reports the results on a thread of its own, with
+// --benchmark_background_reporting, so that formatting and writing them out
+// doesn't delay the next repetition, nor take its cpu. The thread that runs
+// the benchmarks hands them over through a queue of a fixed capacity, and
+// they are reported one at a time, in the order they were posted.
+class ReportingThread {
+ public:
+  // Reports one of the repetitions of 'results' if 'repetition' is non-null,
+  // and else all of 'results'.
+  typedef std::function<void(const RunResults& results,
+                             const BenchmarkReporter::Run* repetition)>
+      ReportFn;
+
+  // Calls 'report' for each of the results posted, at the lowest scheduling
+  // priority and restricted to 'cpus', if not empty. Post() waits while
+  // 'capacity' results are waiting to be reported.
+  ReportingThread(const ReportFn& report, size_t capacity,
+                  const std::vector<int>& cpus);
+
+  // Reports what was posted and not reported yet, and joins the thread.
+  ~ReportingThread();
+
+  // Hand over the repetition 'run' of 'results', of which only the options
+  // that tell where it is reported are copied.
+  void PostRepetition(const RunResults& results,
+                      const BenchmarkReporter::Run& run);
+
+  // Hand over all of 'results'.
+  void PostResults(const RunResults& results);
+
+  // Wait until everything that was posted is reported.
+  void WaitForIdle();
+
+ private:
+  struct Item {
+    Item() : repetition(false) {}
+    RunResults results;
+    bool repetition;
+  };
+
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(ReportingThread);
+
+  void Post(Item item);
+  void Run(const std::vector<int>& cpus);
+
+  const ReportFn report_;
+  Mutex mutex_;
+  Condition not_empty_;
+  Condition not_full_;
+  Condition idle_;
+  // All guarded by 'mutex_'. A ring of the items posted and not reported
+  // yet, the first at 'head_'.
+  std::vector<Item> items_;
+  size_t head_;
+  size_t size_;
+  // Whether the item taken last from the ring is being reported.
+  bool reporting_;
+  bool stopping_;
+  std::thread thread_;
+};
+
+}  // end namespace internal
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_REPORTING_THREAD_H_
@@ -0,0 +1,269 @@
+#include "result_cache.h"
+
+#include "internal_macros.h"
+
+#ifdef BENCHMARK_OS_WINDOWS
+#include <direct.h>
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+#ifdef BENCHMARK_OS_MACOSX
+#include <mach-o/dyld.h>
+#endif
+
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/marshalling.h"
+#include "run_serialization.h"
+#include "string_util.h"
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+// Written first in each file, to tell the files of another version apart.
+const char kCacheFileVersion[] = "benchmark result cache 20";
+
+bool ReadFile(const std::string& path, std::string* contents) {
+  std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+  if (!file.is_open()) return false;
+  contents->assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+  return !file.bad();
+}
+
+std::string ExecutablePath() {
+#if defined(BENCHMARK_OS_LINUX) || defined(BENCHMARK_OS_CYGWIN)
+  return "/proc/self/exe";
+#elif defined(BENCHMARK_OS_MACOSX)
+  char path[4096];
+  uint32_t size = sizeof(path);
+  if (_NSGetExecutablePath(path, &size) != 0) return "";
+  return path;
+#elif defined(BENCHMARK_OS_WINDOWS)
+  char path[MAX_PATH];
+  const DWORD size = GetModuleFileNameA(nullptr, path, MAX_PATH);
+  if (size == 0 || size == MAX_PATH) return "";
+  return std::string(path, size);
+#else
+  return "";
+#endif
+}
+
+void AppendRuns(BinaryWriter* writer,
+                const std::vector<BenchmarkReporter::Run>& runs) {
+  writer->Write(static_cast<uint64_t>(runs.size()));
+  for (const BenchmarkReporter::Run& run : runs) writer->WriteRun(run);
+}
+
+bool ReadRuns(BinaryReader* reader,
+              std::vector<BenchmarkReporter::Run>* runs) {
+  uint64_t num_runs;
+  if (!reader->Read(&num_runs)) return false;
+  runs->clear();
+  for (uint64_t i = 0; i < num_runs; ++i) {
+    BenchmarkReporter::Run run;
+    if (!reader->ReadRun(&run)) return false;
+    runs->push_back(run);
+  }
+  return true;
+}
+
+}  // end namespace
+
+ResultCache::ResultCache(const std::string& dir,
+                         const std::string& fingerprint)
+    : dir_(dir), fingerprint_(fingerprint) {
+  // Only the directory itself is made, if it doesn't exist yet.
+#ifdef BENCHMARK_OS_WINDOWS
+  _mkdir(dir_.c_str());
+#else
+  mkdir(dir_.c_str(), 0777);
+#endif
+}
+
+bool ResultCache::IsCacheable(const BenchmarkInstance& instance) const {
+  return instance.complexity() == oNone &&
+         instance.complexity_terms().empty() && !instance.thread_scaling() &&
+         instance.matrix_counter().empty() && instance.ab_role() == kNotAB &&
+         !instance.tuned() &&
+         !(instance.cache_fingerprint().empty() && fingerprint_.empty());
+}
+
+std::string ResultCache::Key(const BenchmarkInstance& instance) const {
+  return RunKey(instance, fingerprint_);
+}
+
+std::string RunKey(const BenchmarkInstance& instance,
+                   const std::string& fingerprint) {
+  std::string key = "name=" + instance.name().str() + "\n";
+  key += "fingerprint=" + (instance.cache_fingerprint().empty()
+                               ? fingerprint
+                               : instance.cache_fingerprint()) +
+         "\n";
+  auto add_flag = [&key](const char* name, const std::string& value) {
+    key += name;
+    key += "=" + value + "\n";
+  };
+  add_flag("min_time",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_min_time)));
+  add_flag("min_warmup_time",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_min_warmup_time)));
+  add_flag("target_cv",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_target_cv)));
+  add_flag("repetitions",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_repetitions)));
+  add_flag("report_aggregates_only",
+           absl::UnparseFlag(
+               absl::GetFlag(FLAGS_benchmark_report_aggregates_only)));
+  add_flag("display_aggregates_only",
+           absl::UnparseFlag(
+               absl::GetFlag(FLAGS_benchmark_display_aggregates_only)));
+  add_flag("outlier_rejection",
+           absl::GetFlag(FLAGS_benchmark_outlier_rejection));
+  add_flag("perf_counters",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_perf_counters)));
+  add_flag("perf_metrics",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_perf_metrics)));
+  add_flag("perf_counters_per_thread",
+           absl::UnparseFlag(
+               absl::GetFlag(FLAGS_benchmark_perf_counters_per_thread)));
+  add_flag("thread_breakdown",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_thread_breakdown)));
+  add_flag("realtime_priority",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_realtime_priority)));
+  add_flag("lock_memory",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_lock_memory)));
+  add_flag("parallel_jobs",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_parallel_jobs)));
+  add_flag("cpu_affinity", absl::GetFlag(FLAGS_benchmark_cpu_affinity));
+  add_flag("isolation", absl::GetFlag(FLAGS_benchmark_isolation));
+  add_flag("report_cpu_frequency",
+           absl::UnparseFlag(
+               absl::GetFlag(FLAGS_benchmark_report_cpu_frequency)));
+  add_flag("max_cpu_frequency_drop",
+           absl::UnparseFlag(
+               absl::GetFlag(FLAGS_benchmark_max_cpu_frequency_drop)));
+  add_flag("noise_stats",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_noise_stats)));
+  add_flag("noise_thresholds",
+           absl::GetFlag(FLAGS_benchmark_noise_thresholds));
+  add_flag("noise_max_reruns",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_noise_max_reruns)));
+  add_flag("normalize_time", absl::GetFlag(FLAGS_benchmark_normalize_time));
+  add_flag("process_memory",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_process_memory)));
+  add_flag("calibrate",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_calibrate)));
+  add_flag("energy", absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_energy)));
+  add_flag("check_measurements",
+           absl::UnparseFlag(
+               absl::GetFlag(FLAGS_benchmark_check_measurements)));
+  add_flag("harness_stats",
+           absl::UnparseFlag(absl::GetFlag(FLAGS_benchmark_harness_stats)));
+  add_flag("interference_file",
+           absl::GetFlag(FLAGS_benchmark_interference_file));
+  add_flag("calibration_interval",
+           absl::UnparseFlag(
+               absl::GetFlag(FLAGS_benchmark_calibration_interval)));
+  add_flag("iterations_hint_file",
+           absl::GetFlag(FLAGS_benchmark_iterations_hint_file));
+  return key;
+}
+
+std::string ResultCache::Path(const std::string& key) const {
+  return dir_ + "/" +
+         StrFormat("%016" PRIx64, Fnv1aHash(key.data(), key.size())) + ".run";
+}
+
+bool ResultCache::Load(const BenchmarkInstance& instance,
+                       RunResults* results) const {
+  if (!IsCacheable(instance)) return false;
+  const std::string key = Key(instance);
+  std::string contents;
+  if (!ReadFile(Path(key), &contents)) return false;
+
+  // The key is kept in the file too, in case another key has the same hash.
+  BinaryReader reader(contents.data(), contents.size());
+  std::string version, file_key;
+  RunResults cached;
+  if (!reader.ReadString(&version) || version != kCacheFileVersion ||
+      !reader.ReadString(&file_key) || file_key != key ||
+      !reader.Read(&cached.display_report_aggregates_only) ||
+      !reader.Read(&cached.file_report_aggregates_only) ||
+      !ReadRuns(&reader, &cached.non_aggregates) ||
+      !ReadRuns(&reader, &cached.aggregates_only) || !reader.AtEnd()) {
+    return false;
+  }
+
+  // The indices depend on which benchmarks the filter selected this time, and
+  // the tags may have changed since.
+  for (std::vector<BenchmarkReporter::Run>* runs :
+       {&cached.non_aggregates, &cached.aggregates_only}) {
+    for (BenchmarkReporter::Run& run : *runs) {
+      run.family_index = instance.family_index();
+      run.per_family_instance_index = instance.per_family_instance_index();
+      run.tags = instance.tags();
+      run.cached = true;
+    }
+  }
+  *results = std::move(cached);
+  return true;
+}
+
+bool ResultCache::Store(const BenchmarkInstance& instance,
+                        const RunResults& results) const {
+  if (!IsCacheable(instance)) return true;
+  for (const BenchmarkReporter::Run& run : results.non_aggregates) {
+    if (run.error_occurred) return true;
+  }
+
+  const std::string key = Key(instance);
+  std::string contents;
+  BinaryWriter writer(&contents);
+  writer.WriteString(kCacheFileVersion);
+  writer.WriteString(key);
+  writer.Write(results.display_report_aggregates_only);
+  writer.Write(results.file_report_aggregates_only);
+  AppendRuns(&writer, results.non_aggregates);
+  AppendRuns(&writer, results.aggregates_only);
+
+  // Write a temporary file and rename it, so that a run that is interrupted,
+  // or another one sharing the cache, never reads a partial file.
+  const std::string path = Path(key);
+  const std::string temp_path = path + ".tmp";
+  {
+    std::ofstream file(temp_path.c_str(),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    if (!file) return false;
+  }
+#ifdef BENCHMARK_OS_WINDOWS
+  // rename() doesn't replace an existing file there.
+  std::remove(path.c_str());
+#endif
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::string ExecutableFingerprint() {
+  const std::string path = ExecutablePath();
+  std::string contents;
+  if (path.empty() || !ReadFile(path, &contents)) return "";
+  return StrFormat("%016" PRIx64, Fnv1aHash(contents.data(), contents.size()));
+}
+
+}  // end namespace internal
+}  // end namespace benchmark
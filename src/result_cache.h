@@ -0,0 +1,59 @@
+#ifndef BENCHMARK_RESULT_CACHE_H_
+#define BENCHMARK_RESULT_CACHE_H_
+
+#include <string>
+
+#include "benchmark_api_internal.h"
+#include "benchmark_runner.h"
+
+namespace benchmark {
+namespace internal {
+
+// Keeps the results of the benchmarks in the files of a directory, one per
+// instance, to report them again rather than rerun the instances, as long as
+// they would run the same code with the same flags.
+class ResultCache {
+ public:
+  // 'fingerprint' identifies the code of the instances that don't have a
+  // fingerprint of their own. If it is empty, those are not cached.
+  ResultCache(const std::string& dir, const std::string& fingerprint);
+
+  // Whether the results of 'instance' can be cached. The instances of the
+  // families that are aggregated over all of them, as for complexity, thread
+  // scaling or A/B pairs, are always run, and so are the ones without a
+  // fingerprint.
+  bool IsCacheable(const BenchmarkInstance& instance) const;
+
+  // What the cached results of 'instance' depend on: its name, the
+  // fingerprint of its code and the flags that affect how it runs.
+  std::string Key(const BenchmarkInstance& instance) const;
+
+  // Read the cached results of 'instance', marked as cached. Return false if
+  // there are none.
+  bool Load(const BenchmarkInstance& instance, RunResults* results) const;
+
+  // Cache the results of 'instance', unless some of its repetitions failed.
+  // Return false if they can't be written.
+  bool Store(const BenchmarkInstance& instance,
+             const RunResults& results) const;
+
+ private:
+  std::string Path(const std::string& key) const;
+
+  const std::string dir_;
+  const std::string fingerprint_;
+};
+
+// What the results of 'instance' depend on: its name, its CacheFingerprint(),
+// or else 'fingerprint', and the flags that affect how it runs.
+std::string RunKey(const BenchmarkInstance& instance,
+                   const std::string& fingerprint);
+
+// A fingerprint of the code of the running executable: a hash of its file, or
+// an empty string if it can't be read.
+std::string ExecutableFingerprint();
+
+}  // end namespace internal
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_RESULT_CACHE_H_
@@ -0,0 +1,313 @@
+#include "results_reader.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+// Just enough of a JSON parser to read the scalar members of the objects in
+// the "benchmarks" array of the JSON reporter's output.
+class JsonReader {
+ public:
+  explicit JsonReader(const std::string& text)
+      : pos_(text.data()), end_(text.data() + text.size()) {}
+
+  // Append the string and number members of each benchmark to 'runs'.
+  bool ReadBenchmarks(std::vector<PreviousRun>* runs) {
+    if (!Consume('{')) return false;
+    if (Consume('}')) return true;
+    do {
+      std::string key;
+      if (!ReadString(&key) || !Consume(':')) return false;
+      if (key != "benchmarks") {
+        if (!SkipValue()) return false;
+        continue;
+      }
+      if (!Consume('[')) return false;
+      if (Consume(']')) continue;
+      do {
+        PreviousRun run;
+        if (!ReadScalarMembers(&run.strings, &run.numbers)) return false;
+        runs->push_back(run);
+      } while (Consume(','));
+      if (!Consume(']')) return false;
+    } while (Consume(','));
+    return Consume('}');
+  }
+
+ private:
+  void SkipSpace() {
+    while (pos_ != end_ && (*pos_ == ' ' || *pos_ == '\n' || *pos_ == '\t' ||
+                            *pos_ == '\r')) {
+      ++pos_;
+    }
+  }
+
+  bool Consume(char c) {
+    SkipSpace();
+    if (pos_ == end_ || *pos_ != c) return false;
+    ++pos_;
+    return true;
+  }
+
+  bool ReadString(std::string* s) {
+    if (!Consume('"')) return false;
+    s->clear();
+    while (pos_ != end_ && *pos_ != '"') {
+      if (*pos_ == '\\') {
+        if (++pos_ == end_) return false;
+        // The names don't have \u escapes; keep what follows as is.
+        switch (*pos_) {
+          case 'n':
+            s->push_back('\n');
+            break;
+          case 't':
+            s->push_back('\t');
+            break;
+          default:
+            s->push_back(*pos_);
+        }
+      } else {
+        s->push_back(*pos_);
+      }
+      ++pos_;
+    }
+    return Consume('"');
+  }
+
+  bool ReadNumber(double* value) {
+    SkipSpace();
+    const char* start = pos_;
+    while (pos_ != end_ && *pos_ != '\0' &&
+           std::strchr("+-.eE0123456789", *pos_) != nullptr) {
+      ++pos_;
+    }
+    if (pos_ == start) return false;
+    *value = std::strtod(std::string(start, pos_).c_str(), nullptr);
+    return true;
+  }
+
+  bool SkipValue() {
+    SkipSpace();
+    if (pos_ == end_) return false;
+    std::string s;
+    double d;
+    switch (*pos_) {
+      case '"':
+        return ReadString(&s);
+      case '{':
+      case '[': {
+        const char close = *pos_ == '{' ? '}' : ']';
+        ++pos_;
+        if (Consume(close)) return true;
+        do {
+          if (close == '}' && (!ReadString(&s) || !Consume(':'))) return false;
+          if (!SkipValue()) return false;
+        } while (Consume(','));
+        return Consume(close);
+      }
+      default:
+        if (ReadNumber(&d)) return true;
+        while (pos_ != end_ && std::isalpha(static_cast<unsigned char>(*pos_)))
+          ++pos_;
+        return true;
+    }
+  }
+
+  bool ReadScalarMembers(std::map<std::string, std::string>* strings,
+                         std::map<std::string, double>* numbers) {
+    if (!Consume('{')) return false;
+    if (Consume('}')) return true;
+    do {
+      std::string key;
+      if (!ReadString(&key) || !Consume(':')) return false;
+      SkipSpace();
+      if (pos_ != end_ && *pos_ == '"') {
+        if (!ReadString(&(*strings)[key])) return false;
+      } else if (pos_ != end_ &&
+                 (*pos_ == '-' || std::isdigit(static_cast<unsigned char>(
+                                      *pos_)))) {
+        if (!ReadNumber(&(*numbers)[key])) return false;
+      } else if (pos_ != end_ && (*pos_ == 't' || *pos_ == 'f')) {
+        // The booleans are read as 1 and 0, as the binary reporter writes
+        // them.
+        (*numbers)[key] = *pos_ == 't' ? 1 : 0;
+        if (!SkipValue()) return false;
+      } else if (!SkipValue()) {
+        return false;
+      }
+    } while (Consume(','));
+    return Consume('}');
+  }
+
+  const char* pos_;
+  const char* end_;
+};
+
+// Reads the output of the binary reporter, laid out as described in
+// binary_reporter.cc, in either byte order.
+class BinaryResultsReader {
+ public:
+  explicit BinaryResultsReader(const std::string& data)
+      : data_(data), swap_(false) {}
+
+  static bool IsBinary(const std::string& data) {
+    return data.compare(0, sizeof(kMagic), kMagic, sizeof(kMagic)) == 0;
+  }
+
+  bool ReadRuns(std::vector<PreviousRun>* runs) {
+    uint32_t byte_order_mark;
+    if (data_.size() < kHeaderSize) return false;
+    std::memcpy(&byte_order_mark, data_.data() + 12, sizeof(byte_order_mark));
+    if (byte_order_mark != 0x01020304) {
+      if (byte_order_mark != 0x04030201) return false;
+      swap_ = true;
+    }
+    const uint64_t num_runs = U64(16), num_columns = U64(24),
+                   num_strings = U64(32), num_counters = U64(40),
+                   num_context = U64(48);
+
+    // Check the sizes before computing with them, so that nothing overflows.
+    const uint64_t max_entries = data_.size() / 8;
+    if (num_runs > max_entries || num_columns > max_entries ||
+        num_strings > max_entries || num_counters > max_entries ||
+        num_context > max_entries ||
+        (num_columns != 0 && num_runs > max_entries / num_columns)) {
+      return false;
+    }
+    const uint64_t columns_offset = kHeaderSize;
+    const uint64_t data_offset = columns_offset + num_columns * 16;
+    const uint64_t counter_index_offset =
+        data_offset + num_columns * num_runs * 8;
+    const uint64_t counters_offset = counter_index_offset + (num_runs + 1) * 8;
+    const uint64_t context_offset = counters_offset + num_counters * 16;
+    const uint64_t string_index_offset = context_offset + num_context * 16;
+    const uint64_t strings_offset = string_index_offset + (num_strings + 1) * 8;
+    if (strings_offset > data_.size()) return false;
+
+    std::vector<std::string> strings;
+    for (uint64_t i = 0; i < num_strings; ++i) {
+      const uint64_t begin = U64(string_index_offset + i * 8);
+      const uint64_t end = U64(string_index_offset + (i + 1) * 8);
+      if (begin > end || strings_offset + end > data_.size()) return false;
+      strings.push_back(data_.substr(strings_offset + begin, end - begin));
+    }
+    auto string_at = [&strings](uint64_t id, std::string* s) {
+      if (id >= strings.size()) return false;
+      *s = strings[id];
+      return true;
+    };
+
+    runs->resize(runs->size() + num_runs);
+    PreviousRun* first_run = &(*runs)[runs->size() - num_runs];
+    for (uint64_t c = 0; c < num_columns; ++c) {
+      std::string name;
+      if (!string_at(U64(columns_offset + c * 16), &name)) return false;
+      const uint64_t type = U64(columns_offset + c * 16 + 8);
+      for (uint64_t r = 0; r < num_runs; ++r) {
+        const uint64_t value = U64(data_offset + (c * num_runs + r) * 8);
+        PreviousRun& run = first_run[r];
+        switch (type) {
+          case 0:
+            run.numbers[name] =
+                static_cast<double>(static_cast<int64_t>(value));
+            break;
+          case 1:
+            run.numbers[name] = Double(value);
+            break;
+          case 2:
+            if (!string_at(value, &run.strings[name])) return false;
+            break;
+          default:
+            return false;
+        }
+      }
+    }
+    for (uint64_t r = 0; r < num_runs; ++r) {
+      const uint64_t begin = U64(counter_index_offset + r * 8);
+      const uint64_t end = U64(counter_index_offset + (r + 1) * 8);
+      if (begin > end || end > num_counters) return false;
+      for (uint64_t i = begin; i < end; ++i) {
+        std::string name;
+        if (!string_at(U64(counters_offset + i * 16), &name)) return false;
+        first_run[r].numbers[name] = Double(U64(counters_offset + i * 16 + 8));
+      }
+    }
+    return true;
+  }
+
+ private:
+  static const char kMagic[8];
+  static const size_t kHeaderSize = 64;
+
+  // The value at 'offset', which the caller checked is in the data.
+  uint64_t U64(uint64_t offset) const {
+    uint64_t value;
+    std::memcpy(&value, data_.data() + offset, sizeof(value));
+    if (swap_) {
+      uint64_t swapped = 0;
+      for (int i = 0; i < 8; ++i) {
+        swapped = (swapped << 8) | (value & 0xff);
+        value >>= 8;
+      }
+      value = swapped;
+    }
+    return value;
+  }
+
+  static double Double(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  const std::string& data_;
+  bool swap_;
+};
+
+const char BinaryResultsReader::kMagic[8] = {'G', 'B', 'E', 'N',
+                                             'C', 'H', 'B', 'R'};
+
+}  // end namespace
+
+bool ReadPreviousRuns(const std::string& path, std::vector<PreviousRun>* runs) {
+  std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+  if (!file.is_open()) return false;
+  const std::string data((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+  if (BinaryResultsReader::IsBinary(data)) {
+    return BinaryResultsReader(data).ReadRuns(runs);
+  }
+  return JsonReader(data).ReadBenchmarks(runs);
+}
+
+bool ReadIterationCounts(const std::string& path,
+                         std::map<std::string, IterationCount>* iterations) {
+  std::vector<PreviousRun> runs;
+  if (!ReadPreviousRuns(path, &runs)) return false;
+  for (const PreviousRun& run : runs) {
+    auto run_type = run.strings.find("run_type");
+    auto name = run.strings.find("run_name");
+    auto count = run.numbers.find("iterations");
+    auto error = run.numbers.find("error_occurred");
+    if (run_type == run.strings.end() || run_type->second != "iteration" ||
+        name == run.strings.end() || count == run.numbers.end() ||
+        count->second < 1 ||
+        (error != run.numbers.end() && error->second != 0)) {
+      continue;
+    }
+    iterations->insert(std::make_pair(
+        name->second, static_cast<IterationCount>(count->second)));
+  }
+  return true;
+}
+
+}  // end namespace internal
+}  // end namespace benchmark
@@ -0,0 +1,32 @@
+#ifndef BENCHMARK_RESULTS_READER_H_
+#define BENCHMARK_RESULTS_READER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+namespace internal {
+
+// One of the runs in the output of an earlier run of the benchmarks: its
+// string and number members, as the JSON reporter names them.
+struct PreviousRun {
+  std::map<std::string, std::string> strings;
+  std::map<std::string, double> numbers;
+};
+
+// Read the runs in 'path', the output of the JSON or the binary reporter.
+// Return false if the file can't be read or parsed.
+bool ReadPreviousRuns(const std::string& path, std::vector<PreviousRun>* runs);
+
+// Read the iteration count each benchmark was run with in the output at
+// 'path', by run name, from the first of its repetitions that didn't fail.
+bool ReadIterationCounts(const std::string& path,
+                         std::map<std::string, IterationCount>* iterations);
+
+}  // end namespace internal
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_RESULTS_READER_H_
@@ -0,0 +1,123 @@
+#include "run_columns.h"
+
+#include <limits>
+#include <utility>
+
+#include "complexity.h"
+
+namespace benchmark {
+namespace internal {
+
+const RunColumn kRunColumns[kNumRunColumns] = {
+    {"name", kStringColumn},
+    {"family_index", kInt64Column},
+    {"per_family_instance_index", kInt64Column},
+    {"run_name", kStringColumn},
+    {"run_type", kStringColumn},
+    {"repetitions", kInt64Column},
+    {"repetition_index", kInt64Column},
+    {"threads", kInt64Column},
+    {"aggregate_name", kStringColumn},
+    {"aggregate_unit", kStringColumn},
+    {"error_occurred", kInt64Column},
+    {"error_message", kStringColumn},
+    {"iterations", kInt64Column},
+    // The real and cpu coefficients of big O runs, and the rms of rms runs in
+    // cpu_time.
+    {"real_time", kDoubleColumn},
+    {"cpu_time", kDoubleColumn},
+    {"time_unit", kStringColumn},
+    // Empty, except for big O runs.
+    {"big_o", kStringColumn},
+    {"rms", kInt64Column},
+    {"has_memory_result", kInt64Column},
+    {"allocs_per_iter", kDoubleColumn},
+    {"max_bytes_used", kInt64Column},
+    // What the MemoryManager didn't measure is NaN, or -1 for the peak.
+    {"bytes_allocated_per_iter", kDoubleColumn},
+    {"frees_per_iter", kDoubleColumn},
+    {"net_heap_growth_per_iter", kDoubleColumn},
+    {"peak_rss_bytes", kInt64Column},
+    {"minor_page_faults_per_iter", kDoubleColumn},
+    {"major_page_faults_per_iter", kDoubleColumn},
+    {"relative_error", kDoubleColumn},
+    {"cold_cache", kInt64Column},
+    {"real_time_overhead", kDoubleColumn},
+    {"cpu_time_overhead", kDoubleColumn},
+    {"cpu_frequency_mhz", kDoubleColumn},
+    {"label", kStringColumn},
+};
+
+void GetRunValues(const BenchmarkReporter::Run& run, RunValue* values) {
+  typedef BenchmarkReporter::Run Run;
+  for (int c = 0; c < kNumRunColumns; ++c) {
+    values[c].int_value = 0;
+    values[c].double_value = 0;
+    values[c].string_value.clear();
+  }
+  values[kName].string_value = run.benchmark_name();
+  values[kFamilyIndex].int_value = static_cast<int64_t>(run.family_index);
+  values[kPerFamilyInstanceIndex].int_value =
+      static_cast<int64_t>(run.per_family_instance_index);
+  values[kRunName].string_value = run.run_name.str();
+  values[kRunType].string_value =
+      run.run_type == Run::RT_Aggregate ? "aggregate" : "iteration";
+  values[kRepetitions].int_value = run.repetitions;
+  values[kRepetitionIndex].int_value = run.repetition_index;
+  values[kThreads].int_value = run.threads;
+  if (run.run_type == Run::RT_Aggregate) {
+    values[kAggregateName].string_value = run.aggregate_name;
+    values[kAggregateUnit].string_value =
+        run.aggregate_unit == StatisticUnit::kPercentage ? "percentage"
+                                                         : "time";
+  }
+  values[kErrorOccurred].int_value = run.error_occurred;
+  values[kErrorMessage].string_value = run.error_message;
+  values[kIterations].int_value = run.iterations;
+  if (run.run_type == Run::RT_Aggregate && !run.report_big_o &&
+      !run.report_rms && run.aggregate_unit == StatisticUnit::kPercentage) {
+    values[kRealTime].double_value = run.real_accumulated_time;
+    values[kCpuTime].double_value = run.cpu_accumulated_time;
+  } else {
+    values[kRealTime].double_value = run.GetAdjustedRealTime();
+    values[kCpuTime].double_value = run.GetAdjustedCPUTime();
+  }
+  values[kTimeUnit].string_value = GetTimeUnitString(run.time_unit);
+  if (run.report_big_o) values[kBigO].string_value = GetBigOString(run);
+  values[kRms].int_value = run.report_rms;
+  values[kHasMemoryResult].int_value = run.has_memory_result;
+  values[kAllocsPerIter].double_value = run.allocs_per_iter;
+  values[kMaxBytesUsed].int_value = run.max_bytes_used;
+  const MemoryManager::Result& memory = run.memory_result;
+  const int64_t kNotMeasured = MemoryManager::Result::TombstoneValue;
+  const std::pair<RunColumnIndex, int64_t> per_iteration[] = {
+      {kBytesAllocatedPerIter, memory.total_allocated_bytes},
+      {kFreesPerIter, memory.num_frees},
+      {kNetHeapGrowthPerIter, memory.net_heap_growth},
+      {kMinorPageFaultsPerIter, memory.minor_page_faults},
+      {kMajorPageFaultsPerIter, memory.major_page_faults}};
+  for (const auto& kv : per_iteration) {
+    values[kv.first].double_value =
+        run.has_memory_result && kv.second != kNotMeasured
+            ? run.MemoryPerIteration(kv.second)
+            : std::numeric_limits<double>::quiet_NaN();
+  }
+  values[kPeakRssBytes].int_value =
+      run.has_memory_result && memory.peak_rss_bytes != kNotMeasured
+          ? memory.peak_rss_bytes
+          : -1;
+  values[kRelativeError].double_value = run.relative_error;
+  values[kColdCache].int_value = run.cold_cache;
+  // Per iteration, like the times.
+  const double multiplier =
+      run.iterations == 0 ? 0
+                          : GetTimeUnitMultiplier(run.time_unit) /
+                                static_cast<double>(run.iterations);
+  values[kRealTimeOverhead].double_value = run.real_time_overhead * multiplier;
+  values[kCpuTimeOverhead].double_value = run.cpu_time_overhead * multiplier;
+  values[kCpuFrequencyMhz].double_value = run.cpu_frequency * 1e-6;
+  values[kLabel].string_value = run.report_label;
+}
+
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,76 @@
+#ifndef BENCHMARK_RUN_COLUMNS_H_
+#define BENCHMARK_RUN_COLUMNS_H_
+
+#include <cstdint>
+#include <string>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+namespace internal {
+
+// The fixed columns of a run in the outputs that are tables, the binary and
+// the table formats, in their order. Each run has the counters too, which
+// differ from one to the next. The values are those the JSON reporter writes.
+enum RunColumnIndex {
+  kName,
+  kFamilyIndex,
+  kPerFamilyInstanceIndex,
+  kRunName,
+  kRunType,
+  kRepetitions,
+  kRepetitionIndex,
+  kThreads,
+  kAggregateName,
+  kAggregateUnit,
+  kErrorOccurred,
+  kErrorMessage,
+  kIterations,
+  kRealTime,
+  kCpuTime,
+  kTimeUnit,
+  kBigO,
+  kRms,
+  kHasMemoryResult,
+  kAllocsPerIter,
+  kMaxBytesUsed,
+  kBytesAllocatedPerIter,
+  kFreesPerIter,
+  kNetHeapGrowthPerIter,
+  kPeakRssBytes,
+  kMinorPageFaultsPerIter,
+  kMajorPageFaultsPerIter,
+  kRelativeError,
+  kColdCache,
+  kRealTimeOverhead,
+  kCpuTimeOverhead,
+  kCpuFrequencyMhz,
+  kLabel,
+  kNumRunColumns
+};
+
+// As the binary format numbers them.
+enum RunColumnType { kInt64Column = 0, kDoubleColumn = 1, kStringColumn = 2 };
+
+struct RunColumn {
+  const char* name;
+  RunColumnType type;
+};
+
+extern const RunColumn kRunColumns[kNumRunColumns];
+
+// The value of a run in a column, in the member of the type of the column.
+struct RunValue {
+  int64_t int_value;
+  double double_value;
+  std::string string_value;
+};
+
+// Set the kNumRunColumns 'values' to those of 'run'. The strings are
+// assigned, so that their memory is reused from one run to the next.
+void GetRunValues(const BenchmarkReporter::Run& run, RunValue* values);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_RUN_COLUMNS_H_
@@ -0,0 +1,321 @@
+#include "run_serialization.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+template <class Enum>
+bool ReadEnum(BinaryReader* reader, Enum* value) {
+  int32_t raw;
+  if (!reader->Read(&raw)) return false;
+  *value = static_cast<Enum>(raw);
+  return true;
+}
+
+template <class T>
+void WriteVector(BinaryWriter* writer, const std::vector<T>& v) {
+  writer->Write(static_cast<uint64_t>(v.size()));
+  for (const T& value : v) writer->Write(value);
+}
+
+template <class T>
+bool ReadVector(BinaryReader* reader, std::vector<T>* v) {
+  uint64_t size;
+  if (!reader->Read(&size)) return false;
+  v->clear();
+  for (uint64_t i = 0; i < size; ++i) {
+    T value;
+    if (!reader->Read(&value)) return false;
+    v->push_back(value);
+  }
+  return true;
+}
+
+template <class First, class Second>
+void WritePairs(BinaryWriter* writer,
+                const std::vector<std::pair<First, Second> >& v) {
+  writer->Write(static_cast<uint64_t>(v.size()));
+  for (const auto& p : v) {
+    writer->Write(p.first);
+    writer->Write(p.second);
+  }
+}
+
+template <class First, class Second>
+bool ReadPairs(BinaryReader* reader,
+               std::vector<std::pair<First, Second> >* v) {
+  uint64_t size;
+  if (!reader->Read(&size)) return false;
+  v->clear();
+  for (uint64_t i = 0; i < size; ++i) {
+    std::pair<First, Second> p;
+    if (!reader->Read(&p.first) || !reader->Read(&p.second)) return false;
+    v->push_back(p);
+  }
+  return true;
+}
+
+}  // end namespace
+
+void BinaryWriter::WriteString(const std::string& s) {
+  Write(static_cast<uint64_t>(s.size()));
+  out_->append(s);
+}
+
+void BinaryWriter::WriteRun(const BenchmarkReporter::Run& run) {
+  WriteString(run.run_name.function_name);
+  WriteString(run.run_name.args);
+  WriteString(run.run_name.min_time);
+  WriteString(run.run_name.min_warmup_time);
+  WriteString(run.run_name.iterations);
+  WriteString(run.run_name.repetitions);
+  WriteString(run.run_name.time_type);
+  WriteString(run.run_name.cache);
+  WriteString(run.run_name.in_flight);
+  WriteString(run.run_name.threads);
+  Write(run.family_index);
+  Write(run.per_family_instance_index);
+  Write(static_cast<int32_t>(run.run_type));
+  WriteString(run.aggregate_name);
+  Write(static_cast<int32_t>(run.aggregate_unit));
+  WriteString(run.report_label);
+  Write(run.error_occurred);
+  WriteString(run.error_message);
+  Write(run.iterations);
+  Write(run.threads);
+  Write(run.in_flight);
+  Write(run.repetition_index);
+  Write(run.repetitions);
+  Write(static_cast<int32_t>(run.time_unit));
+  Write(run.real_accumulated_time);
+  Write(run.cpu_accumulated_time);
+  Write(run.real_time_overhead);
+  Write(run.cpu_time_overhead);
+  Write(run.max_heapbytes_used);
+  Write(static_cast<int32_t>(run.complexity));
+  Write(run.complexity_n);
+  Write(run.report_big_o);
+  Write(run.report_rms);
+  Write(static_cast<uint64_t>(run.counters.size()));
+  for (const auto& kv : run.counters) {
+    WriteString(kv.first);
+    Write(kv.second.value);
+    Write(static_cast<int32_t>(kv.second.flags));
+    Write(static_cast<int32_t>(kv.second.oneK));
+  }
+  Write(run.has_memory_result);
+  Write(run.allocs_per_iter);
+  Write(run.max_bytes_used);
+  WriteVector(this, run.thread_cpus);
+  WriteVector(this, run.thread_numa_nodes);
+  WriteVector(this, run.thread_iterations);
+  WriteVector(this, run.thread_real_times);
+  WriteVector(this, run.thread_cpu_times);
+  Write(run.latency_samples);
+  WritePairs(this, run.latency_percentiles);
+  WritePairs(this, run.latency_buckets);
+  Write(run.relative_error);
+  Write(run.cold_cache);
+  Write(run.cpu_frequency);
+  Write(static_cast<uint64_t>(run.time_series.size()));
+  for (const BenchmarkReporter::TimeSeriesSample& sample : run.time_series) {
+    Write(sample.time);
+    Write(sample.iterations);
+    Write(static_cast<uint64_t>(sample.counters.size()));
+    for (const auto& kv : sample.counters) {
+      WriteString(kv.first);
+      Write(kv.second);
+    }
+  }
+  WriteVector(this, run.complexity_ns);
+  WriteString(run.big_o_string);
+  Write(run.outliers_dropped);
+  Write(run.cached);
+  const MemoryManager::Result& memory = run.memory_result;
+  Write(run.memory_iterations);
+  Write(memory.num_allocs);
+  Write(memory.max_bytes_used);
+  Write(memory.total_allocated_bytes);
+  Write(memory.num_frees);
+  Write(memory.net_heap_growth);
+  WriteVector(this, memory.alloc_size_histogram);
+  Write(memory.peak_rss_bytes);
+  Write(memory.minor_page_faults);
+  Write(memory.major_page_faults);
+  WriteVector(this, memory.thread_allocs);
+  WriteVector(this, memory.thread_allocated_bytes);
+  WriteString(run.profile_file);
+  WriteString(run.matrix_counter);
+  WriteVector(this, run.matrix_rows);
+  WriteVector(this, run.matrix_columns);
+  WriteVector(this, run.matrix_values);
+  Write(static_cast<uint64_t>(run.roles.size()));
+  for (const BenchmarkReporter::RoleRun& role : run.roles) {
+    WriteString(role.name);
+    Write(role.threads);
+    Write(role.iterations);
+    Write(role.real_accumulated_time);
+    Write(role.cpu_accumulated_time);
+    Write(static_cast<uint64_t>(role.counters.size()));
+    for (const auto& kv : role.counters) {
+      WriteString(kv.first);
+      Write(kv.second.value);
+      Write(static_cast<int32_t>(kv.second.flags));
+      Write(static_cast<int32_t>(kv.second.oneK));
+    }
+  }
+  Write(static_cast<uint64_t>(run.tags.size()));
+  for (const std::string& tag : run.tags) WriteString(tag);
+  Write(run.processes);
+  Write(static_cast<uint64_t>(run.warnings.size()));
+  for (const std::string& warning : run.warnings) WriteString(warning);
+  WriteVector(this, run.sample_times);
+}
+
+bool BinaryReader::ReadString(std::string* s) {
+  uint64_t size;
+  if (!Read(&size)) return false;
+  if (static_cast<uint64_t>(end_ - pos_) < size) {
+    pos_ = end_;
+    return false;
+  }
+  s->assign(pos_, static_cast<size_t>(size));
+  pos_ += size;
+  return true;
+}
+
+bool BinaryReader::ReadRun(BenchmarkReporter::Run* run) {
+  if (!ReadString(&run->run_name.function_name) ||
+      !ReadString(&run->run_name.args) ||
+      !ReadString(&run->run_name.min_time) ||
+      !ReadString(&run->run_name.min_warmup_time) ||
+      !ReadString(&run->run_name.iterations) ||
+      !ReadString(&run->run_name.repetitions) ||
+      !ReadString(&run->run_name.time_type) ||
+      !ReadString(&run->run_name.cache) ||
+      !ReadString(&run->run_name.in_flight) ||
+      !ReadString(&run->run_name.threads) || !Read(&run->family_index) ||
+      !Read(&run->per_family_instance_index) ||
+      !ReadEnum(this, &run->run_type) || !ReadString(&run->aggregate_name) ||
+      !ReadEnum(this, &run->aggregate_unit) ||
+      !ReadString(&run->report_label) || !Read(&run->error_occurred) ||
+      !ReadString(&run->error_message) || !Read(&run->iterations) ||
+      !Read(&run->threads) || !Read(&run->in_flight) ||
+      !Read(&run->repetition_index) ||
+      !Read(&run->repetitions) || !ReadEnum(this, &run->time_unit) ||
+      !Read(&run->real_accumulated_time) ||
+      !Read(&run->cpu_accumulated_time) || !Read(&run->real_time_overhead) ||
+      !Read(&run->cpu_time_overhead) || !Read(&run->max_heapbytes_used) ||
+      !ReadEnum(this, &run->complexity) || !Read(&run->complexity_n) ||
+      !Read(&run->report_big_o) || !Read(&run->report_rms)) {
+    return false;
+  }
+  uint64_t num_counters;
+  if (!Read(&num_counters)) return false;
+  run->counters.clear();
+  for (uint64_t i = 0; i < num_counters; ++i) {
+    std::string name;
+    Counter counter;
+    if (!ReadString(&name) || !Read(&counter.value) ||
+        !ReadEnum(this, &counter.flags) || !ReadEnum(this, &counter.oneK)) {
+      return false;
+    }
+    run->counters[name] = counter;
+  }
+  if (!Read(&run->has_memory_result) || !Read(&run->allocs_per_iter) ||
+      !Read(&run->max_bytes_used) || !ReadVector(this, &run->thread_cpus) ||
+      !ReadVector(this, &run->thread_numa_nodes) ||
+      !ReadVector(this, &run->thread_iterations) ||
+      !ReadVector(this, &run->thread_real_times) ||
+      !ReadVector(this, &run->thread_cpu_times) ||
+      !Read(&run->latency_samples) ||
+      !ReadPairs(this, &run->latency_percentiles) ||
+      !ReadPairs(this, &run->latency_buckets) || !Read(&run->relative_error) ||
+      !Read(&run->cold_cache) || !Read(&run->cpu_frequency)) {
+    return false;
+  }
+  uint64_t num_samples;
+  if (!Read(&num_samples)) return false;
+  run->time_series.clear();
+  for (uint64_t i = 0; i < num_samples; ++i) {
+    BenchmarkReporter::TimeSeriesSample sample;
+    uint64_t num_sample_counters;
+    if (!Read(&sample.time) || !Read(&sample.iterations) ||
+        !Read(&num_sample_counters)) {
+      return false;
+    }
+    for (uint64_t j = 0; j < num_sample_counters; ++j) {
+      std::string name;
+      if (!ReadString(&name) || !Read(&sample.counters[name])) return false;
+    }
+    run->time_series.push_back(sample);
+  }
+  if (!ReadVector(this, &run->complexity_ns) ||
+      !ReadString(&run->big_o_string) || !Read(&run->outliers_dropped) ||
+      !Read(&run->cached) || !Read(&run->memory_iterations) ||
+      !Read(&run->memory_result.num_allocs) ||
+      !Read(&run->memory_result.max_bytes_used) ||
+      !Read(&run->memory_result.total_allocated_bytes) ||
+      !Read(&run->memory_result.num_frees) ||
+      !Read(&run->memory_result.net_heap_growth) ||
+      !ReadVector(this, &run->memory_result.alloc_size_histogram) ||
+      !Read(&run->memory_result.peak_rss_bytes) ||
+      !Read(&run->memory_result.minor_page_faults) ||
+      !Read(&run->memory_result.major_page_faults) ||
+      !ReadVector(this, &run->memory_result.thread_allocs) ||
+      !ReadVector(this, &run->memory_result.thread_allocated_bytes) ||
+      !ReadString(&run->profile_file) ||
+      !ReadString(&run->matrix_counter) ||
+      !ReadVector(this, &run->matrix_rows) ||
+      !ReadVector(this, &run->matrix_columns) ||
+      !ReadVector(this, &run->matrix_values)) {
+    return false;
+  }
+  uint64_t num_roles;
+  if (!Read(&num_roles)) return false;
+  run->roles.clear();
+  for (uint64_t i = 0; i < num_roles; ++i) {
+    BenchmarkReporter::RoleRun role;
+    uint64_t num_role_counters;
+    if (!ReadString(&role.name) || !Read(&role.threads) ||
+        !Read(&role.iterations) || !Read(&role.real_accumulated_time) ||
+        !Read(&role.cpu_accumulated_time) || !Read(&num_role_counters)) {
+      return false;
+    }
+    for (uint64_t j = 0; j < num_role_counters; ++j) {
+      std::string name;
+      Counter counter;
+      if (!ReadString(&name) || !Read(&counter.value) ||
+          !ReadEnum(this, &counter.flags) || !ReadEnum(this, &counter.oneK)) {
+        return false;
+      }
+      role.counters[name] = counter;
+    }
+    run->roles.push_back(role);
+  }
+  uint64_t num_tags;
+  if (!Read(&num_tags)) return false;
+  run->tags.clear();
+  for (uint64_t i = 0; i < num_tags; ++i) {
+    std::string tag;
+    if (!ReadString(&tag)) return false;
+    run->tags.push_back(tag);
+  }
+  uint64_t num_warnings;
+  if (!Read(&run->processes) || !Read(&num_warnings)) return false;
+  run->warnings.clear();
+  for (uint64_t i = 0; i < num_warnings; ++i) {
+    std::string warning;
+    if (!ReadString(&warning)) return false;
+    run->warnings.push_back(warning);
+  }
+  return ReadVector(this, &run->sample_times);
+}
+
+}  // namespace internal
+}  // namespace benchmark
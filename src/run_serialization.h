@@ -0,0 +1,72 @@
+#ifndef BENCHMARK_RUN_SERIALIZATION_H_
+#define BENCHMARK_RUN_SERIALIZATION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+namespace internal {
+
+// A compact binary encoding of run reports, to hand them over to another
+// process of the same binary. Numbers are written as they are laid out in
+// memory, so the encoding is not meant to be read on another machine.
+
+class BinaryWriter {
+ public:
+  explicit BinaryWriter(std::string* out) : out_(out) {}
+
+  template <class T>
+  void Write(T value) {
+    static_assert(std::is_arithmetic<T>::value, "only numbers are written");
+    out_->append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void WriteString(const std::string& s);
+
+  // The statistics and the complexity lambda are pointers, which are not
+  // written.
+  void WriteRun(const BenchmarkReporter::Run& run);
+
+ private:
+  std::string* out_;
+};
+
+// Each of the Read functions returns false, and leaves the reader at the end,
+// if the data is truncated.
+class BinaryReader {
+ public:
+  BinaryReader(const char* data, size_t size)
+      : pos_(data), end_(data + size) {}
+
+  template <class T>
+  bool Read(T* value) {
+    static_assert(std::is_arithmetic<T>::value, "only numbers are read");
+    if (static_cast<size_t>(end_ - pos_) < sizeof(*value)) {
+      pos_ = end_;
+      return false;
+    }
+    std::memcpy(value, pos_, sizeof(*value));
+    pos_ += sizeof(*value);
+    return true;
+  }
+
+  bool ReadString(std::string* s);
+
+  bool ReadRun(BenchmarkReporter::Run* run);
+
+  bool AtEnd() const { return pos_ == end_; }
+
+ private:
+  const char* pos_;
+  const char* end_;
+};
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_RUN_SERIALIZATION_H_
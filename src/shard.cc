@@ -0,0 +1,113 @@
+#include "shard.h"
+
+#include <algorithm>
+
+#include "check.h"
+#include "results_reader.h"
+#include "statistics.h"
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+double TimeUnitMultiplier(const std::string& unit) {
+  if (unit == "s") return GetTimeUnitMultiplier(kSecond);
+  if (unit == "ms") return GetTimeUnitMultiplier(kMillisecond);
+  if (unit == "us") return GetTimeUnitMultiplier(kMicrosecond);
+  return GetTimeUnitMultiplier(kNanosecond);
+}
+
+}  // end namespace
+
+bool ReadBenchmarkCosts(const std::string& path,
+                        std::map<std::string, double>* costs) {
+  std::vector<PreviousRun> runs;
+  if (!ReadPreviousRuns(path, &runs)) return false;
+  for (const PreviousRun& run : runs) {
+    auto run_type = run.strings.find("run_type");
+    if (run_type != run.strings.end() && run_type->second != "iteration") {
+      continue;
+    }
+    auto name = run.strings.find("run_name");
+    if (name == run.strings.end()) name = run.strings.find("name");
+    auto iterations = run.numbers.find("iterations");
+    auto real_time = run.numbers.find("real_time");
+    if (name == run.strings.end() || iterations == run.numbers.end() ||
+        real_time == run.numbers.end()) {
+      continue;
+    }
+    auto unit = run.strings.find("time_unit");
+    (*costs)[name->second] +=
+        iterations->second * real_time->second /
+        TimeUnitMultiplier(unit == run.strings.end() ? "" : unit->second);
+  }
+  return true;
+}
+
+std::vector<int> AssignShards(const std::vector<double>& costs,
+                              int shard_count) {
+  BM_CHECK_GT(shard_count, 0);
+  std::vector<size_t> order(costs.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&costs](size_t a, size_t b) {
+    return costs[a] > costs[b];
+  });
+
+  std::vector<double> loads(static_cast<size_t>(shard_count), 0.0);
+  std::vector<int> shards(costs.size());
+  for (size_t unit : order) {
+    const size_t shard = static_cast<size_t>(
+        std::min_element(loads.begin(), loads.end()) - loads.begin());
+    loads[shard] += costs[unit];
+    shards[unit] = static_cast<int>(shard);
+  }
+  return shards;
+}
+
+void SelectShard(int shard_index, int shard_count,
+                 const std::map<std::string, double>& costs,
+                 std::vector<BenchmarkInstance>* benchmarks) {
+  BM_CHECK(shard_index >= 0 && shard_index < shard_count);
+  std::vector<double> known_costs;
+  for (const auto& kv : costs) known_costs.push_back(kv.second);
+  const double default_cost =
+      known_costs.empty() ? 1.0 : StatisticsMedian(known_costs);
+
+  // Group the instances into units: one per instance, but for the families
+  // that need all of theirs in the same run.
+  std::vector<double> unit_costs;
+  std::vector<size_t> units;
+  std::map<int, size_t> family_units;
+  for (const BenchmarkInstance& instance : *benchmarks) {
+    auto cost = costs.find(instance.name().str());
+    const double instance_cost =
+        cost == costs.end() ? default_cost : cost->second;
+    const bool whole_family = instance.complexity() != oNone ||
+                              !instance.complexity_terms().empty() ||
+                              instance.thread_scaling() ||
+                              !instance.matrix_counter().empty() ||
+                              instance.ab_role() != kNotAB;
+    auto family_unit = family_units.find(instance.family_index());
+    if (whole_family && family_unit != family_units.end()) {
+      unit_costs[family_unit->second] += instance_cost;
+      units.push_back(family_unit->second);
+      continue;
+    }
+    if (whole_family) {
+      family_units[instance.family_index()] = unit_costs.size();
+    }
+    units.push_back(unit_costs.size());
+    unit_costs.push_back(instance_cost);
+  }
+
+  const std::vector<int> shards = AssignShards(unit_costs, shard_count);
+  std::vector<BenchmarkInstance> selected;
+  for (size_t i = 0; i < benchmarks->size(); ++i) {
+    if (shards[units[i]] == shard_index) selected.push_back((*benchmarks)[i]);
+  }
+  benchmarks->swap(selected);
+}
+
+}  // end namespace internal
+}  // end namespace benchmark
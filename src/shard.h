@@ -0,0 +1,41 @@
+#ifndef BENCHMARK_SHARD_H_
+#define BENCHMARK_SHARD_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "benchmark_api_internal.h"
+
+namespace benchmark {
+namespace internal {
+
+// Read the time each benchmark took, in seconds, from the JSON or binary
+// output of a previous run at 'path': the iterations of its repetitions times
+// their real time, by run name. Return false if the file can't be read or
+// parsed.
+bool ReadBenchmarkCosts(const std::string& path,
+                        std::map<std::string, double>* costs);
+
+// Assign each of the units of work, which cost 'costs', to one of
+// 'shard_count' shards, so that the shards cost about as much: the most
+// costly units first, each to the shard that costs the least so far. Ties go
+// to the earlier unit and the lower shard, so that every shard computes the
+// same assignment.
+std::vector<int> AssignShards(const std::vector<double>& costs,
+                              int shard_count);
+
+// Keep only the 'benchmarks' of shard 'shard_index' of 'shard_count', in
+// their order. The instances of a family that computes aggregates over them,
+// as for complexity, thread scaling or A/B pairs, stay together. The other
+// instances cost what they did in 'costs', or the median of those if they
+// weren't run before, or all the same if 'costs' is empty. The instances keep
+// the family indices they have among all the shards.
+void SelectShard(int shard_index, int shard_count,
+                 const std::map<std::string, double>& costs,
+                 std::vector<BenchmarkInstance>* benchmarks);
+
+}  // end namespace internal
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_SHARD_H_
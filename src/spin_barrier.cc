@@ -0,0 +1,125 @@
+#include "spin_barrier.h"
+
+#include <thread>
+
+#include "check.h"
+#include "internal_macros.h"
+
+#ifdef BENCHMARK_OS_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace benchmark {
+namespace {
+
+// How many times to poll the phase word before blocking on it. Long enough to
+// cover the time the other threads need to finish their iterations once they
+// are all running, short enough to not burn a cpu on an oversubscribed
+// machine.
+constexpr int kSpinCount = 1 << 14;
+
+inline void CpuRelax() {
+#if defined(__i386__) || defined(__x86_64__)
+  asm volatile("pause" ::: "memory");
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Block while '*addr' still holds 'value'. May return spuriously.
+void WaitOnAddress(std::atomic<uint32_t>* addr, uint32_t value) {
+#ifdef BENCHMARK_OS_LINUX
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "futex requires a plain 32 bit word");
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT_PRIVATE,
+          value, nullptr, nullptr, 0);
+#else
+  (void)addr;
+  (void)value;
+  std::this_thread::yield();
+#endif
+}
+
+void WakeAllOnAddress(std::atomic<uint32_t>* addr) {
+#ifdef BENCHMARK_OS_LINUX
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE,
+          INT32_MAX, nullptr, nullptr, 0);
+#else
+  (void)addr;
+#endif
+}
+
+}  // namespace
+
+SpinBarrier::SpinBarrier(int num_threads)
+    : state_(Pack(0, 0, static_cast<uint32_t>(num_threads))),
+      completed_phase_(0) {
+  BM_CHECK(num_threads > 0 && num_threads <= 0xffff)
+      << "SpinBarrier supports up to 65535 threads.";
+}
+
+bool SpinBarrier::wait() {
+  uint64_t s = state_.load(std::memory_order_relaxed);
+  uint64_t next;
+  bool last_thread;
+  do {
+    BM_CHECK_LT(Entered(s), Running(s));
+    last_thread = Entered(s) + 1 == Running(s);
+    next = last_thread ? Pack(Phase(s) + 1, 0, Running(s))
+                       : Pack(Phase(s), Entered(s) + 1, Running(s));
+  } while (!state_.compare_exchange_weak(s, next, std::memory_order_acq_rel,
+                                         std::memory_order_relaxed));
+  if (last_thread) {
+    Release(Phase(next));
+  } else {
+    WaitForPhaseAfter(Phase(s));
+  }
+  return last_thread;
+}
+
+void SpinBarrier::removeThread() {
+  uint64_t s = state_.load(std::memory_order_relaxed);
+  uint64_t next;
+  bool completes_phase;
+  do {
+    BM_CHECK_GT(Running(s), 0u);
+    // If every remaining thread is already waiting, leaving completes the
+    // phase on their behalf.
+    completes_phase = Entered(s) != 0 && Entered(s) == Running(s) - 1;
+    next = completes_phase ? Pack(Phase(s) + 1, 0, Running(s) - 1)
+                           : Pack(Phase(s), Entered(s), Running(s) - 1);
+  } while (!state_.compare_exchange_weak(s, next, std::memory_order_acq_rel,
+                                         std::memory_order_relaxed));
+  if (completes_phase) Release(Phase(next));
+}
+
+void SpinBarrier::Release(uint32_t phase) {
+  // Phases may complete out of order here if a thread races ahead into the
+  // next phase while we are still publishing this one; never go backwards.
+  uint32_t current = completed_phase_.load(std::memory_order_relaxed);
+  while (static_cast<int32_t>(phase - current) > 0 &&
+         !completed_phase_.compare_exchange_weak(current, phase,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed)) {
+  }
+  WakeAllOnAddress(&completed_phase_);
+}
+
+void SpinBarrier::WaitForPhaseAfter(uint32_t phase) {
+  // The phase counter wraps around, so compare through the signed distance.
+  int spins = 0;
+  for (;;) {
+    uint32_t current = completed_phase_.load(std::memory_order_acquire);
+    if (static_cast<int32_t>(current - phase) > 0) return;
+    if (spins < kSpinCount) {
+      ++spins;
+      CpuRelax();
+    } else {
+      WaitOnAddress(&completed_phase_, current);
+    }
+  }
+}
+
+}  // end namespace benchmark
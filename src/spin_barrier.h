@@ -0,0 +1,56 @@
+#ifndef BENCHMARK_SPIN_BARRIER_H_
+#define BENCHMARK_SPIN_BARRIER_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+
+// A drop-in alternative to Barrier for when the threads should leave the
+// barrier as close to each other as possible. Instead of having the last
+// thread wake up all the others through a condition variable, one after the
+// other, the waiting threads spin on the phase word, so they all notice the
+// phase change at (nearly) the same time. If the wait takes longer than a
+// short spin, e.g. because there are more threads than cpus, the threads
+// block on the phase word (futex on Linux, yielding elsewhere).
+class SpinBarrier {
+ public:
+  explicit SpinBarrier(int num_threads);
+
+  // Called by each thread. Returns true for the thread that completed the
+  // phase.
+  bool wait();
+
+  void removeThread();
+
+ private:
+  // The number of threads that have entered the barrier, the number of
+  // threads taking part in it and the phase number are all packed into a
+  // single word, so that a phase is completed exactly once, either by the
+  // last thread entering it or by the thread leaving it.
+  static uint64_t Pack(uint32_t phase, uint32_t entered, uint32_t running) {
+    return static_cast<uint64_t>(phase) |
+           (static_cast<uint64_t>(entered & 0xffff) << 32) |
+           (static_cast<uint64_t>(running & 0xffff) << 48);
+  }
+  static uint32_t Phase(uint64_t s) { return static_cast<uint32_t>(s); }
+  static uint32_t Entered(uint64_t s) { return (s >> 32) & 0xffff; }
+  static uint32_t Running(uint64_t s) { return (s >> 48) & 0xffff; }
+
+  // Publish the completion of the phase 'phase' and wake the waiters.
+  void Release(uint32_t phase);
+  void WaitForPhaseAfter(uint32_t phase);
+
+  std::atomic<uint64_t> state_;
+  // The last completed phase, mirrored out of 'state_' into a 32 bit word
+  // that the waiting threads can block on.
+  std::atomic<uint32_t> completed_phase_;
+
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(SpinBarrier);
+};
+
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_SPIN_BARRIER_H_
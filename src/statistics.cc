@@ -18,9 +18,11 @@
 #include <algorithm>
 #include <cmath>
 #include <numeric>
+#include <random>
 #include <string>
 #include <vector>
 #include "check.h"
+#include "online_statistics.h"
 #include "statistics.h"
 
 namespace benchmark {
@@ -83,124 +85,187 @@ double StatisticsCV(const std::vector<double>& v) {
   return stddev / mean;
 }
 
-std::vector<BenchmarkReporter::Run> ComputeStats(
-    const std::vector<BenchmarkReporter::Run>& reports) {
-  typedef BenchmarkReporter::Run Run;
-  std::vector<Run> results;
+double StudentT975(size_t dof) {
+  BM_CHECK_GT(dof, 0);
+  // The 97.5th percentiles of Student's t-distribution, by degrees of freedom.
+  static const double kStudentT[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  const size_t kNumStudentT = sizeof(kStudentT) / sizeof(kStudentT[0]);
+  // Past the table, this stays within 0.2% of the exact value.
+  return dof <= kNumStudentT ? kStudentT[dof - 1] : 1.96 + 2.4 / dof;
+}
 
-  auto error_count =
-      std::count_if(reports.begin(), reports.end(),
-                    [](Run const& run) { return run.error_occurred; });
+double StatisticsRelativeError(const std::vector<double>& v) {
+  if (v.size() < 2) return 0.0;
 
-  if (reports.size() - error_count < 2) {
-    // We don't report aggregated data if there was a single run.
-    return results;
-  }
+  const double t = StudentT975(v.size() - 1);
+  const auto mean = StatisticsMean(v);
+  if (mean == 0.0) return 0.0;
+  return t * StatisticsStdDev(v) / std::sqrt(v.size()) / std::fabs(mean);
+}
 
-  // Accumulators.
-  std::vector<double> real_accumulated_time_stat;
-  std::vector<double> cpu_accumulated_time_stat;
-
-  real_accumulated_time_stat.reserve(reports.size());
-  cpu_accumulated_time_stat.reserve(reports.size());
-
-  // All repetitions should be run with the same number of iterations so we
-  // can take this information from the first benchmark.
-  const IterationCount run_iterations = reports.front().iterations;
-  // create stats for user counters
-  struct CounterStat {
-    Counter c;
-    std::vector<double> s;
-  };
-  std::map<std::string, CounterStat> counter_stats;
-  for (Run const& r : reports) {
-    for (auto const& cnt : r.counters) {
-      auto it = counter_stats.find(cnt.first);
-      if (it == counter_stats.end()) {
-        counter_stats.insert({cnt.first, {cnt.second, std::vector<double>{}}});
-        it = counter_stats.find(cnt.first);
-        it->second.s.reserve(reports.size());
-      } else {
-        BM_CHECK_EQ(counter_stats[cnt.first].c.flags, cnt.second.flags);
-      }
-    }
+double StatisticsMin(const std::vector<double>& v) {
+  if (v.empty()) return 0.0;
+  return *std::min_element(v.begin(), v.end());
+}
+
+double StatisticsMax(const std::vector<double>& v) {
+  if (v.empty()) return 0.0;
+  return *std::max_element(v.begin(), v.end());
+}
+
+double StatisticsPercentile(const std::vector<double>& v, double p) {
+  BM_CHECK(p >= 0.0 && p <= 100.0);
+  if (v.empty()) return 0.0;
+  std::vector<double> sorted(v);
+  std::sort(sorted.begin(), sorted.end());
+
+  const double rank = p / 100.0 * (sorted.size() - 1);
+  const size_t lower = static_cast<size_t>(rank);
+  if (lower + 1 >= sorted.size()) return sorted.back();
+  const double fraction = rank - lower;
+  return sorted[lower] + fraction * (sorted[lower + 1] - sorted[lower]);
+}
+
+double StatisticsP5(const std::vector<double>& v) {
+  return StatisticsPercentile(v, 5.0);
+}
+
+double StatisticsP95(const std::vector<double>& v) {
+  return StatisticsPercentile(v, 95.0);
+}
+
+double StatisticsMAD(const std::vector<double>& v) {
+  const double median = StatisticsMedian(v);
+  std::vector<double> deviations;
+  deviations.reserve(v.size());
+  for (double x : v) deviations.push_back(std::fabs(x - median));
+  return StatisticsMedian(deviations);
+}
+
+double StatisticsTrimmedMean(const std::vector<double>& v) {
+  const size_t trimmed = v.size() / 10;
+  if (trimmed == 0) return StatisticsMean(v);
+  std::vector<double> sorted(v);
+  std::sort(sorted.begin(), sorted.end());
+  return StatisticsMean(
+      std::vector<double>(sorted.begin() + trimmed, sorted.end() - trimmed));
+}
+
+namespace {
+
+// Return the means of 1000 resamples, with replacement, of 'v'.
+std::vector<double> BootstrapMeans(const std::vector<double>& v) {
+  static const int kResamples = 1000;
+  // Always the default seed, so the same samples give the same bounds.
+  std::mt19937 rng;
+  std::uniform_int_distribution<size_t> pick(0, v.size() - 1);
+  std::vector<double> means;
+  means.reserve(kResamples);
+  for (int i = 0; i < kResamples; ++i) {
+    double sum = 0.0;
+    for (size_t j = 0; j < v.size(); ++j) sum += v[pick(rng)];
+    means.push_back(sum / v.size());
   }
+  return means;
+}
 
-  // Populate the accumulators.
-  for (Run const& run : reports) {
-    BM_CHECK_EQ(reports[0].benchmark_name(), run.benchmark_name());
-    BM_CHECK_EQ(run_iterations, run.iterations);
-    if (run.error_occurred) continue;
-    real_accumulated_time_stat.emplace_back(run.real_accumulated_time);
-    cpu_accumulated_time_stat.emplace_back(run.cpu_accumulated_time);
-    // user counters
-    for (auto const& cnt : run.counters) {
-      auto it = counter_stats.find(cnt.first);
-      BM_CHECK_NE(it, counter_stats.end());
-      it->second.s.emplace_back(cnt.second);
-    }
+}  // end namespace
+
+double StatisticsBootstrapLow(const std::vector<double>& v) {
+  if (v.size() < 2) return StatisticsMean(v);
+  return StatisticsPercentile(BootstrapMeans(v), 2.5);
+}
+
+double StatisticsBootstrapHigh(const std::vector<double>& v) {
+  if (v.size() < 2) return StatisticsMean(v);
+  return StatisticsPercentile(BootstrapMeans(v), 97.5);
+}
+
+bool ParseOutlierRejection(const std::string& str, OutlierRejection* rule) {
+  if (str == "none") {
+    *rule = kNoOutlierRejection;
+  } else if (str == "iqr") {
+    *rule = kIQROutlierRejection;
+  } else if (str == "mad") {
+    *rule = kMADOutlierRejection;
+  } else {
+    return false;
   }
+  return true;
+}
 
-  // Only add label if it is same for all runs
-  std::string report_label = reports[0].report_label;
-  for (std::size_t i = 1; i < reports.size(); i++) {
-    if (reports[i].report_label != report_label) {
-      report_label = "";
+std::vector<size_t> FindOutliers(const std::vector<double>& v,
+                                 OutlierRejection rule) {
+  std::vector<size_t> outliers;
+  double low = 0.0;
+  double high = 0.0;
+  switch (rule) {
+    case kNoOutlierRejection:
+      return outliers;
+    case kIQROutlierRejection: {
+      // The quartiles of fewer values say little about the spread.
+      if (v.size() < 4) return outliers;
+      const double q1 = StatisticsPercentile(v, 25.0);
+      const double q3 = StatisticsPercentile(v, 75.0);
+      low = q1 - 1.5 * (q3 - q1);
+      high = q3 + 1.5 * (q3 - q1);
       break;
     }
-  }
-
-  const double iteration_rescale_factor =
-      double(reports.size()) / double(run_iterations);
-
-  for (const auto& Stat : *reports[0].statistics) {
-    // Get the data from the accumulator to BenchmarkReporter::Run's.
-    Run data;
-    data.run_name = reports[0].run_name;
-    data.family_index = reports[0].family_index;
-    data.per_family_instance_index = reports[0].per_family_instance_index;
-    data.run_type = BenchmarkReporter::Run::RT_Aggregate;
-    data.threads = reports[0].threads;
-    data.repetitions = reports[0].repetitions;
-    data.repetition_index = Run::no_repetition_index;
-    data.aggregate_name = Stat.name_;
-    data.aggregate_unit = Stat.unit_;
-    data.report_label = report_label;
-
-    // It is incorrect to say that an aggregate is computed over
-    // run's iterations, because those iterations already got averaged.
-    // Similarly, if there are N repetitions with 1 iterations each,
-    // an aggregate will be computed over N measurements, not 1.
-    // Thus it is best to simply use the count of separate reports.
-    data.iterations = reports.size();
-
-    data.real_accumulated_time = Stat.compute_(real_accumulated_time_stat);
-    data.cpu_accumulated_time = Stat.compute_(cpu_accumulated_time_stat);
-
-    if (data.aggregate_unit == StatisticUnit::kTime) {
-      // We will divide these times by data.iterations when reporting, but the
-      // data.iterations is not necessarily the scale of these measurements,
-      // because in each repetition, these timers are sum over all the iters.
-      // And if we want to say that the stats are over N repetitions and not
-      // M iterations, we need to multiply these by (N/M).
-      data.real_accumulated_time *= iteration_rescale_factor;
-      data.cpu_accumulated_time *= iteration_rescale_factor;
+    case kMADOutlierRejection: {
+      if (v.size() < 3) return outliers;
+      const double median = StatisticsMedian(v);
+      // The MAD of normally distributed values, scaled to their deviation.
+      const double sigma = 1.4826 * StatisticsMAD(v);
+      // If most values are equal, there is no spread to measure against.
+      if (sigma == 0.0) return outliers;
+      low = median - 3.0 * sigma;
+      high = median + 3.0 * sigma;
+      break;
     }
+  }
+  for (size_t i = 0; i < v.size(); ++i) {
+    if (v[i] < low || v[i] > high) outliers.push_back(i);
+  }
+  return outliers;
+}
 
-    data.time_unit = reports[0].time_unit;
+std::vector<BenchmarkReporter::Run> ComputeStats(
+    const std::vector<BenchmarkReporter::Run>& reports,
+    OutlierRejection rule) {
+  typedef BenchmarkReporter::Run Run;
 
-    // user counters
-    for (auto const& kv : counter_stats) {
-      // Do *NOT* rescale the custom counters. They are already properly scaled.
-      const auto uc_stat = Stat.compute_(kv.second.s);
-      auto c = Counter(uc_stat, counter_stats[kv.first].c.flags,
-                       counter_stats[kv.first].c.oneK);
-      data.counters[kv.first] = c;
+  // Flag the outliers by the time the benchmark is measured by, leaving them
+  // all in if too few repetitions would be left.
+  std::vector<bool> dropped(reports.size(), false);
+  size_t num_dropped = 0;
+  if (rule != kNoOutlierRejection && !reports.empty()) {
+    const std::string& time_type = reports[0].run_name.time_type;
+    const bool real_time = time_type.find("real_time") != std::string::npos ||
+                           time_type.find("manual_time") != std::string::npos;
+    std::vector<double> times;
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < reports.size(); ++i) {
+      if (reports[i].error_occurred) continue;
+      times.push_back(real_time ? reports[i].real_accumulated_time
+                                : reports[i].cpu_accumulated_time);
+      indices.push_back(i);
+    }
+    const std::vector<size_t> outliers = FindOutliers(times, rule);
+    if (times.size() - outliers.size() >= 2) {
+      for (size_t outlier : outliers) dropped[indices[outlier]] = true;
+      num_dropped = outliers.size();
     }
-
-    results.push_back(data);
   }
 
+  StatisticsAccumulator accumulator;
+  for (size_t i = 0; i < reports.size(); ++i) {
+    if (!dropped[i]) accumulator.Add(reports[i]);
+  }
+  std::vector<Run> results = accumulator.Compute();
+  for (Run& data : results) data.outliers_dropped = num_dropped;
   return results;
 }
 
@@ -16,23 +16,73 @@
 #ifndef STATISTICS_H_
 #define STATISTICS_H_
 
+#include <string>
 #include <vector>
 
 #include "benchmark/benchmark.h"
 
 namespace benchmark {
 
+// How repetitions are flagged as outliers, to be left out of the aggregates.
+enum OutlierRejection {
+  kNoOutlierRejection,
+  // Outside [Q1 - 1.5 * IQR, Q3 + 1.5 * IQR] (Tukey's fences).
+  kIQROutlierRejection,
+  // More than 3 estimated standard deviations, 1.4826 * MAD, from the median.
+  kMADOutlierRejection
+};
+
+// Parse "none", "iqr" or "mad". Return false if 'str' is none of these.
+bool ParseOutlierRejection(const std::string& str, OutlierRejection* rule);
+
+// Return the indices of the values in 'v' that 'rule' flags as outliers, in
+// increasing order.
+std::vector<size_t> FindOutliers(const std::vector<double>& v,
+                                 OutlierRejection rule);
+
 // Return a vector containing the mean, median and standard devation information
 // (and any user-specified info) for the specified list of reports. If 'reports'
-// contains less than two non-errored runs an empty vector is returned
+// contains less than two non-errored runs an empty vector is returned. The
+// repetitions that 'rule' flags as outliers are left out, as long as two are
+// left, and their number is reported in the aggregates' 'outliers_dropped'.
 std::vector<BenchmarkReporter::Run> ComputeStats(
-    const std::vector<BenchmarkReporter::Run>& reports);
+    const std::vector<BenchmarkReporter::Run>& reports,
+    OutlierRejection rule = kNoOutlierRejection);
 
 double StatisticsMean(const std::vector<double>& v);
 double StatisticsMedian(const std::vector<double>& v);
 double StatisticsStdDev(const std::vector<double>& v);
 double StatisticsCV(const std::vector<double>& v);
 
+// The robust statistics that Benchmark::RobustStatistics() adds.
+double StatisticsMin(const std::vector<double>& v);
+double StatisticsMax(const std::vector<double>& v);
+// The 'p'-th percentile, 0 <= p <= 100, interpolated between the two closest
+// ranks.
+double StatisticsPercentile(const std::vector<double>& v, double p);
+double StatisticsP5(const std::vector<double>& v);
+double StatisticsP95(const std::vector<double>& v);
+// The median absolute deviation from the median.
+double StatisticsMAD(const std::vector<double>& v);
+// The mean of the values left once the lowest and highest 10% are dropped.
+double StatisticsTrimmedMean(const std::vector<double>& v);
+// The bounds of the 95% confidence interval of the mean, bootstrapped from
+// 1000 resamples of 'v'. These make no assumption on the distribution of the
+// samples, unlike StatisticsRelativeError(). The resampling is seeded the same
+// way every time, so the bounds are reproducible.
+double StatisticsBootstrapLow(const std::vector<double>& v);
+double StatisticsBootstrapHigh(const std::vector<double>& v);
+
+// The 97.5th percentile of Student's t-distribution with 'dof' > 0 degrees of
+// freedom, by which the standard error of a mean is multiplied for the
+// half-width of its 95% confidence interval.
+double StudentT975(size_t dof);
+
+// Return the half-width of the 95% confidence interval of the mean of 'v',
+// relative to the mean; e.g. 0.01 if the mean is known within +/-1%. Assumes
+// the samples are independent and normally distributed.
+double StatisticsRelativeError(const std::vector<double>& v);
+
 }  // end namespace benchmark
 
 #endif  // STATISTICS_H_
@@ -1,9 +1,13 @@
 #ifndef BENCHMARK_STRING_UTIL_H_
 #define BENCHMARK_STRING_UTIL_H_
 
+#include <stdint.h>
+
 #include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
+
 #include "internal_macros.h"
 
 namespace benchmark {
@@ -39,6 +43,9 @@ inline std::string StrCat(Args&&... args) {
 
 std::vector<std::string> StrSplit(const std::string& str, char delim);
 
+// The 64-bit FNV-1a hash of 'data'.
+uint64_t Fnv1aHash(const char* data, size_t size);
+
 #ifdef BENCHMARK_STL_ANDROID_GNUSTL
 /*
  * GNU STL in Android NDK lacks support for some C++11 functions, including
@@ -15,6 +15,7 @@
 #include "internal_macros.h"
 
 #ifdef BENCHMARK_OS_WINDOWS
+#include <direct.h>
 #include <shlwapi.h>
 #undef StrCat  // Don't let StrCat in string_util.h be renamed to lstrcatA
 #include <versionhelpers.h>
@@ -25,6 +26,7 @@
 #ifndef BENCHMARK_OS_FUCHSIA
 #include <sys/resource.h>
 #endif
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>  // this header must be included before 'sys/sysctl.h' to avoid compilation error on FreeBSD
 #include <unistd.h>
@@ -41,6 +43,15 @@
 #if defined(BENCHMARK_OS_QNX)
 #include <sys/syspage.h>
 #endif
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+#if defined(BENCHMARK_OS_LINUX) && defined(__aarch64__)
+#include <sys/auxv.h>
+#endif
 
 #include <algorithm>
 #include <array>
@@ -55,17 +66,23 @@
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <map>
 #include <memory>
+#include <set>
 #include <sstream>
 #include <locale>
 #include <utility>
 
+#include "absl/flags/flag.h"
+#include "benchmark_runner.h"
 #include "check.h"
+#include "cpu_affinity.h"
 #include "cycleclock.h"
 #include "internal_macros.h"
 #include "log.h"
 #include "sleep.h"
 #include "string_util.h"
+#include "sysinfo.h"
 
 namespace benchmark {
 namespace {
@@ -415,6 +432,203 @@ std::vector<CPUInfo::CacheInfo> GetCacheSizes() {
 #endif
 }
 
+#ifdef BENCHMARK_OS_LINUX
+// The cpus of the list in the file at 'path' in the 'cpulist' format.
+std::vector<int> ReadCpuList(const std::string& path) {
+  std::ifstream f(path.c_str());
+  std::string list;
+  std::vector<int> cpus;
+  if (!std::getline(f, list) || !internal::ParseCpuList(list, &cpus)) {
+    cpus.clear();
+  }
+  return cpus;
+}
+
+std::vector<CPUInfo::LogicalCpu> GetCPUTopologyFromKVFS() {
+  std::vector<CPUInfo::LogicalCpu> res;
+  for (int cpu : ReadCpuList("/sys/devices/system/cpu/online")) {
+    const std::string dir = StrCat("/sys/devices/system/cpu/cpu", cpu, "/");
+    CPUInfo::LogicalCpu info;
+    info.cpu = cpu;
+    if (!ReadFromFile(StrCat(dir, "topology/physical_package_id"),
+                      &info.package)) {
+      info.package = -1;
+    }
+    if (!ReadFromFile(StrCat(dir, "topology/core_id"), &info.core)) {
+      info.core = -1;
+    }
+    const std::vector<int> siblings =
+        ReadCpuList(StrCat(dir, "topology/thread_siblings_list"));
+    info.smt_index = siblings.empty() ? -1
+                                      : static_cast<int>(
+                                            std::find(siblings.begin(),
+                                                      siblings.end(), cpu) -
+                                            siblings.begin());
+    info.numa_node = -1;
+    info.llc = -1;
+    int llc_level = 0;
+    for (int idx = 0;; ++idx) {
+      const std::string cache = StrCat(dir, "cache/index", idx, "/");
+      int level;
+      if (!ReadFromFile(StrCat(cache, "level"), &level)) break;
+      const std::vector<int> sharing =
+          ReadCpuList(StrCat(cache, "shared_cpu_list"));
+      if (level > llc_level && !sharing.empty()) {
+        llc_level = level;
+        info.llc = sharing.front();
+      }
+    }
+    res.push_back(info);
+  }
+  // The nodes list their cpus, rather than the cpus their node.
+  const char* const kNodeDir = "/sys/devices/system/node";
+  for (int node : ReadCpuList(StrCat(kNodeDir, "/online"))) {
+    for (int cpu : ReadCpuList(StrCat(kNodeDir, "/node", node, "/cpulist"))) {
+      for (CPUInfo::LogicalCpu& info : res) {
+        if (info.cpu == cpu) info.numa_node = node;
+      }
+    }
+  }
+  return res;
+}
+#endif
+
+#ifdef BENCHMARK_OS_WINDOWS
+std::vector<CPUInfo::LogicalCpu> GetCPUTopologyWindows() {
+  std::vector<CPUInfo::LogicalCpu> res;
+  DWORD size = 0;
+  GetLogicalProcessorInformationEx(RelationAll, nullptr, &size);
+  std::vector<char> buffer(size);
+  if (size == 0 ||
+      !GetLogicalProcessorInformationEx(
+          RelationAll,
+          reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(
+              buffer.data()),
+          &size)) {
+    return res;
+  }
+  // The cpus of 'mask', numbered across the processor groups.
+  auto cpus_of = [](const GROUP_AFFINITY& mask) {
+    std::vector<int> cpus;
+    for (int bit = 0; bit < static_cast<int>(sizeof(KAFFINITY) * 8); ++bit) {
+      if (mask.Mask & (static_cast<KAFFINITY>(1) << bit)) {
+        cpus.push_back(mask.Group * static_cast<int>(sizeof(KAFFINITY) * 8) +
+                       bit);
+      }
+    }
+    return cpus;
+  };
+  std::map<int, CPUInfo::LogicalCpu> by_cpu;
+  auto at = [&](int cpu) -> CPUInfo::LogicalCpu& {
+    auto it = by_cpu.find(cpu);
+    if (it == by_cpu.end()) {
+      CPUInfo::LogicalCpu info = {cpu, -1, -1, -1, -1, -1};
+      it = by_cpu.insert(std::make_pair(cpu, info)).first;
+    }
+    return it->second;
+  };
+  std::map<int, int> llc_level;
+  int package = 0;
+  int core = 0;
+  for (DWORD offset = 0; offset < size;) {
+    const auto* info =
+        reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(
+            buffer.data() + offset);
+    switch (info->Relationship) {
+      case RelationProcessorCore: {
+        int smt_index = 0;
+        for (WORD g = 0; g < info->Processor.GroupCount; ++g) {
+          for (int cpu : cpus_of(info->Processor.GroupMask[g])) {
+            at(cpu).core = core;
+            at(cpu).smt_index = smt_index++;
+          }
+        }
+        ++core;
+        break;
+      }
+      case RelationProcessorPackage:
+        for (WORD g = 0; g < info->Processor.GroupCount; ++g) {
+          for (int cpu : cpus_of(info->Processor.GroupMask[g])) {
+            at(cpu).package = package;
+          }
+        }
+        ++package;
+        break;
+      case RelationNumaNode:
+        for (int cpu : cpus_of(info->NumaNode.GroupMask)) {
+          at(cpu).numa_node = static_cast<int>(info->NumaNode.NodeNumber);
+        }
+        break;
+      case RelationCache: {
+        const std::vector<int> cpus = cpus_of(info->Cache.GroupMask);
+        for (int cpu : cpus) {
+          if (info->Cache.Level > llc_level[cpu]) {
+            llc_level[cpu] = info->Cache.Level;
+            at(cpu).llc = cpus.front();
+          }
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    offset += info->Size;
+  }
+  // Number the cores within their package.
+  std::map<int, std::map<int, int> > cores_of_package;
+  for (auto& cpu : by_cpu) {
+    CPUInfo::LogicalCpu& info = cpu.second;
+    if (info.core < 0) continue;
+    std::map<int, int>& cores = cores_of_package[info.package];
+    info.core = cores.insert(std::make_pair(info.core,
+                                            static_cast<int>(cores.size())))
+                    .first->second;
+  }
+  for (const auto& cpu : by_cpu) res.push_back(cpu.second);
+  return res;
+}
+#endif
+
+#ifdef BENCHMARK_OS_MACOSX
+// The cpus are not mapped to their cores, which is assumed to be in order.
+std::vector<CPUInfo::LogicalCpu> GetCPUTopologyMacOSX() {
+  std::vector<CPUInfo::LogicalCpu> res;
+  int logical = 0, physical = 0, packages = 0;
+  if (!GetSysctl("hw.logicalcpu", &logical) ||
+      !GetSysctl("hw.physicalcpu", &physical) ||
+      !GetSysctl("hw.packages", &packages) || logical <= 0 || physical <= 0 ||
+      packages <= 0 || logical % physical != 0 || physical % packages != 0) {
+    return res;
+  }
+  const int threads_per_core = logical / physical;
+  const int cores_per_package = physical / packages;
+  for (int cpu = 0; cpu < logical; ++cpu) {
+    const int core = cpu / threads_per_core;
+    CPUInfo::LogicalCpu info;
+    info.cpu = cpu;
+    info.package = core / cores_per_package;
+    info.core = core % cores_per_package;
+    info.smt_index = cpu % threads_per_core;
+    info.numa_node = 0;
+    info.llc = -1;
+    res.push_back(info);
+  }
+  return res;
+}
+#endif
+
+std::vector<CPUInfo::LogicalCpu> GetCPUTopology() {
+#if defined(BENCHMARK_OS_LINUX)
+  return GetCPUTopologyFromKVFS();
+#elif defined(BENCHMARK_OS_WINDOWS)
+  return GetCPUTopologyWindows();
+#elif defined(BENCHMARK_OS_MACOSX)
+  return GetCPUTopologyMacOSX();
+#else
+  return std::vector<CPUInfo::LogicalCpu>();
+#endif
+}
+
 std::string GetSystemName() {
 #if defined(BENCHMARK_OS_WINDOWS)
   std::string str;
@@ -703,19 +917,353 @@ std::vector<double> GetLoadAvg() {
 #endif
 }
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+// The registers CPUID returns for 'leaf' and 'subleaf': eax, ebx, ecx, edx.
+std::array<uint32_t, 4> CPUID(uint32_t leaf, uint32_t subleaf) {
+  std::array<uint32_t, 4> regs = {{0, 0, 0, 0}};
+#if defined(__GNUC__) || defined(__clang__)
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#else
+  int info[4];
+  __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (int i = 0; i < 4; ++i) regs[i] = static_cast<uint32_t>(info[i]);
+#endif
+  return regs;
+}
+
+// The state components that the OS saves on context switches, from XCR0.
+uint64_t XCR0() {
+#if defined(__GNUC__) || defined(__clang__)
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+#else
+  return _xgetbv(0);
+#endif
+}
+#endif
+
+std::vector<std::string> GetCPUFeatures() {
+  std::vector<std::string> features;
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+  // The registers that a feature needs the OS to save, see XCR0().
+  enum State { kSSE = 0x2, kAVX = 0x6, kAVX512 = 0xe6 };
+  struct Feature {
+    const char* name;
+    uint32_t leaf;
+    int reg;  // Index in the registers, see CPUID().
+    int bit;
+    State state;
+  };
+  // Named as by the "target" attribute of GCC and Clang.
+  static const Feature kFeatures[] = {
+      {"sse", 1, 3, 25, kSSE},
+      {"sse2", 1, 3, 26, kSSE},
+      {"sse3", 1, 2, 0, kSSE},
+      {"pclmul", 1, 2, 1, kSSE},
+      {"ssse3", 1, 2, 9, kSSE},
+      {"fma", 1, 2, 12, kAVX},
+      {"cx16", 1, 2, 13, kSSE},
+      {"sse4.1", 1, 2, 19, kSSE},
+      {"sse4.2", 1, 2, 20, kSSE},
+      {"movbe", 1, 2, 22, kSSE},
+      {"popcnt", 1, 2, 23, kSSE},
+      {"aes", 1, 2, 25, kSSE},
+      {"avx", 1, 2, 28, kAVX},
+      {"f16c", 1, 2, 29, kAVX},
+      {"bmi", 7, 1, 3, kSSE},
+      {"avx2", 7, 1, 5, kAVX},
+      {"bmi2", 7, 1, 8, kSSE},
+      {"avx512f", 7, 1, 16, kAVX512},
+      {"avx512dq", 7, 1, 17, kAVX512},
+      {"adx", 7, 1, 19, kSSE},
+      {"avx512ifma", 7, 1, 21, kAVX512},
+      {"avx512cd", 7, 1, 28, kAVX512},
+      {"sha", 7, 1, 29, kSSE},
+      {"avx512bw", 7, 1, 30, kAVX512},
+      {"avx512vl", 7, 1, 31, kAVX512},
+      {"avx512vbmi", 7, 2, 1, kAVX512},
+      {"avx512vbmi2", 7, 2, 6, kAVX512},
+      {"gfni", 7, 2, 8, kSSE},
+      {"vaes", 7, 2, 9, kAVX},
+      {"vpclmulqdq", 7, 2, 10, kAVX},
+      {"avx512vnni", 7, 2, 11, kAVX512},
+      {"avx512bitalg", 7, 2, 12, kAVX512},
+      {"avx512vpopcntdq", 7, 2, 14, kAVX512},
+  };
+  const uint32_t max_leaf = CPUID(0, 0)[0];
+  std::array<uint32_t, 4> leaves[8] = {};
+  for (uint32_t leaf = 1; leaf <= std::min<uint32_t>(max_leaf, 7); ++leaf) {
+    leaves[leaf] = CPUID(leaf, 0);
+  }
+  // The AVX and AVX-512 registers are of no use unless the OS saves them,
+  // while the SSE ones always are on the OSes that run the benchmarks.
+  const bool osxsave = (leaves[1][2] >> 27) & 1;
+  const uint64_t xcr0 = (osxsave ? XCR0() : 0) | kSSE;
+  for (const Feature& feature : kFeatures) {
+    if (feature.leaf <= max_leaf &&
+        ((leaves[feature.leaf][feature.reg] >> feature.bit) & 1) &&
+        (xcr0 & feature.state) == static_cast<uint64_t>(feature.state)) {
+      features.push_back(feature.name);
+    }
+  }
+  // The x86-64 microarchitecture levels, by the features they add.
+  auto has_all = [&features](std::initializer_list<const char*> names) {
+    return std::all_of(names.begin(), names.end(), [&](const char* name) {
+      return std::find(features.begin(), features.end(), name) !=
+             features.end();
+    });
+  };
+  if (has_all({"cx16", "popcnt", "sse3", "sse4.1", "sse4.2", "ssse3"})) {
+    features.push_back("x86-64-v2");
+    if (has_all({"avx", "avx2", "bmi", "bmi2", "f16c", "fma", "movbe"})) {
+      features.push_back("x86-64-v3");
+      if (has_all({"avx512f", "avx512bw", "avx512cd", "avx512dq",
+                   "avx512vl"})) {
+        features.push_back("x86-64-v4");
+      }
+    }
+  }
+#elif defined(__aarch64__)
+  // Advanced SIMD is part of the architecture.
+  features.push_back("neon");
+#if defined(BENCHMARK_OS_LINUX)
+  struct Feature {
+    const char* name;
+    int hwcap;  // AT_HWCAP or AT_HWCAP2.
+    unsigned long bit;
+  };
+  // The bits of HWCAP_* and HWCAP2_*, which not every libc defines.
+  static const Feature kFeatures[] = {
+      {"aes", AT_HWCAP, 1UL << 3},      {"crc", AT_HWCAP, 1UL << 7},
+      {"lse", AT_HWCAP, 1UL << 8},      {"fp16", AT_HWCAP, 1UL << 9},
+      {"dotprod", AT_HWCAP, 1UL << 20}, {"sve", AT_HWCAP, 1UL << 22},
+      {"sve2", AT_HWCAP2, 1UL << 1},    {"i8mm", AT_HWCAP2, 1UL << 13},
+      {"bf16", AT_HWCAP2, 1UL << 14},
+  };
+  const unsigned long hwcap = getauxval(AT_HWCAP);
+  const unsigned long hwcap2 = getauxval(AT_HWCAP2);
+  for (const Feature& feature : kFeatures) {
+    if ((feature.hwcap == AT_HWCAP ? hwcap : hwcap2) & feature.bit) {
+      features.push_back(feature.name);
+    }
+  }
+#endif
+#endif
+  return features;
+}
+
+bool SupportsAll(const std::vector<std::string>& features,
+                 const std::string& variant) {
+  if (variant == "scalar") return true;
+  for (const std::string& feature : StrSplit(variant, '+')) {
+    if (std::find(features.begin(), features.end(), feature) ==
+        features.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const std::vector<std::string>& CPUFeatures() {
+  static const std::vector<std::string>* features =
+      new std::vector<std::string>(GetCPUFeatures());
+  return *features;
+}
+
+// The info of the host that is cached, probed, or read from the cache of
+// --benchmark_sysinfo_cache_dir and written there if it wasn't.
+internal::CachedCPUInfo GetCachedCPUInfo(CPUInfo::Scaling scaling) {
+  const std::string dir = absl::GetFlag(FLAGS_benchmark_sysinfo_cache_dir);
+  const std::string path =
+      dir.empty() ? ""
+                  : internal::CPUInfoCachePath(dir, SystemInfo::Get().name);
+  const std::string key = internal::CPUInfoCacheKey(scaling);
+  internal::CachedCPUInfo info;
+  if (!path.empty() && internal::ReadCPUInfoCache(path, key, &info)) {
+    return info;
+  }
+  info.cycles_per_second = GetCPUCyclesPerSecond(scaling);
+  info.caches = internal::CPUCaches();
+  info.features = CPUFeatures();
+  info.topology = internal::CPUTopology();
+  if (!path.empty()) {
+#ifdef BENCHMARK_OS_WINDOWS
+    _mkdir(dir.c_str());
+#else
+    mkdir(dir.c_str(), 0777);
+#endif
+    internal::WriteCPUInfoCache(path, key, info);
+  }
+  return info;
+}
+
 }  // end namespace
 
+namespace internal {
+
+int NumCPUs() {
+  static const int num_cpus = GetNumCPUs();
+  return num_cpus;
+}
+
+const std::vector<CPUInfo::CacheInfo>& CPUCaches() {
+  static const std::vector<CPUInfo::CacheInfo>* caches =
+      new std::vector<CPUInfo::CacheInfo>(GetCacheSizes());
+  return *caches;
+}
+
+bool CPUSupports(const std::string& variant) {
+  return SupportsAll(CPUFeatures(), variant);
+}
+
+const std::vector<CPUInfo::LogicalCpu>& CPUTopology() {
+  static const std::vector<CPUInfo::LogicalCpu>* topology =
+      new std::vector<CPUInfo::LogicalCpu>(GetCPUTopology());
+  return *topology;
+}
+
+void CountTopology(const std::vector<CPUInfo::LogicalCpu>& topology,
+                   int* num_packages, int* num_cores, int* num_numa_nodes) {
+  std::set<int> packages;
+  std::set<std::pair<int, int> > cores;
+  std::set<int> nodes;
+  for (const CPUInfo::LogicalCpu& cpu : topology) {
+    if (cpu.package >= 0) packages.insert(cpu.package);
+    if (cpu.core >= 0) cores.insert(std::make_pair(cpu.package, cpu.core));
+    if (cpu.numa_node >= 0) nodes.insert(cpu.numa_node);
+  }
+  *num_packages = static_cast<int>(packages.size());
+  *num_cores = static_cast<int>(cores.size());
+  *num_numa_nodes = static_cast<int>(nodes.size());
+}
+
+std::string CPUInfoCacheKey(CPUInfo::Scaling scaling) {
+  std::string boot_id;
+  std::string online;
+#ifdef BENCHMARK_OS_LINUX
+  ReadFromFile("/proc/sys/kernel/random/boot_id", &boot_id);
+  ReadFromFile("/sys/devices/system/cpu/online", &online);
+#endif
+  return StrFormat("%s %s %s %d", SystemInfo::Get().name.c_str(),
+                   boot_id.empty() ? "-" : boot_id.c_str(),
+                   online.empty() ? "-" : online.c_str(),
+                   static_cast<int>(scaling));
+}
+
+std::string CPUInfoCachePath(const std::string& dir, const std::string& host) {
+  std::string file = "sysinfo_";
+  for (char c : host) {
+    const bool keep = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                      (c >= '0' && c <= '9') || c == '_' || c == '-' ||
+                      c == '.';
+    file.push_back(keep ? c : '_');
+  }
+  return dir + "/" + file + ".txt";
+}
+
+// The first line of the cache, followed by one line per field, which starts
+// with its name.
+const char kCacheVersion[] = "benchmark sysinfo cache 2";
+
+bool ReadCPUInfoCache(const std::string& path, const std::string& key,
+                      CachedCPUInfo* info) {
+  std::ifstream file(path.c_str());
+  std::string line;
+  if (!std::getline(file, line) || line != kCacheVersion ||
+      !std::getline(file, line) || line != "key " + key) {
+    return false;
+  }
+  CachedCPUInfo result;
+  bool has_cycles = false;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string name;
+    fields >> name;
+    if (name == "cycles_per_second") {
+      has_cycles = static_cast<bool>(fields >> result.cycles_per_second);
+    } else if (name == "cache") {
+      CPUInfo::CacheInfo cache;
+      if (!(fields >> cache.type >> cache.level >> cache.size >>
+            cache.num_sharing)) {
+        return false;
+      }
+      result.caches.push_back(cache);
+    } else if (name == "cpu") {
+      CPUInfo::LogicalCpu cpu;
+      if (!(fields >> cpu.cpu >> cpu.package >> cpu.core >> cpu.smt_index >>
+            cpu.numa_node >> cpu.llc)) {
+        return false;
+      }
+      result.topology.push_back(cpu);
+    } else if (name == "features") {
+      std::string feature;
+      while (fields >> feature) result.features.push_back(feature);
+    } else {
+      return false;
+    }
+  }
+  if (!has_cycles) return false;
+  *info = result;
+  return true;
+}
+
+void WriteCPUInfoCache(const std::string& path, const std::string& key,
+                       const CachedCPUInfo& info) {
+  const std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary.c_str());
+    file << kCacheVersion << "\n";
+    file << "key " << key << "\n";
+    file << StrFormat("cycles_per_second %.17g\n", info.cycles_per_second);
+    for (const CPUInfo::CacheInfo& cache : info.caches) {
+      file << "cache " << cache.type << " " << cache.level << " " << cache.size
+           << " " << cache.num_sharing << "\n";
+    }
+    for (const CPUInfo::LogicalCpu& cpu : info.topology) {
+      file << "cpu " << cpu.cpu << " " << cpu.package << " " << cpu.core << " "
+           << cpu.smt_index << " " << cpu.numa_node << " " << cpu.llc << "\n";
+    }
+    file << "features";
+    for (const std::string& feature : info.features) file << " " << feature;
+    file << "\n";
+    if (!file) {
+      std::remove(temporary.c_str());
+      return;
+    }
+  }
+  std::rename(temporary.c_str(), path.c_str());
+}
+
+}  // namespace internal
+
 const CPUInfo& CPUInfo::Get() {
   static const CPUInfo* info = new CPUInfo();
   return *info;
 }
 
 CPUInfo::CPUInfo()
-    : num_cpus(GetNumCPUs()),
+    : num_cpus(internal::NumCPUs()),
       scaling(CpuScaling(num_cpus)),
-      cycles_per_second(GetCPUCyclesPerSecond(scaling)),
-      caches(GetCacheSizes()),
-      load_avg(GetLoadAvg()) {}
+      cycles_per_second(0),
+      num_packages(0),
+      num_cores(0),
+      num_numa_nodes(0),
+      load_avg(GetLoadAvg()) {
+  internal::CachedCPUInfo info = GetCachedCPUInfo(scaling);
+  cycles_per_second = info.cycles_per_second;
+  caches.swap(info.caches);
+  features.swap(info.features);
+  topology.swap(info.topology);
+  internal::CountTopology(topology, &num_packages, &num_cores,
+                          &num_numa_nodes);
+}
+
+bool CPUInfo::Supports(const std::string& variant) const {
+  return SupportsAll(features, variant);
+}
 
 const SystemInfo& SystemInfo::Get() {
   static const SystemInfo* info = new SystemInfo();
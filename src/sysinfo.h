@@ -0,0 +1,53 @@
+#ifndef BENCHMARK_SYSINFO_H_
+#define BENCHMARK_SYSINFO_H_
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+namespace internal {
+
+// The parts of CPUInfo that the library needs to register and run the
+// benchmarks, each probed the first time it is asked for, rather than all of
+// CPUInfo, which is only needed to report the context.
+int NumCPUs();
+const std::vector<CPUInfo::CacheInfo>& CPUCaches();
+bool CPUSupports(const std::string& variant);
+const std::vector<CPUInfo::LogicalCpu>& CPUTopology();
+
+// The distinct packages, cores and NUMA nodes of 'topology'.
+void CountTopology(const std::vector<CPUInfo::LogicalCpu>& topology,
+                   int* num_packages, int* num_cores, int* num_numa_nodes);
+
+// What --benchmark_sysinfo_cache_dir keeps of CPUInfo: what takes long to
+// probe and does not change until the host reboots, or a cpu goes offline.
+struct CachedCPUInfo {
+  double cycles_per_second;
+  std::vector<CPUInfo::CacheInfo> caches;
+  std::vector<std::string> features;
+  std::vector<CPUInfo::LogicalCpu> topology;
+};
+
+// What identifies the host, its boot, its online cpus and its frequency
+// scaling, which the cycles per second depend on, in the cache.
+std::string CPUInfoCacheKey(CPUInfo::Scaling scaling);
+
+// The file in 'dir' that the CPUInfo of the host named 'host' is cached in.
+std::string CPUInfoCachePath(const std::string& dir, const std::string& host);
+
+// Read the info cached in 'path' under 'key' into 'info'. Returns false if the
+// file is missing, malformed or was written under another key.
+bool ReadCPUInfoCache(const std::string& path, const std::string& key,
+                      CachedCPUInfo* info);
+
+// Write 'info' to 'path' under 'key', through a temporary file so that the
+// processes starting at the same time never read half of it.
+void WriteCPUInfoCache(const std::string& path, const std::string& key,
+                       const CachedCPUInfo& info);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_SYSINFO_H_
@@ -0,0 +1,225 @@
+// Copyright 2021 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "run_columns.h"
+
+// The output is RFC 4180 CSV: a header with the names of the columns, then a
+// line per run. The fields with a comma, a double quote or a line break are
+// in double quotes, with the double quotes in them doubled. Doubles have the
+// 17 significant digits of the JSON output, and NaN is left empty.
+
+namespace benchmark {
+
+namespace {
+
+// The output is written in chunks of about this many bytes.
+constexpr size_t kChunkSize = 1 << 20;
+// The runs are held until their fields take this many bytes, for the
+// counters of the header.
+constexpr size_t kMaxBufferedBytes = 16 << 20;
+
+void AppendInt(std::string* out, int64_t value) {
+  char digits[24];
+  char* end = digits + sizeof(digits);
+  char* p = end;
+  uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value)
+                                 : static_cast<uint64_t>(value);
+  do {
+    *--p = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (value < 0) *--p = '-';
+  out->append(p, static_cast<size_t>(end - p));
+}
+
+void AppendDouble(std::string* out, double value) {
+  if (std::isnan(value)) return;
+  char digits[32];
+  const int size = std::snprintf(digits, sizeof(digits), "%.17g", value);
+  out->append(digits, static_cast<size_t>(size));
+}
+
+void AppendField(std::string* out, const std::string& value) {
+  if (value.find_first_of(",\"\r\n") == std::string::npos) {
+    out->append(value);
+    return;
+  }
+  *out += '"';
+  size_t begin = 0;
+  for (size_t quote = value.find('"'); quote != std::string::npos;
+       quote = value.find('"', begin)) {
+    out->append(value, begin, quote + 1 - begin);
+    *out += '"';
+    begin = quote + 1;
+  }
+  out->append(value, begin, std::string::npos);
+  *out += '"';
+}
+
+// Append the fields of 'run' to 'out', with 'values' to hold them.
+void AppendFields(std::string* out, const BenchmarkReporter::Run& run,
+                  internal::RunValue* values) {
+  internal::GetRunValues(run, values);
+  for (int c = 0; c < internal::kNumRunColumns; ++c) {
+    if (c != 0) *out += ',';
+    const internal::RunValue& value = values[c];
+    switch (internal::kRunColumns[c].type) {
+      case internal::kInt64Column:
+        AppendInt(out, value.int_value);
+        break;
+      case internal::kDoubleColumn:
+        AppendDouble(out, value.double_value);
+        break;
+      case internal::kStringColumn:
+        AppendField(out, value.string_value);
+        break;
+    }
+  }
+}
+
+}  // end namespace
+
+bool TableReporter::ReportContext(const Context&) {
+  // Only the runs, so that the output loads as it is. The context is in the
+  // output of the other formats.
+  return true;
+}
+
+void TableReporter::ReportRuns(const std::vector<Run>& reports) {
+  if (!schema_fixed_) {
+    BufferRuns(reports);
+    if (rows_.size() >= kMaxBufferedBytes) FixSchema();
+    return;
+  }
+  std::string chunk;
+  std::vector<internal::RunValue> values(internal::kNumRunColumns);
+  for (const Run& run : reports) {
+    AppendFields(&chunk, run, values.data());
+    // Both are in the order of the names.
+    std::string others;
+    size_t column = 0;
+    for (const auto& counter : run.counters) {
+      while (column < schema_.size() && schema_[column] < counter.first) {
+        chunk += ',';
+        ++column;
+      }
+      if (column < schema_.size() && schema_[column] == counter.first) {
+        chunk += ',';
+        AppendDouble(&chunk, counter.second);
+        ++column;
+        continue;
+      }
+      if (!others.empty()) others += ';';
+      others += counter.first;
+      others += '=';
+      AppendDouble(&others, counter.second);
+    }
+    for (; column < schema_.size(); ++column) chunk += ',';
+    chunk += ',';
+    AppendField(&chunk, others);
+    chunk += '\n';
+  }
+  Write(chunk);
+}
+
+void TableReporter::Finalize() {
+  if (!schema_fixed_) FixSchema();
+  schema_fixed_ = false;
+  schema_.clear();
+}
+
+void TableReporter::BufferRuns(const std::vector<Run>& reports) {
+  std::vector<internal::RunValue> values(internal::kNumRunColumns);
+  for (const Run& run : reports) {
+    AppendFields(&rows_, run, values.data());
+    row_ends_.push_back(rows_.size());
+
+    for (const auto& counter : run.counters) {
+      const uint32_t id = static_cast<uint32_t>(counter_ids_.size());
+      const auto it = counter_ids_.insert(std::make_pair(counter.first, id));
+      counters_.push_back(std::make_pair(it.first->second, counter.second));
+    }
+    counter_ends_.push_back(counters_.size());
+  }
+}
+
+void TableReporter::FixSchema() {
+  // The counters are in the order of their names, like those of each run.
+  std::vector<uint32_t> column_of(counter_ids_.size());
+  for (const auto& kv : counter_ids_) {
+    column_of[kv.second] = static_cast<uint32_t>(schema_.size());
+    schema_.push_back(kv.first);
+  }
+
+  std::string chunk;
+  chunk.reserve(kChunkSize + (kChunkSize >> 2));
+  for (int c = 0; c < internal::kNumRunColumns; ++c) {
+    if (c != 0) chunk += ',';
+    chunk += internal::kRunColumns[c].name;
+  }
+  for (const std::string& name : schema_) {
+    chunk += ',';
+    AppendField(&chunk, name);
+  }
+  chunk += ",other_counters\n";
+
+  size_t row_begin = 0;
+  size_t counter = 0;
+  for (size_t row = 0; row < row_ends_.size(); ++row) {
+    chunk.append(rows_, row_begin, row_ends_[row] - row_begin);
+    row_begin = row_ends_[row];
+    for (uint32_t c = 0; c < column_of.size(); ++c) {
+      chunk += ',';
+      if (counter < counter_ends_[row] &&
+          column_of[counters_[counter].first] == c) {
+        AppendDouble(&chunk, counters_[counter].second);
+        ++counter;
+      }
+    }
+    // All of their counters have columns.
+    chunk += ",\n";
+    if (chunk.size() >= kChunkSize) {
+      Write(chunk);
+      chunk.clear();
+    }
+  }
+  Write(chunk);
+
+  // Freed, as the runs after these are written as they come.
+  std::string().swap(rows_);
+  std::vector<size_t>().swap(row_ends_);
+  std::vector<std::pair<uint32_t, double> >().swap(counters_);
+  std::vector<size_t>().swap(counter_ends_);
+  counter_ids_.clear();
+  schema_fixed_ = true;
+}
+
+void TableReporter::Write(const std::string& chunk) {
+  std::ostream& out = GetOutputStream();
+  out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+  out.flush();
+}
+
+}  // end namespace benchmark
@@ -1,35 +1,90 @@
 #ifndef BENCHMARK_THREAD_MANAGER_H
 #define BENCHMARK_THREAD_MANAGER_H
 
+#include <algorithm>
 #include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "benchmark/benchmark.h"
+#include "counter.h"
+#include "latency_histogram.h"
 #include "mutex.h"
+#include "region.h"
+#include "spin_barrier.h"
+#include "trace.h"
 
 namespace benchmark {
 namespace internal {
 
 class ThreadManager {
  public:
-  explicit ThreadManager(int num_threads)
-      : alive_threads_(num_threads), start_stop_barrier_(num_threads) {}
+  explicit ThreadManager(int num_threads, bool use_spin_barrier = false)
+      : num_threads_(num_threads),
+        alive_threads_(num_threads),
+        use_spin_barrier_(use_spin_barrier),
+        start_stop_barrier_(num_threads),
+        spin_barrier_(num_threads),
+        shared_iterations_(0),
+        iterations_shared_(false),
+        repetition_index_(0),
+        record_samples_(false),
+        thread_results_(num_threads) {}
+
+  int num_threads() const { return num_threads_; }
+
+  // The repetition that the threads run, for State::repetition_index().
+  int64_t repetition_index() const { return repetition_index_; }
+  void set_repetition_index(int64_t index) { repetition_index_ = index; }
+
+  // Whether each chunk of the iterations of a thread is a sample of its time,
+  // for Samples().
+  bool record_samples() const { return record_samples_; }
+  void set_record_samples(bool record) { record_samples_ = record; }
 
   Mutex& GetBenchmarkMutex() const RETURN_CAPABILITY(benchmark_mutex_) {
     return benchmark_mutex_;
   }
 
   bool StartStopBarrier() EXCLUDES(end_cond_mutex_) {
-    return start_stop_barrier_.wait();
+    TraceScope trace("threads", "barrier");
+    return use_spin_barrier_ ? spin_barrier_.wait()
+                             : start_stop_barrier_.wait();
   }
 
   void NotifyThreadComplete() EXCLUDES(end_cond_mutex_) {
-    start_stop_barrier_.removeThread();
+    if (use_spin_barrier_) {
+      spin_barrier_.removeThread();
+    } else {
+      start_stop_barrier_.removeThread();
+    }
     if (--alive_threads_ == 0) {
       MutexLock lock(end_cond_mutex_);
       end_condition_.notify_all();
     }
   }
 
+  // Share 'iterations' between the threads of a FixedWork() run, for them
+  // to take with TakeSharedIterations().
+  void ShareIterations(IterationCount iterations) {
+    shared_iterations_.store(iterations, std::memory_order_relaxed);
+    iterations_shared_ = true;
+  }
+
+  // Take up to 'chunk' of the shared iterations left. Returns how many were
+  // taken, 0 once they are all gone.
+  IterationCount TakeSharedIterations(IterationCount chunk) {
+    IterationCount left = shared_iterations_.load(std::memory_order_relaxed);
+    IterationCount taken;
+    do {
+      taken = std::min(chunk, left);
+    } while (taken != 0 && !shared_iterations_.compare_exchange_weak(
+                               left, left - taken, std::memory_order_relaxed));
+    return taken;
+  }
+
   void WaitForAllThreads() EXCLUDES(end_cond_mutex_) {
     MutexLock lock(end_cond_mutex_);
     end_condition_.wait(lock.native_handle(),
@@ -38,24 +93,238 @@ class ThreadManager {
 
  public:
   struct Result {
+    // The processes whose threads these are the results of, more than one
+    // for the leader of a Coordinator.
+    int processes = 1;
     IterationCount iterations = 0;
     double real_time_used = 0;
     double cpu_time_used = 0;
     double manual_time_used = 0;
+    // The pause overhead subtracted from the real and CPU times.
+    double real_time_overhead = 0;
+    double cpu_time_overhead = 0;
+    // The slices the timers ran for, see ThreadTimer::num_slices().
+    int64_t timed_slices = 0;
+    // When the thread started and finished the loop of the benchmark, by
+    // ChronoClockNow() and inside the barriers, and how long the rest of the
+    // benchmark took, in seconds. Of the thread only, never reduced.
+    double loop_start = 0;
+    double loop_end = 0;
+    double setup_time = 0;
     int64_t complexity_n = 0;
+    std::vector<int64_t> complexity_ns;
     std::string report_label_;
     std::string error_message_;
     bool has_error_ = false;
+    // Whether the caches were flushed.
+    bool cold_cache = false;
     UserCounters counters;
+    // Where the threads ran, if they were pinned; in thread order.
+    std::vector<int> thread_cpus;
+    std::vector<int> thread_numa_nodes;
+    // The iterations and times of each thread; in thread order.
+    std::vector<IterationCount> thread_iterations;
+    std::vector<double> thread_real_times;
+    std::vector<double> thread_cpu_times;
+    // The real time per iteration of each Samples() of the iterations, in
+    // seconds, summed over the threads.
+    std::vector<double> sample_times;
+    LatencyHistogram latency_histogram;
+    // Recorded by the TimeSeriesSampler, if any.
+    std::vector<BenchmarkReporter::TimeSeriesSample> time_series;
+    // The iterations per second of all the threads over each interval of
+    // IntervalThroughput(), if any; of this process only.
+    std::vector<double> interval_rates;
+    // The role of the thread in the ThreadGroups(), if any, in the results of
+    // a thread.
+    std::string role;
+    // The results of each role, in the order the threads of the roles come,
+    // summed over the threads of the role as those above are over all of
+    // them.
+    struct RoleResult {
+      std::string name;
+      int threads = 0;
+      IterationCount iterations = 0;
+      double real_time_used = 0;
+      double cpu_time_used = 0;
+      double manual_time_used = 0;
+      UserCounters counters;
+    };
+    std::vector<RoleResult> roles;
   };
   GUARDED_BY(GetBenchmarkMutex()) Result results;
 
+  // The slot into which the thread 'thread_id' accumulates its own stats.
+  // Each thread only ever touches its own slot, so no lock is needed.
+  Result& GetThreadResult(int thread_id) {
+    BM_CHECK(thread_id >= 0 &&
+             static_cast<size_t>(thread_id) < thread_results_.size());
+    return thread_results_[thread_id].result;
+  }
+
+  // Where the Regions of the thread 'thread_id' accumulate. Only that thread
+  // touches it.
+  RegionProfile& GetThreadRegions(int thread_id) {
+    return thread_results_[static_cast<size_t>(thread_id)].regions;
+  }
+
+  // Publish that the thread 'thread_id' is done with 'iterations' iterations,
+  // for TotalProgress().
+  void SetThreadProgress(int thread_id, IterationCount iterations) {
+    thread_results_[thread_id].progress.store(iterations,
+                                              std::memory_order_relaxed);
+  }
+
+  // The iterations done by all the threads so far, as published with
+  // SetThreadProgress(). Safe to call while the threads are running.
+  IterationCount TotalProgress() const {
+    IterationCount total = 0;
+    for (const ThreadResult& t : thread_results_) {
+      total += t.progress.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  // The totals of the shared counters so far. Safe to call while the threads
+  // are running.
+  void SampleSharedCounters(std::map<std::string, double>* totals)
+      EXCLUDES(shared_counters_mutex_) {
+    MutexLock l(shared_counters_mutex_);
+    for (const std::unique_ptr<SharedCounterEntry>& e : shared_counters_) {
+      (*totals)[e->name] = SumSharedCounterSlots(e->slots.get(), num_threads_);
+    }
+  }
+
+  // Add the stats of all the threads into 'results', in thread order.
+  // REQUIRES: WaitForAllThreads() returned.
+  void ReduceThreadResults()
+      EXCLUDES(benchmark_mutex_, shared_counters_mutex_) {
+    MutexLock l(benchmark_mutex_);
+    for (const ThreadResult& t : thread_results_) {
+      results.iterations += t.result.iterations;
+      results.cpu_time_used += t.result.cpu_time_used;
+      results.real_time_used += t.result.real_time_used;
+      results.manual_time_used += t.result.manual_time_used;
+      results.real_time_overhead += t.result.real_time_overhead;
+      results.cpu_time_overhead += t.result.cpu_time_overhead;
+      results.timed_slices += t.result.timed_slices;
+      results.complexity_n += t.result.complexity_n;
+      // The threads run the same inputs, so take those of the first one.
+      if (results.complexity_ns.empty())
+        results.complexity_ns = t.result.complexity_ns;
+      results.cold_cache = results.cold_cache || t.result.cold_cache;
+      Increment(&results.counters, t.result.counters);
+      results.thread_cpus.insert(results.thread_cpus.end(),
+                                 t.result.thread_cpus.begin(),
+                                 t.result.thread_cpus.end());
+      results.thread_numa_nodes.insert(results.thread_numa_nodes.end(),
+                                       t.result.thread_numa_nodes.begin(),
+                                       t.result.thread_numa_nodes.end());
+      results.thread_iterations.push_back(t.result.iterations);
+      results.thread_real_times.push_back(t.result.real_time_used);
+      results.thread_cpu_times.push_back(t.result.cpu_time_used);
+      // The threads run as many samples, of as many iterations, unless they
+      // share them: then each ran those of the iterations it took.
+      if (iterations_shared_) {
+        results.sample_times.insert(results.sample_times.end(),
+                                    t.result.sample_times.begin(),
+                                    t.result.sample_times.end());
+      } else if (results.sample_times.empty()) {
+        results.sample_times = t.result.sample_times;
+      } else {
+        const size_t samples = std::min(results.sample_times.size(),
+                                        t.result.sample_times.size());
+        results.sample_times.resize(samples);
+        for (size_t s = 0; s < samples; ++s)
+          results.sample_times[s] += t.result.sample_times[s];
+      }
+      results.latency_histogram.Merge(t.result.latency_histogram);
+      if (!t.result.role.empty()) {
+        if (results.roles.empty() ||
+            results.roles.back().name != t.result.role) {
+          results.roles.emplace_back();
+          results.roles.back().name = t.result.role;
+        }
+        Result::RoleResult& role = results.roles.back();
+        ++role.threads;
+        role.iterations += t.result.iterations;
+        role.real_time_used += t.result.real_time_used;
+        role.cpu_time_used += t.result.cpu_time_used;
+        role.manual_time_used += t.result.manual_time_used;
+        Increment(&role.counters, t.result.counters);
+      }
+    }
+    MutexLock shared_lock(shared_counters_mutex_);
+    UserCounters shared;
+    for (const std::unique_ptr<SharedCounterEntry>& e : shared_counters_) {
+      Counter c = e->counter;
+      c.value = SumSharedCounterSlots(e->slots.get(), num_threads_);
+      shared[e->name] = c;
+    }
+    Increment(&results.counters, shared);
+  }
+
+  // The slots of the shared counter 'name', one per thread, created with the
+  // flags of 'counter' by the first thread that registers it.
+  SharedCounterSlot* GetSharedCounterSlots(const std::string& name,
+                                           const Counter& counter)
+      EXCLUDES(shared_counters_mutex_) {
+    MutexLock l(shared_counters_mutex_);
+    for (const std::unique_ptr<SharedCounterEntry>& e : shared_counters_) {
+      if (e->name == name) return e->slots.get();
+    }
+    shared_counters_.emplace_back(new SharedCounterEntry);
+    SharedCounterEntry& e = *shared_counters_.back();
+    e.name = name;
+    e.counter = counter;
+    e.slots.reset(new SharedCounterSlot[num_threads_]);
+    return e.slots.get();
+  }
+
+  static double SumSharedCounterSlots(const SharedCounterSlot* slots,
+                                      int num_threads) {
+    double total = 0;
+    for (int i = 0; i < num_threads; ++i) {
+      total += slots[i].value.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
  private:
+  const int num_threads_;
   mutable Mutex benchmark_mutex_;
   std::atomic<int> alive_threads_;
+  const bool use_spin_barrier_;
   Barrier start_stop_barrier_;
+  SpinBarrier spin_barrier_;
   Mutex end_cond_mutex_;
   Condition end_condition_;
+  std::atomic<IterationCount> shared_iterations_;
+  bool iterations_shared_;
+  int64_t repetition_index_;
+  bool record_samples_;
+
+  // Padded so that the slots of two threads never share a cache line, and the
+  // threads don't contend on it when writing their stats at the end of a run.
+  struct ThreadResult {
+    ThreadResult() : progress(0) {}
+
+    Result result;
+    RegionProfile regions;
+    std::atomic<IterationCount> progress;
+    char padding[64];
+  };
+  std::vector<ThreadResult> thread_results_;
+
+  struct SharedCounterEntry {
+    std::string name;
+    Counter counter;
+    std::unique_ptr<SharedCounterSlot[]> slots;
+  };
+  Mutex shared_counters_mutex_;
+  // Entries are never removed, so the slots stay put once handed out.
+  GUARDED_BY(shared_counters_mutex_)
+  std::vector<std::unique_ptr<SharedCounterEntry> > shared_counters_;
 };
 
 }  // namespace internal
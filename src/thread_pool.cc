@@ -0,0 +1,94 @@
+#include "thread_pool.h"
+
+#include <utility>
+
+#include "check.h"
+
+namespace benchmark {
+namespace internal {
+
+struct ThreadPool::Worker {
+  explicit Worker(int thread_index)
+      : index(thread_index),
+        has_task(false),
+        stop(false),
+        thread(&Worker::Loop, this) {}
+
+  ~Worker() {
+    {
+      MutexLock l(mutex);
+      cond.wait(l.native_handle(), [this]() { return !has_task; });
+      stop = true;
+    }
+    cond.notify_all();
+    thread.join();
+  }
+
+  void Loop() {
+    MutexLock l(mutex);
+    for (;;) {
+      cond.wait(l.native_handle(), [this]() { return has_task || stop; });
+      if (!has_task) return;
+      Task current = std::move(task);
+      l.native_handle().unlock();
+      current(index);
+      l.native_handle().lock();
+      has_task = false;
+      cond.notify_all();
+    }
+  }
+
+  void Assign(const Task& t) {
+    {
+      MutexLock l(mutex);
+      cond.wait(l.native_handle(), [this]() { return !has_task; });
+      task = t;
+      has_task = true;
+    }
+    cond.notify_all();
+  }
+
+  void WaitForIdle() {
+    MutexLock l(mutex);
+    cond.wait(l.native_handle(), [this]() { return !has_task; });
+  }
+
+  const int index;
+  Mutex mutex;
+  Condition cond;
+  Task task;
+  bool has_task;
+  bool stop;
+  // Must be last, the thread starts running Loop() once it is constructed.
+  std::thread thread;
+};
+
+ThreadPool::ThreadPool() : num_dispatched_(0) {}
+
+ThreadPool::~ThreadPool() {}
+
+ThreadPool& ThreadPool::Get() {
+  // Intentionally leaked: the workers are parked for the whole lifetime of the
+  // process, and must not be joined from a static destructor.
+  static ThreadPool* pool = new ThreadPool();
+  return *pool;
+}
+
+void ThreadPool::Dispatch(int num_threads, const Task& task) {
+  BM_CHECK_GT(num_threads, 0);
+  const size_t num_workers = static_cast<size_t>(num_threads - 1);
+  while (workers_.size() < num_workers) {
+    const int thread_index = static_cast<int>(workers_.size()) + 1;
+    workers_.emplace_back(new Worker(thread_index));
+  }
+  for (size_t i = 0; i < num_workers; ++i) workers_[i]->Assign(task);
+  num_dispatched_ = num_workers;
+}
+
+void ThreadPool::WaitForIdle() {
+  for (size_t i = 0; i < num_dispatched_; ++i) workers_[i]->WaitForIdle();
+  num_dispatched_ = 0;
+}
+
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,56 @@
+#ifndef BENCHMARK_THREAD_POOL_H
+#define BENCHMARK_THREAD_POOL_H
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "mutex.h"
+
+namespace benchmark {
+namespace internal {
+
+// A process-wide set of worker threads used to run all but the first thread
+// of a multi-threaded benchmark. Workers are created on demand, the first time
+// that many threads are needed, and are then parked on a condition variable
+// between runs instead of being joined. This way, the probing iterations and
+// the repetitions of a benchmark don't pay for thread creation and teardown.
+// Benchmarks run concurrently (see --benchmark_parallel_jobs) each use a pool
+// of their own instead, whose workers are joined when it is destroyed.
+class ThreadPool {
+ public:
+  typedef std::function<void(int)> Task;
+
+  ThreadPool();
+  ~ThreadPool();
+
+  // The process-wide pool.
+  static ThreadPool& Get();
+
+  // Run 'task(thread_index)' for every 'thread_index' in [1, num_threads),
+  // each on its own worker. The same 'thread_index' is always served by the
+  // same worker thread. Returns without waiting for the tasks to finish.
+  // REQUIRES: The previous dispatch, if any, was waited for.
+  void Dispatch(int num_threads, const Task& task);
+
+  // Wait until all of the tasks handed out by the last Dispatch() returned.
+  void WaitForIdle();
+
+  // The number of worker threads created so far.
+  size_t NumWorkers() const { return workers_.size(); }
+
+ private:
+  struct Worker;
+
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  size_t num_dispatched_;
+};
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_THREAD_POOL_H
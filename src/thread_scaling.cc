@@ -0,0 +1,204 @@
+#include "thread_scaling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+
+#include "check.h"
+#include "complexity.h"
+
+namespace benchmark {
+
+namespace {
+
+struct ThreadCountStats {
+  ThreadCountStats()
+      : iterations(0), real_time(0), cpu_time(0), name_index(0) {}
+
+  double iterations;
+  double real_time;
+  double cpu_time;
+  // The report to name the aggregate after.
+  size_t name_index;
+};
+
+// What the runs of a set of arguments are scaled by: the threads, or the
+// operations in flight per thread, see Benchmark::InFlightRange().
+enum ScalingAxis { kThreadsAxis, kInFlightAxis };
+
+}  // end namespace
+
+ScalabilityFit FitScalability(const std::vector<double>& threads,
+                              const std::vector<double>& throughputs) {
+  BM_CHECK_EQ(threads.size(), throughputs.size());
+  ScalabilityFit best;
+  if (threads.empty()) return best;
+
+  // n / X(n) = 1 / lambda + (sigma / lambda) * (n - 1) +
+  //            (kappa / lambda) * n * (n - 1), which is linear.
+  std::vector<std::vector<double> > x(3);
+  std::vector<double> y;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    const double n = threads[i];
+    x[0].push_back(1);
+    x[1].push_back(n - 1);
+    x[2].push_back(n * (n - 1));
+    y.push_back(n / throughputs[i]);
+  }
+
+  // Try the full model first, then those without kappa, sigma or both, and
+  // keep the best fit with no negative coefficient.
+  const bool kModels[][3] = {{true, true, true},
+                             {true, true, false},
+                             {true, false, true},
+                             {true, false, false}};
+  bool found = false;
+  for (const auto& model : kModels) {
+    // Kappa can't be told apart from sigma with two thread counts.
+    if (model[2] && model[1] && threads.size() < 3) continue;
+    std::vector<double> coef;
+    if (!LinearLeastSquares(x, y, std::vector<bool>(model, model + 3), &coef))
+      continue;
+    if (coef[0] <= 0 || coef[1] < 0 || coef[2] < 0) continue;
+    ScalabilityFit fit;
+    fit.lambda = 1 / coef[0];
+    fit.sigma = coef[1] / coef[0];
+    fit.kappa = coef[2] / coef[0];
+    double sum_squares = 0;
+    for (size_t i = 0; i < threads.size(); ++i) {
+      const double n = threads[i];
+      const double predicted =
+          fit.lambda * n / (1 + fit.sigma * (n - 1) + fit.kappa * n * (n - 1));
+      const double error = (predicted - throughputs[i]) / throughputs[i];
+      sum_squares += error * error;
+    }
+    fit.rms = std::sqrt(sum_squares / static_cast<double>(threads.size()));
+    if (!found || fit.rms < best.rms) best = fit;
+    found = true;
+  }
+  return best;
+}
+
+namespace {
+
+// Append the aggregates of ComputeThreadScaling() along 'axis' to 'results'.
+void ComputeScaling(const std::vector<BenchmarkReporter::Run>& reports,
+                    ScalingAxis axis,
+                    std::vector<BenchmarkReporter::Run>* results) {
+  typedef BenchmarkReporter::Run Run;
+  const bool in_flight = axis == kInFlightAxis;
+  const std::string prefix = in_flight ? "in_flight_" : "";
+
+  // The runs of each set of arguments (everything in the name but the
+  // axis), in the order they first ran, and their repetitions summed up
+  // per thread count, or per operations in flight.
+  std::vector<std::string> groups;
+  std::map<std::string, std::map<int64_t, ThreadCountStats> > stats;
+  for (size_t i = 0; i < reports.size(); ++i) {
+    const Run& run = reports[i];
+    if (run.run_type != Run::RT_Iteration || run.error_occurred) continue;
+    if (in_flight && run.in_flight == 0) continue;
+    BenchmarkName name = run.run_name;
+    (in_flight ? name.in_flight : name.threads).clear();
+    const std::string key = name.str();
+    const int64_t n = in_flight ? run.in_flight : run.threads;
+    if (stats.find(key) == stats.end()) groups.push_back(key);
+    std::map<int64_t, ThreadCountStats>& group = stats[key];
+    if (group.find(n) == group.end()) group[n].name_index = i;
+    ThreadCountStats& s = group[n];
+    s.iterations += static_cast<double>(run.iterations);
+    s.real_time += run.real_accumulated_time;
+    s.cpu_time += run.cpu_accumulated_time;
+  }
+
+  for (const std::string& key : groups) {
+    const std::map<int64_t, ThreadCountStats>& group = stats[key];
+    if (group.size() < 2) continue;
+
+    std::vector<double> threads;
+    std::vector<double> throughputs;
+    for (const auto& kv : group) {
+      threads.push_back(static_cast<double>(kv.first));
+      throughputs.push_back(kv.second.iterations / kv.second.real_time);
+    }
+    const ScalabilityFit fit = FitScalability(threads, throughputs);
+
+    // The speedups are relative to one thread (or operation in flight), if
+    // it ran, and to the fitted throughput of one otherwise. The work done
+    // per cpu second is relative to the fewest that ran.
+    const auto& fewest = *group.begin();
+    const double base_throughput =
+        fewest.first == 1 ? throughputs.front() : fit.lambda;
+    const double base_cpu_throughput =
+        fewest.second.iterations / fewest.second.cpu_time;
+    size_t i = 0;
+    for (const auto& kv : group) {
+      const Run& named = reports[kv.second.name_index];
+      const double speedup = throughputs[i++] / base_throughput;
+      Run efficiency;
+      efficiency.run_name = named.run_name;
+      efficiency.family_index = named.family_index;
+      efficiency.per_family_instance_index = named.per_family_instance_index;
+      efficiency.tags = named.tags;
+      efficiency.run_type = Run::RT_Aggregate;
+      efficiency.aggregate_name = prefix + "efficiency";
+      efficiency.aggregate_unit = StatisticUnit::kPercentage;
+      efficiency.report_label = named.report_label;
+      efficiency.iterations = 0;
+      efficiency.repetitions = named.repetitions;
+      efficiency.repetition_index = Run::no_repetition_index;
+      efficiency.threads = in_flight ? named.threads : kv.first;
+      efficiency.in_flight = in_flight ? kv.first : named.in_flight;
+      efficiency.time_unit = named.time_unit;
+      efficiency.real_accumulated_time =
+          speedup / static_cast<double>(kv.first);
+      efficiency.cpu_accumulated_time =
+          kv.second.iterations / kv.second.cpu_time / base_cpu_throughput;
+      efficiency.counters["speedup"] = Counter(speedup);
+      results->push_back(efficiency);
+    }
+
+    // The time per iteration of one thread, or operation in flight, as
+    // fitted.
+    const Run& named = reports[group.rbegin()->second.name_index];
+    Run usl;
+    usl.run_name = named.run_name;
+    (in_flight ? usl.run_name.in_flight : usl.run_name.threads).clear();
+    usl.family_index = named.family_index;
+    usl.per_family_instance_index = named.per_family_instance_index;
+    usl.tags = named.tags;
+    usl.run_type = Run::RT_Aggregate;
+    usl.aggregate_name = prefix + "USL";
+    usl.aggregate_unit = StatisticUnit::kTime;
+    usl.report_label = named.report_label;
+    usl.iterations = 0;
+    usl.repetitions = named.repetitions;
+    usl.repetition_index = Run::no_repetition_index;
+    usl.threads = in_flight ? named.threads : group.rbegin()->first;
+    usl.in_flight = in_flight ? group.rbegin()->first : named.in_flight;
+    usl.time_unit = named.time_unit;
+    usl.real_accumulated_time = fit.lambda > 0 ? 1 / fit.lambda : 0;
+    usl.cpu_accumulated_time = usl.real_accumulated_time;
+    usl.counters["serial_fraction"] = Counter(fit.sigma);
+    usl.counters["coherency"] = Counter(fit.kappa);
+    usl.counters["rms"] = Counter(fit.rms);
+    if (fit.kappa > 0) {
+      usl.counters[in_flight ? "peak_in_flight" : "peak_threads"] =
+          Counter(std::sqrt(std::max(0.0, 1 - fit.sigma) / fit.kappa));
+    }
+    results->push_back(usl);
+  }
+}
+
+}  // end namespace
+
+std::vector<BenchmarkReporter::Run> ComputeThreadScaling(
+    const std::vector<BenchmarkReporter::Run>& reports) {
+  std::vector<BenchmarkReporter::Run> results;
+  ComputeScaling(reports, kThreadsAxis, &results);
+  ComputeScaling(reports, kInFlightAxis, &results);
+  return results;
+}
+
+}  // end namespace benchmark
@@ -0,0 +1,44 @@
+#ifndef BENCHMARK_THREAD_SCALING_H_
+#define BENCHMARK_THREAD_SCALING_H_
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+
+// The Universal Scalability Law, X(n) = lambda * n / (1 + sigma * (n - 1) +
+// kappa * n * (n - 1)), fitted to the throughputs X(n) at n threads:
+//   - lambda : the throughput of one thread.
+//   - sigma  : the contention, or serial, fraction. With kappa = 0, this is
+//              Amdahl's law.
+//   - kappa  : the coherency cost, which makes the throughput fall past
+//              sqrt((1 - sigma) / kappa) threads.
+//   - rms    : the root mean square of the relative errors of the fit.
+struct ScalabilityFit {
+  ScalabilityFit() : lambda(0), sigma(0), kappa(0), rms(0) {}
+
+  double lambda;
+  double sigma;
+  double kappa;
+  double rms;
+};
+
+// Fit the Universal Scalability Law to the 'throughputs' at 'threads'. Kappa
+// is only fitted with at least three thread counts, and neither sigma nor
+// kappa is ever negative.
+ScalabilityFit FitScalability(const std::vector<double>& threads,
+                              const std::vector<double>& throughputs);
+
+// Return, for each set of arguments that was run at two or more thread counts
+// in the 'reports', an 'efficiency' aggregate with the parallel efficiency and
+// speedup of each thread count, and a 'USL' aggregate with the fitted
+// Universal Scalability Law. The same goes for the sets of arguments that were
+// run at two or more operations in flight, with the 'in_flight_efficiency' and
+// 'in_flight_USL' aggregates.
+std::vector<BenchmarkReporter::Run> ComputeThreadScaling(
+    const std::vector<BenchmarkReporter::Run>& reports);
+
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_THREAD_SCALING_H_
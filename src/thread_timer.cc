@@ -0,0 +1,46 @@
+#include "thread_timer.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace benchmark {
+namespace internal {
+
+ThreadTimer::PauseOverhead ThreadTimer::MeasurePauseOverhead(
+    ThreadTimer timer) {
+  static constexpr int kPauses = 1000;
+  static constexpr int kTrials = 5;
+  // The least overhead over a few trials, so that an interrupt in one of them
+  // doesn't count.
+  PauseOverhead overhead;
+  overhead.real_time = std::numeric_limits<double>::max();
+  overhead.cpu_time = std::numeric_limits<double>::max();
+  for (int trial = 0; trial < kTrials; ++trial) {
+    ThreadTimer paused = timer;
+    paused.StartTimer();
+    for (int i = 0; i < kPauses; ++i) {
+      paused.StopTimer();
+      ClobberMemory();
+      paused.StartTimer();
+    }
+    paused.StopTimer();
+
+    ThreadTimer unpaused = timer;
+    unpaused.StartTimer();
+    for (int i = 0; i < kPauses; ++i) ClobberMemory();
+    unpaused.StopTimer();
+
+    overhead.real_time =
+        std::min(overhead.real_time,
+                 (paused.RawRealTime() - unpaused.RawRealTime()) / kPauses);
+    overhead.cpu_time =
+        std::min(overhead.cpu_time,
+                 (paused.RawCpuTime() - unpaused.RawCpuTime()) / kPauses);
+  }
+  overhead.real_time = std::max(overhead.real_time, 0.0);
+  overhead.cpu_time = std::max(overhead.cpu_time, 0.0);
+  return overhead;
+}
+
+}  // namespace internal
+}  // namespace benchmark
@@ -1,27 +1,77 @@
 #ifndef BENCHMARK_THREAD_TIMER_H
 #define BENCHMARK_THREAD_TIMER_H
 
+#include <algorithm>
+#include <cstdint>
+
 #include "check.h"
+#include "cycleclock.h"
 #include "timers.h"
 
 namespace benchmark {
 namespace internal {
 
 class ThreadTimer {
-  explicit ThreadTimer(bool measure_process_cpu_time_)
-      : measure_process_cpu_time(measure_process_cpu_time_) {}
+ public:
+  // The time an empty PauseTiming()/ResumeTiming() pair adds to what a timer
+  // measures.
+  struct PauseOverhead {
+    PauseOverhead() : real_time(0), cpu_time(0) {}
+    double real_time;
+    double cpu_time;
+  };
+
+ private:
+  explicit ThreadTimer(bool measure_process_cpu_time_,
+                       bool use_cycle_clock_ = false,
+                       int64_t cycle_clock_overhead_ = 0,
+                       PauseOverhead pause_overhead_ = PauseOverhead())
+      : measure_process_cpu_time(measure_process_cpu_time_),
+        use_cycle_clock(use_cycle_clock_),
+        cycle_clock_overhead(cycle_clock_overhead_),
+        seconds_per_cycle(use_cycle_clock_ ? 1 / CycleClockTicksPerSecond()
+                                           : 0),
+        pause_overhead(pause_overhead_) {}
+
+  // Measure the overhead of pausing and resuming 'timer', which must not be
+  // used otherwise.
+  static PauseOverhead MeasurePauseOverhead(ThreadTimer timer);
 
  public:
+  // The pause overhead of each kind of timer is measured the first time one
+  // is created, and then subtracted from the time it measures.
   static ThreadTimer Create() {
-    return ThreadTimer(/*measure_process_cpu_time_=*/false);
+    static const PauseOverhead overhead = MeasurePauseOverhead(
+        ThreadTimer(/*measure_process_cpu_time_=*/false));
+    return ThreadTimer(/*measure_process_cpu_time_=*/false,
+                       /*use_cycle_clock_=*/false, 0, overhead);
   }
   static ThreadTimer CreateProcessCpuTime() {
-    return ThreadTimer(/*measure_process_cpu_time_=*/true);
+    static const PauseOverhead overhead = MeasurePauseOverhead(
+        ThreadTimer(/*measure_process_cpu_time_=*/true));
+    return ThreadTimer(/*measure_process_cpu_time_=*/true,
+                       /*use_cycle_clock_=*/false, 0, overhead);
+  }
+  // Times the slices with cycleclock::NowSerialized() alone, and reports them
+  // as both the real and the CPU time, so that no system call is made.
+  static ThreadTimer CreateCycleClock(bool subtract_overhead) {
+    if (subtract_overhead) {
+      static const ThreadTimer timer = CreateCycleClockWithPauseOverhead(
+          CycleClockOverhead());
+      return timer;
+    }
+    static const ThreadTimer timer = CreateCycleClockWithPauseOverhead(0);
+    return timer;
   }
 
   // Called by each thread
   void StartTimer() {
     running_ = true;
+    ++num_starts_;
+    if (use_cycle_clock) {
+      start_cycles_ = cycleclock::NowSerialized();
+      return;
+    }
     start_real_time_ = ChronoClockNow();
     start_cpu_time_ = ReadCpuTimerOfChoice();
   }
@@ -30,6 +80,12 @@ class ThreadTimer {
   void StopTimer() {
     BM_CHECK(running_);
     running_ = false;
+    if (use_cycle_clock) {
+      cycles_used_ += std::max<int64_t>(
+          cycleclock::NowSerialized() - start_cycles_ - cycle_clock_overhead,
+          0);
+      return;
+    }
     real_time_used_ += ChronoClockNow() - start_real_time_;
     // Floating point error can result in the subtraction producing a negative
     // time. Guard against that.
@@ -42,16 +98,50 @@ class ThreadTimer {
 
   bool running() const { return running_; }
 
+  // The slices of time the timer ran for, those in between the pauses.
+  int64_t num_slices() const { return num_starts_; }
+
+  // The real time measured so far, with that of the slice running, if any,
+  // and with the pause overhead.
+  double real_time_so_far() const {
+    if (use_cycle_clock) {
+      const int64_t running_cycles =
+          running_ ? cycleclock::NowSerialized() - start_cycles_ : 0;
+      return static_cast<double>(cycles_used_ + running_cycles) *
+             seconds_per_cycle;
+    }
+    return real_time_used_ +
+           (running_ ? ChronoClockNow() - start_real_time_ : 0);
+  }
+
+  // Without the pause overhead.
   // REQUIRES: timer is not running
   double real_time_used() const {
     BM_CHECK(!running_);
-    return real_time_used_;
+    return RawRealTime() - real_time_overhead();
   }
 
+  // Without the pause overhead.
   // REQUIRES: timer is not running
   double cpu_time_used() const {
     BM_CHECK(!running_);
-    return cpu_time_used_;
+    return RawCpuTime() - cpu_time_overhead();
+  }
+
+  // The pause overhead included in the measured times, for each time the timer
+  // was paused and resumed.
+  double real_time_overhead() const {
+    return std::min(RawRealTime(), NumPauses() * pause_overhead.real_time);
+  }
+  double cpu_time_overhead() const {
+    return std::min(RawCpuTime(), NumPauses() * pause_overhead.cpu_time);
+  }
+
+  // Without the pause overhead.
+  // REQUIRES: timer is not running, and uses the cycle clock
+  double cycles_used() const {
+    BM_CHECK(use_cycle_clock);
+    return real_time_used() / seconds_per_cycle;
   }
 
   // REQUIRES: timer is not running
@@ -61,6 +151,35 @@ class ThreadTimer {
   }
 
  private:
+  static ThreadTimer CreateCycleClockWithPauseOverhead(
+      int64_t cycle_clock_overhead_) {
+    const ThreadTimer timer(/*measure_process_cpu_time_=*/false,
+                            /*use_cycle_clock_=*/true, cycle_clock_overhead_);
+    return ThreadTimer(/*measure_process_cpu_time_=*/false,
+                       /*use_cycle_clock_=*/true, cycle_clock_overhead_,
+                       MeasurePauseOverhead(timer));
+  }
+
+  double RawRealTime() const {
+    if (use_cycle_clock) {
+      return static_cast<double>(cycles_used_) * seconds_per_cycle;
+    }
+    return real_time_used_;
+  }
+
+  double RawCpuTime() const {
+    if (use_cycle_clock) {
+      return static_cast<double>(cycles_used_) * seconds_per_cycle;
+    }
+    return cpu_time_used_;
+  }
+
+  // The first start is that of the benchmark loop, every other one ends a
+  // pause.
+  double NumPauses() const {
+    return num_starts_ > 1 ? static_cast<double>(num_starts_ - 1) : 0;
+  }
+
   double ReadCpuTimerOfChoice() const {
     if (measure_process_cpu_time) return ProcessCPUUsage();
     return ThreadCPUUsage();
@@ -68,14 +187,22 @@ class ThreadTimer {
 
   // should the thread, or the process, time be measured?
   const bool measure_process_cpu_time;
+  const bool use_cycle_clock;
+  // Subtracted from every slice timed with the cycle clock.
+  const int64_t cycle_clock_overhead;
+  const double seconds_per_cycle;
+  const PauseOverhead pause_overhead;
 
   bool running_ = false;        // Is the timer running
   double start_real_time_ = 0;  // If running_
   double start_cpu_time_ = 0;   // If running_
+  int64_t start_cycles_ = 0;    // If running_ with the cycle clock
+  int64_t num_starts_ = 0;
 
   // Accumulated time so far (does not contain current slice if running_)
   double real_time_used_ = 0;
   double cpu_time_used_ = 0;
+  int64_t cycles_used_ = 0;
   // Manually set iteration time. User sets this with SetIterationTime(seconds).
   double manual_time_used_ = 0;
 };
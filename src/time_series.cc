@@ -0,0 +1,128 @@
+#include "time_series.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "live_metrics.h"
+#include "statistics.h"
+#include "thread_manager.h"
+#include "timers.h"
+
+namespace benchmark {
+namespace internal {
+
+TimeSeriesSampler::TimeSeriesSampler(ThreadManager* manager, double interval,
+                                     LiveMetrics* live,
+                                     const std::string& name)
+    : manager_(manager),
+      interval_(interval),
+      live_(live),
+      name_(name),
+      start_(ChronoClockNow()),
+      stop_(false),
+      thread_([this]() { Loop(); }) {}
+
+TimeSeriesSampler::~TimeSeriesSampler() {
+  if (thread_.joinable()) Stop();
+}
+
+std::vector<BenchmarkReporter::TimeSeriesSample> TimeSeriesSampler::Stop() {
+  {
+    MutexLock l(mutex_);
+    stop_ = true;
+  }
+  stop_condition_.notify_all();
+  thread_.join();
+  Sample();
+  return samples_;
+}
+
+void TimeSeriesSampler::Sample() {
+  BenchmarkReporter::TimeSeriesSample sample;
+  sample.time = ChronoClockNow() - start_;
+  sample.iterations = manager_->TotalProgress();
+  manager_->SampleSharedCounters(&sample.counters);
+  if (live_ != nullptr) live_->AddSample(name_, sample);
+  samples_.push_back(sample);
+}
+
+void TimeSeriesSampler::Loop() {
+  // Wake up on a fixed schedule, so that the time spent sampling doesn't make
+  // the samples drift apart.
+  const std::chrono::duration<double> interval(interval_);
+  auto next = std::chrono::steady_clock::now();
+  MutexLock l(mutex_);
+  for (;;) {
+    next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        interval);
+    if (stop_condition_.wait_until(l.native_handle(), next,
+                                   [this]() { return stop_; })) {
+      return;
+    }
+    Sample();
+  }
+}
+
+void AppendTimeSeries(
+    std::vector<BenchmarkReporter::TimeSeriesSample>* series,
+    const std::vector<BenchmarkReporter::TimeSeriesSample>& more) {
+  if (series->empty()) {
+    *series = more;
+    return;
+  }
+  const BenchmarkReporter::TimeSeriesSample last = series->back();
+  for (BenchmarkReporter::TimeSeriesSample sample : more) {
+    sample.time += last.time;
+    sample.iterations += last.iterations;
+    for (const auto& kv : last.counters) sample.counters[kv.first] += kv.second;
+    series->push_back(sample);
+  }
+}
+
+std::vector<double> IntervalRates(
+    const std::vector<BenchmarkReporter::TimeSeriesSample>& series,
+    double interval) {
+  std::vector<double> rates;
+  if (series.empty()) return rates;
+  // From the first sample with any progress, to the first with all of it.
+  size_t first = 0;
+  while (first < series.size() && series[first].iterations == 0) ++first;
+  size_t last = first;
+  while (last < series.size() &&
+         series[last].iterations < series.back().iterations)
+    ++last;
+  // A sampler that fell behind catches up with samples in quick succession,
+  // which are taken together.
+  for (size_t start = first, s = first + 1; s < last; ++s) {
+    const double seconds = series[s].time - series[start].time;
+    if (seconds < interval / 2) continue;
+    rates.push_back(static_cast<double>(series[s].iterations -
+                                        series[start].iterations) /
+                    seconds);
+    start = s;
+  }
+  return rates;
+}
+
+void AddIntervalThroughput(const std::vector<double>& rates,
+                           double items_per_iteration, UserCounters* counters) {
+  if (rates.empty()) return;
+  const bool items =
+      counters->find("items_per_second") != counters->end() &&
+      items_per_iteration > 0;
+  const std::string name = items ? "items_per_second" : "iterations_per_second";
+  const double multiplier = items ? items_per_iteration : 1;
+  // Already per second: the flag is for the reporters, as the counters were
+  // finished before these were added.
+  (*counters)[name + "_min"] =
+      Counter(*std::min_element(rates.begin(), rates.end()) * multiplier,
+              Counter::kIsRate);
+  (*counters)[name + "_median"] =
+      Counter(StatisticsMedian(rates) * multiplier, Counter::kIsRate);
+  (*counters)[name + "_max"] =
+      Counter(*std::max_element(rates.begin(), rates.end()) * multiplier,
+              Counter::kIsRate);
+}
+
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,77 @@
+#ifndef BENCHMARK_TIME_SERIES_H_
+#define BENCHMARK_TIME_SERIES_H_
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "mutex.h"
+
+namespace benchmark {
+namespace internal {
+
+class LiveMetrics;
+class ThreadManager;
+
+// Records the progress of a run into a time series, for RecordTimeSeries():
+// a thread of its own wakes up every 'interval' seconds, and reads how many
+// iterations the threads of the run have done and the totals of the shared
+// counters. None of this is written by the threads of the run under a lock,
+// so sampling doesn't slow them down. Each sample is also added to the
+// 'live' metrics, if any, under the name of the benchmark.
+class TimeSeriesSampler {
+ public:
+  TimeSeriesSampler(ThreadManager* manager, double interval,
+                    LiveMetrics* live = nullptr,
+                    const std::string& name = std::string());
+  ~TimeSeriesSampler();
+
+  // Take a last sample, stop the sampling thread and return the samples.
+  std::vector<BenchmarkReporter::TimeSeriesSample> Stop();
+
+ private:
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(TimeSeriesSampler);
+
+  void Sample();
+  void Loop();
+
+  ThreadManager* const manager_;
+  const double interval_;
+  LiveMetrics* const live_;
+  const std::string name_;
+  const double start_;
+  // Only touched by the sampling thread until it is joined.
+  std::vector<BenchmarkReporter::TimeSeriesSample> samples_;
+  Mutex mutex_;
+  Condition stop_condition_;
+  bool stop_ GUARDED_BY(mutex_);
+  std::thread thread_;
+};
+
+// Append the samples of 'more', taken over a run that followed those of
+// 'series', shifted so that they carry on from its last sample.
+void AppendTimeSeries(
+    std::vector<BenchmarkReporter::TimeSeriesSample>* series,
+    const std::vector<BenchmarkReporter::TimeSeriesSample>& more);
+
+// The iterations per second between each sample of 'series' and the one
+// before it, for IntervalThroughput(). Only the intervals entirely within the
+// loops of the threads are: those from the first sample with any progress
+// to the last before the threads were all done. Those shorter than half the
+// 'interval' the samples were taken at are taken together with the next.
+std::vector<double> IntervalRates(
+    const std::vector<BenchmarkReporter::TimeSeriesSample>& series,
+    double interval);
+
+// Add the lowest, median and highest of the 'rates', in iterations per
+// second, to 'counters', as those of "items_per_second" if it has it, for
+// the items of 'items_per_iteration', or as "iterations_per_second". They
+// are flagged as rates, to be shown as such, but not divided again.
+void AddIntervalThroughput(const std::vector<double>& rates,
+                           double items_per_iteration, UserCounters* counters);
+
+}  // namespace internal
+}  // namespace benchmark
+
+#endif  // BENCHMARK_TIME_SERIES_H_
@@ -43,6 +43,7 @@
 #include <emscripten.h>
 #endif
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdint>
 #include <cstdio>
@@ -54,6 +55,7 @@
 #include <mutex>
 
 #include "check.h"
+#include "cycleclock.h"
 #include "log.h"
 #include "sleep.h"
 #include "string_util.h"
@@ -179,6 +181,34 @@ double ThreadCPUUsage() {
 #endif
 }
 
+double CycleClockTicksPerSecond() {
+  static const double ticks_per_second = []() {
+    // Spin rather than sleep, so that the measured interval isn't rounded to
+    // the scheduler's granularity.
+    const double start_time = ChronoClockNow();
+    const int64_t start_ticks = cycleclock::NowSerialized();
+    double elapsed;
+    do {
+      elapsed = ChronoClockNow() - start_time;
+    } while (elapsed < 0.01);
+    return static_cast<double>(cycleclock::NowSerialized() - start_ticks) /
+           elapsed;
+  }();
+  return ticks_per_second;
+}
+
+int64_t CycleClockOverhead() {
+  static const int64_t overhead = []() {
+    int64_t least = std::numeric_limits<int64_t>::max();
+    for (int i = 0; i < 1000; ++i) {
+      const int64_t start = cycleclock::NowSerialized();
+      least = std::min(least, cycleclock::NowSerialized() - start);
+    }
+    return least;
+  }();
+  return overhead;
+}
+
 std::string LocalDateTimeString() {
   // Write the local time in RFC3339 format yyyy-mm-ddTHH:MM:SS+/-HH:MM.
   typedef std::chrono::system_clock Clock;
@@ -2,6 +2,7 @@
 #define BENCHMARK_TIMERS_H
 
 #include <chrono>
+#include <cstdint>
 #include <string>
 
 namespace benchmark {
@@ -41,6 +42,14 @@ inline double ChronoClockNow() {
   return FpSeconds(ClockType::now().time_since_epoch()).count();
 }
 
+// The rate at which cycleclock::NowSerialized() ticks, measured against
+// ChronoClockNow() the first time it is called.
+double CycleClockTicksPerSecond();
+
+// The least number of ticks between two back-to-back
+// cycleclock::NowSerialized() reads, measured the first time it is called.
+int64_t CycleClockOverhead();
+
 std::string LocalDateTimeString();
 
 }  // end namespace benchmark
@@ -0,0 +1,134 @@
+#include "trace.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "string_util.h"
+#include "timers.h"
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+std::atomic<Tracer*> tracer(nullptr);
+
+// The id of the calling thread in the trace, numbered in the order they
+// first add to it.
+int TraceThreadId() {
+  static std::atomic<int> next_id(0);
+  thread_local int id = next_id++;
+  return id;
+}
+
+// The start of the timed stretch of the calling thread, if it is in one, and
+// how many it had in its current run.
+thread_local double timed_start = -1;
+thread_local int64_t timed_run = -1;
+thread_local int timed_in_run = 0;
+
+void AppendEscaped(std::string* out, const std::string& s) {
+  for (const char c : s) {
+    if (c == '"' || c == '\\') {
+      *out += '\\';
+      *out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      *out += StrFormat("\\u%04x", c);
+    } else {
+      *out += c;
+    }
+  }
+}
+
+}  // end namespace
+
+Tracer::Tracer(size_t max_events, int max_timed_per_run)
+    : max_events_(max_events),
+      max_timed_per_run_(max_timed_per_run),
+      start_(ChronoClockNow()),
+      run_(0),
+      dropped_(0) {}
+
+double Tracer::Now() const { return (ChronoClockNow() - start_) * 1e6; }
+
+void Tracer::AddSpan(const char* category, std::string name, double start,
+                     const Args& args) {
+  const double end = Now();
+  const int thread = TraceThreadId();
+  MutexLock l(mutex_);
+  if (events_.size() == max_events_) {
+    ++dropped_;
+    return;
+  }
+  events_.push_back(
+      Event{category, std::move(name), thread, start, end - start, args});
+}
+
+void Tracer::StartTimed() {
+  const int64_t run = run_.load(std::memory_order_relaxed);
+  if (run != timed_run) {
+    timed_run = run;
+    timed_in_run = 0;
+  }
+  // Those of a benchmark that pauses in every iteration would crowd out the
+  // rest.
+  timed_start = timed_in_run < max_timed_per_run_ ? Now() : -1;
+}
+
+void Tracer::StopTimed() {
+  if (timed_start < 0) return;
+  ++timed_in_run;
+  AddSpan("state", "timed", timed_start, Args());
+  timed_start = -1;
+}
+
+bool Tracer::Write(const std::string& path, std::string* error) const {
+  std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  MutexLock l(mutex_);
+  out +=
+      "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+      "\"args\":{\"name\":\"benchmark\"}}";
+  for (const Event& e : events_) {
+    out += ",\n{\"name\":\"";
+    AppendEscaped(&out, e.name);
+    out += StrFormat(
+        "\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,"
+        "\"dur\":%.3f",
+        e.category, e.thread, e.start, e.duration);
+    if (!e.args.empty()) {
+      out += ",\"args\":{";
+      for (size_t i = 0; i < e.args.size(); ++i) {
+        out += StrFormat("%s\"%s\":%lld", i == 0 ? "" : ",", e.args[i].first,
+                         static_cast<long long>(e.args[i].second));
+      }
+      out += '}';
+    }
+    out += '}';
+  }
+  out += StrFormat("\n],\"otherData\":{\"dropped_events\":%lld}}\n",
+                   static_cast<long long>(dropped_));
+
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  if (!file) {
+    *error = StrFormat("could not open %s: %s", path.c_str(), strerror(errno));
+    return false;
+  }
+  file << out;
+  file.close();
+  if (!file) {
+    *error = "could not write " + path;
+    return false;
+  }
+  return true;
+}
+
+Tracer* GetTracer() { return tracer.load(); }
+
+void SetTracer(Tracer* t) { tracer.store(t); }
+
+}  // end namespace internal
+}  // end namespace benchmark
@@ -0,0 +1,114 @@
+#ifndef BENCHMARK_TRACE_H_
+#define BENCHMARK_TRACE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "mutex.h"
+
+namespace benchmark {
+namespace internal {
+
+// The timeline of what the runner does, for --benchmark_trace_out: the
+// repetitions, the runs that probe for the iteration count, the memory runs,
+// the start and stop barriers of each thread, the timed stretches between
+// the pauses, and the reporting, written as Chrome trace events, which
+// chrome://tracing and Perfetto load. Any thread can add to it.
+class Tracer {
+ public:
+  typedef std::vector<std::pair<const char*, int64_t> > Args;
+
+  // Keeps at most 'max_events', and counts those that don't fit, and at
+  // most 'max_timed_per_run' timed stretches of each thread in each run.
+  Tracer(size_t max_events, int max_timed_per_run);
+
+  // The microseconds since the tracer was created.
+  double Now() const;
+
+  // Add the span 'name' of the calling thread, from 'start', as returned by
+  // Now(), to now.
+  void AddSpan(const char* category, std::string name, double start,
+               const Args& args);
+
+  // Start the timed stretch of the calling thread, and end it, which adds
+  // its span. Starting it again before it ended drops the first start.
+  void StartTimed();
+  void StopTimed();
+
+  // The threads are about to start another run of the benchmark.
+  void StartRun() { ++run_; }
+
+  // Write the events to the file 'path'.
+  bool Write(const std::string& path, std::string* error) const;
+
+ private:
+  struct Event {
+    const char* category;
+    std::string name;
+    int thread;
+    double start;
+    double duration;
+    Args args;
+  };
+
+  const size_t max_events_;
+  const int max_timed_per_run_;
+  const double start_;
+  std::atomic<int64_t> run_;
+  mutable Mutex mutex_;
+  std::vector<Event> events_ GUARDED_BY(mutex_);
+  int64_t dropped_ GUARDED_BY(mutex_);
+};
+
+// The tracer that the runs add to, or null.
+Tracer* GetTracer();
+void SetTracer(Tracer* tracer);
+
+// Adds the span from its construction to its destruction to the tracer, if
+// there is one.
+class TraceScope {
+ public:
+  // 'name' must outlive the scope.
+  TraceScope(const char* category, const char* name)
+      : tracer_(GetTracer()),
+        category_(category),
+        name_(name),
+        name_string_(nullptr),
+        start_(tracer_ != nullptr ? tracer_->Now() : 0) {}
+  TraceScope(const char* category, const std::string& name)
+      : tracer_(GetTracer()),
+        category_(category),
+        name_(nullptr),
+        name_string_(&name),
+        start_(tracer_ != nullptr ? tracer_->Now() : 0) {}
+
+  ~TraceScope() {
+    if (tracer_ == nullptr) return;
+    tracer_->AddSpan(category_, name_ != nullptr ? name_ : *name_string_,
+                     start_, args_);
+  }
+
+  void AddArg(const char* key, int64_t value) {
+    if (tracer_ != nullptr) args_.emplace_back(key, value);
+  }
+
+ private:
+  BENCHMARK_DISALLOW_COPY_AND_ASSIGN(TraceScope);
+
+  Tracer* const tracer_;
+  const char* const category_;
+  const char* const name_;
+  const std::string* const name_string_;
+  const double start_;
+  Tracer::Args args_;
+};
+
+}  // end namespace internal
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_TRACE_H_
@@ -0,0 +1,188 @@
+#include "tuner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+
+#include "benchmark_runner.h"
+#include "check.h"
+#include "log.h"
+
+namespace benchmark {
+namespace internal {
+
+namespace {
+
+// The most points successive halving starts from, sampled at random if the
+// space has more.
+const size_t kHalvingSampleSize = 64;
+// Coordinate descent stops after this many sweeps over the args even if it
+// still moves, as measurement noise can keep it going back and forth.
+const int kMaxSweeps = 8;
+
+// Remembers what the points measured at each rung, so that none is measured
+// twice.
+class MemoizedEvaluator {
+ public:
+  explicit MemoizedEvaluator(const TuneEvaluator& evaluate)
+      : evaluate_(evaluate) {}
+
+  double operator()(const TunePoint& point, int rung) {
+    const auto key = std::make_pair(rung, point);
+    auto it = values_.find(key);
+    if (it == values_.end()) {
+      it = values_.emplace(key, evaluate_(point, rung)).first;
+    }
+    return it->second;
+  }
+
+ private:
+  const TuneEvaluator& evaluate_;
+  std::map<std::pair<int, TunePoint>, double> values_;
+};
+
+TunePoint CoordinateDescent(const std::vector<size_t>& dimensions,
+                            MemoizedEvaluator* evaluate) {
+  TunePoint point;
+  for (size_t size : dimensions) point.push_back((size - 1) / 2);
+  double best = (*evaluate)(point, 0);
+  for (int sweep = 0; sweep < kMaxSweeps; ++sweep) {
+    bool moved = false;
+    for (size_t d = 0; d < dimensions.size(); ++d) {
+      const size_t start = point[d];
+      size_t best_index = start;
+      for (int direction : {-1, 1}) {
+        TunePoint candidate = point;
+        double previous = (*evaluate)(point, 0);
+        for (size_t i = start + direction; i < dimensions[d]; i += direction) {
+          candidate[d] = i;
+          const double value = (*evaluate)(candidate, 0);
+          if (value < best) {
+            best = value;
+            best_index = i;
+          }
+          // Past a minimum along this arg, the rest of it is not searched.
+          if (value > previous) break;
+          previous = value;
+        }
+      }
+      if (best_index != start) {
+        point[d] = best_index;
+        moved = true;
+      }
+    }
+    if (!moved) break;
+  }
+  return point;
+}
+
+TunePoint SuccessiveHalving(const std::vector<size_t>& dimensions,
+                            MemoizedEvaluator* evaluate) {
+  double space_size = 1;
+  for (size_t size : dimensions) space_size *= static_cast<double>(size);
+  std::vector<TunePoint> candidates;
+  auto point_at = [&dimensions](uint64_t index) {
+    TunePoint point;
+    for (size_t size : dimensions) {
+      point.push_back(static_cast<size_t>(index % size));
+      index /= size;
+    }
+    return point;
+  };
+  if (space_size <= kHalvingSampleSize) {
+    for (uint64_t i = 0; i < static_cast<uint64_t>(space_size); ++i)
+      candidates.push_back(point_at(i));
+  } else {
+    // The same sample every time, so that runs can be compared.
+    std::mt19937_64 generator(1);
+    std::set<TunePoint> sampled;
+    while (sampled.size() < kHalvingSampleSize) {
+      TunePoint point;
+      for (size_t size : dimensions) {
+        point.push_back(std::uniform_int_distribution<size_t>(0, size - 1)(
+            generator));
+      }
+      if (sampled.insert(point).second) candidates.push_back(point);
+    }
+  }
+
+  for (int rung = 0; candidates.size() > 1; ++rung) {
+    std::vector<std::pair<double, size_t> > ranked;
+    for (size_t i = 0; i < candidates.size(); ++i)
+      ranked.emplace_back((*evaluate)(candidates[i], rung), i);
+    std::stable_sort(ranked.begin(), ranked.end());
+    std::vector<TunePoint> kept;
+    for (size_t i = 0; i < (candidates.size() + 1) / 2; ++i)
+      kept.push_back(candidates[ranked[i].second]);
+    candidates.swap(kept);
+  }
+  return candidates.front();
+}
+
+}  // end namespace
+
+TunePoint SearchTuneSpace(const std::vector<size_t>& dimensions,
+                          TuneStrategy strategy,
+                          const TuneEvaluator& evaluate) {
+  BM_CHECK(!dimensions.empty());
+  MemoizedEvaluator memoized(evaluate);
+  if (strategy == kTuneSuccessiveHalving)
+    return SuccessiveHalving(dimensions, &memoized);
+  return CoordinateDescent(dimensions, &memoized);
+}
+
+double TuneObjectiveValue(const BenchmarkReporter::Run& run,
+                          const std::string& objective) {
+  const double kFailed = std::numeric_limits<double>::infinity();
+  if (run.error_occurred) return kFailed;
+  if (objective.empty()) return run.GetAdjustedRealTime();
+  if (objective == "cpu_time") return run.GetAdjustedCPUTime();
+  auto counter = run.counters.find(objective);
+  return counter == run.counters.end() ? kFailed : counter->second.value;
+}
+
+BenchmarkInstance TuneInstance(const BenchmarkInstance& instance) {
+  const std::vector<std::vector<int64_t> >& space = instance.tune_space();
+  std::vector<size_t> dimensions;
+  for (const auto& values : space) dimensions.push_back(values.size());
+  auto args_at = [&space](const TunePoint& point) {
+    std::vector<int64_t> args;
+    for (size_t d = 0; d < point.size(); ++d)
+      args.push_back(space[d][point[d]]);
+    return args;
+  };
+  const double min_time = !IsZero(instance.min_time())
+                              ? instance.min_time()
+                              : absl::GetFlag(FLAGS_benchmark_min_time);
+
+  int runs = 0;
+  const TuneEvaluator evaluate = [&](const TunePoint& point, int rung) {
+    const int halvings = kTuneRungs - 1 - std::min(rung, kTuneRungs - 1);
+    const BenchmarkInstance trial = instance.WithArgs(
+        args_at(point), instance.per_family_instance_index(), 1,
+        std::ldexp(min_time, -halvings));
+    BenchmarkRunner runner(trial, nullptr);
+    while (runner.HasRepeatsRemaining()) runner.DoOneRepetition();
+    const RunResults results = runner.GetResults();
+    ++runs;
+    const double value =
+        TuneObjectiveValue(results.non_aggregates.front(),
+                           instance.tune_objective());
+    BM_VLOG(1) << "Tuning " << trial.name().str() << " at rung " << rung
+               << ": " << value << "\n";
+    return value;
+  };
+  const TunePoint best =
+      SearchTuneSpace(dimensions, instance.tune_strategy(), evaluate);
+  BM_VLOG(1) << "Tuned " << instance.name().str() << " in " << runs
+             << " runs\n";
+  return instance.WithArgs(args_at(best), instance.per_family_instance_index(),
+                           instance.repetitions(), instance.min_time());
+}
+
+}  // end namespace internal
+}  // end namespace benchmark
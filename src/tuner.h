@@ -0,0 +1,44 @@
+#ifndef BENCHMARK_TUNER_H_
+#define BENCHMARK_TUNER_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "benchmark_api_internal.h"
+
+namespace benchmark {
+namespace internal {
+
+// The rung of the shortest runs of a search; the runs of the last rung are
+// as long as the benchmark's min time, and each rung before is half as long.
+const int kTuneRungs = 4;
+
+// A point of a tune space, as the index of its value in each list.
+typedef std::vector<size_t> TunePoint;
+
+// The objective of 'point' measured at 'rung', lower is better.
+typedef std::function<double(const TunePoint& point, int rung)> TuneEvaluator;
+
+// Search the space of 'dimensions' values per arg with 'strategy', measuring
+// each point at most once per rung with 'evaluate', and return the best
+// point found.
+TunePoint SearchTuneSpace(const std::vector<size_t>& dimensions,
+                          TuneStrategy strategy,
+                          const TuneEvaluator& evaluate);
+
+// The value of 'objective', see Benchmark::Tune(), in 'run'; infinite if the
+// run failed or has no such counter.
+double TuneObjectiveValue(const BenchmarkReporter::Run& run,
+                          const std::string& objective);
+
+// Search the args of the tuned 'instance', running the args the search
+// proposes without reporting them, and return its instance for the best
+// args, to be run and reported as the benchmark is configured.
+BenchmarkInstance TuneInstance(const BenchmarkInstance& instance);
+
+}  // end namespace internal
+}  // end namespace benchmark
+
+#endif  // BENCHMARK_TUNER_H_
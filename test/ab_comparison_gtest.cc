@@ -0,0 +1,138 @@
+//===---------------------------------------------------------------------===//
+// ab_comparison_test - Unit tests for src/ab_comparison.cc and the running of
+// A/B pairs
+//===---------------------------------------------------------------------===//
+
+#include <string>
+#include <vector>
+
+#include "../src/ab_comparison.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+ABSL_DECLARE_FLAG(std::string, benchmark_filter);
+
+namespace benchmark {
+namespace {
+
+BenchmarkReporter::Run MakeRun(const std::string& name, int64_t instance,
+                               int64_t repetition, double seconds) {
+  BenchmarkReporter::Run run;
+  run.run_name.function_name = name;
+  run.run_name.args = std::to_string(instance / 2);
+  run.family_index = 0;
+  run.per_family_instance_index = instance;
+  run.repetition_index = repetition;
+  run.repetitions = 3;
+  run.iterations = 10;
+  run.real_accumulated_time = seconds;
+  run.cpu_accumulated_time = seconds / 2;
+  return run;
+}
+
+TEST(ABComparisonTest, PairsTheRepetitions) {
+  // The contender is 10% slower in every repetition, however noisy they are.
+  const std::vector<BenchmarkReporter::Run> reports = {
+      MakeRun("BM_old", 0, 0, 1.0), MakeRun("BM_new", 1, 0, 1.1),
+      MakeRun("BM_old", 0, 1, 2.0), MakeRun("BM_new", 1, 1, 2.2),
+      MakeRun("BM_new", 1, 2, 3.3), MakeRun("BM_old", 0, 2, 3.0)};
+  const std::vector<BenchmarkReporter::Run> results =
+      ComputeABComparison(reports);
+  ASSERT_EQ(results.size(), 3u);
+  EXPECT_EQ(results[0].benchmark_name(), "BM_new/0_ab_diff");
+  EXPECT_EQ(results[0].report_label, "vs BM_old/0");
+  EXPECT_EQ(results[0].aggregate_unit, StatisticUnit::kPercentage);
+  EXPECT_EQ(results[0].iterations, 3);
+  EXPECT_NEAR(results[0].real_accumulated_time, 0.1, 1e-9);
+  EXPECT_NEAR(results[0].cpu_accumulated_time, 0.1, 1e-9);
+  EXPECT_EQ(results[1].aggregate_name, "ab_ci_low");
+  EXPECT_NEAR(results[1].real_accumulated_time, 0.1, 1e-9);
+  EXPECT_EQ(results[2].aggregate_name, "ab_ci_high");
+  EXPECT_NEAR(results[2].real_accumulated_time, 0.1, 1e-9);
+}
+
+TEST(ABComparisonTest, ReportsTheConfidenceInterval) {
+  const std::vector<BenchmarkReporter::Run> reports = {
+      MakeRun("BM_old", 0, 0, 1.0), MakeRun("BM_new", 1, 0, 1.1),
+      MakeRun("BM_old", 0, 1, 1.0), MakeRun("BM_new", 1, 1, 1.3)};
+  const std::vector<BenchmarkReporter::Run> results =
+      ComputeABComparison(reports);
+  ASSERT_EQ(results.size(), 3u);
+  // The differences are 10% and 30%: their standard error is 10%, and the
+  // 97.5th percentile of the t-distribution with one degree of freedom is
+  // 12.706.
+  EXPECT_NEAR(results[0].real_accumulated_time, 0.2, 1e-9);
+  EXPECT_NEAR(results[1].real_accumulated_time, 0.2 - 1.2706, 1e-9);
+  EXPECT_NEAR(results[2].real_accumulated_time, 0.2 + 1.2706, 1e-9);
+}
+
+TEST(ABComparisonTest, NeedsTwoCompletePairs) {
+  BenchmarkReporter::Run errored = MakeRun("BM_new", 1, 1, 1.0);
+  errored.error_occurred = true;
+  const std::vector<BenchmarkReporter::Run> reports = {
+      MakeRun("BM_old", 0, 0, 1.0), MakeRun("BM_new", 1, 0, 1.1),
+      MakeRun("BM_old", 0, 1, 1.0), errored, MakeRun("BM_old", 0, 2, 1.0),
+      MakeRun("BM_old", 2, 0, 1.0), MakeRun("BM_new", 3, 0, 1.0)};
+  EXPECT_TRUE(ComputeABComparison(reports).empty());
+}
+
+std::vector<std::string>* events = new std::vector<std::string>();
+
+void BM_baseline(State& state) {
+  for (auto _ : state) {
+  }
+  events->push_back("BM_baseline");
+}
+
+void BM_contender(State& state) {
+  for (auto _ : state) {
+  }
+  events->push_back("BM_contender");
+}
+
+BENCHMARK_AB(BM_baseline, BM_contender)->Iterations(10)->Repetitions(20);
+
+class RecordingReporter : public BenchmarkReporter {
+ public:
+  bool ReportContext(const Context& /*context*/) override { return true; }
+  void ReportRuns(const std::vector<Run>& report) override {
+    for (const Run& run : report) {
+      if (run.run_type == Run::RT_Aggregate &&
+          run.aggregate_name.compare(0, 3, "ab_") == 0) {
+        events->push_back(run.benchmark_name() + " " + run.report_label);
+      }
+    }
+  }
+};
+
+std::vector<std::string> Execute(const std::string& filter) {
+  events->clear();
+  RecordingReporter reporter;
+  absl::SetFlag(&FLAGS_benchmark_filter, filter);
+  RunSpecifiedBenchmarks(&reporter);
+  return *events;
+}
+
+TEST(ABComparisonTest, InterleavesThePairs) {
+  const std::vector<std::string> ran = Execute("BM_baseline");
+  ASSERT_EQ(ran.size(), 43u);
+  bool contender_first = false;
+  for (size_t i = 0; i < 40; i += 2) {
+    EXPECT_NE(ran[i], ran[i + 1]);
+    contender_first |= ran[i] == "BM_contender";
+  }
+  EXPECT_TRUE(contender_first) << "The order of the pairs was not randomized";
+  EXPECT_EQ(ran[38], "BM_baseline");
+  EXPECT_EQ(ran[40],
+            "BM_contender/iterations:10/repeats:20_ab_diff "
+            "vs BM_baseline/iterations:10/repeats:20");
+}
+
+TEST(ABComparisonTest, SelectsThePairsByTheBaseline) {
+  EXPECT_TRUE(Execute("BM_contender").empty());
+}
+
+}  // namespace
+}  // namespace benchmark
@@ -0,0 +1,170 @@
+//===---------------------------------------------------------------------===//
+// async_benchmark_gtest - Tests for BENCHMARK_ASYNC() benchmarks
+//===---------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <coroutine>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+int in_flight = 0;
+int max_in_flight = 0;
+
+// Yields to the other iterations in flight a few times.
+AsyncTask BM_Yielding(State& state) {
+  ++in_flight;
+  max_in_flight = std::max(max_in_flight, in_flight);
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    co_await AsyncLoop::Current()->Schedule();
+  }
+  --in_flight;
+}
+
+TEST(AsyncBenchmarkTest, KeepsTheIterationsInFlight) {
+  ClearRegisteredBenchmarks();
+  in_flight = max_in_flight = 0;
+  internal::RegisterAsyncBenchmark("BM_Yielding", BM_Yielding)
+      ->InFlight(8)
+      ->Arg(3)
+      ->Iterations(100);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Yielding");
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_FALSE(runs[0].error_occurred);
+  EXPECT_EQ(runs[0].iterations, 100u);
+  EXPECT_EQ(max_in_flight, 8);
+  EXPECT_EQ(in_flight, 0);
+  EXPECT_GT(runs[0].counters.at("items_per_second").value, 0);
+  EXPECT_GT(runs[0].counters.at("latency").value, 0);
+}
+
+TEST(AsyncBenchmarkTest, RecordsTheLatencyOfEachIteration) {
+  ClearRegisteredBenchmarks();
+  internal::RegisterAsyncBenchmark("BM_Yielding", BM_Yielding)
+      ->InFlight(4)
+      ->Arg(1)
+      ->Iterations(50)
+      ->RecordLatencyHistogram(1);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Yielding");
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_EQ(runs[0].latency_samples, 50);
+}
+
+TEST(AsyncBenchmarkTest, RunsAnInstancePerDepth) {
+  ClearRegisteredBenchmarks();
+  internal::RegisterAsyncBenchmark("BM_Yielding", BM_Yielding)
+      ->InFlightRange(1, 8)
+      ->Arg(2)
+      ->Iterations(20);
+  std::vector<int> depths;
+  for (int depth : {1, 2, 4, 8}) {
+    in_flight = max_in_flight = 0;
+    const std::vector<BenchmarkReporter::Run> runs = RunSpecifiedBenchmarks(
+        "BM_Yielding/2/iterations:20/in_flight:" + std::to_string(depth) + "$");
+    ASSERT_EQ(runs.size(), 1u);
+    EXPECT_EQ(runs[0].in_flight, depth);
+    depths.push_back(max_in_flight);
+  }
+  EXPECT_EQ(depths, std::vector<int>({1, 2, 4, 8}));
+}
+
+AsyncTask Nested(int* steps) {
+  co_await AsyncLoop::Current()->Schedule();
+  ++*steps;
+}
+
+int nested_steps = 0;
+
+AsyncTask BM_Nested(State&) {
+  co_await Nested(&nested_steps);
+  co_await Nested(&nested_steps);
+}
+
+TEST(AsyncBenchmarkTest, AwaitsNestedTasks) {
+  ClearRegisteredBenchmarks();
+  nested_steps = 0;
+  internal::RegisterAsyncBenchmark("BM_Nested", BM_Nested)
+      ->InFlight(2)
+      ->Iterations(10);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Nested");
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_EQ(runs[0].iterations, 10u);
+  EXPECT_EQ(nested_steps, 20);
+}
+
+// Completes the operations started on it one RunOnce() at a time, as the
+// completion queue of an RPC stack would.
+class CompletionQueue : public AsyncExecutor {
+ public:
+  struct Awaiter {
+    CompletionQueue* queue;
+    bool await_ready() noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      queue->pending.push_back(handle);
+    }
+    void await_resume() noexcept {}
+  };
+
+  Awaiter Call() { return Awaiter{this}; }
+
+  void RunOnce() override {
+    ++polls;
+    std::coroutine_handle<> handle = pending.front();
+    pending.pop_front();
+    handle.resume();
+  }
+
+  std::deque<std::coroutine_handle<> > pending;
+  int polls = 0;
+};
+
+CompletionQueue* queue = nullptr;
+
+AsyncTask BM_Rpc(State&) { co_await queue->Call(); }
+
+TEST(AsyncBenchmarkTest, WaitsOnTheExecutor) {
+  ClearRegisteredBenchmarks();
+  CompletionQueue completion_queue;
+  queue = &completion_queue;
+  internal::RegisterAsyncBenchmark("BM_Rpc", BM_Rpc)
+      ->InFlight(4)
+      ->Executor(&completion_queue)
+      ->Iterations(20);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Rpc");
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_FALSE(runs[0].error_occurred);
+  EXPECT_EQ(completion_queue.polls, 20);
+  EXPECT_TRUE(completion_queue.pending.empty());
+}
+
+struct Forever {
+  bool await_ready() noexcept { return false; }
+  void await_suspend(std::coroutine_handle<>) {}
+  void await_resume() noexcept {}
+};
+
+AsyncTask BM_Stuck(State&) { co_await Forever(); }
+
+TEST(AsyncBenchmarkTest, FailsIfNothingCanResumeTheIterations) {
+  ClearRegisteredBenchmarks();
+  internal::RegisterAsyncBenchmark("BM_Stuck", BM_Stuck)
+      ->InFlight(2)
+      ->Iterations(10);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Stuck");
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_TRUE(runs[0].error_occurred);
+}
+
+}  // namespace
+}  // namespace benchmark
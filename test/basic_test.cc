@@ -133,6 +133,36 @@ void BM_KeepRunningBatch(benchmark::State& state) {
 // cause this test to fail if set > 1.
 BENCHMARK(BM_KeepRunningBatch)->Repetitions(1);
 
+void BM_RunBatched(benchmark::State& state) {
+  const benchmark::IterationCount batch_size = state.range(0);
+  std::vector<int> inputs(static_cast<size_t>(batch_size));
+  benchmark::IterationCount iter_count = 0;
+  state.RunBatched(
+      batch_size,
+      [&](benchmark::IterationCount i) { inputs[static_cast<size_t>(i)] = 1; },
+      [&](benchmark::IterationCount i) {
+        // Every item was set up before it is used.
+        assert(inputs[static_cast<size_t>(i)] == 1);
+        inputs[static_cast<size_t>(i)] = 0;
+        ++iter_count;
+      });
+  assert(state.iterations() == iter_count);
+  assert(iter_count % batch_size == 0);
+}
+BENCHMARK(BM_RunBatched)->Arg(1)->Arg(64);
+
+void BM_RunUnrolled(benchmark::State& state) {
+  benchmark::IterationCount iter_count = 0;
+  state.RunUnrolled<8>([&] { ++iter_count; });
+  assert(state.iterations() == iter_count);
+  assert(iter_count == state.max_iterations);
+  assert(state.counters["unroll_factor"] == 8);
+}
+BENCHMARK(BM_RunUnrolled);
+// With iterations left over, and chunks of them between the samples.
+BENCHMARK(BM_RunUnrolled)->Iterations(13);
+BENCHMARK(BM_RunUnrolled)->Iterations(1000)->RecordLatencyHistogram(7);
+
 void BM_RangedFor(benchmark::State& state) {
   benchmark::IterationCount iter_count = 0;
   for (auto _ : state) {
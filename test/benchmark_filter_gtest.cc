@@ -0,0 +1,156 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/benchmark_api_internal.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace benchmark;
+using namespace benchmark::internal;
+
+void BM_Noop(State& state) {
+  for (auto _ : state) {
+  }
+}
+
+class BenchmarkFilterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    RegisterBenchmark("BM_Product", BM_Noop)
+        ->ArgsProduct({{1, 2, 30}, {4, 5}})
+        ->ArgNames({"x", "y"});
+    RegisterBenchmark("BM_Args", BM_Noop)
+        ->Args({7})
+        ->Arg(12)
+        ->Threads(2)
+        ->Tags({"numa", "slow"});
+  }
+
+  void TearDown() override { ClearRegisteredBenchmarks(); }
+
+  static std::vector<std::string> Find(const std::string& filter,
+                                       const std::string& tags = "") {
+    std::vector<BenchmarkInstance> instances;
+    std::stringstream err;
+    EXPECT_TRUE(FindBenchmarksInternal(filter, &instances, &err, tags));
+    std::vector<std::string> names;
+    for (const BenchmarkInstance& instance : instances) {
+      names.push_back(instance.name().str());
+    }
+    return names;
+  }
+};
+
+TEST_F(BenchmarkFilterTest, AllInRegistrationOrder) {
+  EXPECT_EQ(Find("."),
+            std::vector<std::string>(
+                {"BM_Product/x:1/y:4", "BM_Product/x:2/y:4",
+                 "BM_Product/x:30/y:4", "BM_Product/x:1/y:5",
+                 "BM_Product/x:2/y:5", "BM_Product/x:30/y:5",
+                 "BM_Args/7/threads:2", "BM_Args/12/threads:2"}));
+}
+
+TEST_F(BenchmarkFilterTest, AnchoredPrefix) {
+  EXPECT_EQ(Find("^BM_Product/x:3"),
+            std::vector<std::string>(
+                {"BM_Product/x:30/y:4", "BM_Product/x:30/y:5"}));
+  EXPECT_EQ(Find("^BM_Product/x:2/y:5$"),
+            std::vector<std::string>({"BM_Product/x:2/y:5"}));
+  EXPECT_EQ(Find("^BM_Args/1*2"),
+            std::vector<std::string>({"BM_Args/12/threads:2"}));
+  EXPECT_TRUE(Find("^BM_Other").empty());
+}
+
+TEST_F(BenchmarkFilterTest, Literal) {
+  EXPECT_EQ(Find("y:5"),
+            std::vector<std::string>({"BM_Product/x:1/y:5",
+                                      "BM_Product/x:2/y:5",
+                                      "BM_Product/x:30/y:5"}));
+  EXPECT_EQ(Find("uct/x:3"),
+            std::vector<std::string>(
+                {"BM_Product/x:30/y:4", "BM_Product/x:30/y:5"}));
+  EXPECT_EQ(Find("2/threads"),
+            std::vector<std::string>({"BM_Args/12/threads:2"}));
+  EXPECT_EQ(Find("Args"), std::vector<std::string>({"BM_Args/7/threads:2",
+                                                    "BM_Args/12/threads:2"}));
+}
+
+TEST_F(BenchmarkFilterTest, Negative) {
+  EXPECT_EQ(Find("-^BM_Product"),
+            std::vector<std::string>(
+                {"BM_Args/7/threads:2", "BM_Args/12/threads:2"}));
+  EXPECT_EQ(Find("-y:4"),
+            std::vector<std::string>(
+                {"BM_Product/x:1/y:5", "BM_Product/x:2/y:5",
+                 "BM_Product/x:30/y:5", "BM_Args/7/threads:2",
+                 "BM_Args/12/threads:2"}));
+}
+
+TEST_F(BenchmarkFilterTest, ArgValues) {
+  RegisterBenchmark("BM_Kernel", BM_Noop)
+      ->ArgStrings(0, {"scalar", "avx2"})
+      ->ArgDoubles(1, {0.5, 2})
+      ->ArgsProduct({{0, 1}, {0, 1}, {64}})
+      ->ArgNames({"", "", "n"});
+  EXPECT_EQ(Find("^BM_Kernel"),
+            std::vector<std::string>(
+                {"BM_Kernel/scalar/0.5/n:64", "BM_Kernel/avx2/0.5/n:64",
+                 "BM_Kernel/scalar/2/n:64", "BM_Kernel/avx2/2/n:64"}));
+  EXPECT_EQ(Find("^BM_Kernel/avx2/2"),
+            std::vector<std::string>({"BM_Kernel/avx2/2/n:64"}));
+  EXPECT_EQ(Find("avx2/0.5"),
+            std::vector<std::string>({"BM_Kernel/avx2/0.5/n:64"}));
+}
+
+TEST_F(BenchmarkFilterTest, Multiversion) {
+  RegisterBenchmark("BM_Kernel", BM_Noop)
+      ->Multiversion({"scalar", "no-such-feature", "scalar+no-such-feature"})
+      ->Arg(8)
+      ->Arg(64);
+  RegisterBenchmark("BM_After", BM_Noop);
+  std::vector<BenchmarkInstance> instances;
+  std::stringstream err;
+  ASSERT_TRUE(FindBenchmarksInternal("^BM_Kernel|^BM_After", &instances,
+                                     &err));
+  ASSERT_EQ(instances.size(), 3u);
+  EXPECT_EQ(instances[0].name().str(), "BM_Kernel/scalar/8");
+  EXPECT_EQ(instances[1].name().str(), "BM_Kernel/scalar/64");
+  EXPECT_EQ(instances[0].variant(), "scalar");
+  EXPECT_EQ(instances[2].name().str(), "BM_After");
+  EXPECT_EQ(instances[2].family_index(), instances[0].family_index() + 1);
+  EXPECT_EQ(Find("scalar/64"),
+            std::vector<std::string>({"BM_Kernel/scalar/64"}));
+}
+
+TEST_F(BenchmarkFilterTest, Tags) {
+  const std::vector<std::string> args = {"BM_Args/7/threads:2",
+                                         "BM_Args/12/threads:2"};
+  EXPECT_EQ(Find(".", "numa"), args);
+  EXPECT_EQ(Find(".", "slow,numa"), args);
+  EXPECT_EQ(Find(".", "gpu|numa"), args);
+  EXPECT_EQ(Find(".", "-gpu|numa").size(), 6u);
+  EXPECT_TRUE(Find(".", "gpu").empty());
+  EXPECT_TRUE(Find("^BM_Product", "slow").empty());
+  EXPECT_EQ(Find("/12/", "slow"),
+            std::vector<std::string>({"BM_Args/12/threads:2"}));
+
+  // The tags given once other families were registered are indexed too.
+  Benchmark* late = RegisterBenchmark("BM_Late", BM_Noop);
+  RegisterBenchmark("BM_Last", BM_Noop);
+  late->Tags({"late"});
+  EXPECT_EQ(Find(".", "late"), std::vector<std::string>({"BM_Late"}));
+}
+
+TEST_F(BenchmarkFilterTest, InvalidTags) {
+  std::vector<BenchmarkInstance> instances;
+  std::stringstream err;
+  EXPECT_FALSE(FindBenchmarksInternal(".", &instances, &err, "a,,b"));
+  EXPECT_FALSE(FindBenchmarksInternal(".", &instances, &err, "a|"));
+  EXPECT_FALSE(FindBenchmarksInternal(".", &instances, &err, "--a"));
+  EXPECT_TRUE(instances.empty());
+}
+
+}  // end namespace
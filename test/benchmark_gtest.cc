@@ -133,6 +133,42 @@ TEST(AddRangeTest, Simple8) {
   EXPECT_THAT(dst, testing::ElementsAre(1, 2, 4, 8));
 }
 
+TEST(CacheBoundarySizesTest, TargetsEachDataCache) {
+  const std::vector<CPUInfo::CacheInfo> caches = {
+      {"Data", 1, 32 * 1024, 1},
+      {"Instruction", 1, 32 * 1024, 1},
+      {"Unified", 2, 1024 * 1024, 2},
+      {"Unified", 2, 1024 * 1024, 2}};
+  const auto sizes = CacheBoundarySizes(caches, {0.01, 0.9, 2}, 4096);
+  EXPECT_THAT(
+      sizes,
+      testing::ElementsAre(
+          // Rounded to cache lines below a page, and to pages above.
+          std::make_pair(int64_t{320}, std::string("L1x0.01")),
+          std::make_pair(int64_t{12288}, std::string("L2x0.01")),
+          std::make_pair(int64_t{28672}, std::string("L1x0.9")),
+          std::make_pair(int64_t{65536}, std::string("L1x2")),
+          std::make_pair(int64_t{942080}, std::string("L2x0.9")),
+          std::make_pair(int64_t{2097152}, std::string("L2x2"))));
+}
+
+TEST(CacheBoundarySizesTest, MergesTheTargetsOfASize) {
+  const std::vector<CPUInfo::CacheInfo> caches = {
+      {"Data", 1, 32 * 1024, 1}, {"Unified", 2, 128 * 1024, 1}};
+  const auto sizes = CacheBoundarySizes(caches, {0.5, 2}, 4096);
+  EXPECT_THAT(sizes,
+              testing::ElementsAre(
+                  std::make_pair(int64_t{16384}, std::string("L1x0.5")),
+                  std::make_pair(int64_t{65536}, std::string("L1x2,L2x0.5")),
+                  std::make_pair(int64_t{262144}, std::string("L2x2"))));
+}
+
+TEST(CacheBoundarySizesTest, EmptyWithoutDataCaches) {
+  const std::vector<CPUInfo::CacheInfo> caches = {
+      {"Instruction", 1, 32 * 1024, 1}};
+  EXPECT_TRUE(CacheBoundarySizes(caches, {0.5}, 4096).empty());
+}
+
 TEST(AddCustomContext, Simple) {
   EXPECT_THAT(global_context, nullptr);
 
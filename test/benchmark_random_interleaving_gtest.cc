@@ -43,16 +43,35 @@ class NullReporter : public BenchmarkReporter {
   void ReportRuns(const std::vector<Run>& /* report */) override {}
 };
 
+// Records when the runs are reported, among the runs of the benchmarks.
+class StreamingReporter : public NullReporter {
+ public:
+  bool StreamsRepetitions() const override { return true; }
+  void ReportRepetition(const Run& run) override {
+    queue->Put("Repetition " + Name(run));
+  }
+  void ReportRuns(const std::vector<Run>& report) override {
+    for (const Run& run : report)
+      queue->Put("Run " + Name(run) + "_" + run.aggregate_name);
+  }
+
+ private:
+  static std::string Name(const Run& run) {
+    return run.run_name.function_name + "/" + run.run_name.args;
+  }
+};
+
 class BenchmarkTest : public testing::Test {
  public:
   static void SetupHook(int /* num_threads */) { queue->push("Setup"); }
 
   static void TeardownHook(int /* num_threads */) { queue->push("Teardown"); }
 
+  template <class Reporter = NullReporter>
   void Execute(const std::string& pattern) {
     queue->Clear();
 
-    BenchmarkReporter* reporter = new NullReporter;
+    BenchmarkReporter* reporter = new Reporter;
     absl::SetFlag(&FLAGS_benchmark_filter, pattern);
     RunSpecifiedBenchmarks(reporter);
     delete reporter;
@@ -123,6 +142,27 @@ TEST_F(BenchmarkTest, Match1WithRandomInterleaving) {
   ASSERT_EQ("DONE", queue->Get());
 }
 
+TEST_F(BenchmarkTest, StreamedRepetitions) {
+  absl::SetFlag(&FLAGS_benchmark_enable_random_interleaving, true);
+  absl::SetFlag(&FLAGS_benchmark_repetitions, 3);
+
+  Execute<StreamingReporter>("BM_Match1/(64|80)");
+  std::map<std::string, int> num_done;
+  for (int i = 0; i < 6; ++i) {
+    const std::string name = queue->Get();
+    ASSERT_EQ("Repetition " + name, queue->Get());
+    ++num_done[name];
+    // The aggregates follow the last repetition.
+    if (num_done[name] == 3) {
+      for (const char* aggregate : {"_mean", "_median", "_stddev", "_cv"})
+        ASSERT_EQ("Run " + name + aggregate, queue->Get());
+    }
+  }
+  EXPECT_EQ(num_done["BM_Match1/64"], 3);
+  EXPECT_EQ(num_done["BM_Match1/80"], 3);
+  ASSERT_EQ("DONE", queue->Get());
+}
+
 }  // namespace
 }  // namespace internal
 }  // namespace benchmark
@@ -78,6 +78,8 @@ static void BM_CalculatePi(benchmark::State& state) {
   }
 }
 BENCHMARK(BM_CalculatePi)->Threads(8);
+BENCHMARK(BM_CalculatePi)->Threads(8)->UseSpinBarrier();
+BENCHMARK(BM_CalculatePi)->Threads(2)->PinThreads(benchmark::kPinCompact);
 BENCHMARK(BM_CalculatePi)->ThreadRange(1, 32);
 BENCHMARK(BM_CalculatePi)->ThreadPerCpu();
 
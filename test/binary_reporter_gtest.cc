@@ -0,0 +1,136 @@
+//===---------------------------------------------------------------------===//
+// binary_reporter_test - Unit tests for src/binary_reporter.cc
+//===---------------------------------------------------------------------===//
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+// Reads back the file layout described in src/binary_reporter.cc.
+class BinaryFile {
+ public:
+  explicit BinaryFile(const std::string& data) : data_(data) {}
+
+  uint64_t U64(size_t offset) const {
+    uint64_t value;
+    std::memcpy(&value, data_.data() + offset, sizeof(value));
+    return value;
+  }
+
+  uint64_t NumRuns() const { return U64(16); }
+  uint64_t NumColumns() const { return U64(24); }
+  uint64_t NumStrings() const { return U64(32); }
+  uint64_t NumCounters() const { return U64(40); }
+  uint64_t NumContext() const { return U64(48); }
+
+  size_t ColumnDataOffset() const { return 64 + 16 * NumColumns(); }
+  size_t CounterIndexOffset() const {
+    return ColumnDataOffset() + 8 * NumColumns() * NumRuns();
+  }
+  size_t CountersOffset() const {
+    return CounterIndexOffset() + 8 * (NumRuns() + 1);
+  }
+  size_t StringIndexOffset() const {
+    return CountersOffset() + 16 * NumCounters() + 16 * NumContext();
+  }
+
+  std::string String(uint64_t index) const {
+    const size_t strings = StringIndexOffset() + 8 * (NumStrings() + 1);
+    const uint64_t begin = U64(StringIndexOffset() + 8 * index);
+    const uint64_t end = U64(StringIndexOffset() + 8 * (index + 1));
+    return data_.substr(strings + begin, end - begin);
+  }
+
+  // The offset of the values of column 'name'.
+  size_t Column(const std::string& name) const {
+    for (uint64_t c = 0; c < NumColumns(); ++c) {
+      if (String(U64(64 + 16 * c)) == name) {
+        return ColumnDataOffset() + 8 * c * NumRuns();
+      }
+    }
+    ADD_FAILURE() << "no column " << name;
+    return 0;
+  }
+
+  double Double(size_t offset) const {
+    double value;
+    std::memcpy(&value, data_.data() + offset, sizeof(value));
+    return value;
+  }
+
+ private:
+  std::string data_;
+};
+
+BenchmarkReporter::Run MakeRun(const char* name, int64_t iterations) {
+  BenchmarkReporter::Run run;
+  run.run_name.function_name = name;
+  run.iterations = iterations;
+  run.repetitions = 1;
+  run.threads = 1;
+  run.time_unit = kNanosecond;
+  run.real_accumulated_time = 2e-6 * static_cast<double>(iterations);
+  run.cpu_accumulated_time = 1e-6 * static_cast<double>(iterations);
+  return run;
+}
+
+TEST(BinaryReporterTest, WritesColumns) {
+  std::vector<BenchmarkReporter::Run> runs;
+  runs.push_back(MakeRun("BM_One", 10));
+  runs.push_back(MakeRun("BM_Two", 20));
+  runs[1].counters["bytes"] = Counter(42);
+  runs[1].report_label = "BM_One";
+
+  std::stringstream out;
+  BinaryReporter reporter;
+  reporter.SetOutputStream(&out);
+  reporter.ReportRuns(runs);
+  reporter.Finalize();
+  const BinaryFile file(out.str());
+
+  ASSERT_EQ(out.str().substr(0, 8), "GBENCHBR");
+  ASSERT_EQ(file.NumRuns(), 2u);
+  EXPECT_EQ(file.String(0), "");
+
+  const size_t names = file.Column("name");
+  EXPECT_EQ(file.String(file.U64(names)), "BM_One");
+  EXPECT_EQ(file.String(file.U64(names + 8)), "BM_Two");
+  // The strings are interned.
+  EXPECT_EQ(file.U64(file.Column("label") + 8), file.U64(names));
+
+  const size_t iterations = file.Column("iterations");
+  EXPECT_EQ(file.U64(iterations), 10u);
+  EXPECT_EQ(file.U64(iterations + 8), 20u);
+  // Per iteration, in the time unit, like in the JSON output.
+  EXPECT_DOUBLE_EQ(file.Double(file.Column("real_time")), 2000);
+  EXPECT_DOUBLE_EQ(file.Double(file.Column("cpu_time") + 8), 1000);
+
+  ASSERT_EQ(file.NumCounters(), 1u);
+  EXPECT_EQ(file.U64(file.CounterIndexOffset()), 0u);
+  EXPECT_EQ(file.U64(file.CounterIndexOffset() + 8), 0u);
+  EXPECT_EQ(file.U64(file.CounterIndexOffset() + 16), 1u);
+  EXPECT_EQ(file.String(file.U64(file.CountersOffset())), "bytes");
+  EXPECT_EQ(file.Double(file.CountersOffset() + 8), 42);
+}
+
+TEST(BinaryReporterTest, EmptyFileHasAllColumns) {
+  std::stringstream out;
+  BinaryReporter reporter;
+  reporter.SetOutputStream(&out);
+  reporter.Finalize();
+  const BinaryFile file(out.str());
+  EXPECT_EQ(file.NumRuns(), 0u);
+  EXPECT_GT(file.NumColumns(), 0u);
+  EXPECT_EQ(file.String(file.U64(64)), "name");
+}
+
+}  // namespace
+}  // namespace benchmark
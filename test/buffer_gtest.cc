@@ -0,0 +1,83 @@
+//===---------------------------------------------------------------------===//
+// buffer_test - Unit tests for src/buffer.cc
+//===---------------------------------------------------------------------===//
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../src/cpu_affinity.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+TEST(BufferTest, IsPageAligned) {
+  Buffer buffer(10000);
+  ASSERT_NE(buffer.data(), nullptr);
+  EXPECT_EQ(buffer.size(), 10000u);
+  EXPECT_GT(buffer.page_size(), 0u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.data()) % buffer.page_size(),
+            0u);
+  // All of it can be written.
+  std::memset(buffer.data(), 1, buffer.size());
+}
+
+TEST(BufferTest, IsOnTheLocalNode) {
+  BufferOptions options;
+  options.numa_node = BufferOptions::kLocalNode;
+  int cpu, node;
+  internal::GetCurrentCpu(&cpu, &node);
+  Buffer buffer(1 << 20, options);
+  // Where the node of the cpu or of the pages is known.
+  if (node >= 0 && buffer.numa_node() >= 0) {
+    EXPECT_EQ(buffer.numa_node(), node);
+  }
+}
+
+TEST(BufferTest, FallsBackWithoutHugePages) {
+  BufferOptions options;
+  options.huge_pages = true;
+  Buffer buffer(4 << 20, options);
+  ASSERT_NE(buffer.data(), nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.data()) % buffer.page_size(),
+            0u);
+  std::memset(buffer.data(), 1, buffer.size());
+}
+
+TEST(BufferTest, IsNotFaultedInUnlessPrefaulted) {
+  BufferOptions options;
+  options.prefault = false;
+  Buffer buffer(1 << 16, options);
+  EXPECT_EQ(buffer.numa_node(), -1);
+}
+
+class BufferPerThread : public BufferFixture {
+ protected:
+  void BenchmarkCase(State& st) BENCHMARK_OVERRIDE {
+    Buffer& buffer = this->buffer(st);
+    if (buffer.size() != 4096) st.SkipWithError("wrong size");
+    for (auto _ : st) {
+      std::memset(buffer.data(), st.thread_index(), buffer.size());
+    }
+  }
+};
+
+TEST(BufferFixtureTest, GivesEachThreadABuffer) {
+  ClearRegisteredBenchmarks();
+  internal::Benchmark* b =
+      internal::RegisterBenchmarkInternal(new BufferPerThread);
+  b->Name("BM_BufferPerThread")->Arg(4096)->Threads(2)->Iterations(10);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_BufferPerThread");
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_FALSE(runs[0].error_occurred);
+  EXPECT_GT(runs[0].counters.at("buffer_page_size").value, 0);
+  EXPECT_GE(runs[0].counters.at("buffer_numa_local").value, 0);
+  EXPECT_LE(runs[0].counters.at("buffer_numa_local").value, 1);
+}
+
+}  // namespace
+}  // namespace benchmark
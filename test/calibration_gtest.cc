@@ -0,0 +1,59 @@
+//===---------------------------------------------------------------------===//
+// calibration_test - Unit tests for src/calibration.cc
+//===---------------------------------------------------------------------===//
+
+#include <cmath>
+
+#include "../src/calibration.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+// How the kernels compare depends on the host and its load, so only that
+// each was timed is checked.
+TEST(CalibrationTest, TimesTheReferenceKernels) {
+  const Calibration calibration = RunCalibration();
+  for (double ns :
+       {calibration.alu_ns, calibration.l1_ns, calibration.dram_ns}) {
+    EXPECT_GT(ns, 0);
+    EXPECT_TRUE(std::isfinite(ns));
+  }
+}
+
+TEST(CalibrationTest, KeepsTheFastestRoundOfEachKernel) {
+  const Calibration calibration =
+      FastestCalibration({{2, 1, 90}, {1, 3, 80}, {3, 2, 100}});
+  EXPECT_EQ(calibration.alu_ns, 1);
+  EXPECT_EQ(calibration.l1_ns, 1);
+  EXPECT_EQ(calibration.dram_ns, 80);
+  const Calibration alone = FastestCalibration({{4, 5, 6}});
+  EXPECT_EQ(alone.dram_ns, 6);
+}
+
+TEST(CalibrationTest, RecalibratesOnlyOnceDue) {
+  Calibration calibration;
+  Calibrate();
+  ASSERT_TRUE(GetCalibration(&calibration));
+  const double l1_ns = calibration.l1_ns;
+  RecalibrateIfDue(3600);
+  ASSERT_TRUE(GetCalibration(&calibration));
+  EXPECT_EQ(calibration.l1_ns, l1_ns);
+}
+
+TEST(CalibrationTest, NamesTheKernels) {
+  const Calibration calibration = {1, 2, 3};
+  EXPECT_TRUE(IsCalibrationKernel("alu"));
+  EXPECT_TRUE(IsCalibrationKernel("l1"));
+  EXPECT_TRUE(IsCalibrationKernel("dram"));
+  EXPECT_FALSE(IsCalibrationKernel("l2"));
+  EXPECT_FALSE(IsCalibrationKernel(""));
+  EXPECT_EQ(CalibrationKernelNs(calibration, "alu"), 1);
+  EXPECT_EQ(CalibrationKernelNs(calibration, "l1"), 2);
+  EXPECT_EQ(CalibrationKernelNs(calibration, "dram"), 3);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
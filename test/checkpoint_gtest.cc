@@ -0,0 +1,129 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/benchmark_api_internal.h"
+#include "../src/checkpoint.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "recording_reporter.h"
+
+ABSL_DECLARE_FLAG(std::string, benchmark_checkpoint);
+ABSL_DECLARE_FLAG(std::string, benchmark_filter);
+
+namespace {
+
+using namespace benchmark;
+using namespace benchmark::internal;
+
+int num_repetitions_run = 0;
+
+void BM_Counted(State& state) {
+  ++num_repetitions_run;
+  for (auto _ : state) {
+  }
+  state.SetComplexityN(state.range(0));
+}
+
+class CheckpointTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    RegisterBenchmark("BM_Counted", BM_Counted)
+        ->Arg(1)
+        ->Arg(2)
+        ->Iterations(5)
+        ->Repetitions(3)
+        ->Complexity(oN);
+    path_ = ::testing::TempDir() + "checkpoint_gtest";
+    std::remove(path_.c_str());
+  }
+
+  void TearDown() override {
+    absl::SetFlag(&FLAGS_benchmark_checkpoint, "");
+    ClearRegisteredBenchmarks();
+    std::remove(path_.c_str());
+  }
+
+  // The names reported by a run with the checkpoint.
+  std::vector<std::string> Run() {
+    absl::SetFlag(&FLAGS_benchmark_filter, "BM_Counted");
+    absl::SetFlag(&FLAGS_benchmark_checkpoint, path_);
+    RecordingReporter reporter;
+    RunSpecifiedBenchmarks(&reporter);
+    std::vector<std::string> names;
+    for (const BenchmarkReporter::Run& run : reporter.runs)
+      names.push_back(run.benchmark_name());
+    return names;
+  }
+
+  std::string path_;
+};
+
+TEST_F(CheckpointTest, ResumesWhereTheRunStopped) {
+  num_repetitions_run = 0;
+  const std::vector<std::string> names = Run();
+  EXPECT_EQ(num_repetitions_run, 6);
+  // 6 repetitions, 8 aggregates, the BigO and the RMS.
+  EXPECT_EQ(names.size(), 16u);
+
+  // All done already: nothing runs, and everything is reported again.
+  num_repetitions_run = 0;
+  EXPECT_EQ(Run(), names);
+  EXPECT_EQ(num_repetitions_run, 0);
+
+  // As if the run was stopped while writing the last repetition.
+  std::string contents;
+  {
+    std::ifstream file(path_.c_str(), std::ios::in | std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream file(path_.c_str(),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(contents.data(),
+               static_cast<std::streamsize>(contents.size() - 10));
+  }
+  num_repetitions_run = 0;
+  EXPECT_EQ(Run(), names);
+  EXPECT_EQ(num_repetitions_run, 1);
+}
+
+TEST_F(CheckpointTest, KeepsTheRepetitionsOfEachInstance) {
+  std::vector<BenchmarkInstance> instances;
+  std::stringstream err;
+  ASSERT_TRUE(FindBenchmarksInternal("BM_Counted", &instances, &err));
+  ASSERT_EQ(instances.size(), 2u);
+  {
+    Checkpoint checkpoint("exe1");
+    ASSERT_TRUE(checkpoint.Open(path_));
+    BenchmarkReporter::Run run;
+    run.run_name = instances[1].name();
+    run.iterations = 5;
+    run.repetition_index = 0;
+    checkpoint.Add(instances[1], run, 7);
+  }
+
+  Checkpoint other_code("exe2");
+  ASSERT_TRUE(other_code.Open(path_));
+  EXPECT_TRUE(other_code.Take(instances[1]).empty());
+
+  Checkpoint checkpoint("exe1");
+  ASSERT_TRUE(checkpoint.Open(path_));
+  EXPECT_TRUE(checkpoint.Take(instances[0]).empty());
+  const std::vector<CheckpointedRepetition> repetitions =
+      checkpoint.Take(instances[1]);
+  ASSERT_EQ(repetitions.size(), 1u);
+  EXPECT_EQ(repetitions[0].run.benchmark_name(),
+            "BM_Counted/2/iterations:5/repeats:3");
+  EXPECT_EQ(repetitions[0].run.per_family_instance_index, 1);
+  EXPECT_EQ(repetitions[0].iters, 7);
+  EXPECT_TRUE(checkpoint.Take(instances[1]).empty());
+}
+
+}  // end namespace
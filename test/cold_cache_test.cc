@@ -0,0 +1,59 @@
+#undef NDEBUG
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "output_test.h"
+
+void BM_ColdCache(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.iterations());
+  }
+}
+BENCHMARK(BM_ColdCache)->ColdCache()->Iterations(10);
+
+ADD_CASES(TC_ConsoleOut, {{"^BM_ColdCache/iterations:10/cold_cache "
+                           "%console_report$"}});
+ADD_CASES(TC_JSONOut,
+          {{"\"name\": \"BM_ColdCache/iterations:10/cold_cache\",$"},
+           {"\"family_index\": 0,$", MR_Next},
+           {"\"per_family_instance_index\": 0,$", MR_Next},
+           {"\"run_name\": \"BM_ColdCache/iterations:10/cold_cache\",$",
+            MR_Next},
+           {"\"run_type\": \"iteration\",$", MR_Next},
+           {"\"repetitions\": 1,$", MR_Next},
+           {"\"repetition_index\": 0,$", MR_Next},
+           {"\"threads\": 1,$", MR_Next},
+           {"\"iterations\": 10,$", MR_Next},
+           {"\"real_time\": %float,$", MR_Next},
+           {"\"cpu_time\": %float,$", MR_Next},
+           {"\"time_unit\": \"ns\",$", MR_Next},
+           {"\"cold_cache\": true$", MR_Next},
+           {"}", MR_Next}});
+ADD_CASES(TC_CSVOut,
+          {{"^\"BM_ColdCache/iterations:10/cold_cache\",%csv_report$"}});
+
+void BM_FlushRegion(benchmark::State& state) {
+  std::vector<int> table(1024, 1);
+  for (auto _ : state) {
+    state.FlushCaches(table.data(), table.size() * sizeof(int));
+    benchmark::DoNotOptimize(table[state.iterations() % table.size()]);
+  }
+}
+BENCHMARK(BM_FlushRegion);
+
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_FlushRegion\",$"},
+                       {"\"family_index\": 1,$", MR_Next},
+                       {"\"per_family_instance_index\": 0,$", MR_Next},
+                       {"\"run_name\": \"BM_FlushRegion\",$", MR_Next},
+                       {"\"run_type\": \"iteration\",$", MR_Next},
+                       {"\"repetitions\": 1,$", MR_Next},
+                       {"\"repetition_index\": 0,$", MR_Next},
+                       {"\"threads\": 1,$", MR_Next},
+                       {"\"iterations\": %int,$", MR_Next},
+                       {"\"real_time\": %float,$", MR_Next},
+                       {"\"cpu_time\": %float,$", MR_Next},
+                       {"\"time_unit\": \"ns\",$", MR_Next},
+                       {"\"cold_cache\": true,$", MR_Next}});
+
+int main(int argc, char* argv[]) { RunOutputTests(argc, argv); }
@@ -217,6 +217,56 @@ const std::string complexity_capture_name =
 ADD_COMPLEXITY_CASES(complexity_capture_name, complexity_capture_name + "_BigO",
                      complexity_capture_name + "_RMS", "N", /*family_index=*/9);
 
+// ========================================================================= //
+// ----------------- Testing BigO over several inputs ---------------------- //
+// ========================================================================= //
+
+void BM_Complexity_N_and_M(benchmark::State &state) {
+  for (auto _ : state) {
+    for (int64_t i = 0; i < state.range(0) + state.range(1); ++i) {
+      benchmark::DoNotOptimize(i);
+    }
+  }
+  state.SetComplexityN({state.range(0), state.range(1)});
+}
+BENCHMARK(BM_Complexity_N_and_M)
+    ->Ranges({{1 << 10, 1 << 16}, {1 << 10, 1 << 16}})
+    ->Complexity({benchmark::oN, benchmark::oN});
+BENCHMARK(BM_Complexity_N_and_M)
+    ->Ranges({{1 << 10, 1 << 16}, {1 << 10, 1 << 16}})
+    ->Complexity({benchmark::oN, benchmark::oLogN},
+                 benchmark::kMultiplicativeComplexity);
+
+ADD_CASES(TC_ConsoleOut,
+          {{"^BM_Complexity_N_and_M_BigO_N [ ]*[-]?%float N "
+            "[ ]*[-]?%float N[ ]*$"},
+           {"^BM_Complexity_N_and_M_BigO_M [ ]*[-]?%float M "
+            "[ ]*[-]?%float M[ ]*$",
+            MR_Next},
+           {"^BM_Complexity_N_and_M_RMS [ ]*[0-9]+ % [ ]*[0-9]+ %[ ]*$",
+            MR_Next}});
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_Complexity_N_and_M_BigO_M\",$"},
+                       {"\"family_index\": 10,$", MR_Next},
+                       {"\"per_family_instance_index\": 0,$", MR_Next},
+                       {"\"run_name\": \"BM_Complexity_N_and_M\",$", MR_Next},
+                       {"\"run_type\": \"aggregate\",$", MR_Next},
+                       {"\"repetitions\": %int,$", MR_Next},
+                       {"\"threads\": 1,$", MR_Next},
+                       {"\"aggregate_name\": \"BigO_M\",$", MR_Next},
+                       {"\"aggregate_unit\": \"time\",$", MR_Next},
+                       {"\"cpu_coefficient\": [-]?%float,$", MR_Next},
+                       {"\"real_coefficient\": [-]?%float,$", MR_Next},
+                       {"\"big_o\": \"M\",$", MR_Next},
+                       {"\"time_unit\": \"ns\"$", MR_Next},
+                       {"}", MR_Next}});
+ADD_CASES(TC_ConsoleOut,
+          {{"^BM_Complexity_N_and_M_BigO [ ]*%float NlgM [ ]*%float NlgM[ ]*$"},
+           {"^BM_Complexity_N_and_M_RMS [ ]*[0-9]+ % [ ]*[0-9]+ %[ ]*$",
+            MR_Next}});
+ADD_CASES(TC_CSVOut,
+          {{"^\"BM_Complexity_N_and_M_BigO\",,%float,%float,NlgM,,,,,$"},
+           {"^\"BM_Complexity_N_and_M_RMS\",,%float,%float,,,,,,$", MR_Next}});
+
 // ========================================================================= //
 // --------------------------- TEST CASES END ------------------------------ //
 // ========================================================================= //
@@ -0,0 +1,114 @@
+//===---------------------------------------------------------------------===//
+// console_reporter_test - Unit tests for src/console_reporter.cc
+//===---------------------------------------------------------------------===//
+
+#include <cstdarg>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/colorprint.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+typedef BenchmarkReporter::Run ConsoleRun;
+
+void Append(std::string* out, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  AppendFormat(out, fmt, args);
+  va_end(args);
+}
+
+ConsoleRun MakeRun(const std::string& name) {
+  ConsoleRun run;
+  run.run_name.function_name = name;
+  run.iterations = 10;
+  run.real_accumulated_time = 1e-6;
+  run.cpu_accumulated_time = 1e-6;
+  return run;
+}
+
+TEST(ConsoleReporterTest, AppendsWhatIsFormatted) {
+  std::string out = "x=";
+  Append(&out, "%d", 42);
+  EXPECT_EQ(out, "x=42");
+  // Longer than what the string has room for.
+  const std::string long_field(1000, 'a');
+  Append(&out, " %s!", long_field.c_str());
+  EXPECT_EQ(out, "x=42 " + long_field + "!");
+}
+
+TEST(ConsoleReporterTest, PrintsTheSameLinesTabular) {
+  std::ostringstream out;
+  ConsoleReporter reporter(ConsoleReporter::OO_Tabular);
+  reporter.SetOutputStream(&out);
+  reporter.SetErrorStream(&out);
+  BenchmarkReporter::Context context;
+  context.name_field_width = 10;
+  reporter.ReportContext(context);
+  out.str("");
+  ConsoleRun run = MakeRun("BM_A");
+  run.counters["a_long_counter_name"] = Counter(3);
+  run.counters["b"] = Counter(4);
+  reporter.ReportRuns({run, run});
+
+  std::vector<std::string> lines;
+  std::istringstream in(out.str());
+  for (std::string line; std::getline(in, line);) lines.push_back(line);
+  // A header and two lines under it, whose counters are as wide as it has
+  // them.
+  ASSERT_EQ(lines.size(), 5u);
+  EXPECT_NE(lines[1].find("a_long_counter_name          b"), std::string::npos);
+  EXPECT_EQ(lines[3], lines[4]);
+  EXPECT_EQ(lines[3].size(), lines[1].size());
+}
+
+TEST(ConsoleReporterTest, PrintsTheProgress) {
+  std::ostringstream out;
+  ConsoleReporter reporter(ConsoleReporter::OO_Progress);
+  reporter.SetOutputStream(&out);
+  reporter.SetErrorStream(&out);
+  BenchmarkReporter::Context context;
+  context.name_field_width = 10;
+  context.num_repetitions = 4;
+  reporter.ReportContext(context);
+  out.str("");
+
+  reporter.ReportRuns({MakeRun("BM_A")});
+  EXPECT_NE(out.str().find("[1/4]  25% 0:00:00 elapsed, 0:00:00 left  BM_A"),
+            std::string::npos);
+  out.str("");
+  // Not until a while later, when it is not to a terminal.
+  reporter.ReportRuns({MakeRun("BM_B")});
+  EXPECT_EQ(out.str(), "");
+
+  ConsoleRun failed = MakeRun("BM_C");
+  failed.error_occurred = true;
+  failed.error_message = "broken";
+  reporter.ReportRuns({failed});
+  EXPECT_NE(out.str().find("ERROR OCCURRED: 'broken'"), std::string::npos);
+  out.str("");
+
+  // Only the aggregates of the last one, which only count for its
+  // repetitions once.
+  ConsoleRun mean = MakeRun("BM_D");
+  mean.run_type = ConsoleRun::RT_Aggregate;
+  mean.aggregate_name = "mean";
+  mean.repetitions = 1;
+  ConsoleRun median = mean;
+  median.aggregate_name = "median";
+  reporter.ReportRuns({mean, median});
+  EXPECT_NE(out.str().find("[4/4] 100%"), std::string::npos);
+  EXPECT_NE(out.str().find(", 1 errors  BM_D_mean"), std::string::npos);
+  out.str("");
+
+  reporter.Finalize();
+  EXPECT_EQ(out.str(), "4 repetitions in 0:00:00, 1 errors\n");
+}
+
+}  // end namespace
+}  // end namespace benchmark
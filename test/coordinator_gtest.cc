@@ -0,0 +1,170 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/coordinator.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+ABSL_DECLARE_FLAG(std::string, benchmark_coordinator);
+ABSL_DECLARE_FLAG(int32_t, benchmark_coordinator_workers);
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+std::string SocketAddress() {
+  return "unix:" + ::testing::TempDir() + "coordinator_gtest.sock";
+}
+
+// Does the runs the leader asks for, with the results of 'iterations_factor'
+// times as many iterations per thread, in one second each.
+void FakeWorker(const std::string& benchmarks, int iterations_factor) {
+  Coordinator worker;
+  std::string error;
+  ASSERT_TRUE(worker.Follow(SocketAddress(), benchmarks, &error)) << error;
+  std::string name;
+  IterationCount iters;
+  int64_t repetition_index;
+  while (worker.NextRun(&name, &iters, &repetition_index)) {
+    if (!worker.StartRun(name, iters, repetition_index, &error)) continue;
+    ThreadManager::Result result;
+    result.iterations = iters * iterations_factor;
+    result.real_time_used = 1;
+    result.cpu_time_used = 1;
+    result.counters["items"] = Counter(5);
+    result.thread_iterations = {result.iterations};
+    ASSERT_TRUE(worker.FinishRun(&result, &error)) << error;
+  }
+}
+
+TEST(CoordinatorTest, AddsTheResultsOfTheWorkers) {
+  std::thread worker(FakeWorker, "BM_A\n", 2);
+  {
+    Coordinator leader;
+    std::string error;
+    ASSERT_TRUE(leader.Lead(SocketAddress(), 1, "BM_A\n", &error)) << error;
+    EXPECT_TRUE(leader.is_leader());
+    EXPECT_EQ(leader.num_processes(), 2);
+    ASSERT_TRUE(leader.StartRun("BM_A", 10, 0, &error)) << error;
+    ThreadManager::Result results;
+    results.iterations = 10;
+    results.real_time_used = 2;
+    results.cpu_time_used = 2;
+    results.counters["items"] = Counter(3);
+    results.thread_iterations = {10};
+    ASSERT_TRUE(leader.FinishRun(&results, &error)) << error;
+    EXPECT_EQ(results.processes, 2);
+    EXPECT_EQ(results.iterations, 30);
+    EXPECT_EQ(results.real_time_used, 3);
+    EXPECT_EQ(results.cpu_time_used, 3);
+    EXPECT_EQ(results.counters["items"].value, 8);
+    const std::vector<IterationCount> thread_iterations = {10, 20};
+    EXPECT_EQ(results.thread_iterations, thread_iterations);
+  }
+  worker.join();
+}
+
+TEST(CoordinatorTest, CallsTheRunOffIfAWorkerRefusesIt) {
+  std::thread worker([]() {
+    Coordinator coordinator;
+    std::string error;
+    ASSERT_TRUE(coordinator.Follow(SocketAddress(), "BM_A\n", &error));
+    std::string name;
+    IterationCount iters;
+    int64_t repetition_index;
+    ASSERT_TRUE(coordinator.NextRun(&name, &iters, &repetition_index));
+    coordinator.RefuseRun("no benchmark named " + name);
+    EXPECT_FALSE(coordinator.NextRun(&name, &iters, &repetition_index));
+  });
+  {
+    Coordinator leader;
+    std::string error;
+    ASSERT_TRUE(leader.Lead(SocketAddress(), 1, "BM_A\n", &error)) << error;
+    EXPECT_FALSE(leader.StartRun("BM_B", 10, 0, &error));
+    EXPECT_EQ(error, "worker 0: no benchmark named BM_B");
+  }
+  worker.join();
+}
+
+TEST(CoordinatorTest, RejectsWorkersOfOtherBenchmarks) {
+  std::thread worker([]() {
+    Coordinator coordinator;
+    std::string error;
+    ASSERT_TRUE(coordinator.Follow(SocketAddress(), "BM_B\n", &error));
+    std::string name;
+    IterationCount iters;
+    int64_t repetition_index;
+    EXPECT_FALSE(coordinator.NextRun(&name, &iters, &repetition_index));
+  });
+  Coordinator leader;
+  std::string error;
+  EXPECT_FALSE(leader.Lead(SocketAddress(), 1, "BM_A\n", &error));
+  EXPECT_EQ(error, "a worker runs other benchmarks than the leader");
+  worker.join();
+}
+
+void BM_Coordinated(State& state) {
+  for (auto _ : state) {
+  }
+  state.counters["items"] = 1;
+}
+BENCHMARK(BM_Coordinated)->Iterations(10);
+
+TEST(CoordinatorTest, ReportsTheThreadsOfAllTheProcesses) {
+  const std::string names = "BM_Coordinated/iterations:10\n";
+  std::thread worker(FakeWorker, names, 3);
+  absl::SetFlag(&FLAGS_benchmark_coordinator, SocketAddress());
+  absl::SetFlag(&FLAGS_benchmark_coordinator_workers, 1);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Coordinated");
+  absl::SetFlag(&FLAGS_benchmark_coordinator, "");
+  absl::SetFlag(&FLAGS_benchmark_coordinator_workers, 0);
+  worker.join();
+
+  ASSERT_EQ(runs.size(), 1u);
+  const BenchmarkReporter::Run& run = runs[0];
+  EXPECT_FALSE(run.error_occurred) << run.error_message;
+  EXPECT_EQ(run.processes, 2);
+  EXPECT_EQ(run.threads, 1);
+  EXPECT_EQ(run.iterations, 40);
+  // The counters are summed over the processes, as over threads.
+  EXPECT_EQ(run.counters.at("items").value, 6);
+}
+
+#ifndef _WIN32
+TEST(CoordinatorTest, WorkersRunWhatTheLeaderAsks) {
+  absl::SetFlag(&FLAGS_benchmark_coordinator, SocketAddress());
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    _exit(RunSpecifiedBenchmarks("BM_Coordinated").empty() ? 0 : 1);
+  }
+  absl::SetFlag(&FLAGS_benchmark_coordinator_workers, 1);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Coordinated");
+  absl::SetFlag(&FLAGS_benchmark_coordinator, "");
+  absl::SetFlag(&FLAGS_benchmark_coordinator_workers, 0);
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  ASSERT_EQ(runs.size(), 1u);
+  const BenchmarkReporter::Run& run = runs[0];
+  EXPECT_FALSE(run.error_occurred) << run.error_message;
+  EXPECT_EQ(run.processes, 2);
+  EXPECT_EQ(run.iterations, 20);
+  EXPECT_EQ(run.counters.at("items").value, 2);
+}
+#endif
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
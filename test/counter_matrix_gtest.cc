@@ -0,0 +1,67 @@
+//===---------------------------------------------------------------------===//
+// counter_matrix_test - Unit tests for src/counter_matrix.cc
+//===---------------------------------------------------------------------===//
+
+#include <cmath>
+#include <vector>
+
+#include "../src/counter_matrix.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+typedef BenchmarkReporter::Run MatrixRun;
+
+MatrixRun MakeRun(const std::string& args, double value) {
+  MatrixRun run;
+  run.run_name.function_name = "BM_Pairs";
+  run.run_name.args = args;
+  run.family_index = 0;
+  run.per_family_instance_index = 0;
+  run.counters["latency"] = Counter(value);
+  return run;
+}
+
+TEST(CounterMatrixTest, ParsesTheArgs) {
+  std::vector<int64_t> values;
+  ASSERT_TRUE(internal::ParseArgValues("cpu:3/peer:-1", &values));
+  EXPECT_EQ(values, std::vector<int64_t>({3, -1}));
+  ASSERT_TRUE(internal::ParseArgValues("4/5/6", &values));
+  EXPECT_EQ(values, std::vector<int64_t>({4, 5, 6}));
+  EXPECT_FALSE(internal::ParseArgValues("cpu:x", &values));
+  EXPECT_FALSE(internal::ParseArgValues("1/", &values));
+}
+
+TEST(CounterMatrixTest, AveragesTheRepetitionsOfEachCell) {
+  std::vector<MatrixRun> reports;
+  reports.push_back(MakeRun("cpu:0/peer:1", 10));
+  reports.push_back(MakeRun("cpu:0/peer:1", 20));
+  reports.push_back(MakeRun("cpu:2/peer:0", 5));
+  MatrixRun failed = MakeRun("cpu:2/peer:1", 1);
+  failed.error_occurred = true;
+  reports.push_back(failed);
+
+  const std::vector<MatrixRun> matrix =
+      ComputeCounterMatrix(reports, "latency");
+  ASSERT_EQ(matrix.size(), 1u);
+  EXPECT_EQ(matrix[0].benchmark_name(), "BM_Pairs_matrix");
+  EXPECT_EQ(matrix[0].matrix_rows, std::vector<int64_t>({0, 2}));
+  EXPECT_EQ(matrix[0].matrix_columns, std::vector<int64_t>({0, 1}));
+  ASSERT_EQ(matrix[0].matrix_values.size(), 4u);
+  EXPECT_TRUE(std::isnan(matrix[0].matrix_values[0]));
+  EXPECT_EQ(matrix[0].matrix_values[1], 15);
+  EXPECT_EQ(matrix[0].matrix_values[2], 5);
+  EXPECT_TRUE(std::isnan(matrix[0].matrix_values[3]));
+}
+
+TEST(CounterMatrixTest, NeedsTwoArgsAndTheCounter) {
+  std::vector<MatrixRun> reports;
+  reports.push_back(MakeRun("8", 1));
+  EXPECT_TRUE(ComputeCounterMatrix(reports, "latency").empty());
+  reports.push_back(MakeRun("8/9", 1));
+  EXPECT_TRUE(ComputeCounterMatrix(reports, "other").empty());
+}
+
+}  // namespace
+}  // namespace benchmark
@@ -0,0 +1,45 @@
+#include "benchmark/benchmark.h"
+#include "output_test.h"
+
+void BM_pairs(benchmark::State& state) {
+  for (auto _ : state) {
+  }
+  state.counters["value"] =
+      static_cast<double>(10 * state.range(0) + state.range(1));
+}
+BENCHMARK(BM_pairs)
+    ->ArgNames({"cpu", "peer"})
+    ->Args({0, 1})
+    ->Args({0, 2})
+    ->Args({1, 2})
+    ->CounterMatrix("value");
+
+ADD_CASES(TC_ConsoleOut,
+          {{"^BM_pairs/cpu:0/peer:1 %console_report value=1$"},
+           {"^BM_pairs/cpu:0/peer:2 %console_report value=2$"},
+           {"^BM_pairs/cpu:1/peer:2 %console_report value=12$"},
+           {"^BM_pairs_matrix +value$"},
+           {"^ +1 +2$", MR_Next},
+           {"^ +0 +1 +2$", MR_Next},
+           {"^ +1 +- +12$", MR_Next}});
+ADD_CASES(TC_JSONOut,
+          {{"\"name\": \"BM_pairs_matrix\",$"},
+           {"\"family_index\": 0,$", MR_Next},
+           {"\"per_family_instance_index\": 0,$", MR_Next},
+           {"\"run_name\": \"BM_pairs\",$", MR_Next},
+           {"\"run_type\": \"aggregate\",$", MR_Next},
+           {"\"repetitions\": 1,$", MR_Next},
+           {"\"threads\": 1,$", MR_Next},
+           {"\"aggregate_name\": \"matrix\",$", MR_Next},
+           {"\"aggregate_unit\": \"time\",$", MR_Next},
+           {"\"iterations\": 0,$", MR_Next},
+           {"\"real_time\": %float,$", MR_Next},
+           {"\"cpu_time\": %float,$", MR_Next},
+           {"\"time_unit\": \"ns\",$", MR_Next},
+           {"\"matrix\": [{]\"counter\": \"value\", \"rows\": [[]0, 1[]], "
+            "\"columns\": [[]1, 2[]], \"values\": [[][[]%float, %float[]], "
+            "[[]null, %float[]][]][}]$",
+            MR_Next},
+           {"}", MR_Next}});
+
+int main(int argc, char* argv[]) { RunOutputTests(argc, argv); }
@@ -0,0 +1,110 @@
+//===---------------------------------------------------------------------===//
+// cpu_affinity_test - Unit tests for src/cpu_affinity.cc
+//===---------------------------------------------------------------------===//
+
+#include <vector>
+
+#include "../src/cpu_affinity.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+typedef std::vector<std::vector<int> > ThreadCpus;
+
+// Two nodes with two cores of two hyperthreads each. As on Linux, the
+// siblings of the cores are numbered after all the first hyperthreads.
+std::vector<CpuLocation> TwoNodeMachine() {
+  std::vector<CpuLocation> cpus;
+  for (int cpu = 0; cpu < 8; ++cpu) {
+    CpuLocation loc;
+    loc.cpu = cpu;
+    loc.numa_node = (cpu % 4) / 2;
+    loc.package = loc.numa_node;
+    loc.core = cpu % 2;
+    cpus.push_back(loc);
+  }
+  return cpus;
+}
+
+TEST(CpuAffinityTest, ParseCpuList) {
+  std::vector<int> cpus;
+  EXPECT_TRUE(ParseCpuList("0-3,8,10-11\n", &cpus));
+  EXPECT_EQ(cpus, std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_FALSE(ParseCpuList("", &cpus));
+  EXPECT_FALSE(ParseCpuList("3-1", &cpus));
+  EXPECT_FALSE(ParseCpuList("1,x", &cpus));
+  EXPECT_FALSE(ParseCpuList("-1", &cpus));
+}
+
+TEST(CpuAffinityTest, ParseCpuAffinity) {
+  PinPolicy policy;
+  std::vector<int> cpus;
+  EXPECT_TRUE(ParseCpuAffinity("", &policy, &cpus));
+  EXPECT_EQ(policy, kPinNone);
+  EXPECT_TRUE(ParseCpuAffinity("scatter", &policy, &cpus));
+  EXPECT_EQ(policy, kPinScatter);
+  EXPECT_TRUE(ParseCpuAffinity("cores", &policy, &cpus));
+  EXPECT_EQ(policy, kPinCores);
+  EXPECT_TRUE(ParseCpuAffinity("2,4", &policy, &cpus));
+  EXPECT_EQ(policy, kPinCpuList);
+  EXPECT_EQ(cpus, std::vector<int>({2, 4}));
+  EXPECT_FALSE(ParseCpuAffinity("everywhere", &policy, &cpus));
+}
+
+TEST(CpuAffinityTest, NoneLeavesThreadsUnpinned) {
+  EXPECT_EQ(AssignThreadCpus(kPinNone, {}, 2, TwoNodeMachine()),
+            ThreadCpus(2));
+}
+
+TEST(CpuAffinityTest, CompactFillsNodeFirst) {
+  EXPECT_EQ(AssignThreadCpus(kPinCompact, {}, 5, TwoNodeMachine()),
+            ThreadCpus({{0}, {4}, {1}, {5}, {2}}));
+}
+
+TEST(CpuAffinityTest, ScatterSpreadsOverNodesAndCores) {
+  EXPECT_EQ(AssignThreadCpus(kPinScatter, {}, 5, TwoNodeMachine()),
+            ThreadCpus({{0}, {2}, {1}, {3}, {4}}));
+}
+
+TEST(CpuAffinityTest, CoresFillAPackageBeforeTheHyperthreads) {
+  EXPECT_EQ(AssignThreadCpus(kPinCores, {}, 6, TwoNodeMachine()),
+            ThreadCpus({{0}, {1}, {2}, {3}, {4}, {5}}));
+}
+
+TEST(CpuAffinityTest, CountsTheThreadsOfTheTopologyPresets) {
+  const TopologyThreadCounts counts = CountTopologyThreads(TwoNodeMachine());
+  EXPECT_EQ(counts.package_cores, 2);
+  EXPECT_EQ(counts.cores, 4);
+  EXPECT_EQ(counts.cpus, 8);
+}
+
+TEST(CpuAffinityTest, NumaNodesRoundRobin) {
+  EXPECT_EQ(AssignThreadCpus(kPinNumaNodes, {}, 3, TwoNodeMachine()),
+            ThreadCpus({{0, 1, 4, 5}, {2, 3, 6, 7}, {0, 1, 4, 5}}));
+}
+
+TEST(CpuAffinityTest, CpuListWrapsAround) {
+  EXPECT_EQ(AssignThreadCpus(kPinCpuList, {3, 1}, 3, TwoNodeMachine()),
+            ThreadCpus({{3}, {1}, {3}}));
+}
+
+TEST(CpuAffinityTest, PartitionsTakeWholeCores) {
+  EXPECT_EQ(PartitionCpus(TwoNodeMachine(), 2, 0),
+            ThreadCpus({{0, 1, 4, 5}, {2, 3, 6, 7}}));
+}
+
+TEST(CpuAffinityTest, PartitionsSpreadOverCaches) {
+  EXPECT_EQ(PartitionCpus(TwoNodeMachine(), 4, 0),
+            ThreadCpus({{0, 4}, {2, 6}, {1, 5}, {3, 7}}));
+  // The cores that don't divide evenly are left out.
+  EXPECT_EQ(PartitionCpus(TwoNodeMachine(), 3, 4),
+            ThreadCpus({{0, 4}, {2, 6}, {1, 5}}));
+  // There can't be more partitions than cores.
+  EXPECT_EQ(PartitionCpus(TwoNodeMachine(), 16, 2).size(), 4u);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,50 @@
+//===---------------------------------------------------------------------===//
+// cpu_features_test - Unit tests for the CPU features of src/sysinfo.cc
+//===---------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+bool HasFeature(const std::string& feature) {
+  const std::vector<std::string>& features = CPUInfo::Get().features;
+  return std::find(features.begin(), features.end(), feature) !=
+         features.end();
+}
+
+TEST(CPUFeaturesTest, ScalarIsAlwaysSupported) {
+  EXPECT_TRUE(CPUInfo::Get().Supports("scalar"));
+  EXPECT_FALSE(CPUInfo::Get().Supports("no-such-feature"));
+}
+
+TEST(CPUFeaturesTest, VariantsNeedAllTheirFeatures) {
+  const CPUInfo& info = CPUInfo::Get();
+  for (const std::string& feature : info.features) {
+    EXPECT_TRUE(info.Supports(feature)) << feature;
+    EXPECT_FALSE(info.Supports(feature + "+no-such-feature")) << feature;
+  }
+  if (info.features.size() >= 2) {
+    EXPECT_TRUE(info.Supports(info.features[0] + "+" + info.features[1]));
+  }
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+TEST(CPUFeaturesTest, X86_64HasSSE2) {
+  EXPECT_TRUE(HasFeature("sse2"));
+  if (HasFeature("x86-64-v3")) {
+    EXPECT_TRUE(HasFeature("avx2"));
+    EXPECT_TRUE(HasFeature("x86-64-v2"));
+  }
+  if (HasFeature("avx512f")) EXPECT_TRUE(HasFeature("avx"));
+}
+#elif defined(__aarch64__)
+TEST(CPUFeaturesTest, AArch64HasNeon) { EXPECT_TRUE(HasFeature("neon")); }
+#endif
+
+}  // namespace
+}  // namespace benchmark
@@ -0,0 +1,52 @@
+//===---------------------------------------------------------------------===//
+// cpu_frequency_test - Unit tests for src/cpu_frequency.cc
+//===---------------------------------------------------------------------===//
+
+#include "../src/cpu_frequency.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+TEST(CpuFrequencyTest, DropIsRelativeToTheReference) {
+  EXPECT_FALSE(IsCpuFrequencyDrop(2.8e9, 3e9, 0.1));
+  EXPECT_TRUE(IsCpuFrequencyDrop(2.6e9, 3e9, 0.1));
+  EXPECT_FALSE(IsCpuFrequencyDrop(3.5e9, 3e9, 0.1));
+}
+
+TEST(CpuFrequencyTest, UnknownFrequenciesAreNoDrop) {
+  EXPECT_FALSE(IsCpuFrequencyDrop(0, 3e9, 0.1));
+  EXPECT_FALSE(IsCpuFrequencyDrop(1e9, 0, 0.1));
+}
+
+TEST(CpuFrequencyTest, HighestIsOfTheEarlierFrequencies) {
+  HighestCpuFrequency highest;
+  EXPECT_EQ(highest.Update(3e9), 0);
+  EXPECT_EQ(highest.Update(2e9), 3e9);
+  EXPECT_EQ(highest.Update(4e9), 3e9);
+  EXPECT_EQ(highest.Update(1e9), 4e9);
+}
+
+TEST(CpuFrequencyTest, EachHighestStartsAfresh) {
+  HighestCpuFrequency first;
+  first.Update(3e9);
+  HighestCpuFrequency second;
+  EXPECT_EQ(second.Update(1e9), 0);
+}
+
+TEST(CpuFrequencyTest, MonitorMeasuresAPlausibleFrequency) {
+  CpuFrequencyMonitor monitor;
+  monitor.Start();
+  volatile double x = 0;
+  for (int i = 0; i < 1000000; ++i) x = x + 1;
+  const double frequency = monitor.Stop();
+  // Unless it can't be measured here at all.
+  if (frequency == 0) return;
+  EXPECT_GT(frequency, 1e8);
+  EXPECT_LT(frequency, 1e11);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
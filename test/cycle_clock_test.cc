@@ -0,0 +1,50 @@
+#undef NDEBUG
+
+#include "benchmark/benchmark.h"
+#include "output_test.h"
+
+void BM_CycleClock(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    benchmark::DoNotOptimize(state.iterations());
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(state.iterations());
+  }
+}
+BENCHMARK(BM_CycleClock)->UseCycleClock();
+BENCHMARK(BM_CycleClock)->UseCycleClock(/*subtract_overhead=*/true);
+
+// Pausing the timer may well take longer than the rest of the loop.
+ADD_CASES(TC_ConsoleOut,
+          {{"^BM_CycleClock/cycle_clock %console_report cycles=%hrfloat"
+            "( [(]timer overhead [0-9]+%[)])?$"},
+           {"^BM_CycleClock/cycle_clock %console_report cycles=%hrfloat"
+            "( [(]timer overhead [0-9]+%[)])?$"}});
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_CycleClock/cycle_clock\",$"},
+                       {"\"family_index\": 0,$", MR_Next},
+                       {"\"per_family_instance_index\": 0,$", MR_Next},
+                       {"\"run_name\": \"BM_CycleClock/cycle_clock\",$",
+                        MR_Next},
+                       {"\"run_type\": \"iteration\",$", MR_Next},
+                       {"\"repetitions\": 1,$", MR_Next},
+                       {"\"repetition_index\": 0,$", MR_Next},
+                       {"\"threads\": 1,$", MR_Next},
+                       {"\"iterations\": %int,$", MR_Next},
+                       {"\"real_time\": %float,$", MR_Next},
+                       {"\"cpu_time\": %float,$", MR_Next},
+                       {"\"time_unit\": \"ns\",$", MR_Next},
+                       {"\"cycles\": %float,$", MR_Next},
+                       {"\"real_time_overhead\": %float,$", MR_Next},
+                       {"\"cpu_time_overhead\": %float$", MR_Next},
+                       {"}", MR_Next}});
+ADD_CASES(TC_CSVOut, {{"^\"BM_CycleClock/cycle_clock\",%csv_report,%float$"}});
+
+void CheckCycleClock(Results const& e) {
+  // Both are the time measured with the cycle clock.
+  CHECK_FLOAT_RESULT_VALUE(e, "real_time", EQ, e.GetAs<double>("cpu_time"),
+                           0.001);
+  CHECK_COUNTER_VALUE(e, double, "cycles", GE, 0);
+}
+CHECK_BENCHMARK_RESULTS("BM_CycleClock/cycle_clock", &CheckCycleClock);
+
+int main(int argc, char* argv[]) { RunOutputTests(argc, argv); }
@@ -0,0 +1,115 @@
+//===---------------------------------------------------------------------===//
+// datagen_test - Unit tests for src/datagen.cc
+//===---------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+ABSL_DECLARE_FLAG(std::string, benchmark_datagen_dir);
+
+namespace benchmark {
+namespace datagen {
+namespace {
+
+TEST(DatagenTest, UniformIsInRange) {
+  const Values<int64_t> values = Uniform(1000, -5, 5, 1);
+  ASSERT_EQ(values.size(), 1000u);
+  EXPECT_EQ(*std::min_element(values.begin(), values.end()), -5);
+  EXPECT_EQ(*std::max_element(values.begin(), values.end()), 5);
+}
+
+TEST(DatagenTest, IsGeneratedOncePerSeed) {
+  const Values<int64_t> a = Uniform(100, 0, 1000000, 7);
+  const Values<int64_t> b = Uniform(100, 0, 1000000, 7);
+  const Values<int64_t> c = Uniform(100, 0, 1000000, 8);
+  // The same input, shared.
+  EXPECT_EQ(a.data(), b.data());
+  EXPECT_FALSE(std::equal(a.begin(), a.end(), c.begin()));
+}
+
+TEST(DatagenTest, ZipfFavorsTheFirstValues) {
+  const Values<int64_t> values = Zipf(10000, 100, 1.0, 1);
+  const size_t zeros = static_cast<size_t>(
+      std::count(values.begin(), values.end(), int64_t{0}));
+  const size_t last = static_cast<size_t>(
+      std::count(values.begin(), values.end(), int64_t{99}));
+  // About 19% of them are 0, and 0.2% are 99.
+  EXPECT_GT(zeros, 1500u);
+  EXPECT_LT(last, 100u);
+  EXPECT_LT(*std::max_element(values.begin(), values.end()), 100);
+}
+
+TEST(DatagenTest, NearlySortedIsAPermutation) {
+  const Values<int64_t> sorted = NearlySorted(1000, 0, 1);
+  EXPECT_TRUE(std::is_sorted(sorted.begin(), sorted.end()));
+  const Values<int64_t> values = NearlySorted(1000, 0.1, 1);
+  EXPECT_FALSE(std::is_sorted(values.begin(), values.end()));
+  std::vector<int64_t> copy(values.begin(), values.end());
+  std::sort(copy.begin(), copy.end());
+  EXPECT_TRUE(std::equal(copy.begin(), copy.end(), sorted.begin()));
+}
+
+TEST(DatagenTest, StringsHaveTheLengths) {
+  const Values<int64_t> lengths = Uniform(100, 0, 40, 2);
+  const std::vector<std::string>& strings = Strings(lengths, 3);
+  ASSERT_EQ(strings.size(), lengths.size());
+  for (size_t i = 0; i < strings.size(); ++i) {
+    EXPECT_EQ(strings[i].size(), static_cast<size_t>(lengths[i]));
+    for (char c : strings[i]) {
+      EXPECT_TRUE(c >= 'a' && c <= 'z');
+    }
+  }
+}
+
+TEST(DatagenTest, ReadsTheInputsBackFromTheirFiles) {
+  absl::SetFlag(&FLAGS_benchmark_datagen_dir, ::testing::TempDir());
+  ClearCache();
+  const std::vector<int64_t> values = [] {
+    const Values<int64_t> v = Zipf(500, 50, 0.8, 11);
+    return std::vector<int64_t>(v.begin(), v.end());
+  }();
+  const std::vector<std::string> strings = Strings(Uniform(50, 1, 9, 12), 13);
+  // Now from the files.
+  ClearCache();
+  const Values<int64_t> mapped = Zipf(500, 50, 0.8, 11);
+  ASSERT_EQ(mapped.size(), values.size());
+  EXPECT_TRUE(std::equal(values.begin(), values.end(), mapped.begin()));
+  EXPECT_EQ(Strings(Uniform(50, 1, 9, 12), 13), strings);
+  absl::SetFlag(&FLAGS_benchmark_datagen_dir, "");
+  ClearCache();
+}
+
+void BM_Seeded(State& state) {
+  for (auto _ : state) {
+  }
+  state.counters["seed"] = Counter(static_cast<double>(state.seed() % 1000003),
+                                   Counter::kAvgThreads);
+}
+
+TEST(DatagenTest, TheSeedDependsOnTheArgsOnly) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_Seeded", BM_Seeded)
+      ->Arg(1)
+      ->Arg(2)
+      ->ThreadRange(1, 2)
+      ->Iterations(1);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Seeded");
+  ASSERT_EQ(runs.size(), 4u);
+  // BM_Seeded/1 on 1 and 2 threads, then BM_Seeded/2.
+  EXPECT_EQ(runs[0].counters.at("seed").value,
+            runs[1].counters.at("seed").value);
+  EXPECT_NE(runs[0].counters.at("seed").value,
+            runs[2].counters.at("seed").value);
+}
+
+}  // namespace
+}  // namespace datagen
+}  // namespace benchmark
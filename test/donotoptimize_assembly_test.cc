@@ -1,4 +1,5 @@
 #include <benchmark/benchmark.h>
+#include <xmmintrin.h>
 
 #ifdef __clang__
 #pragma clang diagnostic ignored "-Wreturn-type"
@@ -9,6 +10,7 @@ extern "C" {
 extern int ExternInt;
 extern int ExternInt2;
 extern int ExternInt3;
+extern __m128 ExternVector;
 
 inline int Add42(int x) { return x + 42; }
 
@@ -161,3 +163,23 @@ extern "C" void test_pointer_lvalue() {
   int *xp = &x;
   benchmark::DoNotOptimize(xp);
 }
+
+// CHECK-LABEL: test_with_vector_lvalue:
+extern "C" void test_with_vector_lvalue() {
+  __m128 v = _mm_add_ps(ExternVector, ExternVector);
+  benchmark::DoNotOptimize(v);
+  // CHECK: ExternVector(%rip)
+  // CHECK: addps
+  // CHECK-NOT: mov{{[a-z]*}} %xmm{{[0-9]+}}, {{.*}}(%{{[a-z]+}})
+  // CHECK: ret
+}
+
+// CHECK-LABEL: test_range_is_reloaded:
+extern "C" int test_range_is_reloaded() {
+  int buf[4] = {1, 2, 3, 4};
+  benchmark::DoNotOptimizeRange(buf, 4);
+  return buf[0];
+  // CHECK: {{movaps|movdqa}} %xmm0, [[DEST:-[0-9]+\(%[a-z]+\)]]
+  // CHECK: movl [[DEST]], %eax
+  // CHECK: ret
+}
@@ -7,6 +7,10 @@ namespace {
 std::uint64_t double_up(const std::uint64_t x) __attribute__((const));
 #endif
 std::uint64_t double_up(const std::uint64_t x) { return x * 2; }
+
+#if defined(__GNUC__)
+typedef float Float4 __attribute__((vector_size(16)));
+#endif
 }
 
 // Using DoNotOptimize on types like BitRef seem to cause a lot of problems
@@ -49,4 +53,17 @@ int main(int, char*[]) {
   benchmark::DoNotOptimize(BitRef::Make());
   BitRef lval = BitRef::Make();
   benchmark::DoNotOptimize(lval);
+
+#if defined(__GNUC__)
+  Float4 vector = {1, 2, 3, 4};
+  benchmark::DoNotOptimize(vector);
+  Float4 const const_vector = vector + vector;
+  benchmark::DoNotOptimize(const_vector);
+  benchmark::DoNotOptimize(vector * const_vector);
+#endif
+
+  benchmark::DoNotOptimizeRange(buffer1024, sizeof(buffer1024));
+  const int values[3] = {1, 2, 3};
+  benchmark::DoNotOptimizeRange(values, 3);
+  benchmark::DoNotOptimizeRange(&x, 0);
 }
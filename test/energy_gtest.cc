@@ -0,0 +1,117 @@
+//===---------------------------------------------------------------------===//
+// energy_test - Unit tests for src/energy.cc
+//===---------------------------------------------------------------------===//
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../src/energy.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+ABSL_DECLARE_FLAG(bool, benchmark_energy);
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+#ifdef __linux__
+void WriteFile(const std::string& path, const std::string& contents) {
+  std::ofstream file(path.c_str());
+  file << contents << "\n";
+}
+
+// A powercap zone of 'name' in 'dir', whose counter is at 'energy' of
+// 'range' microjoules.
+void AddZone(const std::string& dir, const std::string& name,
+             const std::string& energy, const std::string& range) {
+  mkdir(dir.c_str(), 0755);
+  WriteFile(dir + "/name", name);
+  WriteFile(dir + "/energy_uj", energy);
+  WriteFile(dir + "/max_energy_range_uj", range);
+}
+
+// A package with core and dram subzones, and the same package through MMIO.
+std::string MakePowercapDir(const std::string& name) {
+  const std::string dir = ::testing::TempDir() + name;
+  mkdir(dir.c_str(), 0755);
+  AddZone(dir + "/intel-rapl:0", "package-0", "1000000", "262143328850");
+  AddZone(dir + "/intel-rapl:0:0", "core", "500000", "262143328850");
+  AddZone(dir + "/intel-rapl:0:1", "dram", "262143000000", "262143328850");
+  AddZone(dir + "/intel-rapl-mmio:0", "package-0", "1000000", "262143328850");
+  return dir;
+}
+
+TEST(EnergyMeterTest, FindsThePackagesAndTheirDomains) {
+  const EnergyMeter meter(MakePowercapDir("energy_domains"));
+  EXPECT_EQ(meter.error(), "");
+  const std::vector<std::string> expected = {"package-0", "package-0/core",
+                                             "package-0/dram"};
+  EXPECT_EQ(meter.domains(), expected);
+  const std::vector<uint64_t> values = {1000000, 500000, 262143000000};
+  EXPECT_EQ(meter.Read(), values);
+}
+
+TEST(EnergyMeterTest, CountsTheJoulesAcrossAWrapAround) {
+  const std::string dir = MakePowercapDir("energy_wrap");
+  const EnergyMeter meter(dir);
+  const std::vector<uint64_t> start = meter.Read();
+  WriteFile(dir + "/intel-rapl:0/energy_uj", "3500000");
+  WriteFile(dir + "/intel-rapl:0:1/energy_uj", "671150");
+  UserCounters counters;
+  meter.AddEnergy(start, &counters);
+  EXPECT_DOUBLE_EQ(counters.at("energy/package-0").value, 2.5);
+  EXPECT_EQ(counters.at("energy/package-0").flags, Counter::kAvgIterations);
+  EXPECT_DOUBLE_EQ(counters.at("energy/package-0/core").value, 0);
+  EXPECT_DOUBLE_EQ(counters.at("energy/package-0/dram").value, 1);
+}
+
+TEST(EnergyMeterTest, SaysWhyThereAreNoDomains) {
+  const EnergyMeter meter(::testing::TempDir() + "energy_none");
+  EXPECT_TRUE(meter.domains().empty());
+  EXPECT_NE(meter.error().find("no RAPL domains"), std::string::npos);
+}
+#endif
+
+TEST(EnergyMeterTest, PowerIsTheJoulesOverTheTime) {
+  UserCounters counters;
+  counters["energy/package-0"] = Counter(30, Counter::kAvgIterations);
+  counters["items"] = Counter(10);
+  AddPowerCounters(2, &counters);
+  EXPECT_EQ(counters.size(), 3u);
+  EXPECT_DOUBLE_EQ(counters.at("power/package-0").value, 15);
+  EXPECT_EQ(counters.at("power/package-0").flags, Counter::kDefaults);
+}
+
+void BM_Energy(State& state) {
+  for (auto _ : state) {
+  }
+}
+BENCHMARK(BM_Energy)->Iterations(1000);
+
+TEST(EnergyMeterTest, MeasuresTheEnergyOfTheRunsWhereItCan) {
+  absl::SetFlag(&FLAGS_benchmark_energy, true);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Energy");
+  absl::SetFlag(&FLAGS_benchmark_energy, false);
+
+  ASSERT_EQ(runs.size(), 1u);
+  const BenchmarkReporter::Run& run = runs[0];
+  EXPECT_FALSE(run.error_occurred) << run.error_message;
+  for (const std::string& domain : GetEnergyMeter().domains()) {
+    EXPECT_EQ(run.counters.count("energy/" + domain), 1u) << domain;
+    EXPECT_EQ(run.counters.count("power/" + domain), 1u) << domain;
+  }
+  if (GetEnergyMeter().domains().empty()) EXPECT_TRUE(run.counters.empty());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
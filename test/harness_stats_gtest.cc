@@ -0,0 +1,104 @@
+//===---------------------------------------------------------------------===//
+// harness_stats_test - Unit tests for src/harness_stats.cc
+//===---------------------------------------------------------------------===//
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/harness_stats.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+ABSL_DECLARE_FLAG(bool, benchmark_harness_stats);
+ABSL_DECLARE_FLAG(std::string, benchmark_filter);
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+std::vector<std::string> Lines(const std::string& text) {
+  std::vector<std::string> lines;
+  std::istringstream in(text);
+  for (std::string line; std::getline(in, line);) lines.push_back(line);
+  return lines;
+}
+
+TEST(HarnessStatsTest, AddsUpThePhasesOfEachInstance) {
+  HarnessStats stats;
+  stats.Add("BM_A", HarnessStats::kTimed, 1);
+  stats.Add("BM_A", HarnessStats::kTimed, 2);
+  stats.Add("BM_B", HarnessStats::kTimed, 4);
+  stats.Add("BM_B", HarnessStats::kProbing, 0.5);
+  EXPECT_DOUBLE_EQ(stats.Get("BM_A", HarnessStats::kTimed), 3);
+  EXPECT_DOUBLE_EQ(stats.Get("BM_B", HarnessStats::kProbing), 0.5);
+  EXPECT_DOUBLE_EQ(stats.Get("BM_C", HarnessStats::kTimed), 0);
+  EXPECT_DOUBLE_EQ(stats.GetTotal(HarnessStats::kTimed), 7);
+}
+
+TEST(HarnessStatsTest, PrintsTheOtherTimeOfTheInstancesAndBetweenThem) {
+  HarnessStats stats;
+  stats.Add("BM_Second", HarnessStats::kTimed, 6);
+  stats.Add("BM_Second", HarnessStats::kSetup, 1);
+  stats.Add("BM_Second", HarnessStats::kReporting, 0.5);
+  stats.AddRepetition("BM_Second", 7.5);
+  stats.Add("BM_First", HarnessStats::kTimed, 1);
+  stats.AddRepetition("BM_First", 1);
+  std::ostringstream out;
+  stats.Print(out, 10);
+
+  const std::vector<std::string> lines = Lines(out.str());
+  ASSERT_EQ(lines.size(), 6u) << out.str();
+  EXPECT_EQ(lines[0].find("Harness"), 0u);
+  EXPECT_NE(lines[0].find("reporting"), std::string::npos);
+  // In the order they were first added to; the 0.5 s of the repetitions that
+  // no phase accounts for are "other", as is the second between them.
+  EXPECT_EQ(lines[2],
+            "BM_Second      6.000      0.000      1.000      0.000      0.000 "
+            "     0.000      0.500      0.500      8.000");
+  EXPECT_EQ(lines[3].find("BM_First       1.000"), 0u);
+  EXPECT_EQ(lines[4],
+            "total          7.000      0.000      1.000      0.000      0.000 "
+            "     0.000      0.500      1.500     10.000");
+  EXPECT_EQ(lines[5],
+            "%              70.0%       0.0%      10.0%       0.0%       0.0% "
+            "      0.0%       5.0%      15.0%     100.0%");
+}
+
+void BM_HarnessStats(State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_HarnessStats)->Iterations(1000)->Threads(2);
+
+class NullReporter : public BenchmarkReporter {
+ public:
+  NullReporter() { SetErrorStream(&err); }
+  bool ReportContext(const Context& /*context*/) override { return true; }
+  void ReportRuns(const std::vector<Run>& /*report*/) override {}
+
+  std::ostringstream err;
+};
+
+TEST(HarnessStatsTest, PrintsWhereTheTimeOfTheRunsWentWithTheFlag) {
+  absl::SetFlag(&FLAGS_benchmark_filter, "BM_HarnessStats");
+  absl::SetFlag(&FLAGS_benchmark_harness_stats, true);
+  NullReporter reporter;
+  RunSpecifiedBenchmarks(&reporter);
+  absl::SetFlag(&FLAGS_benchmark_harness_stats, false);
+
+  EXPECT_EQ(GetHarnessStats(), nullptr);
+  const std::vector<std::string> lines = Lines(reporter.err.str());
+  ASSERT_EQ(lines.size(), 5u) << reporter.err.str();
+  EXPECT_EQ(lines[2].find("BM_HarnessStats/iterations:1000/threads:2"), 0u);
+  EXPECT_EQ(lines[3].find("total"), 0u);
+  EXPECT_EQ(lines[4].find("%"), 0u);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
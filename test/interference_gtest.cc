@@ -0,0 +1,130 @@
+//===---------------------------------------------------------------------===//
+// interference_test - Unit tests for src/interference.cc
+//===---------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/interference.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+ABSL_DECLARE_FLAG(std::string, benchmark_interference_file);
+ABSL_DECLARE_FLAG(std::string, benchmark_trace_out);
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+constexpr double kCacheBytes = 32 << 20;
+
+PreviousRun MakeRun(const char* name, double value) {
+  PreviousRun run;
+  run.numbers[name] = value;
+  return run;
+}
+
+TEST(InterferenceTest, FindsTheRunsThatGoThroughMoreThanTheCache) {
+  EXPECT_TRUE(IsCacheHeavy(MakeRun("max_bytes_used", 64 << 20), kCacheBytes));
+  EXPECT_FALSE(IsCacheHeavy(MakeRun("max_bytes_used", 1 << 20), kCacheBytes));
+  // 64 bytes per miss.
+  EXPECT_TRUE(IsCacheHeavy(MakeRun("CACHE-MISSES", 1 << 19), kCacheBytes));
+  EXPECT_FALSE(IsCacheHeavy(MakeRun("CACHE-MISSES", 1 << 10), kCacheBytes));
+  EXPECT_TRUE(IsCacheHeavy(MakeRun("llc_mpki", 25), kCacheBytes));
+  EXPECT_FALSE(IsCacheHeavy(MakeRun("llc_mpki", 0.5), kCacheBytes));
+  EXPECT_FALSE(IsCacheHeavy(PreviousRun(), kCacheBytes));
+  EXPECT_GT(LastLevelCacheBytes(), 0);
+}
+
+BenchmarkReporter::Run MakeReport(const std::string& name) {
+  BenchmarkReporter::Run run;
+  run.run_name.function_name = name;
+  run.iterations = 100;
+  run.real_accumulated_time = 1;
+  run.cpu_accumulated_time = 1;
+  return run;
+}
+
+// The instances run below.
+const char kHeavy[] = "BM_Heavy/iterations:10/repeats:2";
+const char kLight[] = "BM_Light/iterations:10/repeats:2";
+
+// BM_Heavy used 1 GiB, and BM_Streaming missed the cache for 64 MiB per
+// iteration; BM_Light did neither.
+std::string WriteEarlierRun(const std::string& name) {
+  const std::string path = ::testing::TempDir() + name;
+  std::ofstream out(path.c_str());
+  JSONReporter reporter;
+  reporter.SetOutputStream(&out);
+  reporter.SetErrorStream(&out);
+  BenchmarkReporter::Run heavy = MakeReport(kHeavy);
+  heavy.has_memory_result = true;
+  heavy.memory_iterations = 16;
+  heavy.max_bytes_used = int64_t{1} << 30;
+  BenchmarkReporter::Run streaming = MakeReport("BM_Streaming");
+  streaming.counters["CACHE-MISSES"] = Counter(1 << 20);
+  BenchmarkReporter::Run light = MakeReport(kLight);
+  light.counters["CACHE-MISSES"] = Counter(10);
+  reporter.ReportContext(BenchmarkReporter::Context());
+  reporter.ReportRuns({heavy, streaming, light});
+  reporter.Finalize();
+  return path;
+}
+
+TEST(InterferenceTest, ReadsTheCacheHeavyInstancesOfAnEarlierRun) {
+  const std::string path = WriteEarlierRun("interference_runs.json");
+  std::set<std::string> names;
+  ASSERT_TRUE(ReadCacheHeavyInstances(path, kCacheBytes, &names));
+  EXPECT_EQ(names, std::set<std::string>({kHeavy, "BM_Streaming"}));
+  std::remove(path.c_str());
+  EXPECT_FALSE(ReadCacheHeavyInstances(path, kCacheBytes, &names));
+}
+
+void BM_Heavy(State& state) {
+  for (auto _ : state) {
+  }
+}
+BENCHMARK(BM_Heavy)->Iterations(10)->Repetitions(2);
+
+void BM_Light(State& state) {
+  for (auto _ : state) {
+  }
+}
+BENCHMARK(BM_Light)->Iterations(10)->Repetitions(2);
+
+int CountSubstrings(const std::string& text, const std::string& sub) {
+  int count = 0;
+  for (size_t pos = text.find(sub); pos != std::string::npos;
+       pos = text.find(sub, pos + sub.size())) {
+    ++count;
+  }
+  return count;
+}
+
+TEST(InterferenceTest, ScrubsBetweenAHeavyInstanceAndALightOne) {
+  const std::string runs = WriteEarlierRun("interference_scrub.json");
+  const std::string trace = ::testing::TempDir() + "interference_trace.json";
+  absl::SetFlag(&FLAGS_benchmark_interference_file, runs);
+  absl::SetFlag(&FLAGS_benchmark_trace_out, trace);
+  RunSpecifiedBenchmarks("BM_Heavy|BM_Light");
+  absl::SetFlag(&FLAGS_benchmark_interference_file, "");
+  absl::SetFlag(&FLAGS_benchmark_trace_out, "");
+
+  std::ifstream in(trace.c_str());
+  std::stringstream contents;
+  contents << in.rdbuf();
+  // Once, between the last repetition of BM_Heavy and the first of BM_Light.
+  EXPECT_EQ(CountSubstrings(contents.str(), "\"scrub\""), 1) << contents.str();
+  std::remove(runs.c_str());
+  std::remove(trace.c_str());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
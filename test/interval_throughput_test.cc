@@ -0,0 +1,47 @@
+#include "benchmark/benchmark.h"
+#include "output_test.h"
+
+void BM_throughput(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.iterations());
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_throughput)->Threads(2)->UseRealTime()->IntervalThroughput(0.001);
+
+ADD_CASES(TC_ConsoleOut,
+          {{"^BM_throughput/real_time/threads:2 %console_report "
+            "items_per_second=%hrfloat/s items_per_second_max=%hrfloat/s "
+            "items_per_second_median=%hrfloat/s "
+            "items_per_second_min=%hrfloat/s$"}});
+ADD_CASES(TC_JSONOut,
+          {{"\"name\": \"BM_throughput/real_time/threads:2\",$"},
+           {"\"family_index\": 0,$", MR_Next},
+           {"\"per_family_instance_index\": 0,$", MR_Next},
+           {"\"run_name\": \"BM_throughput/real_time/threads:2\",$", MR_Next},
+           {"\"run_type\": \"iteration\",$", MR_Next},
+           {"\"repetitions\": 1,$", MR_Next},
+           {"\"repetition_index\": 0,$", MR_Next},
+           {"\"threads\": 2,$", MR_Next},
+           {"\"iterations\": %int,$", MR_Next},
+           {"\"real_time\": %float,$", MR_Next},
+           {"\"cpu_time\": %float,$", MR_Next},
+           {"\"time_unit\": \"ns\",$", MR_Next},
+           {"\"items_per_second\": %float,$", MR_Next},
+           {"\"items_per_second_max\": %float,$", MR_Next},
+           {"\"items_per_second_median\": %float,$", MR_Next},
+           {"\"items_per_second_min\": %float$", MR_Next},
+           {"}", MR_Next}});
+ADD_CASES(TC_CSVOut,
+          {{"^\"BM_throughput/real_time/threads:2\",%csv_items_report,"
+            "%float,%float,%float$"}});
+
+void CheckThroughput(Results const& e) {
+  const double median = e.GetCounterAs<double>("items_per_second_median");
+  CHECK_COUNTER_VALUE(e, double, "items_per_second_min", GE, 0);
+  CHECK_COUNTER_VALUE(e, double, "items_per_second_min", LE, median);
+  CHECK_COUNTER_VALUE(e, double, "items_per_second_max", GE, median);
+}
+CHECK_BENCHMARK_RESULTS("BM_throughput/real_time/threads:2", &CheckThroughput);
+
+int main(int argc, char* argv[]) { RunOutputTests(argc, argv); }
@@ -0,0 +1,47 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "output_test.h"
+
+// Each iteration takes two milliseconds, so that without a hint the runs ramp
+// up from 1 to 7 iterations to reach --benchmark_min_time=0.01.
+void BM_manual(benchmark::State& state) {
+  for (auto _ : state) {
+    state.SetIterationTime(0.002);
+  }
+}
+BENCHMARK(BM_manual)->Name("BM_hinted")->UseManualTime();
+BENCHMARK(BM_manual)->Name("BM_too_few")->UseManualTime();
+BENCHMARK(BM_manual)->Name("BM_not_hinted")->UseManualTime();
+
+// The hinted count is run as is, and one that is too short still ramps up.
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_hinted/manual_time\",$"},
+                       {"\"iterations\": 37,$"}});
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_too_few/manual_time\",$"},
+                       {"\"iterations\": 7,$"}});
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_not_hinted/manual_time\",$"},
+                       {"\"iterations\": 7,$"}});
+
+int main(int argc, char* argv[]) {
+  const std::string path = "iterations_hint_test_hints.json";
+  {
+    std::ofstream hints(path.c_str());
+    hints << "{\"context\": {}, \"benchmarks\": [\n"
+             "  {\"name\": \"BM_hinted/manual_time\", \"run_name\": "
+             "\"BM_hinted/manual_time\", \"run_type\": \"iteration\", "
+             "\"iterations\": 37},\n"
+             "  {\"name\": \"BM_too_few/manual_time\", \"run_name\": "
+             "\"BM_too_few/manual_time\", \"run_type\": \"iteration\", "
+             "\"iterations\": 2}\n"
+             "]}\n";
+  }
+  std::string flag = "--benchmark_iterations_hint_file=" + path;
+  std::vector<char*> args(argv, argv + argc);
+  args.push_back(&flag[0]);
+  args.push_back(nullptr);
+  RunOutputTests(argc + 1, args.data());
+  std::remove(path.c_str());
+}
@@ -0,0 +1,72 @@
+//===---------------------------------------------------------------------===//
+// latency_histogram_test - Unit tests for src/latency_histogram.cc
+//===---------------------------------------------------------------------===//
+
+#include <cstdint>
+
+#include "../src/latency_histogram.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+  for (uint64_t v = 0; v < 128; ++v) {
+    EXPECT_EQ(LatencyHistogram::BucketIndex(v), v);
+    EXPECT_EQ(LatencyHistogram::BucketUpperBound(v), v);
+  }
+}
+
+TEST(LatencyHistogramTest, BucketsCoverTheirValues) {
+  const uint64_t values[] = {128, 129, 130, 1000, 123456789, UINT64_MAX};
+  for (uint64_t v : values) {
+    const size_t index = LatencyHistogram::BucketIndex(v);
+    const uint64_t upper = LatencyHistogram::BucketUpperBound(index);
+    EXPECT_GE(upper, v);
+    // Within the precision of the buckets.
+    EXPECT_LE(upper - v, v / 64);
+    if (index > 0) {
+      EXPECT_LT(LatencyHistogram::BucketUpperBound(index - 1), v);
+    }
+  }
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram h(1);
+  for (uint64_t v = 1; v <= 100; ++v) h.Record(v);
+  EXPECT_EQ(h.count(), 100u);
+  EXPECT_EQ(h.min(), 1u);
+  EXPECT_EQ(h.max(), 100u);
+  EXPECT_DOUBLE_EQ(h.mean(), 50.5);
+  EXPECT_DOUBLE_EQ(h.Percentile(0), 1);
+  EXPECT_DOUBLE_EQ(h.Percentile(50), 50);
+  EXPECT_DOUBLE_EQ(h.Percentile(99), 99);
+  EXPECT_DOUBLE_EQ(h.Percentile(100), 100);
+}
+
+TEST(LatencyHistogramTest, PercentileIsClampedToRecordedRange) {
+  LatencyHistogram h(1);
+  h.Record(1000);
+  EXPECT_DOUBLE_EQ(h.Percentile(50), 1000);
+}
+
+TEST(LatencyHistogramTest, Merge) {
+  LatencyHistogram a(8), b(8), empty;
+  a.Record(10);
+  b.Record(20);
+  b.Record(30);
+  empty.Merge(a);
+  empty.Merge(b);
+  EXPECT_EQ(empty.sample_period(), 8);
+  EXPECT_EQ(empty.count(), 3u);
+  EXPECT_EQ(empty.min(), 10u);
+  EXPECT_EQ(empty.max(), 30u);
+  ASSERT_EQ(empty.Buckets().size(), 3u);
+  EXPECT_EQ(empty.Buckets()[1].first, 20u);
+  EXPECT_EQ(empty.Buckets()[1].second, 1u);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
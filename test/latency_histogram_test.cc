@@ -0,0 +1,36 @@
+#include "benchmark/benchmark.h"
+#include "output_test.h"
+
+void BM_sampled(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.iterations());
+  }
+}
+BENCHMARK(BM_sampled)->RecordLatencyHistogram(4);
+
+ADD_CASES(TC_ConsoleOut,
+          {{"^BM_sampled %console_report p50=%floatns p90=%floatns "
+            "p99=%floatns p99.9=%floatns$"}});
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_sampled\",$"},
+                       {"\"family_index\": 0,$", MR_Next},
+                       {"\"per_family_instance_index\": 0,$", MR_Next},
+                       {"\"run_name\": \"BM_sampled\",$", MR_Next},
+                       {"\"run_type\": \"iteration\",$", MR_Next},
+                       {"\"repetitions\": 1,$", MR_Next},
+                       {"\"repetition_index\": 0,$", MR_Next},
+                       {"\"threads\": 1,$", MR_Next},
+                       {"\"iterations\": %int,$", MR_Next},
+                       {"\"real_time\": %float,$", MR_Next},
+                       {"\"cpu_time\": %float,$", MR_Next},
+                       {"\"time_unit\": \"ns\",$", MR_Next},
+                       {"\"latency_samples\": %int,$", MR_Next},
+                       {"\"latency_percentiles\": [{]\"p50\": %float, "
+                        "\"p90\": %float, \"p99\": %float, "
+                        "\"p99.9\": %float[}],$",
+                        MR_Next},
+                       {"\"latency_histogram\": [[][[]%float, %int[]].*[]]$",
+                        MR_Next},
+                       {"}", MR_Next}});
+ADD_CASES(TC_CSVOut, {{"^\"BM_sampled\",%csv_report$"}});
+
+int main(int argc, char* argv[]) { RunOutputTests(argc, argv); }
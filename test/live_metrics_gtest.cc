@@ -0,0 +1,159 @@
+//===---------------------------------------------------------------------===//
+// live_metrics_test - Unit tests for src/live_metrics.cc
+//===---------------------------------------------------------------------===//
+
+#include <string>
+#include <vector>
+
+#include "../src/internal_macros.h"
+#include "../src/live_metrics.h"
+#include "gtest/gtest.h"
+
+#ifndef BENCHMARK_OS_WINDOWS
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+typedef BenchmarkReporter::Run LiveRun;
+
+bool Contains(const std::string& text, const std::string& line) {
+  return text.find(line + "\n") != std::string::npos;
+}
+
+TEST(LiveMetricsTest, RendersTheRatesOfTheSamples) {
+  LiveMetrics metrics;
+  BenchmarkReporter::TimeSeriesSample sample;
+  sample.time = 1;
+  sample.iterations = 100;
+  sample.counters["bytes"] = 1000;
+  metrics.AddSample("BM_A/8", sample);
+  sample.time = 3;
+  sample.iterations = 500;
+  sample.counters["bytes"] = 2000;
+  metrics.AddSample("BM_A/8", sample);
+
+  const std::string text = metrics.Render();
+  EXPECT_TRUE(Contains(
+      text, "benchmark_live_iterations_per_second{benchmark=\"BM_A/8\"} 200"));
+  EXPECT_TRUE(Contains(text,
+                       "benchmark_live_counter_rate{benchmark=\"BM_A/8\","
+                       "counter=\"bytes\"} 500"));
+  EXPECT_TRUE(Contains(text, "# TYPE benchmark_repetitions counter"));
+  EXPECT_EQ(text.substr(text.size() - 6), "# EOF\n");
+
+  // A new batch starts from nothing again.
+  sample.time = 0.5;
+  sample.iterations = 50;
+  sample.counters["bytes"] = 100;
+  metrics.AddSample("BM_A/8", sample);
+  EXPECT_TRUE(Contains(
+      metrics.Render(),
+      "benchmark_live_iterations_per_second{benchmark=\"BM_A/8\"} 100"));
+}
+
+TEST(LiveMetricsTest, RendersTheRepetitionsAndTheAggregates) {
+  LiveMetrics metrics;
+  LiveRun run;
+  run.run_name.function_name = "BM_\"B\"";
+  run.iterations = 1000;
+  run.real_accumulated_time = 2;
+  run.cpu_accumulated_time = 1;
+  run.time_unit = kMillisecond;
+  run.counters["items"] = Counter(7);
+  LiveRun failed = run;
+  failed.error_occurred = true;
+  LiveRun mean = run;
+  mean.run_type = LiveRun::RT_Aggregate;
+  mean.aggregate_name = "mean";
+  mean.iterations = 1;
+  mean.real_accumulated_time = 0.004;
+  mean.cpu_accumulated_time = 0.003;
+  LiveRun cv = mean;
+  cv.aggregate_name = "cv";
+  cv.aggregate_unit = StatisticUnit::kPercentage;
+  metrics.ReportRuns({run, failed});
+  metrics.ReportRuns({mean, cv});
+
+  const std::string text = metrics.Render();
+  const std::string labels = "{benchmark=\"BM_\\\"B\\\"\"}";
+  EXPECT_TRUE(Contains(text, "benchmark_repetitions_total" + labels + " 2"));
+  EXPECT_TRUE(Contains(text, "benchmark_errors_total" + labels + " 1"));
+  EXPECT_TRUE(Contains(text, "benchmark_iterations" + labels + " 1000"));
+  EXPECT_TRUE(
+      Contains(text, "benchmark_iterations_per_second" + labels + " 500"));
+  EXPECT_TRUE(
+      Contains(text, "benchmark_real_time_seconds" + labels + " 0.002"));
+  EXPECT_TRUE(Contains(text, "benchmark_cpu_time_seconds" + labels + " 0.001"));
+  EXPECT_TRUE(Contains(text,
+                       "benchmark_counter{benchmark=\"BM_\\\"B\\\"\","
+                       "counter=\"items\"} 7"));
+  EXPECT_TRUE(Contains(text,
+                       "benchmark_aggregate_real_time_seconds{benchmark="
+                       "\"BM_\\\"B\\\"\",aggregate=\"mean\"} "
+                       "0.0040000000000000001"));
+  // Not the percentages.
+  EXPECT_EQ(text.find("aggregate=\"cv\""), std::string::npos);
+}
+
+#ifndef BENCHMARK_OS_WINDOWS
+std::string Get(int port, const std::string& path) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in address;
+  address.sin_family = AF_INET;
+  address.sin_port = htons(static_cast<uint16_t>(port));
+  inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+  std::string response;
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&address),
+              sizeof(address)) == 0) {
+    const std::string request = "GET " + path + " HTTP/1.1\r\n\r\n";
+    send(fd, request.data(), request.size(), 0);
+    char buffer[4096];
+    for (ssize_t n; (n = recv(fd, buffer, sizeof(buffer), 0)) > 0;) {
+      response.append(buffer, static_cast<size_t>(n));
+    }
+  }
+  close(fd);
+  return response;
+}
+
+TEST(MetricsServerTest, ServesTheMetrics) {
+  LiveMetrics metrics;
+  LiveRun run;
+  run.run_name.function_name = "BM_C";
+  run.iterations = 10;
+  run.real_accumulated_time = 1;
+  metrics.ReportRuns({run});
+
+  MetricsServer server(&metrics);
+  std::string error;
+  ASSERT_TRUE(server.Start("127.0.0.1:0", &error)) << error;
+  ASSERT_GT(server.port(), 0);
+  const std::string response = Get(server.port(), "/metrics");
+  EXPECT_EQ(response.compare(0, 15, "HTTP/1.1 200 OK"), 0) << response;
+  EXPECT_NE(response.find("application/openmetrics-text"), std::string::npos);
+  EXPECT_TRUE(
+      Contains(response, "benchmark_repetitions_total{benchmark=\"BM_C\"} 1"));
+  EXPECT_EQ(Get(server.port(), "/").compare(0, 22, "HTTP/1.1 404 Not Found"),
+            0);
+  server.Stop();
+}
+
+TEST(MetricsServerTest, RejectsBadAddresses) {
+  LiveMetrics metrics;
+  MetricsServer server(&metrics);
+  std::string error;
+  EXPECT_FALSE(server.Start("9100", &error));
+  EXPECT_FALSE(error.empty());
+  EXPECT_FALSE(server.Start("127.0.0.1:", &error));
+}
+#endif
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,96 @@
+//===---------------------------------------------------------------------===//
+// measurement_checks_test - Unit tests for src/measurement_checks.cc
+//===---------------------------------------------------------------------===//
+
+#include <string>
+#include <vector>
+
+#include "../src/measurement_checks.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+ABSL_DECLARE_FLAG(bool, benchmark_check_measurements);
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+MeasurementFloor MakeFloor() {
+  MeasurementFloor floor;
+  floor.empty_iteration = 0.3e-9;
+  floor.real_resolution = 20e-9;
+  floor.cpu_resolution = 1e-6;
+  return floor;
+}
+
+std::string Check(const std::string& warning) {
+  return warning.substr(0, warning.find(':'));
+}
+
+TEST(MeasurementChecksTest, MeasuresAFloor) {
+  const MeasurementFloor& floor = GetMeasurementFloor();
+  EXPECT_GT(floor.empty_iteration, 0);
+  EXPECT_LT(floor.empty_iteration, 1e-6);
+  EXPECT_GT(floor.real_resolution, 0);
+  EXPECT_LT(floor.real_resolution, 1e-3);
+}
+
+TEST(MeasurementChecksTest, FlagsIterationsAsFastAsAnEmptyLoop) {
+  const std::vector<std::string> warnings =
+      CheckMeasurements(0.5e-9, 1, 1, MakeFloor());
+  ASSERT_EQ(warnings.size(), 1u);
+  EXPECT_EQ(Check(warnings[0]), "empty_loop");
+  EXPECT_NE(warnings[0].find("0.50 ns"), std::string::npos) << warnings[0];
+  EXPECT_TRUE(CheckMeasurements(2e-9, 1, 1, MakeFloor()).empty());
+}
+
+TEST(MeasurementChecksTest, FlagsSlicesNearTheResolutionOfTheirClock) {
+  std::vector<std::string> warnings =
+      CheckMeasurements(1e-6, 100e-9, 1, MakeFloor());
+  ASSERT_EQ(warnings.size(), 1u);
+  EXPECT_EQ(Check(warnings[0]), "timer_resolution");
+  EXPECT_NE(warnings[0].find("real clock"), std::string::npos) << warnings[0];
+  // The CPU clock is coarser.
+  warnings = CheckMeasurements(1e-6, 1e-3, 5e-6, MakeFloor());
+  ASSERT_EQ(warnings.size(), 1u);
+  EXPECT_NE(warnings[0].find("cpu clock"), std::string::npos) << warnings[0];
+  EXPECT_TRUE(CheckMeasurements(1e-6, 1e-3, 1e-3, MakeFloor()).empty());
+  // Nor are the times of 0, which were not measured.
+  EXPECT_TRUE(CheckMeasurements(0, 0, 0, MakeFloor()).empty());
+}
+
+void BM_OptimizedAway(State& state) {
+  for (auto _ : state) {
+  }
+}
+BENCHMARK(BM_OptimizedAway);
+
+// The checks the runs of 'spec' failed.
+std::vector<std::string> ChecksOf(const std::string& spec) {
+  std::vector<std::string> checks;
+  for (const BenchmarkReporter::Run& run : RunSpecifiedBenchmarks(spec)) {
+    for (const std::string& warning : run.warnings)
+      checks.push_back(Check(warning));
+  }
+  return checks;
+}
+
+// Which checks a real run fails depends on the machine and its load, so that
+// is left to the tests above; this one only sees that a run reports no other
+// checks with the flag, and none without it.
+TEST(MeasurementChecksTest, ChecksTheRunsWithTheFlag) {
+  absl::SetFlag(&FLAGS_benchmark_check_measurements, true);
+  const std::vector<std::string> checks = ChecksOf("BM_OptimizedAway");
+  absl::SetFlag(&FLAGS_benchmark_check_measurements, false);
+  for (const std::string& check : checks) {
+    EXPECT_TRUE(check == "empty_loop" || check == "timer_resolution") << check;
+  }
+
+  EXPECT_TRUE(ChecksOf("BM_OptimizedAway").empty());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,51 @@
+//===---------------------------------------------------------------------===//
+// memory_bandwidth_test - Unit tests for src/memory_bandwidth.cc
+//===---------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <vector>
+
+#include "../src/memory_bandwidth.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+CPUInfo::CacheInfo MakeCache(const char* type, int level, int size) {
+  CPUInfo::CacheInfo cache;
+  cache.type = type;
+  cache.level = level;
+  cache.size = size;
+  cache.num_sharing = 1;
+  return cache;
+}
+
+TEST(MemoryBandwidthTest, WorkingSetsFollowTheCaches) {
+  std::vector<CPUInfo::CacheInfo> caches;
+  caches.push_back(MakeCache("Data", 1, 32 << 10));
+  caches.push_back(MakeCache("Instruction", 1, 32 << 10));
+  caches.push_back(MakeCache("Unified", 2, 1 << 20));
+  caches.push_back(MakeCache("Unified", 3, 32 << 20));
+  EXPECT_EQ(MemoryBandwidthWorkingSets(caches),
+            std::vector<int64_t>({16 << 10, 512 << 10, 16 << 20, 128 << 20}));
+}
+
+TEST(MemoryBandwidthTest, DuplicateSizesAreMerged) {
+  std::vector<CPUInfo::CacheInfo> caches;
+  caches.push_back(MakeCache("Data", 1, 32 << 10));
+  caches.push_back(MakeCache("Unified", 2, 32 << 10));
+  EXPECT_EQ(MemoryBandwidthWorkingSets(caches),
+            std::vector<int64_t>({16 << 10, 128 << 10}));
+}
+
+TEST(MemoryBandwidthTest, DefaultsWithoutCaches) {
+  const std::vector<int64_t> sizes =
+      MemoryBandwidthWorkingSets(std::vector<CPUInfo::CacheInfo>());
+  ASSERT_FALSE(sizes.empty());
+  EXPECT_TRUE(std::is_sorted(sizes.begin(), sizes.end()));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
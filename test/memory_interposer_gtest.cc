@@ -0,0 +1,106 @@
+//===---------------------------------------------------------------------===//
+// memory_interposer_gtest - Unit tests for src/benchmark_memory.cc
+//===---------------------------------------------------------------------===//
+
+#include <cstdlib>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+class RunCollector : public BenchmarkReporter {
+ public:
+  bool ReportContext(const Context&) override { return true; }
+  void ReportRuns(const std::vector<Run>& runs) override {
+    for (const Run& run : runs) {
+      if (run.memory_iterations > 0) runs_.push_back(run);
+    }
+  }
+  std::vector<Run> runs_;
+};
+
+void BM_NewDelete(State& state) {
+  for (auto _ : state) {
+    char* block = new char[100];
+    DoNotOptimize(block);
+    delete[] block;
+  }
+}
+
+void BM_Leak(State& state) {
+  for (auto _ : state) {
+    DoNotOptimize(std::malloc(64));
+  }
+}
+
+const BenchmarkReporter::Run& RunOf(
+    const std::vector<BenchmarkReporter::Run>& runs, const char* name) {
+  for (const BenchmarkReporter::Run& run : runs) {
+    if (run.run_name.function_name == name) return run;
+  }
+  ADD_FAILURE() << "no run of " << name;
+  return runs.front();
+}
+
+TEST(MemoryInterposerTest, CountsTheAllocationsOfTheMemoryRun) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_NewDelete", BM_NewDelete)->Iterations(10);
+  RegisterBenchmark("BM_Leak", BM_Leak)->Iterations(10);
+  RunCollector collector;
+  RunSpecifiedBenchmarks(&collector);
+  ASSERT_EQ(collector.runs_.size(), 2u);
+
+  // The harness may allocate too while the memory run is measured.
+  const BenchmarkReporter::Run& new_delete =
+      RunOf(collector.runs_, "BM_NewDelete");
+  const MemoryManager::Result& counts = new_delete.memory_result;
+  const int64_t iterations = new_delete.memory_iterations;
+  EXPECT_GE(counts.num_allocs, iterations);
+  EXPECT_LT(counts.num_allocs, iterations + 100);
+  EXPECT_GE(counts.num_frees, iterations);
+  EXPECT_GE(counts.total_allocated_bytes, 100 * iterations);
+  EXPECT_GE(counts.max_bytes_used, 100);
+  ASSERT_GT(counts.alloc_size_histogram.size(), 7u);
+  // 100 bytes are in (64, 128].
+  EXPECT_GE(counts.alloc_size_histogram[7], iterations);
+
+  const BenchmarkReporter::Run& leak = RunOf(collector.runs_, "BM_Leak");
+  EXPECT_GE(leak.memory_result.num_allocs, leak.memory_iterations);
+  EXPECT_GE(leak.memory_result.total_allocated_bytes,
+            64 * leak.memory_iterations);
+#ifdef __GLIBC__
+  EXPECT_GE(leak.memory_result.net_heap_growth, 64 * leak.memory_iterations);
+  EXPECT_GE(leak.memory_result.max_bytes_used, 64 * leak.memory_iterations);
+#endif
+}
+
+TEST(MemoryInterposerTest, CountsEachThreadOfTheMemoryRun) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_NewDelete", BM_NewDelete)
+      ->Iterations(100)
+      ->MemoryIterations(20)
+      ->Threads(3);
+  RunCollector collector;
+  RunSpecifiedBenchmarks(&collector);
+  ASSERT_EQ(collector.runs_.size(), 1u);
+
+  const BenchmarkReporter::Run& run = collector.runs_[0];
+  EXPECT_EQ(run.memory_iterations, 60);
+  const MemoryManager::Result& counts = run.memory_result;
+  EXPECT_GE(counts.num_allocs, 60);
+  ASSERT_EQ(counts.thread_allocs.size(), 3u);
+  ASSERT_EQ(counts.thread_allocated_bytes.size(), 3u);
+  int64_t thread_allocs = 0;
+  for (size_t t = 0; t < 3; ++t) {
+    EXPECT_GE(counts.thread_allocs[t], 20);
+    EXPECT_GE(counts.thread_allocated_bytes[t], 100 * 20);
+    thread_allocs += counts.thread_allocs[t];
+  }
+  EXPECT_LE(thread_allocs, counts.num_allocs);
+}
+
+}  // namespace
+}  // namespace benchmark
@@ -0,0 +1,46 @@
+//===---------------------------------------------------------------------===//
+// memory_latency_test - Unit tests for src/memory_latency.cc
+//===---------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <vector>
+
+#include "../src/memory_latency.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+bool IsPermutation(std::vector<size_t> order) {
+  std::sort(order.begin(), order.end());
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (order[i] != i) return false;
+  }
+  return true;
+}
+
+TEST(MemoryLatencyTest, ChaseVisitsEveryLineOnce) {
+  const std::vector<size_t> order = ChaseOrder(1000, 0, 1);
+  ASSERT_EQ(order.size(), 1000u);
+  EXPECT_TRUE(IsPermutation(order));
+  EXPECT_FALSE(std::is_sorted(order.begin(), order.end()));
+  EXPECT_EQ(ChaseOrder(1000, 0, 1), order);
+}
+
+TEST(MemoryLatencyTest, PageLocalChaseFinishesEachPageFirst) {
+  // The last page is only partly used.
+  const size_t kLinesPerPage = 64;
+  const std::vector<size_t> order = ChaseOrder(1000, kLinesPerPage, 1);
+  ASSERT_EQ(order.size(), 1000u);
+  EXPECT_TRUE(IsPermutation(order));
+  size_t page_changes = 0;
+  for (size_t i = 1; i < order.size(); ++i) {
+    page_changes += order[i] / kLinesPerPage != order[i - 1] / kLinesPerPage;
+  }
+  EXPECT_EQ(page_changes, (1000 + kLinesPerPage - 1) / kLinesPerPage - 1);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
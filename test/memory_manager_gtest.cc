@@ -0,0 +1,48 @@
+//===---------------------------------------------------------------------===//
+// memory_manager_test - Unit tests for src/memory_manager.cc
+//===---------------------------------------------------------------------===//
+
+#include <cstring>
+#include <vector>
+
+#include "../src/internal_macros.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+TEST(MemoryManagerTest, ResultsStartNotMeasured) {
+  const MemoryManager::Result result;
+  EXPECT_EQ(result.num_allocs, 0);
+  EXPECT_EQ(result.total_allocated_bytes,
+            MemoryManager::Result::TombstoneValue);
+  EXPECT_EQ(result.peak_rss_bytes, MemoryManager::Result::TombstoneValue);
+  EXPECT_TRUE(result.alloc_size_histogram.empty());
+}
+
+#ifdef BENCHMARK_OS_LINUX
+TEST(ProcessMemoryManagerTest, MeasuresThePeakAndThePageFaults) {
+  const size_t kSize = 64 << 20;
+  ProcessMemoryManager manager;
+  MemoryManager::Result result;
+  manager.Start();
+  {
+    std::vector<char> buffer(kSize);
+    std::memset(buffer.data(), 1, kSize);
+    DoNotOptimize(buffer.data());
+    ClobberMemory();
+  }
+  manager.Stop(&result);
+  EXPECT_GE(result.peak_rss_bytes, static_cast<int64_t>(kSize));
+  // At least one per page, if not every page of a huge one.
+  EXPECT_GT(result.minor_page_faults, 0);
+  EXPECT_GE(result.major_page_faults, 0);
+  // Allocations are not counted.
+  EXPECT_EQ(result.num_allocs, MemoryManager::Result::TombstoneValue);
+  EXPECT_EQ(result.num_frees, MemoryManager::Result::TombstoneValue);
+}
+#endif
+
+}  // namespace
+}  // namespace benchmark
@@ -4,12 +4,32 @@
 #include "benchmark/benchmark.h"
 #include "output_test.h"
 
+// Measures what older MemoryManagers do for the first benchmark, and all but
+// the major page faults for the others.
 class TestMemoryManager : public benchmark::MemoryManager {
+ public:
+  TestMemoryManager() : num_runs_(0) {}
+
   void Start() BENCHMARK_OVERRIDE {}
   void Stop(Result* result) BENCHMARK_OVERRIDE {
-    result->num_allocs = 42;
-    result->max_bytes_used = 42000;
+    if (num_runs_++ == 0) {
+      result->num_allocs = 42;
+      result->max_bytes_used = 42000;
+      return;
+    }
+    // Over 16 iterations.
+    result->num_allocs = 32;
+    result->max_bytes_used = 2048;
+    result->total_allocated_bytes = 16 * 64;
+    result->num_frees = 24;
+    result->net_heap_growth = 16 * 8;
+    result->alloc_size_histogram = {0, 0, 0, 16, 16};
+    result->peak_rss_bytes = 1 << 20;
+    result->minor_page_faults = 160;
   }
+
+ private:
+  int num_runs_;
 };
 
 void BM_empty(benchmark::State& state) {
@@ -19,7 +39,9 @@ void BM_empty(benchmark::State& state) {
 }
 BENCHMARK(BM_empty);
 
-ADD_CASES(TC_ConsoleOut, {{"^BM_empty %console_report$"}});
+ADD_CASES(TC_ConsoleOut,
+          {{"^BM_empty %console_report allocs/iter=%hrfloat "
+            "max_bytes=41.0156k$"}});
 ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_empty\",$"},
                        {"\"family_index\": 0,$", MR_Next},
                        {"\"per_family_instance_index\": 0,$", MR_Next},
@@ -35,7 +57,40 @@ ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_empty\",$"},
                        {"\"allocs_per_iter\": %float,$", MR_Next},
                        {"\"max_bytes_used\": 42000$", MR_Next},
                        {"}", MR_Next}});
-ADD_CASES(TC_CSVOut, {{"^\"BM_empty\",%csv_report$"}});
+ADD_CASES(TC_CSVOut, {{"%csv_header,allocs_per_iter,max_bytes_used,"
+                        "bytes_allocated_per_iter,frees_per_iter,"
+                        "net_heap_growth_per_iter,peak_rss_bytes,"
+                        "minor_page_faults_per_iter,"
+                        "major_page_faults_per_iter$"},
+                       {"^\"BM_empty\",%csv_report,%float,42000,,,,,,$"}});
+
+void BM_detailed(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.iterations());
+  }
+}
+BENCHMARK(BM_detailed)->Iterations(100);
+
+ADD_CASES(TC_ConsoleOut,
+          {{"^BM_detailed/iterations:100 %console_report allocs/iter=2 "
+            "max_bytes=2k bytes/iter=64 frees/iter=1.5 net_bytes/iter=8 "
+            "minor_faults/iter=10 peak_rss=1024k$"}});
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_detailed/iterations:100\",$"},
+                       {"\"allocs_per_iter\": 2\\.0+e\\+00,$"},
+                       {"\"max_bytes_used\": 2048,$", MR_Next},
+                       {"\"bytes_allocated_per_iter\": 6\\.40+e\\+01,$",
+                        MR_Next},
+                       {"\"frees_per_iter\": 1\\.50+e\\+00,$", MR_Next},
+                       {"\"net_heap_growth_per_iter\": 8\\.0+e\\+00,$",
+                        MR_Next},
+                       {"\"minor_page_faults_per_iter\": 1\\.0+e\\+01,$",
+                        MR_Next},
+                       {"\"peak_rss_bytes\": 1048576,$", MR_Next},
+                       {"\"allocs_per_iter_by_size\": \\[\\[8, 1\\.0+e\\+00], "
+                        "\\[16, 1\\.0+e\\+00]]$", MR_Next},
+                       {"}", MR_Next}});
+ADD_CASES(TC_CSVOut, {{"^\"BM_detailed/iterations:100\",%csv_report,2,2048,64,"
+                        "1.5,8,1048576,10,$"}});
 
 int main(int argc, char* argv[]) {
   std::unique_ptr<benchmark::MemoryManager> mm(new TestMemoryManager());
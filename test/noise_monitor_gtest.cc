@@ -0,0 +1,68 @@
+//===---------------------------------------------------------------------===//
+// noise_monitor_test - Unit tests for src/noise_monitor.cc
+//===---------------------------------------------------------------------===//
+
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/noise_monitor.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+TEST(NoiseMonitorTest, ParsesTheThresholds) {
+  std::map<std::string, double> thresholds;
+  ASSERT_TRUE(ParseNoiseThresholds("", &thresholds));
+  EXPECT_TRUE(thresholds.empty());
+  ASSERT_TRUE(
+      ParseNoiseThresholds("cpu_migrations=0,minor_faults=10.5", &thresholds));
+  EXPECT_EQ(thresholds.size(), 2u);
+  EXPECT_EQ(thresholds["cpu_migrations"], 0);
+  EXPECT_EQ(thresholds["minor_faults"], 10.5);
+  EXPECT_FALSE(ParseNoiseThresholds("cpu_migrations", &thresholds));
+  EXPECT_FALSE(ParseNoiseThresholds("cpu_migrations=", &thresholds));
+  EXPECT_FALSE(ParseNoiseThresholds("cpu_migrations=-1", &thresholds));
+  EXPECT_FALSE(ParseNoiseThresholds("interrupts=0", &thresholds));
+}
+
+TEST(NoiseMonitorTest, TellsTheThresholdExceeded) {
+  std::map<std::string, double> thresholds;
+  ASSERT_TRUE(ParseNoiseThresholds("major_faults=0,voluntary_switches=2",
+                                   &thresholds));
+  UserCounters counters;
+  counters["major_faults"] = Counter(0);
+  counters["voluntary_switches"] = Counter(2);
+  EXPECT_EQ(ExceededNoiseThreshold(counters, thresholds), "");
+  counters["voluntary_switches"] = Counter(3);
+  EXPECT_EQ(ExceededNoiseThreshold(counters, thresholds),
+            "voluntary_switches: 3 > 2");
+  // What isn't counted isn't exceeded.
+  EXPECT_EQ(ExceededNoiseThreshold(UserCounters(), thresholds), "");
+}
+
+TEST(NoiseMonitorTest, CountsTheSwitchesAndFaultsOfTheThread) {
+  NoiseMonitor monitor;
+  monitor.Start();
+  // Sleeping gives the cpu up, and the pages of a new mapping fault in.
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::vector<char> memory(16 << 20);
+  std::memset(memory.data(), 1, memory.size());
+  UserCounters counters;
+  monitor.Stop(&counters);
+#ifndef _WIN32
+  EXPECT_GE(counters["voluntary_switches"].value, 1);
+  EXPECT_GE(counters["minor_faults"].value, 1);
+#endif
+  EXPECT_EQ(counters.count("involuntary_switches"), 1u);
+  EXPECT_EQ(counters.count("major_faults"), 1u);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
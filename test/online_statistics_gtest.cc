@@ -0,0 +1,117 @@
+//===---------------------------------------------------------------------===//
+// online_statistics_test - Unit tests for src/online_statistics.cc
+//===---------------------------------------------------------------------===//
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "../src/online_statistics.h"
+#include "../src/statistics.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(RunningMomentsTest, MatchesStatistics) {
+  const std::vector<double> v = {2.5, 2.4, 3.3, 4.2, 5.1};
+  benchmark::RunningMoments moments;
+  EXPECT_EQ(moments.Mean(), 0.0);
+  EXPECT_EQ(moments.StdDev(), 0.0);
+  for (double x : v) moments.Add(x);
+  EXPECT_EQ(moments.count(), 5u);
+  EXPECT_DOUBLE_EQ(moments.Mean(), benchmark::StatisticsMean(v));
+  EXPECT_DOUBLE_EQ(moments.StdDev(), benchmark::StatisticsStdDev(v));
+  EXPECT_DOUBLE_EQ(moments.CV(), benchmark::StatisticsCV(v));
+  EXPECT_EQ(moments.Min(), 2.4);
+  EXPECT_EQ(moments.Max(), 5.1);
+}
+
+TEST(RunningMomentsTest, NoCancellation) {
+  benchmark::RunningMoments moments;
+  for (int i = 0; i < 1000; ++i) moments.Add(1e9 + (i % 2));
+  EXPECT_NEAR(moments.StdDev(), 0.5, 1e-3);
+}
+
+TEST(StreamingQuantileTest, ExactForFewValues) {
+  benchmark::StreamingQuantile median(0.5);
+  benchmark::StreamingQuantile p95(0.95);
+  const std::vector<double> v = {5, 1, 4, 2, 3, 10};
+  for (double x : v) {
+    median.Add(x);
+    p95.Add(x);
+  }
+  EXPECT_DOUBLE_EQ(median.Value(), benchmark::StatisticsMedian(v));
+  EXPECT_DOUBLE_EQ(p95.Value(), benchmark::StatisticsP95(v));
+}
+
+TEST(StreamingQuantileTest, EstimatesManyValues) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> uniform(0.0, 100.0);
+  benchmark::StreamingQuantile median(0.5);
+  benchmark::StreamingQuantile p5(0.05);
+  for (int i = 0; i < 100000; ++i) {
+    const double x = uniform(rng);
+    median.Add(x);
+    p5.Add(x);
+  }
+  EXPECT_NEAR(median.Value(), 50.0, 1.0);
+  EXPECT_NEAR(p5.Value(), 5.0, 1.0);
+}
+
+TEST(StatisticsAccumulatorTest, MatchesComputeStats) {
+  const auto kUserStatistic = [](const std::vector<double>& v) {
+    return static_cast<double>(v.size());
+  };
+  const std::vector<benchmark::internal::Statistics> statistics = {
+      {"mean", benchmark::StatisticsMean},
+      {"median", benchmark::StatisticsMedian},
+      {"stddev", benchmark::StatisticsStdDev},
+      {"count", kUserStatistic}};
+  std::vector<benchmark::BenchmarkReporter::Run> reports(4);
+  const double times[] = {10, 12, 11, 15};
+  for (size_t i = 0; i < reports.size(); ++i) {
+    reports[i].iterations = 2;
+    reports[i].real_accumulated_time = times[i];
+    reports[i].cpu_accumulated_time = times[i] / 2;
+    reports[i].counters["items"] = benchmark::Counter(times[i]);
+    reports[i].statistics = &statistics;
+  }
+
+  benchmark::StatisticsAccumulator accumulator;
+  accumulator.Add(reports[0]);
+  EXPECT_TRUE(accumulator.Compute().empty());
+  for (size_t i = 1; i < reports.size(); ++i) accumulator.Add(reports[i]);
+  const auto aggregates = accumulator.Compute();
+  ASSERT_EQ(aggregates.size(), 4u);
+  EXPECT_EQ(aggregates[0].aggregate_name, "mean");
+  EXPECT_EQ(aggregates[0].iterations, 4);
+  // Per iteration, of which there were two in each repetition.
+  EXPECT_DOUBLE_EQ(aggregates[0].real_accumulated_time / 4, 12.0 / 2);
+  EXPECT_DOUBLE_EQ(aggregates[1].cpu_accumulated_time / 4, 11.5 / 2 / 2);
+  EXPECT_DOUBLE_EQ(aggregates[2].counters.at("items"),
+                   benchmark::StatisticsStdDev({10, 12, 11, 15}));
+  EXPECT_DOUBLE_EQ(aggregates[3].counters.at("items"), 4.0);
+}
+
+TEST(StatisticsAccumulatorTest, TakesTheIterationsFromARunThatDidNotFail) {
+  const std::vector<benchmark::internal::Statistics> statistics = {
+      {"mean", benchmark::StatisticsMean}};
+  std::vector<benchmark::BenchmarkReporter::Run> reports(4);
+  // The first one failed before it ran any iterations.
+  reports[0].error_occurred = true;
+  const double times[] = {0, 10, 12, 14};
+  for (size_t i = 1; i < reports.size(); ++i) {
+    reports[i].iterations = 2;
+    reports[i].real_accumulated_time = times[i];
+    reports[i].cpu_accumulated_time = times[i];
+    reports[i].statistics = &statistics;
+  }
+
+  benchmark::StatisticsAccumulator accumulator;
+  for (const auto& report : reports) accumulator.Add(report);
+  const auto aggregates = accumulator.Compute();
+  ASSERT_EQ(aggregates.size(), 1u);
+  EXPECT_DOUBLE_EQ(aggregates[0].real_accumulated_time / 4, 12.0 / 2);
+}
+
+}  // end namespace
@@ -55,10 +55,15 @@ TEST(PerfCountersTest, NegativeTest) {
                                       kGenericPerfEvent3})
                     .IsValid());
   }
-  EXPECT_FALSE(
+  // More counters than fit in one group are split into several groups.
+  EXPECT_TRUE(
       PerfCounters::Create({kGenericPerfEvent1, kGenericPerfEvent2,
                             kGenericPerfEvent3, "MISPREDICTED_BRANCH_RETIRED"})
           .IsValid());
+  EXPECT_FALSE(PerfCounters::Create(std::vector<std::string>(
+                                        PerfCounterValues::kMaxCounters + 1,
+                                        kGenericPerfEvent1))
+                   .IsValid());
 }
 
 TEST(PerfCountersTest, Read1Counter) {
@@ -95,6 +100,42 @@ TEST(PerfCountersTest, Read2Counters) {
   EXPECT_GT(values2[1], 0);
 }
 
+TEST(PerfCountersTest, ReadSeveralGroups) {
+  if (!PerfCounters::kSupported) {
+    GTEST_SKIP() << "Test skipped because libpfm is not supported.\n";
+  }
+  EXPECT_TRUE(PerfCounters::Initialize());
+  const std::vector<std::string> names = {
+      kGenericPerfEvent1, kGenericPerfEvent2, kGenericPerfEvent3,
+      kGenericPerfEvent1, kGenericPerfEvent2};
+  auto counters = PerfCounters::Create(names);
+  EXPECT_TRUE(counters.IsValid());
+  EXPECT_EQ(counters.num_groups(), 2u);
+  PerfCounterValues values(names.size());
+  EXPECT_TRUE(counters.Snapshot(&values));
+  for (size_t i = 0; i < names.size(); ++i) {
+    EXPECT_GT(values.time_enabled(i), 0u);
+    EXPECT_LE(values.time_running(i), values.time_enabled(i));
+  }
+}
+
+TEST(PerfCountersTest, ReadNonInheritedCounters) {
+  if (!PerfCounters::kSupported) {
+    GTEST_SKIP() << "Test skipped because libpfm is not supported.\n";
+  }
+  EXPECT_TRUE(PerfCounters::Initialize());
+  // These may be read in user space, without a syscall.
+  auto counters = PerfCounters::Create({kGenericPerfEvent1, kGenericPerfEvent3},
+                                       /*inherit=*/false);
+  EXPECT_TRUE(counters.IsValid());
+  PerfCounterValues values1(2);
+  EXPECT_TRUE(counters.Snapshot(&values1));
+  PerfCounterValues values2(2);
+  EXPECT_TRUE(counters.Snapshot(&values2));
+  EXPECT_GT(values2[0], values1[0]);
+  EXPECT_GT(values2[1], values1[1]);
+}
+
 size_t do_work() {
   size_t res = 0;
   for (size_t i = 0; i < 100000000; ++i) res += i * i;
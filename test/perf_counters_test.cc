@@ -19,6 +19,41 @@ static void CheckSimple(Results const& e) {
 }
 CHECK_BENCHMARK_RESULTS("BM_Simple", &CheckSimple);
 
+// Pausing and resuming the timer accumulates the counters over the timed
+// intervals only.
+static void BM_WithPauses(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    benchmark::DoNotOptimize(state.iterations());
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(state.iterations());
+  }
+}
+BENCHMARK(BM_WithPauses);
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_WithPauses\",$"}});
+
+static void CheckWithPauses(Results const& e) {
+  CHECK_COUNTER_VALUE(e, double, "CYCLES", GT, 0);
+  CHECK_COUNTER_VALUE(e, double, "BRANCHES", GT, 0.0);
+}
+CHECK_BENCHMARK_RESULTS("BM_WithPauses", &CheckWithPauses);
+
+// Each thread counts its own events.
+static void BM_Threaded(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.iterations());
+  }
+}
+BENCHMARK(BM_Threaded)->Threads(2);
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_Threaded/threads:2\",$"}});
+
+static void CheckThreaded(Results const& e) {
+  CHECK_COUNTER_VALUE(e, double, "CYCLES", GT, 0);
+  CHECK_COUNTER_VALUE(e, double, "CYCLES/thread:0", GT, 0);
+  CHECK_COUNTER_VALUE(e, double, "CYCLES/thread:1", GT, 0);
+}
+CHECK_BENCHMARK_RESULTS("BM_Threaded/threads:2", &CheckThreaded);
+
 int main(int argc, char* argv[]) {
   if (!benchmark::internal::PerfCounters::kSupported) {
     return 0;
@@ -0,0 +1,125 @@
+//===---------------------------------------------------------------------===//
+// perf_metrics_test - Unit tests for src/perf_metrics.cc
+//===---------------------------------------------------------------------===//
+
+#include <string>
+#include <vector>
+
+#include "../src/perf_metrics.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+TEST(PerfMetricsTest, KnowsTheSets) {
+  EXPECT_TRUE(PerfMetrics::IsValid({}));
+  EXPECT_TRUE(PerfMetrics::IsValid({"ipc", "branch", "memory", "tma_l1"}));
+  EXPECT_FALSE(PerfMetrics::IsValid({"ipc", "tma_l2"}));
+}
+
+TEST(PerfMetricsTest, CountersAreOnlyOpenedOnce) {
+  PerfMetrics metrics;
+  std::string error;
+  ASSERT_TRUE(PerfMetrics::Create({"ipc", "branch", "ipc"}, "", &metrics,
+                                  &error));
+  EXPECT_EQ(metrics.counter_names(),
+            (std::vector<std::string>{"CYCLES", "INSTRUCTIONS", "BRANCHES",
+                                      "BRANCH-MISSES"}));
+}
+
+TEST(PerfMetricsTest, TopDownNeedsAKnownCore) {
+  PerfMetrics metrics;
+  std::string error;
+  ASSERT_TRUE(PerfMetrics::Create({"tma_l1"}, "skl", &metrics, &error));
+  EXPECT_EQ(metrics.counter_names().size(), 5u);
+  EXPECT_FALSE(
+      PerfMetrics::Create({"tma_l1"}, "amd64_fam19h_zen3", &metrics, &error));
+  EXPECT_EQ(error,
+            "the events of 'tma_l1' are not known for this cpu "
+            "(amd64_fam19h_zen3)");
+  EXPECT_FALSE(PerfMetrics::Create({"tma_l1"}, "", &metrics, &error));
+}
+
+TEST(PerfMetricsTest, ComputesTheRatiosOfTheTotals) {
+  PerfMetrics metrics;
+  std::string error;
+  ASSERT_TRUE(PerfMetrics::Create({"ipc", "branch", "memory"}, "", &metrics,
+                                  &error));
+  UserCounters counters;
+  counters["CYCLES"] = Counter(1000, Counter::kAvgIterations);
+  counters["INSTRUCTIONS"] = Counter(2000, Counter::kAvgIterations);
+  counters["BRANCHES"] = Counter(400, Counter::kAvgIterations);
+  counters["BRANCH-MISSES"] = Counter(20, Counter::kAvgIterations);
+  counters["PERF_COUNT_HW_CACHE_L1D:READ:MISS"] =
+      Counter(100, Counter::kAvgIterations);
+  counters["CACHE-MISSES"] = Counter(4, Counter::kAvgIterations);
+  metrics.Compute(&counters);
+  EXPECT_DOUBLE_EQ(counters["ipc"].value, 2);
+  EXPECT_EQ(counters["ipc"].flags, Counter::kDefaults);
+  EXPECT_DOUBLE_EQ(counters["branch_miss_rate"].value, 0.05);
+  EXPECT_DOUBLE_EQ(counters["branch_mpki"].value, 10);
+  EXPECT_DOUBLE_EQ(counters["l1d_mpki"].value, 50);
+  EXPECT_DOUBLE_EQ(counters["llc_mpki"].value, 2);
+}
+
+TEST(PerfMetricsTest, ComputesTheTopDownLevel1) {
+  PerfMetrics metrics;
+  std::string error;
+  ASSERT_TRUE(PerfMetrics::Create({"tma_l1"}, "skl", &metrics, &error));
+  UserCounters counters;
+  // 400 slots, of which 100 were not delivered uops, and 200 retired them.
+  counters["UNHALTED_CORE_CYCLES"] = Counter(100);
+  counters["IDQ_UOPS_NOT_DELIVERED:CORE"] = Counter(100);
+  counters["UOPS_ISSUED:ANY"] = Counter(220);
+  counters["UOPS_RETIRED:RETIRE_SLOTS"] = Counter(200);
+  counters["INT_MISC:RECOVERY_CYCLES"] = Counter(5);
+  metrics.Compute(&counters);
+  EXPECT_DOUBLE_EQ(counters["tma_frontend_bound"].value, 0.25);
+  EXPECT_DOUBLE_EQ(counters["tma_bad_speculation"].value, 0.1);
+  EXPECT_DOUBLE_EQ(counters["tma_retiring"].value, 0.5);
+  EXPECT_DOUBLE_EQ(counters["tma_backend_bound"].value, 0.15);
+}
+
+TEST(PerfMetricsTest, LeavesOutTheMetricsOfMissingCounters) {
+  PerfMetrics metrics;
+  std::string error;
+  ASSERT_TRUE(PerfMetrics::Create({"ipc", "branch"}, "", &metrics, &error));
+  UserCounters counters;
+  counters["CYCLES"] = Counter(1000);
+  metrics.Compute(&counters);
+  EXPECT_EQ(counters.size(), 1u);
+}
+
+TEST(PerfMetricsTest, CountsTheCountersPerItemAndPerByte) {
+  UserCounters counters;
+  counters["CYCLES"] = Counter(6000, Counter::kAvgIterations);
+  counters["INSTRUCTIONS"] = Counter(12000, Counter::kAvgIterations);
+  counters["CACHE-MISSES"] = Counter(30, Counter::kAvgIterations);
+  counters["items_per_second"] = Counter(100, Counter::kIsRate);
+  counters["bytes_per_second"] = Counter(1500, Counter::kIsRate);
+  AddPerUnitCounters({"CYCLES", "INSTRUCTIONS"}, &counters);
+  EXPECT_DOUBLE_EQ(counters["CYCLES_per_item"].value, 60);
+  EXPECT_DOUBLE_EQ(counters["CYCLES_per_byte"].value, 4);
+  EXPECT_EQ(counters["CYCLES_per_byte"].flags, Counter::kDefaults);
+  EXPECT_DOUBLE_EQ(counters["INSTRUCTIONS_per_item"].value, 120);
+  EXPECT_DOUBLE_EQ(counters["INSTRUCTIONS_per_byte"].value, 8);
+  EXPECT_DOUBLE_EQ(counters["ipc"].value, 2);
+  // Only those of the perf counters.
+  EXPECT_EQ(counters.count("CACHE-MISSES_per_item"), 0u);
+  EXPECT_EQ(counters.size(), 10u);
+}
+
+TEST(PerfMetricsTest, CountsPerUnitOnlyWhatWasProcessed) {
+  UserCounters counters;
+  counters["CYCLES"] = Counter(6000, Counter::kAvgIterations);
+  counters["items_per_second"] = Counter(100, Counter::kIsRate);
+  AddPerUnitCounters({"CYCLES", "INSTRUCTIONS"}, &counters);
+  EXPECT_DOUBLE_EQ(counters["CYCLES_per_item"].value, 60);
+  // No bytes, and no instructions to make an ipc of.
+  EXPECT_EQ(counters.size(), 3u);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,133 @@
+
+#undef NDEBUG
+#include <cassert>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+
+ABSL_DECLARE_FLAG(std::string, benchmark_isolation);
+
+namespace {
+
+class TestReporter : public benchmark::ConsoleReporter {
+ public:
+  virtual void ReportRuns(const std::vector<Run>& report) BENCHMARK_OVERRIDE {
+    all_runs_.insert(all_runs_.end(), begin(report), end(report));
+    ConsoleReporter::ReportRuns(report);
+  }
+
+  std::vector<Run> all_runs_;
+};
+
+// Set by every repetition, but only ever in a child process.
+int times_run = 0;
+
+void BM_SeesFreshState(benchmark::State& state) {
+  const int previous_runs = times_run;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(times_run);
+  }
+  ++times_run;
+  state.counters["previous_runs"] = previous_runs;
+}
+BENCHMARK(BM_SeesFreshState)->Repetitions(3)->Iterations(10);
+
+void BM_Crashes(benchmark::State& state) {
+  for (auto _ : state) {
+    std::abort();
+  }
+}
+BENCHMARK(BM_Crashes);
+
+// Which a child process leaves behind so only the first repetition crashes.
+std::string crash_marker;
+
+void BM_CrashesFirst(benchmark::State& state) {
+  if (std::FILE* marker = std::fopen(crash_marker.c_str(), "r")) {
+    std::fclose(marker);
+  } else {
+    std::fclose(std::fopen(crash_marker.c_str(), "w"));
+    std::abort();
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.iterations());
+  }
+}
+BENCHMARK(BM_CrashesFirst)->Repetitions(3);
+
+void BM_Threaded(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.iterations());
+  }
+}
+BENCHMARK(BM_Threaded)->Threads(2)->Repetitions(2);
+
+}  // end namespace
+
+int main(int argc, char* argv[]) {
+  absl::SetFlag(&FLAGS_benchmark_isolation, "process");
+  benchmark::Initialize(&argc, argv);
+  const char* tmpdir = std::getenv("TMPDIR");
+  crash_marker = std::string(tmpdir != nullptr ? tmpdir : "/tmp") +
+                 "/process_isolation_test_crashed";
+  std::remove(crash_marker.c_str());
+
+  TestReporter test_reporter;
+  benchmark::RunSpecifiedBenchmarks(&test_reporter);
+
+  typedef benchmark::BenchmarkReporter::Run Run;
+  int fresh_runs = 0, crashed_runs = 0, threaded_runs = 0;
+  int crashed_first_runs = 0, crashed_first_aggregates = 0;
+  for (const Run& run : test_reporter.all_runs_) {
+    const std::string name = run.benchmark_name();
+    if (name.find("BM_CrashesFirst") == 0) {
+      if (run.run_type == Run::RT_Aggregate) {
+        assert(std::isfinite(run.GetAdjustedRealTime()));
+        ++crashed_first_aggregates;
+      } else if (crashed_first_runs++ == 0) {
+        assert(run.error_occurred);
+      } else {
+        // The repetitions after the crash still find the iteration count.
+        assert(!run.error_occurred);
+        assert(run.iterations > 1);
+      }
+      continue;
+    }
+    if (run.run_type != Run::RT_Iteration) continue;
+    if (name.find("BM_SeesFreshState") == 0) {
+      assert(!run.error_occurred);
+      assert(run.iterations == 10);
+      assert(run.counters.at("previous_runs").value == 0);
+      ++fresh_runs;
+    } else if (name.find("BM_Crashes") == 0) {
+      assert(run.error_occurred);
+      assert(run.error_message ==
+             "the benchmark process was killed by signal " +
+                 std::to_string(SIGABRT));
+      ++crashed_runs;
+    } else if (name.find("BM_Threaded") == 0) {
+      assert(!run.error_occurred);
+      assert(run.threads == 2);
+      assert(run.iterations > 0);
+      assert(run.repetition_index == threaded_runs);
+      ++threaded_runs;
+    }
+  }
+  assert(fresh_runs == 3);
+  assert(crashed_runs == 1);
+  assert(threaded_runs == 2);
+  assert(crashed_first_runs == 3);
+  assert(crashed_first_aggregates > 0);
+  std::remove(crash_marker.c_str());
+  // Nothing ran in this process.
+  assert(times_run == 0);
+
+  return 0;
+}
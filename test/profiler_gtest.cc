@@ -0,0 +1,101 @@
+//===---------------------------------------------------------------------===//
+// profiler_test - Unit tests for src/profiler.cc
+//===---------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "../src/profiler.h"
+#include "../src/timers.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+uint64_t NumSamples(const Profiler& profiler) {
+  uint64_t total = 0;
+  for (const auto& sample : profiler.samples()) total += sample.second;
+  return total;
+}
+
+void Spin(double seconds) {
+  volatile double x = 0;
+  const double start = ThreadCPUUsage();
+  while (ThreadCPUUsage() - start < seconds) x = x + 1;
+}
+
+TEST(ProfilerTest, ParsesTheModes) {
+  Profiler::Mode mode;
+  ASSERT_TRUE(Profiler::ParseMode("perf", &mode));
+  EXPECT_EQ(mode, Profiler::kInstructions);
+  ASSERT_TRUE(Profiler::ParseMode("lbr", &mode));
+  EXPECT_EQ(mode, Profiler::kBranches);
+  // Processor traces are not decoded.
+  EXPECT_FALSE(Profiler::ParseMode("pt", &mode));
+  EXPECT_FALSE(Profiler::ParseMode("", &mode));
+}
+
+TEST(ProfilerTest, FilesAreNamedAfterTheBenchmark) {
+  EXPECT_EQ(ProfilePath("out", "BM_Sort<int>/1024/threads:2",
+                        Profiler::kInstructions),
+            "out/BM_Sort_int__1024_threads_2.perf.txt");
+  EXPECT_EQ(ProfilePath("", "BM_Sort", Profiler::kBranches), "BM_Sort.lbr.txt");
+}
+
+TEST(ProfilerTest, SamplesOnlyWhileStarted) {
+  std::string error;
+  std::unique_ptr<Profiler> profiler =
+      Profiler::Create(Profiler::kInstructions, &error);
+  // Unless the kernel doesn't let us sample here at all.
+  if (!profiler) {
+    EXPECT_FALSE(error.empty());
+    return;
+  }
+  profiler->Start();
+  Spin(0.1);
+  profiler->Stop();
+  const uint64_t samples = NumSamples(*profiler);
+  EXPECT_GT(samples, 0u);
+
+  Spin(0.1);
+  profiler->Start();
+  profiler->Stop();
+  // At most the one sample that may be taken in between.
+  EXPECT_LE(NumSamples(*profiler), samples + 1);
+
+  profiler->Clear();
+  EXPECT_EQ(NumSamples(*profiler), 0u);
+  EXPECT_EQ(profiler->lost(), 0u);
+}
+
+TEST(ProfilerTest, WritesAFlatProfile) {
+  std::string error;
+  std::unique_ptr<Profiler> profiler =
+      Profiler::Create(Profiler::kInstructions, &error);
+  if (!profiler) return;
+  profiler->Start();
+  Spin(0.1);
+  profiler->Stop();
+
+  const std::string path = ::testing::TempDir() + "profiler_test.perf.txt";
+  ASSERT_TRUE(WriteProfile("BM_Spin", Profiler::kInstructions,
+                           {profiler.get()}, path));
+  std::ifstream in(path.c_str());
+  std::string line;
+  ASSERT_TRUE(std::getline(in, line));
+  EXPECT_EQ(line, "# Profile of BM_Spin, sampled at 1000 Hz");
+  ASSERT_TRUE(std::getline(in, line));
+  EXPECT_EQ(line, "# " + std::to_string(NumSamples(*profiler)) +
+                      " samples, 0 samples lost");
+  ASSERT_TRUE(std::getline(in, line));
+  EXPECT_EQ(line, "# samples percent function");
+  // At least the function the samples fell in.
+  EXPECT_TRUE(std::getline(in, line));
+  std::remove(path.c_str());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
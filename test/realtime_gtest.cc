@@ -0,0 +1,42 @@
+//===---------------------------------------------------------------------===//
+// realtime_test - Unit tests for src/realtime.cc
+//===---------------------------------------------------------------------===//
+
+#include <string>
+
+#include "../src/realtime.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+TEST(RealtimeTest, PutsTheSchedulingBack) {
+  ThreadScheduling before;
+  std::string error;
+  // Unless we are not allowed to here.
+  if (!SetCurrentThreadRealtime(1, &before, &error)) {
+    EXPECT_FALSE(error.empty());
+    return;
+  }
+  ThreadScheduling realtime;
+  ASSERT_TRUE(SetCurrentThreadRealtime(2, &realtime, nullptr));
+  EXPECT_EQ(realtime.priority, 1);
+  RestoreCurrentThreadScheduling(before);
+
+  ThreadScheduling after;
+  ASSERT_TRUE(SetCurrentThreadRealtime(1, &after, nullptr));
+  RestoreCurrentThreadScheduling(before);
+  EXPECT_EQ(after.policy, before.policy);
+  EXPECT_EQ(after.priority, before.priority);
+}
+
+TEST(RealtimeTest, RejectsAnInvalidPriority) {
+  std::string error;
+  EXPECT_FALSE(SetCurrentThreadRealtime(100, nullptr, &error));
+  EXPECT_FALSE(error.empty());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
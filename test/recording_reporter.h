@@ -0,0 +1,31 @@
+#ifndef TEST_RECORDING_REPORTER_H
+#define TEST_RECORDING_REPORTER_H
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+namespace benchmark {
+
+// Records the runs in the order they are reported: each repetition as soon
+// as it is done, then the aggregates of the instance. For the tests of the
+// order of the repetitions; RunSpecifiedBenchmarks(spec) returns the runs
+// otherwise.
+class RecordingReporter : public BenchmarkReporter {
+ public:
+  bool ReportContext(const Context& /*context*/) override { return true; }
+  bool StreamsRepetitions() const override { return true; }
+  void ReportRepetition(const Run& run) override { runs.push_back(run); }
+  void ReportRuns(const std::vector<Run>& report) override {
+    // The others were reported as repetitions already.
+    for (const Run& run : report) {
+      if (run.run_type == Run::RT_Aggregate) runs.push_back(run);
+    }
+  }
+
+  std::vector<Run> runs;
+};
+
+}  // namespace benchmark
+
+#endif  // TEST_RECORDING_REPORTER_H
@@ -0,0 +1,84 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+void Spin(int n) {
+  for (int i = 0; i < n; ++i) DoNotOptimize(i);
+}
+
+void BM_Regions(State& state) {
+  for (auto _ : state) {
+    {
+      Region r(state, "hash");
+      Spin(1000);
+    }
+    Region r(state, "probe");
+    for (int i = 0; i < 2; ++i) {
+      Region c(state, "compare");
+      Spin(1000);
+    }
+  }
+}
+BENCHMARK(BM_Regions)->Iterations(100)->Threads(1)->Threads(2);
+
+TEST(RegionTest, ReportsTheNestedRegions) {
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Regions");
+
+  ASSERT_EQ(runs.size(), 2u);
+  for (const BenchmarkReporter::Run& run : runs) {
+    ASSERT_EQ(run.counters.size(), 3u) << run.benchmark_name();
+    const double hash = run.counters.at("region/hash").value;
+    const double probe = run.counters.at("region/probe").value;
+    const double compare = run.counters.at("region/probe;compare").value;
+    EXPECT_GT(hash, 0);
+    EXPECT_GT(compare, 0);
+    // A region includes those nested in it, and the threads add up.
+    EXPECT_GE(probe, compare);
+    EXPECT_LE(hash + probe,
+              run.real_accumulated_time * static_cast<double>(run.threads) /
+                  static_cast<double>(run.iterations) * 1.01);
+  }
+}
+
+TEST(RegionTest, FoldsTheTimeOfTheRegions) {
+  BenchmarkReporter::Run run;
+  run.run_name.function_name = "BM_A;B";
+  run.iterations = 1000;
+  run.threads = 2;
+  run.real_accumulated_time = 0.002;
+  run.counters["region/a"] = Counter(2e-6);
+  run.counters["region/a;b"] = Counter(0.5e-6);
+  run.counters["region/a;b/CYCLES"] = Counter(1000);
+  run.counters["region/c"] = Counter(1e-6);
+  run.counters["items"] = Counter(10);
+  BenchmarkReporter::Run aggregate = run;
+  aggregate.run_type = BenchmarkReporter::Run::RT_Aggregate;
+  BenchmarkReporter::Run no_regions;
+  no_regions.run_name.function_name = "BM_B";
+  no_regions.iterations = 1;
+  no_regions.real_accumulated_time = 1;
+
+  std::ostringstream out;
+  FoldedReporter reporter;
+  reporter.SetOutputStream(&out);
+  reporter.SetErrorStream(&out);
+  reporter.ReportContext(BenchmarkReporter::Context());
+  reporter.ReportRuns({run, aggregate, no_regions});
+  reporter.Finalize();
+
+  EXPECT_EQ(out.str(),
+            "BM_A:B 1000000\n"
+            "BM_A:B;a 1500000\n"
+            "BM_A:B;a;b 500000\n"
+            "BM_A:B;c 1000000\n");
+}
+
+}  // namespace
+}  // namespace benchmark
@@ -1120,6 +1120,28 @@ void BM_CSV_Format(benchmark::State& state) {
 BENCHMARK(BM_CSV_Format);
 ADD_CASES(TC_CSVOut, {{"^\"BM_CSV_Format\",,,,,,,,true,\"\"\"freedom\"\"\"$"}});
 
+// ========================================================================= //
+// ----------------------------- Testing Tags ------------------------------ //
+// ========================================================================= //
+
+void BM_tagged(benchmark::State& state) {
+  for (auto _ : state) {
+  }
+}
+BENCHMARK(BM_tagged)->Tags({"slow", "numa"});
+ADD_CASES(TC_ConsoleOut, {{"^BM_tagged %console_report$"}});
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_tagged\",$"},
+                       {"\"family_index\": %int,$", MR_Next},
+                       {"\"per_family_instance_index\": 0,$", MR_Next},
+                       {"\"run_name\": \"BM_tagged\",$", MR_Next},
+                       {"\"run_type\": \"iteration\",$", MR_Next},
+                       {"\"repetitions\": 1,$", MR_Next},
+                       {"\"repetition_index\": 0,$", MR_Next},
+                       {"\"threads\": 1,$", MR_Next},
+                       {"\"tags\": \\[\"slow\", \"numa\"],$", MR_Next},
+                       {"\"iterations\": %int,$", MR_Next}});
+ADD_CASES(TC_CSVOut, {{"^\"BM_tagged\",%csv_report$"}});
+
 // ========================================================================= //
 // --------------------------- TEST CASES END ------------------------------ //
 // ========================================================================= //
@@ -0,0 +1,153 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/reporting_thread.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+ABSL_DECLARE_FLAG(bool, benchmark_background_reporting);
+ABSL_DECLARE_FLAG(std::string, benchmark_filter);
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+BenchmarkReporter::Run MakeRun(const std::string& name) {
+  BenchmarkReporter::Run run;
+  run.run_name.function_name = name;
+  return run;
+}
+
+TEST(ReportingThreadTest, ReportsInTheOrderPosted) {
+  std::vector<std::string> reported;
+  {
+    ReportingThread thread(
+        [&reported](const RunResults& results,
+                    const BenchmarkReporter::Run* repetition) {
+          if (repetition != nullptr) {
+            reported.push_back("Repetition " +
+                               repetition->run_name.function_name);
+            return;
+          }
+          for (const BenchmarkReporter::Run& run : results.non_aggregates)
+            reported.push_back("Run " + run.run_name.function_name);
+        },
+        2, {});
+    RunResults results;
+    results.non_aggregates.push_back(MakeRun("BM_0"));
+    results.non_aggregates.push_back(MakeRun("BM_1"));
+    results.display_report_aggregates_only = true;
+    for (int i = 0; i < 10; ++i)
+      thread.PostRepetition(results, MakeRun("BM_" + std::to_string(i)));
+    thread.PostResults(results);
+  }
+  std::vector<std::string> expected;
+  for (int i = 0; i < 10; ++i)
+    expected.push_back("Repetition BM_" + std::to_string(i));
+  expected.push_back("Run BM_0");
+  expected.push_back("Run BM_1");
+  EXPECT_EQ(reported, expected);
+}
+
+TEST(ReportingThreadTest, PassesTheOptionsOfTheRepetitions) {
+  bool display_aggregates_only = false;
+  size_t num_non_aggregates = 0;
+  ReportingThread thread(
+      [&](const RunResults& results, const BenchmarkReporter::Run*) {
+        display_aggregates_only = results.display_report_aggregates_only;
+        num_non_aggregates = results.non_aggregates.size();
+      },
+      1, {});
+  RunResults results;
+  results.non_aggregates.resize(3);
+  results.display_report_aggregates_only = true;
+  thread.PostRepetition(results, MakeRun("BM_Run"));
+  thread.WaitForIdle();
+  EXPECT_TRUE(display_aggregates_only);
+  EXPECT_EQ(num_non_aggregates, 1u);
+}
+
+TEST(ReportingThreadTest, PostWaitsWhileTheQueueIsFull) {
+  std::atomic<bool> release(false);
+  std::atomic<int> num_reported(0);
+  ReportingThread thread(
+      [&](const RunResults&, const BenchmarkReporter::Run*) {
+        while (!release) std::this_thread::yield();
+        ++num_reported;
+      },
+      2, {});
+  RunResults results;
+  // One being reported, and two waiting.
+  for (int i = 0; i < 3; ++i) thread.PostResults(results);
+  std::atomic<bool> posted(false);
+  std::thread poster([&]() {
+    thread.PostResults(results);
+    posted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(posted);
+  release = true;
+  poster.join();
+  thread.WaitForIdle();
+  EXPECT_EQ(num_reported, 4);
+}
+
+void BM_Empty(State& state) {
+  for (auto _ : state) {
+  }
+}
+BENCHMARK(BM_Empty)->Name("BM_Background")->Iterations(10)->Repetitions(3);
+
+// Records the repetitions and the aggregates, in the order they are reported,
+// and whether any of them was reported by the thread that runs them.
+class RecordingReporter : public BenchmarkReporter {
+ public:
+  RecordingReporter()
+      : main_thread(std::this_thread::get_id()), on_main_thread(false) {}
+
+  bool ReportContext(const Context& /*context*/) override { return true; }
+  bool StreamsRepetitions() const override { return true; }
+  void ReportRepetition(const Run& run) override {
+    Record("Repetition " + run.run_name.function_name);
+  }
+  void ReportRuns(const std::vector<Run>& report) override {
+    for (const Run& run : report) {
+      if (run.run_type == Run::RT_Aggregate)
+        Record("Run " + run.run_name.function_name + "_" + run.aggregate_name);
+    }
+  }
+
+  void Record(const std::string& event) {
+    on_main_thread |= std::this_thread::get_id() == main_thread;
+    events.push_back(event);
+  }
+
+  const std::thread::id main_thread;
+  bool on_main_thread;
+  std::vector<std::string> events;
+};
+
+TEST(ReportingThreadTest, ReportsTheBenchmarksInOrder) {
+  absl::SetFlag(&FLAGS_benchmark_filter, "BM_Background");
+  absl::SetFlag(&FLAGS_benchmark_background_reporting, true);
+  RecordingReporter reporter;
+  RunSpecifiedBenchmarks(&reporter);
+  absl::SetFlag(&FLAGS_benchmark_background_reporting, false);
+
+  const std::vector<std::string> expected = {
+      "Repetition BM_Background", "Repetition BM_Background",
+      "Repetition BM_Background", "Run BM_Background_mean",
+      "Run BM_Background_median", "Run BM_Background_stddev",
+      "Run BM_Background_cv"};
+  EXPECT_EQ(reporter.events, expected);
+  EXPECT_FALSE(reporter.on_main_thread);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,133 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/benchmark_api_internal.h"
+#include "../src/benchmark_runner.h"
+#include "../src/result_cache.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace benchmark;
+using namespace benchmark::internal;
+
+void BM_Noop(State& state) {
+  for (auto _ : state) {
+  }
+}
+
+class ResultCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    RegisterBenchmark("BM_Cached", BM_Noop)->Arg(1)->Arg(2);
+    RegisterBenchmark("BM_Own", BM_Noop)->CacheFingerprint("own");
+    RegisterBenchmark("BM_Complexity", BM_Noop)->Arg(1)->Complexity(oN);
+    std::stringstream err;
+    ASSERT_TRUE(FindBenchmarksInternal(".", &instances_, &err));
+    ASSERT_EQ(instances_.size(), 4u);
+    dir_ = ::testing::TempDir() + "result_cache_gtest";
+  }
+
+  void TearDown() override { ClearRegisteredBenchmarks(); }
+
+  static RunResults MakeResults(const BenchmarkInstance& instance,
+                                double real_time) {
+    RunResults results;
+    BenchmarkReporter::Run run;
+    run.run_name = instance.name();
+    run.iterations = 10;
+    run.real_accumulated_time = real_time;
+    run.counters["items"] = Counter(3);
+    results.non_aggregates.push_back(run);
+    results.file_report_aggregates_only = true;
+    return results;
+  }
+
+  std::vector<BenchmarkInstance> instances_;
+  std::string dir_;
+};
+
+TEST_F(ResultCacheTest, LoadsWhatWasStored) {
+  const ResultCache cache(dir_, "exe1");
+  ASSERT_TRUE(cache.Store(instances_[0], MakeResults(instances_[0], 1.5)));
+  RunResults results;
+  ASSERT_TRUE(cache.Load(instances_[0], &results));
+  ASSERT_EQ(results.non_aggregates.size(), 1u);
+  const BenchmarkReporter::Run& run = results.non_aggregates[0];
+  EXPECT_EQ(run.benchmark_name(), "BM_Cached/1");
+  EXPECT_EQ(run.iterations, 10);
+  EXPECT_EQ(run.real_accumulated_time, 1.5);
+  EXPECT_EQ(run.counters.at("items").value, 3);
+  EXPECT_EQ(run.family_index, instances_[0].family_index());
+  EXPECT_TRUE(run.cached);
+  EXPECT_TRUE(results.file_report_aggregates_only);
+  EXPECT_FALSE(results.display_report_aggregates_only);
+
+  // The other instance of the family isn't cached.
+  EXPECT_FALSE(cache.Load(instances_[1], &results));
+}
+
+TEST_F(ResultCacheTest, DependsOnTheFingerprint) {
+  ASSERT_TRUE(ResultCache(dir_, "exe1").Store(
+      instances_[0], MakeResults(instances_[0], 1.0)));
+  RunResults results;
+  EXPECT_FALSE(ResultCache(dir_, "exe2").Load(instances_[0], &results));
+  EXPECT_NE(ResultCache(dir_, "exe1").Key(instances_[0]),
+            ResultCache(dir_, "exe2").Key(instances_[0]));
+
+  // A fingerprint of the benchmark's own takes precedence.
+  ASSERT_TRUE(ResultCache(dir_, "exe1").Store(
+      instances_[2], MakeResults(instances_[2], 2.0)));
+  EXPECT_TRUE(ResultCache(dir_, "exe2").Load(instances_[2], &results));
+  EXPECT_FALSE(ResultCache(dir_, "").IsCacheable(instances_[0]));
+  EXPECT_TRUE(ResultCache(dir_, "").IsCacheable(instances_[2]));
+}
+
+TEST_F(ResultCacheTest, SkipsFailuresAndFamilyAggregates) {
+  const ResultCache cache(dir_, "exe3");
+  RunResults failed = MakeResults(instances_[1], 1.0);
+  failed.non_aggregates[0].error_occurred = true;
+  ASSERT_TRUE(cache.Store(instances_[1], failed));
+  RunResults results;
+  EXPECT_FALSE(cache.Load(instances_[1], &results));
+
+  EXPECT_FALSE(cache.IsCacheable(instances_[3]));
+  ASSERT_TRUE(cache.Store(instances_[3], MakeResults(instances_[3], 1.0)));
+  EXPECT_FALSE(cache.Load(instances_[3], &results));
+}
+
+// Whether setting 'flag' to 'value' changes the key of the instance.
+template <class T>
+bool KeyDependsOn(absl::Flag<T>* flag, const T& value,
+                  const BenchmarkInstance& instance) {
+  const ResultCache cache("", "exe");
+  const std::string key = cache.Key(instance);
+  const T old_value = absl::GetFlag(*flag);
+  absl::SetFlag(flag, value);
+  const std::string changed = cache.Key(instance);
+  absl::SetFlag(flag, old_value);
+  return changed != key;
+}
+
+// Whether setting the bool 'flag' changes the key of the instance.
+bool KeyDependsOn(absl::Flag<bool>* flag, const BenchmarkInstance& instance) {
+  return KeyDependsOn(flag, !absl::GetFlag(*flag), instance);
+}
+
+TEST_F(ResultCacheTest, DependsOnTheFlagsThatChangeTheResults) {
+  EXPECT_TRUE(KeyDependsOn(&FLAGS_benchmark_process_memory, instances_[0]));
+  EXPECT_TRUE(KeyDependsOn(&FLAGS_benchmark_calibrate, instances_[0]));
+  EXPECT_TRUE(KeyDependsOn(&FLAGS_benchmark_energy, instances_[0]));
+  EXPECT_TRUE(KeyDependsOn(&FLAGS_benchmark_check_measurements, instances_[0]));
+  EXPECT_TRUE(KeyDependsOn(&FLAGS_benchmark_harness_stats, instances_[0]));
+  EXPECT_TRUE(KeyDependsOn(&FLAGS_benchmark_interference_file,
+                           std::string("runs.json"), instances_[0]));
+  EXPECT_TRUE(KeyDependsOn(&FLAGS_benchmark_calibration_interval, 60.0,
+                           instances_[0]));
+  EXPECT_TRUE(KeyDependsOn(&FLAGS_benchmark_iterations_hint_file,
+                           std::string("runs.json"), instances_[0]));
+}
+
+}  // end namespace
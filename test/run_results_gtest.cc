@@ -0,0 +1,372 @@
+//===---------------------------------------------------------------------===//
+// run_results_gtest - Tests for RunSpecifiedBenchmarks(spec)
+//===---------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+ABSL_DECLARE_FLAG(bool, benchmark_thread_breakdown);
+ABSL_DECLARE_FLAG(std::string, benchmark_noise_thresholds);
+ABSL_DECLARE_FLAG(int32_t, benchmark_noise_max_reruns);
+ABSL_DECLARE_FLAG(std::string, benchmark_normalize_time);
+
+namespace benchmark {
+namespace {
+
+void BM_Counted(State& state) {
+  for (auto _ : state) {
+  }
+  state.counters["arg"] = static_cast<double>(state.range(0));
+}
+
+TEST(RunResultsTest, ReturnsTheRunsOfTheMatchingBenchmarks) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_Counted", BM_Counted)
+      ->Arg(1)
+      ->Arg(2)
+      ->Iterations(10)
+      ->Repetitions(2);
+  RegisterBenchmark("BM_Other", BM_Counted)->Arg(3)->Iterations(10);
+
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Counted/2");
+  std::vector<std::string> names;
+  for (const BenchmarkReporter::Run& run : runs) {
+    names.push_back(run.run_name.function_name + "/" + run.run_name.args +
+                    (run.aggregate_name.empty() ? "" : "_") +
+                    run.aggregate_name);
+  }
+  EXPECT_EQ(names, std::vector<std::string>(
+                       {"BM_Counted/2", "BM_Counted/2", "BM_Counted/2_mean",
+                        "BM_Counted/2_median", "BM_Counted/2_stddev",
+                        "BM_Counted/2_cv"}));
+  ASSERT_EQ(runs.size(), 6u);
+  EXPECT_EQ(runs[0].run_type, BenchmarkReporter::Run::RT_Iteration);
+  EXPECT_EQ(runs[0].iterations, 10u);
+  EXPECT_EQ(runs[1].repetition_index, 1);
+  EXPECT_EQ(runs[0].counters.at("arg").value, 2);
+  EXPECT_EQ(runs[2].run_type, BenchmarkReporter::Run::RT_Aggregate);
+  EXPECT_EQ(runs[2].aggregate_name, "mean");
+}
+
+TEST(RunResultsTest, ReturnsNothingIfNothingMatches) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_Counted", BM_Counted)->Arg(1)->Iterations(10);
+  EXPECT_TRUE(RunSpecifiedBenchmarks("BM_Missing").empty());
+  EXPECT_EQ(RunSpecifiedBenchmarks("").size(), 1u);
+}
+
+void BM_Valued(State& state) {
+  for (auto _ : state) {
+  }
+  state.SetLabel(state.string_arg(0));
+  state.counters["scale"] = state.double_arg(1);
+}
+
+TEST(RunResultsTest, PassesTheValuesOfTheArgs) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_Valued", BM_Valued)
+      ->ArgStrings(0, {"uniform", "zipf"})
+      ->ArgDoubles(1, {0.25, 4})
+      ->Args({1, 0})
+      ->Iterations(10);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Valued");
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_EQ(runs[0].run_name.args, "zipf/0.25");
+  EXPECT_EQ(runs[0].report_label, "zipf");
+  EXPECT_EQ(runs[0].counters.at("scale").value, 0.25);
+}
+
+// Each timestamp is a millisecond after the one before it.
+class FakeAsyncTimer : public AsyncTimer {
+ public:
+  uint64_t Record() override {
+    ++outstanding;
+    max_outstanding = std::max(max_outstanding, outstanding);
+    return next_event++;
+  }
+  double ElapsedSeconds(uint64_t start, uint64_t stop) override {
+    return static_cast<double>(stop - start) * 1e-3;
+  }
+  void Release(uint64_t) override { --outstanding; }
+
+  uint64_t next_event = 0;
+  int outstanding = 0;
+  int max_outstanding = 0;
+};
+
+FakeAsyncTimer* async_timer = nullptr;
+
+void BM_Async(State& state) {
+  state.SetAsyncTimer(async_timer, 4);
+  for (auto _ : state) {
+    state.StartAsyncIteration();
+    state.StopAsyncIteration();
+  }
+}
+
+TEST(RunResultsTest, WaitsForTheTimesOfAllTheAsyncIterations) {
+  FakeAsyncTimer timer;
+  async_timer = &timer;
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_Async", BM_Async)->UseManualTime()->Iterations(10);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Async");
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_DOUBLE_EQ(runs[0].real_accumulated_time, 10e-3);
+  // At most 4 iterations in flight besides the one started, and nothing left
+  // once done.
+  EXPECT_EQ(timer.max_outstanding, 2 * 4 + 1);
+  EXPECT_EQ(timer.outstanding, 0);
+  async_timer = nullptr;
+}
+
+void BM_ProducerConsumer(State& state) {
+  for (auto _ : state) {
+  }
+  const bool producer = state.thread_role() == "producer";
+  state.counters[producer ? "produced" : "consumed"] =
+      static_cast<double>(state.role_thread_index() + 1);
+}
+
+TEST(RunResultsTest, ReportsEachRoleOfTheThreadGroups) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_ProducerConsumer", BM_ProducerConsumer)
+      ->ThreadGroups({{"producer", 3}, {"consumer", 1}})
+      ->Iterations(10);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_ProducerConsumer");
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_EQ(runs[0].benchmark_name(),
+            "BM_ProducerConsumer/iterations:10/threads:4");
+  EXPECT_EQ(runs[0].iterations, 40u);
+  ASSERT_EQ(runs[0].roles.size(), 2u);
+  const BenchmarkReporter::RoleRun& producers = runs[0].roles[0];
+  EXPECT_EQ(producers.name, "producer");
+  EXPECT_EQ(producers.threads, 3);
+  EXPECT_EQ(producers.iterations, 30u);
+  // The producers are numbered 0 to 2 within their role.
+  EXPECT_EQ(producers.counters.at("produced").value, 1 + 2 + 3);
+  EXPECT_EQ(producers.counters.count("consumed"), 0u);
+  const BenchmarkReporter::RoleRun& consumers = runs[0].roles[1];
+  EXPECT_EQ(consumers.name, "consumer");
+  EXPECT_EQ(consumers.threads, 1);
+  EXPECT_EQ(consumers.iterations, 10u);
+  EXPECT_EQ(consumers.counters.at("consumed").value, 1);
+  EXPECT_EQ(runs[0].counters.at("produced").value, 6);
+}
+
+void BM_Uneven(State& state) {
+  for (auto _ : state) {
+  }
+}
+
+TEST(RunResultsTest, BreaksTheRunDownByThread) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_Uneven", BM_Uneven)->Threads(3)->Iterations(10);
+  absl::SetFlag(&FLAGS_benchmark_thread_breakdown, true);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Uneven");
+  absl::SetFlag(&FLAGS_benchmark_thread_breakdown, false);
+  ASSERT_EQ(runs.size(), 1u);
+  const BenchmarkReporter::Run& run = runs[0];
+  EXPECT_EQ(run.thread_iterations,
+            std::vector<IterationCount>({10, 10, 10}));
+  EXPECT_EQ(run.thread_real_times.size(), 3u);
+  EXPECT_EQ(run.thread_cpu_times.size(), 3u);
+  // The slowest thread is at least as slow as the mean.
+  EXPECT_GE(run.counters.at("thread_imbalance").value, 1);
+  EXPECT_GE(run.counters.at("thread_cv").value, 0);
+
+  const std::vector<BenchmarkReporter::Run> plain =
+      RunSpecifiedBenchmarks("BM_Uneven");
+  ASSERT_EQ(plain.size(), 1u);
+  EXPECT_TRUE(plain[0].thread_iterations.empty());
+  EXPECT_EQ(plain[0].counters.count("thread_imbalance"), 0u);
+}
+
+void BM_Sleepy(State& state) {
+  for (auto _ : state) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+TEST(RunResultsTest, RunsTheNoisyRepetitionsAgain) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_Sleepy", BM_Sleepy)->Iterations(2)->Repetitions(2);
+  // Each sleep is a voluntary switch.
+  absl::SetFlag(&FLAGS_benchmark_noise_thresholds, "voluntary_switches=0");
+  absl::SetFlag(&FLAGS_benchmark_noise_max_reruns, 2);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Sleepy");
+  absl::SetFlag(&FLAGS_benchmark_noise_thresholds, "");
+  absl::SetFlag(&FLAGS_benchmark_noise_max_reruns, 3);
+  int repetitions = 0;
+  for (const BenchmarkReporter::Run& run : runs) {
+    if (run.run_type != BenchmarkReporter::Run::RT_Iteration) continue;
+    ++repetitions;
+    EXPECT_GE(run.counters.at("voluntary_switches").value, 2);
+    EXPECT_EQ(run.counters.at("noise_reruns").value, 2);
+  }
+  EXPECT_EQ(repetitions, 2);
+
+  const std::vector<BenchmarkReporter::Run> plain =
+      RunSpecifiedBenchmarks("BM_Sleepy");
+  ASSERT_FALSE(plain.empty());
+  EXPECT_EQ(plain[0].counters.count("voluntary_switches"), 0u);
+}
+
+TEST(RunResultsTest, NormalizesTheTimeToTheCalibration) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_Sleepy", BM_Sleepy)->Iterations(2);
+  absl::SetFlag(&FLAGS_benchmark_normalize_time, "dram");
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Sleepy");
+  absl::SetFlag(&FLAGS_benchmark_normalize_time, "");
+  ASSERT_EQ(runs.size(), 1u);
+  // How many loads from memory the sleep is worth depends on the load of the
+  // machine, both while calibrating and while sleeping.
+  ASSERT_EQ(runs[0].counters.count("normalized_time"), 1u);
+  EXPECT_GT(runs[0].counters.at("normalized_time").value, 0);
+}
+
+void BM_SharedBatches(State& state) {
+  while (state.KeepRunningBatch(7)) {
+  }
+}
+
+TEST(RunResultsTest, SharesTheIterationsOfAFixedWorkRun) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_Uneven", BM_Uneven)
+      ->Threads(4)
+      ->FixedWork()
+      ->Iterations(1000);
+  RegisterBenchmark("BM_SharedBatches", BM_SharedBatches)
+      ->Threads(4)
+      ->FixedWork()
+      ->Iterations(1000);
+  absl::SetFlag(&FLAGS_benchmark_thread_breakdown, true);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Uneven|BM_SharedBatches");
+  absl::SetFlag(&FLAGS_benchmark_thread_breakdown, false);
+  ASSERT_EQ(runs.size(), 2u);
+  EXPECT_EQ(runs[0].benchmark_name(),
+            "BM_Uneven/iterations:1000/threads:4/fixed_work");
+  // All the threads together run the iterations once.
+  EXPECT_EQ(runs[0].iterations, 1000u);
+  IterationCount total = 0;
+  for (IterationCount n : runs[0].thread_iterations) total += n;
+  EXPECT_EQ(total, 1000u);
+  // A batch is only cut short once the budget is spent, so the threads may
+  // run up to a batch each over it.
+  EXPECT_GE(runs[1].iterations, 1000u);
+  EXPECT_LT(runs[1].iterations, 1000u + 4 * 7);
+}
+
+TEST(RunResultsTest, SamplesTheSharedIterationsOfEachThread) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_Counted", BM_Counted)
+      ->Arg(1)
+      ->Threads(2)
+      ->FixedWork()
+      ->Iterations(1000)
+      ->Samples(4);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Counted");
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_EQ(runs[0].iterations, 1000u);
+  // Each sample is of a quarter of the share of a thread, whichever of them
+  // took it.
+  ASSERT_EQ(runs[0].sample_times.size(), 8u);
+  for (double sample_time : runs[0].sample_times) EXPECT_GE(sample_time, 0);
+}
+
+TEST(RunResultsTest, TimesTheLatenciesOfTheSharedIterations) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_Counted", BM_Counted)
+      ->Arg(1)
+      ->Threads(2)
+      ->FixedWork()
+      ->Iterations(1000)
+      ->RecordLatencyHistogram(1);
+  RegisterBenchmark("BM_Counted", BM_Counted)
+      ->Arg(2)
+      ->Threads(2)
+      ->FixedWork()
+      ->Iterations(100)
+      ->TargetRate(1e5);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Counted");
+  ASSERT_EQ(runs.size(), 2u);
+  EXPECT_EQ(runs[0].iterations, 1000u);
+  EXPECT_EQ(runs[0].latency_samples, 1000);
+  // On the schedule, every iteration is timed.
+  EXPECT_EQ(runs[1].iterations, 100u);
+  EXPECT_EQ(runs[1].latency_samples, 100);
+}
+
+class CountingFixture : public Fixture {
+ public:
+  explicit CountingFixture(SharedScope scope)
+      : Fixture(scope), set_ups(0), tear_downs(0), built(false) {}
+
+  int set_ups;
+  int tear_downs;
+
+ protected:
+  void SetUpShared(const State&) BENCHMARK_OVERRIDE {
+    ++set_ups;
+    built = true;
+  }
+  void TearDownShared() BENCHMARK_OVERRIDE {
+    ++tear_downs;
+    built = false;
+  }
+  void BenchmarkCase(State& st) BENCHMARK_OVERRIDE {
+    if (!built) st.SkipWithError("not set up");
+    for (auto _ : st) {
+    }
+  }
+
+ private:
+  bool built;
+};
+
+int SharedSetUps(Fixture::SharedScope scope) {
+  ClearRegisteredBenchmarks();
+  CountingFixture* fixture = new CountingFixture(scope);
+  internal::RegisterBenchmarkInternal(fixture)
+      ->Name("BM_Shared")
+      ->Arg(1)
+      ->Arg(2)
+      ->ThreadRange(1, 2)
+      ->Iterations(10)
+      ->Repetitions(3);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Shared");
+  for (const BenchmarkReporter::Run& run : runs) {
+    EXPECT_FALSE(run.error_occurred) << run.error_message;
+  }
+  // All torn down once the benchmarks have run.
+  EXPECT_EQ(fixture->tear_downs, fixture->set_ups);
+  return fixture->set_ups;
+}
+
+TEST(RunResultsTest, SharesTheFixtureStateWithinItsScope) {
+  EXPECT_EQ(SharedSetUps(Fixture::kPerFamily), 1);
+  EXPECT_EQ(SharedSetUps(Fixture::kPerArgs), 2);
+  // Of each of the 2 args and 2 thread counts.
+  EXPECT_EQ(SharedSetUps(Fixture::kPerRepetition), 2 * 2 * 3);
+}
+
+}  // namespace
+}  // namespace benchmark
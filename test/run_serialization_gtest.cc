@@ -0,0 +1,155 @@
+//===---------------------------------------------------------------------===//
+// run_serialization_test - Unit tests for src/run_serialization.cc
+//===---------------------------------------------------------------------===//
+
+#include <string>
+
+#include "../src/run_serialization.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+BenchmarkReporter::Run MakeRun() {
+  BenchmarkReporter::Run run;
+  run.run_name.function_name = "BM_Foo";
+  run.run_name.args = "8";
+  run.run_name.cache = "cold_cache";
+  run.run_name.in_flight = "in_flight:8";
+  run.run_name.threads = "threads:2";
+  run.family_index = 3;
+  run.per_family_instance_index = 1;
+  run.report_label = "label";
+  run.iterations = 12345;
+  run.threads = 2;
+  run.in_flight = 8;
+  run.repetition_index = 4;
+  run.repetitions = 5;
+  run.time_unit = kMicrosecond;
+  run.real_accumulated_time = 1.5;
+  run.cpu_accumulated_time = 2.5;
+  run.real_time_overhead = 0.5;
+  run.cpu_time_overhead = 0.75;
+  run.complexity = oNLogN;
+  run.complexity_n = 8;
+  run.counters["items"] = Counter(42, Counter::kIsRate, Counter::kIs1024);
+  run.counters["bytes"] = Counter(7);
+  run.has_memory_result = true;
+  run.allocs_per_iter = 0.25;
+  run.max_bytes_used = 1024;
+  run.tags = {"slow", "numa"};
+  run.warnings = {"empty_loop: an iteration took 0.30 ns"};
+  run.processes = 3;
+  run.thread_cpus = {0, 2};
+  run.thread_numa_nodes = {0, 0};
+  run.thread_iterations = {6000, 6345};
+  run.thread_real_times = {1.5, 1.25};
+  run.thread_cpu_times = {1.25, 1.25};
+  run.latency_samples = 100;
+  run.latency_percentiles.emplace_back(50, 1.0);
+  run.latency_buckets.emplace_back(2.0, 10);
+  run.relative_error = 0.01;
+  run.cold_cache = true;
+  run.cpu_frequency = 3.2e9;
+  BenchmarkReporter::RoleRun role;
+  role.name = "producer";
+  role.threads = 1;
+  role.iterations = 6000;
+  role.real_accumulated_time = 1.25;
+  role.cpu_accumulated_time = 1.0;
+  role.counters["items"] = Counter(21, Counter::kIsRate);
+  run.roles.push_back(role);
+  return run;
+}
+
+TEST(RunSerializationTest, RoundTrip) {
+  const BenchmarkReporter::Run run = MakeRun();
+  std::string data;
+  BinaryWriter writer(&data);
+  writer.WriteRun(run);
+  writer.Write(int64_t{99});
+
+  BenchmarkReporter::Run read;
+  int64_t trailer = 0;
+  BinaryReader reader(data.data(), data.size());
+  ASSERT_TRUE(reader.ReadRun(&read));
+  ASSERT_TRUE(reader.Read(&trailer));
+  EXPECT_TRUE(reader.AtEnd());
+  EXPECT_EQ(trailer, 99);
+
+  EXPECT_EQ(read.benchmark_name(), run.benchmark_name());
+  EXPECT_EQ(read.family_index, run.family_index);
+  EXPECT_EQ(read.per_family_instance_index, run.per_family_instance_index);
+  EXPECT_EQ(read.report_label, run.report_label);
+  EXPECT_EQ(read.iterations, run.iterations);
+  EXPECT_EQ(read.threads, run.threads);
+  EXPECT_EQ(read.in_flight, run.in_flight);
+  EXPECT_EQ(read.repetition_index, run.repetition_index);
+  EXPECT_EQ(read.repetitions, run.repetitions);
+  EXPECT_EQ(read.time_unit, run.time_unit);
+  EXPECT_EQ(read.real_accumulated_time, run.real_accumulated_time);
+  EXPECT_EQ(read.cpu_accumulated_time, run.cpu_accumulated_time);
+  EXPECT_EQ(read.real_time_overhead, run.real_time_overhead);
+  EXPECT_EQ(read.cpu_time_overhead, run.cpu_time_overhead);
+  EXPECT_EQ(read.complexity, run.complexity);
+  EXPECT_EQ(read.complexity_n, run.complexity_n);
+  ASSERT_EQ(read.counters.size(), 2u);
+  EXPECT_EQ(read.counters["items"].value, 42);
+  EXPECT_EQ(read.counters["items"].flags, Counter::kIsRate);
+  EXPECT_EQ(read.counters["items"].oneK, Counter::kIs1024);
+  EXPECT_EQ(read.counters["bytes"].value, 7);
+  EXPECT_TRUE(read.has_memory_result);
+  EXPECT_EQ(read.allocs_per_iter, run.allocs_per_iter);
+  EXPECT_EQ(read.max_bytes_used, run.max_bytes_used);
+  EXPECT_EQ(read.thread_cpus, run.thread_cpus);
+  EXPECT_EQ(read.thread_numa_nodes, run.thread_numa_nodes);
+  EXPECT_EQ(read.thread_iterations, run.thread_iterations);
+  EXPECT_EQ(read.thread_real_times, run.thread_real_times);
+  EXPECT_EQ(read.thread_cpu_times, run.thread_cpu_times);
+  EXPECT_EQ(read.latency_samples, run.latency_samples);
+  EXPECT_EQ(read.latency_percentiles, run.latency_percentiles);
+  EXPECT_EQ(read.latency_buckets, run.latency_buckets);
+  EXPECT_EQ(read.relative_error, run.relative_error);
+  EXPECT_TRUE(read.cold_cache);
+  EXPECT_EQ(read.cpu_frequency, run.cpu_frequency);
+  ASSERT_EQ(read.roles.size(), 1u);
+  EXPECT_EQ(read.roles[0].name, "producer");
+  EXPECT_EQ(read.roles[0].threads, 1);
+  EXPECT_EQ(read.roles[0].iterations, 6000);
+  EXPECT_EQ(read.roles[0].real_accumulated_time, 1.25);
+  EXPECT_EQ(read.roles[0].cpu_accumulated_time, 1.0);
+  EXPECT_EQ(read.roles[0].counters["items"].value, 21);
+  EXPECT_EQ(read.roles[0].counters["items"].flags, Counter::kIsRate);
+  EXPECT_EQ(read.tags, run.tags);
+  EXPECT_EQ(read.warnings, run.warnings);
+  EXPECT_EQ(read.processes, 3);
+}
+
+TEST(RunSerializationTest, TruncatedDataIsRejected) {
+  std::string data;
+  BinaryWriter writer(&data);
+  writer.WriteRun(MakeRun());
+
+  for (size_t size = 0; size < data.size(); ++size) {
+    BenchmarkReporter::Run read;
+    BinaryReader reader(data.data(), size);
+    EXPECT_FALSE(reader.ReadRun(&read)) << size;
+    EXPECT_TRUE(reader.AtEnd());
+  }
+}
+
+// The result cache and the checkpoint tell the files of another layout apart
+// by their version only. If this fails, the layout changed: bump
+// kCacheFileVersion in src/result_cache.cc and kCheckpointVersion in
+// src/checkpoint.cc, then update the size.
+TEST(RunSerializationTest, LayoutMatchesTheFileVersions) {
+  std::string data;
+  BinaryWriter writer(&data);
+  writer.WriteRun(BenchmarkReporter::Run());
+  EXPECT_EQ(data.size(), 542u);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
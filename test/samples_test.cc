@@ -0,0 +1,34 @@
+#include "benchmark/benchmark.h"
+#include "output_test.h"
+
+void BM_samples(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.iterations());
+  }
+}
+BENCHMARK(BM_samples)->Threads(2)->Iterations(1000)->Samples(4);
+
+ADD_CASES(TC_ConsoleOut,
+          {{"^BM_samples/iterations:1000/threads:2 %console_report$"}});
+ADD_CASES(TC_JSONOut,
+          {{"\"name\": \"BM_samples/iterations:1000/threads:2\",$"},
+           {"\"family_index\": 0,$", MR_Next},
+           {"\"per_family_instance_index\": 0,$", MR_Next},
+           {"\"run_name\": \"BM_samples/iterations:1000/threads:2\",$",
+            MR_Next},
+           {"\"run_type\": \"iteration\",$", MR_Next},
+           {"\"repetitions\": 1,$", MR_Next},
+           {"\"repetition_index\": 0,$", MR_Next},
+           {"\"threads\": 2,$", MR_Next},
+           {"\"iterations\": 2000,$", MR_Next},
+           {"\"real_time\": %float,$", MR_Next},
+           {"\"cpu_time\": %float,$", MR_Next},
+           {"\"time_unit\": \"ns\",$", MR_Next},
+           {"\"samples\": [[]%float, %float, %float, %float[]],$", MR_Next},
+           {"\"samples_median\": %float,$", MR_Next},
+           {"\"samples_mad\": %float$", MR_Next},
+           {"}", MR_Next}});
+ADD_CASES(TC_CSVOut,
+          {{"^\"BM_samples/iterations:1000/threads:2\",%csv_report$"}});
+
+int main(int argc, char* argv[]) { RunOutputTests(argc, argv); }
@@ -0,0 +1,158 @@
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/benchmark_api_internal.h"
+#include "../src/results_reader.h"
+#include "../src/shard.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace benchmark;
+using namespace benchmark::internal;
+
+void BM_Noop(State& state) {
+  for (auto _ : state) {
+  }
+}
+
+TEST(AssignShardsTest, BalancesTheCosts) {
+  // The largest costs go first, each to the least loaded shard.
+  EXPECT_EQ(AssignShards({1.0, 5.0, 3.0, 3.0, 2.0}, 2),
+            std::vector<int>({1, 0, 1, 1, 0}));
+  EXPECT_EQ(AssignShards({1.0, 1.0, 1.0}, 3), std::vector<int>({0, 1, 2}));
+  EXPECT_EQ(AssignShards({1.0, 1.0}, 1), std::vector<int>({0, 0}));
+  EXPECT_TRUE(AssignShards({}, 4).empty());
+}
+
+class SelectShardTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    RegisterBenchmark("BM_A", BM_Noop)->DenseRange(0, 3);
+    RegisterBenchmark("BM_Complexity", BM_Noop)
+        ->RangeMultiplier(2)
+        ->Range(8, 64)
+        ->Complexity(oN);
+    RegisterBenchmark("BM_B", BM_Noop)->Arg(1)->Arg(2);
+  }
+
+  void TearDown() override { ClearRegisteredBenchmarks(); }
+
+  static std::vector<BenchmarkInstance> Shard(
+      int index, int count, const std::map<std::string, double>& costs) {
+    std::vector<BenchmarkInstance> instances;
+    std::stringstream err;
+    EXPECT_TRUE(FindBenchmarksInternal(".", &instances, &err));
+    SelectShard(index, count, costs, &instances);
+    return instances;
+  }
+
+  static std::vector<std::string> Names(
+      const std::vector<BenchmarkInstance>& instances) {
+    std::vector<std::string> names;
+    for (const BenchmarkInstance& instance : instances) {
+      names.push_back(instance.name().str());
+    }
+    return names;
+  }
+};
+
+TEST_F(SelectShardTest, EachBenchmarkRunsInOneShard) {
+  std::map<std::string, int> runs;
+  for (int index = 0; index < 3; ++index) {
+    for (const std::string& name : Names(Shard(index, 3, {}))) ++runs[name];
+  }
+  EXPECT_EQ(runs.size(), 10u);
+  for (const auto& kv : runs) EXPECT_EQ(kv.second, 1) << kv.first;
+}
+
+TEST_F(SelectShardTest, KeepsComplexityFamiliesTogether) {
+  for (int index = 0; index < 4; ++index) {
+    int complexity_instances = 0;
+    for (const BenchmarkInstance& instance : Shard(index, 4, {})) {
+      if (instance.complexity() != oNone) {
+        ++complexity_instances;
+        // The family index is the one among all the benchmarks.
+        EXPECT_EQ(instance.family_index(), 1);
+      }
+    }
+    EXPECT_TRUE(complexity_instances == 0 || complexity_instances == 4);
+  }
+}
+
+TEST_F(SelectShardTest, BalancesTheCosts) {
+  // BM_A/0 costs more than all the others together, which cost the median
+  // of the known costs when unknown.
+  const std::map<std::string, double> costs = {
+      {"BM_A/0", 100.0}, {"BM_A/1", 1.0}, {"BM_A/2", 2.0}};
+  EXPECT_EQ(Names(Shard(0, 2, costs)), std::vector<std::string>({"BM_A/0"}));
+  EXPECT_EQ(Shard(1, 2, costs).size(), 9u);
+}
+
+TEST(ReadBenchmarkCostsTest, SumsTheRepetitions) {
+  const std::string path = ::testing::TempDir() + "shard_gtest_costs.json";
+  {
+    std::ofstream out(path.c_str());
+    out << "{\n"
+           "  \"context\": {\"caches\": [{\"size\": 32768}], \"x\": true},\n"
+           "  \"benchmarks\": [\n"
+           "    {\"name\": \"BM_A/1\", \"run_name\": \"BM_A/1\", "
+           "\"run_type\": \"iteration\", \"iterations\": 1000, "
+           "\"real_time\": 2.0e+00, \"time_unit\": \"ms\"},\n"
+           "    {\"name\": \"BM_A/1\", \"run_name\": \"BM_A/1\", "
+           "\"run_type\": \"iteration\", \"iterations\": 1000, "
+           "\"real_time\": 4, \"time_unit\": \"ms\", \"label\": \"a\\\"b\"},\n"
+           "    {\"name\": \"BM_A/1_mean\", \"run_name\": \"BM_A/1\", "
+           "\"run_type\": \"aggregate\", \"iterations\": 2, "
+           "\"real_time\": 3, \"time_unit\": \"ms\"},\n"
+           "    {\"name\": \"BM_B\", \"iterations\": 10, "
+           "\"real_time\": 100, \"time_unit\": \"ns\"}\n"
+           "  ]\n"
+           "}\n";
+  }
+  std::map<std::string, double> costs;
+  ASSERT_TRUE(ReadBenchmarkCosts(path, &costs));
+  EXPECT_EQ(costs.size(), 2u);
+  EXPECT_DOUBLE_EQ(costs["BM_A/1"], 6.0);
+  EXPECT_DOUBLE_EQ(costs["BM_B"], 1e-6);
+  std::remove(path.c_str());
+
+  EXPECT_FALSE(ReadBenchmarkCosts(path, &costs));
+}
+
+TEST(ReadBenchmarkCostsTest, ReadsTheBinaryOutput) {
+  const std::string path = ::testing::TempDir() + "shard_gtest_costs.bin";
+  {
+    std::ofstream out(path.c_str(), std::ios::out | std::ios::binary);
+    BinaryReporter reporter;
+    reporter.SetOutputStream(&out);
+    reporter.SetErrorStream(&out);
+    BenchmarkReporter::Run run;
+    run.run_name.function_name = "BM_A";
+    run.iterations = 100;
+    run.real_accumulated_time = 0.5;
+    run.counters["items"] = Counter(7);
+    BenchmarkReporter::Run failed = run;
+    failed.run_name.function_name = "BM_B";
+    failed.error_occurred = true;
+    reporter.ReportContext(BenchmarkReporter::Context());
+    reporter.ReportRuns({run, failed});
+    reporter.Finalize();
+  }
+  std::map<std::string, double> costs;
+  ASSERT_TRUE(ReadBenchmarkCosts(path, &costs));
+  EXPECT_DOUBLE_EQ(costs["BM_A"], 0.5);
+
+  std::map<std::string, IterationCount> iterations;
+  ASSERT_TRUE(ReadIterationCounts(path, &iterations));
+  EXPECT_EQ(iterations.size(), 1u);
+  EXPECT_EQ(iterations["BM_A"], 100);
+  std::remove(path.c_str());
+}
+
+}  // end namespace
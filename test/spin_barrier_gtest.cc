@@ -0,0 +1,58 @@
+//===---------------------------------------------------------------------===//
+// spin_barrier_test - Unit tests for src/spin_barrier.cc
+//===---------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../src/spin_barrier.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+TEST(SpinBarrierTest, SingleThreadIsAlwaysLast) {
+  SpinBarrier barrier(1);
+  EXPECT_TRUE(barrier.wait());
+  EXPECT_TRUE(barrier.wait());
+}
+
+TEST(SpinBarrierTest, NoThreadLeavesBeforeAllEntered) {
+  const int kThreads = 4;
+  const int kPhases = 1000;
+  SpinBarrier barrier(kThreads);
+  std::atomic<int> entered(0);
+  std::atomic<int> last_threads(0);
+  std::atomic<bool> failed(false);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&]() {
+      for (int phase = 1; phase <= kPhases; ++phase) {
+        ++entered;
+        if (barrier.wait()) ++last_threads;
+        if (entered.load() < phase * kThreads) failed = true;
+        // Keep anyone from entering the next phase before everyone checked.
+        barrier.wait();
+      }
+    });
+  }
+  for (std::thread& t : threads) t.join();
+  EXPECT_FALSE(failed.load());
+  EXPECT_EQ(last_threads.load(), kPhases);
+}
+
+TEST(SpinBarrierTest, RemovingThreadReleasesWaiters) {
+  SpinBarrier barrier(2);
+  std::thread waiter([&]() { barrier.wait(); });
+  // Let the waiter get into the barrier before the other thread drops out.
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  barrier.removeThread();
+  waiter.join();
+  // The remaining thread now passes the barrier on its own.
+  EXPECT_TRUE(barrier.wait());
+}
+
+}  // namespace
+}  // namespace benchmark
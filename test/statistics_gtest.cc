@@ -2,6 +2,9 @@
 // statistics_test - Unit tests for src/statistics.cc
 //===---------------------------------------------------------------------===//
 
+#include <cmath>
+#include <vector>
+
 #include "../src/statistics.h"
 #include "gtest/gtest.h"
 
@@ -32,4 +35,86 @@ TEST(StatisticsTest, CV) {
                    0.32888184094918121);
 }
 
+TEST(StatisticsTest, RelativeError) {
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsRelativeError({101, 101, 101}), 0.0);
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsRelativeError({1, 2, 3}),
+                   4.303 / std::sqrt(3.0) / 2.0);
+}
+
+TEST(StatisticsTest, MinMax) {
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsMin({3, 1, 2}), 1.0);
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsMax({3, 1, 2}), 3.0);
+}
+
+TEST(StatisticsTest, Percentile) {
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsPercentile({4, 1, 3, 2}, 0), 1.0);
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsPercentile({4, 1, 3, 2}, 50), 2.5);
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsPercentile({4, 1, 3, 2}, 100), 4.0);
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsP5({0, 10, 20, 30, 40}), 2.0);
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsP95({0, 10, 20, 30, 40}), 38.0);
+}
+
+TEST(StatisticsTest, MAD) {
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsMAD({42, 42, 42}), 0.0);
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsMAD({1, 1, 2, 2, 4, 6, 9}), 1.0);
+}
+
+TEST(StatisticsTest, TrimmedMean) {
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsTrimmedMean({1, 2, 3}), 2.0);
+  EXPECT_DOUBLE_EQ(
+      benchmark::StatisticsTrimmedMean({100, 1, 1, 1, 1, 1, 1, 1, 1, -100}),
+      1.0);
+}
+
+TEST(StatisticsTest, BootstrapInterval) {
+  const std::vector<double> v = {9, 10, 11, 10, 9, 10, 11, 10};
+  const double low = benchmark::StatisticsBootstrapLow(v);
+  const double high = benchmark::StatisticsBootstrapHigh(v);
+  EXPECT_LT(low, 10.0);
+  EXPECT_GT(high, 10.0);
+  EXPECT_GE(low, 9.0);
+  EXPECT_LE(high, 11.0);
+  // Reproducible from one call to the next.
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsBootstrapLow(v), low);
+  EXPECT_DOUBLE_EQ(benchmark::StatisticsBootstrapLow({5, 5}), 5.0);
+}
+
+TEST(StatisticsTest, FindOutliers) {
+  const std::vector<double> v = {10, 11, 10, 9, 10, 30, 11};
+  EXPECT_TRUE(FindOutliers(v, benchmark::kNoOutlierRejection).empty());
+  EXPECT_EQ(FindOutliers(v, benchmark::kIQROutlierRejection),
+            std::vector<size_t>{5});
+  EXPECT_EQ(FindOutliers(v, benchmark::kMADOutlierRejection),
+            std::vector<size_t>{5});
+  EXPECT_TRUE(
+      FindOutliers({10, 10, 10, 11}, benchmark::kMADOutlierRejection).empty());
+}
+
+TEST(StatisticsTest, ComputeStatsDropsOutliers) {
+  const std::vector<benchmark::internal::Statistics> statistics = {
+      {"mean", benchmark::StatisticsMean}};
+  std::vector<benchmark::BenchmarkReporter::Run> reports(5);
+  const double times[] = {10, 11, 10, 100, 9};
+  for (size_t i = 0; i < reports.size(); ++i) {
+    reports[i].iterations = 1;
+    reports[i].time_unit = benchmark::kSecond;
+    reports[i].real_accumulated_time = times[i];
+    reports[i].cpu_accumulated_time = times[i];
+    reports[i].statistics = &statistics;
+  }
+
+  auto aggregates = benchmark::ComputeStats(reports);
+  ASSERT_EQ(aggregates.size(), 1u);
+  EXPECT_EQ(aggregates[0].iterations, 5);
+  EXPECT_EQ(aggregates[0].outliers_dropped, 0);
+  EXPECT_DOUBLE_EQ(aggregates[0].GetAdjustedCPUTime(), 28.0);
+
+  aggregates =
+      benchmark::ComputeStats(reports, benchmark::kIQROutlierRejection);
+  ASSERT_EQ(aggregates.size(), 1u);
+  EXPECT_EQ(aggregates[0].iterations, 4);
+  EXPECT_EQ(aggregates[0].outliers_dropped, 1);
+  EXPECT_DOUBLE_EQ(aggregates[0].GetAdjustedCPUTime(), 10.0);
+}
+
 }  // end namespace
@@ -0,0 +1,142 @@
+//===---------------------------------------------------------------------===//
+// sysinfo_test - Unit tests for the system information cache of
+// src/sysinfo.cc
+//===---------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "../src/sysinfo.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+CPUInfo::LogicalCpu MakeCpu(int cpu, int package, int core, int smt_index,
+                            int numa_node, int llc) {
+  CPUInfo::LogicalCpu result;
+  result.cpu = cpu;
+  result.package = package;
+  result.core = core;
+  result.smt_index = smt_index;
+  result.numa_node = numa_node;
+  result.llc = llc;
+  return result;
+}
+
+CachedCPUInfo MakeInfo() {
+  CachedCPUInfo info;
+  info.cycles_per_second = 2.5e9;
+  CPUInfo::CacheInfo cache;
+  cache.type = "Data";
+  cache.level = 1;
+  cache.size = 32768;
+  cache.num_sharing = 2;
+  info.caches.push_back(cache);
+  info.features.push_back("avx2");
+  info.features.push_back("fma");
+  info.topology.push_back(MakeCpu(0, 0, 0, 0, 0, 0));
+  info.topology.push_back(MakeCpu(1, 0, 0, 1, 0, 0));
+  return info;
+}
+
+TEST(SysInfoTest, TheLazyPartsAgreeWithCPUInfo) {
+  const CPUInfo& info = CPUInfo::Get();
+  EXPECT_EQ(NumCPUs(), info.num_cpus);
+  EXPECT_EQ(CPUCaches().size(), info.caches.size());
+  EXPECT_TRUE(CPUSupports("scalar"));
+  for (const std::string& feature : info.features) {
+    EXPECT_TRUE(CPUSupports(feature)) << feature;
+  }
+}
+
+TEST(SysInfoTest, TheTopologyCoversTheCpus) {
+  const CPUInfo& info = CPUInfo::Get();
+  const std::vector<CPUInfo::LogicalCpu>& topology = info.topology;
+  for (size_t i = 1; i < topology.size(); ++i) {
+    EXPECT_LT(topology[i - 1].cpu, topology[i].cpu);
+  }
+  for (const CPUInfo::LogicalCpu& cpu : topology) {
+    EXPECT_GE(cpu.smt_index, -1);
+    EXPECT_GE(cpu.llc, -1);
+    EXPECT_LE(cpu.llc, cpu.cpu);
+  }
+  if (!topology.empty()) {
+    EXPECT_LE(info.num_cores, static_cast<int>(topology.size()));
+    EXPECT_LE(info.num_packages, info.num_cores);
+  }
+}
+
+TEST(SysInfoTest, CountsThePackagesCoresAndNodes) {
+  std::vector<CPUInfo::LogicalCpu> topology;
+  // 2 packages of 2 cores of 2 threads, a node per package.
+  for (int cpu = 0; cpu < 8; ++cpu) {
+    topology.push_back(MakeCpu(cpu, cpu / 4, cpu / 2 % 2, cpu % 2, cpu / 4,
+                               cpu / 4 * 4));
+  }
+  int packages, cores, nodes;
+  CountTopology(topology, &packages, &cores, &nodes);
+  EXPECT_EQ(packages, 2);
+  EXPECT_EQ(cores, 4);
+  EXPECT_EQ(nodes, 2);
+
+  // Nothing known of the cpus.
+  for (CPUInfo::LogicalCpu& cpu : topology) {
+    cpu.package = cpu.core = cpu.numa_node = -1;
+  }
+  CountTopology(topology, &packages, &cores, &nodes);
+  EXPECT_EQ(packages, 0);
+  EXPECT_EQ(cores, 0);
+  EXPECT_EQ(nodes, 0);
+}
+
+TEST(SysInfoTest, FilesAreNamedAfterTheHost) {
+  EXPECT_EQ(CPUInfoCachePath("dir", "build-01.example.com"),
+            "dir/sysinfo_build-01.example.com.txt");
+  EXPECT_EQ(CPUInfoCachePath("dir", "a b/c"), "dir/sysinfo_a_b_c.txt");
+}
+
+TEST(SysInfoTest, ReadsBackWhatItCached) {
+  const std::string path = ::testing::TempDir() + "sysinfo_test.txt";
+  const std::string key = CPUInfoCacheKey(CPUInfo::Scaling::DISABLED);
+  WriteCPUInfoCache(path, key, MakeInfo());
+
+  CachedCPUInfo info;
+  ASSERT_TRUE(ReadCPUInfoCache(path, key, &info));
+  EXPECT_EQ(info.cycles_per_second, 2.5e9);
+  ASSERT_EQ(info.caches.size(), 1u);
+  EXPECT_EQ(info.caches[0].type, "Data");
+  EXPECT_EQ(info.caches[0].level, 1);
+  EXPECT_EQ(info.caches[0].size, 32768);
+  EXPECT_EQ(info.caches[0].num_sharing, 2);
+  ASSERT_EQ(info.features.size(), 2u);
+  EXPECT_EQ(info.features[1], "fma");
+  ASSERT_EQ(info.topology.size(), 2u);
+  EXPECT_EQ(info.topology[1].cpu, 1);
+  EXPECT_EQ(info.topology[1].core, 0);
+  EXPECT_EQ(info.topology[1].smt_index, 1);
+
+  // Another scaling, or another host or boot, is another key.
+  EXPECT_FALSE(ReadCPUInfoCache(
+      path, CPUInfoCacheKey(CPUInfo::Scaling::ENABLED), &info));
+  std::remove(path.c_str());
+  EXPECT_FALSE(ReadCPUInfoCache(path, key, &info));
+}
+
+TEST(SysInfoTest, IgnoresAMalformedCache) {
+  const std::string path = ::testing::TempDir() + "sysinfo_test_bad.txt";
+  const std::string key = CPUInfoCacheKey(CPUInfo::Scaling::UNKNOWN);
+  {
+    std::ofstream file(path.c_str());
+    file << "benchmark sysinfo cache 2\nkey " << key << "\ncache Data 1\n";
+  }
+  CachedCPUInfo info;
+  EXPECT_FALSE(ReadCPUInfoCache(path, key, &info));
+  std::remove(path.c_str());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,112 @@
+//===---------------------------------------------------------------------===//
+// table_reporter_test - Unit tests for src/table_reporter.cc
+//===---------------------------------------------------------------------===//
+
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/run_columns.h"
+#include "../src/string_util.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+typedef BenchmarkReporter::Run TableRun;
+
+std::vector<std::string> Lines(const std::string& output) {
+  std::vector<std::string> lines;
+  std::istringstream in(output);
+  for (std::string line; std::getline(in, line);) lines.push_back(line);
+  return lines;
+}
+
+std::string Write(const std::vector<TableRun>& runs) {
+  std::ostringstream out;
+  TableReporter reporter;
+  reporter.SetOutputStream(&out);
+  reporter.SetErrorStream(&out);
+  reporter.ReportContext(BenchmarkReporter::Context());
+  for (const TableRun& run : runs) reporter.ReportRuns({run});
+  reporter.Finalize();
+  return out.str();
+}
+
+TEST(TableReporterTest, HasTheCountersOfAllTheRuns) {
+  TableRun first;
+  first.run_name.function_name = "BM_A";
+  first.iterations = 10;
+  first.counters["b"] = Counter(2);
+  TableRun second;
+  second.run_name.function_name = "BM_B";
+  second.iterations = 20;
+  second.counters["a"] = Counter(1.5);
+  second.counters["c"] = Counter(3);
+
+  const std::vector<std::string> lines = Lines(Write({first, second}));
+  ASSERT_EQ(lines.size(), 3u);
+  // The counters are after the fixed columns, in the order of their names.
+  EXPECT_EQ(lines[0].substr(0, 5), "name,");
+  EXPECT_EQ(lines[0].substr(lines[0].size() - 27),
+            ",label,a,b,c,other_counters");
+  EXPECT_EQ(StrSplit(lines[0], ',').size(),
+            static_cast<size_t>(internal::kNumRunColumns) + 4);
+  EXPECT_EQ(lines[1].substr(0, 5), "BM_A,");
+  EXPECT_EQ(lines[1].substr(lines[1].size() - 5), ",,2,,");
+  EXPECT_EQ(lines[2].substr(0, 5), "BM_B,");
+  EXPECT_EQ(lines[2].substr(lines[2].size() - 8), ",1.5,,3,");
+}
+
+TEST(TableReporterTest, QuotesTheFieldsThatNeedIt) {
+  TableRun run;
+  run.run_name.function_name = "BM_A";
+  run.report_label = "say \"hi\", twice";
+  run.relative_error = std::numeric_limits<double>::quiet_NaN();
+  const std::vector<std::string> lines = Lines(Write({run}));
+  ASSERT_EQ(lines.size(), 2u);
+  EXPECT_EQ(lines[1].substr(lines[1].size() - 21),
+            ",\"say \"\"hi\"\", twice\",");
+  // Without counters, every line has the fixed columns only, and the other
+  // counters.
+  EXPECT_EQ(lines[0].substr(lines[0].size() - 21), ",label,other_counters");
+}
+
+TEST(TableReporterTest, WritesNothingButTheHeaderWithoutRuns) {
+  const std::vector<std::string> lines = Lines(Write({}));
+  ASSERT_EQ(lines.size(), 1u);
+  EXPECT_EQ(StrSplit(lines[0], ',').size(),
+            static_cast<size_t>(internal::kNumRunColumns) + 1);
+}
+
+TEST(TableReporterTest, WritesTheRunsAsTheyComeOnceTooManyAreHeld) {
+  std::ostringstream out;
+  TableReporter reporter;
+  reporter.SetOutputStream(&out);
+  reporter.SetErrorStream(&out);
+  reporter.ReportContext(BenchmarkReporter::Context());
+  TableRun run;
+  run.run_name.function_name = "BM_A";
+  run.report_label = std::string(64 << 10, 'x');
+  run.counters["b"] = Counter(1);
+  // 16 MiB of them.
+  for (int i = 0; i < 256; ++i) reporter.ReportRuns({run});
+  EXPECT_EQ(Lines(out.str()).size(), 257u);
+
+  // What has no column of its own is in the last one.
+  run.report_label = "";
+  run.counters["a"] = Counter(2);
+  run.counters["c"] = Counter(0.5);
+  reporter.ReportRuns({run});
+  const std::vector<std::string> lines = Lines(out.str());
+  ASSERT_EQ(lines.size(), 258u);
+  EXPECT_EQ(lines[0].substr(lines[0].size() - 23), ",label,b,other_counters");
+  EXPECT_EQ(lines[257].substr(lines[257].size() - 13), ",,1,a=2;c=0.5");
+  reporter.Finalize();
+  EXPECT_EQ(Lines(out.str()).size(), 258u);
+}
+
+}  // end namespace
+}  // end namespace benchmark
@@ -0,0 +1,46 @@
+#include "benchmark/benchmark.h"
+#include "output_test.h"
+
+void BM_open_loop(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.iterations());
+  }
+}
+BENCHMARK(BM_open_loop)->TargetRate(20000);
+BENCHMARK(BM_open_loop)->TargetRate(20000, benchmark::kPoissonArrivals);
+
+ADD_CASES(TC_ConsoleOut,
+          {{"^BM_open_loop/real_time %console_report achieved_rate=%hrfloat/s "
+            "p50=%floatns p90=%floatns p99=%floatns p99.9=%floatns$"}});
+ADD_CASES(TC_JSONOut,
+          {{"\"name\": \"BM_open_loop/real_time\",$"},
+           {"\"family_index\": 0,$", MR_Next},
+           {"\"per_family_instance_index\": 0,$", MR_Next},
+           {"\"run_name\": \"BM_open_loop/real_time\",$", MR_Next},
+           {"\"run_type\": \"iteration\",$", MR_Next},
+           {"\"repetitions\": 1,$", MR_Next},
+           {"\"repetition_index\": 0,$", MR_Next},
+           {"\"threads\": 1,$", MR_Next},
+           {"\"iterations\": %int,$", MR_Next},
+           {"\"real_time\": %float,$", MR_Next},
+           {"\"cpu_time\": %float,$", MR_Next},
+           {"\"time_unit\": \"ns\",$", MR_Next},
+           {"\"achieved_rate\": %float,$", MR_Next},
+           {"\"latency_samples\": %int,$", MR_Next},
+           {"\"latency_percentiles\": [{]\"p50\": %float, "
+            "\"p90\": %float, \"p99\": %float, "
+            "\"p99.9\": %float[}],$",
+            MR_Next},
+           {"\"latency_histogram\": [[][[]%float, %int[]].*[]]$", MR_Next},
+           {"}", MR_Next}});
+ADD_CASES(TC_CSVOut, {{"^\"BM_open_loop/real_time\",%csv_report,%float$"}});
+
+// The iterations are due every 50us on average, but how close to that the
+// benchmark keeps up depends on the load of the machine, so only the rate is
+// checked to be measured.
+void CheckRate(Results const& e) {
+  CHECK_COUNTER_VALUE(e, double, "achieved_rate", GT, 0);
+}
+CHECK_BENCHMARK_RESULTS("BM_open_loop/real_time", &CheckRate);
+
+int main(int argc, char* argv[]) { RunOutputTests(argc, argv); }
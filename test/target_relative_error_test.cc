@@ -0,0 +1,28 @@
+#include "benchmark/benchmark.h"
+#include "output_test.h"
+
+void BM_precise(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.iterations());
+  }
+}
+BENCHMARK(BM_precise)->TargetRelativeError(0.5);
+
+ADD_CASES(TC_ConsoleOut, {{"^BM_precise %console_report [+]/-%float%$"}});
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_precise\",$"},
+                       {"\"family_index\": 0,$", MR_Next},
+                       {"\"per_family_instance_index\": 0,$", MR_Next},
+                       {"\"run_name\": \"BM_precise\",$", MR_Next},
+                       {"\"run_type\": \"iteration\",$", MR_Next},
+                       {"\"repetitions\": 1,$", MR_Next},
+                       {"\"repetition_index\": 0,$", MR_Next},
+                       {"\"threads\": 1,$", MR_Next},
+                       {"\"iterations\": %int,$", MR_Next},
+                       {"\"real_time\": %float,$", MR_Next},
+                       {"\"cpu_time\": %float,$", MR_Next},
+                       {"\"time_unit\": \"ns\",$", MR_Next},
+                       {"\"relative_error\": %float$", MR_Next},
+                       {"}", MR_Next}});
+ADD_CASES(TC_CSVOut, {{"^\"BM_precise\",%csv_report$"}});
+
+int main(int argc, char* argv[]) { RunOutputTests(argc, argv); }
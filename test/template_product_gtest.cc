@@ -0,0 +1,81 @@
+//===---------------------------------------------------------------------===//
+// template_product_test - Tests for BENCHMARK_TEMPLATE_PRODUCT
+//===---------------------------------------------------------------------===//
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/benchmark_api_internal.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+template <typename T, typename N>
+void BM_Unrolled(State& state) {
+  for (auto _ : state) {
+  }
+  state.counters["size"] = sizeof(T);
+  state.counters["n"] = N::value;
+}
+
+BENCHMARK_TEMPLATE_PRODUCT(BM_Unrolled, TypeList<char, double>,
+                           ValueList<int, 2, 8>)
+    ->Iterations(1);
+
+TEST(TemplateProductTest, RegistersEveryCombination) {
+  std::vector<internal::BenchmarkInstance> instances;
+  std::stringstream err;
+  ASSERT_TRUE(internal::FindBenchmarksInternal("BM_Unrolled", &instances,
+                                               &err));
+  std::vector<std::string> names;
+  for (const internal::BenchmarkInstance& instance : instances) {
+    names.push_back(instance.name().str());
+  }
+  EXPECT_EQ(names, std::vector<std::string>(
+                       {"BM_Unrolled<char,2>/iterations:1",
+                        "BM_Unrolled<char,8>/iterations:1",
+                        "BM_Unrolled<double,2>/iterations:1",
+                        "BM_Unrolled<double,8>/iterations:1"}));
+  ASSERT_EQ(instances.size(), 4u);
+  EXPECT_NE(instances[0].family_index(), instances[1].family_index());
+}
+
+TEST(TemplateProductTest, RunsTheInstantiationOfTheName) {
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Unrolled<double,8>");
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_EQ(runs[0].counters.at("size").value, sizeof(double));
+  EXPECT_EQ(runs[0].counters.at("n").value, 8);
+}
+
+TEST(TemplateProductTest, NamesTypesAndValues) {
+  EXPECT_EQ(internal::TemplateArgName<float>::Get(), "float");
+  EXPECT_EQ((internal::TemplateArgName<std::integral_constant<int, -3>>::Get()),
+            "-3");
+  EXPECT_EQ(
+      (internal::TemplateArgName<std::integral_constant<bool, true>>::Get()),
+      "true");
+}
+
+TEST(TemplateProductTest, ParsesTheSignaturesOfTheCompilers) {
+  EXPECT_EQ(internal::TypeNameFromSignature(
+                "static std::string benchmark::internal::TemplateArgName<T>::"
+                "Get() [with T = std::pair<int, float>; std::string = "
+                "std::__cxx11::basic_string<char>]"),
+            "std::pair<int, float>");
+  EXPECT_EQ(internal::TypeNameFromSignature(
+                "static std::string benchmark::internal::TemplateArgName<int "
+                "*>::Get() [T = int *]"),
+            "int *");
+  EXPECT_EQ(internal::TypeNameFromSignature(
+                "class std::basic_string<char> __cdecl "
+                "benchmark::internal::TemplateArgName<struct Foo<int> >::Get("
+                "void)"),
+            "Foo<int>");
+}
+
+}  // namespace
+}  // namespace benchmark
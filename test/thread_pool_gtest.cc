@@ -0,0 +1,70 @@
+//===---------------------------------------------------------------------===//
+// thread_pool_test - Unit tests for src/thread_pool.cc
+//===---------------------------------------------------------------------===//
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "../src/thread_pool.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+TEST(ThreadPoolTest, RunsEveryThreadIndexOnce) {
+  ThreadPool& pool = ThreadPool::Get();
+  std::vector<std::atomic<int>> runs(8);
+  for (auto& r : runs) r = 0;
+  pool.Dispatch(8, [&runs](int thread_index) { ++runs[thread_index]; });
+  pool.WaitForIdle();
+  EXPECT_EQ(runs[0], 0);  // Index 0 is run by the caller, not the pool.
+  for (size_t i = 1; i < runs.size(); ++i) EXPECT_EQ(runs[i], 1);
+}
+
+TEST(ThreadPoolTest, ReusesWorkers) {
+  ThreadPool& pool = ThreadPool::Get();
+  std::mutex mu;
+  std::set<std::thread::id> ids;
+  auto record = [&](int) {
+    std::lock_guard<std::mutex> l(mu);
+    ids.insert(std::this_thread::get_id());
+  };
+  pool.Dispatch(4, record);
+  pool.WaitForIdle();
+  const size_t num_workers = pool.NumWorkers();
+  EXPECT_EQ(ids.size(), 3u);
+
+  for (int i = 0; i < 10; ++i) {
+    pool.Dispatch(4, record);
+    pool.WaitForIdle();
+  }
+  EXPECT_EQ(ids.size(), 3u);
+  EXPECT_EQ(pool.NumWorkers(), num_workers);
+}
+
+TEST(ThreadPoolTest, OwnPoolJoinsWorkersWhenDestroyed) {
+  std::atomic<int> runs(0);
+  {
+    ThreadPool pool;
+    pool.Dispatch(4, [&runs](int) { ++runs; });
+    pool.WaitForIdle();
+    pool.Dispatch(3, [&runs](int) { ++runs; });
+  }
+  EXPECT_EQ(runs, 5);
+}
+
+TEST(ThreadPoolTest, SingleThreadDispatchRunsNothing) {
+  ThreadPool& pool = ThreadPool::Get();
+  std::atomic<int> runs(0);
+  pool.Dispatch(1, [&runs](int) { ++runs; });
+  pool.WaitForIdle();
+  EXPECT_EQ(runs, 0);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,117 @@
+//===---------------------------------------------------------------------===//
+// thread_scaling_test - Unit tests for src/thread_scaling.cc
+//===---------------------------------------------------------------------===//
+
+#include <cmath>
+#include <vector>
+
+#include "../src/thread_scaling.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace {
+
+std::vector<double> Usl(const std::vector<double>& threads, double lambda,
+                        double sigma, double kappa) {
+  std::vector<double> throughputs;
+  for (double n : threads) {
+    throughputs.push_back(lambda * n /
+                          (1 + sigma * (n - 1) + kappa * n * (n - 1)));
+  }
+  return throughputs;
+}
+
+TEST(ThreadScalingTest, RecoversTheUniversalScalabilityLaw) {
+  const std::vector<double> threads = {1, 2, 4, 8, 16, 32};
+  const ScalabilityFit fit =
+      FitScalability(threads, Usl(threads, 1e6, 0.05, 0.001));
+  EXPECT_NEAR(fit.lambda, 1e6, 1);
+  EXPECT_NEAR(fit.sigma, 0.05, 1e-9);
+  EXPECT_NEAR(fit.kappa, 0.001, 1e-9);
+  EXPECT_NEAR(fit.rms, 0, 1e-9);
+}
+
+TEST(ThreadScalingTest, FitsAmdahlToTwoThreadCounts) {
+  const std::vector<double> threads = {1, 4};
+  const ScalabilityFit fit = FitScalability(threads, Usl(threads, 100, 0.2, 0));
+  EXPECT_NEAR(fit.lambda, 100, 1e-9);
+  EXPECT_NEAR(fit.sigma, 0.2, 1e-9);
+  EXPECT_EQ(fit.kappa, 0);
+}
+
+TEST(ThreadScalingTest, NeverFitsNegativeCoefficients) {
+  // Better than linear, e.g. as the working set of each thread fits in cache.
+  const std::vector<double> threads = {1, 2, 4};
+  const ScalabilityFit fit = FitScalability(threads, {100, 210, 440});
+  EXPECT_GT(fit.lambda, 0);
+  EXPECT_EQ(fit.sigma, 0);
+  EXPECT_EQ(fit.kappa, 0);
+  EXPECT_GT(fit.rms, 0);
+}
+
+BenchmarkReporter::Run MakeRun(int threads, double seconds) {
+  BenchmarkReporter::Run run;
+  run.run_name.function_name = "BM_scaling";
+  run.run_name.threads = "threads:" + std::to_string(threads);
+  run.threads = threads;
+  run.iterations = 1000;
+  run.real_accumulated_time = seconds;
+  run.cpu_accumulated_time = seconds * threads;
+  return run;
+}
+
+TEST(ThreadScalingTest, ReportsEfficiencyPerThreadCount) {
+  // Perfect scaling up to 2 threads, half of it at 4.
+  const std::vector<BenchmarkReporter::Run> reports = {
+      MakeRun(1, 1.0), MakeRun(2, 0.5), MakeRun(4, 0.5)};
+  const std::vector<BenchmarkReporter::Run> results =
+      ComputeThreadScaling(reports);
+  ASSERT_EQ(results.size(), 4u);
+  EXPECT_EQ(results[0].benchmark_name(), "BM_scaling/threads:1_efficiency");
+  EXPECT_DOUBLE_EQ(results[1].real_accumulated_time, 1.0);
+  EXPECT_DOUBLE_EQ(results[1].counters.at("speedup"), 2.0);
+  EXPECT_DOUBLE_EQ(results[2].real_accumulated_time, 0.5);
+  EXPECT_DOUBLE_EQ(results[2].counters.at("speedup"), 2.0);
+  EXPECT_EQ(results[3].benchmark_name(), "BM_scaling_USL");
+  EXPECT_EQ(results[3].threads, 4);
+}
+
+BenchmarkReporter::Run MakeInFlightRun(int threads, int in_flight,
+                                       double seconds) {
+  BenchmarkReporter::Run run = MakeRun(threads, seconds);
+  run.run_name.in_flight = "in_flight:" + std::to_string(in_flight);
+  run.in_flight = in_flight;
+  return run;
+}
+
+TEST(ThreadScalingTest, ScalesByTheOperationsInFlightToo) {
+  // Each depth runs at one and two threads; doubling either doubles the
+  // throughput.
+  const std::vector<BenchmarkReporter::Run> reports = {
+      MakeInFlightRun(1, 1, 1.0), MakeInFlightRun(2, 1, 0.5),
+      MakeInFlightRun(1, 4, 0.25), MakeInFlightRun(2, 4, 0.125)};
+  const std::vector<BenchmarkReporter::Run> results =
+      ComputeThreadScaling(reports);
+  // Per depth, two thread counts and the USL; per thread count, two depths
+  // and the USL.
+  ASSERT_EQ(results.size(), 12u);
+  EXPECT_EQ(results[0].benchmark_name(),
+            "BM_scaling/in_flight:1/threads:1_efficiency");
+  EXPECT_EQ(results[6].benchmark_name(),
+            "BM_scaling/in_flight:1/threads:1_in_flight_efficiency");
+  EXPECT_EQ(results[7].in_flight, 4);
+  EXPECT_EQ(results[7].threads, 1);
+  EXPECT_DOUBLE_EQ(results[7].counters.at("speedup"), 4.0);
+  EXPECT_DOUBLE_EQ(results[7].real_accumulated_time, 1.0);
+  EXPECT_EQ(results[8].benchmark_name(), "BM_scaling/threads:1_in_flight_USL");
+  EXPECT_EQ(results[8].in_flight, 4);
+}
+
+TEST(ThreadScalingTest, NeedsTwoThreadCounts) {
+  const std::vector<BenchmarkReporter::Run> reports = {MakeRun(2, 1.0),
+                                                       MakeRun(2, 1.0)};
+  EXPECT_TRUE(ComputeThreadScaling(reports).empty());
+}
+
+}  // namespace
+}  // namespace benchmark
@@ -0,0 +1,48 @@
+//===---------------------------------------------------------------------===//
+// thread_timer_test - Unit tests for src/thread_timer.h
+//===---------------------------------------------------------------------===//
+
+#include "../src/thread_timer.h"
+#include "gtest/gtest.h"
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+TEST(ThreadTimerTest, UnpausedTimerHasNoOverhead) {
+  ThreadTimer timer = ThreadTimer::Create();
+  timer.StartTimer();
+  for (int i = 0; i < 1000; ++i) ClobberMemory();
+  timer.StopTimer();
+  EXPECT_EQ(timer.real_time_overhead(), 0);
+  EXPECT_EQ(timer.cpu_time_overhead(), 0);
+  EXPECT_GT(timer.real_time_used(), 0);
+}
+
+TEST(ThreadTimerTest, PauseOverheadIsSubtracted) {
+  ThreadTimer timer = ThreadTimer::Create();
+  timer.StartTimer();
+  for (int i = 0; i < 1000; ++i) {
+    timer.StopTimer();
+    timer.StartTimer();
+  }
+  timer.StopTimer();
+  EXPECT_GT(timer.real_time_overhead(), 0);
+  EXPECT_GE(timer.real_time_used(), 0);
+  EXPECT_GE(timer.cpu_time_used(), 0);
+}
+
+TEST(ThreadTimerTest, CycleClockCountsCycles) {
+  ThreadTimer timer = ThreadTimer::CreateCycleClock(/*subtract_overhead=*/true);
+  timer.StartTimer();
+  for (int i = 0; i < 1000; ++i) ClobberMemory();
+  timer.StopTimer();
+  EXPECT_GT(timer.cycles_used(), 0);
+  EXPECT_DOUBLE_EQ(timer.real_time_used(), timer.cpu_time_used());
+  EXPECT_DOUBLE_EQ(timer.cycles_used(),
+                   timer.real_time_used() * CycleClockTicksPerSecond());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
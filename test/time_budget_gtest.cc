@@ -0,0 +1,104 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "recording_reporter.h"
+
+ABSL_DECLARE_FLAG(std::string, benchmark_filter);
+ABSL_DECLARE_FLAG(double, benchmark_time_budget);
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+void BM_Quick(State& state) {
+  for (auto _ : state) {
+  }
+}
+BENCHMARK(BM_Quick)->Name("BM_Low")->Iterations(10)->Repetitions(3);
+BENCHMARK(BM_Quick)
+    ->Name("BM_High")
+    ->Iterations(10)
+    ->Repetitions(3)
+    ->Priority(5);
+
+void BM_Slow(State& state) {
+  for (auto _ : state) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+}
+BENCHMARK(BM_Slow)->Name("BM_SlowLow")->Iterations(1)->Repetitions(3);
+BENCHMARK(BM_Slow)
+    ->Name("BM_SlowHigh")
+    ->Iterations(1)
+    ->Repetitions(3)
+    ->Priority(1);
+
+class TimeBudgetTest : public testing::Test {
+ protected:
+  void TearDown() override {
+    absl::SetFlag(&FLAGS_benchmark_time_budget, 0.0);
+  }
+
+  void Execute(const std::string& filter, double budget) {
+    absl::SetFlag(&FLAGS_benchmark_filter, filter);
+    absl::SetFlag(&FLAGS_benchmark_time_budget, budget);
+    RecordingReporter reporter;
+    RunSpecifiedBenchmarks(&reporter);
+    for (const BenchmarkReporter::Run& run : reporter.runs) {
+      if (run.run_type == BenchmarkReporter::Run::RT_Aggregate) {
+        events.push_back("Run " + run.run_name.function_name + "_" +
+                         run.aggregate_name);
+        continue;
+      }
+      events.push_back("Repetition " + run.run_name.function_name);
+      if (run.error_occurred) errors.push_back(run.error_message);
+    }
+  }
+
+  // The repetitions and the aggregates, in the order they were reported.
+  std::vector<std::string> events;
+  std::vector<std::string> errors;
+};
+
+TEST_F(TimeBudgetTest, RunsInRoundsByPriority) {
+  Execute("BM_(Low|High)/", 1000);
+  const std::vector<std::string> expected = {
+      "Repetition BM_High", "Repetition BM_Low",  "Repetition BM_High",
+      "Repetition BM_Low",  "Repetition BM_High", "Run BM_High_mean",
+      "Run BM_High_median", "Run BM_High_stddev", "Run BM_High_cv",
+      "Repetition BM_Low",  "Run BM_Low_mean",    "Run BM_Low_median",
+      "Run BM_Low_stddev",  "Run BM_Low_cv"};
+  EXPECT_EQ(events, expected);
+  EXPECT_TRUE(errors.empty());
+}
+
+TEST_F(TimeBudgetTest, ReportsWhatWasRunOnceTheBudgetRunsOut) {
+  // Time for a second repetition of the first, but not of the second.
+  Execute("BM_Slow", 0.35);
+  const std::vector<std::string> expected = {
+      "Repetition BM_SlowHigh",  "Repetition BM_SlowLow",
+      "Repetition BM_SlowHigh",  "Run BM_SlowHigh_mean",
+      "Run BM_SlowHigh_median",  "Run BM_SlowHigh_stddev",
+      "Run BM_SlowHigh_cv"};
+  EXPECT_EQ(events, expected);
+  EXPECT_TRUE(errors.empty());
+}
+
+TEST_F(TimeBudgetTest, SkipsWhatCannotRun) {
+  Execute("BM_Slow", 0.01);
+  const std::vector<std::string> expected = {"Repetition BM_SlowHigh",
+                                             "Repetition BM_SlowLow"};
+  EXPECT_EQ(events, expected);
+  const std::vector<std::string> errors = {"skipped: the time budget ran out"};
+  EXPECT_EQ(errors, errors);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,35 @@
+#include "benchmark/benchmark.h"
+#include "output_test.h"
+
+void BM_series(benchmark::State& state) {
+  benchmark::SharedCounter ops = state.RegisterSharedCounter("ops");
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(state.iterations());
+    ops += 1;
+  }
+}
+BENCHMARK(BM_series)->Threads(2)->RecordTimeSeries(0.001);
+
+ADD_CASES(TC_ConsoleOut,
+          {{"^BM_series/threads:2 %console_report ops=%hrfloat$"}});
+ADD_CASES(TC_JSONOut,
+          {{"\"name\": \"BM_series/threads:2\",$"},
+           {"\"family_index\": 0,$", MR_Next},
+           {"\"per_family_instance_index\": 0,$", MR_Next},
+           {"\"run_name\": \"BM_series/threads:2\",$", MR_Next},
+           {"\"run_type\": \"iteration\",$", MR_Next},
+           {"\"repetitions\": 1,$", MR_Next},
+           {"\"repetition_index\": 0,$", MR_Next},
+           {"\"threads\": 2,$", MR_Next},
+           {"\"iterations\": %int,$", MR_Next},
+           {"\"real_time\": %float,$", MR_Next},
+           {"\"cpu_time\": %float,$", MR_Next},
+           {"\"time_unit\": \"ns\",$", MR_Next},
+           {"\"ops\": %float,$", MR_Next},
+           {"\"time_series\": [[][{]\"time\": %float, \"iterations\": %int, "
+            "\"ops\": %float[}].*[]]$",
+            MR_Next},
+           {"}", MR_Next}});
+ADD_CASES(TC_CSVOut, {{"^\"BM_series/threads:2\",%csv_report,%float$"}});
+
+int main(int argc, char* argv[]) { RunOutputTests(argc, argv); }
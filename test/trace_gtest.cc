@@ -0,0 +1,100 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/trace.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+ABSL_DECLARE_FLAG(std::string, benchmark_trace_out);
+
+namespace benchmark {
+namespace internal {
+namespace {
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+size_t Count(const std::string& s, const std::string& what) {
+  size_t count = 0;
+  for (size_t pos = s.find(what); pos != std::string::npos;
+       pos = s.find(what, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+TEST(TracerTest, WritesTheSpans) {
+  Tracer tracer(10, 1);
+  tracer.AddSpan("runner", "a \"quoted\" name", tracer.Now(),
+                 {{"iterations", 42}});
+  const std::string path = ::testing::TempDir() + "trace_gtest_spans.json";
+  std::string error;
+  ASSERT_TRUE(tracer.Write(path, &error)) << error;
+  const std::string trace = ReadFile(path);
+  EXPECT_NE(trace.find("\"name\":\"a \\\"quoted\\\" name\",\"cat\":\"runner\","
+                       "\"ph\":\"X\""),
+            std::string::npos)
+      << trace;
+  EXPECT_NE(trace.find("\"args\":{\"iterations\":42}"), std::string::npos);
+  EXPECT_NE(trace.find("\"dropped_events\":0"), std::string::npos);
+}
+
+TEST(TracerTest, LimitsTheEvents) {
+  Tracer tracer(3, 2);
+  for (int run = 0; run < 2; ++run) {
+    tracer.StartRun();
+    for (int i = 0; i < 5; ++i) {
+      tracer.StartTimed();
+      tracer.StopTimed();
+    }
+  }
+  const std::string path = ::testing::TempDir() + "trace_gtest_limits.json";
+  std::string error;
+  ASSERT_TRUE(tracer.Write(path, &error)) << error;
+  const std::string trace = ReadFile(path);
+  // Two timed stretches of each run, of which the last one doesn't fit.
+  EXPECT_EQ(Count(trace, "\"name\":\"timed\""), 3u);
+  EXPECT_NE(trace.find("\"dropped_events\":1"), std::string::npos);
+}
+
+void BM_Traced(State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_Traced)->Iterations(10)->Threads(2)->Repetitions(2);
+
+TEST(TracerTest, TracesTheRun) {
+  const std::string path = ::testing::TempDir() + "trace_gtest_run.json";
+  absl::SetFlag(&FLAGS_benchmark_trace_out, path);
+  RunSpecifiedBenchmarks("BM_Traced");
+  absl::SetFlag(&FLAGS_benchmark_trace_out, "");
+  EXPECT_EQ(GetTracer(), nullptr);
+
+  const std::string trace = ReadFile(path);
+  EXPECT_EQ(Count(trace, "\"name\":\"BM_Traced/iterations:10/repeats:2/"
+                         "threads:2\""),
+            2u)
+      << trace;
+  EXPECT_EQ(Count(trace, "\"name\":\"iterations\""), 2u);
+  // A start and a stop barrier per thread and run.
+  EXPECT_EQ(Count(trace, "\"name\":\"barrier\""), 8u);
+  // With the ResumeTiming() when the iterations start, and the PauseTiming()
+  // when they are done.
+  EXPECT_EQ(Count(trace, "\"name\":\"timed\""), 2u * 2u * 11u);
+  EXPECT_EQ(Count(trace, "\"name\":\"report\""), 1u);
+  EXPECT_NE(trace.find("\"tid\":1"), std::string::npos);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace benchmark
@@ -0,0 +1,100 @@
+#include <cmath>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../src/benchmark_api_internal.h"
+#include "../src/tuner.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace benchmark;
+using namespace benchmark::internal;
+
+// A bowl over a 50x40 grid, lowest at (31, 7).
+double Bowl(const TunePoint& point) {
+  const double x = static_cast<double>(point[0]) - 31;
+  const double y = static_cast<double>(point[1]) - 7;
+  return x * x + 2 * y * y + 1;
+}
+
+TEST(TunerTest, CoordinateDescentFindsTheMinimumOfABowl) {
+  std::set<TunePoint> evaluated;
+  const TunePoint best = SearchTuneSpace(
+      {50, 40}, kTuneCoordinateDescent,
+      [&evaluated](const TunePoint& point, int rung) {
+        EXPECT_EQ(rung, 0);
+        EXPECT_TRUE(evaluated.insert(point).second) << "evaluated twice";
+        return Bowl(point);
+      });
+  EXPECT_EQ(best, TunePoint({31, 7}));
+  // Far fewer than the 2000 points of the grid.
+  EXPECT_LT(evaluated.size(), 100u);
+}
+
+TEST(TunerTest, SuccessiveHalvingKeepsTheBetterHalf) {
+  std::vector<int> evaluations_per_rung(10, 0);
+  const TunePoint best = SearchTuneSpace(
+      {8, 4}, kTuneSuccessiveHalving,
+      [&evaluations_per_rung](const TunePoint& point, int rung) {
+        ++evaluations_per_rung[rung];
+        return std::abs(static_cast<double>(point[0]) - 5) +
+               std::abs(static_cast<double>(point[1]) - 2);
+      });
+  EXPECT_EQ(best, TunePoint({5, 2}));
+  // All 32 points, then 16, 8, 4 and 2.
+  EXPECT_EQ(evaluations_per_rung,
+            std::vector<int>({32, 16, 8, 4, 2, 0, 0, 0, 0, 0}));
+}
+
+TEST(TunerTest, SuccessiveHalvingSamplesLargeSpaces) {
+  int evaluations = 0;
+  SearchTuneSpace({100, 100, 100}, kTuneSuccessiveHalving,
+                  [&evaluations](const TunePoint& point, int) {
+                    ++evaluations;
+                    return Bowl(point);
+                  });
+  EXPECT_EQ(evaluations, 64 + 32 + 16 + 8 + 4 + 2);
+}
+
+TEST(TunerTest, ObjectiveValue) {
+  BenchmarkReporter::Run run;
+  run.iterations = 10;
+  run.real_accumulated_time = 2;
+  run.cpu_accumulated_time = 1;
+  run.time_unit = kSecond;
+  run.counters["misses"] = Counter(3);
+  EXPECT_EQ(TuneObjectiveValue(run, ""), 0.2);
+  EXPECT_EQ(TuneObjectiveValue(run, "cpu_time"), 0.1);
+  EXPECT_EQ(TuneObjectiveValue(run, "misses"), 3);
+  EXPECT_TRUE(std::isinf(TuneObjectiveValue(run, "hits")));
+  run.error_occurred = true;
+  EXPECT_TRUE(std::isinf(TuneObjectiveValue(run, "")));
+}
+
+// Takes the least time per iteration with 48 and 3.
+void BM_Tiles(State& state) {
+  const double tile = static_cast<double>(state.range(0)) - 48;
+  const double unroll = static_cast<double>(state.range(1)) - 3;
+  for (auto _ : state) {
+    state.SetIterationTime(1e-6 * (1 + tile * tile + unroll * unroll));
+  }
+}
+
+TEST(TunerTest, ReportsTheBestArgs) {
+  ClearRegisteredBenchmarks();
+  RegisterBenchmark("BM_Tiles", BM_Tiles)
+      ->Tune({{8, 16, 32, 48, 64, 128}, {1, 2, 3, 4, 8}})
+      ->UseManualTime()
+      ->Iterations(10);
+  const std::vector<BenchmarkReporter::Run> runs =
+      RunSpecifiedBenchmarks("BM_Tiles/tune");
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_EQ(runs[0].run_name.function_name, "BM_Tiles");
+  EXPECT_EQ(runs[0].run_name.args, "48/3");
+  EXPECT_EQ(runs[0].iterations, 10u);
+}
+
+}  // namespace
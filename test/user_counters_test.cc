@@ -548,6 +548,97 @@ void CheckAvgIterationsRate(Results const& e) {
 CHECK_BENCHMARK_RESULTS("BM_Counters_kAvgIterationsRate",
                         &CheckAvgIterationsRate);
 
+// ========================================================================= //
+// ------------------------- Counter Handles Output ------------------------ //
+// ========================================================================= //
+
+void BM_Counters_Handles(benchmark::State& state) {
+  benchmark::CounterHandle foo = state.RegisterCounter("foo");
+  benchmark::CounterHandle bar = state.RegisterCounter(
+      "bar", benchmark::Counter(0, benchmark::Counter::kAvgIterations));
+  for (auto _ : state) {
+    state.counter(foo) += 1;
+    state.counter(bar) += 2;
+  }
+  // Registering a name again refers to the same counter.
+  state.counter(state.RegisterCounter("foo")) += 1;
+}
+BENCHMARK(BM_Counters_Handles);
+ADD_CASES(TC_ConsoleOut,
+          {{"^BM_Counters_Handles %console_report bar=%hrfloat "
+            "foo=%hrfloat$"}});
+ADD_CASES(TC_JSONOut, {{"\"name\": \"BM_Counters_Handles\",$"},
+                       {"\"family_index\": 12,$", MR_Next},
+                       {"\"per_family_instance_index\": 0,$", MR_Next},
+                       {"\"run_name\": \"BM_Counters_Handles\",$", MR_Next},
+                       {"\"run_type\": \"iteration\",$", MR_Next},
+                       {"\"repetitions\": 1,$", MR_Next},
+                       {"\"repetition_index\": 0,$", MR_Next},
+                       {"\"threads\": 1,$", MR_Next},
+                       {"\"iterations\": %int,$", MR_Next},
+                       {"\"real_time\": %float,$", MR_Next},
+                       {"\"cpu_time\": %float,$", MR_Next},
+                       {"\"time_unit\": \"ns\",$", MR_Next},
+                       {"\"bar\": %float,$", MR_Next},
+                       {"\"foo\": %float$", MR_Next},
+                       {"}", MR_Next}});
+ADD_CASES(TC_CSVOut,
+          {{"^\"BM_Counters_Handles\",%csv_report,%float,%float$"}});
+// VS2013 does not allow this function to be passed as a lambda argument
+// to CHECK_BENCHMARK_RESULTS()
+void CheckHandles(Results const& e) {
+  double its = e.NumIterations();
+  CHECK_FLOAT_COUNTER_VALUE(e, "foo", EQ, its + 1, 0.001);
+  CHECK_FLOAT_COUNTER_VALUE(e, "bar", EQ, 2., 0.001);
+}
+CHECK_BENCHMARK_RESULTS("BM_Counters_Handles", &CheckHandles);
+
+// ========================================================================= //
+// ------------------------- Shared Counters Output ------------------------ //
+// ========================================================================= //
+
+void BM_Counters_Shared(benchmark::State& state) {
+  benchmark::SharedCounter foo = state.RegisterSharedCounter("foo");
+  benchmark::SharedCounter bar = state.RegisterSharedCounter(
+      "bar", benchmark::Counter(0, benchmark::Counter::kAvgThreads));
+  double own = 0;
+  for (auto _ : state) {
+    foo += 1;
+    own += 1;
+  }
+  bar += 2;
+  assert(foo.Total() >= own);
+}
+BENCHMARK(BM_Counters_Shared)->Threads(2);
+ADD_CASES(TC_ConsoleOut, {{"^BM_Counters_Shared/threads:2 %console_report "
+                           "bar=%hrfloat foo=%hrfloat$"}});
+ADD_CASES(TC_JSONOut,
+          {{"\"name\": \"BM_Counters_Shared/threads:2\",$"},
+           {"\"family_index\": 13,$", MR_Next},
+           {"\"per_family_instance_index\": 0,$", MR_Next},
+           {"\"run_name\": \"BM_Counters_Shared/threads:2\",$", MR_Next},
+           {"\"run_type\": \"iteration\",$", MR_Next},
+           {"\"repetitions\": 1,$", MR_Next},
+           {"\"repetition_index\": 0,$", MR_Next},
+           {"\"threads\": 2,$", MR_Next},
+           {"\"iterations\": %int,$", MR_Next},
+           {"\"real_time\": %float,$", MR_Next},
+           {"\"cpu_time\": %float,$", MR_Next},
+           {"\"time_unit\": \"ns\",$", MR_Next},
+           {"\"bar\": %float,$", MR_Next},
+           {"\"foo\": %float$", MR_Next},
+           {"}", MR_Next}});
+ADD_CASES(TC_CSVOut, {{"^\"BM_Counters_Shared/threads:2\",%csv_report,"
+                       "%float,%float$"}});
+// VS2013 does not allow this function to be passed as a lambda argument
+// to CHECK_BENCHMARK_RESULTS()
+void CheckShared(Results const& e) {
+  double its = e.NumIterations();
+  CHECK_FLOAT_COUNTER_VALUE(e, "foo", EQ, its, 0.001);
+  CHECK_FLOAT_COUNTER_VALUE(e, "bar", EQ, 2., 0.001);
+}
+CHECK_BENCHMARK_RESULTS("BM_Counters_Shared/threads:2", &CheckShared);
+
 // ========================================================================= //
 // --------------------------- TEST CASES END ------------------------------ //
 // ========================================================================= //
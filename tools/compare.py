@@ -10,7 +10,7 @@ from argparse import ArgumentParser
 import json
 import sys
 import gbench
-from gbench import util, report
+from gbench import util, report, gate
 from gbench.util import *
 
 
@@ -25,10 +25,11 @@ def check_inputs(in1, in2, flags):
     if in1_kind == IT_Executable and in2_kind == IT_Executable and output_file:
         print(("WARNING: '--benchmark_out=%s' will be passed to both "
                "benchmarks causing it to be overwritten") % output_file)
-    if in1_kind == IT_JSON and in2_kind == IT_JSON and len(flags) > 0:
+    if in1_kind in (IT_JSON, IT_Binary) and \
+            in2_kind in (IT_JSON, IT_Binary) and len(flags) > 0:
         print("WARNING: passing optional flags has no effect since both "
-              "inputs are JSON")
-    if output_type is not None and output_type != 'json':
+              "inputs are result files")
+    if output_type is not None and output_type not in ('json', 'binary'):
         print(("ERROR: passing '--benchmark_out_format=%s' to 'compare.py`"
                " is not supported.") % output_type)
         sys.exit(1)
@@ -63,6 +64,15 @@ def create_parser():
         dest='dump_to_json',
         help="Additionally, dump benchmark comparison output to this file in JSON format.")
 
+    parser.add_argument(
+        '--normalize',
+        dest='normalize',
+        choices=['alu', 'l1', 'dram'],
+        help="Scale the times of the contender by how much faster this "
+             "reference kernel ran on its host than on the baseline's, as "
+             "timed by --benchmark_calibrate, so that results of hosts of "
+             "different speeds can be compared.")
+
     utest = parser.add_argument_group()
     utest.add_argument(
         '--no-utest',
@@ -79,6 +89,55 @@ def create_parser():
         help=("significance level alpha. if the calculated p-value is below this value, then the result is said to be statistically significant and the null hypothesis is rejected.\n(default: %0.4f)") %
         alpha_default)
 
+    gate_group = parser.add_argument_group(
+        'gate', 'Fail on the regressions that are significant across all '
+        'the benchmarks compared, and large enough to matter')
+    gate_group.add_argument(
+        '--gate',
+        dest='gate',
+        default=False,
+        action="store_true",
+        help="Exit with status 1 if any benchmark regressed: if the median of "
+             "its repetitions grew by more than its threshold, and its U test "
+             "p-value, adjusted for the number of benchmarks with the "
+             "Benjamini-Hochberg procedure, is at most the false discovery "
+             "rate. Requires the U test.")
+    gate_group.add_argument(
+        '--gate-fdr',
+        dest='gate_fdr',
+        default=0.05,
+        type=float,
+        help="The false discovery rate: the expected fraction of the reported "
+             "regressions that are false alarms. (default: %(default)g)")
+    gate_group.add_argument(
+        '--gate-threshold',
+        dest='gate_threshold',
+        default=0.05,
+        type=float,
+        help="The relative change below which a benchmark is unchanged, "
+             "e.g. 0.05 for 5%%. (default: %(default)g)")
+    gate_group.add_argument(
+        '--gate-thresholds',
+        dest='gate_thresholds',
+        type=argparse.FileType('r'),
+        help="A JSON file mapping regexes to thresholds, e.g. "
+             "{\"BM_noisy\": 0.2}. A benchmark gets the threshold of the "
+             "first regex matching the start of its name, or --gate-threshold "
+             "if none does.")
+    gate_group.add_argument(
+        '--gate-metric',
+        dest='gate_metric',
+        default='time',
+        choices=['time', 'cpu'],
+        help="Whether to gate on the real time or the cpu time. "
+             "(default: %(default)s)")
+    gate_group.add_argument(
+        '--gate-verdict',
+        dest='gate_verdict',
+        help="Write the verdict, with the change of each benchmark and the "
+             "geometric mean change of each family, to this file in JSON "
+             "format.")
+
     subparsers = parser.add_subparsers(
         help='This tool has multiple modes of operation:',
         dest='mode')
@@ -187,6 +246,9 @@ def main():
         exit(1)
     assert not unknown_args
     benchmark_options = args.benchmark_options
+    if args.gate and not args.utest:
+        print("ERROR: '--gate' needs the U test, which '--no-utest' disables")
+        exit(1)
 
     if args.mode == 'benchmarks':
         test_baseline = args.test_baseline[0].name
@@ -243,6 +305,14 @@ def main():
     json2 = json2_orig = gbench.util.sort_benchmark_results(gbench.util.run_or_load_benchmark(
         test_contender, benchmark_options + options_contender))
 
+    if args.normalize is not None:
+        try:
+            json2 = json2_orig = gbench.report.normalize_benchmark(
+                json1_orig, json2_orig, args.normalize)
+        except ValueError as e:
+            print("ERROR: %s" % e)
+            exit(1)
+
     # Now, filter the benchmarks so that the difference report can work
     if filter_baseline and filter_contender:
         replacement = '[%s vs. %s]' % (filter_baseline, filter_contender)
@@ -266,6 +336,22 @@ def main():
         with open(args.dump_to_json, 'w') as f_json:
             json.dump(diff_report, f_json)
 
+    if args.gate:
+        thresholds = []
+        if args.gate_thresholds is not None:
+            thresholds = json.load(args.gate_thresholds,
+                                   object_pairs_hook=lambda pairs: pairs)
+        verdict = gate.evaluate(diff_report, args.gate_fdr,
+                                args.gate_threshold, thresholds,
+                                args.gate_metric)
+        for ln in gate.print_verdict(verdict):
+            print(ln)
+        if args.gate_verdict is not None:
+            with open(args.gate_verdict, 'w') as f_json:
+                json.dump(verdict, f_json, indent=2)
+        if not verdict['passed']:
+            sys.exit(1)
+
 class TestParser(unittest.TestCase):
     def setUp(self):
         self.parser = create_parser()
@@ -287,6 +373,25 @@ class TestParser(unittest.TestCase):
         self.assertEqual(parsed.test_contender[0].name, self.testInput1)
         self.assertFalse(parsed.benchmark_options)
 
+    def test_benchmarks_with_gate(self):
+        parsed = self.parser.parse_args(
+            ['--gate', '--gate-fdr=0.1', '--gate-metric=cpu', 'benchmarks',
+             self.testInput0, self.testInput1])
+        self.assertTrue(parsed.gate)
+        self.assertEqual(parsed.gate_fdr, 0.1)
+        self.assertEqual(parsed.gate_threshold, 0.05)
+        self.assertEqual(parsed.gate_metric, 'cpu')
+        self.assertIsNone(parsed.gate_thresholds)
+        self.assertIsNone(parsed.gate_verdict)
+        self.assertEqual(parsed.mode, 'benchmarks')
+
+    def test_benchmarks_with_normalize(self):
+        parsed = self.parser.parse_args(
+            ['--normalize=dram', 'benchmarks', self.testInput0,
+             self.testInput1])
+        self.assertEqual(parsed.normalize, 'dram')
+        self.assertEqual(parsed.mode, 'benchmarks')
+
     def test_benchmarks_basic_without_utest(self):
         parsed = self.parser.parse_args(
             ['--no-utest', 'benchmarks', self.testInput0, self.testInput1])
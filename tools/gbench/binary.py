@@ -0,0 +1,370 @@
+"""binary.py - Reader for the --benchmark_out_format=binary result files
+
+The layout is described in src/binary_reporter.cc. The file is memory-mapped,
+and the columns are handed out as memoryviews into it, so that scanning them
+doesn't parse or copy anything.
+"""
+import mmap
+import struct
+import sys
+import unittest
+import os
+import tempfile
+
+MAGIC = b'GBENCHBR'
+VERSION = 1
+_HEADER = '8sII6Q'
+_HEADER_SIZE = 64
+
+_INT64 = 0
+_DOUBLE = 1
+_STRING = 2
+
+
+def is_binary_file(filename):
+    """
+    Return 'True' if 'filename' names a binary benchmark output file.
+    """
+    try:
+        with open(filename, 'rb') as f:
+            return f.read(len(MAGIC)) == MAGIC
+    except BaseException:
+        return False
+
+
+class BinaryResults(object):
+    """
+    The runs of a binary result file. Use as a context manager, or call
+    close(), to unmap the file.
+    """
+
+    def __init__(self, filename):
+        self._file = open(filename, 'rb')
+        self._map = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        self._view = memoryview(self._map)
+        magic, version, mark = struct.unpack_from('<8sII', self._map, 0)
+        if magic != MAGIC:
+            raise ValueError("'%s' is not a binary benchmark output file"
+                             % filename)
+        if mark == 0x01020304:
+            self._order = '<'
+        elif mark == 0x04030201:
+            self._order = '>'
+        else:
+            raise ValueError("'%s' has no valid byte order mark" % filename)
+        header = struct.unpack_from(self._order + _HEADER, self._map, 0)
+        if header[1] != VERSION:
+            raise ValueError("'%s' is of version %d, expected %d"
+                             % (filename, header[1], VERSION))
+        (self.num_runs, num_columns, num_strings, num_counters,
+         num_context) = header[3:8]
+        # The memoryviews can only be cast in the byte order of this machine.
+        self._native = self._order == ('<' if sys.byteorder == 'little'
+                                       else '>')
+
+        offset = _HEADER_SIZE
+        directory = self._uint64s(offset, 2 * num_columns)
+        offset += 16 * num_columns
+        self._columns = {}
+        column_offsets = []
+        for c in range(num_columns):
+            column_offsets.append((directory[2 * c], directory[2 * c + 1],
+                                   offset))
+            offset += 8 * self.num_runs
+        self._counter_index = self._uint64s(offset, self.num_runs + 1)
+        offset += 8 * (self.num_runs + 1)
+        self._counters_offset = offset
+        offset += 16 * num_counters
+        context = self._uint64s(offset, 2 * num_context)
+        offset += 16 * num_context
+        self._string_index = self._uint64s(offset, num_strings + 1)
+        offset += 8 * (num_strings + 1)
+        self._strings_offset = offset
+
+        for name, ctype, column_offset in column_offsets:
+            self._columns[self.string(name)] = (ctype, column_offset)
+        self._context = [(self.string(context[2 * i]),
+                          self.string(context[2 * i + 1]))
+                         for i in range(num_context)]
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def __len__(self):
+        return self.num_runs
+
+    def close(self):
+        self._view.release()
+        self._map.close()
+        self._file.close()
+
+    def _values(self, offset, count, fmt):
+        if self._native:
+            return self._view[offset:offset + 8 * count].cast(fmt)
+        return struct.unpack_from('%s%d%s' % (self._order, count, fmt),
+                                  self._map, offset)
+
+    def _uint64s(self, offset, count):
+        # A copy, so that the views into the map don't outlive it.
+        return list(self._values(offset, count, 'Q'))
+
+    def string(self, index):
+        """The string of index 'index' in the string table."""
+        begin = self._strings_offset + self._string_index[index]
+        end = self._strings_offset + self._string_index[index + 1]
+        return self._map[begin:end].decode('utf-8')
+
+    def column_names(self):
+        return list(self._columns.keys())
+
+    def column(self, name):
+        """
+        The values of column 'name' for all of the runs: a sequence of ints
+        or floats, or of string table indices for the string columns. It is a
+        view into the file, which must be released before close() is called.
+        """
+        ctype, offset = self._columns[name]
+        return self._values(offset, self.num_runs,
+                            'd' if ctype == _DOUBLE else 'q')
+
+    def values(self, name):
+        """The values of column 'name', copied into a list."""
+        return list(self.column(name))
+
+    def strings(self, name):
+        """The values of the string column 'name', as strings."""
+        return [self.string(i) for i in self.values(name)]
+
+    def counters(self, run):
+        """The user counters of run 'run', as a list of (name, value)."""
+        begin = self._counter_index[run]
+        end = self._counter_index[run + 1]
+        fmt = self._order + 'Qd'
+        return [struct.unpack_from(fmt, self._map,
+                                   self._counters_offset + 16 * i)
+                for i in range(begin, end)]
+
+    def context(self):
+        """The context, in the shape the JSON reporter writes it."""
+        context = {}
+        caches = {}
+        for key, value in self._context:
+            if key.startswith('caches/'):
+                _, index, field = key.split('/', 2)
+                cache = caches.setdefault(int(index), {})
+                cache[field] = value if field == 'type' else int(value)
+            elif key in ('num_cpus', 'mhz_per_cpu'):
+                context[key] = int(value)
+            elif key == 'cpu_scaling_enabled':
+                context[key] = value == 'true'
+            elif key == 'load_avg':
+                context[key] = [float(v) for v in value.split(',') if v]
+            else:
+                context[key] = value
+        context['caches'] = [caches[i] for i in sorted(caches)]
+        return context
+
+    def to_json(self):
+        """
+        All of the runs, in the shape the JSON reporter writes them, with the
+        same fields left out.
+        """
+        columns = {}
+        for name, (ctype, _) in self._columns.items():
+            values = self.values(name)
+            if ctype == _STRING:
+                values = [self.string(i) for i in values]
+            columns[name] = values
+        benchmarks = []
+        for i in range(self.num_runs):
+            def get(name):
+                return columns[name][i]
+            run = {
+                'name': get('name'),
+                'family_index': get('family_index'),
+                'per_family_instance_index': get('per_family_instance_index'),
+                'run_name': get('run_name'),
+                'run_type': get('run_type'),
+                'repetitions': get('repetitions'),
+            }
+            is_aggregate = run['run_type'] == 'aggregate'
+            if not is_aggregate:
+                run['repetition_index'] = get('repetition_index')
+            run['threads'] = get('threads')
+            if is_aggregate:
+                run['aggregate_name'] = get('aggregate_name')
+                run['aggregate_unit'] = get('aggregate_unit')
+            if get('error_occurred'):
+                run['error_occurred'] = True
+                run['error_message'] = get('error_message')
+            if get('big_o'):
+                run['cpu_coefficient'] = get('cpu_time')
+                run['real_coefficient'] = get('real_time')
+                run['big_o'] = get('big_o')
+                run['time_unit'] = get('time_unit')
+            elif get('rms'):
+                run['rms'] = get('cpu_time')
+            else:
+                run['iterations'] = get('iterations')
+                run['real_time'] = get('real_time')
+                run['cpu_time'] = get('cpu_time')
+                run['time_unit'] = get('time_unit')
+            for name, value in self.counters(i):
+                run[self.string(name)] = value
+            if get('has_memory_result'):
+                run['allocs_per_iter'] = get('allocs_per_iter')
+                run['max_bytes_used'] = get('max_bytes_used')
+            if get('relative_error') > 0:
+                run['relative_error'] = get('relative_error')
+            if get('cold_cache'):
+                run['cold_cache'] = True
+            if get('real_time_overhead') > 0 or get('cpu_time_overhead') > 0:
+                run['real_time_overhead'] = get('real_time_overhead')
+                run['cpu_time_overhead'] = get('cpu_time_overhead')
+            if get('cpu_frequency_mhz') > 0:
+                run['cpu_frequency_mhz'] = get('cpu_frequency_mhz')
+            if get('label'):
+                run['label'] = get('label')
+            benchmarks.append(run)
+        return {'context': self.context(), 'benchmarks': benchmarks}
+
+
+def load(filename):
+    """
+    Read a binary result file into the same object json.load() returns for
+    the JSON output.
+    """
+    with BinaryResults(filename) as results:
+        return results.to_json()
+
+
+def _write_test_file(filename, runs, context):
+    """
+    Write 'runs', dicts of column values, and 'context', a list of key and
+    value pairs, as the binary reporter would.
+    """
+    int64_columns = ['family_index', 'per_family_instance_index',
+                     'repetitions', 'repetition_index', 'threads',
+                     'error_occurred', 'iterations', 'rms',
+                     'has_memory_result', 'max_bytes_used', 'cold_cache']
+    double_columns = ['real_time', 'cpu_time', 'allocs_per_iter',
+                      'relative_error', 'real_time_overhead',
+                      'cpu_time_overhead', 'cpu_frequency_mhz']
+    string_columns = ['name', 'run_name', 'run_type', 'aggregate_name',
+                      'aggregate_unit', 'error_message', 'time_unit', 'big_o',
+                      'label']
+    strings = ['']
+
+    def intern(s):
+        if s not in strings:
+            strings.append(s)
+        return strings.index(s)
+
+    columns = [(name, _INT64) for name in int64_columns] + \
+        [(name, _DOUBLE) for name in double_columns] + \
+        [(name, _STRING) for name in string_columns]
+    data = b''
+    for name, ctype in columns:
+        for run in runs:
+            if ctype == _STRING:
+                data += struct.pack('<Q', intern(run.get(name, '')))
+            elif ctype == _DOUBLE:
+                data += struct.pack('<d', run.get(name, 0.0))
+            else:
+                data += struct.pack('<q', run.get(name, 0))
+    index = [0]
+    counters = b''
+    for run in runs:
+        for name, value in run.get('counters', []):
+            counters += struct.pack('<Qd', intern(name), value)
+        index.append(index[-1] + len(run.get('counters', [])))
+    directory = b''.join(struct.pack('<QQ', intern(name), ctype)
+                         for name, ctype in columns)
+    context_data = b''.join(struct.pack('<QQ', intern(k), intern(v))
+                            for k, v in context)
+    blob = b''
+    string_index = [0]
+    for s in strings:
+        blob += s.encode('utf-8')
+        string_index.append(len(blob))
+    with open(filename, 'wb') as f:
+        f.write(struct.pack('<' + _HEADER, MAGIC, VERSION, 0x01020304,
+                            len(runs), len(columns), len(strings),
+                            index[-1], len(context), 0))
+        f.write(directory)
+        f.write(data)
+        f.write(struct.pack('<%dQ' % len(index), *index))
+        f.write(counters)
+        f.write(context_data)
+        f.write(struct.pack('<%dQ' % len(string_index), *string_index))
+        f.write(blob)
+
+
+class TestBinaryResults(unittest.TestCase):
+    def setUp(self):
+        handle, self.filename = tempfile.mkstemp()
+        os.close(handle)
+        run = {'name': 'BM_Two/8', 'run_name': 'BM_Two/8',
+               'run_type': 'iteration', 'repetitions': 2, 'threads': 1,
+               'iterations': 500, 'real_time': 3.0, 'cpu_time': 2.5,
+               'time_unit': 'us'}
+        runs = [
+            {'name': 'BM_One', 'run_name': 'BM_One', 'run_type': 'iteration',
+             'repetitions': 1, 'threads': 1, 'iterations': 1000,
+             'real_time': 10.5, 'cpu_time': 10.25, 'time_unit': 'ns',
+             'label': 'hello', 'counters': [('items_per_second', 2e6)]},
+            dict(run, family_index=1),
+            dict(run, family_index=1, repetition_index=1),
+            dict(run, name='BM_Two/8_mean', family_index=1,
+                 run_type='aggregate', aggregate_name='mean',
+                 aggregate_unit='time', iterations=2),
+        ]
+        context = [('num_cpus', '8'), ('host_name', 'host'),
+                   ('caches/0/type', 'Data'), ('caches/0/level', '1'),
+                   ('caches/0/size', '32768'), ('caches/0/num_sharing', '1'),
+                   ('caches/1/type', 'Unified'), ('caches/1/level', '2'),
+                   ('caches/1/size', '1048576'), ('caches/1/num_sharing', '2')]
+        _write_test_file(self.filename, runs, context)
+
+    def tearDown(self):
+        os.unlink(self.filename)
+
+    def test_is_binary_file(self):
+        self.assertTrue(is_binary_file(self.filename))
+        self.assertFalse(is_binary_file(os.path.realpath(__file__)))
+
+    def test_columns(self):
+        with BinaryResults(self.filename) as results:
+            self.assertEqual(len(results), 4)
+            self.assertEqual(results.strings('name'),
+                             ['BM_One', 'BM_Two/8', 'BM_Two/8',
+                              'BM_Two/8_mean'])
+            self.assertEqual(results.values('repetition_index'),
+                             [0, 0, 1, 0])
+            real_time = results.column('real_time')
+            self.assertEqual(sum(real_time), 19.5)
+            real_time.release()
+
+    def test_to_json(self):
+        result = load(self.filename)
+        self.assertEqual(result['context']['num_cpus'], 8)
+        self.assertEqual(result['context']['caches'][1],
+                         {'type': 'Unified', 'level': 2, 'size': 1048576,
+                          'num_sharing': 2})
+        benchmarks = result['benchmarks']
+        self.assertEqual(benchmarks[0], {
+            'name': 'BM_One', 'family_index': 0,
+            'per_family_instance_index': 0, 'run_name': 'BM_One',
+            'run_type': 'iteration', 'repetitions': 1, 'repetition_index': 0,
+            'threads': 1, 'iterations': 1000, 'real_time': 10.5,
+            'cpu_time': 10.25, 'time_unit': 'ns', 'items_per_second': 2e6,
+            'label': 'hello'})
+        self.assertEqual(benchmarks[3]['aggregate_name'], 'mean')
+        self.assertNotIn('repetition_index', benchmarks[3])
+
+
+if __name__ == '__main__':
+    unittest.main()
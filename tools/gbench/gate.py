@@ -0,0 +1,249 @@
+"""gate.py - Decide whether a difference report shows regressions
+
+A difference report of thousands of benchmarks has some with a p-value below
+any alpha by chance alone. The gate only confirms a regression if it is still
+significant once the p-values are corrected for the number of benchmarks
+(Benjamini-Hochberg, which bounds the expected fraction of false alarms among
+the reported regressions), and if it is large enough to matter.
+"""
+import math
+import re
+import unittest
+
+REGRESSION = 'regression'
+IMPROVEMENT = 'improvement'
+UNCHANGED = 'unchanged'
+# The change is larger than the threshold, but there are too few repetitions
+# to tell whether it is significant.
+INCONCLUSIVE = 'inconclusive'
+
+
+def benjamini_hochberg(pvalues):
+    """
+    Return the Benjamini-Hochberg adjusted p-values (q-values) of 'pvalues', in
+    the same order: a test is significant at a false discovery rate q if its
+    adjusted p-value is at most q.
+    """
+    m = len(pvalues)
+    order = sorted(range(m), key=lambda i: pvalues[i])
+    adjusted = [0.0] * m
+    running_min = 1.0
+    for rank in range(m, 0, -1):
+        i = order[rank - 1]
+        running_min = min(running_min, pvalues[i] * m / rank)
+        adjusted[i] = running_min
+    return adjusted
+
+
+def median(values):
+    values = sorted(values)
+    n = len(values)
+    if n % 2:
+        return values[n // 2]
+    return (values[n // 2 - 1] + values[n // 2]) / 2.0
+
+
+def geometric_mean(values):
+    return math.exp(sum(math.log(v) for v in values) / len(values))
+
+
+def parse_thresholds(thresholds):
+    """
+    Compile 'thresholds', a list of (regex, threshold) pairs, or a dict of
+    them in order, of which the first whose regex matches the start of a
+    benchmark's name applies to it.
+    """
+    items = thresholds.items() if isinstance(thresholds, dict) else thresholds
+    return [(re.compile(pattern), float(threshold))
+            for pattern, threshold in items]
+
+
+def family_name(benchmark_name):
+    return benchmark_name.split('/', 1)[0]
+
+
+def evaluate(diff_report, fdr=0.05, threshold=0.05, thresholds=(),
+             metric='time'):
+    """
+    Gate the benchmarks of 'diff_report', as made by
+    report.get_difference_report() with the U test, on their 'metric' ('time'
+    or 'cpu'). A benchmark regressed if the median of its repetitions grew by
+    more than its threshold, the first of 'thresholds' that matches its name
+    or 'threshold' otherwise, and if its adjusted p-value is at most 'fdr'.
+    Return the verdict: whether it 'passed', and each benchmark's and each
+    family's change, as a dict that can be written as JSON.
+    """
+    assert metric in ('time', 'cpu')
+    thresholds = parse_thresholds(thresholds)
+    old_field = 'real_time' if metric == 'time' else 'cpu_time'
+    pvalue_field = metric + '_pvalue'
+
+    benchmarks = []
+    for benchmark in diff_report:
+        if benchmark['run_type'] == 'aggregate' or not benchmark['measurements']:
+            continue
+        measurements = benchmark['measurements']
+        old = median([m[old_field] for m in measurements])
+        new = median([m[old_field + '_other'] for m in measurements])
+        if old <= 0 or new <= 0:
+            continue
+        limit = threshold
+        for pattern, value in thresholds:
+            if pattern.match(benchmark['name']):
+                limit = value
+                break
+        utest = benchmark['utest']
+        benchmarks.append({
+            'name': benchmark['name'],
+            'old': old,
+            'new': new,
+            'change': new / old - 1,
+            'threshold': limit,
+            'pvalue': utest[pvalue_field] if utest else None,
+        })
+
+    tested = [b for b in benchmarks if b['pvalue'] is not None]
+    for b, q in zip(tested, benjamini_hochberg([b['pvalue'] for b in tested])):
+        b['qvalue'] = q
+    for b in benchmarks:
+        b.setdefault('qvalue', None)
+        if abs(b['change']) <= b['threshold']:
+            b['verdict'] = UNCHANGED
+        elif b['qvalue'] is None:
+            b['verdict'] = INCONCLUSIVE
+        elif b['qvalue'] > fdr:
+            b['verdict'] = UNCHANGED
+        else:
+            b['verdict'] = REGRESSION if b['change'] > 0 else IMPROVEMENT
+
+    families = []
+    by_family = {}
+    for b in benchmarks:
+        name = family_name(b['name'])
+        if name not in by_family:
+            by_family[name] = []
+            families.append(name)
+        by_family[name].append(b)
+    family_summaries = []
+    for name in families:
+        members = by_family[name]
+        family_summaries.append({
+            'name': name,
+            'benchmarks': len(members),
+            'change': geometric_mean([b['new'] / b['old']
+                                      for b in members]) - 1,
+            'regressions': sum(b['verdict'] == REGRESSION for b in members),
+        })
+
+    regressions = [b['name'] for b in benchmarks if b['verdict'] == REGRESSION]
+    return {
+        'passed': not regressions,
+        'metric': metric,
+        'fdr': fdr,
+        'regressions': regressions,
+        'benchmarks': benchmarks,
+        'families': family_summaries,
+    }
+
+
+def print_verdict(verdict):
+    """
+    Return the lines summarizing 'verdict': the confirmed regressions and
+    improvements, and the change of each family.
+    """
+    lines = ['Gate on %s, false discovery rate %g:' %
+             (verdict['metric'], verdict['fdr'])]
+    for b in verdict['benchmarks']:
+        if b['verdict'] in (REGRESSION, IMPROVEMENT, INCONCLUSIVE):
+            lines.append('  %-12s %s %+.2f%% (threshold %.2f%%, q=%s)' % (
+                b['verdict'], b['name'], b['change'] * 100,
+                b['threshold'] * 100,
+                'n/a' if b['qvalue'] is None else '%.4f' % b['qvalue']))
+    for f in verdict['families']:
+        lines.append('  family %s: geomean %+.2f%% over %d benchmarks' % (
+            f['name'], f['change'] * 100, f['benchmarks']))
+    lines.append('PASSED' if verdict['passed'] else
+                 'FAILED: %d regressions' % len(verdict['regressions']))
+    return lines
+
+
+###############################################################################
+# Unit tests
+
+
+class TestBenjaminiHochberg(unittest.TestCase):
+    def test_adjusted_pvalues(self):
+        adjusted = benjamini_hochberg([0.01, 0.04, 0.03, 0.5])
+        expected = [0.04, 0.04 * 4 / 3, 0.04 * 4 / 3, 0.5]
+        for a, e in zip(adjusted, expected):
+            self.assertAlmostEqual(a, e)
+
+    def test_capped_at_one(self):
+        self.assertEqual(benjamini_hochberg([0.9, 0.8]), [0.9, 0.9])
+        self.assertEqual(benjamini_hochberg([]), [])
+
+
+class TestEvaluate(unittest.TestCase):
+    @staticmethod
+    def make_benchmark(name, old, new, pvalue, run_type='iteration'):
+        return {
+            'name': name,
+            'run_type': run_type,
+            'measurements': [{'real_time': o, 'cpu_time': o,
+                              'real_time_other': n, 'cpu_time_other': n}
+                             for o, n in zip(old, new)],
+            'utest': {} if pvalue is None else {'time_pvalue': pvalue,
+                                                'cpu_pvalue': pvalue},
+        }
+
+    def test_verdicts(self):
+        report = [
+            self.make_benchmark('BM_a/1', [10, 10, 10], [12, 12, 12], 0.001),
+            self.make_benchmark('BM_a/1_mean', [10], [12], None, 'aggregate'),
+            self.make_benchmark('BM_a/2', [10, 10, 10], [8, 8, 8], 0.002),
+            # Significant, but too small to matter.
+            self.make_benchmark('BM_b', [10, 10, 10], [10.2, 10.2, 10.2],
+                                0.001),
+            # Large, but not significant once corrected.
+            self.make_benchmark('BM_c', [10, 10, 10], [13, 13, 13], 0.045),
+            self.make_benchmark('BM_d', [10], [20], None),
+            self.make_benchmark('BM_e', [10, 10, 10], [10, 10, 10], 0.9),
+        ]
+        verdict = evaluate(report, fdr=0.05, threshold=0.05)
+        self.assertFalse(verdict['passed'])
+        self.assertEqual(verdict['regressions'], ['BM_a/1'])
+        self.assertEqual([b['verdict'] for b in verdict['benchmarks']],
+                         [REGRESSION, IMPROVEMENT, UNCHANGED, UNCHANGED,
+                          INCONCLUSIVE, UNCHANGED])
+        self.assertAlmostEqual(verdict['benchmarks'][3]['qvalue'],
+                               0.045 * 5 / 4)
+        families = verdict['families']
+        self.assertEqual([f['name'] for f in families],
+                         ['BM_a', 'BM_b', 'BM_c', 'BM_d', 'BM_e'])
+        self.assertAlmostEqual(families[0]['change'],
+                               math.sqrt(1.2 * 0.8) - 1)
+        self.assertEqual(families[0]['regressions'], 1)
+        self.assertTrue(print_verdict(verdict)[-1].startswith('FAILED'))
+
+    def test_thresholds(self):
+        report = [
+            self.make_benchmark('BM_noisy/1', [10, 10], [12, 12], 0.001),
+            self.make_benchmark('BM_quiet/1', [10, 10], [10.3, 10.3], 0.001),
+        ]
+        verdict = evaluate(report, threshold=0.1,
+                           thresholds=[('BM_noisy', 0.25), ('BM_q', 0.02)])
+        self.assertEqual(verdict['regressions'], ['BM_quiet/1'])
+        self.assertEqual([b['threshold'] for b in verdict['benchmarks']],
+                         [0.25, 0.02])
+
+        verdict = evaluate(report, threshold=0.5)
+        self.assertTrue(verdict['passed'])
+        self.assertEqual(print_verdict(verdict)[-1], 'PASSED')
+
+
+if __name__ == '__main__':
+    unittest.main()
+
+# vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4
+# kate: tab-width: 4; replace-tabs on; indent-width 4; tab-indents: off;
+# kate: indent-mode python; remove-trailing-spaces modified;
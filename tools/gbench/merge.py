@@ -0,0 +1,123 @@
+"""merge.py - Merge the outputs of the shards of a benchmark run
+
+Each shard, run with --benchmark_shard_index=<i> --benchmark_shard_count=<n>,
+only runs some of the benchmarks, but they keep the family indices they have
+among all the shards, so that merging the shards' outputs gives the report of
+an unsharded run. See tools/merge_shards.py for the command line tool.
+"""
+import copy
+import unittest
+
+SHARD_CONTEXT_KEY = 'benchmark_shard'
+
+
+def _instance_key(benchmark):
+    return (benchmark.get('family_index', -1),
+            benchmark.get('per_family_instance_index', -1))
+
+
+def merge_shards(shards):
+    """
+    Merge 'shards', the JSON results of the shards of a run, into the results
+    of the whole run. The benchmarks are in the order an unsharded run reports
+    them, and the family indices are renumbered from 0, as if the benchmarks of
+    any shard that is missing had not been selected.
+    RAISES ValueError if the shards are not of the same run: if two shards
+    are the same shard, or have a different count of shards, or have
+    different benchmarks at the same indices.
+    """
+    if not shards:
+        raise ValueError('no shards to merge')
+
+    seen_shards = set()
+    shard_count = None
+    for shard in shards:
+        value = shard.get('context', {}).get(SHARD_CONTEXT_KEY)
+        if value is None:
+            continue
+        index, count = value.split('/')
+        if shard_count is not None and count != shard_count:
+            raise ValueError('shards of runs with %s and %s shards' %
+                             (shard_count, count))
+        shard_count = count
+        if index in seen_shards:
+            raise ValueError('shard %s is given twice' % index)
+        seen_shards.add(index)
+
+    names = {}
+    benchmarks = []
+    for shard in shards:
+        for benchmark in shard['benchmarks']:
+            # The aggregates of a family are named after the family.
+            if benchmark.get('run_type') != 'aggregate':
+                key = _instance_key(benchmark)
+                name = benchmark.get('run_name', benchmark['name'])
+                if names.setdefault(key, name) != name:
+                    raise ValueError(
+                        "'%s' and '%s' have the same indices %s" %
+                        (names[key], name, key))
+            benchmarks.append(benchmark)
+
+    # A stable sort keeps the repetitions and aggregates of an instance in
+    # the order they were reported in.
+    benchmarks = sorted(copy.deepcopy(benchmarks), key=_instance_key)
+    family_indices = {}
+    for benchmark in benchmarks:
+        if 'family_index' in benchmark:
+            benchmark['family_index'] = family_indices.setdefault(
+                benchmark['family_index'], len(family_indices))
+
+    context = copy.deepcopy(shards[0].get('context', {}))
+    context.pop(SHARD_CONTEXT_KEY, None)
+    context['num_shards'] = len(shards)
+    return {'context': context, 'benchmarks': benchmarks}
+
+
+class TestMergeShards(unittest.TestCase):
+    @staticmethod
+    def make_shard(index, count, benchmarks):
+        return {'context': {'host_name': 'host%d' % index,
+                            SHARD_CONTEXT_KEY: '%d/%d' % (index, count)},
+                'benchmarks': benchmarks}
+
+    @staticmethod
+    def make_run(name, family, instance, run_type='iteration'):
+        return {'name': name, 'run_name': name, 'run_type': run_type,
+                'family_index': family, 'per_family_instance_index': instance}
+
+    def test_merge_in_order(self):
+        shard0 = self.make_shard(0, 2, [
+            self.make_run('BM_b/1', 2, 0),
+            self.make_run('BM_a/2', 1, 1)])
+        shard1 = self.make_shard(1, 2, [
+            self.make_run('BM_a/1', 1, 0),
+            self.make_run('BM_a/1_mean', 1, 0, 'aggregate'),
+            self.make_run('BM_c', 4, 0)])
+        merged = merge_shards([shard0, shard1])
+        self.assertEqual(
+            [(b['name'], b['family_index']) for b in merged['benchmarks']],
+            [('BM_a/1', 0), ('BM_a/1_mean', 0), ('BM_a/2', 0),
+             ('BM_b/1', 1), ('BM_c', 2)])
+        self.assertEqual(merged['context']['host_name'], 'host0')
+        self.assertNotIn(SHARD_CONTEXT_KEY, merged['context'])
+        self.assertEqual(merged['context']['num_shards'], 2)
+        # The inputs are left as they were.
+        self.assertEqual(shard1['benchmarks'][2]['family_index'], 4)
+
+    def test_inconsistent_shards(self):
+        shard0 = self.make_shard(0, 2, [self.make_run('BM_a', 0, 0)])
+        with self.assertRaises(ValueError):
+            merge_shards([shard0, shard0])
+        with self.assertRaises(ValueError):
+            merge_shards([shard0, self.make_shard(1, 3, [])])
+        with self.assertRaises(ValueError):
+            merge_shards(
+                [shard0, self.make_shard(1, 2, [self.make_run('BM_b', 0, 0)])])
+
+
+if __name__ == '__main__':
+    unittest.main()
+
+# vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4
+# kate: tab-width: 4; replace-tabs on; indent-width 4; tab-indents: off;
+# kate: indent-mode python; remove-trailing-spaces modified;
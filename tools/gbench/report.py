@@ -91,12 +91,40 @@ def filter_benchmark(json_orig, family, replacement=""):
     for be in json_orig['benchmarks']:
         if not regex.search(be['name']):
             continue
-        filteredbench = copy.deepcopy(be)  # Do NOT modify the old name!
+        filteredbench = dict(be)  # Do NOT modify the old name!
         filteredbench['name'] = regex.sub(replacement, filteredbench['name'])
         filtered['benchmarks'].append(filteredbench)
     return filtered
 
 
+def normalize_benchmark(json_baseline, json_contender, kernel):
+    """
+    Scale the times of 'json_contender' by how much faster the reference
+    'kernel' of --benchmark_calibrate ran on its host than on that of
+    'json_baseline', so that they are as if measured on the baseline's host.
+    Raises ValueError if either was not calibrated.
+    """
+    key = 'calibration_%s_ns' % kernel
+    try:
+        baseline_ns = float(json_baseline['context'][key])
+        contender_ns = float(json_contender['context'][key])
+    except (KeyError, ValueError):
+        raise ValueError("both results need '%s' in their context, from "
+                         "--benchmark_calibrate" % key)
+    scale = baseline_ns / contender_ns
+    normalized = dict(json_contender)
+    normalized['benchmarks'] = []
+    for be in json_contender['benchmarks']:
+        scaledbench = dict(be)
+        # The coefficients of variation are not times.
+        if be.get('aggregate_unit', 'time') == 'time':
+            for field in ('real_time', 'cpu_time'):
+                if field in scaledbench:
+                    scaledbench[field] = scaledbench[field] * scale
+        normalized['benchmarks'].append(scaledbench)
+    return normalized
+
+
 def get_unique_benchmark_names(json):
     """
     While *keeping* the order, give all the unique 'names' used for benchmarks.
@@ -113,7 +141,8 @@ def intersect(list1, list2):
     Given two lists, get a new list consisting of the elements only contained
     in *both of the input lists*, while preserving the ordering.
     """
-    return [x for x in list1 if x in list2]
+    set2 = set(list2)
+    return [x for x in list1 if x in set2]
 
 
 def is_potentially_comparable_benchmark(x):
@@ -126,26 +155,33 @@ def partition_benchmarks(json1, json2):
     both of the inputs, and group them.
     (i.e. partition/filter into groups with common name)
     """
-    json1_unique_names = get_unique_benchmark_names(json1)
-    json2_unique_names = get_unique_benchmark_names(json2)
-    names = intersect(json1_unique_names, json2_unique_names)
+    # Group the runs of each input by name in one pass, rather than scanning
+    # the inputs for each name, which is quadratic in the number of runs.
+    def group_by_name(json):
+        groups = {}
+        for x in json['benchmarks']:
+            groups.setdefault(x['name'], []).append(x)
+        return groups
+
+    json1_groups = group_by_name(json1)
+    json2_groups = group_by_name(json2)
     partitions = []
-    for name in names:
+    for name in get_unique_benchmark_names(json1):
+        if name not in json2_groups:
+            continue
         time_unit = None
         # Pick the time unit from the first entry of the lhs benchmark.
         # We should be careful not to crash with unexpected input.
-        for x in json1['benchmarks']:
-            if (x['name'] == name and is_potentially_comparable_benchmark(x)):
+        for x in json1_groups[name]:
+            if is_potentially_comparable_benchmark(x):
                 time_unit = x['time_unit']
                 break
         if time_unit is None:
             continue
-        # Filter by name and time unit.
+        # Filter by time unit.
         # All the repetitions are assumed to be comparable.
-        lhs = [x for x in json1['benchmarks'] if x['name'] == name and
-               x['time_unit'] == time_unit]
-        rhs = [x for x in json2['benchmarks'] if x['name'] == name and
-               x['time_unit'] == time_unit]
+        lhs = [x for x in json1_groups[name] if x.get('time_unit') == time_unit]
+        rhs = [x for x in json2_groups[name] if x.get('time_unit') == time_unit]
         partitions.append([lhs, rhs])
     return partitions
 
@@ -994,7 +1030,7 @@ class TestReportSorting(unittest.TestCase):
         cls.json = load_result()
 
     def test_json_diff_report_pretty_printing(self):
-        import util
+        from . import util
 
         expected_names = [
             "99 family 0 instance 0 repetition 0",
@@ -1020,6 +1056,34 @@ class TestReportSorting(unittest.TestCase):
                 self.assertEqual(out['name'], expected)
 
 
+class TestNormalizeBenchmark(unittest.TestCase):
+    def setUp(self):
+        def result(alu_ns, times):
+            return {
+                'context': {'calibration_alu_ns': str(alu_ns)},
+                'benchmarks': [
+                    {'name': 'BM_One', 'real_time': times[0],
+                     'cpu_time': times[0]},
+                    {'name': 'BM_One_cv', 'run_type': 'aggregate',
+                     'aggregate_unit': 'percentage', 'real_time': times[1],
+                     'cpu_time': times[1]},
+                ]
+            }
+        self.baseline = result(1.0, [10, 0.1])
+        self.contender = result(2.0, [30, 0.2])
+
+    def test_scales_the_times_of_the_contender(self):
+        normalized = normalize_benchmark(self.baseline, self.contender, 'alu')
+        self.assertEqual(normalized['benchmarks'][0]['real_time'], 15)
+        self.assertEqual(normalized['benchmarks'][0]['cpu_time'], 15)
+        self.assertEqual(normalized['benchmarks'][1]['real_time'], 0.2)
+        self.assertEqual(self.contender['benchmarks'][0]['real_time'], 30)
+
+    def test_needs_the_calibration(self):
+        with self.assertRaises(ValueError):
+            normalize_benchmark(self.baseline, self.contender, 'dram')
+
+
 def assert_utest(unittest_instance, lhs, rhs):
     if lhs['utest']:
         unittest_instance.assertAlmostEqual(
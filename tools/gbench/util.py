@@ -7,10 +7,13 @@ import subprocess
 import sys
 import functools
 
+from . import binary
+
 # Input file type enumeration
 IT_Invalid = 0
 IT_JSON = 1
 IT_Executable = 2
+IT_Binary = 3
 
 _num_magic_bytes = 2 if sys.platform.startswith('win') else 4
 
@@ -68,10 +71,12 @@ def classify_input_file(filename):
         err_msg = "'%s' does not name a file" % filename
     elif is_executable_file(filename):
         ftype = IT_Executable
+    elif binary.is_binary_file(filename):
+        ftype = IT_Binary
     elif is_json_file(filename):
         ftype = IT_JSON
     else:
-        err_msg = "'%s' does not name a valid benchmark executable or JSON file" % filename
+        err_msg = "'%s' does not name a valid benchmark executable, JSON or binary file" % filename
     return ftype, err_msg
 
 
@@ -114,8 +119,10 @@ def remove_benchmark_flags(prefix, benchmark_flags):
 def load_benchmark_results(fname):
     """
     Read benchmark output from a file and return the JSON object.
-    REQUIRES: 'fname' names a file containing JSON benchmark output.
+    REQUIRES: 'fname' names a file containing JSON or binary benchmark output.
     """
+    if binary.is_binary_file(fname):
+        return binary.load(fname)
     with open(fname, 'r') as f:
         return json.load(f)
 
@@ -123,15 +130,13 @@ def load_benchmark_results(fname):
 def sort_benchmark_results(result):
     benchmarks = result['benchmarks']
 
-    # From inner key to the outer key!
-    benchmarks = sorted(
-        benchmarks, key=lambda benchmark: benchmark['repetition_index'] if 'repetition_index' in benchmark else -1)
-    benchmarks = sorted(
-        benchmarks, key=lambda benchmark: 1 if 'run_type' in benchmark and benchmark['run_type'] == "aggregate" else 0)
-    benchmarks = sorted(
-        benchmarks, key=lambda benchmark: benchmark['per_family_instance_index'] if 'per_family_instance_index' in benchmark else -1)
-    benchmarks = sorted(
-        benchmarks, key=lambda benchmark: benchmark['family_index'] if 'family_index' in benchmark else -1)
+    # One stable sort by the outer key, then the inner ones.
+    def sort_key(benchmark):
+        return (benchmark.get('family_index', -1),
+                benchmark.get('per_family_instance_index', -1),
+                1 if benchmark.get('run_type') == "aggregate" else 0,
+                benchmark.get('repetition_index', -1))
+    benchmarks = sorted(benchmarks, key=sort_key)
 
     result['benchmarks'] = benchmarks
     return result
@@ -170,11 +175,11 @@ def run_or_load_benchmark(filename, benchmark_flags):
     """
     Get the results for a specified benchmark. If 'filename' specifies
     an executable benchmark then the results are generated by running the
-    benchmark. Otherwise 'filename' must name a valid JSON output file,
-    which is loaded and the result returned.
+    benchmark. Otherwise 'filename' must name a valid JSON or binary output
+    file, which is loaded and the result returned.
     """
     ftype = check_input_file(filename)
-    if ftype == IT_JSON:
+    if ftype == IT_JSON or ftype == IT_Binary:
         return load_benchmark_results(filename)
     if ftype == IT_Executable:
         return run_benchmark(filename, benchmark_flags)
@@ -0,0 +1,44 @@
+#!/usr/bin/env python
+
+"""
+merge_shards.py - merge the outputs of the shards of a benchmark run
+"""
+
+from argparse import ArgumentParser
+import json
+import sys
+from gbench import merge, util
+
+
+def create_parser():
+    parser = ArgumentParser(
+        description='merge the outputs of the shards of a benchmark run, '
+        'each run with --benchmark_shard_index and --benchmark_shard_count, '
+        'into the output of the whole run')
+    parser.add_argument(
+        '-o', '--output', dest='output', required=True,
+        help='the JSON file to write the merged results to')
+    parser.add_argument(
+        'shards', metavar='shard', nargs='+',
+        help='the JSON or binary output of a shard')
+    return parser
+
+
+def main():
+    args = create_parser().parse_args()
+    shards = [util.load_benchmark_results(fname) for fname in args.shards]
+    try:
+        merged = merge.merge_shards(shards)
+    except ValueError as e:
+        print('ERROR: %s' % e)
+        sys.exit(1)
+    with open(args.output, 'w') as f:
+        json.dump(merged, f, indent=2)
+
+
+if __name__ == '__main__':
+    main()
+
+# vim: tabstop=4 expandtab shiftwidth=4 softtabstop=4
+# kate: tab-width: 4; replace-tabs on; indent-width 4; tab-indents: off;
+# kate: indent-mode python; remove-trailing-spaces modified;